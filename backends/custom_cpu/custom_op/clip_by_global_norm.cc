@@ -0,0 +1,86 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/l2_norm.h"
+#include "paddle/extension.h"
+
+namespace {
+
+// Returns the global norm, the gradients are scaled in place when it is
+// above max_norm.
+template <typename T>
+float ClipGradients(const std::vector<paddle::Tensor>& grads, float max_norm) {
+  std::vector<const T*> xs;
+  std::vector<T*> outs;
+  std::vector<int64_t> numels;
+  for (const auto& grad : grads) {
+    xs.push_back(grad.data<T>());
+    outs.push_back(const_cast<T*>(xs.back()));
+    numels.push_back(grad.numel());
+  }
+  const float norm = std::sqrt(
+      custom_kernel::funcs::MultiTensorSquaredL2Norm<T, float>(xs, numels));
+  if (norm > max_norm) {
+    custom_kernel::funcs::MultiTensorScale<T, float>(
+        xs, outs, numels, max_norm / norm);
+  }
+  return norm;
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> ClipByGlobalNorm(
+    const std::vector<paddle::Tensor>& grads, float max_norm) {
+  PD_CHECK(!grads.empty(), "clip_by_global_norm got no gradients.");
+  const auto dtype = grads[0].dtype();
+  for (const auto& grad : grads) {
+    PD_CHECK(grad.dtype() == dtype,
+             "All gradients of clip_by_global_norm must have the same "
+             "data type.");
+  }
+  float norm = 0.f;
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      dtype, "clip_by_global_norm", ([&] {
+        norm = ClipGradients<data_t>(grads, max_norm);
+      }));
+  return {paddle::full({1}, norm, paddle::DataType::FLOAT32, grads[0].place())};
+}
+
+std::vector<std::vector<int64_t>> ClipByGlobalNormInferShape(
+    const std::vector<std::vector<int64_t>>& grads_shape, float max_norm) {
+  return {{1}};
+}
+
+std::vector<paddle::DataType> ClipByGlobalNormInferDtype(
+    const std::vector<paddle::DataType>& grads_dtype) {
+  return {paddle::DataType::FLOAT32};
+}
+
+// Gradient clipping by global norm in two sweeps over all gradients
+// instead of a squared_l2_norm per gradient, a sum, a sqrt and a scale per
+// gradient: one multi-tensor reduction with Kahan compensated partials and,
+// when the norm exceeds max_norm, one multi-tensor scale in place. Grads
+// coalesced with coalesce_tensor can be passed as the single fused tensor.
+PD_BUILD_OP(clip_by_global_norm)
+    .Inputs({paddle::Vec("grads")})
+    .Outputs({paddle::Vec("grads_out"), "global_norm"})
+    .Attrs({"max_norm: float"})
+    .SetInplaceMap({{paddle::Vec("grads"), paddle::Vec("grads_out")}})
+    .SetKernelFn(PD_KERNEL(ClipByGlobalNorm))
+    .SetInferShapeFn(PD_INFER_SHAPE(ClipByGlobalNormInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(ClipByGlobalNormInferDtype));
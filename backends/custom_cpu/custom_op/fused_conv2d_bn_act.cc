@@ -0,0 +1,340 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/blocked_gemm.h"
+#include "kernels/funcs/layout.h"
+#include "paddle/extension.h"
+
+namespace {
+
+namespace funcs = custom_kernel::funcs;
+
+struct ConvGeometry {
+  int64_t batch, channels, height, width;
+  int64_t out_channels, kernel_h, kernel_w, groups;
+  int64_t stride_h, stride_w, dilation_h, dilation_w;
+  int64_t pad_top, pad_left;
+  int64_t out_h, out_w;
+  bool nhwc;
+};
+
+// Resolves the output size and padding the way conv2d does, including the
+// SAME / VALID padding algorithms.
+ConvGeometry GetConvGeometry(const std::vector<int64_t>& input_shape,
+                             const std::vector<int64_t>& filter_shape,
+                             const std::vector<int>& strides,
+                             const std::vector<int>& paddings,
+                             const std::string& padding_algorithm,
+                             const std::vector<int>& dilations,
+                             int groups,
+                             const std::string& data_format) {
+  PD_CHECK(input_shape.size() == 4 && filter_shape.size() == 4,
+           "fused_conv2d_bn_act expects a 4-D input and filter.");
+  PD_CHECK(strides.size() == 2 && dilations.size() == 2,
+           "fused_conv2d_bn_act expects 2 strides and 2 dilations.");
+  PD_CHECK(paddings.size() == 2 || paddings.size() == 4,
+           "fused_conv2d_bn_act expects 2 or 4 paddings.");
+  ConvGeometry g;
+  g.nhwc = data_format == "NHWC";
+  g.batch = input_shape[0];
+  g.channels = g.nhwc ? input_shape[3] : input_shape[1];
+  g.height = g.nhwc ? input_shape[1] : input_shape[2];
+  g.width = g.nhwc ? input_shape[2] : input_shape[3];
+  g.out_channels = filter_shape[0];
+  g.kernel_h = filter_shape[2];
+  g.kernel_w = filter_shape[3];
+  g.groups = std::max(groups, 1);
+  PD_CHECK(filter_shape[1] * g.groups == g.channels &&
+               g.out_channels % g.groups == 0,
+           "The filter of fused_conv2d_bn_act does not match the input "
+           "channels and groups.");
+  g.stride_h = strides[0];
+  g.stride_w = strides[1];
+  g.dilation_h = dilations[0];
+  g.dilation_w = dilations[1];
+
+  int64_t pads[4];  // top, bottom, left, right
+  if (paddings.size() == 2) {
+    pads[0] = pads[1] = paddings[0];
+    pads[2] = pads[3] = paddings[1];
+  } else {
+    for (int i = 0; i < 4; ++i) {
+      pads[i] = paddings[i];
+    }
+  }
+  if (padding_algorithm == "VALID") {
+    std::fill(pads, pads + 4, 0);
+  } else if (padding_algorithm == "SAME") {
+    g.dilation_h = g.dilation_w = 1;
+    const int64_t sizes[2] = {g.height, g.width};
+    const int64_t kernels[2] = {g.kernel_h, g.kernel_w};
+    const int64_t steps[2] = {g.stride_h, g.stride_w};
+    for (int i = 0; i < 2; ++i) {
+      const int64_t out = (sizes[i] + steps[i] - 1) / steps[i];
+      const int64_t total = std::max<int64_t>(
+          (out - 1) * steps[i] + kernels[i] - sizes[i], 0);
+      pads[2 * i] = total / 2;
+      pads[2 * i + 1] = total - total / 2;
+    }
+  }
+  g.pad_top = pads[0];
+  g.pad_left = pads[2];
+  g.out_h = (g.height + pads[0] + pads[1] -
+             (g.dilation_h * (g.kernel_h - 1) + 1)) /
+                g.stride_h +
+            1;
+  g.out_w = (g.width + pads[2] + pads[3] -
+             (g.dilation_w * (g.kernel_w - 1) + 1)) /
+                g.stride_w +
+            1;
+  return g;
+}
+
+std::vector<int64_t> ConvOutShape(const ConvGeometry& g) {
+  if (g.nhwc) {
+    return {g.batch, g.out_h, g.out_w, g.out_channels};
+  }
+  return {g.batch, g.out_channels, g.out_h, g.out_w};
+}
+
+// col[(c * KH + kh) * KW + kw, oh * OW + ow] of one NCHW image, zeros in
+// the padding.
+template <typename T>
+void Im2Col(const T* image, const ConvGeometry& g, T* col) {
+  const int64_t rows = g.channels * g.kernel_h * g.kernel_w;
+  const int64_t cols = g.out_h * g.out_w;
+  const int64_t grain = std::max<int64_t>(
+      1, funcs::kParallelGrainSize / std::max<int64_t>(1, cols));
+  funcs::ParallelFor(0, rows, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t row = begin; row < end; ++row) {
+      const int64_t kw = row % g.kernel_w;
+      const int64_t kh = row / g.kernel_w % g.kernel_h;
+      const int64_t c = row / (g.kernel_w * g.kernel_h);
+      const T* src = image + c * g.height * g.width;
+      T* dst = col + row * cols;
+      for (int64_t oh = 0; oh < g.out_h; ++oh) {
+        const int64_t ih = oh * g.stride_h - g.pad_top + kh * g.dilation_h;
+        T* out_row = dst + oh * g.out_w;
+        if (ih < 0 || ih >= g.height) {
+          std::fill(out_row, out_row + g.out_w, static_cast<T>(0));
+          continue;
+        }
+        for (int64_t ow = 0; ow < g.out_w; ++ow) {
+          const int64_t iw = ow * g.stride_w - g.pad_left + kw * g.dilation_w;
+          out_row[ow] = iw < 0 || iw >= g.width ? static_cast<T>(0)
+                                                : src[ih * g.width + iw];
+        }
+      }
+    }
+  });
+}
+
+template <typename T>
+void ConvBnAct(const paddle::Tensor& input,
+               const paddle::Tensor& filter,
+               const paddle::Tensor& scale,
+               const paddle::Tensor& bias,
+               const paddle::Tensor& mean,
+               const paddle::Tensor& variance,
+               const ConvGeometry& g,
+               float epsilon,
+               funcs::GemmActivation act,
+               T* out) {
+  // Fold the inference batch norm into the filter and a per channel bias:
+  // bn(conv(x, w)) = conv(x, w * s) + (beta - mean * s),
+  // s = gamma / sqrt(var + eps). The statistics are float32 for every
+  // input type, as in batch_norm.
+  const int64_t oc = g.out_channels;
+  const int64_t filter_size = filter.numel() / std::max<int64_t>(1, oc);
+  std::vector<T> folded(filter.numel());
+  std::vector<T> folded_bias(oc);
+  const T* w = filter.data<T>();
+  for (int64_t o = 0; o < oc; ++o) {
+    const float s =
+        scale.data<float>()[o] / std::sqrt(variance.data<float>()[o] + epsilon);
+    for (int64_t i = 0; i < filter_size; ++i) {
+      folded[o * filter_size + i] =
+          static_cast<T>(static_cast<float>(w[o * filter_size + i]) * s);
+    }
+    folded_bias[o] =
+        static_cast<T>(bias.data<float>()[o] - mean.data<float>()[o] * s);
+  }
+
+  const int64_t spatial = g.height * g.width;
+  const int64_t out_spatial = g.out_h * g.out_w;
+  const int64_t image_size = g.channels * spatial;
+  const int64_t out_size = oc * out_spatial;
+  const T* x = input.data<T>();
+  std::vector<T> nchw_in, nchw_out;
+  T* y = out;
+  if (g.nhwc) {
+    nchw_in.resize(input.numel());
+    nchw_out.resize(g.batch * out_size);
+    funcs::NhwcToNchw(x, g.batch, g.channels, spatial, nchw_in.data());
+    x = nchw_in.data();
+    y = nchw_out.data();
+  }
+
+  const bool pointwise = g.kernel_h == 1 && g.kernel_w == 1 &&
+                         g.stride_h == 1 && g.stride_w == 1 &&
+                         g.out_h == g.height && g.out_w == g.width;
+  std::vector<T> col(pointwise ? 0 : g.channels * g.kernel_h * g.kernel_w *
+                                         out_spatial);
+  const int64_t oc_g = oc / g.groups;
+  const int64_t k_g = filter_size;  // (C / groups) * KH * KW
+  for (int64_t n = 0; n < g.batch; ++n) {
+    const T* image = x + n * image_size;
+    const T* cols = image;
+    if (!pointwise) {
+      Im2Col(image, g, col.data());
+      cols = col.data();
+    }
+    std::vector<funcs::GemmProblem<T, float>> problems;
+    for (int64_t grp = 0; grp < g.groups; ++grp) {
+      funcs::GemmEpilogue<T> ep;
+      ep.bias = folded_bias.data() + grp * oc_g;
+      ep.bias_row_stride = 1;
+      ep.act = act;
+      problems.push_back({false,
+                          false,
+                          oc_g,
+                          k_g,
+                          out_spatial,
+                          folded.data() + grp * oc_g * k_g,
+                          cols + grp * k_g * out_spatial,
+                          y + n * out_size + grp * oc_g * out_spatial,
+                          false,
+                          1.0f,
+                          false,
+                          ep});
+    }
+    funcs::BlockedGemmBatch<T, float>(problems, funcs::DefaultGemmConfig());
+  }
+  if (g.nhwc) {
+    funcs::NchwToNhwc(y, g.batch, oc, out_spatial, out);
+  }
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> FusedConv2dBnAct(
+    const paddle::Tensor& input,
+    const paddle::Tensor& filter,
+    const paddle::Tensor& scale,
+    const paddle::Tensor& bias,
+    const paddle::Tensor& mean,
+    const paddle::Tensor& variance,
+    const std::vector<int>& strides,
+    const std::vector<int>& paddings,
+    const std::string& padding_algorithm,
+    const std::vector<int>& dilations,
+    int groups,
+    const std::string& data_format,
+    float epsilon,
+    const std::string& activation) {
+  funcs::GemmActivation act;
+  PD_CHECK(funcs::ParseGemmActivation(activation, &act),
+           "Unsupported activation of fused_conv2d_bn_act: ",
+           activation);
+  for (const auto* t : {&scale, &bias, &mean, &variance}) {
+    PD_CHECK(t->dtype() == paddle::DataType::FLOAT32 &&
+                 t->numel() == filter.shape()[0],
+             "The batch norm parameters of fused_conv2d_bn_act must be "
+             "float32 vectors of the output channels.");
+  }
+  const auto g = GetConvGeometry(input.shape(),
+                                 filter.shape(),
+                                 strides,
+                                 paddings,
+                                 padding_algorithm,
+                                 dilations,
+                                 groups,
+                                 data_format);
+  auto out = paddle::empty(ConvOutShape(g), input.dtype(), input.place());
+  if (out.numel() == 0) {
+    return {out};
+  }
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      input.dtype(), "fused_conv2d_bn_act", ([&] {
+        ConvBnAct<data_t>(input,
+                          filter,
+                          scale,
+                          bias,
+                          mean,
+                          variance,
+                          g,
+                          epsilon,
+                          act,
+                          out.data<data_t>());
+      }));
+  return {out};
+}
+
+std::vector<std::vector<int64_t>> FusedConv2dBnActInferShape(
+    const std::vector<int64_t>& input_shape,
+    const std::vector<int64_t>& filter_shape,
+    const std::vector<int64_t>& scale_shape,
+    const std::vector<int64_t>& bias_shape,
+    const std::vector<int64_t>& mean_shape,
+    const std::vector<int64_t>& variance_shape,
+    const std::vector<int>& strides,
+    const std::vector<int>& paddings,
+    const std::string& padding_algorithm,
+    const std::vector<int>& dilations,
+    int groups,
+    const std::string& data_format,
+    float epsilon,
+    const std::string& activation) {
+  return {ConvOutShape(GetConvGeometry(input_shape,
+                                       filter_shape,
+                                       strides,
+                                       paddings,
+                                       padding_algorithm,
+                                       dilations,
+                                       groups,
+                                       data_format))};
+}
+
+std::vector<paddle::DataType> FusedConv2dBnActInferDtype(
+    const paddle::DataType& input_dtype,
+    const paddle::DataType& filter_dtype,
+    const paddle::DataType& scale_dtype,
+    const paddle::DataType& bias_dtype,
+    const paddle::DataType& mean_dtype,
+    const paddle::DataType& variance_dtype) {
+  return {input_dtype};
+}
+
+// act(batch_norm(conv2d(input, filter))) for inference: the batch norm is
+// folded into the filter, and the conv runs as im2col + GEMM with the bias
+// and activation applied to each output tile.
+PD_BUILD_OP(fused_conv2d_bn_act)
+    .Inputs({"input", "filter", "scale", "bias", "mean", "variance"})
+    .Outputs({"out"})
+    .Attrs({"strides: std::vector<int>",
+            "paddings: std::vector<int>",
+            "padding_algorithm: std::string",
+            "dilations: std::vector<int>",
+            "groups: int",
+            "data_format: std::string",
+            "epsilon: float",
+            "activation: std::string"})
+    .SetKernelFn(PD_KERNEL(FusedConv2dBnAct))
+    .SetInferShapeFn(PD_INFER_SHAPE(FusedConv2dBnActInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(FusedConv2dBnActInferDtype));
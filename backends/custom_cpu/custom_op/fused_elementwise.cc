@@ -0,0 +1,285 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/fusion_engine.h"
+#include "kernels/funcs/jit/fused_elementwise_jit.h"
+#include "paddle/extension.h"
+
+namespace {
+
+// `out_dtype` uses the framework.proto VarType numbering so the fusion pass
+// can map it straight from the `out_dtype` of a cast op; -1 keeps the dtype
+// of x.
+paddle::DataType FusedOutDtype(int out_dtype, paddle::DataType x_dtype) {
+  switch (out_dtype) {
+    case -1:
+      return x_dtype;
+    case 0:
+      return paddle::DataType::BOOL;
+    case 2:
+      return paddle::DataType::INT32;
+    case 3:
+      return paddle::DataType::INT64;
+    case 4:
+      return paddle::DataType::FLOAT16;
+    case 5:
+      return paddle::DataType::FLOAT32;
+    case 6:
+      return paddle::DataType::FLOAT64;
+    case 22:
+      return paddle::DataType::BFLOAT16;
+    default:
+      PD_THROW("fused_elementwise does not support out_dtype ", out_dtype, ".");
+  }
+}
+
+// The numpy broadcast of the input shapes, which is the output shape. A -1
+// (unknown when inferring shapes) gives way to a known size.
+std::vector<int64_t> FusedBroadcastShape(
+    const std::vector<std::vector<int64_t>>& shapes) {
+  size_t rank = 0;
+  for (const auto& shape : shapes) {
+    rank = std::max(rank, shape.size());
+  }
+  std::vector<int64_t> out(rank, 1);
+  for (const auto& shape : shapes) {
+    const size_t pad = rank - shape.size();
+    for (size_t i = 0; i < shape.size(); ++i) {
+      int64_t& dim = out[pad + i];
+      if (shape[i] == 1 || shape[i] == dim) {
+        continue;
+      }
+      if (shape[i] == -1) {
+        dim = dim == 1 ? -1 : dim;
+        continue;
+      }
+      PD_CHECK(dim == 1 || dim == -1,
+               "fused_elementwise: the inputs cannot broadcast, dim ",
+               pad + i,
+               " is ",
+               dim,
+               " and ",
+               shape[i],
+               ".");
+      dim = shape[i];
+    }
+  }
+  return out;
+}
+
+// Whether `shape` reads as a FusedInput over `out_shape`: once ones are
+// trimmed from both ends, the dims left must equal the output dims they
+// align with. `inner` is the size of the output dims after them.
+bool FusedBlockLayout(const std::vector<int64_t>& shape,
+                      const std::vector<int64_t>& out_shape,
+                      int64_t* inner) {
+  const size_t pad = out_shape.size() - shape.size();
+  size_t first = 0;
+  size_t last = shape.size();
+  while (first < last && shape[first] == 1) {
+    ++first;
+  }
+  while (last > first && shape[last - 1] == 1) {
+    --last;
+  }
+  *inner = 1;
+  for (size_t i = last; i < shape.size(); ++i) {
+    *inner *= out_shape[pad + i];
+  }
+  for (size_t i = first; i < last; ++i) {
+    if (shape[i] != out_shape[pad + i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Any other broadcast (e.g. [C, 1, W]) is expanded to the output shape.
+template <typename T>
+std::vector<T> FusedBroadcastTo(const T* data,
+                                const std::vector<int64_t>& shape,
+                                const std::vector<int64_t>& out_shape,
+                                int64_t numel) {
+  const size_t rank = out_shape.size();
+  const size_t pad = rank - shape.size();
+  std::vector<int64_t> strides(rank, 0);
+  int64_t stride = 1;
+  for (size_t i = shape.size(); i-- > 0;) {
+    if (shape[i] != 1) {
+      strides[pad + i] = stride;
+    }
+    stride *= shape[i];
+  }
+  std::vector<T> out(numel);
+  std::vector<int64_t> index(rank, 0);
+  int64_t offset = 0;
+  for (int64_t i = 0; i < numel; ++i) {
+    out[i] = data[offset];
+    for (size_t d = rank; d-- > 0;) {
+      offset += strides[d];
+      if (++index[d] < out_shape[d]) {
+        break;
+      }
+      offset -= strides[d] * out_shape[d];
+      index[d] = 0;
+    }
+  }
+  return out;
+}
+
+template <typename T, typename OutT>
+void RunFused(const custom_kernel::funcs::FusedProgram& program,
+              const std::vector<custom_kernel::funcs::FusedInput<T>>& inputs,
+              int64_t numel,
+              paddle::Tensor* out) {
+  custom_kernel::funcs::RunFusedProgram<T, OutT>(
+      program, inputs, numel, out->data<OutT>());
+}
+
+// float32 programs over full-size inputs run as JIT code when the host
+// supports it; everything else goes through the tile interpreter.
+template <>
+void RunFused<float, float>(
+    const custom_kernel::funcs::FusedProgram& program,
+    const std::vector<custom_kernel::funcs::FusedInput<float>>& inputs,
+    int64_t numel,
+    paddle::Tensor* out) {
+  if (!custom_kernel::funcs::jit::TryRunFusedProgramJit(
+          program, inputs, numel, out->data<float>())) {
+    custom_kernel::funcs::RunFusedProgram<float, float>(
+        program, inputs, numel, out->data<float>());
+  }
+}
+
+template <typename T>
+void DispatchFusedOut(
+    const custom_kernel::funcs::FusedProgram& program,
+    const std::vector<custom_kernel::funcs::FusedInput<T>>& inputs,
+    int64_t numel,
+    paddle::Tensor* out) {
+  switch (out->dtype()) {
+    case paddle::DataType::BOOL:
+      return RunFused<T, bool>(program, inputs, numel, out);
+    case paddle::DataType::INT32:
+      return RunFused<T, int32_t>(program, inputs, numel, out);
+    case paddle::DataType::INT64:
+      return RunFused<T, int64_t>(program, inputs, numel, out);
+    case paddle::DataType::FLOAT16:
+      return RunFused<T, phi::dtype::float16>(program, inputs, numel, out);
+    case paddle::DataType::BFLOAT16:
+      return RunFused<T, phi::dtype::bfloat16>(program, inputs, numel, out);
+    case paddle::DataType::FLOAT64:
+      return RunFused<T, double>(program, inputs, numel, out);
+    default:
+      return RunFused<T, float>(program, inputs, numel, out);
+  }
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> FusedElementwise(
+    const paddle::Tensor& x,
+    const paddle::optional<paddle::Tensor>& y,
+    const paddle::optional<paddle::Tensor>& z,
+    const std::string& program_text,
+    int out_dtype) {
+  std::vector<const paddle::Tensor*> tensors = {&x};
+  if (y) {
+    tensors.push_back(y.get_ptr());
+  }
+  if (z) {
+    PD_CHECK(y, "fused_elementwise: z is given without y.");
+    tensors.push_back(z.get_ptr());
+  }
+  std::vector<std::vector<int64_t>> shapes;
+  for (auto* t : tensors) {
+    PD_CHECK(t->dtype() == x.dtype(),
+             "fused_elementwise: all inputs must have the dtype of x.");
+    shapes.push_back(t->shape());
+  }
+  const auto out_shape = FusedBroadcastShape(shapes);
+
+  custom_kernel::funcs::FusedProgram program;
+  std::string error;
+  const int num_inputs = static_cast<int>(tensors.size());
+  PD_CHECK(program.Parse(program_text, num_inputs, &error),
+           "fused_elementwise: invalid program '",
+           program_text,
+           "': ",
+           error,
+           ".");
+
+  auto out = paddle::empty(
+      out_shape, FusedOutDtype(out_dtype, x.dtype()), x.place());
+  const int64_t numel = out.numel();
+  if (numel == 0) {
+    return {out};
+  }
+  PD_CUSTOM_CPU_DISPATCH_ELEMENTWISE_TYPES(
+      x.dtype(), "fused_elementwise", ([&] {
+        std::vector<custom_kernel::funcs::FusedInput<data_t>> inputs;
+        std::vector<std::vector<data_t>> expanded;
+        expanded.reserve(tensors.size());
+        for (auto* t : tensors) {
+          int64_t inner = 1;
+          if (FusedBlockLayout(t->shape(), out_shape, &inner)) {
+            inputs.push_back({t->data<data_t>(), t->numel(), inner});
+          } else {
+            expanded.push_back(FusedBroadcastTo(
+                t->data<data_t>(), t->shape(), out_shape, numel));
+            inputs.push_back({expanded.back().data(), numel});
+          }
+        }
+        DispatchFusedOut<data_t>(program, inputs, numel, &out);
+      }));
+  return {out};
+}
+
+std::vector<std::vector<int64_t>> FusedElementwiseInferShape(
+    const std::vector<int64_t>& x_shape,
+    const paddle::optional<std::vector<int64_t>>& y_shape,
+    const paddle::optional<std::vector<int64_t>>& z_shape,
+    const std::string& program_text,
+    int out_dtype) {
+  std::vector<std::vector<int64_t>> shapes = {x_shape};
+  if (y_shape) {
+    shapes.push_back(*y_shape);
+  }
+  if (z_shape) {
+    shapes.push_back(*z_shape);
+  }
+  return {FusedBroadcastShape(shapes)};
+}
+
+std::vector<paddle::DataType> FusedElementwiseInferDtype(
+    const paddle::DataType& x_dtype,
+    const paddle::optional<paddle::DataType>& y_dtype,
+    const paddle::optional<paddle::DataType>& z_dtype,
+    const std::string& program_text,
+    int out_dtype) {
+  return {FusedOutDtype(out_dtype, x_dtype)};
+}
+
+PD_BUILD_OP(fused_elementwise)
+    .Inputs({"x", paddle::Optional("y"), paddle::Optional("z")})
+    .Outputs({"out"})
+    .Attrs({"program: std::string", "out_dtype: int"})
+    .SetKernelFn(PD_KERNEL(FusedElementwise))
+    .SetInferShapeFn(PD_INFER_SHAPE(FusedElementwiseInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(FusedElementwiseInferDtype));
@@ -0,0 +1,182 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/blocked_gemm.h"
+#include "paddle/extension.h"
+
+namespace {
+
+namespace funcs = custom_kernel::funcs;
+
+std::vector<int64_t> MatmulOutShape(const std::vector<int64_t>& x_shape,
+                                    const std::vector<int64_t>& y_shape,
+                                    bool trans_x,
+                                    bool trans_y) {
+  PD_CHECK(x_shape.size() >= 2 && y_shape.size() == 2,
+           "fused_matmul_bias_act expects x of rank >= 2 and a 2-D y.");
+  const size_t r = x_shape.size();
+  const int64_t M = trans_x ? x_shape[r - 1] : x_shape[r - 2];
+  const int64_t K = trans_x ? x_shape[r - 2] : x_shape[r - 1];
+  PD_CHECK(K == (trans_y ? y_shape[1] : y_shape[0]),
+           "The contracted dims of x and y of fused_matmul_bias_act differ.");
+  std::vector<int64_t> out(x_shape.begin(), x_shape.end() - 2);
+  out.push_back(M);
+  out.push_back(trans_y ? y_shape[0] : y_shape[1]);
+  return out;
+}
+
+// Rows of the [rows, N] pattern the bias repeats with over the flattened
+// output: 0 for a [N] bias. The bias shape (without leading 1s) must be a
+// suffix of the output shape.
+int64_t BiasRows(const std::vector<int64_t>& bias_shape,
+                 const std::vector<int64_t>& out_shape) {
+  size_t lead = 0;
+  while (lead + 1 < bias_shape.size() && bias_shape[lead] == 1) {
+    ++lead;
+  }
+  const size_t rank = bias_shape.size() - lead;
+  bool suffix = rank >= 1 && rank <= out_shape.size();
+  int64_t rows = 1;
+  for (size_t i = 0; suffix && i < rank; ++i) {
+    const int64_t dim = bias_shape[bias_shape.size() - 1 - i];
+    suffix = dim == out_shape[out_shape.size() - 1 - i];
+    rows *= i == 0 ? 1 : dim;
+  }
+  PD_CHECK(suffix,
+           "The bias of fused_matmul_bias_act must broadcast along the "
+           "leading dims of the output.");
+  return rank == 1 ? 0 : rows;
+}
+
+template <typename T>
+void MatmulBiasAct(const paddle::Tensor& x,
+                   const paddle::Tensor& y,
+                   const paddle::optional<paddle::Tensor>& bias,
+                   bool trans_x,
+                   bool trans_y,
+                   funcs::GemmActivation act,
+                   paddle::Tensor* out) {
+  const auto x_shape = x.shape();
+  const auto out_shape = out->shape();
+  const size_t r = out_shape.size();
+  const int64_t M = out_shape[r - 2];
+  const int64_t N = out_shape[r - 1];
+  const int64_t K = trans_x ? x_shape[r - 2] : x_shape[r - 1];
+  const int64_t batch = out->numel() / std::max<int64_t>(1, M * N);
+
+  funcs::GemmEpilogue<T> epilogue;
+  epilogue.act = act;
+  int64_t bias_rows = 0;
+  if (bias) {
+    epilogue.bias = bias->data<T>();
+    epilogue.bias_col_stride = 1;
+    bias_rows = BiasRows(bias->shape(), out_shape);
+    epilogue.bias_row_stride = bias_rows > 0 ? N : 0;
+  }
+
+  std::vector<funcs::GemmProblem<T, float>> problems;
+  if (!trans_x) {
+    // the batch folds into M, so y is packed once per column panel
+    epilogue.bias_rows = bias_rows;
+    problems.push_back({false,
+                        trans_y,
+                        batch * M,
+                        K,
+                        N,
+                        x.data<T>(),
+                        y.data<T>(),
+                        out->data<T>(),
+                        false,
+                        1.0f,
+                        false,
+                        epilogue});
+  } else {
+    for (int64_t b = 0; b < batch; ++b) {
+      funcs::GemmEpilogue<T> ep = epilogue;
+      if (bias_rows > 0) {
+        // bias_rows is a multiple of M here
+        ep.bias += (b * M) % bias_rows * N;
+      }
+      problems.push_back({true,
+                          trans_y,
+                          M,
+                          K,
+                          N,
+                          x.data<T>() + b * M * K,
+                          y.data<T>(),
+                          out->data<T>() + b * M * N,
+                          false,
+                          1.0f,
+                          false,
+                          ep});
+    }
+  }
+  funcs::BlockedGemmBatch<T, float>(problems, funcs::DefaultGemmConfig());
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> FusedMatmulBiasAct(
+    const paddle::Tensor& x,
+    const paddle::Tensor& y,
+    const paddle::optional<paddle::Tensor>& bias,
+    bool trans_x,
+    bool trans_y,
+    const std::string& activation) {
+  funcs::GemmActivation act;
+  PD_CHECK(funcs::ParseGemmActivation(activation, &act),
+           "Unsupported activation of fused_matmul_bias_act: ",
+           activation);
+  auto out_shape = MatmulOutShape(x.shape(), y.shape(), trans_x, trans_y);
+  auto out = paddle::empty(out_shape, x.dtype(), x.place());
+  if (out.numel() == 0) {
+    return {out};
+  }
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      x.dtype(), "fused_matmul_bias_act", ([&] {
+        MatmulBiasAct<data_t>(x, y, bias, trans_x, trans_y, act, &out);
+      }));
+  return {out};
+}
+
+std::vector<std::vector<int64_t>> FusedMatmulBiasActInferShape(
+    const std::vector<int64_t>& x_shape,
+    const std::vector<int64_t>& y_shape,
+    const paddle::optional<std::vector<int64_t>>& bias_shape,
+    bool trans_x,
+    bool trans_y,
+    const std::string& activation) {
+  return {MatmulOutShape(x_shape, y_shape, trans_x, trans_y)};
+}
+
+std::vector<paddle::DataType> FusedMatmulBiasActInferDtype(
+    const paddle::DataType& x_dtype,
+    const paddle::DataType& y_dtype,
+    const paddle::optional<paddle::DataType>& bias_dtype) {
+  return {x_dtype};
+}
+
+// act(matmul(x, y) + bias): the bias add and activation run on each output
+// tile while it is still in cache.
+PD_BUILD_OP(fused_matmul_bias_act)
+    .Inputs({"x", "y", paddle::Optional("bias")})
+    .Outputs({"out"})
+    .Attrs({"trans_x: bool", "trans_y: bool", "activation: std::string"})
+    .SetKernelFn(PD_KERNEL(FusedMatmulBiasAct))
+    .SetInferShapeFn(PD_INFER_SHAPE(FusedMatmulBiasActInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(FusedMatmulBiasActInferDtype));
@@ -0,0 +1,125 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/blocked_gemm.h"
+#include "paddle/extension.h"
+
+namespace {
+
+namespace funcs = custom_kernel::funcs;
+
+std::vector<int64_t> ProjectionShape(const std::vector<int64_t>& x_shape,
+                                     const std::vector<int64_t>& w_shape) {
+  PD_CHECK(x_shape.size() >= 2 && w_shape.size() == 2 &&
+               x_shape.back() == w_shape[0],
+           "fused_qkv_projection expects x [..., K] and weights [K, N].");
+  std::vector<int64_t> shape(x_shape.begin(), x_shape.end() - 1);
+  shape.push_back(w_shape[1]);
+  return shape;
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> FusedQkvProjection(
+    const paddle::Tensor& x,
+    const paddle::Tensor& q_weight,
+    const paddle::Tensor& k_weight,
+    const paddle::Tensor& v_weight,
+    const paddle::optional<paddle::Tensor>& q_bias,
+    const paddle::optional<paddle::Tensor>& k_bias,
+    const paddle::optional<paddle::Tensor>& v_bias) {
+  const paddle::Tensor* weights[3] = {&q_weight, &k_weight, &v_weight};
+  const paddle::optional<paddle::Tensor>* biases[3] = {
+      &q_bias, &k_bias, &v_bias};
+  std::vector<paddle::Tensor> outs;
+  for (int i = 0; i < 3; ++i) {
+    const auto shape = ProjectionShape(x.shape(), weights[i]->shape());
+    outs.push_back(paddle::empty(shape, x.dtype(), x.place()));
+    PD_CHECK(!*biases[i] || (*biases[i])->numel() == weights[i]->shape()[1],
+             "The biases of fused_qkv_projection must be [N] vectors.");
+  }
+  const int64_t K = x.shape().back();
+  const int64_t M = K == 0 ? 0 : x.numel() / K;
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      x.dtype(), "fused_qkv_projection", ([&] {
+        // one parallel region over the tiles of all three products, so the
+        // activation panels are shared in cache between them
+        std::vector<funcs::GemmProblem<data_t, float>> problems;
+        for (int i = 0; i < 3; ++i) {
+          funcs::GemmEpilogue<data_t> ep;
+          if (*biases[i]) {
+            ep.bias = (*biases[i])->data<data_t>();
+            ep.bias_col_stride = 1;
+          }
+          problems.push_back({false,
+                              false,
+                              M,
+                              K,
+                              weights[i]->shape()[1],
+                              x.data<data_t>(),
+                              weights[i]->data<data_t>(),
+                              outs[i].data<data_t>(),
+                              false,
+                              1.0f,
+                              false,
+                              ep});
+        }
+        funcs::BlockedGemmBatch<data_t, float>(problems,
+                                               funcs::DefaultGemmConfig());
+      }));
+  return outs;
+}
+
+std::vector<std::vector<int64_t>> FusedQkvProjectionInferShape(
+    const std::vector<int64_t>& x_shape,
+    const std::vector<int64_t>& q_weight_shape,
+    const std::vector<int64_t>& k_weight_shape,
+    const std::vector<int64_t>& v_weight_shape,
+    const paddle::optional<std::vector<int64_t>>& q_bias_shape,
+    const paddle::optional<std::vector<int64_t>>& k_bias_shape,
+    const paddle::optional<std::vector<int64_t>>& v_bias_shape) {
+  return {ProjectionShape(x_shape, q_weight_shape),
+          ProjectionShape(x_shape, k_weight_shape),
+          ProjectionShape(x_shape, v_weight_shape)};
+}
+
+std::vector<paddle::DataType> FusedQkvProjectionInferDtype(
+    const paddle::DataType& x_dtype,
+    const paddle::DataType& q_weight_dtype,
+    const paddle::DataType& k_weight_dtype,
+    const paddle::DataType& v_weight_dtype,
+    const paddle::optional<paddle::DataType>& q_bias_dtype,
+    const paddle::optional<paddle::DataType>& k_bias_dtype,
+    const paddle::optional<paddle::DataType>& v_bias_dtype) {
+  return {x_dtype, x_dtype, x_dtype};
+}
+
+// The query, key and value projections of attention, x * W + b for the
+// three weights, computed together. The weights are used untransposed, so
+// the fusion pass only matches matmul_v2 with trans_x = trans_y = false.
+PD_BUILD_OP(fused_qkv_projection)
+    .Inputs({"x",
+             "q_weight",
+             "k_weight",
+             "v_weight",
+             paddle::Optional("q_bias"),
+             paddle::Optional("k_bias"),
+             paddle::Optional("v_bias")})
+    .Outputs({"q", "k", "v"})
+    .SetKernelFn(PD_KERNEL(FusedQkvProjection))
+    .SetInferShapeFn(PD_INFER_SHAPE(FusedQkvProjectionInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(FusedQkvProjectionInferDtype));
@@ -0,0 +1,189 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/parallel.h"
+#include "paddle/extension.h"
+
+namespace {
+
+// Statistics are accumulated in double for double data and in float for
+// everything else.
+template <typename T>
+using ComputeType = typename std::conditional<std::is_same<T, double>::value,
+                                              double,
+                                              float>::type;
+
+// residual_out = x + residual
+// out = (residual_out - mean) / sqrt(var + epsilon) * scale + bias
+// per row of `cols` elements. The sum is kept in the compute type for the
+// statistics, so each row is read from memory once.
+template <typename T, typename MT = ComputeType<T>>
+void ResidualLayerNorm(const T* x,
+                       const T* residual,
+                       const MT* scale,
+                       const MT* bias,
+                       int64_t rows,
+                       int64_t cols,
+                       float epsilon,
+                       T* out,
+                       T* residual_out) {
+  const int64_t grain =
+      std::max<int64_t>(1, custom_kernel::funcs::kParallelGrainSize / cols);
+  custom_kernel::funcs::ParallelFor(
+      0, rows, grain, [&](int64_t begin, int64_t end) {
+        std::vector<MT> sum(cols);
+        for (int64_t r = begin; r < end; ++r) {
+          const int64_t offset = r * cols;
+          MT mean = 0;
+          for (int64_t i = 0; i < cols; ++i) {
+            const MT a = static_cast<MT>(x[offset + i]);
+            const MT b = static_cast<MT>(residual[offset + i]);
+            const T v = static_cast<T>(a + b);
+            residual_out[offset + i] = v;
+            sum[i] = static_cast<MT>(v);
+            mean += sum[i];
+          }
+          mean /= cols;
+          MT var = 0;
+          for (int64_t i = 0; i < cols; ++i) {
+            const MT d = sum[i] - mean;
+            var += d * d;
+          }
+          const MT rstd =
+              MT(1) / std::sqrt(var / cols + static_cast<MT>(epsilon));
+          for (int64_t i = 0; i < cols; ++i) {
+            MT v = (sum[i] - mean) * rstd;
+            if (scale != nullptr) {
+              v *= scale[i];
+            }
+            if (bias != nullptr) {
+              v += bias[i];
+            }
+            out[offset + i] = static_cast<T>(v);
+          }
+        }
+      });
+}
+
+// layer_norm takes float32 or x typed scale and bias.
+template <typename MT>
+std::vector<MT> ToComputeVector(const paddle::optional<paddle::Tensor>& t) {
+  std::vector<MT> values;
+  if (!t) {
+    return values;
+  }
+  values.resize(t->numel());
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_AND_DOUBLE_TYPES(
+      t->dtype(), "fused_residual_layer_norm", ([&] {
+        const data_t* src = t->data<data_t>();
+        for (int64_t i = 0; i < t->numel(); ++i) {
+          values[i] = static_cast<MT>(src[i]);
+        }
+      }));
+  return values;
+}
+
+void CheckResidualLayerNorm(const std::vector<int64_t>& x_shape,
+                            const std::vector<int64_t>& residual_shape,
+                            int begin_norm_axis) {
+  PD_CHECK(x_shape == residual_shape,
+           "x and residual of fused_residual_layer_norm must have the same "
+           "shape.");
+  PD_CHECK(begin_norm_axis > 0 &&
+               begin_norm_axis < static_cast<int>(x_shape.size()),
+           "begin_norm_axis of fused_residual_layer_norm must be in [1, ",
+           x_shape.size(),
+           ").");
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> FusedResidualLayerNorm(
+    const paddle::Tensor& x,
+    const paddle::Tensor& residual,
+    const paddle::optional<paddle::Tensor>& scale,
+    const paddle::optional<paddle::Tensor>& bias,
+    float epsilon,
+    int begin_norm_axis) {
+  const auto shape = x.shape();
+  CheckResidualLayerNorm(shape, residual.shape(), begin_norm_axis);
+  int64_t cols = 1;
+  for (size_t i = begin_norm_axis; i < shape.size(); ++i) {
+    cols *= shape[i];
+  }
+  const int64_t rows = cols == 0 ? 0 : x.numel() / cols;
+  PD_CHECK((!scale || scale->numel() == cols) &&
+               (!bias || bias->numel() == cols),
+           "scale and bias of fused_residual_layer_norm must have ",
+           cols,
+           " elements.");
+  auto out = paddle::empty(shape, x.dtype(), x.place());
+  auto residual_out = paddle::empty(shape, x.dtype(), x.place());
+  if (x.numel() == 0) {
+    return {out, residual_out};
+  }
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_AND_DOUBLE_TYPES(
+      x.dtype(), "fused_residual_layer_norm", ([&] {
+        using MT = ComputeType<data_t>;
+        const auto scale_values = ToComputeVector<MT>(scale);
+        const auto bias_values = ToComputeVector<MT>(bias);
+        ResidualLayerNorm<data_t>(
+            x.data<data_t>(),
+            residual.data<data_t>(),
+            scale ? scale_values.data() : nullptr,
+            bias ? bias_values.data() : nullptr,
+            rows,
+            cols,
+            epsilon,
+            out.data<data_t>(),
+            residual_out.data<data_t>());
+      }));
+  return {out, residual_out};
+}
+
+std::vector<std::vector<int64_t>> FusedResidualLayerNormInferShape(
+    const std::vector<int64_t>& x_shape,
+    const std::vector<int64_t>& residual_shape,
+    const paddle::optional<std::vector<int64_t>>& scale_shape,
+    const paddle::optional<std::vector<int64_t>>& bias_shape,
+    float epsilon,
+    int begin_norm_axis) {
+  return {x_shape, x_shape};
+}
+
+std::vector<paddle::DataType> FusedResidualLayerNormInferDtype(
+    const paddle::DataType& x_dtype,
+    const paddle::DataType& residual_dtype,
+    const paddle::optional<paddle::DataType>& scale_dtype,
+    const paddle::optional<paddle::DataType>& bias_dtype) {
+  return {x_dtype, x_dtype};
+}
+
+// layer_norm(x + residual) in one pass over the rows, also returning the
+// sum for the next residual connection.
+PD_BUILD_OP(fused_residual_layer_norm)
+    .Inputs({"x",
+             "residual",
+             paddle::Optional("scale"),
+             paddle::Optional("bias")})
+    .Outputs({"out", "residual_out"})
+    .Attrs({"epsilon: float", "begin_norm_axis: int"})
+    .SetKernelFn(PD_KERNEL(FusedResidualLayerNorm))
+    .SetInferShapeFn(PD_INFER_SHAPE(FusedResidualLayerNormInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(FusedResidualLayerNormInferDtype));
@@ -0,0 +1,156 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/parallel.h"
+#include "paddle/extension.h"
+
+namespace {
+
+// Heads of rope rows rotated per parallel block.
+constexpr int64_t kRopeGrain = 4096;
+
+// x [batch, seq_len, num_heads, head_dim], cos/sin [1, seq_len, 1, head_dim]
+//
+// Forward:  y = x * cos + rotate_half(x) * sin, rotate_half(x) = [-x2, x1]
+// Backward: dx = dy * cos + rotate_half^T(dy * sin), rotate_half^T = [y2, -y1]
+template <typename T, bool kBackward>
+void RotateHalf(const T* x,
+                const T* cos,
+                const T* sin,
+                int64_t batch,
+                int64_t seq_len,
+                int64_t num_heads,
+                int64_t head_dim,
+                T* out) {
+  const int64_t half = head_dim / 2;
+  const int64_t grain =
+      std::max<int64_t>(1, kRopeGrain / std::max<int64_t>(num_heads, 1));
+  custom_kernel::funcs::ParallelFor(
+      0, batch * seq_len, grain, [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t s = row % seq_len;
+          const T* c = cos + s * head_dim;
+          const T* sn = sin + s * head_dim;
+          for (int64_t h = 0; h < num_heads; ++h) {
+            const int64_t offset = (row * num_heads + h) * head_dim;
+            const T* src = x + offset;
+            T* dst = out + offset;
+            for (int64_t i = 0; i < half; ++i) {
+              const float x1 = static_cast<float>(src[i]);
+              const float x2 = static_cast<float>(src[i + half]);
+              const float c1 = static_cast<float>(c[i]);
+              const float c2 = static_cast<float>(c[i + half]);
+              const float s1 = static_cast<float>(sn[i]);
+              const float s2 = static_cast<float>(sn[i + half]);
+              if (kBackward) {
+                dst[i] = static_cast<T>(x1 * c1 + x2 * s2);
+                dst[i + half] = static_cast<T>(x2 * c2 - x1 * s1);
+              } else {
+                dst[i] = static_cast<T>(x1 * c1 - x2 * s1);
+                dst[i + half] = static_cast<T>(x2 * c2 + x1 * s2);
+              }
+            }
+          }
+        }
+      });
+}
+
+void CheckRopeInputs(const paddle::Tensor& query,
+                     const paddle::Tensor& cos,
+                     const paddle::Tensor& sin) {
+  auto q_shape = query.shape();
+  auto cos_shape = cos.shape();
+  PD_CHECK(q_shape.size() == 4,
+           "The query of fused_rope must be [batch, seq_len, num_heads, "
+           "head_dim].");
+  PD_CHECK(q_shape[3] % 2 == 0, "The head_dim of fused_rope must be even.");
+  PD_CHECK(cos_shape == sin.shape(),
+           "The shapes of cos and sin of fused_rope must be the same.");
+  PD_CHECK(cos_shape.size() == 4 && cos_shape[0] == 1 && cos_shape[2] == 1 &&
+               cos_shape[1] == q_shape[1] && cos_shape[3] == q_shape[3],
+           "The cos and sin tables of fused_rope must be [1, seq_len, 1, "
+           "head_dim].");
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> FusedRope(const paddle::Tensor& query,
+                                      const paddle::Tensor& cos,
+                                      const paddle::Tensor& sin) {
+  CheckRopeInputs(query, cos, sin);
+  auto shape = query.shape();
+  auto out = paddle::empty(shape, query.dtype(), query.place());
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(query.dtype(), "fused_rope", ([&] {
+                                       RotateHalf<data_t, false>(
+                                           query.data<data_t>(),
+                                           cos.data<data_t>(),
+                                           sin.data<data_t>(),
+                                           shape[0],
+                                           shape[1],
+                                           shape[2],
+                                           shape[3],
+                                           out.data<data_t>());
+                                     }));
+  return {out};
+}
+
+std::vector<paddle::Tensor> FusedRopeGrad(const paddle::Tensor& query,
+                                          const paddle::Tensor& grad_out,
+                                          const paddle::Tensor& cos,
+                                          const paddle::Tensor& sin) {
+  CheckRopeInputs(query, cos, sin);
+  auto shape = query.shape();
+  auto grad_query = paddle::empty(shape, query.dtype(), query.place());
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(query.dtype(), "fused_rope_grad", ([&] {
+                                       RotateHalf<data_t, true>(
+                                           grad_out.data<data_t>(),
+                                           cos.data<data_t>(),
+                                           sin.data<data_t>(),
+                                           shape[0],
+                                           shape[1],
+                                           shape[2],
+                                           shape[3],
+                                           grad_query.data<data_t>());
+                                     }));
+  return {grad_query};
+}
+
+std::vector<std::vector<int64_t>> FusedRopeInferShape(
+    const std::vector<int64_t>& query_shape,
+    const std::vector<int64_t>& cos_shape,
+    const std::vector<int64_t>& sin_shape) {
+  return {query_shape};
+}
+
+std::vector<paddle::DataType> FusedRopeInferDtype(
+    const paddle::DataType& query_dtype,
+    const paddle::DataType& cos_dtype,
+    const paddle::DataType& sin_dtype) {
+  return {query_dtype};
+}
+
+PD_BUILD_OP(fused_rope)
+    .Inputs({"query", "cos", "sin"})
+    .Outputs({"query_out"})
+    .SetKernelFn(PD_KERNEL(FusedRope))
+    .SetInferShapeFn(PD_INFER_SHAPE(FusedRopeInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(FusedRopeInferDtype));
+
+PD_BUILD_GRAD_OP(fused_rope)
+    .Inputs({"query", paddle::Grad("query_out"), "cos", "sin"})
+    .Outputs({paddle::Grad("query")})
+    .SetKernelFn(PD_KERNEL(FusedRopeGrad));
@@ -0,0 +1,178 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/layout.h"
+#include "paddle/extension.h"
+
+namespace {
+
+using custom_kernel::funcs::ImageFormat;
+
+struct ImageShape {
+  int64_t batch;
+  int64_t channels;
+  std::vector<int64_t> spatial;
+};
+
+ImageFormat GetFormat(const std::string& name) {
+  ImageFormat format;
+  PD_CHECK(custom_kernel::funcs::ParseImageFormat(name, &format),
+           "layout_reorder supports NCHW, NHWC, NCDHW, NDHWC and nChw16c, "
+           "but received ",
+           name,
+           ".");
+  return format;
+}
+
+// `channels` is the unpadded channel count of a blocked input, -1 for all
+// of its blocks.
+ImageShape ParseShape(const std::vector<int64_t>& shape,
+                      ImageFormat format,
+                      int channels) {
+  const size_t min_rank = format == ImageFormat::kNChw16c ? 4 : 3;
+  PD_CHECK(shape.size() >= min_rank,
+           "The input of layout_reorder must have at least ",
+           min_rank,
+           " dims.");
+  ImageShape image;
+  image.batch = shape[0];
+  if (format == ImageFormat::kNCHW) {
+    image.channels = shape[1];
+    image.spatial.assign(shape.begin() + 2, shape.end());
+  } else if (format == ImageFormat::kNHWC) {
+    image.channels = shape.back();
+    image.spatial.assign(shape.begin() + 1, shape.end() - 1);
+  } else {
+    PD_CHECK(shape.back() == custom_kernel::funcs::kChannelBlock,
+             "The last dim of a nChw16c input must be 16.");
+    const int64_t padded = shape[1] * custom_kernel::funcs::kChannelBlock;
+    image.channels = channels < 0 ? padded : channels;
+    PD_CHECK(image.channels <= padded &&
+                 image.channels > padded - custom_kernel::funcs::kChannelBlock,
+             "channels (",
+             channels,
+             ") does not match the ",
+             shape[1],
+             " channel blocks of the nChw16c input.");
+    image.spatial.assign(shape.begin() + 2, shape.end() - 1);
+  }
+  return image;
+}
+
+std::vector<int64_t> FormatShape(const ImageShape& image, ImageFormat format) {
+  std::vector<int64_t> shape{image.batch};
+  if (format == ImageFormat::kNCHW) {
+    shape.push_back(image.channels);
+    shape.insert(shape.end(), image.spatial.begin(), image.spatial.end());
+  } else if (format == ImageFormat::kNHWC) {
+    shape.insert(shape.end(), image.spatial.begin(), image.spatial.end());
+    shape.push_back(image.channels);
+  } else {
+    shape.push_back(custom_kernel::funcs::ChannelBlocks(image.channels));
+    shape.insert(shape.end(), image.spatial.begin(), image.spatial.end());
+    shape.push_back(custom_kernel::funcs::kChannelBlock);
+  }
+  return shape;
+}
+
+template <typename T>
+void Reorder(const T* x,
+             ImageFormat src,
+             ImageFormat dst,
+             const ImageShape& image,
+             int64_t numel,
+             T* out) {
+  int64_t spatial = 1;
+  for (auto s : image.spatial) {
+    spatial *= s;
+  }
+  namespace funcs = custom_kernel::funcs;
+  if (src == dst) {
+    funcs::ParallelMemcpy(out, x, numel * sizeof(T));
+  } else if (dst == ImageFormat::kNChw16c) {
+    funcs::PlainToBlocked(x,
+                          src == ImageFormat::kNHWC,
+                          image.batch,
+                          image.channels,
+                          spatial,
+                          out);
+  } else if (src == ImageFormat::kNChw16c) {
+    funcs::BlockedToPlain(x,
+                          dst == ImageFormat::kNHWC,
+                          image.batch,
+                          image.channels,
+                          spatial,
+                          out);
+  } else if (src == ImageFormat::kNCHW) {
+    funcs::NchwToNhwc(x, image.batch, image.channels, spatial, out);
+  } else {
+    funcs::NhwcToNchw(x, image.batch, image.channels, spatial, out);
+  }
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> LayoutReorder(const paddle::Tensor& x,
+                                          const std::string& src_format,
+                                          const std::string& dst_format,
+                                          int channels) {
+  const auto src = GetFormat(src_format);
+  const auto dst = GetFormat(dst_format);
+  const auto image = ParseShape(x.shape(), src, channels);
+  auto out = paddle::empty(FormatShape(image, dst), x.dtype(), x.place());
+  if (x.numel() == 0) {
+    return {out};
+  }
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(x.dtype(), "layout_reorder", ([&] {
+                                       Reorder<data_t>(x.data<data_t>(),
+                                                       src,
+                                                       dst,
+                                                       image,
+                                                       x.numel(),
+                                                       out.data<data_t>());
+                                     }));
+  return {out};
+}
+
+std::vector<std::vector<int64_t>> LayoutReorderInferShape(
+    const std::vector<int64_t>& x_shape,
+    const std::string& src_format,
+    const std::string& dst_format,
+    int channels) {
+  const auto src = GetFormat(src_format);
+  const auto dst = GetFormat(dst_format);
+  return {FormatShape(ParseShape(x_shape, src, channels), dst)};
+}
+
+std::vector<paddle::DataType> LayoutReorderInferDtype(
+    const paddle::DataType& x_dtype) {
+  return {x_dtype};
+}
+
+// Reorders an image batch between NCHW, NHWC and the channel-blocked
+// nChw16c layout. Put it on the edges of a chain of kernels working in one
+// layout instead of transposing around every op.
+PD_BUILD_OP(layout_reorder)
+    .Inputs({"x"})
+    .Outputs({"out"})
+    .Attrs({"src_format: std::string",
+            "dst_format: std::string",
+            "channels: int"})
+    .SetKernelFn(PD_KERNEL(LayoutReorder))
+    .SetInferShapeFn(PD_INFER_SHAPE(LayoutReorderInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(LayoutReorderInferDtype));
@@ -0,0 +1,218 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/funcs/philox.h"
+#include "kernels/funcs/sampling.h"
+#include "paddle/extension.h"
+
+namespace {
+
+template <typename T>
+struct SamplingInputs {
+  const T* logits;
+  const int64_t* pre_ids;
+  const T* penalty_scores;
+  const T* frequency_scores;
+  const T* presence_scores;
+  const T* temperatures;
+  const T* top_p;
+  const int64_t* cur_len;
+  const int64_t* min_len;
+  const int64_t* eos_token_id;
+  const bool* stop_flags;
+  int64_t num_eos;
+  int64_t bs;
+  int64_t max_len;
+  int64_t vocab;
+};
+
+template <typename T>
+void FusedTokenSamplingImpl(const SamplingInputs<T>& in,
+                            int64_t top_k,
+                            const custom_kernel::funcs::Philox4x32& philox,
+                            int64_t* next_tokens,
+                            bool* stop_flags_out) {
+  namespace funcs = custom_kernel::funcs;
+  funcs::ParallelFor(0, in.bs, 1, [&](int64_t begin, int64_t end) {
+    funcs::SamplingScratch scratch;
+    scratch.row.resize(in.vocab);
+    float* row = scratch.row.data();
+    for (int64_t b = begin; b < end; ++b) {
+      if (in.stop_flags[b]) {
+        next_tokens[b] = in.eos_token_id[0];
+        stop_flags_out[b] = true;
+        continue;
+      }
+      funcs::ConvertElements(in.logits + b * in.vocab, row, in.vocab);
+      if (in.cur_len[b] >= 0) {
+        if (in.cur_len[b] < in.min_len[b]) {
+          funcs::MaskTokens(in.eos_token_id, in.num_eos, in.vocab, row);
+        }
+        funcs::CountTokens(
+            in.pre_ids + b * in.max_len, in.max_len, in.vocab, &scratch);
+        funcs::TokenPenalty penalty;
+        penalty.repetition = static_cast<float>(in.penalty_scores[b]);
+        penalty.frequency = static_cast<float>(in.frequency_scores[b]);
+        penalty.presence = static_cast<float>(in.presence_scores[b]);
+        funcs::ApplyTokenPenalty(penalty, scratch, row);
+      }
+      const float total = funcs::ExpInPlace(
+          row, in.vocab, static_cast<float>(in.temperatures[b]));
+      const funcs::PhiloxBlock r = philox(b);
+      const int64_t token =
+          funcs::SampleToken(row,
+                             in.vocab,
+                             total,
+                             top_k,
+                             static_cast<float>(in.top_p[b]),
+                             0.0f,
+                             funcs::Uint64ToUnitDouble(r.v[0], r.v[1]),
+                             &scratch);
+      next_tokens[b] = token;
+      stop_flags_out[b] =
+          funcs::IsEndToken(token, in.eos_token_id, in.num_eos);
+    }
+  });
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> FusedTokenSampling(
+    const paddle::Tensor& logits,
+    const paddle::Tensor& pre_ids,
+    const paddle::Tensor& penalty_scores,
+    const paddle::Tensor& frequency_scores,
+    const paddle::Tensor& presence_scores,
+    const paddle::Tensor& temperatures,
+    const paddle::Tensor& top_p,
+    const paddle::Tensor& cur_len,
+    const paddle::Tensor& min_len,
+    const paddle::Tensor& eos_token_id,
+    const paddle::Tensor& stop_flags,
+    int64_t top_k,
+    int64_t seed) {
+  const auto logits_shape = logits.shape();
+  PD_CHECK(logits_shape.size() == 2,
+           "logits of fused_token_sampling must be [bs, vocab_size].");
+  const int64_t bs = logits_shape[0];
+  PD_CHECK(pre_ids.shape().size() == 2 && pre_ids.shape()[0] == bs,
+           "pre_ids of fused_token_sampling must be [bs, max_len].");
+  PD_CHECK(penalty_scores.numel() == bs && frequency_scores.numel() == bs &&
+               presence_scores.numel() == bs && temperatures.numel() == bs &&
+               top_p.numel() == bs && cur_len.numel() == bs &&
+               min_len.numel() == bs && stop_flags.numel() == bs,
+           "fused_token_sampling needs one value per row in every per row "
+           "input.");
+  PD_CHECK(eos_token_id.numel() > 0,
+           "fused_token_sampling has no end token.");
+  auto next_tokens =
+      paddle::empty({bs, 1}, paddle::DataType::INT64, logits.place());
+  auto stop_flags_out =
+      paddle::empty({bs, 1}, paddle::DataType::BOOL, logits.place());
+  if (bs == 0 || logits_shape[1] == 0) {
+    return {next_tokens, stop_flags_out};
+  }
+
+  uint64_t philox_seed, offset;
+  custom_kernel::funcs::GetPhiloxSeedOffset(
+      seed > 0 ? static_cast<uint64_t>(seed) : 0, bs, &philox_seed, &offset);
+  const custom_kernel::funcs::Philox4x32 philox(philox_seed, offset);
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      logits.dtype(), "fused_token_sampling", ([&] {
+        SamplingInputs<data_t> in;
+        in.logits = logits.data<data_t>();
+        in.pre_ids = pre_ids.data<int64_t>();
+        in.penalty_scores = penalty_scores.data<data_t>();
+        in.frequency_scores = frequency_scores.data<data_t>();
+        in.presence_scores = presence_scores.data<data_t>();
+        in.temperatures = temperatures.data<data_t>();
+        in.top_p = top_p.data<data_t>();
+        in.cur_len = cur_len.data<int64_t>();
+        in.min_len = min_len.data<int64_t>();
+        in.eos_token_id = eos_token_id.data<int64_t>();
+        in.stop_flags = stop_flags.data<bool>();
+        in.num_eos = eos_token_id.numel();
+        in.bs = bs;
+        in.max_len = pre_ids.shape()[1];
+        in.vocab = logits_shape[1];
+        FusedTokenSamplingImpl<data_t>(in,
+                                       top_k,
+                                       philox,
+                                       next_tokens.data<int64_t>(),
+                                       stop_flags_out.data<bool>());
+      }));
+  return {next_tokens, stop_flags_out};
+}
+
+std::vector<std::vector<int64_t>> FusedTokenSamplingInferShape(
+    const std::vector<int64_t>& logits_shape,
+    const std::vector<int64_t>& pre_ids_shape,
+    const std::vector<int64_t>& penalty_scores_shape,
+    const std::vector<int64_t>& frequency_scores_shape,
+    const std::vector<int64_t>& presence_scores_shape,
+    const std::vector<int64_t>& temperatures_shape,
+    const std::vector<int64_t>& top_p_shape,
+    const std::vector<int64_t>& cur_len_shape,
+    const std::vector<int64_t>& min_len_shape,
+    const std::vector<int64_t>& eos_token_id_shape,
+    const std::vector<int64_t>& stop_flags_shape,
+    int64_t top_k,
+    int64_t seed) {
+  return {{logits_shape[0], 1}, {logits_shape[0], 1}};
+}
+
+std::vector<paddle::DataType> FusedTokenSamplingInferDtype(
+    const paddle::DataType& logits_dtype,
+    const paddle::DataType& pre_ids_dtype,
+    const paddle::DataType& penalty_scores_dtype,
+    const paddle::DataType& frequency_scores_dtype,
+    const paddle::DataType& presence_scores_dtype,
+    const paddle::DataType& temperatures_dtype,
+    const paddle::DataType& top_p_dtype,
+    const paddle::DataType& cur_len_dtype,
+    const paddle::DataType& min_len_dtype,
+    const paddle::DataType& eos_token_id_dtype,
+    const paddle::DataType& stop_flags_dtype) {
+  return {paddle::DataType::INT64, paddle::DataType::BOOL};
+}
+
+// One generation step per row in a single task: the penalties and minimum
+// length masking of get_token_penalty_multi_scores, temperature softmax,
+// top-k (top_k <= 0 keeps the whole vocabulary) and top-p selection, the
+// draw, and the end token check of set_stop_value_multi_ends. Finished
+// rows emit eos_token_id[0] without touching their logits. Row b draws
+// Philox block b, so a positive seed reproduces the tokens for any thread
+// count.
+PD_BUILD_OP(fused_token_sampling)
+    .Inputs({"logits",
+             "pre_ids",
+             "penalty_scores",
+             "frequency_scores",
+             "presence_scores",
+             "temperatures",
+             "top_p",
+             "cur_len",
+             "min_len",
+             "eos_token_id",
+             "stop_flags"})
+    .Outputs({"next_tokens", "stop_flags_out"})
+    .Attrs({"top_k: int64_t", "seed: int64_t"})
+    .SetKernelFn(PD_KERNEL(FusedTokenSampling))
+    .SetInferShapeFn(PD_INFER_SHAPE(FusedTokenSamplingInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(FusedTokenSamplingInferDtype));
@@ -0,0 +1,154 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/parallel.h"
+#include "paddle/extension.h"
+
+namespace {
+
+// Splits the fused, padding-free qkv [token_num, (num_head + 2 *
+// kv_num_head) * head_size] into padded q [bsz, num_head, max_seq_len,
+// head_size] and k/v [bsz, kv_num_head, max_seq_len, head_size]. Token i
+// sits at position i + padding_offset[i] of the padded [bsz, max_seq_len]
+// batch; padded positions stay zero.
+template <typename T>
+void QKVTransposeSplitImpl(const T* qkv,
+                           const int32_t* padding_offset,
+                           int64_t token_num,
+                           int64_t max_seq_len,
+                           int64_t num_head,
+                           int64_t kv_num_head,
+                           int64_t head_size,
+                           T* q_out,
+                           T* k_out,
+                           T* v_out) {
+  const int64_t row_bytes = head_size * sizeof(T);
+  const int64_t fused_hidden = (num_head + 2 * kv_num_head) * head_size;
+  const int64_t grain = std::max<int64_t>(
+      1, custom_kernel::funcs::kParallelGrainSize / fused_hidden);
+  custom_kernel::funcs::ParallelFor(
+      0, token_num, grain, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t ori = i + padding_offset[i];
+          const int64_t b = ori / max_seq_len;
+          const int64_t s = ori % max_seq_len;
+          const T* src = qkv + i * fused_hidden;
+          for (int64_t h = 0; h < num_head; ++h) {
+            std::memcpy(
+                q_out + ((b * num_head + h) * max_seq_len + s) * head_size,
+                src + h * head_size,
+                row_bytes);
+          }
+          src += num_head * head_size;
+          for (int64_t h = 0; h < kv_num_head; ++h) {
+            const int64_t dst =
+                ((b * kv_num_head + h) * max_seq_len + s) * head_size;
+            std::memcpy(k_out + dst, src + h * head_size, row_bytes);
+            std::memcpy(v_out + dst,
+                        src + (kv_num_head + h) * head_size,
+                        row_bytes);
+          }
+        }
+      });
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> QKVTransposeSplit(
+    const paddle::Tensor& qkv,
+    const paddle::Tensor& padding_offset,
+    const paddle::Tensor& seq_lens,
+    const paddle::Tensor& input_ids,
+    int num_head,
+    int head_size) {
+  const int64_t token_num = qkv.shape()[0];
+  const int64_t fused_hidden_size = qkv.shape()[1];
+  const int64_t bsz = seq_lens.shape()[0];
+  const int64_t max_seq_len = input_ids.shape()[1];
+  const int64_t kv_num_head =
+      (fused_hidden_size - num_head * head_size) / head_size / 2;
+  PD_CHECK((num_head + 2 * kv_num_head) * head_size == fused_hidden_size,
+           "qkv_transpose_split: the hidden size ",
+           fused_hidden_size,
+           " does not split into ",
+           num_head,
+           " query heads and two equal kv parts of head_size ",
+           head_size,
+           ".");
+
+  auto q_out = paddle::full(
+      {bsz, num_head, max_seq_len, head_size}, 0, qkv.dtype(), qkv.place());
+  auto k_out = paddle::full(
+      {bsz, kv_num_head, max_seq_len, head_size}, 0, qkv.dtype(), qkv.place());
+  auto v_out = paddle::full(
+      {bsz, kv_num_head, max_seq_len, head_size}, 0, qkv.dtype(), qkv.place());
+
+  auto offsets = padding_offset.data<int32_t>();
+  for (int64_t i = 0; i < token_num; ++i) {
+    PD_CHECK(i + offsets[i] < bsz * max_seq_len,
+             "qkv_transpose_split: token ",
+             i,
+             " is placed outside the padded batch.");
+  }
+
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      qkv.dtype(), "qkv_transpose_split", ([&] {
+        QKVTransposeSplitImpl<data_t>(qkv.data<data_t>(),
+                                      offsets,
+                                      token_num,
+                                      max_seq_len,
+                                      num_head,
+                                      kv_num_head,
+                                      head_size,
+                                      q_out.data<data_t>(),
+                                      k_out.data<data_t>(),
+                                      v_out.data<data_t>());
+      }));
+  return {q_out, k_out, v_out};
+}
+
+std::vector<std::vector<int64_t>> QKVTransposeSplitInferShape(
+    const std::vector<int64_t>& qkv_shape,
+    const std::vector<int64_t>& padding_offset_shape,
+    const std::vector<int64_t>& seq_lens_shape,
+    const std::vector<int64_t>& input_ids_shape,
+    int num_head,
+    int head_size) {
+  int64_t bsz = seq_lens_shape[0];
+  int64_t fused_hidden_size = qkv_shape[1];
+  int kv_num_head = (fused_hidden_size - num_head * head_size) / head_size / 2;
+  return {{bsz, num_head, -1, head_size},
+          {bsz, kv_num_head, -1, head_size},
+          {bsz, kv_num_head, -1, head_size}};
+}
+
+std::vector<paddle::DataType> QKVTransposeSplitInferDtype(
+    const paddle::DataType& qkv_dtype,
+    const paddle::DataType& padding_offset_dtype,
+    const paddle::DataType& seq_lens_dtype,
+    const paddle::DataType& input_ids_dtype) {
+  return {qkv_dtype, qkv_dtype, qkv_dtype};
+}
+
+PD_BUILD_OP(qkv_transpose_split)
+    .Inputs({"qkv", "padding_offset", "seq_lens", "input_ids"})
+    .Outputs({"q_out", "k_out", "v_out"})
+    .Attrs({"num_head: int", "head_size: int"})
+    .SetKernelFn(PD_KERNEL(QKVTransposeSplit))
+    .SetInferShapeFn(PD_INFER_SHAPE(QKVTransposeSplitInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(QKVTransposeSplitInferDtype));
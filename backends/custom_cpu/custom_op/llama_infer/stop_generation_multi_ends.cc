@@ -0,0 +1,72 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "kernels/funcs/sampling.h"
+#include "paddle/extension.h"
+
+std::vector<paddle::Tensor> GetStopFlagsMulti(const paddle::Tensor& topk_ids,
+                                              const paddle::Tensor& stop_flags,
+                                              const paddle::Tensor& end_ids,
+                                              int64_t mode) {
+  PD_CHECK(mode == 0 || mode == 1,
+           "set_stop_value_multi_ends only supports mode 0 and 1, got ",
+           mode,
+           ".");
+  const int64_t bs = stop_flags.numel();
+  PD_CHECK(topk_ids.numel() == bs,
+           "set_stop_value_multi_ends needs one token per stop flag.");
+  PD_CHECK(end_ids.numel() > 0, "set_stop_value_multi_ends has no end ids.");
+  auto topk_ids_out =
+      paddle::empty(topk_ids.shape(), topk_ids.dtype(), topk_ids.place());
+  auto stop_flags_out = paddle::empty(
+      stop_flags.shape(), paddle::DataType::BOOL, stop_flags.place());
+  const int64_t* ids = topk_ids.data<int64_t>();
+  const bool* flags = stop_flags.data<bool>();
+  const int64_t* ends = end_ids.data<int64_t>();
+  int64_t* ids_out = topk_ids_out.data<int64_t>();
+  bool* flags_out = stop_flags_out.data<bool>();
+  const int64_t num_ends = end_ids.numel();
+  for (int64_t b = 0; b < bs; ++b) {
+    ids_out[b] = flags[b] ? ends[0] : ids[b];
+    flags_out[b] = flags[b] || custom_kernel::funcs::IsEndToken(
+                                   ids_out[b], ends, num_ends);
+  }
+  return {topk_ids_out, stop_flags_out};
+}
+
+std::vector<std::vector<int64_t>> GetStopFlagsMultiInferShape(
+    const std::vector<int64_t>& topk_ids_shape,
+    const std::vector<int64_t>& stop_flags_shape,
+    const std::vector<int64_t>& end_ids_shape) {
+  return {topk_ids_shape, stop_flags_shape};
+}
+
+std::vector<paddle::DataType> GetStopFlagsMultiInferDtype(
+    const paddle::DataType& topk_ids_dtype,
+    const paddle::DataType& stop_flags_dtype,
+    const paddle::DataType& end_ids_dtype) {
+  return {topk_ids_dtype, stop_flags_dtype};
+}
+
+// Finished rows emit end_ids[0]; a row finishes when its token is any of
+// end_ids. Both modes of the other backends behave the same here.
+PD_BUILD_OP(set_stop_value_multi_ends)
+    .Inputs({"topk_ids", "stop_flags", "end_ids"})
+    .Outputs({"topk_ids_out", "stop_flags_out"})
+    .Attrs({"mode: int64_t"})
+    .SetKernelFn(PD_KERNEL(GetStopFlagsMulti))
+    .SetInferShapeFn(PD_INFER_SHAPE(GetStopFlagsMultiInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(GetStopFlagsMultiInferDtype));
@@ -0,0 +1,263 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/funcs/sampling.h"
+#include "paddle/extension.h"
+
+namespace {
+
+// In the order of the reference kernels: while 0 <= cur_len < min_len the
+// end tokens are masked, then the repeated tokens of pre_ids are penalized
+// (rows with cur_len < 0 are finished and skip both), every row is divided
+// by its temperature and the bad tokens are masked last.
+template <typename T>
+void TokenPenaltyImpl(const int64_t* pre_ids,
+                      const T* logits,
+                      const T* penalty_scores,
+                      const T* frequency_scores,
+                      const T* presence_scores,
+                      const float* temperatures,
+                      const int64_t* bad_tokens,
+                      int64_t num_bad_tokens,
+                      const int64_t* cur_len,
+                      const int64_t* min_len,
+                      const int64_t* eos_token_id,
+                      int64_t num_eos,
+                      int64_t bs,
+                      int64_t max_len,
+                      int64_t vocab,
+                      T* logits_out) {
+  namespace funcs = custom_kernel::funcs;
+  funcs::ParallelFor(0, bs, 1, [&](int64_t begin, int64_t end) {
+    funcs::SamplingScratch scratch;
+    scratch.row.resize(vocab);
+    float* row = scratch.row.data();
+    for (int64_t b = begin; b < end; ++b) {
+      funcs::ConvertElements(logits + b * vocab, row, vocab);
+      if (cur_len[b] >= 0) {
+        if (cur_len[b] < min_len[b]) {
+          funcs::MaskTokens(eos_token_id, num_eos, vocab, row);
+        }
+        funcs::CountTokens(pre_ids + b * max_len, max_len, vocab, &scratch);
+        funcs::TokenPenalty penalty;
+        penalty.repetition = static_cast<float>(penalty_scores[b]);
+        penalty.frequency = static_cast<float>(frequency_scores[b]);
+        penalty.presence = static_cast<float>(presence_scores[b]);
+        funcs::ApplyTokenPenalty(penalty, scratch, row);
+      }
+      if (temperatures != nullptr) {
+        const float scale = 1.0f / temperatures[b];
+        PD_CPU_SIMD
+        for (int64_t i = 0; i < vocab; ++i) {
+          row[i] *= scale;
+        }
+      }
+      funcs::MaskTokens(bad_tokens, num_bad_tokens, vocab, row);
+      funcs::ConvertElements(row, logits_out + b * vocab, vocab);
+    }
+  });
+}
+
+paddle::Tensor TokenPenalty(const paddle::Tensor& pre_ids,
+                            const paddle::Tensor& logits,
+                            const paddle::Tensor& penalty_scores,
+                            const paddle::Tensor& frequency_scores,
+                            const paddle::Tensor& presence_scores,
+                            const paddle::Tensor* temperatures,
+                            const paddle::Tensor* bad_tokens,
+                            const paddle::Tensor& cur_len,
+                            const paddle::Tensor& min_len,
+                            const paddle::Tensor& eos_token_id) {
+  const auto logits_shape = logits.shape();
+  PD_CHECK(logits_shape.size() == 2,
+           "logits of get_token_penalty_multi_scores must be [bs, "
+           "vocab_size].");
+  const int64_t bs = logits_shape[0];
+  const int64_t vocab = logits_shape[1];
+  PD_CHECK(pre_ids.shape().size() == 2 && pre_ids.shape()[0] == bs,
+           "pre_ids of get_token_penalty_multi_scores must be [bs, "
+           "max_len].");
+  PD_CHECK(penalty_scores.numel() == bs && frequency_scores.numel() == bs &&
+               presence_scores.numel() == bs && cur_len.numel() == bs &&
+               min_len.numel() == bs,
+           "get_token_penalty_multi_scores needs one penalty, length and "
+           "minimum length per row.");
+  auto logits_out = paddle::empty(logits_shape, logits.dtype(), logits.place());
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      logits.dtype(), "get_token_penalty_multi_scores", ([&] {
+        TokenPenaltyImpl<data_t>(
+            pre_ids.data<int64_t>(),
+            logits.data<data_t>(),
+            penalty_scores.data<data_t>(),
+            frequency_scores.data<data_t>(),
+            presence_scores.data<data_t>(),
+            temperatures ? temperatures->data<float>() : nullptr,
+            bad_tokens ? bad_tokens->data<int64_t>() : nullptr,
+            bad_tokens ? bad_tokens->numel() : 0,
+            cur_len.data<int64_t>(),
+            min_len.data<int64_t>(),
+            eos_token_id.data<int64_t>(),
+            eos_token_id.numel(),
+            bs,
+            pre_ids.shape()[1],
+            vocab,
+            logits_out.data<data_t>());
+      }));
+  return logits_out;
+}
+
+}  // namespace
+
+std::vector<paddle::Tensor> TokenPenaltyMultiScores(
+    const paddle::Tensor& pre_ids,
+    const paddle::Tensor& logits,
+    const paddle::Tensor& penalty_scores,
+    const paddle::Tensor& frequency_scores,
+    const paddle::Tensor& presence_scores,
+    const paddle::Tensor& cur_len,
+    const paddle::Tensor& min_len,
+    const paddle::Tensor& eos_token_id) {
+  return {TokenPenalty(pre_ids,
+                       logits,
+                       penalty_scores,
+                       frequency_scores,
+                       presence_scores,
+                       nullptr,
+                       nullptr,
+                       cur_len,
+                       min_len,
+                       eos_token_id)};
+}
+
+std::vector<paddle::Tensor> TokenPenaltyMultiScoresV2(
+    const paddle::Tensor& pre_ids,
+    const paddle::Tensor& logits,
+    const paddle::Tensor& penalty_scores,
+    const paddle::Tensor& frequency_scores,
+    const paddle::Tensor& presence_scores,
+    const paddle::Tensor& temperatures,
+    const paddle::Tensor& bad_tokens,
+    const paddle::Tensor& cur_len,
+    const paddle::Tensor& min_len,
+    const paddle::Tensor& eos_token_id) {
+  PD_CHECK(temperatures.numel() == logits.shape()[0],
+           "get_token_penalty_multi_scores_v2 needs one temperature per "
+           "row.");
+  PD_CHECK(temperatures.dtype() == paddle::DataType::FLOAT32,
+           "temperatures of get_token_penalty_multi_scores_v2 must be "
+           "float32.");
+  return {TokenPenalty(pre_ids,
+                       logits,
+                       penalty_scores,
+                       frequency_scores,
+                       presence_scores,
+                       &temperatures,
+                       &bad_tokens,
+                       cur_len,
+                       min_len,
+                       eos_token_id)};
+}
+
+std::vector<std::vector<int64_t>> TokenPenaltyMultiScoresInferShape(
+    const std::vector<int64_t>& pre_ids_shape,
+    const std::vector<int64_t>& logits_shape,
+    const std::vector<int64_t>& penalty_scores_shape,
+    const std::vector<int64_t>& frequency_scores_shape,
+    const std::vector<int64_t>& presence_scores_shape,
+    const std::vector<int64_t>& cur_len_shape,
+    const std::vector<int64_t>& min_len_shape,
+    const std::vector<int64_t>& eos_token_id_shape) {
+  return {logits_shape};
+}
+
+std::vector<paddle::DataType> TokenPenaltyMultiScoresInferDtype(
+    const paddle::DataType& pre_ids_dtype,
+    const paddle::DataType& logits_dtype,
+    const paddle::DataType& penalty_scores_dtype,
+    const paddle::DataType& frequency_scores_dtype,
+    const paddle::DataType& presence_scores_dtype,
+    const paddle::DataType& cur_len_dtype,
+    const paddle::DataType& min_len_dtype,
+    const paddle::DataType& eos_token_id_dtype) {
+  return {logits_dtype};
+}
+
+std::vector<std::vector<int64_t>> TokenPenaltyMultiScoresV2InferShape(
+    const std::vector<int64_t>& pre_ids_shape,
+    const std::vector<int64_t>& logits_shape,
+    const std::vector<int64_t>& penalty_scores_shape,
+    const std::vector<int64_t>& frequency_scores_shape,
+    const std::vector<int64_t>& presence_scores_shape,
+    const std::vector<int64_t>& temperatures_shape,
+    const std::vector<int64_t>& bad_tokens_shape,
+    const std::vector<int64_t>& cur_len_shape,
+    const std::vector<int64_t>& min_len_shape,
+    const std::vector<int64_t>& eos_token_id_shape) {
+  return {logits_shape};
+}
+
+std::vector<paddle::DataType> TokenPenaltyMultiScoresV2InferDtype(
+    const paddle::DataType& pre_ids_dtype,
+    const paddle::DataType& logits_dtype,
+    const paddle::DataType& penalty_scores_dtype,
+    const paddle::DataType& frequency_scores_dtype,
+    const paddle::DataType& presence_scores_dtype,
+    const paddle::DataType& temperatures_dtype,
+    const paddle::DataType& bad_tokens_dtype,
+    const paddle::DataType& cur_len_dtype,
+    const paddle::DataType& min_len_dtype,
+    const paddle::DataType& eos_token_id_dtype) {
+  return {logits_dtype};
+}
+
+// Repetition / frequency / presence penalties and minimum length masking
+// of the generation loop, one parallel pass per vocabulary row. The
+// penalties are applied sparsely from the sorted pre_ids, no vocab sized
+// repeat count tensor is built or zeroed per step.
+PD_BUILD_OP(get_token_penalty_multi_scores)
+    .Inputs({"pre_ids",
+             "logits",
+             "penalty_scores",
+             "frequency_scores",
+             "presence_scores",
+             "cur_len",
+             "min_len",
+             "eos_token_id"})
+    .Outputs({"logits_out"})
+    .SetKernelFn(PD_KERNEL(TokenPenaltyMultiScores))
+    .SetInferShapeFn(PD_INFER_SHAPE(TokenPenaltyMultiScoresInferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(TokenPenaltyMultiScoresInferDtype));
+
+// As get_token_penalty_multi_scores, plus bad_tokens masking and division
+// by the per row temperature in the same pass.
+PD_BUILD_OP(get_token_penalty_multi_scores_v2)
+    .Inputs({"pre_ids",
+             "logits",
+             "penalty_scores",
+             "frequency_scores",
+             "presence_scores",
+             "temperatures",
+             "bad_tokens",
+             "cur_len",
+             "min_len",
+             "eos_token_id"})
+    .Outputs({"logits_out"})
+    .SetKernelFn(PD_KERNEL(TokenPenaltyMultiScoresV2))
+    .SetInferShapeFn(PD_INFER_SHAPE(TokenPenaltyMultiScoresV2InferShape))
+    .SetInferDtypeFn(PD_INFER_DTYPE(TokenPenaltyMultiScoresV2InferDtype));
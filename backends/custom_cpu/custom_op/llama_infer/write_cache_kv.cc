@@ -0,0 +1,157 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <vector>
+
+#include "custom_op/custom_op_utils.h"
+#include "kernels/funcs/parallel.h"
+#include "paddle/extension.h"
+
+namespace {
+
+// Copies the first sequence_lengths[b] tokens of input_k/input_v
+// [bsz, num_head, seq_len, head_dim] into the cache.
+//
+// The cache is paged: cache_kv is [2, num_blocks, num_head, block_size,
+// head_dim] and token t of batch b lives in block block_tables[b, t /
+// block_size] at row t % block_size. Without block tables the cache is the
+// contiguous [2, bsz, num_head, max_seq_len, head_dim] layout, which is the
+// same thing with one block of max_seq_len rows per batch.
+template <typename T>
+void WriteCacheKVImpl(const T* input_k,
+                      const T* input_v,
+                      const int32_t* seq_lens,
+                      const int32_t* block_tables,
+                      int64_t max_blocks_per_seq,
+                      int64_t bsz,
+                      int64_t num_head,
+                      int64_t seq_len,
+                      int64_t head_dim,
+                      int64_t num_blocks,
+                      int64_t block_size,
+                      T* cache_kv) {
+  const int64_t row_bytes = head_dim * sizeof(T);
+  const int64_t block_numel = num_head * block_size * head_dim;
+  T* cache_k = cache_kv;
+  T* cache_v = cache_kv + num_blocks * block_numel;
+  const int64_t row_numel = std::max<int64_t>(num_head * head_dim, 1);
+  const int64_t grain = std::max<int64_t>(
+      1, custom_kernel::funcs::kParallelGrainSize / row_numel);
+  custom_kernel::funcs::ParallelFor(
+      0, bsz * seq_len, grain, [&](int64_t begin, int64_t end) {
+        for (int64_t idx = begin; idx < end; ++idx) {
+          const int64_t b = idx / seq_len;
+          const int64_t t = idx % seq_len;
+          if (t >= seq_lens[b]) {
+            continue;
+          }
+          const int64_t block =
+              block_tables ? block_tables[b * max_blocks_per_seq +
+                                          t / block_size]
+                           : b;
+          const int64_t row = t % block_size;
+          for (int64_t h = 0; h < num_head; ++h) {
+            const int64_t src = ((b * num_head + h) * seq_len + t) * head_dim;
+            const int64_t dst = block * block_numel +
+                                (h * block_size + row) * head_dim;
+            std::memcpy(cache_k + dst, input_k + src, row_bytes);
+            std::memcpy(cache_v + dst, input_v + src, row_bytes);
+          }
+        }
+      });
+}
+
+}  // namespace
+
+void WriteCacheKV(const paddle::Tensor& input_k,
+                  const paddle::Tensor& input_v,
+                  const paddle::Tensor& cache_kv,
+                  const paddle::Tensor& sequence_lengths,
+                  const paddle::optional<paddle::Tensor>& block_tables) {
+  auto k_shape = input_k.shape();
+  auto cache_shape = cache_kv.shape();
+  PD_CHECK(k_shape.size() == 4 && input_v.shape() == k_shape,
+           "input_k and input_v of write_cache_kv must both be [bsz, "
+           "num_head, seq_len, head_dim].");
+  PD_CHECK(cache_shape.size() == 5 && cache_shape[0] == 2,
+           "cache_kv of write_cache_kv must be 5-D with a leading 2.");
+  const int64_t bsz = k_shape[0];
+  const int64_t num_head = k_shape[1];
+  const int64_t seq_len = k_shape[2];
+  const int64_t head_dim = k_shape[3];
+  const int64_t num_blocks = cache_shape[1];
+  const int64_t block_size = cache_shape[3];
+  PD_CHECK(cache_shape[2] == num_head && cache_shape[4] == head_dim,
+           "The heads of cache_kv and input_k of write_cache_kv differ.");
+
+  auto seq_lens = sequence_lengths.data<int32_t>();
+  const int32_t* tables = nullptr;
+  int64_t max_blocks_per_seq = 0;
+  if (block_tables) {
+    tables = block_tables->data<int32_t>();
+    max_blocks_per_seq = block_tables->shape()[1];
+    for (int64_t b = 0; b < bsz; ++b) {
+      PD_CHECK(seq_lens[b] <= max_blocks_per_seq * block_size,
+               "write_cache_kv: sequence ",
+               b,
+               " does not fit in its block table.");
+      for (int64_t i = 0; i * block_size < seq_lens[b]; ++i) {
+        const int32_t block = tables[b * max_blocks_per_seq + i];
+        PD_CHECK(block >= 0 && block < num_blocks,
+                 "write_cache_kv: block id ",
+                 block,
+                 " is out of range [0, ",
+                 num_blocks,
+                 ").");
+      }
+    }
+  } else {
+    PD_CHECK(num_blocks == bsz,
+             "Without block tables cache_kv of write_cache_kv must be [2, "
+             "bsz, num_head, max_seq_len, head_dim].");
+    for (int64_t b = 0; b < bsz; ++b) {
+      PD_CHECK(seq_lens[b] <= block_size,
+               "write_cache_kv: sequence ",
+               b,
+               " is longer than the cache.");
+    }
+  }
+
+  PD_CUSTOM_CPU_DISPATCH_FLOAT_TYPES(
+      input_k.dtype(), "write_cache_kv", ([&] {
+        WriteCacheKVImpl<data_t>(input_k.data<data_t>(),
+                                 input_v.data<data_t>(),
+                                 seq_lens,
+                                 tables,
+                                 max_blocks_per_seq,
+                                 bsz,
+                                 num_head,
+                                 seq_len,
+                                 head_dim,
+                                 num_blocks,
+                                 block_size,
+                                 const_cast<data_t*>(cache_kv.data<data_t>()));
+      }));
+}
+
+PD_BUILD_OP(write_cache_kv)
+    .Inputs({"input_k",
+             "input_v",
+             "cache_kv",
+             "sequence_lengths",
+             paddle::Optional("block_tables")})
+    .Outputs({"cache_kv_out"})
+    .SetInplaceMap({{"cache_kv", "cache_kv_out"}})
+    .SetKernelFn(PD_KERNEL(WriteCacheKV));
@@ -0,0 +1,445 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstring>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Elements handed to one task of the multi tensor loop.
+constexpr int64_t kAdamChunkSize = 16384;
+
+// Everything one parameter tensor needs for an Adam(W) step. The learning
+// rate and epsilon already carry the bias correction terms, so the element
+// loop only streams through memory.
+template <typename T, typename MT>
+struct AdamTensorArgs {
+  const T* param;
+  const T* grad;
+  const MT* moment1;
+  const MT* moment2;
+  const MT* master_param;
+  T* param_out;
+  MT* moment1_out;
+  MT* moment2_out;
+  MT* master_param_out;
+  MT beta1;
+  MT beta2;
+  MT lr;
+  MT epsilon;
+  MT decay;
+};
+
+template <typename T, typename MT, bool kHasMaster>
+void AdamUpdate(const AdamTensorArgs<T, MT>& args,
+                int64_t begin,
+                int64_t end) {
+  const MT beta1 = args.beta1;
+  const MT beta2 = args.beta2;
+  const MT one_minus_beta1 = static_cast<MT>(1) - beta1;
+  const MT one_minus_beta2 = static_cast<MT>(1) - beta2;
+  const MT lr = args.lr;
+  const MT epsilon = args.epsilon;
+  const MT decay = args.decay;
+  PD_CPU_SIMD
+  for (int64_t i = begin; i < end; ++i) {
+    MT p = kHasMaster ? args.master_param[i] : static_cast<MT>(args.param[i]);
+    const MT g = static_cast<MT>(args.grad[i]);
+    const MT mom1 = beta1 * args.moment1[i] + one_minus_beta1 * g;
+    const MT mom2 = beta2 * args.moment2[i] + one_minus_beta2 * g * g;
+    p -= decay * p;
+    p -= lr * (mom1 / (std::sqrt(mom2) + epsilon));
+    args.moment1_out[i] = mom1;
+    args.moment2_out[i] = mom2;
+    args.param_out[i] = static_cast<T>(p);
+    if (kHasMaster) {
+      args.master_param_out[i] = p;
+    }
+  }
+}
+
+// Updates every tensor of the group in a single parallel sweep.
+template <typename T, typename MT>
+void MultiTensorAdam(const std::vector<AdamTensorArgs<T, MT>>& group,
+                     const std::vector<int64_t>& numels) {
+  funcs::MultiTensorParallelFor(
+      numels, kAdamChunkSize, [&](size_t t, int64_t begin, int64_t end) {
+        if (group[t].master_param != nullptr) {
+          AdamUpdate<T, MT, true>(group[t], begin, end);
+        } else {
+          AdamUpdate<T, MT, false>(group[t], begin, end);
+        }
+      });
+}
+
+template <typename T>
+void CopyIfNotSame(const phi::Context& dev_ctx,
+                   const phi::DenseTensor& src,
+                   phi::DenseTensor* dst) {
+  dst->Resize(src.dims());
+  auto dst_data = dev_ctx.template Alloc<T>(dst);
+  if (src.data<T>() != dst_data) {
+    std::memcpy(dst_data, src.data<T>(), src.numel() * sizeof(T));
+  }
+}
+
+// Allocates the outputs of one tensor and folds the bias correction of this
+// step into the learning rate and epsilon:
+//   lr_t  = lr * sqrt(1 - beta2_pow) / (1 - beta1_pow)
+//   eps_t = epsilon * sqrt(1 - beta2_pow)
+template <typename T, typename MT>
+AdamTensorArgs<T, MT> PrepareAdamTensor(const phi::Context& dev_ctx,
+                                        const phi::DenseTensor& param,
+                                        const phi::DenseTensor& grad,
+                                        const phi::DenseTensor& learning_rate,
+                                        const phi::DenseTensor& moment1,
+                                        const phi::DenseTensor& moment2,
+                                        const phi::DenseTensor& beta1_pow,
+                                        const phi::DenseTensor& beta2_pow,
+                                        const phi::DenseTensor* master_param,
+                                        MT beta1,
+                                        MT beta2,
+                                        MT epsilon,
+                                        MT lr_ratio,
+                                        MT coeff,
+                                        bool with_decay,
+                                        phi::DenseTensor* param_out,
+                                        phi::DenseTensor* moment1_out,
+                                        phi::DenseTensor* moment2_out,
+                                        phi::DenseTensor* master_param_out) {
+  PD_CHECK(param.numel() == grad.numel(),
+           "The numel of Param(%ld) and Grad(%ld) must be equal.",
+           param.numel(),
+           grad.numel());
+  PD_CHECK(param.numel() == moment1.numel() &&
+               param.numel() == moment2.numel(),
+           "The numel of Param(%ld), Moment1(%ld) and Moment2(%ld) must be "
+           "equal.",
+           param.numel(),
+           moment1.numel(),
+           moment2.numel());
+
+  AdamTensorArgs<T, MT> args;
+  args.param = param.data<T>();
+  args.grad = grad.data<T>();
+  args.moment1 = moment1.data<MT>();
+  args.moment2 = moment2.data<MT>();
+  args.param_out = dev_ctx.template Alloc<T>(param_out);
+  args.moment1_out = dev_ctx.template Alloc<MT>(moment1_out);
+  args.moment2_out = dev_ctx.template Alloc<MT>(moment2_out);
+  args.master_param = nullptr;
+  args.master_param_out = nullptr;
+  if (master_param != nullptr) {
+    args.master_param = master_param->data<MT>();
+    args.master_param_out = dev_ctx.template Alloc<MT>(master_param_out);
+  }
+
+  const MT lr = learning_rate.data<MT>()[0] * lr_ratio;
+  const MT beta1_pow_data = beta1_pow.data<MT>()[0];
+  const MT beta2_pow_data = beta2_pow.data<MT>()[0];
+  const MT one = static_cast<MT>(1);
+  args.beta1 = beta1;
+  args.beta2 = beta2;
+  args.lr = lr * std::sqrt(one - beta2_pow_data) / (one - beta1_pow_data);
+  args.epsilon = epsilon * std::sqrt(one - beta2_pow_data);
+  args.decay = with_decay ? lr * coeff : static_cast<MT>(0);
+  return args;
+}
+
+template <typename MT>
+void UpdateBetaPow(const phi::Context& dev_ctx,
+                   const phi::DenseTensor& beta1_pow,
+                   const phi::DenseTensor& beta2_pow,
+                   MT beta1,
+                   MT beta2,
+                   phi::DenseTensor* beta1_pow_out,
+                   phi::DenseTensor* beta2_pow_out) {
+  const MT beta1_pow_data = beta1_pow.data<MT>()[0];
+  const MT beta2_pow_data = beta2_pow.data<MT>()[0];
+  beta1_pow_out->Resize({1});
+  beta2_pow_out->Resize({1});
+  dev_ctx.template Alloc<MT>(beta1_pow_out)[0] = beta1_pow_data * beta1;
+  dev_ctx.template Alloc<MT>(beta2_pow_out)[0] = beta2_pow_data * beta2;
+}
+
+template <typename T>
+void AdamwKernel(const phi::Context& dev_ctx,
+                 const phi::DenseTensor& param,
+                 const phi::DenseTensor& grad,
+                 const phi::DenseTensor& learning_rate,
+                 const phi::DenseTensor& moment1,
+                 const phi::DenseTensor& moment2,
+                 const phi::DenseTensor& beta1_pow,
+                 const phi::DenseTensor& beta2_pow,
+                 const paddle::optional<phi::DenseTensor>& master_param,
+                 const paddle::optional<phi::DenseTensor>& skip_update,
+                 const phi::Scalar& beta1,
+                 const phi::Scalar& beta2,
+                 const phi::Scalar& epsilon,
+                 float lr_ratio,
+                 float coeff,
+                 bool with_decay,
+                 bool lazy_mode,
+                 int64_t min_row_size_to_use_multithread,
+                 bool multi_precision,
+                 bool use_global_beta_pow,
+                 phi::DenseTensor* param_out,
+                 phi::DenseTensor* moment1_out,
+                 phi::DenseTensor* moment2_out,
+                 phi::DenseTensor* beta1_pow_out,
+                 phi::DenseTensor* beta2_pow_out,
+                 phi::DenseTensor* master_param_out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+
+  const bool use_master = multi_precision && master_param_out != nullptr;
+  if (use_master) {
+    PD_CHECK(master_param.get_ptr() != nullptr,
+             "Input(MasterParam) must be provided when multi_precision is "
+             "true.");
+  }
+
+  bool skip_update_ = false;
+  if (skip_update.get_ptr() != nullptr) {
+    PD_CHECK(skip_update->numel() == 1,
+             "Input(SkipUpdate) size must be 1, but get %ld",
+             skip_update->numel());
+    skip_update_ = skip_update->data<bool>()[0];
+  }
+  if (skip_update_) {
+    CopyIfNotSame<T>(dev_ctx, param, param_out);
+    CopyIfNotSame<MT>(dev_ctx, moment1, moment1_out);
+    CopyIfNotSame<MT>(dev_ctx, moment2, moment2_out);
+    if (use_master) {
+      CopyIfNotSame<MT>(dev_ctx, master_param.get(), master_param_out);
+    }
+    if (!use_global_beta_pow) {
+      CopyIfNotSame<MT>(dev_ctx, beta1_pow, beta1_pow_out);
+      CopyIfNotSame<MT>(dev_ctx, beta2_pow, beta2_pow_out);
+    }
+    return;
+  }
+
+  const MT beta1_ = beta1.to<MT>();
+  const MT beta2_ = beta2.to<MT>();
+  std::vector<AdamTensorArgs<T, MT>> group{
+      PrepareAdamTensor<T, MT>(dev_ctx,
+                               param,
+                               grad,
+                               learning_rate,
+                               moment1,
+                               moment2,
+                               beta1_pow,
+                               beta2_pow,
+                               use_master ? master_param.get_ptr() : nullptr,
+                               beta1_,
+                               beta2_,
+                               epsilon.to<MT>(),
+                               static_cast<MT>(lr_ratio),
+                               static_cast<MT>(coeff),
+                               with_decay,
+                               param_out,
+                               moment1_out,
+                               moment2_out,
+                               master_param_out)};
+  MultiTensorAdam<T, MT>(group, {param.numel()});
+
+  if (!use_global_beta_pow) {
+    UpdateBetaPow<MT>(dev_ctx,
+                      beta1_pow,
+                      beta2_pow,
+                      beta1_,
+                      beta2_,
+                      beta1_pow_out,
+                      beta2_pow_out);
+  }
+}
+
+template <typename T>
+void AdamKernel(const phi::Context& dev_ctx,
+                const phi::DenseTensor& param,
+                const phi::DenseTensor& grad,
+                const phi::DenseTensor& learning_rate,
+                const phi::DenseTensor& moment1,
+                const phi::DenseTensor& moment2,
+                const phi::DenseTensor& beta1_pow,
+                const phi::DenseTensor& beta2_pow,
+                const paddle::optional<phi::DenseTensor>& master_param,
+                const paddle::optional<phi::DenseTensor>& skip_update,
+                const phi::Scalar& beta1,
+                const phi::Scalar& beta2,
+                const phi::Scalar& epsilon,
+                bool lazy_mode,
+                int64_t min_row_size_to_use_multithread,
+                bool multi_precision,
+                bool use_global_beta_pow,
+                phi::DenseTensor* param_out,
+                phi::DenseTensor* moment1_out,
+                phi::DenseTensor* moment2_out,
+                phi::DenseTensor* beta1_pow_out,
+                phi::DenseTensor* beta2_pow_out,
+                phi::DenseTensor* master_param_out) {
+  AdamwKernel<T>(dev_ctx,
+                 param,
+                 grad,
+                 learning_rate,
+                 moment1,
+                 moment2,
+                 beta1_pow,
+                 beta2_pow,
+                 master_param,
+                 skip_update,
+                 beta1,
+                 beta2,
+                 epsilon,
+                 1.0f,
+                 0.0f,
+                 false,
+                 lazy_mode,
+                 min_row_size_to_use_multithread,
+                 multi_precision,
+                 use_global_beta_pow,
+                 param_out,
+                 moment1_out,
+                 moment2_out,
+                 beta1_pow_out,
+                 beta2_pow_out,
+                 master_param_out);
+}
+
+template <typename T>
+void MergedAdamKernel(
+    const phi::Context& dev_ctx,
+    const std::vector<const phi::DenseTensor*>& param,
+    const std::vector<const phi::DenseTensor*>& grad,
+    const std::vector<const phi::DenseTensor*>& learning_rate,
+    const std::vector<const phi::DenseTensor*>& moment1,
+    const std::vector<const phi::DenseTensor*>& moment2,
+    const std::vector<const phi::DenseTensor*>& beta1_pow,
+    const std::vector<const phi::DenseTensor*>& beta2_pow,
+    const paddle::optional<std::vector<const phi::DenseTensor*>>& master_param,
+    const phi::Scalar& beta1,
+    const phi::Scalar& beta2,
+    const phi::Scalar& epsilon,
+    bool multi_precision,
+    bool use_global_beta_pow,
+    std::vector<phi::DenseTensor*> param_out,
+    std::vector<phi::DenseTensor*> moment1_out,
+    std::vector<phi::DenseTensor*> moment2_out,
+    std::vector<phi::DenseTensor*> beta1_pow_out,
+    std::vector<phi::DenseTensor*> beta2_pow_out,
+    std::vector<phi::DenseTensor*> master_param_out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+
+  const size_t n = param.size();
+  PD_CHECK(n == grad.size() && n == moment1.size() && n == moment2.size() &&
+               n == beta1_pow.size() && n == beta2_pow.size(),
+           "The size of Input(Grad), Input(Moment1), Input(Moment2), "
+           "Input(Beta1Pow) and Input(Beta2Pow) must be equal to "
+           "Input(Param) (%d).",
+           static_cast<int>(n));
+  PD_CHECK(n == param_out.size() && n == moment1_out.size() &&
+               n == moment2_out.size(),
+           "The size of Output(ParamOut), Output(Moment1Out) and "
+           "Output(Moment2Out) must be equal to Input(Param) (%d).",
+           static_cast<int>(n));
+  PD_CHECK(learning_rate.size() == 1 || learning_rate.size() == n,
+           "The size of Input(LearningRate) must be 1 or equal to "
+           "Input(Param) (%d), but received %d.",
+           static_cast<int>(n),
+           static_cast<int>(learning_rate.size()));
+  if (multi_precision) {
+    PD_CHECK(master_param.get_ptr() != nullptr &&
+                 master_param->size() == n && master_param_out.size() == n,
+             "Input(MasterParam) and Output(MasterParamOut) must hold %d "
+             "tensors when multi_precision is true.",
+             static_cast<int>(n));
+  }
+
+  const MT beta1_ = beta1.to<MT>();
+  const MT beta2_ = beta2.to<MT>();
+  const MT epsilon_ = epsilon.to<MT>();
+  std::vector<AdamTensorArgs<T, MT>> group;
+  std::vector<int64_t> numels;
+  group.reserve(n);
+  numels.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    group.push_back(PrepareAdamTensor<T, MT>(
+        dev_ctx,
+        *param[i],
+        *grad[i],
+        *learning_rate[learning_rate.size() == 1 ? 0 : i],
+        *moment1[i],
+        *moment2[i],
+        *beta1_pow[i],
+        *beta2_pow[i],
+        multi_precision ? master_param.get()[i] : nullptr,
+        beta1_,
+        beta2_,
+        epsilon_,
+        static_cast<MT>(1),
+        static_cast<MT>(0),
+        false,
+        param_out[i],
+        moment1_out[i],
+        moment2_out[i],
+        multi_precision ? master_param_out[i] : nullptr));
+    numels.push_back(param[i]->numel());
+  }
+  MultiTensorAdam<T, MT>(group, numels);
+
+  if (!use_global_beta_pow) {
+    for (size_t i = 0; i < n; ++i) {
+      UpdateBetaPow<MT>(dev_ctx,
+                        *beta1_pow[i],
+                        *beta2_pow[i],
+                        beta1_,
+                        beta2_,
+                        beta1_pow_out[i],
+                        beta2_pow_out[i]);
+    }
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(adam,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::AdamKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(adamw,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::AdamwKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(merged_adam,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::MergedAdamKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -14,6 +14,7 @@
 
 #include <cmath>
 
+#include "kernels/funcs/parallel.h"
 #include "paddle/phi/capi/all.h"
 #include "phi_funcs.h"  //NOLINT
 
@@ -31,11 +32,16 @@ void AssignValueKernel(const phi::Context& dev_ctx,
            "argument dtype is %s, kernel dtype is %s.",
            dtype,
            template_dtype);
-  auto out_data = dev_ctx.template Alloc<T>(out);
-  for (auto i = 0; i < values.size(); ++i) {
-    out_data[i] = values[i].to<T>();
-  }
   out->Resize(std::vector<int64_t>(shape.cbegin(), shape.cend()));
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  funcs::ParallelFor(0,
+                     static_cast<int64_t>(values.size()),
+                     funcs::kParallelGrainSize,
+                     [&](int64_t begin, int64_t end) {
+                       for (int64_t i = begin; i < end; ++i) {
+                         out_data[i] = values[i].to<T>();
+                       }
+                     });
 }
 
 template <typename T>
@@ -44,7 +50,7 @@ void AssignKernel(const phi::Context& dev_ctx,
                   phi::DenseTensor* out) {
   auto out_data = dev_ctx.template Alloc<T>(out);
   auto x_data = x.data<T>();
-  std::memcpy(out_data, x_data, sizeof(T) * x.numel());
+  funcs::ParallelMemcpy(out_data, x_data, sizeof(T) * x.numel());
 }
 
 }  // namespace custom_kernel
@@ -0,0 +1,271 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "kernels/funcs/batch_norm.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// The statistics, scale and bias of a float16 / bfloat16 batch_norm are
+// float32, as on the other devices.
+template <typename MT>
+std::vector<MT> BatchNormParam(const paddle::optional<phi::DenseTensor> &t,
+                               int64_t channels,
+                               MT value) {
+  if (!t) {
+    return std::vector<MT>(channels, value);
+  }
+  PD_CHECK(t->numel() == channels,
+           "The scale and bias of batch_norm must have %d elements.",
+           static_cast<int>(channels));
+  const MT *data = t->data<MT>();
+  return std::vector<MT>(data, data + channels);
+}
+
+template <typename MT>
+std::vector<MT> InvStd(const MT *variance, int64_t channels, float epsilon) {
+  std::vector<MT> inv_std(channels);
+  for (int64_t c = 0; c < channels; ++c) {
+    inv_std[c] = MT(1) / std::sqrt(variance[c] + static_cast<MT>(epsilon));
+  }
+  return inv_std;
+}
+
+template <typename T>
+void BatchNormKernel(const phi::Context &dev_ctx,
+                     const phi::DenseTensor &x,
+                     const phi::DenseTensor &mean,
+                     const phi::DenseTensor &variance,
+                     const paddle::optional<phi::DenseTensor> &scale,
+                     const paddle::optional<phi::DenseTensor> &bias,
+                     bool is_test,
+                     float momentum,
+                     float epsilon,
+                     const std::string &data_layout,
+                     bool use_global_stats,
+                     bool trainable_statistics,
+                     phi::DenseTensor *y,
+                     phi::DenseTensor *mean_out,
+                     phi::DenseTensor *variance_out,
+                     phi::DenseTensor *saved_mean,
+                     phi::DenseTensor *saved_variance,
+                     phi::DenseTensor *reserve_space) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto shape = funcs::GetChannelShape(x.dims(), data_layout);
+  const int64_t C = shape.c;
+  const bool global_stats = (is_test && !trainable_statistics) ||
+                            use_global_stats;
+  const auto scale_v = BatchNormParam<MT>(scale, C, MT(1));
+  const auto bias_v = BatchNormParam<MT>(bias, C, MT(0));
+  const MT *running_mean = mean.data<MT>();
+  const MT *running_var = variance.data<MT>();
+
+  T *y_data = dev_ctx.template Alloc<T>(y);
+  // mean_out / variance_out may share memory with mean / variance
+  MT *mean_out_data = dev_ctx.template Alloc<MT>(mean_out);
+  MT *variance_out_data = dev_ctx.template Alloc<MT>(variance_out);
+  MT *saved_mean_data = dev_ctx.template Alloc<MT>(saved_mean);
+  MT *saved_variance_data = dev_ctx.template Alloc<MT>(saved_variance);
+
+  std::vector<MT> batch_mean(C);
+  std::vector<MT> batch_var(C);
+  if (global_stats) {
+    for (int64_t c = 0; c < C; ++c) {
+      batch_mean[c] = running_mean[c];
+      batch_var[c] = running_var[c];
+      mean_out_data[c] = running_mean[c];
+      variance_out_data[c] = running_var[c];
+    }
+  } else {
+    std::vector<funcs::WelfordState<MT>> stats;
+    funcs::ChannelWelford<T, MT>(x.data<T>(), shape, &stats);
+    const MT m = static_cast<MT>(momentum);
+    for (int64_t c = 0; c < C; ++c) {
+      batch_mean[c] = stats[c].mean;
+      batch_var[c] = stats[c].Variance();
+      mean_out_data[c] = running_mean[c] * m + batch_mean[c] * (1 - m);
+      variance_out_data[c] = running_var[c] * m + batch_var[c] * (1 - m);
+    }
+  }
+  const auto inv_std = InvStd(batch_var.data(), C, epsilon);
+  for (int64_t c = 0; c < C; ++c) {
+    saved_mean_data[c] = batch_mean[c];
+    saved_variance_data[c] = inv_std[c];
+  }
+  if (x.numel() == 0) {
+    return;
+  }
+  funcs::BatchNormApply<T, MT>(x.data<T>(),
+                               shape,
+                               batch_mean.data(),
+                               inv_std.data(),
+                               scale_v.data(),
+                               bias_v.data(),
+                               y_data);
+}
+
+// Inference batch_norm: the statistics, scale and bias fold into one
+// multiply-add per element.
+template <typename T>
+void BatchNormInferKernel(const phi::Context &dev_ctx,
+                          const phi::DenseTensor &x,
+                          const phi::DenseTensor &mean,
+                          const phi::DenseTensor &variance,
+                          const phi::DenseTensor &scale,
+                          const phi::DenseTensor &bias,
+                          float momentum,
+                          float epsilon,
+                          const std::string &data_layout,
+                          phi::DenseTensor *y,
+                          phi::DenseTensor *mean_out,
+                          phi::DenseTensor *variance_out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto shape = funcs::GetChannelShape(x.dims(), data_layout);
+  const int64_t C = shape.c;
+  const MT *running_mean = mean.data<MT>();
+  const MT *running_var = variance.data<MT>();
+  T *y_data = dev_ctx.template Alloc<T>(y);
+  MT *mean_out_data = dev_ctx.template Alloc<MT>(mean_out);
+  MT *variance_out_data = dev_ctx.template Alloc<MT>(variance_out);
+  for (int64_t c = 0; c < C; ++c) {
+    mean_out_data[c] = running_mean[c];
+    variance_out_data[c] = running_var[c];
+  }
+  if (x.numel() == 0) {
+    return;
+  }
+  const auto inv_std = InvStd(running_var, C, epsilon);
+  funcs::BatchNormApply<T, MT>(x.data<T>(),
+                               shape,
+                               running_mean,
+                               inv_std.data(),
+                               scale.data<MT>(),
+                               bias.data<MT>(),
+                               y_data);
+}
+
+template <typename T>
+void BatchNormGradKernel(
+    const phi::Context &dev_ctx,
+    const phi::DenseTensor &x,
+    const paddle::optional<phi::DenseTensor> &scale,
+    const paddle::optional<phi::DenseTensor> &bias,
+    const paddle::optional<phi::DenseTensor> &mean,
+    const paddle::optional<phi::DenseTensor> &variance,
+    const phi::DenseTensor &saved_mean,
+    const phi::DenseTensor &saved_inv_variance,
+    const paddle::optional<phi::DenseTensor> &reserve_space,
+    const phi::DenseTensor &d_y,
+    float momentum,
+    float epsilon,
+    const std::string &data_layout,
+    bool is_test,
+    bool use_global_stats,
+    bool trainable_statistics,
+    phi::DenseTensor *d_x,
+    phi::DenseTensor *d_scale,
+    phi::DenseTensor *d_bias) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto shape = funcs::GetChannelShape(x.dims(), data_layout);
+  const int64_t C = shape.c;
+  const bool global_stats = (is_test && !trainable_statistics) ||
+                            use_global_stats;
+  const auto scale_v = BatchNormParam<MT>(scale, C, MT(1));
+
+  std::vector<MT> batch_mean(C);
+  std::vector<MT> inv_std;
+  if (global_stats) {
+    PD_CHECK(mean && variance,
+             "batch_norm_grad with global statistics needs the running "
+             "mean and variance.");
+    const MT *running_mean = mean->data<MT>();
+    batch_mean.assign(running_mean, running_mean + C);
+    inv_std = InvStd(variance->data<MT>(), C, epsilon);
+  } else {
+    const MT *saved = saved_mean.data<MT>();
+    const MT *saved_inv = saved_inv_variance.data<MT>();
+    batch_mean.assign(saved, saved + C);
+    inv_std.assign(saved_inv, saved_inv + C);
+  }
+
+  std::vector<MT> sum_dy(C);
+  std::vector<MT> sum_dy_xmu(C);
+  funcs::ChannelGradSums<T, MT>(d_y.data<T>(),
+                                x.data<T>(),
+                                shape,
+                                batch_mean.data(),
+                                sum_dy.data(),
+                                sum_dy_xmu.data());
+  if (d_scale) {
+    MT *d_scale_data = dev_ctx.template Alloc<MT>(d_scale);
+    for (int64_t c = 0; c < C; ++c) {
+      d_scale_data[c] = sum_dy_xmu[c] * inv_std[c];
+    }
+  }
+  if (d_bias) {
+    MT *d_bias_data = dev_ctx.template Alloc<MT>(d_bias);
+    for (int64_t c = 0; c < C; ++c) {
+      d_bias_data[c] = sum_dy[c];
+    }
+  }
+  if (d_x) {
+    T *d_x_data = dev_ctx.template Alloc<T>(d_x);
+    if (x.numel() == 0) {
+      return;
+    }
+    funcs::BatchNormGradApply<T, MT>(d_y.data<T>(),
+                                     x.data<T>(),
+                                     shape,
+                                     batch_mean.data(),
+                                     inv_std.data(),
+                                     scale_v.data(),
+                                     sum_dy.data(),
+                                     sum_dy_xmu.data(),
+                                     static_cast<MT>(shape.n * shape.s),
+                                     !global_stats,
+                                     d_x_data);
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(batch_norm,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::BatchNormKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(batch_norm_infer,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::BatchNormInferKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(batch_norm_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::BatchNormGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
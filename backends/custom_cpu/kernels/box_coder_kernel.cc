@@ -0,0 +1,145 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+// Center form (cx, cy, w, h) of corner boxes [n, 4]; unnormalized boxes
+// count pixels inclusively.
+template <typename T>
+void CenterSize(const T* boxes, int64_t n, bool normalized, T* center) {
+  const T off = normalized ? 0 : 1;
+  for (int64_t i = 0; i < n; ++i) {
+    const T* b = boxes + i * 4;
+    T* c = center + i * 4;
+    c[2] = b[2] - b[0] + off;
+    c[3] = b[3] - b[1] + off;
+    c[0] = b[0] + c[2] / 2;
+    c[1] = b[1] + c[3] / 2;
+  }
+}
+
+}  // namespace
+
+// encode_center_size: target [N, 4] x prior [M, 4] -> [N, M, 4].
+// decode_center_size: target [N, M, 4] -> [N, M, 4], with prior j
+// (axis 0) or prior i (axis 1) for element (i, j).
+template <typename T>
+void BoxCoderKernel(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& prior_box,
+                    const paddle::optional<phi::DenseTensor>& prior_box_var,
+                    const phi::DenseTensor& target_box,
+                    const std::string& code_type,
+                    bool box_normalized,
+                    int axis,
+                    const std::vector<float>& variance,
+                    phi::DenseTensor* output_box) {
+  const auto prior_dims = prior_box.dims();
+  const auto target_dims = target_box.dims();
+  PD_CHECK(prior_dims.size() == 2 && prior_dims[1] == 4,
+           "The prior_box of box_coder must be [M, 4].");
+  const bool encode = code_type == "encode_center_size";
+  PD_CHECK(encode || code_type == "decode_center_size",
+           "The code_type of box_coder must be encode_center_size or "
+           "decode_center_size, but received %s.",
+           code_type);
+  PD_CHECK(variance.empty() || variance.size() == 4,
+           "The variance of box_coder must hold 4 values.");
+  const int64_t rows = target_dims[0];
+  const int64_t cols = encode ? prior_dims[0] : target_dims[1];
+  if (encode) {
+    PD_CHECK(target_dims.size() == 2 && target_dims[1] == 4,
+             "box_coder encodes target boxes [N, 4].");
+  } else {
+    PD_CHECK(target_dims.size() == 3 && target_dims[2] == 4,
+             "box_coder decodes target boxes [N, M, 4].");
+    PD_CHECK(prior_dims[0] == (axis == 0 ? cols : rows),
+             "The prior_box of box_coder does not match target_box on "
+             "axis %d.",
+             axis);
+  }
+  output_box->Resize({rows, cols, 4});
+  T* out = dev_ctx.template Alloc<T>(output_box);
+
+  const T* target = target_box.data<T>();
+  const T* var = prior_box_var ? prior_box_var->data<T>() : nullptr;
+  T attr_var[4] = {1, 1, 1, 1};
+  for (size_t k = 0; k < variance.size(); ++k) {
+    attr_var[k] = static_cast<T>(variance[k]);
+  }
+  std::vector<T> prior(prior_dims[0] * 4);
+  CenterSize(prior_box.data<T>(), prior_dims[0], box_normalized, prior.data());
+  const T off = box_normalized ? 0 : 1;
+  const int64_t grain =
+      std::max<int64_t>(1, funcs::kParallelGrainSize / (cols * 16));
+
+  funcs::ParallelFor(0, rows, grain, [&](int64_t b, int64_t e) {
+    for (int64_t i = b; i < e; ++i) {
+      // The target center is the corner midpoint, without the offset.
+      T center[4] = {0, 0, 0, 0};
+      if (encode) {
+        const T* t = target + i * 4;
+        center[0] = (t[0] + t[2]) / 2;
+        center[1] = (t[1] + t[3]) / 2;
+        center[2] = t[2] - t[0] + off;
+        center[3] = t[3] - t[1] + off;
+      }
+      for (int64_t j = 0; j < cols; ++j) {
+        const int64_t p = encode || axis == 0 ? j : i;
+        const T* pc = prior.data() + p * 4;
+        const T* v = var != nullptr ? var + p * 4 : attr_var;
+        T* o = out + (i * cols + j) * 4;
+        if (encode) {
+          o[0] = (center[0] - pc[0]) / pc[2];
+          o[1] = (center[1] - pc[1]) / pc[3];
+          o[2] = std::log(std::abs(center[2] / pc[2]));
+          o[3] = std::log(std::abs(center[3] / pc[3]));
+          if (var != nullptr || !variance.empty()) {
+            for (int k = 0; k < 4; ++k) {
+              o[k] /= v[k];
+            }
+          }
+        } else {
+          const T* t = target + (i * cols + j) * 4;
+          const T cx = v[0] * t[0] * pc[2] + pc[0];
+          const T cy = v[1] * t[1] * pc[3] + pc[1];
+          const T w = std::exp(v[2] * t[2]) * pc[2];
+          const T h = std::exp(v[3] * t[3]) * pc[3];
+          o[0] = cx - w / 2;
+          o[1] = cy - h / 2;
+          o[2] = cx + w / 2 - off;
+          o[3] = cy + h / 2 - off;
+        }
+      }
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(box_coder,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::BoxCoderKernel,
+                    float,
+                    double) {}
@@ -12,93 +12,60 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "kernels/funcs/cast.h"
 #include "paddle/phi/capi/all.h"
 #include "phi_funcs.h"  //NOLINT
 
 namespace custom_kernel {
 
+template <typename T, typename OutT>
+void CastTo(const phi::Context& dev_ctx,
+            const phi::DenseTensor& x,
+            phi::DenseTensor* out) {
+  auto out_data = dev_ctx.template Alloc<OutT>(out);
+  funcs::ParallelConvert(x.data<T>(), out_data, x.numel());
+}
+
 template <typename T>
 void CastKernel(const phi::Context& dev_ctx,
                 const phi::DenseTensor& x,
                 phi::DataType out_dtype,
                 phi::DenseTensor* out) {
-  auto x_data = x.data<T>();
   out->Resize(x.dims());
-  auto numel = x.numel();
   switch (out_dtype) {
-    case phi::DataType::BFLOAT16: {
-      auto out_data = dev_ctx.template Alloc<phi::dtype::bfloat16>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] =
-            static_cast<phi::dtype::bfloat16>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::BFLOAT16:
+      CastTo<T, phi::dtype::bfloat16>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::FLOAT16: {
-      auto out_data = dev_ctx.template Alloc<phi::dtype::float16>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] =
-            static_cast<phi::dtype::float16>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::FLOAT16:
+      CastTo<T, phi::dtype::float16>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::FLOAT32: {
-      auto out_data = dev_ctx.template Alloc<float>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<float>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::FLOAT32:
+      CastTo<T, float>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::FLOAT64: {
-      auto out_data = dev_ctx.template Alloc<double>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<double>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::FLOAT64:
+      CastTo<T, double>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::INT8: {
-      auto out_data = dev_ctx.template Alloc<int8_t>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<int8_t>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::INT8:
+      CastTo<T, int8_t>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::INT16: {
-      auto out_data = dev_ctx.template Alloc<int16_t>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<int16_t>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::INT16:
+      CastTo<T, int16_t>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::INT32: {
-      auto out_data = dev_ctx.template Alloc<int32_t>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<int32_t>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::INT32:
+      CastTo<T, int32_t>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::INT64: {
-      auto out_data = dev_ctx.template Alloc<int64_t>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<int64_t>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::INT64:
+      CastTo<T, int64_t>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::UINT8: {
-      auto out_data = dev_ctx.template Alloc<uint8_t>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<uint8_t>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::UINT8:
+      CastTo<T, uint8_t>(dev_ctx, x, out);
       break;
-    }
-    case phi::DataType::BOOL: {
-      auto out_data = dev_ctx.template Alloc<bool>(out);
-      for (auto i = 0; i < numel; ++i) {
-        out_data[i] = static_cast<bool>(static_cast<float>(x_data[i]));
-      }
+    case phi::DataType::BOOL:
+      CastTo<T, bool>(dev_ctx, x, out);
       break;
-    }
     default:
+      PD_CHECK(false, "cast to data type %d is not supported.",
+               static_cast<int>(out_dtype));
       break;
   }
 }
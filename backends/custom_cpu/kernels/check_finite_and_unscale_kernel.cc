@@ -0,0 +1,98 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+constexpr int64_t kUnscaleChunkSize = 16384;
+
+// out[i] = x[i] * inv_scale over [begin, end), returns whether any x[i] is
+// inf or nan. The elements go through a float (or double) block, so the
+// test and the multiply are the same vector loop for every T. v - v is 0
+// for a finite v and nan otherwise; the or-reduction of the compares
+// vectorizes without a pragma.
+template <typename T, typename MT>
+bool UnscaleAndCheck(
+    const T* x, T* out, MT inv_scale, int64_t begin, int64_t end) {
+  MT block[funcs::kCastBlock];
+  int non_finite = 0;
+  for (int64_t i = begin; i < end; i += funcs::kCastBlock) {
+    const int64_t len = std::min(funcs::kCastBlock, end - i);
+    funcs::ConvertElements(x + i, block, len);
+    for (int64_t j = 0; j < len; ++j) {
+      const MT v = block[j];
+      non_finite |= static_cast<int>((v - v) != MT(0));
+      block[j] = v * inv_scale;
+    }
+    funcs::ConvertElements(block, out + i, len);
+  }
+  return non_finite != 0;
+}
+
+// Unscales every gradient and reduces a single found_infinite flag in one
+// parallel sweep over all of them: the tensors are cut into chunks that
+// are distributed together, so many small gradients cost one fork.
+template <typename T>
+void CheckFiniteAndUnscaleKernel(const phi::Context& dev_ctx,
+                                 const std::vector<const phi::DenseTensor*>& xs,
+                                 const phi::DenseTensor& scale,
+                                 std::vector<phi::DenseTensor*> outs,
+                                 phi::DenseTensor* found_infinite) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const size_t n = xs.size();
+  PD_CHECK(outs.size() == n,
+           "The size of Output(Out) (%d) must be equal to Input(X) (%d).",
+           static_cast<int>(outs.size()),
+           static_cast<int>(n));
+  const MT inv_scale = MT(1) / scale.data<MT>()[0];
+
+  std::vector<const T*> x_data(n);
+  std::vector<T*> out_data(n);
+  std::vector<int64_t> numels(n);
+  for (size_t i = 0; i < n; ++i) {
+    x_data[i] = xs[i]->data<T>();
+    outs[i]->Resize(xs[i]->dims());
+    out_data[i] = dev_ctx.template Alloc<T>(outs[i]);
+    numels[i] = xs[i]->numel();
+  }
+
+  std::atomic<bool> found{false};
+  funcs::MultiTensorParallelFor(
+      numels, kUnscaleChunkSize, [&](size_t t, int64_t begin, int64_t end) {
+        if (UnscaleAndCheck<T, MT>(
+                x_data[t], out_data[t], inv_scale, begin, end)) {
+          found.store(true, std::memory_order_relaxed);
+        }
+      });
+
+  bool* found_data = dev_ctx.template Alloc<bool>(found_infinite);
+  found_data[0] = found.load();
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(check_finite_and_unscale,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::CheckFiniteAndUnscaleKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
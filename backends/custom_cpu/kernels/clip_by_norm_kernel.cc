@@ -0,0 +1,57 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "kernels/funcs/l2_norm.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// out = x * max_norm / max(norm(x), max_norm): one sweep for the norm and
+// one for the scale, skipped when x is within the norm and not in place.
+template <typename T>
+void ClipByNormKernel(const phi::Context& dev_ctx,
+                      const phi::DenseTensor& x,
+                      float max_norm,
+                      phi::DenseTensor* out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  out->Resize(x.dims());
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  const T* x_data = x.data<T>();
+  const int64_t numel = x.numel();
+  const MT norm = std::sqrt(
+      funcs::MultiTensorSquaredL2Norm<T, MT>({x_data}, {numel}));
+  const MT max = static_cast<MT>(max_norm);
+  if (norm <= max) {
+    if (out_data != x_data) {
+      funcs::ParallelMemcpy(out_data, x_data, numel * sizeof(T));
+    }
+    return;
+  }
+  // Paddle's epsilon only guards a zero norm, which is never clipped
+  funcs::MultiTensorScale<T, MT>({x_data}, {out_data}, {numel}, max / norm);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(clip_by_norm,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::ClipByNormKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
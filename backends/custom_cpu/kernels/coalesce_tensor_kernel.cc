@@ -0,0 +1,165 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+
+#include "kernels/funcs/fill.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// The device reports 512 bytes as its minimum chunk size.
+constexpr int64_t kCoalesceAlignBytes = 512;
+
+inline int64_t AlignedBytes(int64_t bytes, bool use_align, int align_size) {
+  if (!use_align) {
+    return bytes;
+  }
+  const int64_t alignment = align_size > 0 ? align_size : kCoalesceAlignBytes;
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+// Places the tensors back to back in one buffer (each padded to the
+// alignment) and turns every output into a view of its slot, so the group
+// can be scaled, clipped or all-reduced as one tensor. The padding is
+// zeroed, a reduction over the whole buffer only sees the tensors.
+template <typename T>
+void CoalesceTensorKernel(const phi::Context& dev_ctx,
+                          const std::vector<const phi::DenseTensor*>& input,
+                          phi::DataType dtype,
+                          bool copy_data,
+                          bool set_constant,
+                          bool persist_output,
+                          float constant,
+                          bool use_align,
+                          int align_size,
+                          int size_of_dtype,
+                          const std::vector<int64_t>& concated_shapes,
+                          const std::vector<int64_t>& concated_ranks,
+                          std::vector<phi::DenseTensor*> output,
+                          phi::DenseTensor* fused_output) {
+  const size_t n = input.size();
+  PD_CHECK(n > 0, "The coalesce_tensor operator has no input.");
+  PD_CHECK(output.size() == n,
+           "The number of inputs (%d) and outputs (%d) of coalesce_tensor "
+           "must match.",
+           static_cast<int>(n),
+           static_cast<int>(output.size()));
+  if (size_of_dtype == -1) {
+    size_of_dtype = sizeof(T);
+  }
+  PD_CHECK(size_of_dtype == static_cast<int>(sizeof(T)),
+           "size_of_dtype (%d) of coalesce_tensor does not match the kernel "
+           "data type.",
+           size_of_dtype);
+
+  // an uninitialized input takes its shape from concated_shapes
+  std::vector<std::vector<int64_t>> dims(n);
+  int64_t rank_offset = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (input[i]->initialized()) {
+      dims[i] = input[i]->dims();
+    } else {
+      PD_CHECK(concated_ranks.size() == n,
+               "Attr(concated_ranks) of coalesce_tensor must have one rank "
+               "per output when an input is not initialized.");
+      PD_CHECK(rank_offset + concated_ranks[i] <=
+                   static_cast<int64_t>(concated_shapes.size()),
+               "Attr(concated_shapes) and Attr(concated_ranks) of "
+               "coalesce_tensor do not match.");
+      dims[i].assign(concated_shapes.begin() + rank_offset,
+                     concated_shapes.begin() + rank_offset + concated_ranks[i]);
+    }
+    if (i < concated_ranks.size()) {
+      rank_offset += concated_ranks[i];
+    }
+  }
+
+  std::vector<int64_t> numels(n);
+  std::vector<int64_t> offsets(n + 1, 0);
+  for (size_t i = 0; i < n; ++i) {
+    numels[i] = 1;
+    for (auto d : dims[i]) {
+      numels[i] *= d;
+    }
+    PD_CHECK(numels[i] > 0,
+             "The %d-th tensor of coalesce_tensor has no elements.",
+             static_cast<int>(i));
+    offsets[i + 1] =
+        offsets[i] +
+        AlignedBytes(numels[i] * sizeof(T), use_align, align_size) /
+            static_cast<int64_t>(sizeof(T));
+  }
+
+  fused_output->Resize({offsets[n]});
+  T* fused = dev_ctx.template Alloc<T>(fused_output);
+
+  if (set_constant) {
+    funcs::ParallelFill(fused, offsets[n], static_cast<T>(constant));
+  } else {
+    // source of every slot, or null when it has no data to keep
+    std::vector<const T*> sources(n, nullptr);
+    for (size_t i = 0; i < n; ++i) {
+      if (copy_data && input[i]->initialized()) {
+        sources[i] = input[i]->data<T>();
+      } else if (persist_output && output[i]->initialized()) {
+        sources[i] = output[i]->data<T>();
+      }
+    }
+    std::vector<int64_t> slot_sizes(n);
+    for (size_t i = 0; i < n; ++i) {
+      slot_sizes[i] = offsets[i + 1] - offsets[i];
+    }
+    // one sweep copies every tensor and zeroes the padding after it
+    funcs::MultiTensorParallelFor(
+        slot_sizes,
+        funcs::kParallelCopyGrainBytes / sizeof(T),
+        [&](size_t t, int64_t begin, int64_t end) {
+          T* slot = fused + offsets[t];
+          const int64_t copy_end = std::min(end, numels[t]);
+          if (sources[t] != nullptr && begin < copy_end) {
+            std::memcpy(slot + begin,
+                        sources[t] + begin,
+                        (copy_end - begin) * sizeof(T));
+          }
+          const int64_t zero_begin = std::max(begin, numels[t]);
+          if (zero_begin < end) {
+            std::memset(slot + zero_begin, 0, (end - zero_begin) * sizeof(T));
+          }
+        });
+  }
+
+  // outputs become views after the copy, they may be the inputs themselves
+  for (size_t i = 0; i < n; ++i) {
+    output[i]->ShareDataWith(*fused_output);
+    output[i]->Resize(dims[i]);
+    output[i]->set_strides(phi::CalcStrides(dims[i]));
+    output[i]->set_offset(fused_output->offset() + offsets[i] * sizeof(T));
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(coalesce_tensor,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::CoalesceTensorKernel,
+                    int,
+                    int64_t,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
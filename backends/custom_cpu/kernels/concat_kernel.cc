@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "kernels/funcs/concat_split.h"
 #include "paddle/phi/capi/all.h"
 #include "phi_funcs.h"  //NOLINT
 
@@ -22,36 +23,71 @@ void ConcatKernel(const phi::Context& dev_ctx,
                   const std::vector<const phi::DenseTensor*>& x,
                   const phi::Scalar& axis_scalar,
                   phi::DenseTensor* out) {
+  const int64_t rank = x[0]->dims().size();
   int64_t axis = axis_scalar.to<int64_t>();
   if (axis < 0) {
-    axis = axis + x[0]->dims().size();
+    axis = axis + rank;
   }
-  std::vector<int64_t> out_dims(x[0]->dims().size(), 0);
-  for (auto i = 0; i < x[0]->dims().size(); ++i) {
-    if (axis == i) {
-      for (auto j = 0; j < x.size(); ++j) {
-        out_dims[i] += x[j]->dims()[i];
-      }
-    } else {
-      out_dims[i] = x[0]->dims()[i];
+  std::vector<int64_t> out_dims = x[0]->dims();
+  std::vector<int64_t> axis_sizes;
+  out_dims[axis] = 0;
+  for (auto t : x) {
+    PD_CHECK(t->dims().size() == rank,
+             "The inputs of concat must have the same rank, got %d and %d.",
+             static_cast<int>(rank),
+             static_cast<int>(t->dims().size()));
+    for (int64_t i = 0; i < rank; ++i) {
+      PD_CHECK(i == axis || t->dims()[i] == out_dims[i],
+               "The inputs of concat must match on dim %d, got %ld and %ld.",
+               static_cast<int>(i),
+               out_dims[i],
+               t->dims()[i]);
     }
+    axis_sizes.push_back(t->dims()[axis]);
+    out_dims[axis] += t->dims()[axis];
   }
   out->Resize(out_dims);
-  dev_ctx.template Alloc<T>(out);
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  std::vector<const T*> parts;
+  for (auto t : x) {
+    parts.push_back(t->numel() > 0 ? t->data<T>() : nullptr);
+  }
+  funcs::ConcatParts(
+      parts, funcs::GetPartsShape(out_dims, axis, axis_sizes), out_data);
+}
 
-  auto M = std::accumulate(
-      out_dims.cbegin(), out_dims.cbegin() + axis, 1, std::multiplies<int>());
-  auto N = std::accumulate(
-      out_dims.cbegin() + axis + 1, out_dims.cend(), 1, std::multiplies<int>());
-  auto out_offset = 0;
-  for (auto i = 0; i < M; ++i) {
-    for (auto j = 0; j < x.size(); ++j) {
-      memcpy(out->data<T>() + out_offset,
-             x[j]->data<T>() + i * N * x[j]->dims()[axis],
-             (N * x[j]->dims()[axis]) * sizeof(T));
-      out_offset += N * x[j]->dims()[axis];
+template <typename T>
+void ConcatGradKernel(const phi::Context& dev_ctx,
+                      const std::vector<const phi::DenseTensor*>& x,
+                      const phi::DenseTensor& out_grad,
+                      const phi::Scalar& axis_scalar,
+                      std::vector<phi::DenseTensor*> x_grad) {
+  const int64_t rank = out_grad.dims().size();
+  int64_t axis = axis_scalar.to<int64_t>();
+  if (axis < 0) {
+    axis = axis + rank;
+  }
+  std::vector<int64_t> axis_sizes;
+  std::vector<T*> parts;
+  for (size_t i = 0; i < x.size(); ++i) {
+    axis_sizes.push_back(x[i]->dims()[axis]);
+    T* part = nullptr;
+    if (x_grad[i] != nullptr) {
+      x_grad[i]->Resize(x[i]->dims());
+      part = dev_ctx.template Alloc<T>(x_grad[i]);
     }
+    parts.push_back(part);
+  }
+  if (out_grad.numel() == 0) {
+    return;
   }
+  funcs::SplitParts(out_grad.data<T>(),
+                    funcs::GetPartsShape(out_grad.dims(), axis, axis_sizes),
+                    parts);
 }
 
 }  // namespace custom_kernel
@@ -69,3 +105,17 @@ PD_BUILD_PHI_KERNEL(concat,
                     uint8_t,
                     phi::dtype::float16,
                     phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(concat_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::ConcatGradKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    int8_t,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
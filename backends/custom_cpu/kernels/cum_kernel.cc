@@ -0,0 +1,261 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "kernels/funcs/scan.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+template <typename T, typename Op>
+void ScanKernel(const phi::Context& dev_ctx,
+                const phi::DenseTensor& x,
+                int axis,
+                bool flatten,
+                bool exclusive,
+                bool reverse,
+                phi::DenseTensor* out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto dims = x.dims();
+  const int rank = static_cast<int>(dims.size());
+  PD_CHECK(flatten || rank == 0 || (axis >= -rank && axis < rank),
+           "The axis (%d) of the scan is out of range for a %d-D input.",
+           axis,
+           rank);
+  out->Resize(flatten ? std::vector<int64_t>{x.numel()} : dims);
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  const auto shape = funcs::GetScanShape(dims, axis, flatten);
+  if (std::is_same<T, float>::value && funcs::ScanInDouble()) {
+    funcs::Scan<T, double, Op>(
+        x.data<T>(), out_data, shape, exclusive, reverse);
+  } else {
+    funcs::Scan<T, MT, Op>(x.data<T>(), out_data, shape, exclusive, reverse);
+  }
+}
+
+template <typename T>
+void CumsumKernel(const phi::Context& dev_ctx,
+                  const phi::DenseTensor& x,
+                  const phi::Scalar& axis,
+                  bool flatten,
+                  bool exclusive,
+                  bool reverse,
+                  phi::DenseTensor* out) {
+  ScanKernel<T, funcs::SumOp>(
+      dev_ctx, x, axis.to<int>(), flatten, exclusive, reverse, out);
+}
+
+template <typename T>
+void CumprodKernel(const phi::Context& dev_ctx,
+                   const phi::DenseTensor& x,
+                   int dim,
+                   bool exclusive,
+                   bool reverse,
+                   phi::DenseTensor* out) {
+  ScanKernel<T, funcs::ProdOp>(
+      dev_ctx, x, dim, false, exclusive, reverse, out);
+}
+
+template <typename T>
+void LogcumsumexpKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        int axis,
+                        bool flatten,
+                        bool exclusive,
+                        bool reverse,
+                        phi::DenseTensor* out) {
+  ScanKernel<T, funcs::LogAddExpOp>(
+      dev_ctx, x, axis, flatten, exclusive, reverse, out);
+}
+
+// Runs grad(line) over every line of `shape` in parallel. `line` holds
+// scratch buffers of len elements; Gather and Scatter move a line between
+// a tensor and a buffer in scan order (reversed for reverse scans).
+template <typename MT, typename Func>
+void ForEachGradLine(const funcs::ScanShape& shape,
+                     bool reverse,
+                     int buffers,
+                     const Func& grad) {
+  const int64_t len = shape.len;
+  const int64_t grain =
+      std::max<int64_t>(1, funcs::kParallelGrainSize / std::max<int64_t>(
+                                                           len, 1));
+  funcs::ParallelFor(
+      0, shape.outer * shape.inner, grain, [&](int64_t begin, int64_t end) {
+        std::vector<std::vector<MT>> scratch(buffers, std::vector<MT>(len));
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t base = funcs::ScanLineOffset(shape, i);
+          auto index = [&](int64_t k) {
+            return base + (reverse ? len - 1 - k : k) * shape.inner;
+          };
+          grad(index, scratch);
+        }
+      });
+}
+
+template <typename T, typename MT, typename Index>
+void GatherLine(const T* src, int64_t len, const Index& index, MT* dst) {
+  for (int64_t k = 0; k < len; ++k) {
+    dst[k] = static_cast<MT>(src[index(k)]);
+  }
+}
+
+// With P_k the product of the elements before k and s = exclusive,
+// dx_k = P_k * D_{k+s}, D_k = dout_k + x_{k+1-s} * D_{k+1}. No division,
+// zeros in x need no special case.
+template <typename T>
+void CumprodGradKernel(const phi::Context& dev_ctx,
+                       const phi::DenseTensor& x,
+                       const phi::DenseTensor& out,
+                       const phi::DenseTensor& dout,
+                       int dim,
+                       bool exclusive,
+                       bool reverse,
+                       phi::DenseTensor* dx) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  dx->Resize(x.dims());
+  T* dx_data = dev_ctx.template Alloc<T>(dx);
+  const auto shape = funcs::GetScanShape(x.dims(), dim, false);
+  if (x.numel() == 0) {
+    return;
+  }
+  const T* x_data = x.data<T>();
+  const T* dout_data = dout.data<T>();
+  const int64_t len = shape.len;
+  const int64_t s = exclusive ? 1 : 0;
+  ForEachGradLine<MT>(
+      shape, reverse, 2, [&](const auto& index, auto& scratch) {
+        MT* xs = scratch[0].data();
+        MT* ds = scratch[1].data();
+        GatherLine(x_data, len, index, xs);
+        GatherLine(dout_data, len, index, ds);
+        for (int64_t k = len - 2; k >= 0; --k) {
+          ds[k] += xs[k + 1 - s] * ds[k + 1];
+        }
+        MT prefix = 1;
+        for (int64_t k = 0; k < len; ++k) {
+          const MT d = k + s < len ? ds[k + s] : MT(0);
+          dx_data[index(k)] = static_cast<T>(prefix * d);
+          prefix *= xs[k];
+        }
+      });
+}
+
+// dx_k = exp(x_k - out_{k+s}) * D_{k+s} with
+// D_k = dout_k + exp(out_k - out_{k+1}) * D_{k+1}; out never decreases
+// along the scan, so no exponent is positive.
+template <typename T>
+void LogcumsumexpGradKernel(const phi::Context& dev_ctx,
+                            const phi::DenseTensor& x,
+                            const phi::DenseTensor& out,
+                            const phi::DenseTensor& dout,
+                            int axis,
+                            bool flatten,
+                            bool exclusive,
+                            bool reverse,
+                            phi::DenseTensor* dx) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  dx->Resize(x.dims());
+  T* dx_data = dev_ctx.template Alloc<T>(dx);
+  const auto shape = funcs::GetScanShape(x.dims(), axis, flatten);
+  if (x.numel() == 0) {
+    return;
+  }
+  const T* x_data = x.data<T>();
+  const T* out_data = out.data<T>();
+  const T* dout_data = dout.data<T>();
+  const int64_t len = shape.len;
+  const int64_t s = exclusive ? 1 : 0;
+  const MT neg_inf = -std::numeric_limits<MT>::infinity();
+  // exp(a - b), zero for a == -inf where b may be -inf too
+  auto ratio = [neg_inf](MT a, MT b) {
+    return a == neg_inf ? MT(0) : std::exp(a - b);
+  };
+  ForEachGradLine<MT>(
+      shape, reverse, 3, [&](const auto& index, auto& scratch) {
+        MT* xs = scratch[0].data();
+        MT* os = scratch[1].data();
+        MT* ds = scratch[2].data();
+        GatherLine(x_data, len, index, xs);
+        GatherLine(out_data, len, index, os);
+        GatherLine(dout_data, len, index, ds);
+        for (int64_t k = len - 2; k >= 0; --k) {
+          ds[k] += ratio(os[k], os[k + 1]) * ds[k + 1];
+        }
+        for (int64_t k = 0; k < len; ++k) {
+          const MT d =
+              k + s < len ? ratio(xs[k], os[k + s]) * ds[k + s] : MT(0);
+          dx_data[index(k)] = static_cast<T>(d);
+        }
+      });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(cumsum,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::CumsumKernel,
+                    float,
+                    double,
+                    int16_t,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(cumprod,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::CumprodKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(cumprod_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::CumprodGradKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(logcumsumexp,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::LogcumsumexpKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(logcumsumexp_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::LogcumsumexpGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
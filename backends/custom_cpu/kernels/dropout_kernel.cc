@@ -0,0 +1,190 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/philox.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// The dropout mask is bit-packed: bit (i % 8) of byte i / 8 (LSB first) is 1
+// when element i is kept. Byte j is drawn from Philox blocks 2j and 2j + 1,
+// so threads work on whole bytes and never share one.
+constexpr int64_t kDropoutBitsPerByte = 8;
+
+static inline int64_t DropoutMaskBytes(int64_t numel) {
+  return (numel + kDropoutBitsPerByte - 1) / kDropoutBitsPerByte;
+}
+
+static inline bool DropoutUpscale(const std::string &mode) {
+  PD_CHECK(mode == "upscale_in_train" || mode == "downgrade_in_infer",
+           "The mode of dropout must be upscale_in_train or "
+           "downgrade_in_infer, but received %s.",
+           mode.c_str());
+  return mode == "upscale_in_train";
+}
+
+template <typename T>
+void DropoutRawKernel(const phi::Context &dev_ctx,
+                      const phi::DenseTensor &x,
+                      const paddle::optional<phi::DenseTensor> &seed_tensor,
+                      const phi::Scalar &p,
+                      bool is_test,
+                      const std::string &mode,
+                      int seed,
+                      bool fix_seed,
+                      phi::DenseTensor *out,
+                      phi::DenseTensor *mask) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const float prob = p.to<float>();
+  PD_CHECK(prob >= 0.0f && prob <= 1.0f,
+           "The probability of dropout must be in [0, 1], but received %f.",
+           prob);
+  const bool upscale = DropoutUpscale(mode);
+  const int64_t numel = x.numel();
+  const T *x_data = x.data<T>();
+  T *out_data = dev_ctx.template Alloc<T>(out);
+
+  if (is_test) {
+    const MT factor = upscale ? static_cast<MT>(1) : static_cast<MT>(1 - prob);
+    funcs::ParallelFor(
+        0, numel, funcs::kParallelGrainSize, [&](int64_t b, int64_t e) {
+          PD_CPU_SIMD
+          for (int64_t i = b; i < e; ++i) {
+            out_data[i] = static_cast<T>(static_cast<MT>(x_data[i]) * factor);
+          }
+        });
+    return;
+  }
+
+  const int64_t mask_bytes = DropoutMaskBytes(numel);
+  mask->Resize(std::vector<int64_t>{mask_bytes});
+  uint8_t *mask_data = dev_ctx.template Alloc<uint8_t>(mask);
+
+  // Element i is kept when its 32-bit draw is >= p * 2^32; p == 1 drops
+  // everything.
+  const uint64_t threshold = static_cast<uint64_t>(
+      std::ldexp(static_cast<double>(prob), 32));
+  const MT scale = upscale && prob < 1.0f ? static_cast<MT>(1 / (1 - prob))
+                                          : static_cast<MT>(1);
+
+  uint64_t philox_seed_value = 0;
+  if (seed_tensor) {
+    philox_seed_value = static_cast<uint32_t>(seed_tensor->data<int>()[0]);
+  } else if (fix_seed) {
+    philox_seed_value = static_cast<uint32_t>(seed);
+  }
+  uint64_t philox_seed, offset;
+  funcs::GetPhiloxSeedOffset(
+      philox_seed_value, 2 * mask_bytes, &philox_seed, &offset);
+  funcs::Philox4x32 philox(philox_seed, offset);
+
+  funcs::ParallelFor(
+      0,
+      mask_bytes,
+      funcs::kParallelGrainSize / kDropoutBitsPerByte,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t j = begin; j < end; ++j) {
+          const funcs::PhiloxBlock r0 = philox(2 * j);
+          const funcs::PhiloxBlock r1 = philox(2 * j + 1);
+          const uint32_t draws[kDropoutBitsPerByte] = {r0.v[0],
+                                                       r0.v[1],
+                                                       r0.v[2],
+                                                       r0.v[3],
+                                                       r1.v[0],
+                                                       r1.v[1],
+                                                       r1.v[2],
+                                                       r1.v[3]};
+          const int64_t first = j * kDropoutBitsPerByte;
+          const int64_t count =
+              std::min<int64_t>(kDropoutBitsPerByte, numel - first);
+          uint8_t bits = 0;
+          for (int64_t l = 0; l < count; ++l) {
+            const bool keep = draws[l] >= threshold;
+            bits |= static_cast<uint8_t>(keep) << l;
+            out_data[first + l] =
+                keep ? static_cast<T>(static_cast<MT>(x_data[first + l]) *
+                                      scale)
+                     : static_cast<T>(0);
+          }
+          mask_data[j] = bits;
+        }
+      });
+}
+
+template <typename T>
+void DropoutGradRawKernel(const phi::Context &dev_ctx,
+                          const phi::DenseTensor &mask,
+                          const phi::DenseTensor &out_grad,
+                          const phi::Scalar &p,
+                          bool is_test,
+                          const std::string &mode,
+                          phi::DenseTensor *x_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const float prob = p.to<float>();
+  const bool upscale = DropoutUpscale(mode);
+  const int64_t numel = out_grad.numel();
+  const T *dout = out_grad.data<T>();
+  T *dx = dev_ctx.template Alloc<T>(x_grad);
+
+  if (is_test) {
+    const MT factor = upscale ? static_cast<MT>(1) : static_cast<MT>(1 - prob);
+    funcs::ParallelFor(
+        0, numel, funcs::kParallelGrainSize, [&](int64_t b, int64_t e) {
+          PD_CPU_SIMD
+          for (int64_t i = b; i < e; ++i) {
+            dx[i] = static_cast<T>(static_cast<MT>(dout[i]) * factor);
+          }
+        });
+    return;
+  }
+
+  PD_CHECK(mask.numel() == DropoutMaskBytes(numel),
+           "The mask of dropout_grad must hold %ld packed bytes, but "
+           "received %ld.",
+           DropoutMaskBytes(numel),
+           mask.numel());
+  const uint8_t *mask_data = mask.data<uint8_t>();
+  const MT scale = upscale && prob < 1.0f ? static_cast<MT>(1 / (1 - prob))
+                                          : static_cast<MT>(1);
+  funcs::ParallelFor(
+      0, numel, funcs::kParallelGrainSize, [&](int64_t b, int64_t e) {
+        for (int64_t i = b; i < e; ++i) {
+          const bool keep = (mask_data[i / kDropoutBitsPerByte] >>
+                             (i % kDropoutBitsPerByte)) & 1;
+          dx[i] = keep ? static_cast<T>(static_cast<MT>(dout[i]) * scale)
+                       : static_cast<T>(0);
+        }
+      });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(dropout,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::DropoutRawKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(dropout_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::DropoutGradRawKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
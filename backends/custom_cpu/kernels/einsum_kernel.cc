@@ -0,0 +1,156 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/einsum.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+std::vector<std::vector<int64_t>> EinsumDims(
+    const std::vector<const phi::DenseTensor*>& inputs) {
+  std::vector<std::vector<int64_t>> dims;
+  for (const auto* x : inputs) {
+    dims.push_back(x->dims());
+  }
+  return dims;
+}
+
+std::shared_ptr<const funcs::EinsumPlan> ForwardPlan(
+    const std::string& equation,
+    const std::vector<std::vector<int64_t>>& dims) {
+  return funcs::GetEinsumPlan(
+      equation, dims, [&] { return funcs::ParseEinsum(equation, dims); });
+}
+
+}  // namespace
+
+template <typename T>
+void EinsumInferKernel(const phi::Context& dev_ctx,
+                       const std::vector<const phi::DenseTensor*>& inputs,
+                       const std::string& equation,
+                       phi::DenseTensor* out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto dims = EinsumDims(inputs);
+  const auto plan = ForwardPlan(equation, dims);
+  std::vector<int64_t> out_dims;
+  for (int l : plan->output) {
+    out_dims.push_back(plan->sizes[l]);
+  }
+  out->Resize(out_dims);
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  std::vector<const T*> data;
+  for (const auto* x : inputs) {
+    data.push_back(x->data<T>());
+  }
+  funcs::RunEinsum<T, MT>(*plan, data, dims, out_data, out_dims);
+}
+
+// The planner needs no preprocessed operands, so the cache outputs read
+// for the gradient are the inputs themselves.
+template <typename T>
+void EinsumKernel(const phi::Context& dev_ctx,
+                  const std::vector<const phi::DenseTensor*>& inputs,
+                  const std::string& equation,
+                  phi::DenseTensor* out,
+                  std::vector<phi::DenseTensor*> cache,
+                  std::vector<phi::DenseTensor*> xshape) {
+  EinsumInferKernel<T>(dev_ctx, inputs, equation, out);
+  for (size_t i = 0; i < cache.size() && i < inputs.size(); ++i) {
+    if (cache[i] != nullptr) {
+      cache[i]->ShareDataWith(*inputs[i]);
+      cache[i]->Resize(inputs[i]->dims());
+    }
+  }
+}
+
+// dx_i is the einsum of out_grad with the other operands into the labels
+// of x_i: summed over what they share, broadcast over labels only x_i has,
+// and written to the diagonal of repeated labels.
+template <typename T>
+void EinsumGradKernel(const phi::Context& dev_ctx,
+                      const std::vector<const phi::DenseTensor*>& x,
+                      const std::vector<const phi::DenseTensor*>& inner_cache,
+                      const phi::DenseTensor& out_grad,
+                      const std::string& equation,
+                      std::vector<phi::DenseTensor*> x_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto dims = EinsumDims(x);
+  const auto forward = ForwardPlan(equation, dims);
+  const std::vector<int64_t> out_dims = out_grad.dims();
+  for (size_t i = 0; i < x_grad.size() && i < x.size(); ++i) {
+    if (x_grad[i] == nullptr) {
+      continue;
+    }
+    std::vector<const T*> data = {out_grad.data<T>()};
+    std::vector<std::vector<int64_t>> grad_dims = {out_dims};
+    for (size_t j = 0; j < x.size(); ++j) {
+      if (j != i) {
+        data.push_back(x[j]->data<T>());
+        grad_dims.push_back(dims[j]);
+      }
+    }
+    const auto plan = funcs::GetEinsumPlan(
+        equation + "->grad" + std::to_string(i), dims, [&] {
+          funcs::EinsumPlan grad;
+          grad.sizes = forward->sizes;
+          grad.inputs.push_back(forward->output);
+          for (size_t j = 0; j < x.size(); ++j) {
+            if (j != i) {
+              grad.inputs.push_back(forward->inputs[j]);
+            }
+          }
+          grad.output = forward->inputs[i];
+          funcs::PlanEinsumOrder(&grad);
+          return grad;
+        });
+    x_grad[i]->Resize(dims[i]);
+    T* dx = dev_ctx.template Alloc<T>(x_grad[i]);
+    funcs::RunEinsum<T, MT>(*plan, data, grad_dims, dx, dims[i]);
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(einsum,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::EinsumKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(einsum_infer,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::EinsumInferKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(einsum_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::EinsumGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,260 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// How many ids ahead of the current one the forward gather prefetches. Rows
+// of a large table are almost never in cache, so the loads of the next rows
+// are issued while the current one is copied.
+constexpr int64_t kEmbeddingPrefetchDistance = 8;
+
+// Table rows copied per parallel block in the forward pass.
+constexpr int64_t kEmbeddingRowGrain = 256;
+
+// padding_idx value meaning "no padding row".
+constexpr int64_t kNoPadding = -1;
+
+static inline bool IsPaddingId(int64_t id, int64_t padding_idx) {
+  return padding_idx != kNoPadding && id == padding_idx;
+}
+
+template <typename IdT>
+void CheckEmbeddingIds(const IdT* ids,
+                       int64_t ids_numel,
+                       int64_t height,
+                       int64_t padding_idx) {
+  for (int64_t i = 0; i < ids_numel; ++i) {
+    if (IsPaddingId(ids[i], padding_idx)) {
+      continue;
+    }
+    PD_CHECK(ids[i] >= 0 && ids[i] < height,
+             "Variable value (input) of OP(paddle.nn.functional.embedding) "
+             "expected >= 0 and < %ld, but got %ld. Please check input "
+             "value.",
+             height,
+             static_cast<int64_t>(ids[i]));
+  }
+}
+
+template <typename T, typename IdT>
+void EmbeddingGather(const IdT* ids,
+                     int64_t ids_numel,
+                     const T* table,
+                     int64_t width,
+                     int64_t padding_idx,
+                     T* out) {
+  const size_t row_bytes = width * sizeof(T);
+  funcs::ParallelFor(
+      0, ids_numel, kEmbeddingRowGrain, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t ahead = i + kEmbeddingPrefetchDistance;
+          if (ahead < end && !IsPaddingId(ids[ahead], padding_idx)) {
+            const char* row =
+                reinterpret_cast<const char*>(table + ids[ahead] * width);
+            for (size_t b = 0; b < row_bytes; b += 64) {
+              __builtin_prefetch(row + b, 0, 0);
+            }
+          }
+          if (IsPaddingId(ids[i], padding_idx)) {
+            std::memset(out + i * width, 0, row_bytes);
+          } else {
+            std::memcpy(out + i * width, table + ids[i] * width, row_bytes);
+          }
+        }
+      });
+}
+
+template <typename T>
+void EmbeddingKernel(const phi::Context& dev_ctx,
+                     const phi::DenseTensor& inputx,
+                     const phi::DenseTensor& weight,
+                     int64_t padding_idx,
+                     phi::DenseTensor* out) {
+  auto table_dims = weight.dims();
+  const int64_t height = table_dims[0];
+  const int64_t width = table_dims[1];
+
+  auto out_dims = inputx.dims();
+  out_dims.push_back(width);
+  out->Resize(out_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  const int64_t ids_numel = inputx.numel();
+  if (ids_numel == 0) {
+    return;
+  }
+
+  if (inputx.dtype() == phi::DataType::INT64) {
+    auto ids = inputx.data<int64_t>();
+    CheckEmbeddingIds(ids, ids_numel, height, padding_idx);
+    EmbeddingGather(
+        ids, ids_numel, weight.data<T>(), width, padding_idx, out_data);
+  } else if (inputx.dtype() == phi::DataType::INT32) {
+    auto ids = inputx.data<int32_t>();
+    CheckEmbeddingIds(ids, ids_numel, height, padding_idx);
+    EmbeddingGather(
+        ids, ids_numel, weight.data<T>(), width, padding_idx, out_data);
+  } else {
+    PD_CHECK(false,
+             "embedding ids only support int32 or int64, but received %s.",
+             phi::to_string(inputx.dtype()));
+  }
+}
+
+// Dense gradient of the lookup without atomics: the positions of the ids are
+// sorted by id so every distinct row becomes one contiguous segment. Each
+// segment is owned by exactly one thread, which sums its out_grad rows in
+// position order, so the result is identical for any thread count.
+template <typename T, typename IdT>
+void EmbeddingSegmentedGrad(const IdT* ids,
+                            int64_t ids_numel,
+                            const T* out_grad,
+                            int64_t height,
+                            int64_t width,
+                            int64_t padding_idx,
+                            T* table_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+
+  std::vector<std::pair<int64_t, int64_t>> order;
+  order.reserve(ids_numel);
+  for (int64_t i = 0; i < ids_numel; ++i) {
+    if (!IsPaddingId(ids[i], padding_idx)) {
+      order.emplace_back(static_cast<int64_t>(ids[i]), i);
+    }
+  }
+  std::sort(order.begin(), order.end());
+
+  // segment_begin[s] is the first entry of `order` holding the s-th row.
+  std::vector<int64_t> segment_begin;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || order[i].first != order[i - 1].first) {
+      segment_begin.push_back(i);
+    }
+  }
+  segment_begin.push_back(order.size());
+  const int64_t num_segments = segment_begin.size() - 1;
+
+  // Rows that are never looked up are zero.
+  std::vector<int64_t> touched;
+  touched.reserve(num_segments);
+  for (int64_t s = 0; s < num_segments; ++s) {
+    touched.push_back(order[segment_begin[s]].first);
+  }
+  funcs::ParallelFor(
+      0, height, kEmbeddingRowGrain, [&](int64_t begin, int64_t end) {
+        auto it = std::lower_bound(touched.cbegin(), touched.cend(), begin);
+        int64_t row = begin;
+        while (row < end) {
+          const int64_t next =
+              (it == touched.cend()) ? end : std::min<int64_t>(*it, end);
+          if (next > row) {
+            std::memset(table_grad + row * width,
+                        0,
+                        (next - row) * width * sizeof(T));
+          }
+          row = next + 1;
+          if (it != touched.cend()) {
+            ++it;
+          }
+        }
+      });
+
+  funcs::ParallelFor(
+      0, num_segments, kEmbeddingRowGrain, [&](int64_t begin, int64_t end) {
+        std::vector<MT> acc(width);
+        for (int64_t s = begin; s < end; ++s) {
+          std::fill(acc.begin(), acc.end(), static_cast<MT>(0));
+          for (int64_t k = segment_begin[s]; k < segment_begin[s + 1]; ++k) {
+            const T* src = out_grad + order[k].second * width;
+            PD_CPU_SIMD
+            for (int64_t j = 0; j < width; ++j) {
+              acc[j] += static_cast<MT>(src[j]);
+            }
+          }
+          T* dst = table_grad + order[segment_begin[s]].first * width;
+          for (int64_t j = 0; j < width; ++j) {
+            dst[j] = static_cast<T>(acc[j]);
+          }
+        }
+      });
+}
+
+template <typename T>
+void EmbeddingGradKernel(const phi::Context& dev_ctx,
+                         const phi::DenseTensor& input,
+                         const phi::DenseTensor& weight,
+                         const phi::DenseTensor& out_grad,
+                         int64_t padding_idx,
+                         phi::DenseTensor* weight_grad) {
+  auto table_dims = weight.dims();
+  const int64_t height = table_dims[0];
+  const int64_t width = table_dims[1];
+
+  weight_grad->Resize(table_dims);
+  auto table_grad = dev_ctx.template Alloc<T>(weight_grad);
+  const int64_t ids_numel = input.numel();
+
+  if (input.dtype() == phi::DataType::INT64) {
+    auto ids = input.data<int64_t>();
+    CheckEmbeddingIds(ids, ids_numel, height, padding_idx);
+    EmbeddingSegmentedGrad(ids,
+                           ids_numel,
+                           out_grad.data<T>(),
+                           height,
+                           width,
+                           padding_idx,
+                           table_grad);
+  } else if (input.dtype() == phi::DataType::INT32) {
+    auto ids = input.data<int32_t>();
+    CheckEmbeddingIds(ids, ids_numel, height, padding_idx);
+    EmbeddingSegmentedGrad(ids,
+                           ids_numel,
+                           out_grad.data<T>(),
+                           height,
+                           width,
+                           padding_idx,
+                           table_grad);
+  } else {
+    PD_CHECK(false,
+             "embedding ids only support int32 or int64, but received %s.",
+             phi::to_string(input.dtype()));
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(embedding,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::EmbeddingKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(embedding_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::EmbeddingGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
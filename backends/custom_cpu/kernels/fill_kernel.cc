@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "kernels/funcs/fill.h"
 #include "kernels/phi_funcs.h"
 #include "paddle/phi/capi/all.h"
 
@@ -26,10 +27,7 @@ void FillKernel(const phi::Context& dev_ctx,
            "fill value should not be NaN, but received NaN");
 
   auto t = dev_ctx.template Alloc<T>(out);
-  T val = value.to<T>();
-  for (auto i = 0; i < out->numel(); ++i) {
-    t[i] = val;
-  }
+  funcs::ParallelFill(t, out->numel(), value.to<T>());
 }
 
 }  // namespace custom_kernel
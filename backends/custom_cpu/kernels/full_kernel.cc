@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "kernels/funcs/fill.h"
 #include "paddle/phi/capi/all.h"
 
 namespace custom_kernel {
@@ -21,9 +22,7 @@ void FullValue(const phi::Context& dev_ctx,
                phi::DenseTensor* tensor,
                VType val) {
   auto t = dev_ctx.template Alloc<T>(tensor);
-  for (auto i = 0; i < tensor->numel(); ++i) {
-    t[i] = val;
-  }
+  funcs::ParallelFill(t, tensor->numel(), static_cast<T>(val));
 }
 
 template <typename T>
@@ -36,6 +35,15 @@ void FullKernel(const phi::Context& dev_ctx,
   out->Resize(std::vector<int64_t>(int_shape.cbegin(), int_shape.cend()));
   FullValue<T>(dev_ctx, out, val.to<T>());
 }
+
+template <typename T>
+void FullLikeKernel(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& x,
+                    const phi::Scalar& val,
+                    phi::DataType dtype,
+                    phi::DenseTensor* out) {
+  FullValue<T>(dev_ctx, out, val.to<T>());
+}
 }  // namespace custom_kernel
 
 PD_BUILD_PHI_KERNEL(full,
@@ -49,3 +57,15 @@ PD_BUILD_PHI_KERNEL(full,
                     int32_t,
                     int64_t,
                     bool) {}
+
+PD_BUILD_PHI_KERNEL(full_like,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::FullLikeKernel,
+                    float,
+                    double,
+                    uint8_t,
+                    int16_t,
+                    int32_t,
+                    int64_t,
+                    bool) {}
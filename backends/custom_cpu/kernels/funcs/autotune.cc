@@ -0,0 +1,293 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/autotune.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace custom_kernel {
+namespace funcs {
+
+namespace {
+
+constexpr char kAutotuneMagic[8] = {'P', 'D', 'C', 'P', 'U', 'A', 'T', '1'};
+constexpr uint32_t kAutotuneVersion = 1;
+constexpr size_t kCpuModelBytes = 64;
+
+struct AutotuneFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t count;
+  char cpu_model[kCpuModelBytes];
+};
+
+// Timed runs per candidate; the fastest counts.
+constexpr int kAutotuneRuns = 2;
+
+std::string SanitizeFileName(const std::string& name) {
+  std::string out;
+  for (char c : name) {
+    const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                      (c >= '0' && c <= '9') || c == '-' || c == '.';
+    out += keep ? c : '_';
+  }
+  return out.empty() ? "unknown" : out;
+}
+
+bool MakeDirs(const std::string& dir) {
+  for (size_t pos = 1; pos <= dir.size(); ++pos) {
+    if (pos == dir.size() || dir[pos] == '/') {
+      const std::string prefix = dir.substr(0, pos);
+      if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::string DefaultCacheDir() {
+  const char* dir = std::getenv("CUSTOM_CPU_AUTOTUNE_CACHE_DIR");
+  if (dir != nullptr && dir[0] != '\0') {
+    return dir;
+  }
+  const char* home = std::getenv("HOME");
+  return std::string(home ? home : "/tmp") +
+         "/.cache/paddle_custom_cpu/autotune";
+}
+
+}  // namespace
+
+bool operator<(const AutotuneKey& a, const AutotuneKey& b) {
+  if (a.op != b.op) return a.op < b.op;
+  if (a.dtype != b.dtype) return a.dtype < b.dtype;
+  return std::lexicographical_compare(a.shape,
+                                      a.shape + kAutotuneShapeRank,
+                                      b.shape,
+                                      b.shape + kAutotuneShapeRank);
+}
+
+std::string HostCpuModel() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  std::string implementer, part;
+  while (std::getline(cpuinfo, line)) {
+    const auto colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    std::string name = line.substr(0, colon);
+    name.erase(name.find_last_not_of(" \t") + 1);
+    std::string value = line.substr(colon + 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+    if (name == "model name") {
+      return value;
+    } else if (name == "CPU implementer") {
+      implementer = value;
+    } else if (name == "CPU part") {
+      part = value;
+    }
+  }
+  if (!implementer.empty()) {
+    return "arm-" + implementer + "-" + part;
+  }
+  return "unknown";
+}
+
+bool AutotuneEnabled() {
+  static const bool enabled = [] {
+    const char* value = std::getenv("CUSTOM_CPU_AUTOTUNE");
+    return value != nullptr && value[0] != '\0' &&
+           std::strcmp(value, "0") != 0;
+  }();
+  return enabled;
+}
+
+AutotuneCache& AutotuneCache::Instance() {
+  static AutotuneCache cache(
+      DefaultCacheDir() + "/" + SanitizeFileName(HostCpuModel()) + ".bin",
+      HostCpuModel());
+  return cache;
+}
+
+AutotuneCache::AutotuneCache(const std::string& path,
+                             const std::string& cpu_model)
+    : path_(path), cpu_model_(cpu_model.substr(0, kCpuModelBytes - 1)) {
+  MapFile();
+}
+
+AutotuneCache::~AutotuneCache() { UnmapFile(); }
+
+void AutotuneCache::MapFile() {
+  const int fd = open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(AutotuneFileHeader)) {
+    close(fd);
+    return;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return;
+  }
+  // A file from another CPU model, format or a torn write is ignored and
+  // replaced on the next Insert.
+  const auto* header = static_cast<const AutotuneFileHeader*>(data);
+  const bool valid =
+      std::memcmp(header->magic, kAutotuneMagic, sizeof(kAutotuneMagic)) ==
+          0 &&
+      header->version == kAutotuneVersion &&
+      header->record_size == sizeof(AutotuneRecord) &&
+      std::strncmp(header->cpu_model, cpu_model_.c_str(), kCpuModelBytes) ==
+          0 &&
+      size == sizeof(AutotuneFileHeader) +
+                  header->count * sizeof(AutotuneRecord);
+  if (!valid) {
+    munmap(data, size);
+    return;
+  }
+  mapped_ = data;
+  mapped_size_ = size;
+  records_ = reinterpret_cast<const AutotuneRecord*>(header + 1);
+  num_records_ = header->count;
+}
+
+void AutotuneCache::UnmapFile() {
+  if (mapped_ != nullptr) {
+    munmap(mapped_, mapped_size_);
+  }
+  mapped_ = nullptr;
+  mapped_size_ = 0;
+  records_ = nullptr;
+  num_records_ = 0;
+}
+
+const AutotuneRecord* AutotuneCache::FindMapped(const AutotuneKey& key) const {
+  const AutotuneRecord* end = records_ + num_records_;
+  const AutotuneRecord* it = std::lower_bound(
+      records_, end, key, [](const AutotuneRecord& r, const AutotuneKey& k) {
+        return r.key < k;
+      });
+  if (it != end && !(key < it->key)) {
+    return it;
+  }
+  return nullptr;
+}
+
+bool AutotuneCache::Lookup(const AutotuneKey& key, AutotuneRecord* record) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = pending_.find(key);
+  if (it != pending_.end()) {
+    *record = it->second;
+    return true;
+  }
+  const AutotuneRecord* found = FindMapped(key);
+  if (found != nullptr) {
+    *record = *found;
+    return true;
+  }
+  return false;
+}
+
+bool AutotuneCache::Insert(const AutotuneRecord& record) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  pending_[record.key] = record;
+
+  // Re-read the file first so winners other processes stored meanwhile
+  // are kept.
+  UnmapFile();
+  MapFile();
+  std::map<AutotuneKey, AutotuneRecord> merged(pending_);
+  for (size_t i = 0; i < num_records_; ++i) {
+    merged.emplace(records_[i].key, records_[i]);
+  }
+
+  AutotuneFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kAutotuneMagic, sizeof(kAutotuneMagic));
+  header.version = kAutotuneVersion;
+  header.record_size = sizeof(AutotuneRecord);
+  header.count = merged.size();
+  std::strncpy(header.cpu_model, cpu_model_.c_str(), kCpuModelBytes - 1);
+
+  const auto slash = path_.find_last_of('/');
+  if (slash != std::string::npos && !MakeDirs(path_.substr(0, slash))) {
+    return false;
+  }
+  const std::string tmp = path_ + ".tmp." + std::to_string(getpid());
+  FILE* file = std::fopen(tmp.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  for (const auto& item : merged) {
+    ok = ok && std::fwrite(&item.second, sizeof(AutotuneRecord), 1, file) == 1;
+  }
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok || std::rename(tmp.c_str(), path_.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  UnmapFile();
+  MapFile();
+  pending_.clear();
+  return true;
+}
+
+int AutotuneCache::Benchmark(int num_candidates,
+                             const std::function<void(int)>& run,
+                             double* best_seconds_out) {
+  using Clock = std::chrono::steady_clock;
+  run(0);  // warm up caches and the thread pool
+  int best = 0;
+  double best_seconds = 0.0;
+  for (int c = 0; c < num_candidates; ++c) {
+    double seconds = 0.0;
+    for (int r = 0; r < kAutotuneRuns; ++r) {
+      const auto start = Clock::now();
+      run(c);
+      const double elapsed =
+          std::chrono::duration<double>(Clock::now() - start).count();
+      seconds = r == 0 ? elapsed : std::min(seconds, elapsed);
+    }
+    if (c == 0 || seconds < best_seconds) {
+      best = c;
+      best_seconds = seconds;
+    }
+  }
+  if (best_seconds_out != nullptr) {
+    *best_seconds_out = best_seconds;
+  }
+  return best;
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Persistent autotuning of kernel parameters.
+//
+// With CUSTOM_CPU_AUTOTUNE=1, the first time a kernel sees a problem (op,
+// dtype, shape, thread count) it times a list of candidate parameter sets
+// and keeps the fastest. Winners are written to a cache file per host CPU
+// model, so later processes reuse them without tuning:
+//
+//   $CUSTOM_CPU_AUTOTUNE_CACHE_DIR/<cpu model>.bin
+//   (default ~/.cache/paddle_custom_cpu/autotune)
+//
+// The file is a header followed by fixed-size records sorted by key; it is
+// mapped read-only and searched in place. New winners are merged into a
+// fresh file that atomically replaces the old one, so readers in other
+// processes never see a partial file. Tuning is opt-in because it runs
+// every candidate on the caller's data: by default kernels only read the
+// cache, populated beforehand by a tuning run, and fall back to their
+// default parameters for problems it does not hold.
+
+namespace custom_kernel {
+namespace funcs {
+
+enum class AutotuneOp : uint32_t {
+  kGemm = 1,
+};
+
+constexpr int kAutotuneShapeRank = 6;
+constexpr int kAutotuneParams = 4;
+
+struct AutotuneKey {
+  uint32_t op;
+  uint32_t dtype;
+  int64_t shape[kAutotuneShapeRank];
+};
+
+bool operator<(const AutotuneKey& a, const AutotuneKey& b);
+
+// One tuned problem as stored on disk.
+struct AutotuneRecord {
+  AutotuneKey key;
+  int32_t params[kAutotuneParams];
+  float seconds;
+  uint32_t reserved;
+};
+
+class AutotuneCache {
+ public:
+  // Cache for the host CPU in the configured directory.
+  static AutotuneCache& Instance();
+
+  AutotuneCache(const std::string& path, const std::string& cpu_model);
+  ~AutotuneCache();
+
+  AutotuneCache(const AutotuneCache&) = delete;
+  AutotuneCache& operator=(const AutotuneCache&) = delete;
+
+  bool Lookup(const AutotuneKey& key, AutotuneRecord* record);
+
+  // Adds a record and persists the cache. Returns false if the file could
+  // not be written; the record is still used for the rest of the process.
+  bool Insert(const AutotuneRecord& record);
+
+  // Times each candidate with `run(index)` and returns the index of the
+  // fastest, storing its time in `best_seconds` if given. `run` must be
+  // safe to call repeatedly.
+  static int Benchmark(int num_candidates,
+                       const std::function<void(int)>& run,
+                       double* best_seconds = nullptr);
+
+  const std::string& path() const { return path_; }
+
+ private:
+  void MapFile();
+  void UnmapFile();
+  const AutotuneRecord* FindMapped(const AutotuneKey& key) const;
+
+  std::mutex mutex_;
+  std::string path_;
+  std::string cpu_model_;
+  void* mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+  const AutotuneRecord* records_ = nullptr;
+  size_t num_records_ = 0;
+  std::map<AutotuneKey, AutotuneRecord> pending_;
+};
+
+// Model name of the host CPU, as in /proc/cpuinfo.
+std::string HostCpuModel();
+
+// Whether new problems are tuned (CUSTOM_CPU_AUTOTUNE set and not 0).
+bool AutotuneEnabled();
+
+}  // namespace funcs
+}  // namespace custom_kernel
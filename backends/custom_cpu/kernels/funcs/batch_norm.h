@@ -0,0 +1,372 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+
+namespace custom_kernel {
+namespace funcs {
+
+// A tensor normalized per channel, seen as [n, c, s] (channels first) or
+// [n, s, c] (channels last).
+struct ChannelShape {
+  int64_t n;
+  int64_t c;
+  int64_t s;
+  bool channels_last;
+};
+
+// `data_layout` is the data_layout attribute of batch_norm. A 2-D input is
+// [N, C] whatever the layout.
+inline ChannelShape GetChannelShape(const std::vector<int64_t>& dims,
+                                    const std::string& data_layout) {
+  ChannelShape shape;
+  shape.channels_last = dims.size() == 2 || data_layout == "NHWC" ||
+                        data_layout == "NDHWC";
+  shape.n = dims[0];
+  shape.c = shape.channels_last ? dims.back() : dims[1];
+  shape.s = 1;
+  for (size_t i = shape.channels_last ? 1 : 2;
+       i < dims.size() - (shape.channels_last ? 1 : 0);
+       ++i) {
+    shape.s *= dims[i];
+  }
+  return shape;
+}
+
+// Running count, mean and sum of squared deviations (Welford). Merge is
+// the pairwise update of Chan et al., so partial states of any split of
+// the data combine to the same statistics as one sequential pass.
+template <typename AT>
+struct WelfordState {
+  int64_t count = 0;
+  AT mean = 0;
+  AT m2 = 0;
+
+  void Merge(const WelfordState& other) {
+    if (other.count == 0) {
+      return;
+    }
+    const int64_t total = count + other.count;
+    const AT delta = other.mean - mean;
+    const AT ratio = static_cast<AT>(other.count) / total;
+    mean += delta * ratio;
+    m2 += other.m2 + delta * delta * count * ratio;
+    count = total;
+  }
+
+  // biased, as batch_norm normalizes with it
+  AT Variance() const { return count > 0 ? m2 / count : AT(0); }
+};
+
+// Welford over a contiguous row, kLanes interleaved states so the update
+// vectorizes: lane k takes elements k, k + kLanes, ... and all lanes share
+// the step count.
+template <typename T, typename AT>
+WelfordState<AT> RowWelford(const T* x, int64_t len) {
+  constexpr int kLanes = 8;
+  AT mean[kLanes] = {0};
+  AT m2[kLanes] = {0};
+  const int64_t steps = len / kLanes;
+  for (int64_t j = 0; j < steps; ++j) {
+    const AT inv = AT(1) / static_cast<AT>(j + 1);
+    const T* v = x + j * kLanes;
+    PD_CPU_SIMD
+    for (int k = 0; k < kLanes; ++k) {
+      const AT value = static_cast<AT>(v[k]);
+      const AT delta = value - mean[k];
+      mean[k] += delta * inv;
+      m2[k] += delta * (value - mean[k]);
+    }
+  }
+  WelfordState<AT> state;
+  for (int k = 0; k < kLanes && steps > 0; ++k) {
+    WelfordState<AT> lane;
+    lane.count = steps;
+    lane.mean = mean[k];
+    lane.m2 = m2[k];
+    state.Merge(lane);
+  }
+  for (int64_t i = steps * kLanes; i < len; ++i) {
+    WelfordState<AT> one;
+    one.count = 1;
+    one.mean = static_cast<AT>(x[i]);
+    state.Merge(one);
+  }
+  return state;
+}
+
+// Number of row chunks a channels-last reduction is split into: each chunk
+// keeps c partial states, merged in chunk order afterwards.
+inline int64_t ChannelsLastChunks(const ChannelShape& shape) {
+  const int64_t rows = shape.n * shape.s;
+  const int64_t by_size =
+      rows * shape.c / std::max<int64_t>(kParallelGrainSize, 1);
+  return std::max<int64_t>(
+      1, std::min<int64_t>({rows, by_size, GetMaxThreads()}));
+}
+
+// Per channel mean and biased variance of x in one pass over memory.
+template <typename T, typename AT>
+void ChannelWelford(const T* x,
+                    const ChannelShape& shape,
+                    std::vector<WelfordState<AT>>* stats) {
+  const int64_t C = shape.c;
+  stats->assign(C, WelfordState<AT>());
+  if (!shape.channels_last) {
+    // one state per contiguous [n, c] row of s elements
+    std::vector<WelfordState<AT>> rows(shape.n * C);
+    const int64_t grain = std::max<int64_t>(
+        1, kParallelGrainSize / std::max<int64_t>(shape.s, 1));
+    ParallelFor(0, shape.n * C, grain, [&](int64_t begin, int64_t end) {
+      for (int64_t r = begin; r < end; ++r) {
+        rows[r] = RowWelford<T, AT>(x + r * shape.s, shape.s);
+      }
+    });
+    ParallelFor(0, C, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; ++c) {
+        for (int64_t i = 0; i < shape.n; ++i) {
+          (*stats)[c].Merge(rows[i * C + c]);
+        }
+      }
+    });
+    return;
+  }
+
+  const int64_t rows = shape.n * shape.s;
+  const int64_t chunks = ChannelsLastChunks(shape);
+  std::vector<AT> means(chunks * C, AT(0));
+  std::vector<AT> m2s(chunks * C, AT(0));
+  std::vector<int64_t> counts(chunks, 0);
+  ParallelFor(0, chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t k = begin; k < end; ++k) {
+      const int64_t row_begin = rows * k / chunks;
+      const int64_t row_end = rows * (k + 1) / chunks;
+      AT* mean = means.data() + k * C;
+      AT* m2 = m2s.data() + k * C;
+      for (int64_t r = row_begin; r < row_end; ++r) {
+        const AT inv = AT(1) / static_cast<AT>(r - row_begin + 1);
+        const T* v = x + r * C;
+        PD_CPU_SIMD
+        for (int64_t c = 0; c < C; ++c) {
+          const AT value = static_cast<AT>(v[c]);
+          const AT delta = value - mean[c];
+          mean[c] += delta * inv;
+          m2[c] += delta * (value - mean[c]);
+        }
+      }
+      counts[k] = row_end - row_begin;
+    }
+  });
+  for (int64_t k = 0; k < chunks; ++k) {
+    for (int64_t c = 0; c < C; ++c) {
+      WelfordState<AT> part;
+      part.count = counts[k];
+      part.mean = means[k * C + c];
+      part.m2 = m2s[k * C + c];
+      (*stats)[c].Merge(part);
+    }
+  }
+}
+
+// out = a[c] * x + b[c] (+ d[c] * z when z is given), elementwise.
+template <typename T, typename AT>
+void ChannelAffine(const T* x,
+                   const T* z,
+                   const ChannelShape& shape,
+                   const AT* a,
+                   const AT* b,
+                   const AT* d,
+                   T* out) {
+  const int64_t C = shape.c;
+  if (!shape.channels_last) {
+    const int64_t S = shape.s;
+    const int64_t grain =
+        std::max<int64_t>(1, kParallelGrainSize / std::max<int64_t>(S, 1));
+    ParallelFor(0, shape.n * C, grain, [&](int64_t begin, int64_t end) {
+      for (int64_t r = begin; r < end; ++r) {
+        const int64_t c = r % C;
+        const T* xr = x + r * S;
+        T* outr = out + r * S;
+        if (z == nullptr) {
+          PD_CPU_SIMD
+          for (int64_t i = 0; i < S; ++i) {
+            outr[i] = static_cast<T>(a[c] * static_cast<AT>(xr[i]) + b[c]);
+          }
+        } else {
+          const T* zr = z + r * S;
+          PD_CPU_SIMD
+          for (int64_t i = 0; i < S; ++i) {
+            outr[i] = static_cast<T>(a[c] * static_cast<AT>(xr[i]) + b[c] +
+                                     d[c] * static_cast<AT>(zr[i]));
+          }
+        }
+      }
+    });
+    return;
+  }
+  const int64_t grain =
+      std::max<int64_t>(1, kParallelGrainSize / std::max<int64_t>(C, 1));
+  ParallelFor(0, shape.n * shape.s, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t r = begin; r < end; ++r) {
+      const T* xr = x + r * C;
+      T* outr = out + r * C;
+      if (z == nullptr) {
+        PD_CPU_SIMD
+        for (int64_t c = 0; c < C; ++c) {
+          outr[c] = static_cast<T>(a[c] * static_cast<AT>(xr[c]) + b[c]);
+        }
+      } else {
+        const T* zr = z + r * C;
+        PD_CPU_SIMD
+        for (int64_t c = 0; c < C; ++c) {
+          outr[c] = static_cast<T>(a[c] * static_cast<AT>(xr[c]) + b[c] +
+                                   d[c] * static_cast<AT>(zr[c]));
+        }
+      }
+    }
+  });
+}
+
+// Per channel sum(dy) and sum(dy * (x - mean[c])), the two reductions of
+// the batch_norm backward.
+template <typename T, typename AT>
+void ChannelGradSums(const T* dy,
+                     const T* x,
+                     const ChannelShape& shape,
+                     const AT* mean,
+                     AT* sum_dy,
+                     AT* sum_dy_xmu) {
+  const int64_t C = shape.c;
+  std::fill(sum_dy, sum_dy + C, AT(0));
+  std::fill(sum_dy_xmu, sum_dy_xmu + C, AT(0));
+  if (!shape.channels_last) {
+    const int64_t S = shape.s;
+    std::vector<AT> rows(shape.n * C * 2);
+    const int64_t grain =
+        std::max<int64_t>(1, kParallelGrainSize / std::max<int64_t>(S, 1));
+    ParallelFor(0, shape.n * C, grain, [&](int64_t begin, int64_t end) {
+      for (int64_t r = begin; r < end; ++r) {
+        const AT m = mean[r % C];
+        const T* dyr = dy + r * S;
+        const T* xr = x + r * S;
+        AT s0 = 0;
+        AT s1 = 0;
+        for (int64_t i = 0; i < S; ++i) {
+          const AT g = static_cast<AT>(dyr[i]);
+          s0 += g;
+          s1 += g * (static_cast<AT>(xr[i]) - m);
+        }
+        rows[2 * r] = s0;
+        rows[2 * r + 1] = s1;
+      }
+    });
+    for (int64_t i = 0; i < shape.n; ++i) {
+      for (int64_t c = 0; c < C; ++c) {
+        sum_dy[c] += rows[2 * (i * C + c)];
+        sum_dy_xmu[c] += rows[2 * (i * C + c) + 1];
+      }
+    }
+    return;
+  }
+
+  const int64_t rows = shape.n * shape.s;
+  const int64_t chunks = ChannelsLastChunks(shape);
+  std::vector<AT> parts(chunks * C * 2, AT(0));
+  ParallelFor(0, chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t k = begin; k < end; ++k) {
+      AT* s0 = parts.data() + k * C * 2;
+      AT* s1 = s0 + C;
+      for (int64_t r = rows * k / chunks; r < rows * (k + 1) / chunks; ++r) {
+        const T* dyr = dy + r * C;
+        const T* xr = x + r * C;
+        PD_CPU_SIMD
+        for (int64_t c = 0; c < C; ++c) {
+          const AT g = static_cast<AT>(dyr[c]);
+          s0[c] += g;
+          s1[c] += g * (static_cast<AT>(xr[c]) - mean[c]);
+        }
+      }
+    }
+  });
+  for (int64_t k = 0; k < chunks; ++k) {
+    for (int64_t c = 0; c < C; ++c) {
+      sum_dy[c] += parts[k * C * 2 + c];
+      sum_dy_xmu[c] += parts[k * C * 2 + C + c];
+    }
+  }
+}
+
+// y = (x - mean[c]) * inv_std[c] * scale[c] + bias[c]
+template <typename T, typename AT>
+void BatchNormApply(const T* x,
+                    const ChannelShape& shape,
+                    const AT* mean,
+                    const AT* inv_std,
+                    const AT* scale,
+                    const AT* bias,
+                    T* y) {
+  std::vector<AT> a(shape.c);
+  std::vector<AT> b(shape.c);
+  for (int64_t c = 0; c < shape.c; ++c) {
+    a[c] = inv_std[c] * scale[c];
+    b[c] = bias[c] - mean[c] * a[c];
+  }
+  ChannelAffine<T, AT>(x, nullptr, shape, a.data(), b.data(), nullptr, y);
+}
+
+// dx of batch_norm from the per channel sums of ChannelGradSums over
+// `count` elements per channel. With batch statistics
+//   dx = scale * inv_std * (dy - sum_dy / count
+//        - (x - mean) * inv_std^2 * sum_dy_xmu / count),
+// with global (running) statistics the mean and variance are constants and
+//   dx = scale * inv_std * dy.
+template <typename T, typename AT>
+void BatchNormGradApply(const T* dy,
+                        const T* x,
+                        const ChannelShape& shape,
+                        const AT* mean,
+                        const AT* inv_std,
+                        const AT* scale,
+                        const AT* sum_dy,
+                        const AT* sum_dy_xmu,
+                        AT count,
+                        bool batch_stats,
+                        T* dx) {
+  std::vector<AT> a(shape.c);
+  std::vector<AT> b(shape.c, AT(0));
+  std::vector<AT> d(shape.c, AT(0));
+  for (int64_t c = 0; c < shape.c; ++c) {
+    a[c] = scale[c] * inv_std[c];
+    if (batch_stats) {
+      d[c] = -a[c] * inv_std[c] * inv_std[c] * sum_dy_xmu[c] / count;
+      b[c] = -a[c] * sum_dy[c] / count - d[c] * mean[c];
+    }
+  }
+  ChannelAffine<T, AT>(dy,
+                       batch_stats ? x : nullptr,
+                       shape,
+                       a.data(),
+                       b.data(),
+                       d.data(),
+                       dx);
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,312 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/parallel.h"
+
+namespace custom_kernel {
+namespace funcs {
+
+// Blocking of a GEMM: the output is cut into mc x nc tiles, each computed
+// by one thread over K in kc slices from packed copies of A and B.
+// `col_major_tiles` orders the tiles column first, so the contiguous block
+// of tiles a thread gets shares A panels rather than B panels.
+struct GemmConfig {
+  int32_t mc;
+  int32_t nc;
+  int32_t kc;
+  int32_t col_major_tiles;
+};
+
+inline GemmConfig DefaultGemmConfig() { return GemmConfig{64, 256, 256, 0}; }
+
+// Configurations tried by the autotuner.
+inline std::vector<GemmConfig> GemmCandidates() {
+  return {{64, 256, 256, 0},
+          {32, 512, 128, 0},
+          {128, 128, 256, 0},
+          {128, 512, 256, 0},
+          {64, 128, 128, 0},
+          {64, 512, 256, 1},
+          {128, 256, 128, 1},
+          {32, 256, 256, 1}};
+}
+
+// Activation applied by a GEMM epilogue.
+enum class GemmActivation { kNone, kRelu, kGelu, kSilu, kSigmoid, kTanh };
+
+inline bool ParseGemmActivation(const std::string& name,
+                                GemmActivation* act) {
+  if (name.empty() || name == "none" || name == "identity") {
+    *act = GemmActivation::kNone;
+  } else if (name == "relu") {
+    *act = GemmActivation::kRelu;
+  } else if (name == "gelu") {
+    *act = GemmActivation::kGelu;
+  } else if (name == "silu" || name == "swish") {
+    *act = GemmActivation::kSilu;
+  } else if (name == "sigmoid") {
+    *act = GemmActivation::kSigmoid;
+  } else if (name == "tanh") {
+    *act = GemmActivation::kTanh;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template <typename MT>
+inline MT ApplyGemmActivation(GemmActivation act, MT v) {
+  switch (act) {
+    case GemmActivation::kRelu:
+      return v > static_cast<MT>(0) ? v : static_cast<MT>(0);
+    case GemmActivation::kGelu:
+      return static_cast<MT>(0.5) * v *
+             (static_cast<MT>(1) + std::erf(v * static_cast<MT>(M_SQRT1_2)));
+    case GemmActivation::kSilu:
+      return v / (static_cast<MT>(1) + std::exp(-v));
+    case GemmActivation::kSigmoid:
+      return static_cast<MT>(1) / (static_cast<MT>(1) + std::exp(-v));
+    case GemmActivation::kTanh:
+      return std::tanh(v);
+    default:
+      return v;
+  }
+}
+
+// Work done on each output element before it is stored:
+// out = act(alpha * sum + bias), with
+// bias(m, n) = bias[(m % bias_rows) * bias_row_stride + n * bias_col_stride]
+// (no modulo when bias_rows is 0), so one struct covers per-column
+// (linear), per-row (conv) and full or row-periodic (residual) biases.
+template <typename T>
+struct GemmEpilogue {
+  const T* bias = nullptr;
+  int64_t bias_rows = 0;
+  int64_t bias_row_stride = 0;
+  int64_t bias_col_stride = 0;
+  GemmActivation act = GemmActivation::kNone;
+};
+
+// One out[M, N] (or out[N, M] with trans_out) = alpha * op(x)[M, K] *
+// op(y)[K, N] product, added to out when `accumulate`.
+//
+// With `strided` the layouts come from the element strides instead: x, y
+// and out are the [M, K], [K, N] and [M, N] views with (row, column)
+// strides x_strides, y_strides and out_strides, and the trans flags are
+// ignored. Einsum passes permuted operands this way without copying them.
+template <typename T, typename MT>
+struct GemmProblem {
+  bool trans_x;
+  bool trans_y;
+  int64_t M;
+  int64_t K;
+  int64_t N;
+  const T* x;
+  const T* y;
+  T* out;
+  bool trans_out;
+  MT alpha;
+  bool accumulate;
+  GemmEpilogue<T> epilogue;
+  bool strided = false;
+  int64_t x_strides[2] = {0, 0};
+  int64_t y_strides[2] = {0, 0};
+  int64_t out_strides[2] = {0, 0};
+};
+
+// Block size actually used along a dimension of size `dim`.
+inline int64_t ClampGemmBlock(int32_t block, int64_t dim) {
+  return std::max<int64_t>(1, std::min<int64_t>(block, dim));
+}
+
+// Runs independent GEMMs in one parallel region over the output tiles of
+// all of them, so problems sharing an operand (e.g. Q/K/V projections of
+// the same activations) are spread over the threads together. Every output
+// element is summed over k = 0 .. K-1 in order in an MT accumulator, so the
+// result does not depend on the config or the thread count.
+template <typename T, typename MT>
+void BlockedGemmBatch(const std::vector<GemmProblem<T, MT>>& problems,
+                      const GemmConfig& config) {
+  // first tile of every problem, plus the total
+  std::vector<int64_t> tile_offsets(problems.size() + 1, 0);
+  int64_t max_k = 1;
+  for (size_t p = 0; p < problems.size(); ++p) {
+    const auto& prob = problems[p];
+    const int64_t mc = ClampGemmBlock(config.mc, prob.M);
+    const int64_t nc = ClampGemmBlock(config.nc, prob.N);
+    const int64_t m_tiles = (prob.M + mc - 1) / mc;
+    const int64_t n_tiles = (prob.N + nc - 1) / nc;
+    tile_offsets[p + 1] = tile_offsets[p] + m_tiles * n_tiles;
+    max_k = std::max(max_k, prob.K);
+  }
+  const int64_t total_tiles = tile_offsets.back();
+  if (total_tiles == 0) {
+    return;
+  }
+  const int64_t tile_flops = std::max<int64_t>(
+      1, static_cast<int64_t>(config.mc) * config.nc * max_k);
+  const int64_t grain =
+      std::max<int64_t>(1, kParallelGrainSize * 16 / tile_flops);
+
+  ParallelFor(0, total_tiles, grain, [&](int64_t first, int64_t last) {
+    std::vector<MT> a_pack;
+    std::vector<MT> b_pack;
+    std::vector<MT> acc;
+    size_t p = std::upper_bound(
+                   tile_offsets.begin(), tile_offsets.end(), first) -
+               tile_offsets.begin() - 1;
+    for (int64_t t = first; t < last; ++t) {
+      while (t >= tile_offsets[p + 1]) {
+        ++p;
+      }
+      const auto& prob = problems[p];
+      const int64_t M = prob.M;
+      const int64_t K = prob.K;
+      const int64_t N = prob.N;
+      const T* x = prob.x;
+      const T* y = prob.y;
+      const int64_t xs_m =
+          prob.strided ? prob.x_strides[0] : (prob.trans_x ? 1 : K);
+      const int64_t xs_k =
+          prob.strided ? prob.x_strides[1] : (prob.trans_x ? M : 1);
+      const int64_t ys_k =
+          prob.strided ? prob.y_strides[0] : (prob.trans_y ? 1 : N);
+      const int64_t ys_n =
+          prob.strided ? prob.y_strides[1] : (prob.trans_y ? K : 1);
+      const int64_t os_m =
+          prob.strided ? prob.out_strides[0] : (prob.trans_out ? 1 : N);
+      const int64_t os_n =
+          prob.strided ? prob.out_strides[1] : (prob.trans_out ? M : 1);
+      const int64_t mc = ClampGemmBlock(config.mc, M);
+      const int64_t nc = ClampGemmBlock(config.nc, N);
+      const int64_t kc = ClampGemmBlock(config.kc, K);
+      const int64_t m_tiles = (M + mc - 1) / mc;
+      const int64_t n_tiles = (N + nc - 1) / nc;
+      a_pack.resize(mc * kc);
+      b_pack.resize(kc * nc);
+      acc.resize(mc * nc);
+
+      const int64_t local = t - tile_offsets[p];
+      const bool col_major = config.col_major_tiles;
+      const int64_t mt = col_major ? local % m_tiles : local / n_tiles;
+      const int64_t nt = col_major ? local / m_tiles : local % n_tiles;
+      const int64_t m0 = mt * mc;
+      const int64_t n0 = nt * nc;
+      const int64_t mb = std::min(mc, M - m0);
+      const int64_t nb = std::min(nc, N - n0);
+      std::fill(acc.begin(), acc.begin() + mb * nb, static_cast<MT>(0));
+      for (int64_t k0 = 0; k0 < K; k0 += kc) {
+        const int64_t kb = std::min(kc, K - k0);
+        for (int64_t i = 0; i < mb; ++i) {
+          const T* row = x + (m0 + i) * xs_m + k0 * xs_k;
+          if (xs_k == 1) {
+            ConvertElements(row, a_pack.data() + i * kb, kb);
+            continue;
+          }
+          for (int64_t k = 0; k < kb; ++k) {
+            a_pack[i * kb + k] = static_cast<MT>(row[k * xs_k]);
+          }
+        }
+        for (int64_t k = 0; k < kb; ++k) {
+          const T* row = y + (k0 + k) * ys_k + n0 * ys_n;
+          MT* dst = b_pack.data() + k * nb;
+          if (ys_n == 1) {
+            ConvertElements(row, dst, nb);
+          } else {
+            for (int64_t j = 0; j < nb; ++j) {
+              dst[j] = static_cast<MT>(row[j * ys_n]);
+            }
+          }
+        }
+        const MT* a_panel = a_pack.data();
+        const MT* b_panel = b_pack.data();
+        for (int64_t i = 0; i < mb; ++i) {
+          MT* c = acc.data() + i * nb;
+          const MT* a = a_panel + i * kb;
+          for (int64_t k = 0; k < kb; ++k) {
+            const MT a_ik = a[k];
+            const MT* b = b_panel + k * nb;
+            PD_CPU_SIMD
+            for (int64_t j = 0; j < nb; ++j) {
+              c[j] += a_ik * b[j];
+            }
+          }
+        }
+      }
+      const auto& ep = prob.epilogue;
+      for (int64_t i = 0; i < mb; ++i) {
+        const int64_t m = m0 + i;
+        const T* bias_row =
+            ep.bias == nullptr
+                ? nullptr
+                : ep.bias + (ep.bias_rows ? m % ep.bias_rows : m) *
+                                ep.bias_row_stride;
+        for (int64_t j = 0; j < nb; ++j) {
+          const int64_t n = n0 + j;
+          T* dst = &prob.out[m * os_m + n * os_n];
+          MT value = prob.alpha * acc[i * nb + j];
+          if (prob.accumulate) {
+            value += static_cast<MT>(*dst);
+          }
+          if (bias_row != nullptr) {
+            value += static_cast<MT>(bias_row[n * ep.bias_col_stride]);
+          }
+          *dst = static_cast<T>(ApplyGemmActivation(ep.act, value));
+        }
+      }
+    }
+  });
+}
+
+// Single GEMM, see GemmProblem.
+template <typename T, typename MT>
+void BlockedGemm(bool trans_x,
+                 bool trans_y,
+                 int64_t M,
+                 int64_t K,
+                 int64_t N,
+                 const T* x,
+                 const T* y,
+                 T* out,
+                 bool trans_out,
+                 MT alpha,
+                 bool accumulate,
+                 const GemmConfig& config,
+                 const GemmEpilogue<T>& epilogue = GemmEpilogue<T>()) {
+  BlockedGemmBatch<T, MT>({GemmProblem<T, MT>{trans_x,
+                                              trans_y,
+                                              M,
+                                              K,
+                                              N,
+                                              x,
+                                              y,
+                                              out,
+                                              trans_out,
+                                              alpha,
+                                              accumulate,
+                                              epilogue}},
+                          config);
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,217 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/cast.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define PD_CAST_X86 1
+#endif
+
+// The plugin is built for the baseline ISA; the x86 routines are compiled
+// for their extension with a target attribute and only called after the
+// host CPU reported it.
+
+namespace custom_kernel {
+namespace funcs {
+
+namespace {
+
+void FloatToHalfPortable(const float* src, uint16_t* dst, int64_t n) {
+  PD_CPU_SIMD
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = FloatToHalfBits(src[i]);
+  }
+}
+
+void HalfToFloatPortable(const uint16_t* src, float* dst, int64_t n) {
+  PD_CPU_SIMD
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = HalfBitsToFloat(src[i]);
+  }
+}
+
+void FloatToBfloat16Portable(const float* src, uint16_t* dst, int64_t n) {
+  PD_CPU_SIMD
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = FloatToBfloat16Bits(src[i]);
+  }
+}
+
+void Bfloat16ToFloatPortable(const uint16_t* src, float* dst, int64_t n) {
+  PD_CPU_SIMD
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = Bfloat16BitsToFloat(src[i]);
+  }
+}
+
+#ifdef PD_CAST_X86
+
+__attribute__((target("avx,f16c"))) void FloatToHalfF16c(const float* src,
+                                                         uint16_t* dst,
+                                                         int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                      _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+  }
+  for (; i < n; ++i) {
+    dst[i] = FloatToHalfBits(src[i]);
+  }
+}
+
+__attribute__((target("avx,f16c"))) void HalfToFloatF16c(const uint16_t* src,
+                                                         float* dst,
+                                                         int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i h =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  for (; i < n; ++i) {
+    dst[i] = HalfBitsToFloat(src[i]);
+  }
+}
+
+// The integer rounding of FloatToBfloat16Bits vectorizes to 8 lanes.
+__attribute__((target("avx2"))) void FloatToBfloat16Avx2(const float* src,
+                                                         uint16_t* dst,
+                                                         int64_t n) {
+  PD_CPU_SIMD
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = FloatToBfloat16Bits(src[i]);
+  }
+}
+
+__attribute__((target("avx2"))) void Bfloat16ToFloatAvx2(const uint16_t* src,
+                                                         float* dst,
+                                                         int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m256i w = _mm256_slli_epi32(_mm256_cvtepu16_epi32(b), 16);
+    _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(w));
+  }
+  for (; i < n; ++i) {
+    dst[i] = Bfloat16BitsToFloat(src[i]);
+  }
+}
+
+#if defined(__clang__) || __GNUC__ >= 10
+#define PD_CAST_AVX512BF16 1
+
+// vcvtneps2bf16 rounds to nearest even and quiets NaN, but treats float
+// subnormals as zero. A block holding one is redone with the integer
+// rounding so the result does not depend on the CPU.
+__attribute__((target("avx512f,avx512bf16"))) void FloatToBfloat16Avx512(
+    const float* src, uint16_t* dst, int64_t n) {
+  const __m512i abs_mask = _mm512_set1_epi32(0x7FFFFFFF);
+  const __m512i min_normal = _mm512_set1_epi32(0x00800000);
+  const __m512i zero = _mm512_setzero_si512();
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m512 v = _mm512_loadu_ps(src + i);
+    const __m512i magnitude =
+        _mm512_and_si512(_mm512_castps_si512(v), abs_mask);
+    const __mmask16 subnormal =
+        _mm512_cmplt_epu32_mask(magnitude, min_normal) &
+        _mm512_cmpneq_epu32_mask(magnitude, zero);
+    if (subnormal != 0) {
+      for (int j = 0; j < 16; ++j) {
+        dst[i + j] = FloatToBfloat16Bits(src[i + j]);
+      }
+      continue;
+    }
+    const __m256bh b = _mm512_cvtneps_pbh(v);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        reinterpret_cast<const __m256i&>(b));
+  }
+  for (; i < n; ++i) {
+    dst[i] = FloatToBfloat16Bits(src[i]);
+  }
+}
+#endif
+
+#endif  // PD_CAST_X86
+
+struct CastRoutines {
+  void (*float_to_half)(const float*, uint16_t*, int64_t);
+  void (*half_to_float)(const uint16_t*, float*, int64_t);
+  void (*float_to_bfloat16)(const float*, uint16_t*, int64_t);
+  void (*bfloat16_to_float)(const uint16_t*, float*, int64_t);
+  const char* name;
+};
+
+CastRoutines DetectCastRoutines() {
+  CastRoutines r{FloatToHalfPortable,
+                 HalfToFloatPortable,
+                 FloatToBfloat16Portable,
+                 Bfloat16ToFloatPortable,
+                 "portable"};
+#ifdef PD_CAST_X86
+  __builtin_cpu_init();
+  const bool f16c = __builtin_cpu_supports("avx") &&
+                    __builtin_cpu_supports("f16c");
+  const bool avx2 = __builtin_cpu_supports("avx2");
+  if (f16c) {
+    r.float_to_half = FloatToHalfF16c;
+    r.half_to_float = HalfToFloatF16c;
+    r.name = "f16c";
+  }
+  if (avx2) {
+    r.float_to_bfloat16 = FloatToBfloat16Avx2;
+    r.bfloat16_to_float = Bfloat16ToFloatAvx2;
+    r.name = f16c ? "f16c+avx2" : "avx2";
+  }
+#ifdef PD_CAST_AVX512BF16
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512bf16")) {
+    r.float_to_bfloat16 = FloatToBfloat16Avx512;
+    r.name = f16c ? "f16c+avx512bf16" : "avx512bf16";
+  }
+#endif
+#endif
+  return r;
+}
+
+const CastRoutines& HostCastRoutines() {
+  static const CastRoutines routines = DetectCastRoutines();
+  return routines;
+}
+
+}  // namespace
+
+void FloatToHalf(const float* src, uint16_t* dst, int64_t n) {
+  HostCastRoutines().float_to_half(src, dst, n);
+}
+
+void HalfToFloat(const uint16_t* src, float* dst, int64_t n) {
+  HostCastRoutines().half_to_float(src, dst, n);
+}
+
+void FloatToBfloat16(const float* src, uint16_t* dst, int64_t n) {
+  HostCastRoutines().float_to_bfloat16(src, dst, n);
+}
+
+void Bfloat16ToFloat(const uint16_t* src, float* dst, int64_t n) {
+  HostCastRoutines().bfloat16_to_float(src, dst, n);
+}
+
+const char* CastIsaName() { return HostCastRoutines().name; }
+
+}  // namespace funcs
+}  // namespace custom_kernel
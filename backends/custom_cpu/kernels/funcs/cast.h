@@ -0,0 +1,264 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "kernels/funcs/parallel.h"
+#include "paddle/phi/common/bfloat16.h"
+#include "paddle/phi/common/float16.h"
+
+// Bulk element type conversion.
+//
+// ConvertElements<Src, Dst>(src, dst, n) converts n elements on the calling
+// thread and ParallelConvert splits the same work over the thread team.
+// Kernels doing mixed-precision loads or stores call ConvertElements on the
+// block they work on instead of static_cast per element.
+//
+// float <-> float16 / bfloat16 are bulk routines picked for the host CPU
+// once (F16C for float16, AVX512-BF16 or AVX2 for bfloat16, a portable loop
+// otherwise). Every path rounds to nearest even and quiets NaNs keeping
+// the top of their payload, the same bits as the scalar FloatToHalfBits /
+// FloatToBfloat16Bits below. A pair involving a
+// 16-bit float and anything but float goes through float in small blocks.
+//
+// Floating point to integer conversions saturate: NaN becomes 0 and values
+// outside the range of the integer type become its min or max, where a
+// plain static_cast is undefined. Integer to integer conversions wrap like
+// static_cast, and any type to bool is `x != 0`.
+
+namespace custom_kernel {
+namespace funcs {
+
+inline uint32_t FloatAsBits(float f) {
+  uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+inline float BitsAsFloat(uint32_t u) {
+  float f;
+  std::memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+// Round to nearest even with correct subnormals and overflow to inf. A NaN
+// is quieted and keeps the top of its payload, like vcvtps2ph. The
+// rounding is done by the FPU on a rescaled value, so the function is
+// branch free and vectorizes.
+inline uint16_t FloatToHalfBits(float f) {
+  const float scale_to_inf = BitsAsFloat(0x77800000u);   // 2^112
+  const float scale_to_zero = BitsAsFloat(0x08800000u);  // 2^-110
+  float base = (std::fabs(f) * scale_to_inf) * scale_to_zero;
+  const uint32_t w = FloatAsBits(f);
+  const uint32_t shl1_w = w + w;
+  const uint32_t sign = w & 0x80000000u;
+  uint32_t bias = shl1_w & 0xFF000000u;
+  bias = bias < 0x71000000u ? 0x71000000u : bias;
+  base = BitsAsFloat((bias >> 1) + 0x07800000u) + base;
+  const uint32_t bits = FloatAsBits(base);
+  const uint32_t exp_bits = (bits >> 13) & 0x00007C00u;
+  const uint32_t mantissa_bits = bits & 0x00000FFFu;
+  const uint32_t nonsign = exp_bits + mantissa_bits;
+  const uint32_t nan = 0x7E00u | ((w >> 13) & 0x03FFu);
+  return static_cast<uint16_t>((sign >> 16) |
+                               (shl1_w > 0xFF000000u ? nan : nonsign));
+}
+
+inline float HalfBitsToFloat(uint16_t h) {
+  const uint32_t w = static_cast<uint32_t>(h) << 16;
+  const uint32_t sign = w & 0x80000000u;
+  const uint32_t two_w = w + w;
+  const float exp_scale = BitsAsFloat(0x07800000u);  // 2^-112
+  const float normalized =
+      BitsAsFloat((two_w >> 4) + (0xE0u << 23)) * exp_scale;
+  const float denormalized =
+      BitsAsFloat((two_w >> 17) | (126u << 23)) - 0.5f;
+  const uint32_t result =
+      sign | (two_w < (1u << 27) ? FloatAsBits(denormalized)
+                                 : FloatAsBits(normalized));
+  return BitsAsFloat(result);
+}
+
+inline uint16_t FloatToBfloat16Bits(float f) {
+  const uint32_t u = FloatAsBits(f);
+  const uint32_t rounded = u + 0x7FFFu + ((u >> 16) & 1u);
+  return static_cast<uint16_t>((u & 0x7FFFFFFFu) > 0x7F800000u
+                                   ? (u >> 16) | 0x0040u
+                                   : rounded >> 16);
+}
+
+inline float Bfloat16BitsToFloat(uint16_t b) {
+  return BitsAsFloat(static_cast<uint32_t>(b) << 16);
+}
+
+// Bulk float <-> 16-bit float, dispatched on the host CPU (cast.cc).
+void FloatToHalf(const float* src, uint16_t* dst, int64_t n);
+void HalfToFloat(const uint16_t* src, float* dst, int64_t n);
+void FloatToBfloat16(const float* src, uint16_t* dst, int64_t n);
+void Bfloat16ToFloat(const uint16_t* src, float* dst, int64_t n);
+
+// "f16c+avx512bf16", "f16c+avx2", "portable", ...
+const char* CastIsaName();
+
+template <typename T>
+struct HalfTraits {
+  static constexpr bool kIsHalf = false;
+};
+
+template <>
+struct HalfTraits<phi::dtype::float16> {
+  static constexpr bool kIsHalf = true;
+  static void ToFloat(const uint16_t* src, float* dst, int64_t n) {
+    HalfToFloat(src, dst, n);
+  }
+  static void FromFloat(const float* src, uint16_t* dst, int64_t n) {
+    FloatToHalf(src, dst, n);
+  }
+};
+
+template <>
+struct HalfTraits<phi::dtype::bfloat16> {
+  static constexpr bool kIsHalf = true;
+  static void ToFloat(const uint16_t* src, float* dst, int64_t n) {
+    Bfloat16ToFloat(src, dst, n);
+  }
+  static void FromFloat(const float* src, uint16_t* dst, int64_t n) {
+    FloatToBfloat16(src, dst, n);
+  }
+};
+
+template <typename Dst, typename Src>
+inline Dst ValueCast(Src v, std::false_type /*saturate*/) {
+  return static_cast<Dst>(v);
+}
+
+template <typename Dst, typename Src>
+inline Dst ValueCast(Src v, std::true_type /*saturate*/) {
+  // the bounds are powers of two or small, exact in Src; a value equal to
+  // the rounded-up max (2^31 for int32 from float) already overflows
+  const Src lo = static_cast<Src>(std::numeric_limits<Dst>::lowest());
+  const Src hi = static_cast<Src>(std::numeric_limits<Dst>::max());
+  const Dst clamped = v >= hi ? std::numeric_limits<Dst>::max()
+                              : (v <= lo ? std::numeric_limits<Dst>::lowest()
+                                         : static_cast<Dst>(v));
+  return v != v ? Dst(0) : clamped;
+}
+
+template <typename Dst, typename Src>
+inline Dst ValueCast(Src v) {
+  using Saturate = std::integral_constant<
+      bool,
+      std::is_floating_point<Src>::value && std::is_integral<Dst>::value &&
+          !std::is_same<Dst, bool>::value>;
+  return ValueCast<Dst>(v, Saturate());
+}
+
+// Elements of a 16-bit float pair converted through float at a time; the
+// staging buffer stays in L1.
+constexpr int64_t kCastBlock = 256;
+
+template <typename Src,
+          typename Dst,
+          bool kSrcHalf = HalfTraits<Src>::kIsHalf,
+          bool kDstHalf = HalfTraits<Dst>::kIsHalf>
+struct ElementConverter {
+  static void Run(const Src* src, Dst* dst, int64_t n) {
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < n; ++i) {
+      dst[i] = ValueCast<Dst>(src[i]);
+    }
+  }
+};
+
+template <typename Src, typename Dst>
+struct ElementConverter<Src, Dst, true, false> {
+  static void Run(const Src* src, Dst* dst, int64_t n) {
+    auto bits = reinterpret_cast<const uint16_t*>(src);
+    if (std::is_same<Dst, float>::value) {
+      HalfTraits<Src>::ToFloat(bits, reinterpret_cast<float*>(dst), n);
+      return;
+    }
+    float buffer[kCastBlock];
+    for (int64_t i = 0; i < n; i += kCastBlock) {
+      const int64_t len = std::min(kCastBlock, n - i);
+      HalfTraits<Src>::ToFloat(bits + i, buffer, len);
+      ElementConverter<float, Dst>::Run(buffer, dst + i, len);
+    }
+  }
+};
+
+template <typename Src, typename Dst>
+struct ElementConverter<Src, Dst, false, true> {
+  static void Run(const Src* src, Dst* dst, int64_t n) {
+    auto bits = reinterpret_cast<uint16_t*>(dst);
+    if (std::is_same<Src, float>::value) {
+      HalfTraits<Dst>::FromFloat(reinterpret_cast<const float*>(src), bits, n);
+      return;
+    }
+    float buffer[kCastBlock];
+    for (int64_t i = 0; i < n; i += kCastBlock) {
+      const int64_t len = std::min(kCastBlock, n - i);
+      ElementConverter<Src, float>::Run(src + i, buffer, len);
+      HalfTraits<Dst>::FromFloat(buffer, bits + i, len);
+    }
+  }
+};
+
+template <typename Src, typename Dst>
+struct ElementConverter<Src, Dst, true, true> {
+  static void Run(const Src* src, Dst* dst, int64_t n) {
+    if (std::is_same<Src, Dst>::value) {
+      std::memcpy(dst, src, n * sizeof(Dst));
+      return;
+    }
+    float buffer[kCastBlock];
+    for (int64_t i = 0; i < n; i += kCastBlock) {
+      const int64_t len = std::min(kCastBlock, n - i);
+      HalfTraits<Src>::ToFloat(
+          reinterpret_cast<const uint16_t*>(src) + i, buffer, len);
+      HalfTraits<Dst>::FromFloat(
+          buffer, reinterpret_cast<uint16_t*>(dst) + i, len);
+    }
+  }
+};
+
+template <typename Src, typename Dst>
+inline void ConvertElements(const Src* src, Dst* dst, int64_t n) {
+  if (std::is_same<Src, Dst>::value) {
+    if (static_cast<const void*>(src) != static_cast<void*>(dst)) {
+      std::memcpy(dst, src, n * sizeof(Dst));
+    }
+    return;
+  }
+  ElementConverter<Src, Dst>::Run(src, dst, n);
+}
+
+template <typename Src, typename Dst>
+void ParallelConvert(const Src* src, Dst* dst, int64_t n) {
+  const int64_t grain = std::max<int64_t>(
+      1, kParallelCopyGrainBytes / std::max(sizeof(Src), sizeof(Dst)));
+  ParallelFor(0, n, grain, [&](int64_t begin, int64_t end) {
+    ConvertElements(src + begin, dst + begin, end - begin);
+  });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
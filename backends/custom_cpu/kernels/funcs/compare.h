@@ -0,0 +1,394 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+// Elementwise comparisons with broadcasting done by strides, and packed
+// bit masks.
+//
+// The operands are never expanded: the output shape is reduced to the
+// fewest dims that keep the broadcast pattern, and each innermost run reads
+// x and y either contiguously or as a repeated scalar, four loop shapes the
+// compiler vectorizes into compare-and-pack instructions.
+//
+// A PackedMask holds one bit per element, 64 per word. masked_select and
+// nonzero count set bits with popcount and walk them with count-trailing-
+// zeros, so all-false words cost one test instead of 64 byte loads.
+
+namespace custom_kernel {
+namespace funcs {
+
+template <typename T, bool kFloat = std::is_floating_point<T>::value>
+struct EqualFunctor {
+  bool operator()(const T a, const T b) const { return a == b; }
+};
+
+// as the other phi CPU kernels, floats compare equal within 1e-8
+template <typename T>
+struct EqualFunctor<T, true> {
+  bool operator()(const T a, const T b) const {
+    return std::fabs(static_cast<double>(a - b)) < 1e-8;
+  }
+};
+
+template <typename T>
+struct NotEqualFunctor {
+  bool operator()(const T a, const T b) const {
+    return !EqualFunctor<T>()(a, b);
+  }
+};
+
+template <typename T>
+struct LessThanFunctor {
+  bool operator()(const T a, const T b) const { return a < b; }
+};
+
+template <typename T>
+struct LessEqualFunctor {
+  bool operator()(const T a, const T b) const { return a <= b; }
+};
+
+template <typename T>
+struct GreaterThanFunctor {
+  bool operator()(const T a, const T b) const { return a > b; }
+};
+
+template <typename T>
+struct GreaterEqualFunctor {
+  bool operator()(const T a, const T b) const { return a >= b; }
+};
+
+// The dims of an operand placed against the output as phi::BroadcastTo
+// does: at `axis`, or right-aligned when axis is -1. `axis` only applies to
+// the operand of lower rank; the full-rank one is returned as is.
+inline std::vector<int64_t> AlignBroadcastDims(
+    const std::vector<int64_t>& dims, int64_t out_rank, int axis) {
+  const int64_t rank = static_cast<int64_t>(dims.size());
+  const int64_t lead = axis == -1 || rank == out_rank ? out_rank - rank : axis;
+  PD_CHECK(lead >= 0 && lead + rank <= out_rank,
+           "The axis %d of a broadcast puts an operand of rank %d outside "
+           "the output of rank %d.",
+           axis,
+           static_cast<int>(rank),
+           static_cast<int>(out_rank));
+  std::vector<int64_t> aligned(out_rank, 1);
+  for (int64_t i = 0; i < rank; ++i) {
+    aligned[lead + i] = dims[i];
+  }
+  return aligned;
+}
+
+// The output of a broadcast binary op with adjacent dims of the same
+// broadcast pattern merged. Strides are 0 along the dims an operand is
+// broadcast over.
+struct BroadcastShape {
+  std::vector<int64_t> dims;
+  std::vector<int64_t> x_strides;
+  std::vector<int64_t> y_strides;
+  int64_t numel = 1;
+};
+
+// `x_dims` and `y_dims` have the rank of `out_dims` (AlignBroadcastDims).
+inline BroadcastShape GetBroadcastShape(const std::vector<int64_t>& out_dims,
+                                        const std::vector<int64_t>& x_dims,
+                                        const std::vector<int64_t>& y_dims) {
+  BroadcastShape shape;
+  int last_pattern = -1;
+  for (size_t i = 0; i < out_dims.size(); ++i) {
+    shape.numel *= out_dims[i];
+    if (out_dims[i] == 1) {
+      continue;
+    }
+    const int pattern = (x_dims[i] == 1 ? 1 : 0) | (y_dims[i] == 1 ? 2 : 0);
+    if (pattern == last_pattern) {
+      shape.dims.back() *= out_dims[i];
+    } else {
+      shape.dims.push_back(out_dims[i]);
+      shape.x_strides.push_back(pattern & 1 ? 0 : 1);
+      shape.y_strides.push_back(pattern & 2 ? 0 : 1);
+      last_pattern = pattern;
+    }
+  }
+  if (shape.dims.empty()) {
+    shape.dims.push_back(1);
+    shape.x_strides.push_back(0);
+    shape.y_strides.push_back(0);
+  }
+  // 0 / 1 flags -> element strides, innermost first
+  int64_t x_step = 1;
+  int64_t y_step = 1;
+  for (int64_t d = static_cast<int64_t>(shape.dims.size()) - 1; d >= 0; --d) {
+    const bool x_moves = shape.x_strides[d] != 0;
+    const bool y_moves = shape.y_strides[d] != 0;
+    shape.x_strides[d] = x_moves ? x_step : 0;
+    shape.y_strides[d] = y_moves ? y_step : 0;
+    x_step *= x_moves ? shape.dims[d] : 1;
+    y_step *= y_moves ? shape.dims[d] : 1;
+  }
+  return shape;
+}
+
+// Calls f(x_offset, y_offset, n, out_offset) for the runs along the
+// innermost dim that cover [first, last) of the output.
+template <typename Func>
+void ForEachBroadcastRun(const BroadcastShape& shape,
+                         int64_t first,
+                         int64_t last,
+                         const Func& f) {
+  const int64_t rank = static_cast<int64_t>(shape.dims.size());
+  std::vector<int64_t> index(rank);
+  int64_t rest = first;
+  for (int64_t d = rank - 1; d >= 0; --d) {
+    index[d] = rest % shape.dims[d];
+    rest /= shape.dims[d];
+  }
+  int64_t pos = first;
+  while (pos < last) {
+    int64_t x_offset = 0;
+    int64_t y_offset = 0;
+    for (int64_t d = 0; d < rank; ++d) {
+      x_offset += index[d] * shape.x_strides[d];
+      y_offset += index[d] * shape.y_strides[d];
+    }
+    const int64_t n = std::min(shape.dims[rank - 1] - index[rank - 1],
+                               last - pos);
+    f(x_offset, y_offset, n, pos);
+    pos += n;
+    index[rank - 1] += n;
+    for (int64_t d = rank - 1; d > 0 && index[d] == shape.dims[d]; --d) {
+      index[d] = 0;
+      ++index[d - 1];
+    }
+  }
+}
+
+// out[i] = cmp(x[i * x_step], y[i * y_step]), steps 0 or 1
+template <typename T, typename Functor>
+inline void CompareRun(const T* x,
+                       int64_t x_step,
+                       const T* y,
+                       int64_t y_step,
+                       int64_t n,
+                       bool* out) {
+  const Functor cmp;
+  if (x_step != 0 && y_step != 0) {
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < n; ++i) {
+      out[i] = cmp(x[i], y[i]);
+    }
+  } else if (x_step != 0) {
+    const T b = y[0];
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < n; ++i) {
+      out[i] = cmp(x[i], b);
+    }
+  } else if (y_step != 0) {
+    const T a = x[0];
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < n; ++i) {
+      out[i] = cmp(a, y[i]);
+    }
+  } else {
+    const bool v = cmp(x[0], y[0]);
+    std::fill(out, out + n, v);
+  }
+}
+
+template <typename T, typename Functor>
+void Compare(const T* x, const T* y, const BroadcastShape& shape, bool* out) {
+  const int64_t x_step = shape.x_strides.back();
+  const int64_t y_step = shape.y_strides.back();
+  ParallelFor(0, shape.numel, kParallelGrainSize, [&](int64_t b, int64_t e) {
+    ForEachBroadcastRun(
+        shape, b, e, [&](int64_t xo, int64_t yo, int64_t n, int64_t oo) {
+          CompareRun<T, Functor>(x + xo, x_step, y + yo, y_step, n, out + oo);
+        });
+  });
+}
+
+struct PackedMask {
+  int64_t size = 0;
+  std::vector<uint64_t> words;
+
+  void Resize(int64_t n) {
+    size = n;
+    words.assign((n + 63) / 64, 0);
+  }
+};
+
+// Bits of `n` flags, n <= 64 * words; the bits past n are zero.
+inline void PackBits(const bool* flags, int64_t n, uint64_t* words) {
+  for (int64_t w = 0; w * 64 < n; ++w) {
+    const bool* f = flags + w * 64;
+    const int64_t len = std::min<int64_t>(64, n - w * 64);
+    uint64_t bits = 0;
+    for (int64_t j = 0; j < len; ++j) {
+      bits |= static_cast<uint64_t>(f[j]) << j;
+    }
+    words[w] = bits;
+  }
+}
+
+// Flags go through a tile of this many bytes on the stack, a multiple of
+// 64 so tiles start on word boundaries.
+constexpr int64_t kMaskTile = 2048;
+
+template <typename Func>
+void ParallelMaskTiles(int64_t numel, PackedMask* mask, const Func& fill) {
+  mask->Resize(numel);
+  const int64_t num_tiles = (numel + kMaskTile - 1) / kMaskTile;
+  const int64_t grain =
+      std::max<int64_t>(1, kParallelGrainSize / kMaskTile);
+  ParallelFor(0, num_tiles, grain, [&](int64_t begin, int64_t end) {
+    bool tile[kMaskTile];
+    for (int64_t t = begin; t < end; ++t) {
+      const int64_t first = t * kMaskTile;
+      const int64_t n = std::min(kMaskTile, numel - first);
+      fill(first, n, tile);
+      PackBits(tile, n, mask->words.data() + first / 64);
+    }
+  });
+}
+
+// The comparison as a packed mask, without a bool tensor in between.
+template <typename T, typename Functor>
+void CompareBits(const T* x,
+                 const T* y,
+                 const BroadcastShape& shape,
+                 PackedMask* mask) {
+  const int64_t x_step = shape.x_strides.back();
+  const int64_t y_step = shape.y_strides.back();
+  ParallelMaskTiles(
+      shape.numel, mask, [&](int64_t first, int64_t n, bool* tile) {
+        ForEachBroadcastRun(
+            shape,
+            first,
+            first + n,
+            [&](int64_t xo, int64_t yo, int64_t len, int64_t oo) {
+              CompareRun<T, Functor>(
+                  x + xo, x_step, y + yo, y_step, len, tile + (oo - first));
+            });
+      });
+}
+
+inline void PackBoolMask(const bool* flags, int64_t n, PackedMask* mask) {
+  ParallelMaskTiles(n, mask, [&](int64_t first, int64_t len, bool* tile) {
+    std::copy(flags + first, flags + first + len, tile);
+  });
+}
+
+// Bits of a bool operand read through the y side of `shape`, so a mask
+// broadcast against x is packed without expanding it first.
+inline void PackBroadcastMask(const bool* flags,
+                              const BroadcastShape& shape,
+                              PackedMask* mask) {
+  const int64_t step = shape.y_strides.back();
+  ParallelMaskTiles(
+      shape.numel, mask, [&](int64_t first, int64_t n, bool* tile) {
+        ForEachBroadcastRun(
+            shape,
+            first,
+            first + n,
+            [&](int64_t, int64_t yo, int64_t len, int64_t oo) {
+              bool* t = tile + (oo - first);
+              if (step != 0) {
+                std::copy(flags + yo, flags + yo + len, t);
+              } else {
+                std::fill(t, t + len, flags[yo]);
+              }
+            });
+      });
+}
+
+// Offset in an operand with `strides` (from GetBroadcastShape) of output
+// element `index`.
+inline int64_t BroadcastOffset(const BroadcastShape& shape,
+                               const std::vector<int64_t>& strides,
+                               int64_t index) {
+  int64_t offset = 0;
+  for (int64_t d = static_cast<int64_t>(shape.dims.size()) - 1; d >= 0; --d) {
+    offset += index % shape.dims[d] * strides[d];
+    index /= shape.dims[d];
+  }
+  return offset;
+}
+
+inline int Popcount(uint64_t word) { return __builtin_popcountll(word); }
+
+// Set bits of a mask split into blocks of kMaskScanWords words; offsets[b]
+// is the number of set bits before block b, offsets.back() the total.
+constexpr int64_t kMaskScanWords = 512;
+
+struct MaskScan {
+  std::vector<int64_t> offsets;
+
+  int64_t count() const { return offsets.back(); }
+};
+
+inline MaskScan ScanMask(const PackedMask& mask) {
+  const int64_t num_words = static_cast<int64_t>(mask.words.size());
+  const int64_t num_blocks = (num_words + kMaskScanWords - 1) / kMaskScanWords;
+  MaskScan scan;
+  scan.offsets.assign(num_blocks + 1, 0);
+  ParallelFor(0, num_blocks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; ++b) {
+      const int64_t w_end = std::min(num_words, (b + 1) * kMaskScanWords);
+      int64_t count = 0;
+      for (int64_t w = b * kMaskScanWords; w < w_end; ++w) {
+        count += Popcount(mask.words[w]);
+      }
+      scan.offsets[b + 1] = count;
+    }
+  });
+  for (int64_t b = 0; b < num_blocks; ++b) {
+    scan.offsets[b + 1] += scan.offsets[b];
+  }
+  return scan;
+}
+
+// Calls f(index, position) for every set bit, position being its rank
+// among the set bits, so outputs can be written in parallel in order.
+template <typename Func>
+void ForEachSetBit(const PackedMask& mask,
+                   const MaskScan& scan,
+                   const Func& f) {
+  const int64_t num_words = static_cast<int64_t>(mask.words.size());
+  const int64_t num_blocks = static_cast<int64_t>(scan.offsets.size()) - 1;
+  ParallelFor(0, num_blocks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; ++b) {
+      int64_t position = scan.offsets[b];
+      const int64_t w_end = std::min(num_words, (b + 1) * kMaskScanWords);
+      for (int64_t w = b * kMaskScanWords; w < w_end; ++w) {
+        uint64_t bits = mask.words[w];
+        while (bits != 0) {
+          f(w * 64 + __builtin_ctzll(bits), position++);
+          bits &= bits - 1;
+        }
+      }
+    }
+  });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
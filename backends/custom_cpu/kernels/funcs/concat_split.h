@@ -0,0 +1,160 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+
+// Concat, split, stack and unbind all move the parts of a tensor along one
+// axis. With outer = prod(dims[:axis]) and inner = prod(dims[axis + 1:]),
+// the whole tensor is `outer` rows, each the concatenation of one row of
+// every part, part k contributing axis_size_k * inner elements ("width").
+// All sizes are int64_t, a tensor may have more than 2^31 elements.
+
+namespace custom_kernel {
+namespace funcs {
+
+struct PartsShape {
+  int64_t outer = 1;
+  // elements of each part in one row
+  std::vector<int64_t> widths;
+  // prefix sums of widths, offsets of the parts in a row
+  std::vector<int64_t> offsets;
+
+  int64_t row_width() const { return offsets.back(); }
+};
+
+// `dims` is the shape of the whole tensor and `axis_sizes` the extent of
+// every part along `axis`; a stacked part has extent 1.
+inline PartsShape GetPartsShape(const std::vector<int64_t>& dims,
+                                int64_t axis,
+                                const std::vector<int64_t>& axis_sizes) {
+  PartsShape shape;
+  int64_t inner = 1;
+  for (int64_t i = 0; i < static_cast<int64_t>(dims.size()); ++i) {
+    if (i < axis) {
+      shape.outer *= dims[i];
+    } else if (i > axis) {
+      inner *= dims[i];
+    }
+  }
+  shape.offsets.assign(1, 0);
+  for (auto size : axis_sizes) {
+    shape.widths.push_back(size * inner);
+    shape.offsets.push_back(shape.offsets.back() + size * inner);
+  }
+  return shape;
+}
+
+// Copies below this many bytes are an inline loop, the call into memcpy
+// costs more than the copy for the narrow rows of a concat along an inner
+// axis.
+constexpr int64_t kInlineCopyBytes = 256;
+
+template <typename T>
+inline void CopyElements(T* dst, const T* src, int64_t n) {
+  if (n * static_cast<int64_t>(sizeof(T)) < kInlineCopyBytes) {
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < n; ++i) {
+      dst[i] = src[i];
+    }
+  } else {
+    std::memcpy(dst, src, n * sizeof(T));
+  }
+}
+
+// Calls f(part, row, begin, end, whole_offset) for the pieces of part rows
+// that cover [first, last) of the whole tensor, [begin, end) being columns
+// of the part row and whole_offset the position of `begin` in the whole.
+template <typename Func>
+void ForEachPartSegment(const PartsShape& shape,
+                        int64_t first,
+                        int64_t last,
+                        const Func& f) {
+  const int64_t width = shape.row_width();
+  const int64_t num_parts = static_cast<int64_t>(shape.widths.size());
+  int64_t row = first / width;
+  int64_t col = first % width;
+  int64_t k = std::upper_bound(shape.offsets.cbegin() + 1,
+                               shape.offsets.cend(),
+                               col) -
+              shape.offsets.cbegin() - 1;
+  int64_t pos = first;
+  while (pos < last) {
+    const int64_t part_end = shape.offsets[k + 1];
+    const int64_t seg_end = std::min(part_end, col + (last - pos));
+    if (seg_end > col) {
+      f(k, row, col - shape.offsets[k], seg_end - shape.offsets[k], pos);
+      pos += seg_end - col;
+      col = seg_end;
+    }
+    if (col == part_end) {
+      ++k;
+      if (k == num_parts) {
+        k = 0;
+        col = 0;
+        ++row;
+      }
+    }
+  }
+}
+
+// The whole tensor is split into one contiguous range per thread, so the
+// work is balanced whatever the number and widths of the parts.
+template <typename T, typename Func>
+void ParallelPartSegments(const PartsShape& shape, const Func& f) {
+  const int64_t numel = shape.outer * shape.row_width();
+  const int64_t grain =
+      std::max<int64_t>(1, kParallelCopyGrainBytes / sizeof(T));
+  ParallelFor(0, numel, grain, [&](int64_t first, int64_t last) {
+    ForEachPartSegment(shape, first, last, f);
+  });
+}
+
+// parts[k] (outer x widths[k], row major) -> whole (outer x row_width)
+template <typename T>
+void ConcatParts(const std::vector<const T*>& parts,
+                 const PartsShape& shape,
+                 T* whole) {
+  ParallelPartSegments<T>(
+      shape,
+      [&](int64_t k, int64_t row, int64_t begin, int64_t end, int64_t pos) {
+        CopyElements(
+            whole + pos, parts[k] + row * shape.widths[k] + begin, end - begin);
+      });
+}
+
+// whole -> parts[k]; a null part is skipped (an input without gradient).
+template <typename T>
+void SplitParts(const T* whole,
+                const PartsShape& shape,
+                const std::vector<T*>& parts) {
+  ParallelPartSegments<T>(
+      shape,
+      [&](int64_t k, int64_t row, int64_t begin, int64_t end, int64_t pos) {
+        if (parts[k] != nullptr) {
+          CopyElements(parts[k] + row * shape.widths[k] + begin,
+                       whole + pos,
+                       end - begin);
+        }
+      });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,398 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+
+// Detection post-processing: greedy NMS and ROI align.
+//
+// Greedy NMS keeps boxes in score order and drops every later box whose
+// IoU with a kept box exceeds the threshold. Boxes that overlap must
+// overlap along x, so the candidates are also sorted by x1: a kept box
+// only tests the window of boxes with x1 in [x1 - max_width, x2], with the
+// IoU of the whole window computed in one vectorized pass. Far-apart
+// proposals then cost O(n log n) instead of O(n^2). An adaptive threshold
+// (eta < 1) compares each candidate with the boxes kept so far instead,
+// exactly as Paddle's reference does.
+//
+// ROI align samples a grid of bilinear points per bin. The sample rows
+// only depend on (ph, iy) and the columns on (pw, ix), so every ROI gets
+// one table per axis, shared by all channels. The sum over a bin is then
+// separable: each input row a sample reads is first reduced along x per
+// bin column and cached, and bins blend those row sums. The backward runs
+// the same steps transposed, one (image, channel) plane per task with its
+// ROIs in order, which keeps the accumulation deterministic.
+
+namespace custom_kernel {
+namespace funcs {
+
+// Paddle's JaccardOverlap; unnormalized boxes count pixels inclusively.
+template <typename T>
+inline T BoxArea(const T* box, bool normalized) {
+  if (box[2] < box[0] || box[3] < box[1]) {
+    return 0;
+  }
+  const T off = normalized ? 0 : 1;
+  return (box[2] - box[0] + off) * (box[3] - box[1] + off);
+}
+
+template <typename T>
+inline T BoxIoU(const T* a, const T* b, bool normalized) {
+  if (b[0] > a[2] || b[2] < a[0] || b[1] > a[3] || b[3] < a[1]) {
+    return 0;
+  }
+  const T off = normalized ? 0 : 1;
+  const T w = std::min(a[2], b[2]) - std::max(a[0], b[0]) + off;
+  const T h = std::min(a[3], b[3]) - std::max(a[1], b[1]) + off;
+  const T inter = w * h;
+  return inter / (BoxArea(a, normalized) + BoxArea(b, normalized) - inter);
+}
+
+// Greedy NMS over boxes [*, 4] (x1, y1, x2, y2) visited in `order`;
+// returns the kept box indices in the order they were kept.
+template <typename T>
+std::vector<int64_t> GreedyNms(const T* boxes,
+                               const std::vector<int64_t>& order,
+                               float threshold,
+                               bool normalized,
+                               float eta = 1.0f) {
+  const int64_t n = static_cast<int64_t>(order.size());
+  std::vector<int64_t> kept;
+  bool finite = true;
+  for (int64_t i = 0; i < n && finite; ++i) {
+    const T* b = boxes + order[i] * 4;
+    finite = std::isfinite(b[0]) && std::isfinite(b[1]) &&
+             std::isfinite(b[2]) && std::isfinite(b[3]);
+  }
+  if (eta < 1.0f || threshold < 0.0f || !finite) {
+    T adaptive = static_cast<T>(threshold);
+    for (int64_t i = 0; i < n; ++i) {
+      const T* box = boxes + order[i] * 4;
+      bool keep = true;
+      for (size_t k = 0; k < kept.size() && keep; ++k) {
+        keep = BoxIoU(box, boxes + kept[k] * 4, normalized) <= adaptive;
+      }
+      if (keep) {
+        kept.push_back(order[i]);
+        if (eta < 1.0f && adaptive > static_cast<T>(0.5)) {
+          adaptive *= static_cast<T>(eta);
+        }
+      }
+    }
+    return kept;
+  }
+
+  // Candidates sorted by x1 (rank breaks ties), as structure of arrays.
+  std::vector<int64_t> by_x(n);
+  std::iota(by_x.begin(), by_x.end(), 0);
+  std::stable_sort(by_x.begin(), by_x.end(), [&](int64_t a, int64_t b) {
+    return boxes[order[a] * 4] < boxes[order[b] * 4];
+  });
+  std::vector<T> x1(n), y1(n), x2(n), y2(n), area(n), iou(n);
+  std::vector<int64_t> rank(n), pos(n);
+  T max_width = 0;
+  for (int64_t p = 0; p < n; ++p) {
+    const T* b = boxes + order[by_x[p]] * 4;
+    x1[p] = b[0];
+    y1[p] = b[1];
+    x2[p] = b[2];
+    y2[p] = b[3];
+    area[p] = BoxArea(b, normalized);
+    rank[p] = by_x[p];
+    pos[by_x[p]] = p;
+    max_width = std::max(max_width, b[2] - b[0]);
+  }
+  const T off = normalized ? 0 : 1;
+  const T thr = static_cast<T>(threshold);
+  std::vector<uint8_t> suppressed(n, 0);
+  for (int64_t i = 0; i < n; ++i) {
+    if (suppressed[i]) {
+      continue;
+    }
+    kept.push_back(order[i]);
+    const int64_t p = pos[i];
+    const T ax1 = x1[p], ay1 = y1[p], ax2 = x2[p], ay2 = y2[p];
+    const T a_area = area[p];
+    const int64_t lo =
+        std::lower_bound(x1.begin(), x1.end(), ax1 - max_width) - x1.begin();
+    const int64_t hi =
+        std::upper_bound(x1.begin(), x1.end(), ax2) - x1.begin();
+    T* out = iou.data();
+    PD_CPU_SIMD
+    for (int64_t q = lo; q < hi; ++q) {
+      const bool apart =
+          x1[q] > ax2 || x2[q] < ax1 || y1[q] > ay2 || y2[q] < ay1;
+      const T w = std::min(ax2, x2[q]) - std::max(ax1, x1[q]) + off;
+      const T h = std::min(ay2, y2[q]) - std::max(ay1, y1[q]) + off;
+      const T inter = w * h;
+      out[q] = apart ? T(0) : inter / (a_area + area[q] - inter);
+    }
+    for (int64_t q = lo; q < hi; ++q) {
+      if (rank[q] > i && out[q] > thr) {
+        suppressed[rank[q]] = 1;
+      }
+    }
+  }
+  return kept;
+}
+
+// Sample positions of one axis of an ROI: bin b reads the sample points
+// s < grid at rows (or columns) lo/hi with weights w_lo/w_hi, zero for
+// samples outside [-1, size].
+template <typename T>
+struct RoiAlignAxis {
+  int64_t grid = 1;
+  std::vector<int64_t> lo, hi;
+  std::vector<T> w_lo, w_hi;
+};
+
+template <typename T>
+RoiAlignAxis<T> MakeRoiAlignAxis(
+    T start, T bin, int64_t pooled, int64_t grid, int64_t size) {
+  RoiAlignAxis<T> axis;
+  axis.grid = grid;
+  const int64_t n = pooled * grid;
+  axis.lo.resize(n);
+  axis.hi.resize(n);
+  axis.w_lo.resize(n);
+  axis.w_hi.resize(n);
+  for (int64_t b = 0; b < pooled; ++b) {
+    for (int64_t s = 0; s < grid; ++s) {
+      const int64_t i = b * grid + s;
+      T v = start + b * bin +
+            static_cast<T>(s + .5f) * bin / static_cast<T>(grid);
+      if (v < -1.0 || v > size) {
+        axis.lo[i] = axis.hi[i] = 0;
+        axis.w_lo[i] = axis.w_hi[i] = 0;
+        continue;
+      }
+      v = std::max(v, T(0));
+      int64_t lo = static_cast<int64_t>(v);
+      int64_t hi = lo + 1;
+      if (lo >= size - 1) {
+        lo = hi = size - 1;
+        v = static_cast<T>(lo);
+      }
+      const T l = v - lo;
+      axis.lo[i] = lo;
+      axis.hi[i] = hi;
+      axis.w_lo[i] = 1 - l;
+      axis.w_hi[i] = l;
+    }
+  }
+  return axis;
+}
+
+struct RoiAlignShape {
+  int64_t channels = 0;
+  int64_t height = 0;
+  int64_t width = 0;
+  int64_t pooled_h = 0;
+  int64_t pooled_w = 0;
+  float spatial_scale = 1.0f;
+  int sampling_ratio = -1;
+  bool aligned = false;
+};
+
+template <typename T>
+struct RoiAlignGeometry {
+  RoiAlignAxis<T> y, x;
+  T count = 1;
+};
+
+template <typename T>
+RoiAlignGeometry<T> MakeRoiAlignGeometry(const RoiAlignShape& s,
+                                         const T* box) {
+  const T offset = s.aligned ? T(0.5) : T(0);
+  const T x0 = box[0] * s.spatial_scale - offset;
+  const T y0 = box[1] * s.spatial_scale - offset;
+  T roi_w = box[2] * s.spatial_scale - offset - x0;
+  T roi_h = box[3] * s.spatial_scale - offset - y0;
+  if (!s.aligned) {
+    roi_w = std::max(roi_w, T(1));
+    roi_h = std::max(roi_h, T(1));
+  }
+  const T bin_h = roi_h / s.pooled_h;
+  const T bin_w = roi_w / s.pooled_w;
+  const int64_t grid_h = s.sampling_ratio > 0
+                             ? s.sampling_ratio
+                             : static_cast<int64_t>(std::ceil(bin_h));
+  const int64_t grid_w = s.sampling_ratio > 0
+                             ? s.sampling_ratio
+                             : static_cast<int64_t>(std::ceil(bin_w));
+  RoiAlignGeometry<T> g;
+  g.y = MakeRoiAlignAxis<T>(y0, bin_h, s.pooled_h, grid_h, s.height);
+  g.x = MakeRoiAlignAxis<T>(x0, bin_w, s.pooled_w, grid_w, s.width);
+  g.count = static_cast<T>(std::max<int64_t>(grid_h * grid_w, 1));
+  return g;
+}
+
+// Row r of a plane reduced along x per bin column, cached per plane.
+template <typename T>
+class RoiAlignRows {
+ public:
+  RoiAlignRows(int64_t height, int64_t pooled_w)
+      : pooled_w_(pooled_w), sums_(height * pooled_w), stamp_(height, -1) {}
+
+  const T* Get(const RoiAlignAxis<T>& x,
+               const T* plane,
+               int64_t width,
+               int64_t r,
+               int64_t key) {
+    T* sum = sums_.data() + r * pooled_w_;
+    if (stamp_[r] == key) {
+      return sum;
+    }
+    stamp_[r] = key;
+    const T* row = plane + r * width;
+    for (int64_t b = 0; b < pooled_w_; ++b) {
+      T acc = 0;
+      for (int64_t s = b * x.grid; s < (b + 1) * x.grid; ++s) {
+        acc += x.w_lo[s] * row[x.lo[s]] + x.w_hi[s] * row[x.hi[s]];
+      }
+      sum[b] = acc;
+    }
+    return sum;
+  }
+
+ private:
+  int64_t pooled_w_;
+  std::vector<T> sums_;
+  std::vector<int64_t> stamp_;
+};
+
+// x: [N, C, H, W], boxes: [R, 4], batch_ids: [R] -> out: [R, C, ph, pw].
+template <typename T>
+void RoiAlignForward(const RoiAlignShape& s,
+                     const T* x,
+                     const T* boxes,
+                     const std::vector<int64_t>& batch_ids,
+                     T* out) {
+  const int64_t rois = static_cast<int64_t>(batch_ids.size());
+  const int64_t plane = s.height * s.width;
+  const int64_t bins = s.pooled_h * s.pooled_w;
+  const int64_t grain = std::max<int64_t>(1, kParallelGrainSize / (bins * 4));
+  ParallelFor(0, rois * s.channels, grain, [&](int64_t b, int64_t e) {
+    RoiAlignRows<T> rows(s.height, s.pooled_w);
+    RoiAlignGeometry<T> g;
+    int64_t roi = -1;
+    for (int64_t task = b; task < e; ++task) {
+      if (task / s.channels != roi) {
+        roi = task / s.channels;
+        g = MakeRoiAlignGeometry<T>(s, boxes + roi * 4);
+      }
+      const int64_t c = task % s.channels;
+      const T* src = x + (batch_ids[roi] * s.channels + c) * plane;
+      T* dst = out + task * bins;
+      std::fill(dst, dst + bins, T(0));
+      for (int64_t ph = 0; ph < s.pooled_h; ++ph) {
+        T* bin = dst + ph * s.pooled_w;
+        for (int64_t i = ph * g.y.grid; i < (ph + 1) * g.y.grid; ++i) {
+          const T* lo = rows.Get(g.x, src, s.width, g.y.lo[i], task);
+          const T wl = g.y.w_lo[i];
+          for (int64_t pw = 0; pw < s.pooled_w; ++pw) {
+            bin[pw] += wl * lo[pw];
+          }
+          const T* hi = rows.Get(g.x, src, s.width, g.y.hi[i], task);
+          const T wh = g.y.w_hi[i];
+          for (int64_t pw = 0; pw < s.pooled_w; ++pw) {
+            bin[pw] += wh * hi[pw];
+          }
+        }
+      }
+      for (int64_t i = 0; i < bins; ++i) {
+        dst[i] /= g.count;
+      }
+    }
+  });
+}
+
+template <typename T>
+void RoiAlignBackward(const RoiAlignShape& s,
+                      const T* boxes,
+                      const std::vector<int64_t>& batch_ids,
+                      int64_t batch,
+                      const T* out_grad,
+                      T* x_grad) {
+  const int64_t rois = static_cast<int64_t>(batch_ids.size());
+  const int64_t plane = s.height * s.width;
+  const int64_t bins = s.pooled_h * s.pooled_w;
+  std::vector<std::vector<int64_t>> rois_of(batch);
+  for (int64_t r = 0; r < rois; ++r) {
+    rois_of[batch_ids[r]].push_back(r);
+  }
+  std::vector<RoiAlignGeometry<T>> geometry(rois);
+  ParallelFor(0, rois, 1, [&](int64_t b, int64_t e) {
+    for (int64_t r = b; r < e; ++r) {
+      geometry[r] = MakeRoiAlignGeometry<T>(s, boxes + r * 4);
+    }
+  });
+  ParallelFor(0, batch * s.channels, 1, [&](int64_t b, int64_t e) {
+    // Gradients of the row sums, and which rows hold one for this ROI.
+    std::vector<T> row_grad(s.height * s.pooled_w);
+    std::vector<int64_t> stamp(s.height, -1);
+    std::vector<int64_t> touched;
+    for (int64_t task = b; task < e; ++task) {
+      const int64_t n = task / s.channels;
+      const int64_t c = task % s.channels;
+      T* dst = x_grad + task * plane;
+      std::fill(dst, dst + plane, T(0));
+      for (int64_t roi : rois_of[n]) {
+        const auto& g = geometry[roi];
+        const T* dout = out_grad + (roi * s.channels + c) * bins;
+        const int64_t key = roi * s.channels + c;
+        touched.clear();
+        auto add = [&](int64_t r, T w, const T* bin) {
+          T* sum = row_grad.data() + r * s.pooled_w;
+          if (stamp[r] != key) {
+            stamp[r] = key;
+            touched.push_back(r);
+            std::fill(sum, sum + s.pooled_w, T(0));
+          }
+          for (int64_t pw = 0; pw < s.pooled_w; ++pw) {
+            sum[pw] += w * bin[pw] / g.count;
+          }
+        };
+        for (int64_t ph = 0; ph < s.pooled_h; ++ph) {
+          const T* bin = dout + ph * s.pooled_w;
+          for (int64_t i = ph * g.y.grid; i < (ph + 1) * g.y.grid; ++i) {
+            add(g.y.lo[i], g.y.w_lo[i], bin);
+            add(g.y.hi[i], g.y.w_hi[i], bin);
+          }
+        }
+        for (int64_t r : touched) {
+          const T* sum = row_grad.data() + r * s.pooled_w;
+          T* row = dst + r * s.width;
+          for (int64_t pw = 0; pw < s.pooled_w; ++pw) {
+            for (int64_t i = pw * g.x.grid; i < (pw + 1) * g.x.grid; ++i) {
+              row[g.x.lo[i]] += g.x.w_lo[i] * sum[pw];
+              row[g.x.hi[i]] += g.x.w_hi[i] * sum[pw];
+            }
+          }
+        }
+      }
+    }
+  });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
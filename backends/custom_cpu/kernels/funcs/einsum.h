@@ -0,0 +1,849 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kernels/funcs/blocked_gemm.h"
+#include "kernels/funcs/fill.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+// Einsum over any number of operands, lowered to the blocked GEMM.
+//
+// The equation is parsed into integer labels (letters, and one label per
+// broadcast dim of the ellipsis) and a contraction order is chosen: the
+// cheapest binary tree by multiply-add count for up to
+// kEinsumOptimalOperands operands, the cheapest next pair otherwise.
+// Parsing and ordering depend only on the equation and the shapes and are
+// cached.
+//
+// Every operand is a strided view: repeated labels (diagonals) add their
+// strides, broadcast dims of size 1 are dropped. A label found in a single
+// operand and not in the output is summed away first. A pairwise
+// contraction then splits the labels into batch (both operands, kept), M
+// (first only), N (second only) and K (both, summed) groups. When the
+// labels of each group are consecutive in memory the group is one stride,
+// and the contraction is a batch of strided GEMMs that read the operands
+// in place; only an operand whose group cannot be merged is copied into
+// [batch, M, K] order first. The last contraction writes the output in
+// place the same way.
+
+namespace custom_kernel {
+namespace funcs {
+
+// 'A'-'Z' are labels 0-25 and 'a'-'z' 26-51 (so label order is character
+// order); dims of the ellipsis follow.
+constexpr int kEinsumLetters = 52;
+constexpr int kEinsumMaxLabels = 128;
+constexpr int kEinsumOptimalOperands = 6;
+constexpr size_t kEinsumPlanCacheSize = 1024;
+
+// Label of a size-1 broadcast dim that does not take part.
+constexpr int kEinsumNoLabel = -1;
+
+using EinsumLabelSet = std::bitset<kEinsumMaxLabels>;
+
+struct EinsumPlan {
+  // label of every dim of every operand and of the output
+  std::vector<std::vector<int>> inputs;
+  std::vector<int> output;
+  std::vector<int64_t> sizes;  // per label
+  // step i contracts working operands steps[i] (inputs, then results in
+  // step order) into a new one
+  std::vector<std::pair<int, int>> steps;
+};
+
+inline int EinsumLetterLabel(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+  if (c >= 'a' && c <= 'z') {
+    return 26 + c - 'a';
+  }
+  return kEinsumNoLabel;
+}
+
+inline EinsumLabelSet EinsumLabels(const std::vector<int>& labels) {
+  EinsumLabelSet set;
+  for (int l : labels) {
+    if (l != kEinsumNoLabel) {
+      set.set(l);
+    }
+  }
+  return set;
+}
+
+// Letters of one term; the ellipsis, if any, is kEinsumNoLabel - 1.
+inline std::vector<int> ParseEinsumTerm(const std::string& term) {
+  constexpr int kEllipsis = kEinsumNoLabel - 1;
+  std::vector<int> labels;
+  for (size_t i = 0; i < term.size(); ++i) {
+    if (term.compare(i, 3, "...") == 0) {
+      PD_CHECK(std::find(labels.begin(), labels.end(), kEllipsis) ==
+                   labels.end(),
+               "The einsum term '%s' has more than one ellipsis.",
+               term);
+      labels.push_back(kEllipsis);
+      i += 2;
+      continue;
+    }
+    const int label = EinsumLetterLabel(term[i]);
+    PD_CHECK(label != kEinsumNoLabel,
+             "Invalid character '%c' in the einsum term '%s'.",
+             term[i],
+             term);
+    labels.push_back(label);
+  }
+  return labels;
+}
+
+// Orders the contractions of `plan` (inputs, output and sizes set).
+inline void PlanEinsumOrder(EinsumPlan* plan) {
+  const int n = static_cast<int>(plan->inputs.size());
+  std::vector<EinsumLabelSet> sets;
+  for (const auto& labels : plan->inputs) {
+    sets.push_back(EinsumLabels(labels));
+  }
+  const EinsumLabelSet out_set = EinsumLabels(plan->output);
+  auto volume = [&](const EinsumLabelSet& set) {
+    double v = 1.0;
+    for (int l = 0; l < kEinsumMaxLabels; ++l) {
+      if (set.test(l)) {
+        v *= static_cast<double>(plan->sizes[l]);
+      }
+    }
+    return v;
+  };
+  plan->steps.clear();
+  if (n <= 1) {
+    return;
+  }
+
+  if (n <= kEinsumOptimalOperands) {
+    // cost[s] of the cheapest tree over the operands in s, its labels are
+    // those still needed outside s
+    const int subsets = 1 << n;
+    std::vector<EinsumLabelSet> union_of(subsets);
+    for (int s = 1; s < subsets; ++s) {
+      const int low = __builtin_ctz(s);
+      union_of[s] = union_of[s & (s - 1)] | sets[low];
+    }
+    std::vector<EinsumLabelSet> kept(subsets);
+    for (int s = 1; s < subsets; ++s) {
+      kept[s] = union_of[s] & (union_of[(subsets - 1) ^ s] | out_set);
+    }
+    std::vector<double> cost(subsets, 0.0);
+    std::vector<int> split(subsets, 0);
+    for (int s = 1; s < subsets; ++s) {
+      if ((s & (s - 1)) == 0) {
+        continue;
+      }
+      cost[s] = std::numeric_limits<double>::infinity();
+      for (int a = (s - 1) & s; a > 0; a = (a - 1) & s) {
+        const int b = s ^ a;
+        if (a < b) {
+          continue;
+        }
+        const double c =
+            cost[a] + cost[b] + volume(kept[a] | kept[b]);
+        if (c < cost[s]) {
+          cost[s] = c;
+          split[s] = a;
+        }
+      }
+    }
+    int next = n;
+    std::vector<int> stack_sets = {subsets - 1};
+    // post-order over the tree, children before their parent
+    std::vector<int> order;
+    while (!stack_sets.empty()) {
+      const int s = stack_sets.back();
+      stack_sets.pop_back();
+      if ((s & (s - 1)) == 0) {
+        continue;
+      }
+      order.push_back(s);
+      stack_sets.push_back(split[s]);
+      stack_sets.push_back(s ^ split[s]);
+    }
+    std::reverse(order.begin(), order.end());
+    std::map<int, int> operand_of;
+    for (int i = 0; i < n; ++i) {
+      operand_of[1 << i] = i;
+    }
+    for (int s : order) {
+      plan->steps.emplace_back(operand_of[split[s]],
+                               operand_of[s ^ split[s]]);
+      operand_of[s] = next++;
+    }
+    return;
+  }
+
+  // greedy: the cheapest pair of the live operands, again and again
+  std::vector<int> live(n);
+  std::vector<EinsumLabelSet> live_sets = sets;
+  for (int i = 0; i < n; ++i) {
+    live[i] = i;
+  }
+  int next = n;
+  while (live.size() > 1) {
+    double best = std::numeric_limits<double>::infinity();
+    size_t best_i = 0;
+    size_t best_j = 1;
+    for (size_t i = 0; i < live.size(); ++i) {
+      for (size_t j = i + 1; j < live.size(); ++j) {
+        const double c = volume(live_sets[i] | live_sets[j]);
+        if (c < best) {
+          best = c;
+          best_i = i;
+          best_j = j;
+        }
+      }
+    }
+    EinsumLabelSet others = out_set;
+    for (size_t i = 0; i < live.size(); ++i) {
+      if (i != best_i && i != best_j) {
+        others |= live_sets[i];
+      }
+    }
+    plan->steps.emplace_back(live[best_i], live[best_j]);
+    const EinsumLabelSet merged =
+        (live_sets[best_i] | live_sets[best_j]) & others;
+    live.erase(live.begin() + best_j);
+    live_sets.erase(live_sets.begin() + best_j);
+    live[best_i] = next++;
+    live_sets[best_i] = merged;
+  }
+}
+
+// Parses `equation` for operands of shapes `dims`. Explicit ("ij,jk->ik")
+// and implicit ("ij,jk", the output is the ellipsis and then the labels
+// seen once, in order) forms are accepted; letters must agree in size,
+// dims of the ellipsis broadcast right aligned.
+inline EinsumPlan ParseEinsum(const std::string& equation,
+                              const std::vector<std::vector<int64_t>>& dims) {
+  std::string eq;
+  for (char c : equation) {
+    if (c != ' ') {
+      eq.push_back(c);
+    }
+  }
+  const size_t arrow = eq.find("->");
+  const std::string lhs = eq.substr(0, arrow);
+  std::vector<std::string> terms(1);
+  for (char c : lhs) {
+    if (c == ',') {
+      terms.emplace_back();
+    } else {
+      terms.back().push_back(c);
+    }
+  }
+  PD_CHECK(terms.size() == dims.size(),
+           "The einsum equation '%s' has %d operands, but %d tensors are "
+           "given.",
+           equation,
+           static_cast<int>(terms.size()),
+           static_cast<int>(dims.size()));
+  constexpr int kEllipsis = kEinsumNoLabel - 1;
+
+  std::vector<std::vector<int>> parsed;
+  int ellipsis_rank = 0;
+  for (size_t i = 0; i < terms.size(); ++i) {
+    parsed.push_back(ParseEinsumTerm(terms[i]));
+    const auto& labels = parsed.back();
+    const bool has_ellipsis =
+        std::find(labels.begin(), labels.end(), kEllipsis) != labels.end();
+    const int letters =
+        static_cast<int>(labels.size()) - (has_ellipsis ? 1 : 0);
+    const int rank = static_cast<int>(dims[i].size());
+    PD_CHECK(has_ellipsis ? rank >= letters : rank == letters,
+             "The einsum term '%s' does not match the %d-D operand %d.",
+             terms[i],
+             rank,
+             static_cast<int>(i));
+    if (has_ellipsis) {
+      ellipsis_rank = std::max(ellipsis_rank, rank - letters);
+    }
+  }
+  PD_CHECK(kEinsumLetters + ellipsis_rank <= kEinsumMaxLabels,
+           "The ellipsis of einsum covers too many dims (%d).",
+           ellipsis_rank);
+
+  EinsumPlan plan;
+  plan.sizes.assign(kEinsumLetters + ellipsis_rank, 1);
+  std::vector<bool> seen(plan.sizes.size(), false);
+  for (size_t i = 0; i < parsed.size(); ++i) {
+    const int rank = static_cast<int>(dims[i].size());
+    const int letters = static_cast<int>(parsed[i].size()) -
+                        (std::count(parsed[i].begin(),
+                                    parsed[i].end(),
+                                    kEllipsis) > 0
+                             ? 1
+                             : 0);
+    const int spread = rank - letters;
+    std::vector<int> labels;
+    for (int l : parsed[i]) {
+      if (l != kEllipsis) {
+        labels.push_back(l);
+        continue;
+      }
+      for (int k = 0; k < spread; ++k) {
+        labels.push_back(kEinsumLetters + ellipsis_rank - spread + k);
+      }
+    }
+    for (int d = 0; d < rank; ++d) {
+      const int l = labels[d];
+      const int64_t size = dims[i][d];
+      if (l >= kEinsumLetters) {
+        PD_CHECK(size == 1 || plan.sizes[l] == 1 || plan.sizes[l] == size,
+                 "Dim %d of einsum operand %d (%ld) does not broadcast "
+                 "with %ld.",
+                 d,
+                 static_cast<int>(i),
+                 size,
+                 plan.sizes[l]);
+        plan.sizes[l] = std::max(plan.sizes[l], size);
+      } else {
+        PD_CHECK(!seen[l] || plan.sizes[l] == size,
+                 "The einsum label '%c' has sizes %ld and %ld.",
+                 static_cast<char>(l < 26 ? 'A' + l : 'a' + l - 26),
+                 plan.sizes[l],
+                 size);
+        plan.sizes[l] = size;
+      }
+      seen[l] = true;
+    }
+    plan.inputs.push_back(labels);
+  }
+  // broadcast dims of size 1 take no part
+  for (size_t i = 0; i < plan.inputs.size(); ++i) {
+    for (size_t d = 0; d < plan.inputs[i].size(); ++d) {
+      const int l = plan.inputs[i][d];
+      if (l >= kEinsumLetters && dims[i][d] == 1 && plan.sizes[l] != 1) {
+        plan.inputs[i][d] = kEinsumNoLabel;
+      }
+    }
+  }
+
+  if (arrow == std::string::npos) {
+    std::vector<int> count(kEinsumLetters, 0);
+    for (const auto& labels : parsed) {
+      for (int l : labels) {
+        if (l >= 0) {
+          ++count[l];
+        }
+      }
+    }
+    for (int k = 0; k < ellipsis_rank; ++k) {
+      plan.output.push_back(kEinsumLetters + k);
+    }
+    for (int l = 0; l < kEinsumLetters; ++l) {
+      if (count[l] == 1) {
+        plan.output.push_back(l);
+      }
+    }
+  } else {
+    for (int l : ParseEinsumTerm(eq.substr(arrow + 2))) {
+      if (l == kEllipsis) {
+        for (int k = 0; k < ellipsis_rank; ++k) {
+          plan.output.push_back(kEinsumLetters + k);
+        }
+        continue;
+      }
+      PD_CHECK(seen[l] && std::find(plan.output.begin(),
+                                    plan.output.end(),
+                                    l) == plan.output.end(),
+               "The output labels of the einsum equation '%s' must be "
+               "distinct input labels.",
+               equation);
+      plan.output.push_back(l);
+    }
+  }
+  PlanEinsumOrder(&plan);
+  return plan;
+}
+
+// Plans by (equation or purpose, shapes), built on first use.
+template <typename Builder>
+std::shared_ptr<const EinsumPlan> GetEinsumPlan(
+    const std::string& equation,
+    const std::vector<std::vector<int64_t>>& dims,
+    const Builder& build) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<const EinsumPlan>> cache;
+  std::string key = equation;
+  for (const auto& d : dims) {
+    key += ';';
+    for (auto v : d) {
+      key += std::to_string(v) + ',';
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      return it->second;
+    }
+  }
+  auto plan = std::make_shared<const EinsumPlan>(build());
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache.size() >= kEinsumPlanCacheSize) {
+    cache.clear();
+  }
+  cache.emplace(key, plan);
+  return plan;
+}
+
+// A tensor seen through its labels: element at label indices (i_l) is
+// data[sum_l i_l * strides[l]]. Labels are distinct.
+template <typename T>
+struct EinsumView {
+  T* data = nullptr;
+  std::vector<int> labels;
+  std::vector<int64_t> strides;
+
+  int64_t StrideOf(int label) const {
+    for (size_t i = 0; i < labels.size(); ++i) {
+      if (labels[i] == label) {
+        return strides[i];
+      }
+    }
+    return 0;
+  }
+};
+
+template <typename T>
+bool EinsumHasLabel(const EinsumView<T>& view, int label) {
+  return std::find(view.labels.begin(), view.labels.end(), label) !=
+         view.labels.end();
+}
+
+// View of a dense row-major tensor with a label per dim: repeated labels
+// are the diagonal, kEinsumNoLabel dims (size 1) are skipped.
+template <typename T>
+EinsumView<T> MakeEinsumView(T* data,
+                             const std::vector<int>& labels,
+                             const std::vector<int64_t>& dims) {
+  EinsumView<T> view;
+  view.data = data;
+  int64_t stride = 1;
+  for (int d = static_cast<int>(dims.size()) - 1; d >= 0; --d) {
+    const int l = labels[d];
+    if (l != kEinsumNoLabel) {
+      auto it = std::find(view.labels.begin(), view.labels.end(), l);
+      if (it == view.labels.end()) {
+        view.labels.insert(view.labels.begin(), l);
+        view.strides.insert(view.strides.begin(), stride);
+      } else {
+        view.strides[it - view.labels.begin()] += stride;
+      }
+    }
+    stride *= dims[d];
+  }
+  return view;
+}
+
+// Dense view of `labels` in that order over new storage.
+template <typename T>
+EinsumView<T> NewEinsumView(const std::vector<int>& labels,
+                            const std::vector<int64_t>& sizes,
+                            std::vector<std::vector<T>>* storage) {
+  int64_t numel = 1;
+  for (int l : labels) {
+    numel *= sizes[l];
+  }
+  storage->emplace_back(numel);
+  std::vector<int64_t> dims;
+  for (int l : labels) {
+    dims.push_back(sizes[l]);
+  }
+  return MakeEinsumView(storage->back().data(), labels, dims);
+}
+
+// dst = src summed over the labels dst lacks, broadcast over the labels
+// src lacks. Parallel over dst; every element sums in index order.
+template <typename T, typename MT>
+void EinsumAssign(const EinsumView<T>& src,
+                  const EinsumView<T>& dst,
+                  const std::vector<int64_t>& sizes) {
+  const int nd = static_cast<int>(dst.labels.size());
+  std::vector<int64_t> dst_sizes(nd);
+  std::vector<int64_t> src_along_dst(nd);
+  int64_t total = 1;
+  for (int d = 0; d < nd; ++d) {
+    dst_sizes[d] = sizes[dst.labels[d]];
+    src_along_dst[d] = src.StrideOf(dst.labels[d]);
+    total *= dst_sizes[d];
+  }
+  std::vector<int64_t> red_sizes;
+  std::vector<int64_t> red_strides;
+  int64_t reduce = 1;
+  for (size_t i = 0; i < src.labels.size(); ++i) {
+    if (!EinsumHasLabel(dst, src.labels[i])) {
+      red_sizes.push_back(sizes[src.labels[i]]);
+      red_strides.push_back(src.strides[i]);
+      reduce *= red_sizes.back();
+    }
+  }
+  const int nr = static_cast<int>(red_sizes.size());
+  const int64_t grain =
+      std::max<int64_t>(1, kParallelGrainSize / std::max<int64_t>(reduce, 1));
+  ParallelFor(0, total, grain, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> index(nd);
+    int64_t rest = begin;
+    int64_t src_offset = 0;
+    int64_t dst_offset = 0;
+    for (int d = nd - 1; d >= 0; --d) {
+      index[d] = rest % dst_sizes[d];
+      rest /= dst_sizes[d];
+      src_offset += index[d] * src_along_dst[d];
+      dst_offset += index[d] * dst.strides[d];
+    }
+    std::vector<int64_t> r_index(nr);
+    for (int64_t e = begin; e < end; ++e) {
+      MT acc = 0;
+      if (nr == 0) {
+        acc = static_cast<MT>(src.data[src_offset]);
+      } else {
+        std::fill(r_index.begin(), r_index.end(), 0);
+        int64_t r_offset = 0;
+        const int64_t inner = red_sizes[nr - 1];
+        const int64_t inner_stride = red_strides[nr - 1];
+        for (int64_t r = 0; r < reduce; r += inner) {
+          const T* p = src.data + src_offset + r_offset;
+          for (int64_t k = 0; k < inner; ++k) {
+            acc += static_cast<MT>(p[k * inner_stride]);
+          }
+          for (int d = nr - 2; d >= 0; --d) {
+            r_offset += red_strides[d];
+            if (++r_index[d] < red_sizes[d]) {
+              break;
+            }
+            r_offset -= red_sizes[d] * red_strides[d];
+            r_index[d] = 0;
+          }
+        }
+      }
+      dst.data[dst_offset] = static_cast<T>(acc);
+      for (int d = nd - 1; d >= 0; --d) {
+        src_offset += src_along_dst[d];
+        dst_offset += dst.strides[d];
+        if (++index[d] < dst_sizes[d]) {
+          break;
+        }
+        src_offset -= dst_sizes[d] * src_along_dst[d];
+        dst_offset -= dst_sizes[d] * dst.strides[d];
+        index[d] = 0;
+      }
+    }
+  });
+}
+
+// Stride of the labels of `group`, in that order, as one merged dim of
+// `view`, or -1 when they are not evenly spaced. Size-1 labels are free.
+template <typename T>
+int64_t EinsumGroupStride(const EinsumView<T>& view,
+                          const std::vector<int>& group,
+                          const std::vector<int64_t>& sizes) {
+  int64_t stride = 0;
+  int64_t expected = -1;
+  for (int i = static_cast<int>(group.size()) - 1; i >= 0; --i) {
+    const int l = group[i];
+    if (sizes[l] == 1) {
+      continue;
+    }
+    const int64_t s = view.StrideOf(l);
+    if (expected == -1) {
+      stride = s;
+    } else if (s != expected) {
+      return -1;
+    }
+    expected = s * sizes[l];
+  }
+  return stride;
+}
+
+// `group` ordered by decreasing stride in `view`.
+template <typename T>
+std::vector<int> EinsumOrderBy(const EinsumView<T>& view,
+                               std::vector<int> group) {
+  std::stable_sort(group.begin(), group.end(), [&](int a, int b) {
+    return view.StrideOf(a) > view.StrideOf(b);
+  });
+  return group;
+}
+
+inline int64_t EinsumGroupSize(const std::vector<int>& group,
+                               const std::vector<int64_t>& sizes) {
+  int64_t size = 1;
+  for (int l : group) {
+    size *= sizes[l];
+  }
+  return size;
+}
+
+// Picks the order of `group` in which it is one stride in both views,
+// trying each view's memory order; the first view's order if none works.
+template <typename T>
+std::vector<int> EinsumGroupOrder(const EinsumView<T>& first,
+                                  const EinsumView<T>& second,
+                                  const std::vector<int>& group,
+                                  const std::vector<int64_t>& sizes) {
+  for (const auto* view : {&first, &second}) {
+    auto order = EinsumOrderBy(*view, group);
+    if (EinsumGroupStride(first, order, sizes) >= 0 &&
+        EinsumGroupStride(second, order, sizes) >= 0) {
+      return order;
+    }
+  }
+  return EinsumOrderBy(first, group);
+}
+
+// out (labels: batch, then M and N labels) = sum over K of a * b, with
+// every label of a and b either in out or in both. `out` may be any view;
+// returns the view written (new storage when out is null).
+template <typename T, typename MT>
+EinsumView<T> EinsumContract(EinsumView<T> a,
+                             EinsumView<T> b,
+                             const std::vector<int>& out_labels,
+                             const EinsumView<T>* out,
+                             const std::vector<int64_t>& sizes,
+                             std::vector<std::vector<T>>* storage) {
+  std::vector<int> batch, m, n, k;
+  for (int l : out_labels) {
+    const bool in_a = EinsumHasLabel(a, l);
+    const bool in_b = EinsumHasLabel(b, l);
+    if (in_a && in_b) {
+      batch.push_back(l);
+    } else if (in_a) {
+      m.push_back(l);
+    } else {
+      n.push_back(l);
+    }
+  }
+  for (int l : a.labels) {
+    if (EinsumHasLabel(b, l) &&
+        std::find(out_labels.begin(), out_labels.end(), l) ==
+            out_labels.end()) {
+      k.push_back(l);
+    }
+  }
+  // the output view, or new storage in [batch, M, N] order
+  EinsumView<T> c;
+  if (out != nullptr) {
+    c = *out;
+  } else {
+    m = EinsumOrderBy(a, m);
+    n = EinsumOrderBy(b, n);
+    std::vector<int> labels = batch;
+    labels.insert(labels.end(), m.begin(), m.end());
+    labels.insert(labels.end(), n.begin(), n.end());
+    c = NewEinsumView(labels, sizes, storage);
+  }
+  m = EinsumGroupOrder(c, a, m, sizes);
+  n = EinsumGroupOrder(c, b, n, sizes);
+  k = EinsumGroupOrder(a, b, k, sizes);
+
+  auto dense = [&](const EinsumView<T>& v,
+                   const std::vector<int>& rows,
+                   const std::vector<int>& cols) {
+    std::vector<int> labels = batch;
+    labels.insert(labels.end(), rows.begin(), rows.end());
+    labels.insert(labels.end(), cols.begin(), cols.end());
+    EinsumView<T> copy = NewEinsumView(labels, sizes, storage);
+    EinsumAssign<T, MT>(v, copy, sizes);
+    return copy;
+  };
+  if (EinsumGroupStride(a, m, sizes) < 0 ||
+      EinsumGroupStride(a, k, sizes) < 0) {
+    a = dense(a, m, k);
+  }
+  if (EinsumGroupStride(b, k, sizes) < 0 ||
+      EinsumGroupStride(b, n, sizes) < 0) {
+    b = dense(b, k, n);
+  }
+  EinsumView<T> target = c;
+  if (EinsumGroupStride(c, m, sizes) < 0 ||
+      EinsumGroupStride(c, n, sizes) < 0) {
+    std::vector<int> labels = batch;
+    labels.insert(labels.end(), m.begin(), m.end());
+    labels.insert(labels.end(), n.begin(), n.end());
+    target = NewEinsumView(labels, sizes, storage);
+  }
+
+  GemmProblem<T, MT> gemm{};
+  gemm.M = EinsumGroupSize(m, sizes);
+  gemm.K = EinsumGroupSize(k, sizes);
+  gemm.N = EinsumGroupSize(n, sizes);
+  gemm.alpha = static_cast<MT>(1);
+  gemm.strided = true;
+  gemm.x_strides[0] = EinsumGroupStride(a, m, sizes);
+  gemm.x_strides[1] = EinsumGroupStride(a, k, sizes);
+  gemm.y_strides[0] = EinsumGroupStride(b, k, sizes);
+  gemm.y_strides[1] = EinsumGroupStride(b, n, sizes);
+  gemm.out_strides[0] = EinsumGroupStride(target, m, sizes);
+  gemm.out_strides[1] = EinsumGroupStride(target, n, sizes);
+  const int64_t batch_count = EinsumGroupSize(batch, sizes);
+  std::vector<GemmProblem<T, MT>> problems(batch_count, gemm);
+  std::vector<int64_t> index(batch.size(), 0);
+  for (int64_t i = 0; i < batch_count; ++i) {
+    int64_t a_offset = 0, b_offset = 0, c_offset = 0;
+    for (size_t d = 0; d < batch.size(); ++d) {
+      a_offset += index[d] * a.StrideOf(batch[d]);
+      b_offset += index[d] * b.StrideOf(batch[d]);
+      c_offset += index[d] * target.StrideOf(batch[d]);
+    }
+    problems[i].x = a.data + a_offset;
+    problems[i].y = b.data + b_offset;
+    problems[i].out = target.data + c_offset;
+    for (int d = static_cast<int>(batch.size()) - 1; d >= 0; --d) {
+      if (++index[d] < sizes[batch[d]]) {
+        break;
+      }
+      index[d] = 0;
+    }
+  }
+  BlockedGemmBatch<T, MT>(problems, DefaultGemmConfig());
+  if (target.data != c.data) {
+    EinsumAssign<T, MT>(target, c, sizes);
+  }
+  return c;
+}
+
+// Evaluates `plan` on operands with the given data and shapes into the
+// dense tensor `out` of shape out_dims.
+template <typename T, typename MT>
+void RunEinsum(const EinsumPlan& plan,
+               const std::vector<const T*>& inputs,
+               const std::vector<std::vector<int64_t>>& dims,
+               T* out,
+               const std::vector<int64_t>& out_dims) {
+  int64_t out_numel = 1;
+  for (auto d : out_dims) {
+    out_numel *= d;
+  }
+  if (out_numel == 0) {
+    return;
+  }
+  const auto& sizes = plan.sizes;
+  const EinsumView<T> out_view = MakeEinsumView(out, plan.output, out_dims);
+  bool empty = false;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    for (auto d : dims[i]) {
+      empty = empty || d == 0;
+    }
+  }
+  // repeated output labels only write the diagonal
+  const size_t out_rank =
+      plan.output.size() -
+      std::count(plan.output.begin(), plan.output.end(), kEinsumNoLabel);
+  if (empty || out_view.labels.size() != out_rank) {
+    ParallelFill(out, out_numel, static_cast<T>(0));
+  }
+  if (empty) {
+    return;
+  }
+
+  const int n = static_cast<int>(inputs.size());
+  std::vector<std::vector<T>> storage;
+  std::vector<EinsumView<T>> work;
+  std::vector<EinsumLabelSet> work_sets;
+  for (int i = 0; i < n; ++i) {
+    work.push_back(MakeEinsumView(
+        const_cast<T*>(inputs[i]), plan.inputs[i], dims[i]));
+    work_sets.push_back(EinsumLabels(work.back().labels));
+  }
+  const EinsumLabelSet out_set = EinsumLabels(out_view.labels);
+  std::vector<bool> live(n, true);
+  auto needed_outside = [&](const std::vector<int>& skip) {
+    EinsumLabelSet set = out_set;
+    for (size_t i = 0; i < work.size(); ++i) {
+      if (live[i] &&
+          std::find(skip.begin(), skip.end(), i) == skip.end()) {
+        set |= work_sets[i];
+      }
+    }
+    return set;
+  };
+  auto labels_of = [](const EinsumLabelSet& set,
+                      const EinsumView<T>& order_from) {
+    std::vector<int> labels;
+    for (int l : order_from.labels) {
+      if (set.test(l)) {
+        labels.push_back(l);
+      }
+    }
+    return labels;
+  };
+  // labels of a single operand outside the output are summed first
+  for (int i = 0; i < n; ++i) {
+    const EinsumLabelSet keep = work_sets[i] & needed_outside({i});
+    if (keep != work_sets[i] && n > 1) {
+      const EinsumView<T> reduced =
+          NewEinsumView(labels_of(keep, work[i]), sizes, &storage);
+      EinsumAssign<T, MT>(work[i], reduced, sizes);
+      work[i] = reduced;
+      work_sets[i] = keep;
+    }
+  }
+
+  for (size_t s = 0; s < plan.steps.size(); ++s) {
+    const int i = plan.steps[s].first;
+    const int j = plan.steps[s].second;
+    const EinsumLabelSet keep =
+        (work_sets[i] | work_sets[j]) & needed_outside({i, j});
+    live[i] = live[j] = false;
+    const bool last = s + 1 == plan.steps.size();
+    std::vector<int> out_labels;
+    for (int l : out_view.labels) {
+      if (keep.test(l)) {
+        out_labels.push_back(l);
+      }
+    }
+    for (int l = 0; l < kEinsumMaxLabels; ++l) {
+      if (keep.test(l) && !out_set.test(l)) {
+        out_labels.push_back(l);
+      }
+    }
+    const bool direct = last && keep == out_set;
+    work.push_back(EinsumContract<T, MT>(work[i],
+                                         work[j],
+                                         out_labels,
+                                         direct ? &out_view : nullptr,
+                                         sizes,
+                                         &storage));
+    work_sets.push_back(keep);
+    live.push_back(!direct);
+  }
+  for (size_t i = 0; i < work.size(); ++i) {
+    if (live[i]) {
+      EinsumAssign<T, MT>(work[i], out_view, sizes);
+    }
+  }
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,73 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "kernels/funcs/parallel.h"
+#include "runtime/runtime.h"
+
+namespace custom_kernel {
+namespace funcs {
+
+// Zero fills from this size on go to the page allocator of the runtime,
+// which drops whole pages instead of writing them (runtime/runtime.h).
+constexpr int64_t kLazyZeroMinBytes = 2 << 20;
+
+// True if every byte of `value` is the same, e.g. 0, -1 or any uint8_t,
+// so the fill is a memset.
+template <typename T>
+inline bool IsByteSplat(const T& value, unsigned char* byte) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+  for (size_t i = 1; i < sizeof(T); ++i) {
+    if (bytes[i] != bytes[0]) {
+      return false;
+    }
+  }
+  *byte = bytes[0];
+  return true;
+}
+
+// data[0, n) = value. The range is split into one block per thread as in
+// ParallelFor, the split the elementwise kernels consuming the buffer use,
+// so with bound threads each page is first touched on the NUMA node of the
+// thread that later works on it.
+template <typename T>
+void ParallelFill(T* data, int64_t n, const T& value) {
+  if (n <= 0) {
+    return;
+  }
+  const int64_t bytes = n * static_cast<int64_t>(sizeof(T));
+  unsigned char byte = 0;
+  if (IsByteSplat(value, &byte)) {
+    if (byte == 0 && bytes >= kLazyZeroMinBytes &&
+        custom_cpu::ZeroPages(data, static_cast<size_t>(bytes))) {
+      return;
+    }
+    ParallelMemset(data, byte, bytes);
+    return;
+  }
+  ParallelFor(0, n, kParallelGrainSize, [&](int64_t begin, int64_t end) {
+    const T v = value;
+    PD_CPU_SIMD
+    for (int64_t i = begin; i < end; ++i) {
+      data[i] = v;
+    }
+  });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
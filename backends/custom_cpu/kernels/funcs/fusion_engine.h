@@ -0,0 +1,454 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+
+// Fused elementwise expressions.
+//
+// A chain such as relu(x * w + b) is written as a postfix program
+// "x y mul z add relu" and evaluated tile by tile: every instruction runs
+// over a tile of kFusionTile elements held in a small per-thread stack, so
+// the inputs are read once and the output written once however long the
+// chain is. Intermediates never leave L1. Tiles hold floats for float and
+// the 16-bit floats, and the input type itself for double and integers, so
+// those programs are not rounded through float.
+
+namespace custom_kernel {
+namespace funcs {
+
+// Elements per tile, and the deepest operand stack a program may use. The
+// stack (kFusionMaxDepth * kFusionTile elements) is sized to stay in L1.
+constexpr int64_t kFusionTile = 512;
+constexpr int kFusionMaxDepth = 8;
+constexpr int kFusionMaxInputs = 3;
+
+enum class FusedOpCode {
+  kInput,
+  kConst,
+  // unary
+  kRelu,
+  kNeg,
+  kAbs,
+  kExp,
+  kLog,
+  kSqrt,
+  kRsqrt,
+  kSquare,
+  kReciprocal,
+  kTanh,
+  kSigmoid,
+  kSilu,
+  // binary
+  kAdd,
+  kSub,
+  kMul,
+  kDiv,
+  kMax,
+  kMin,
+  kPow,
+  kEqual,
+  kNotEqual,
+  kLess,
+  kLessEqual,
+  kGreater,
+  kGreaterEqual,
+  // ternary: cond a b where -> cond != 0 ? a : b
+  kWhere,
+};
+
+struct FusedInstr {
+  FusedOpCode code;
+  int arity;
+  int input;  // kInput
+  float value;  // kConst
+};
+
+struct FusedOpName {
+  const char* name;
+  FusedOpCode code;
+  int arity;
+};
+
+static const FusedOpName kFusedOpNames[] = {
+    {"relu", FusedOpCode::kRelu, 1},
+    {"neg", FusedOpCode::kNeg, 1},
+    {"abs", FusedOpCode::kAbs, 1},
+    {"exp", FusedOpCode::kExp, 1},
+    {"log", FusedOpCode::kLog, 1},
+    {"sqrt", FusedOpCode::kSqrt, 1},
+    {"rsqrt", FusedOpCode::kRsqrt, 1},
+    {"square", FusedOpCode::kSquare, 1},
+    {"reciprocal", FusedOpCode::kReciprocal, 1},
+    {"tanh", FusedOpCode::kTanh, 1},
+    {"sigmoid", FusedOpCode::kSigmoid, 1},
+    {"silu", FusedOpCode::kSilu, 1},
+    {"add", FusedOpCode::kAdd, 2},
+    {"sub", FusedOpCode::kSub, 2},
+    {"mul", FusedOpCode::kMul, 2},
+    {"div", FusedOpCode::kDiv, 2},
+    {"max", FusedOpCode::kMax, 2},
+    {"min", FusedOpCode::kMin, 2},
+    {"pow", FusedOpCode::kPow, 2},
+    {"eq", FusedOpCode::kEqual, 2},
+    {"ne", FusedOpCode::kNotEqual, 2},
+    {"lt", FusedOpCode::kLess, 2},
+    {"le", FusedOpCode::kLessEqual, 2},
+    {"gt", FusedOpCode::kGreater, 2},
+    {"ge", FusedOpCode::kGreaterEqual, 2},
+    {"where", FusedOpCode::kWhere, 3},
+};
+
+// Inputs are named x, y, z in program text.
+static const char kFusedInputNames[kFusionMaxInputs] = {'x', 'y', 'z'};
+
+class FusedProgram {
+ public:
+  // Parses whitespace separated postfix tokens. Returns false and sets
+  // `error` if a token is unknown, an input is missing, the stack
+  // underflows or overflows, or the program does not leave exactly one
+  // value.
+  bool Parse(const std::string& text, int num_inputs, std::string* error) {
+    instrs_.clear();
+    std::istringstream stream(text);
+    std::string token;
+    int depth = 0;
+    while (stream >> token) {
+      FusedInstr instr{FusedOpCode::kConst, 0, -1, 0.0f};
+      if (!ParseToken(token, &instr)) {
+        *error = "unknown token '" + token + "'";
+        return false;
+      }
+      if (instr.code == FusedOpCode::kInput && instr.input >= num_inputs) {
+        *error = "input '" + token + "' is not given";
+        return false;
+      }
+      if (depth < instr.arity) {
+        *error = "'" + token + "' needs " + std::to_string(instr.arity) +
+                 " operands";
+        return false;
+      }
+      depth += instr.arity == 0 ? 1 : 1 - instr.arity;
+      if (depth > kFusionMaxDepth) {
+        *error = "the stack is deeper than " + std::to_string(kFusionMaxDepth);
+        return false;
+      }
+      instrs_.push_back(instr);
+    }
+    if (depth != 1) {
+      *error = "the program leaves " + std::to_string(depth) +
+               " values instead of 1";
+      return false;
+    }
+    return true;
+  }
+
+  const std::vector<FusedInstr>& instrs() const { return instrs_; }
+
+ private:
+  static bool ParseToken(const std::string& token, FusedInstr* instr) {
+    for (int i = 0; i < kFusionMaxInputs; ++i) {
+      if (token.size() == 1 && token[0] == kFusedInputNames[i]) {
+        *instr = FusedInstr{FusedOpCode::kInput, 0, i, 0.0f};
+        return true;
+      }
+    }
+    for (const auto& op : kFusedOpNames) {
+      if (token == op.name) {
+        *instr = FusedInstr{op.code, op.arity, -1, 0.0f};
+        return true;
+      }
+    }
+    char* end = nullptr;
+    const float value = std::strtof(token.c_str(), &end);
+    if (end != token.c_str() && *end == '\0') {
+      *instr = FusedInstr{FusedOpCode::kConst, 0, -1, value};
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<FusedInstr> instrs_;
+};
+
+// An input broadcast against the output: output element i reads
+// data[(i / inner) % numel]. `numel` is the output size (same shape), 1
+// (scalar) or the size of a block of the output shape, which repeats with
+// that period (e.g. a bias over the last axis); `inner` is the size of the
+// output dims after the block (e.g. H * W for a [C, 1, 1] bias in NCHW).
+template <typename T>
+struct FusedInput {
+  const T* data;
+  int64_t numel;
+  int64_t inner = 1;
+};
+
+// The type a tile of T inputs is computed in.
+template <typename T>
+struct FusedComputeType {
+  using type = float;
+};
+template <>
+struct FusedComputeType<double> {
+  using type = double;
+};
+template <>
+struct FusedComputeType<int32_t> {
+  using type = int32_t;
+};
+template <>
+struct FusedComputeType<int64_t> {
+  using type = int64_t;
+};
+
+template <typename T>
+using FusedMT = typename FusedComputeType<T>::type;
+
+template <typename T, typename MT>
+void LoadFusedTile(const FusedInput<T>& input,
+                   int64_t begin,
+                   int64_t count,
+                   MT* dst) {
+  if (input.numel == 1) {
+    const MT value = static_cast<MT>(input.data[0]);
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < count; ++i) {
+      dst[i] = value;
+    }
+    return;
+  }
+  if (input.inner > 1) {
+    // Runs of `inner` copies of one element.
+    int64_t outer = begin / input.inner;
+    int64_t pos = begin % input.inner;
+    int64_t i = 0;
+    while (i < count) {
+      const int64_t run = std::min(count - i, input.inner - pos);
+      const MT value = static_cast<MT>(input.data[outer % input.numel]);
+      PD_CPU_SIMD
+      for (int64_t j = 0; j < run; ++j) {
+        dst[i + j] = value;
+      }
+      i += run;
+      pos = 0;
+      ++outer;
+    }
+    return;
+  }
+  int64_t pos = begin % input.numel;
+  int64_t i = 0;
+  while (i < count) {
+    const int64_t run = std::min(count - i, input.numel - pos);
+    const T* src = input.data + pos;
+    PD_CPU_SIMD
+    for (int64_t j = 0; j < run; ++j) {
+      dst[i + j] = static_cast<MT>(src[j]);
+    }
+    i += run;
+    pos = 0;
+  }
+}
+
+template <typename MT>
+inline void RunFusedUnary(FusedOpCode code, int64_t n, MT* a) {
+  const MT zero = 0;
+  const MT one = 1;
+  switch (code) {
+    case FusedOpCode::kRelu:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] > zero ? a[i] : zero;
+      break;
+    case FusedOpCode::kNeg:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = -a[i];
+      break;
+    case FusedOpCode::kAbs:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = std::fabs(a[i]);
+      break;
+    case FusedOpCode::kExp:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = std::exp(a[i]);
+      break;
+    case FusedOpCode::kLog:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = std::log(a[i]);
+      break;
+    case FusedOpCode::kSqrt:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = std::sqrt(a[i]);
+      break;
+    case FusedOpCode::kRsqrt:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = one / std::sqrt(a[i]);
+      break;
+    case FusedOpCode::kSquare:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] * a[i];
+      break;
+    case FusedOpCode::kReciprocal:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = one / a[i];
+      break;
+    case FusedOpCode::kTanh:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = std::tanh(a[i]);
+      break;
+    case FusedOpCode::kSigmoid:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = one / (one + std::exp(-a[i]));
+      break;
+    case FusedOpCode::kSilu:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) {
+        a[i] = a[i] / (one + std::exp(-a[i]));
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// a = a op b
+template <typename MT>
+inline void RunFusedBinary(FusedOpCode code,
+                           int64_t n,
+                           MT* a,
+                           const MT* b) {
+  const MT zero = 0;
+  const MT one = 1;
+  switch (code) {
+    case FusedOpCode::kAdd:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] + b[i];
+      break;
+    case FusedOpCode::kSub:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] - b[i];
+      break;
+    case FusedOpCode::kMul:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] * b[i];
+      break;
+    case FusedOpCode::kDiv:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] / b[i];
+      break;
+    case FusedOpCode::kMax:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] > b[i] ? a[i] : b[i];
+      break;
+    case FusedOpCode::kMin:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] < b[i] ? a[i] : b[i];
+      break;
+    case FusedOpCode::kPow:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = std::pow(a[i], b[i]);
+      break;
+    case FusedOpCode::kEqual:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] == b[i] ? one : zero;
+      break;
+    case FusedOpCode::kNotEqual:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] != b[i] ? one : zero;
+      break;
+    case FusedOpCode::kLess:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] < b[i] ? one : zero;
+      break;
+    case FusedOpCode::kLessEqual:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] <= b[i] ? one : zero;
+      break;
+    case FusedOpCode::kGreater:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] > b[i] ? one : zero;
+      break;
+    case FusedOpCode::kGreaterEqual:
+      PD_CPU_SIMD
+      for (int64_t i = 0; i < n; ++i) a[i] = a[i] >= b[i] ? one : zero;
+      break;
+    default:
+      break;
+  }
+}
+
+// Evaluates `program` over `numel` output elements. Tiles are independent,
+// so the result does not depend on the thread count.
+template <typename T, typename OutT>
+void RunFusedProgram(const FusedProgram& program,
+                     const std::vector<FusedInput<T>>& inputs,
+                     int64_t numel,
+                     OutT* out) {
+  using MT = FusedMT<T>;
+  const auto& instrs = program.instrs();
+  const int64_t num_tiles = (numel + kFusionTile - 1) / kFusionTile;
+  ParallelFor(0,
+              num_tiles,
+              std::max<int64_t>(1, kParallelGrainSize / kFusionTile),
+              [&](int64_t tile_begin, int64_t tile_end) {
+                alignas(64) MT stack[kFusionMaxDepth][kFusionTile];
+                for (int64_t t = tile_begin; t < tile_end; ++t) {
+                  const int64_t begin = t * kFusionTile;
+                  const int64_t n = std::min(kFusionTile, numel - begin);
+                  int sp = 0;
+                  for (const auto& instr : instrs) {
+                    if (instr.code == FusedOpCode::kInput) {
+                      LoadFusedTile(inputs[instr.input], begin, n, stack[sp]);
+                      ++sp;
+                    } else if (instr.code == FusedOpCode::kConst) {
+                      MT* dst = stack[sp];
+                      const MT value = static_cast<MT>(instr.value);
+                      PD_CPU_SIMD
+                      for (int64_t i = 0; i < n; ++i) dst[i] = value;
+                      ++sp;
+                    } else if (instr.arity == 1) {
+                      RunFusedUnary(instr.code, n, stack[sp - 1]);
+                    } else if (instr.arity == 2) {
+                      RunFusedBinary(
+                          instr.code, n, stack[sp - 2], stack[sp - 1]);
+                      --sp;
+                    } else {
+                      MT* cond = stack[sp - 3];
+                      const MT* a = stack[sp - 2];
+                      const MT* b = stack[sp - 1];
+                      PD_CPU_SIMD
+                      for (int64_t i = 0; i < n; ++i) {
+                        cond[i] = cond[i] != MT(0) ? a[i] : b[i];
+                      }
+                      sp -= 2;
+                    }
+                  }
+                  OutT* dst = out + begin;
+                  const MT* result = stack[0];
+                  for (int64_t i = 0; i < n; ++i) {
+                    dst[i] = static_cast<OutT>(result[i]);
+                  }
+                }
+              });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,300 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+// Shared engine of the index based kernels (gather, scatter, index_select,
+// take_along_axis, index_put, ...).
+//
+// Tensors are viewed as [outer, rows, slice] where `slice` is the contiguous
+// block addressed by one index. Whole slices are moved with memcpy, so the
+// per element cost is only paid when `slice` is 1. Scatters group the index
+// positions by target row first; every target row is then owned by a single
+// thread and combined in position order, which makes them parallel and
+// deterministic without atomics.
+
+namespace custom_kernel {
+namespace funcs {
+
+// Slices moved per parallel block.
+constexpr int64_t kIndexSliceGrain = 1024;
+
+static inline int64_t SliceGrain(int64_t slice) {
+  return std::max<int64_t>(1, kIndexSliceGrain / std::max<int64_t>(slice, 1));
+}
+
+// Reads an int32 or int64 index tensor into int64, wrapping negative values
+// by `bound` and checking that every index is inside [0, bound).
+static inline std::vector<int64_t> ReadIndex(const phi::DenseTensor& index,
+                                             int64_t bound,
+                                             const std::string& op_name) {
+  const int64_t n = index.numel();
+  std::vector<int64_t> out(n);
+  if (index.dtype() == phi::DataType::INT64) {
+    auto data = index.data<int64_t>();
+    std::copy(data, data + n, out.begin());
+  } else if (index.dtype() == phi::DataType::INT32) {
+    auto data = index.data<int32_t>();
+    std::copy(data, data + n, out.begin());
+  } else {
+    PD_CHECK(false,
+             "The index of %s must be int32 or int64, but received %s.",
+             op_name,
+             phi::to_string(index.dtype()));
+  }
+  for (auto& v : out) {
+    const int64_t raw = v;
+    if (v < 0) {
+      v += bound;
+    }
+    PD_CHECK(v >= 0 && v < bound,
+             "The index of %s is out of range, expected in [%ld, %ld), but "
+             "received %ld.",
+             op_name,
+             -bound,
+             bound,
+             raw);
+  }
+  return out;
+}
+
+// dst[o, i, :] = src[o, index[i], :]
+template <typename T>
+void GatherSlices(const T* src,
+                  int64_t outer,
+                  int64_t src_rows,
+                  int64_t slice,
+                  const std::vector<int64_t>& index,
+                  T* dst) {
+  const int64_t n = index.size();
+  const int64_t grain = SliceGrain(slice);
+  ParallelFor(0, outer * n, grain, [&](int64_t begin, int64_t end) {
+    if (slice == 1) {
+      for (int64_t k = begin; k < end; ++k) {
+        dst[k] = src[(k / n) * src_rows + index[k % n]];
+      }
+      return;
+    }
+    for (int64_t k = begin; k < end; ++k) {
+      const int64_t o = k / n;
+      std::memcpy(dst + k * slice,
+                  src + (o * src_rows + index[k % n]) * slice,
+                  slice * sizeof(T));
+    }
+  });
+}
+
+// Positions of an index grouped by the row they address, in CSR form:
+// positions[offsets[s] .. offsets[s + 1]) all address rows[s], in ascending
+// position order.
+struct IndexSegments {
+  std::vector<int64_t> rows;
+  std::vector<int64_t> offsets;
+  std::vector<int64_t> positions;
+};
+
+static inline IndexSegments GroupByIndex(const std::vector<int64_t>& index,
+                                         int64_t num_rows) {
+  const int64_t n = index.size();
+  IndexSegments seg;
+  seg.positions.resize(n);
+  if (num_rows <= 4 * n) {
+    // Counting sort, stable by construction.
+    std::vector<int64_t> count(num_rows + 1, 0);
+    for (auto v : index) {
+      ++count[v + 1];
+    }
+    for (int64_t r = 0; r < num_rows; ++r) {
+      if (count[r + 1] > 0) {
+        seg.rows.push_back(r);
+      }
+      count[r + 1] += count[r];
+    }
+    for (auto r : seg.rows) {
+      seg.offsets.push_back(count[r]);
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      seg.positions[count[index[i]]++] = i;
+    }
+  } else {
+    for (int64_t i = 0; i < n; ++i) {
+      seg.positions[i] = i;
+    }
+    std::stable_sort(
+        seg.positions.begin(),
+        seg.positions.end(),
+        [&](int64_t a, int64_t b) { return index[a] < index[b]; });
+    for (int64_t i = 0; i < n; ++i) {
+      if (i == 0 || index[seg.positions[i]] != index[seg.positions[i - 1]]) {
+        seg.rows.push_back(index[seg.positions[i]]);
+        seg.offsets.push_back(i);
+      }
+    }
+  }
+  seg.offsets.push_back(n);
+  return seg;
+}
+
+enum class ScatterMode {
+  // dst row = last src row addressing it.
+  kAssign,
+  // dst row += sum of the src rows addressing it.
+  kAdd,
+  // dst row = sum of the src rows addressing it.
+  kAddToZero,
+};
+
+// Scatters src [outer, index.size(), slice] into dst [outer, dst_rows,
+// slice]. Rows of dst that are not addressed are left untouched.
+template <typename T>
+void ScatterSlices(const T* src,
+                   int64_t outer,
+                   int64_t dst_rows,
+                   int64_t slice,
+                   const std::vector<int64_t>& index,
+                   ScatterMode mode,
+                   T* dst) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const int64_t n = index.size();
+  if (n == 0 || outer == 0) {
+    return;
+  }
+  const IndexSegments seg = GroupByIndex(index, dst_rows);
+  const int64_t num_segments = seg.rows.size();
+  const int64_t grain = SliceGrain(slice);
+
+  ParallelFor(0, outer * num_segments, grain, [&](int64_t begin, int64_t end) {
+    std::vector<MT> acc(mode == ScatterMode::kAssign ? 0 : slice);
+    for (int64_t k = begin; k < end; ++k) {
+      const int64_t o = k / num_segments;
+      const int64_t s = k % num_segments;
+      T* out = dst + (o * dst_rows + seg.rows[s]) * slice;
+      const T* in = src + o * n * slice;
+      if (mode == ScatterMode::kAssign) {
+        const int64_t last = seg.positions[seg.offsets[s + 1] - 1];
+        std::memcpy(out, in + last * slice, slice * sizeof(T));
+        continue;
+      }
+      if (mode == ScatterMode::kAdd) {
+        for (int64_t j = 0; j < slice; ++j) {
+          acc[j] = static_cast<MT>(out[j]);
+        }
+      } else {
+        std::fill(acc.begin(), acc.end(), static_cast<MT>(0));
+      }
+      for (int64_t p = seg.offsets[s]; p < seg.offsets[s + 1]; ++p) {
+        const T* row = in + seg.positions[p] * slice;
+        PD_CPU_SIMD
+        for (int64_t j = 0; j < slice; ++j) {
+          acc[j] += static_cast<MT>(row[j]);
+        }
+      }
+      for (int64_t j = 0; j < slice; ++j) {
+        out[j] = static_cast<T>(acc[j]);
+      }
+    }
+  });
+}
+
+// Sets the addressed rows of dst [outer, dst_rows, slice] to zero.
+template <typename T>
+void ZeroSlices(int64_t outer,
+                int64_t dst_rows,
+                int64_t slice,
+                const std::vector<int64_t>& index,
+                T* dst) {
+  const int64_t n = index.size();
+  const int64_t grain = SliceGrain(slice);
+  ParallelFor(0, outer * n, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t k = begin; k < end; ++k) {
+      std::memset(dst + ((k / n) * dst_rows + index[k % n]) * slice,
+                  0,
+                  slice * sizeof(T));
+    }
+  });
+}
+
+// Row offsets addressed by the last dimension of an N-D index, as used by
+// gather_nd and scatter_nd_add. `x_dims[:index_dims.back()]` is flattened
+// into rows and the remaining dims form the slice.
+static inline std::vector<int64_t> NdIndexToRows(
+    const phi::DenseTensor& index,
+    const std::vector<int64_t>& x_dims,
+    const std::string& op_name) {
+  auto index_dims = index.dims();
+  const int64_t depth = index_dims.empty() ? 0 : index_dims.back();
+  PD_CHECK(depth <= static_cast<int64_t>(x_dims.size()),
+           "The last dimension of the index of %s (%ld) must not exceed the "
+           "rank of x (%ld).",
+           op_name,
+           depth,
+           static_cast<int64_t>(x_dims.size()));
+  // One row per index tuple, i.e. per element of index_dims[:-1].
+  int64_t count = 1;
+  for (size_t i = 0; i + 1 < index_dims.size(); ++i) {
+    count *= index_dims[i];
+  }
+  if (index.numel() == 0) {
+    // a [3, 0] index addresses the whole of x three times, a [0, k] one
+    // nothing; either way there is no index data to read
+    return std::vector<int64_t>(count, 0);
+  }
+  std::vector<int64_t> flat;
+  if (index.dtype() == phi::DataType::INT64) {
+    auto data = index.data<int64_t>();
+    flat.assign(data, data + index.numel());
+  } else if (index.dtype() == phi::DataType::INT32) {
+    auto data = index.data<int32_t>();
+    flat.assign(data, data + index.numel());
+  } else {
+    PD_CHECK(false,
+             "The index of %s must be int32 or int64, but received %s.",
+             op_name,
+             phi::to_string(index.dtype()));
+  }
+  std::vector<int64_t> rows(count, 0);
+  for (int64_t i = 0; i < count; ++i) {
+    int64_t row = 0;
+    for (int64_t d = 0; d < depth; ++d) {
+      int64_t v = flat[i * depth + d];
+      if (v < 0) {
+        v += x_dims[d];
+      }
+      PD_CHECK(v >= 0 && v < x_dims[d],
+               "The index of %s is out of range in dimension %ld, expected "
+               "in [%ld, %ld), but received %ld.",
+               op_name,
+               d,
+               -x_dims[d],
+               x_dims[d],
+               flat[i * depth + d]);
+      row = row * x_dims[d] + v;
+    }
+    rows[i] = row;
+  }
+  return rows;
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,131 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+
+// Building blocks of the quantized linear kernels.
+//
+// Weights are stored output-channel major, i.e. [n, k], so every output
+// element is a dot product over two contiguous rows. The int8 x int8 dot
+// accumulates in int32 and is written as a plain widening multiply-add loop
+// that the compiler vectorizes for the ISA the plugin is built for; there is
+// no runtime dispatch to dot-product instructions such as VNNI or SDOT.
+//
+// Int4 weights pack two output channels per byte over the same k: row r of
+// the packed tensor holds channel 2r in the low nibble and 2r + 1 in the
+// high nibble, so [n, k] int4 is stored as [n / 2, k] int8.
+
+namespace custom_kernel {
+namespace funcs {
+
+constexpr int kInt8Bound = 127;
+constexpr int kInt4Bound = 7;
+
+// Output channels of a weight tile dequantized at once. A tile of
+// kWeightTileRows x k floats stays in L1/L2 while all rows of x use it.
+constexpr int64_t kWeightTileRows = 8;
+
+static inline int8_t QuantizeValue(float v, float inv_scale, int bound) {
+  const float q = std::round(v * inv_scale);
+  return static_cast<int8_t>(
+      std::max<float>(-bound, std::min<float>(bound, q)));
+}
+
+static inline int8_t LowNibble(int8_t packed) {
+  return static_cast<int8_t>(static_cast<int8_t>(packed << 4) >> 4);
+}
+
+static inline int8_t HighNibble(int8_t packed) {
+  return static_cast<int8_t>(packed >> 4);
+}
+
+static inline int8_t PackNibbles(int8_t low, int8_t high) {
+  return static_cast<int8_t>((low & 0x0F) | ((high & 0x0F) << 4));
+}
+
+static inline int32_t Int8Dot(const int8_t* a, const int8_t* b, int64_t k) {
+  int32_t acc = 0;
+  PD_CPU_SIMD_SUM(acc)
+  for (int64_t i = 0; i < k; ++i) {
+    acc += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+  }
+  return acc;
+}
+
+static inline float FloatDot(const float* a, const float* b, int64_t k) {
+  float acc = 0.f;
+  PD_CPU_SIMD_SUM(acc)
+  for (int64_t i = 0; i < k; ++i) {
+    acc += a[i] * b[i];
+  }
+  return acc;
+}
+
+// c[m, n] = a[m, k] . b[n, k]^T with int32 accumulation. The output is
+// split over columns so every thread streams its own block of b once.
+static inline void Int8Gemm(int64_t m,
+                            int64_t n,
+                            int64_t k,
+                            const int8_t* a,
+                            const int8_t* b,
+                            int32_t* c) {
+  const int64_t grain =
+      std::max<int64_t>(1, kParallelGrainSize / std::max<int64_t>(m * k, 1));
+  ParallelFor(0, n, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t j = begin; j < end; ++j) {
+      const int8_t* b_row = b + j * k;
+      for (int64_t i = 0; i < m; ++i) {
+        c[i * n + j] = Int8Dot(a + i * k, b_row, k);
+      }
+    }
+  });
+}
+
+// Dynamic per-row activation quantization: q[i, :] = round(x[i, :] / s[i])
+// with s[i] = absmax(x[i, :]) / 127.
+template <typename T>
+void QuantizeRowsAbsMax(const T* x,
+                        int64_t m,
+                        int64_t k,
+                        int8_t* q,
+                        float* scales) {
+  const int64_t grain =
+      std::max<int64_t>(1, kParallelGrainSize / std::max<int64_t>(k, 1));
+  ParallelFor(0, m, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      const T* row = x + i * k;
+      float absmax = 0.f;
+      for (int64_t j = 0; j < k; ++j) {
+        absmax = std::max(absmax, std::abs(static_cast<float>(row[j])));
+      }
+      const float scale = absmax / kInt8Bound;
+      const float inv_scale = scale > 0.f ? 1.f / scale : 0.f;
+      for (int64_t j = 0; j < k; ++j) {
+        q[i * k + j] =
+            QuantizeValue(static_cast<float>(row[j]), inv_scale, kInt8Bound);
+      }
+      scales[i] = scale;
+    }
+  });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
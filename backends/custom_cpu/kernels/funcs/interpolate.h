@@ -0,0 +1,664 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+
+// Resampling for interpolate (nearest, linear, cubic) and grid_sample.
+//
+// Interpolation is separable: every output pixel (k, l) is
+//   sum_t sum_s wy[k][t] * wx[l][s] * x[iy[k][t]][ix[l][s]],
+// so each axis gets a table of source indices and weights, built once per
+// call from the output size and the ratio alone. The forward resamples
+// one axis after the other, in the order that touches fewer values: either
+// every output row blends whole input rows and is then resampled along w,
+// or the input rows some output row reads are resampled along w into an
+// intermediate that the output rows then blend. An image is viewed as
+// [planes, h, w, vec]: NCHW has vec = 1 and planes = N * C, NHWC has
+// vec = C and planes = N, so channels-last blends C-wide vectors.
+//
+// The backward runs the two passes transposed. Each axis table is inverted
+// into the list of (output index, weight) pairs that read every source
+// index, so every input gradient is a gather summed in increasing output
+// order: no atomics, and the result does not depend on the thread count.
+//
+// grid_sample reads arbitrary points, so it precomputes the corner offsets
+// and weights of every grid point once and shares them across channels.
+
+namespace custom_kernel {
+namespace funcs {
+
+// Accumulation type of resampling: integer images blend in float.
+template <typename T>
+using InterpMT = typename std::
+    conditional<std::is_same<T, double>::value, double, float>::type;
+
+enum class InterpMethod { kNearest, kLinear, kCubic };
+
+// Source per output index of one axis, as in Paddle's reference: the
+// ratio is (in - 1) / (out - 1) with align_corners, else 1 / scale for a
+// positive scale, else in / out.
+inline float InterpRatio(int64_t in,
+                         int64_t out,
+                         float scale,
+                         bool align_corners) {
+  if (out <= 1) {
+    return 0.0f;
+  }
+  if (align_corners) {
+    return static_cast<float>(in - 1) / (out - 1);
+  }
+  return scale > 0.0f ? static_cast<float>(1.0 / scale)
+                      : static_cast<float>(in) / out;
+}
+
+template <typename MT>
+struct InterpAxis {
+  int64_t in = 1;
+  int64_t out = 1;
+  int taps = 1;
+  // Output index o reads index[o * taps + t] with weight[o * taps + t].
+  std::vector<int64_t> index;
+  std::vector<MT> weight;
+  // Source index i is read by the outputs inv_index[j] with weights
+  // inv_weight[j] for j in [inv_offset[i], inv_offset[i + 1]), in
+  // increasing output order.
+  std::vector<int64_t> inv_offset;
+  std::vector<int64_t> inv_index;
+  std::vector<MT> inv_weight;
+};
+
+// Keys' cubic convolution with A = -0.75 at fraction t of the 4 taps.
+template <typename MT>
+inline void CubicWeights(MT t, MT* w) {
+  const MT a = static_cast<MT>(-0.75);
+  auto near = [a](MT x) { return ((a + 2) * x - (a + 3)) * x * x + 1; };
+  auto far = [a](MT x) { return ((a * x - 5 * a) * x + 8 * a) * x - 4 * a; };
+  w[0] = far(t + 1);
+  w[1] = near(t);
+  w[2] = near(1 - t);
+  w[3] = far(2 - t);
+}
+
+template <typename MT>
+InterpAxis<MT> MakeInterpAxis(InterpMethod method,
+                              int64_t in,
+                              int64_t out,
+                              float ratio,
+                              bool align_corners,
+                              int align_mode) {
+  InterpAxis<MT> axis;
+  axis.in = in;
+  axis.out = out;
+  axis.taps = method == InterpMethod::kCubic    ? 4
+              : method == InterpMethod::kLinear ? 2
+                                                : 1;
+  axis.index.resize(out * axis.taps);
+  axis.weight.resize(out * axis.taps);
+  const bool half_pixel = align_mode == 0 && !align_corners;
+  for (int64_t o = 0; o < out; ++o) {
+    int64_t* index = axis.index.data() + o * axis.taps;
+    MT* weight = axis.weight.data() + o * axis.taps;
+    if (method == InterpMethod::kNearest) {
+      const float src = align_corners ? ratio * o + 0.5f : ratio * o;
+      index[0] = std::min<int64_t>(static_cast<int64_t>(src), in - 1);
+      weight[0] = 1;
+    } else if (method == InterpMethod::kLinear) {
+      const float center = ratio * (o + 0.5f) - 0.5f;
+      int64_t i0 = half_pixel ? static_cast<int64_t>(center)
+                              : static_cast<int64_t>(ratio * o);
+      i0 = std::min<int64_t>(std::max<int64_t>(i0, 0), in - 1);
+      const float lambda =
+          half_pixel ? std::max(center, 0.0f) - i0 : ratio * o - i0;
+      index[0] = i0;
+      index[1] = std::min<int64_t>(i0 + 1, in - 1);
+      weight[0] = static_cast<MT>(1.0f - lambda);
+      weight[1] = static_cast<MT>(lambda);
+    } else {
+      const MT src = align_corners
+                         ? static_cast<MT>(ratio * o)
+                         : static_cast<MT>(ratio * (o + 0.5f) - 0.5f);
+      const MT floor = std::floor(src);
+      for (int t = 0; t < 4; ++t) {
+        index[t] = std::min<int64_t>(
+            std::max<int64_t>(static_cast<int64_t>(floor) - 1 + t, 0),
+            in - 1);
+      }
+      CubicWeights<MT>(src - floor, weight);
+    }
+  }
+
+  // Counting sort of the (output, tap) pairs by source index; outputs are
+  // visited in increasing order, so every list comes out sorted.
+  axis.inv_offset.assign(in + 1, 0);
+  for (int64_t i : axis.index) {
+    ++axis.inv_offset[i + 1];
+  }
+  for (int64_t i = 0; i < in; ++i) {
+    axis.inv_offset[i + 1] += axis.inv_offset[i];
+  }
+  std::vector<int64_t> next(axis.inv_offset.begin(), axis.inv_offset.end() - 1);
+  axis.inv_index.resize(axis.index.size());
+  axis.inv_weight.resize(axis.index.size());
+  for (int64_t j = 0; j < static_cast<int64_t>(axis.index.size()); ++j) {
+    const int64_t pos = next[axis.index[j]]++;
+    axis.inv_index[pos] = j / axis.taps;
+    axis.inv_weight[pos] = axis.weight[j];
+  }
+  return axis;
+}
+
+// An image viewed as [planes, h, w, vec].
+struct InterpShape {
+  int64_t planes = 1;
+  int64_t vec = 1;
+  int64_t in_h = 1;
+  int64_t in_w = 1;
+  int64_t out_h = 1;
+  int64_t out_w = 1;
+};
+
+// Slot of every input row some output row reads in the intermediate of the
+// separable passes, or -1; returns the number of such rows.
+template <typename MT>
+int64_t InterpRowSlots(const InterpAxis<MT>& ay, std::vector<int64_t>* slot) {
+  slot->assign(ay.in, -1);
+  int64_t rows = 0;
+  for (int64_t i = 0; i < ay.in; ++i) {
+    if (ay.inv_offset[i + 1] > ay.inv_offset[i]) {
+      (*slot)[i] = rows++;
+    }
+  }
+  return rows;
+}
+
+// dst[0, n) = sum_t w[t] * src[t][0, n), in tap order.
+template <typename MT, typename S>
+inline void InterpBlend(
+    int taps, const MT* w, const S* const* src, int64_t n, MT* dst) {
+  const S* s0 = src[0];
+  const MT w0 = w[0];
+  PD_CPU_SIMD
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = w0 * static_cast<MT>(s0[i]);
+  }
+  for (int t = 1; t < taps; ++t) {
+    const S* s = src[t];
+    const MT wt = w[t];
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < n; ++i) {
+      dst[i] += wt * static_cast<MT>(s[i]);
+    }
+  }
+}
+
+// Integer images saturate, since cubic weights overshoot.
+template <typename T, typename MT>
+inline void InterpStore(const MT* src, int64_t n, T* dst) {
+  if (std::is_integral<T>::value) {
+    const MT lo = static_cast<MT>(std::numeric_limits<T>::lowest());
+    const MT hi = static_cast<MT>(std::numeric_limits<T>::max());
+    for (int64_t i = 0; i < n; ++i) {
+      dst[i] = static_cast<T>(std::min(std::max(src[i], lo), hi));
+    }
+    return;
+  }
+  PD_CPU_SIMD
+  for (int64_t i = 0; i < n; ++i) {
+    dst[i] = static_cast<T>(src[i]);
+  }
+}
+
+template <typename T, typename MT>
+void InterpForward(const InterpShape& s,
+                   const InterpAxis<MT>& ay,
+                   const InterpAxis<MT>& ax,
+                   const T* x,
+                   T* out) {
+  if (s.planes * s.vec * s.out_h * s.out_w == 0) {
+    return;
+  }
+  const int64_t vec = s.vec;
+  const int64_t in_row = s.in_w * vec;
+  const int64_t out_row = s.out_w * vec;
+  const int64_t row_grain = std::max<int64_t>(1, kParallelGrainSize / out_row);
+
+  if (ay.taps == 1 && ax.taps == 1) {
+    // Nearest neighbour is a gather of whole vectors.
+    ParallelFor(0, s.planes * s.out_h, row_grain, [&](int64_t b, int64_t e) {
+      for (int64_t r = b; r < e; ++r) {
+        const int64_t p = r / s.out_h;
+        const T* src = x + (p * s.in_h + ay.index[r % s.out_h]) * in_row;
+        T* dst = out + r * out_row;
+        for (int64_t l = 0; l < s.out_w; ++l) {
+          const T* v = src + ax.index[l] * vec;
+          std::copy(v, v + vec, dst + l * vec);
+        }
+      }
+    });
+    return;
+  }
+
+  std::vector<int64_t> slot;
+  const int64_t rows = InterpRowSlots(ay, &slot);
+  if (s.out_h * s.in_w * ay.taps <= rows * s.out_w * ax.taps) {
+    // Vertical pass first, one output row at a time: blend the input rows
+    // into a row of in_w vectors, then resample it horizontally.
+    ParallelFor(0, s.planes * s.out_h, row_grain, [&](int64_t b, int64_t e) {
+      const T* src[4];
+      const MT* mid[4];
+      std::vector<MT> row(in_row);
+      std::vector<MT> acc(out_row);
+      for (int64_t r = b; r < e; ++r) {
+        const int64_t p = r / s.out_h;
+        const int64_t k = r % s.out_h;
+        for (int t = 0; t < ay.taps; ++t) {
+          src[t] = x + (p * s.in_h + ay.index[k * ay.taps + t]) * in_row;
+        }
+        InterpBlend<MT, T>(
+            ay.taps, ay.weight.data() + k * ay.taps, src, in_row, row.data());
+        for (int64_t l = 0; l < s.out_w; ++l) {
+          const int64_t* index = ax.index.data() + l * ax.taps;
+          const MT* weight = ax.weight.data() + l * ax.taps;
+          if (vec == 1) {
+            MT sum = weight[0] * row[index[0]];
+            for (int t = 1; t < ax.taps; ++t) {
+              sum += weight[t] * row[index[t]];
+            }
+            acc[l] = sum;
+          } else {
+            for (int t = 0; t < ax.taps; ++t) {
+              mid[t] = row.data() + index[t] * vec;
+            }
+            InterpBlend<MT, MT>(ax.taps, weight, mid, vec, &acc[l * vec]);
+          }
+        }
+        InterpStore(acc.data(), out_row, out + r * out_row);
+      }
+    });
+    return;
+  }
+
+  // Horizontal pass over the rows that are read, in the accumulation type.
+  std::vector<int64_t> used;
+  for (int64_t i = 0; i < s.in_h; ++i) {
+    if (slot[i] >= 0) {
+      used.push_back(i);
+    }
+  }
+  std::vector<MT> tmp(s.planes * rows * out_row);
+  ParallelFor(0, s.planes * rows, row_grain, [&](int64_t b, int64_t e) {
+    const T* src[4];
+    for (int64_t r = b; r < e; ++r) {
+      const int64_t p = r / rows;
+      const T* row = x + (p * s.in_h + used[r % rows]) * in_row;
+      MT* dst = tmp.data() + r * out_row;
+      for (int64_t l = 0; l < s.out_w; ++l) {
+        const int64_t* index = ax.index.data() + l * ax.taps;
+        const MT* weight = ax.weight.data() + l * ax.taps;
+        if (vec == 1) {
+          MT acc = weight[0] * static_cast<MT>(row[index[0]]);
+          for (int t = 1; t < ax.taps; ++t) {
+            acc += weight[t] * static_cast<MT>(row[index[t]]);
+          }
+          dst[l] = acc;
+        } else {
+          for (int t = 0; t < ax.taps; ++t) {
+            src[t] = row + index[t] * vec;
+          }
+          InterpBlend<MT, T>(ax.taps, weight, src, vec, dst + l * vec);
+        }
+      }
+    }
+  });
+
+  // Vertical pass: every output row blends whole intermediate rows.
+  ParallelFor(0, s.planes * s.out_h, row_grain, [&](int64_t b, int64_t e) {
+    const MT* src[4];
+    std::vector<MT> acc(std::is_same<T, MT>::value ? 0 : out_row);
+    for (int64_t r = b; r < e; ++r) {
+      const int64_t p = r / s.out_h;
+      const int64_t k = r % s.out_h;
+      for (int t = 0; t < ay.taps; ++t) {
+        src[t] = tmp.data() +
+                 (p * rows + slot[ay.index[k * ay.taps + t]]) * out_row;
+      }
+      const MT* weight = ay.weight.data() + k * ay.taps;
+      T* dst = out + r * out_row;
+      if (std::is_same<T, MT>::value) {
+        InterpBlend<MT, MT>(
+            ay.taps, weight, src, out_row, reinterpret_cast<MT*>(dst));
+      } else {
+        InterpBlend<MT, MT>(ay.taps, weight, src, out_row, acc.data());
+        InterpStore(acc.data(), out_row, dst);
+      }
+    }
+  });
+}
+
+// The forward transposed: dx[i] = sum over the outputs o reading i of
+// w(o, i) * dout[o], per axis, summed in increasing o.
+template <typename T, typename MT>
+void InterpBackward(const InterpShape& s,
+                    const InterpAxis<MT>& ay,
+                    const InterpAxis<MT>& ax,
+                    const T* out_grad,
+                    T* x_grad) {
+  const int64_t vec = s.vec;
+  const int64_t in_row = s.in_w * vec;
+  const int64_t out_row = s.out_w * vec;
+  if (s.planes * in_row * s.in_h == 0) {
+    return;
+  }
+  if (s.out_h * out_row == 0) {
+    // no output reads any input
+    std::fill(x_grad, x_grad + s.planes * s.in_h * in_row, static_cast<T>(0));
+    return;
+  }
+
+  // Vertical pass: the gradient of every intermediate row.
+  std::vector<int64_t> slot;
+  const int64_t rows = InterpRowSlots(ay, &slot);
+  std::vector<int64_t> used;
+  for (int64_t i = 0; i < s.in_h; ++i) {
+    if (slot[i] >= 0) {
+      used.push_back(i);
+    }
+  }
+  std::vector<MT> tmp(s.planes * rows * out_row);
+  const int64_t tmp_grain = std::max<int64_t>(1, kParallelGrainSize / out_row);
+  ParallelFor(0, s.planes * rows, tmp_grain, [&](int64_t b, int64_t e) {
+    for (int64_t r = b; r < e; ++r) {
+      const int64_t p = r / rows;
+      const int64_t i = used[r % rows];
+      MT* dst = tmp.data() + r * out_row;
+      for (int64_t j = ay.inv_offset[i]; j < ay.inv_offset[i + 1]; ++j) {
+        const T* src = out_grad + (p * s.out_h + ay.inv_index[j]) * out_row;
+        const MT w = ay.inv_weight[j];
+        if (j == ay.inv_offset[i]) {
+          PD_CPU_SIMD
+          for (int64_t c = 0; c < out_row; ++c) {
+            dst[c] = w * static_cast<MT>(src[c]);
+          }
+        } else {
+          PD_CPU_SIMD
+          for (int64_t c = 0; c < out_row; ++c) {
+            dst[c] += w * static_cast<MT>(src[c]);
+          }
+        }
+      }
+    }
+  });
+
+  // Horizontal pass into every input row; rows nobody reads get zeros.
+  const int64_t row_grain = std::max<int64_t>(1, kParallelGrainSize / in_row);
+  ParallelFor(0, s.planes * s.in_h, row_grain, [&](int64_t b, int64_t e) {
+    std::vector<MT> acc(vec);
+    for (int64_t r = b; r < e; ++r) {
+      const int64_t p = r / s.in_h;
+      const int64_t i = r % s.in_h;
+      T* dst = x_grad + r * in_row;
+      if (slot[i] < 0) {
+        std::fill(dst, dst + in_row, static_cast<T>(0));
+        continue;
+      }
+      const MT* src = tmp.data() + (p * rows + slot[i]) * out_row;
+      for (int64_t q = 0; q < s.in_w; ++q) {
+        std::fill(acc.begin(), acc.end(), static_cast<MT>(0));
+        for (int64_t j = ax.inv_offset[q]; j < ax.inv_offset[q + 1]; ++j) {
+          const MT* v = src + ax.inv_index[j] * vec;
+          const MT w = ax.inv_weight[j];
+          PD_CPU_SIMD
+          for (int64_t c = 0; c < vec; ++c) {
+            acc[c] += w * v[c];
+          }
+        }
+        InterpStore(acc.data(), vec, dst + q * vec);
+      }
+    }
+  });
+}
+
+enum class GridPadding { kZeros, kBorder, kReflection };
+
+// Source coordinate of a normalized grid coordinate g on an axis of `size`
+// pixels; *scale receives d(source) / d(g), 0 where padding clamps.
+template <typename MT>
+MT GridSampleSource(
+    MT g, int64_t size, GridPadding padding, bool align_corners, MT* scale) {
+  const MT max_val = static_cast<MT>(size - 1);
+  const MT half = align_corners ? max_val / 2 : static_cast<MT>(size) / 2;
+  MT v = align_corners ? half * (g + 1) : half * (g + 1) - MT(0.5);
+  *scale = half;
+  if (padding == GridPadding::kBorder) {
+    if (!(v > 0 && v < max_val)) {
+      *scale = 0;
+    }
+    v = std::min(std::max(v, MT(0)), max_val);
+  } else if (padding == GridPadding::kReflection) {
+    // Reflect about the border pixels' centers (align_corners) or edges.
+    if (align_corners && size == 1) {
+      *scale = 0;
+      return 0;
+    }
+    const MT shift = align_corners ? MT(0) : MT(0.5);
+    const MT range = align_corners ? 2 * max_val : static_cast<MT>(2 * size);
+    const MT a = std::abs(v + shift);
+    const MT extra = a - std::floor(a / range) * range;
+    const bool flip = extra > range - extra;
+    if ((v + shift < 0) != flip) {
+      *scale = -*scale;
+    }
+    v = std::min(extra, range - extra) - shift;
+    if (!align_corners) {
+      if (!(v > 0 && v < max_val)) {
+        *scale = 0;
+      }
+      v = std::min(std::max(v, MT(0)), max_val);
+    }
+  }
+  return v;
+}
+
+// The corners a grid point reads: offset -1 marks a corner outside the
+// image, which reads zeros. Nearest uses corner 0 only.
+template <typename MT>
+struct GridSampleTap {
+  int64_t offset[4];
+  MT weight[4];
+  // Fractions of the source point past its north-west corner, and the
+  // chain factors d(source) / d(grid) of both axes.
+  MT fx, fy;
+  MT sx, sy;
+};
+
+template <typename T, typename MT>
+std::vector<GridSampleTap<MT>> MakeGridSampleTaps(const T* grid,
+                                                  int64_t points,
+                                                  int64_t in_h,
+                                                  int64_t in_w,
+                                                  bool nearest,
+                                                  GridPadding padding,
+                                                  bool align_corners) {
+  std::vector<GridSampleTap<MT>> taps(points);
+  ParallelFor(0, points, kParallelGrainSize / 64, [&](int64_t b, int64_t e) {
+    for (int64_t p = b; p < e; ++p) {
+      auto& tap = taps[p];
+      MT x = GridSampleSource<MT>(static_cast<MT>(grid[2 * p]),
+                                  in_w,
+                                  padding,
+                                  align_corners,
+                                  &tap.sx);
+      MT y = GridSampleSource<MT>(static_cast<MT>(grid[2 * p + 1]),
+                                  in_h,
+                                  padding,
+                                  align_corners,
+                                  &tap.sy);
+      // Far outside (or NaN) reads zeros just like one pixel outside.
+      x = x > -2 ? std::min<MT>(x, in_w + 1) : MT(-2);
+      y = y > -2 ? std::min<MT>(y, in_h + 1) : MT(-2);
+      auto at = [&](int64_t cy, int64_t cx) -> int64_t {
+        return cy >= 0 && cy < in_h && cx >= 0 && cx < in_w ? cy * in_w + cx
+                                                            : -1;
+      };
+      if (nearest) {
+        tap.offset[0] = at(static_cast<int64_t>(std::nearbyint(y)),
+                           static_cast<int64_t>(std::nearbyint(x)));
+        tap.weight[0] = 1;
+        tap.fx = tap.fy = 0;
+        continue;
+      }
+      const MT x0 = std::floor(x);
+      const MT y0 = std::floor(y);
+      const int64_t w = static_cast<int64_t>(x0);
+      const int64_t n = static_cast<int64_t>(y0);
+      tap.fx = x - x0;
+      tap.fy = y - y0;
+      const MT ex = x0 + 1 - x;
+      const MT sy = y0 + 1 - y;
+      tap.offset[0] = at(n, w);
+      tap.offset[1] = at(n, w + 1);
+      tap.offset[2] = at(n + 1, w);
+      tap.offset[3] = at(n + 1, w + 1);
+      tap.weight[0] = ex * sy;
+      tap.weight[1] = tap.fx * sy;
+      tap.weight[2] = ex * tap.fy;
+      tap.weight[3] = tap.fx * tap.fy;
+    }
+  });
+  return taps;
+}
+
+// x: [N, C, H, W], taps: [N, P] -> out: [N, C, P].
+template <typename T, typename MT>
+void GridSampleForward(const std::vector<GridSampleTap<MT>>& taps,
+                       int64_t batch,
+                       int64_t channels,
+                       int64_t in_size,
+                       int64_t points,
+                       int corners,
+                       const T* x,
+                       T* out) {
+  const int64_t planes = batch * channels;
+  const int64_t total = planes * points;
+  ParallelFor(0, total, kParallelGrainSize, [&](int64_t b, int64_t e) {
+    for (int64_t i = b; i < e;) {
+      const int64_t plane = i / points;
+      const int64_t first = i % points;
+      const int64_t last = std::min(points, first + (e - i));
+      const T* src = x + plane * in_size;
+      const auto* tap = taps.data() + (plane / channels) * points;
+      T* dst = out + plane * points;
+      for (int64_t p = first; p < last; ++p) {
+        MT acc = 0;
+        for (int c = 0; c < corners; ++c) {
+          const int64_t o = tap[p].offset[c];
+          if (o >= 0) {
+            acc += tap[p].weight[c] * static_cast<MT>(src[o]);
+          }
+        }
+        dst[p] = static_cast<T>(acc);
+      }
+      i += last - first;
+    }
+  });
+}
+
+// x_grad scatters every plane's points in order on one thread; grid_grad
+// sums the channels of every point in order.
+template <typename T, typename MT>
+void GridSampleBackward(const std::vector<GridSampleTap<MT>>& taps,
+                        int64_t batch,
+                        int64_t channels,
+                        int64_t in_size,
+                        int64_t points,
+                        int corners,
+                        const T* x,
+                        const T* out_grad,
+                        T* x_grad,
+                        T* grid_grad) {
+  const int64_t planes = batch * channels;
+  if (points == 0 || channels == 0) {
+    // nothing was sampled, or nothing read the grid
+    if (x_grad != nullptr) {
+      std::fill(x_grad, x_grad + planes * in_size, static_cast<T>(0));
+    }
+    if (grid_grad != nullptr) {
+      std::fill(grid_grad, grid_grad + 2 * batch * points, static_cast<T>(0));
+    }
+    return;
+  }
+  if (x_grad != nullptr) {
+    const int64_t grain = std::max<int64_t>(1, kParallelGrainSize / points);
+    ParallelFor(0, planes, grain, [&](int64_t b, int64_t e) {
+      std::vector<MT> acc(in_size);
+      for (int64_t plane = b; plane < e; ++plane) {
+        std::fill(acc.begin(), acc.end(), static_cast<MT>(0));
+        const T* dout = out_grad + plane * points;
+        const auto* tap = taps.data() + (plane / channels) * points;
+        for (int64_t p = 0; p < points; ++p) {
+          const MT g = static_cast<MT>(dout[p]);
+          for (int c = 0; c < corners; ++c) {
+            const int64_t o = tap[p].offset[c];
+            if (o >= 0) {
+              acc[o] += tap[p].weight[c] * g;
+            }
+          }
+        }
+        InterpStore(acc.data(), in_size, x_grad + plane * in_size);
+      }
+    });
+  }
+  if (grid_grad == nullptr) {
+    return;
+  }
+  const int64_t grain = std::max<int64_t>(1, kParallelGrainSize / channels);
+  ParallelFor(0, batch * points, grain, [&](int64_t b, int64_t e) {
+    for (int64_t i = b; i < e; ++i) {
+      const auto& tap = taps[i];
+      MT gx = 0, gy = 0;
+      if (corners == 4) {
+        const int64_t n = i / points;
+        const int64_t p = i % points;
+        const MT ex = 1 - tap.fx;
+        const MT sy = 1 - tap.fy;
+        for (int64_t c = 0; c < channels; ++c) {
+          const T* src = x + (n * channels + c) * in_size;
+          MT v[4];
+          for (int k = 0; k < 4; ++k) {
+            v[k] = tap.offset[k] >= 0 ? static_cast<MT>(src[tap.offset[k]])
+                                      : MT(0);
+          }
+          const MT g =
+              static_cast<MT>(out_grad[(n * channels + c) * points + p]);
+          gx += g * ((v[1] - v[0]) * sy + (v[3] - v[2]) * tap.fy);
+          gy += g * ((v[2] - v[0]) * ex + (v[3] - v[1]) * tap.fx);
+        }
+      }
+      grid_grad[2 * i] = static_cast<T>(gx * tap.sx);
+      grid_grad[2 * i + 1] = static_cast<T>(gy * tap.sy);
+    }
+  });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
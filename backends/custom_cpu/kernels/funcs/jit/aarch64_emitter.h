@@ -0,0 +1,153 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Minimal AArch64 assembler for the custom_cpu JIT kernels: integer
+// bookkeeping plus NEON single precision ops on full 128-bit vectors
+// (Vd.4S). Operands are register numbers (x0 ... x30, v0 ... v31).
+
+namespace custom_kernel {
+namespace funcs {
+namespace jit {
+
+class AArch64Emitter {
+ public:
+  // Three register NEON ops, "op Vd.4S, Vn.4S, Vm.4S".
+  enum VecOp3 : uint32_t {
+    kFadd = 0x4E20D400,
+    kFsub = 0x4EA0D400,
+    kFmul = 0x6E20DC00,
+    kFdiv = 0x6E20FC00,
+    kFcmeq = 0x4E20E400,
+    kFcmge = 0x6E20E400,
+    kFcmgt = 0x6EA0E400,
+    kAnd = 0x4E201C00,
+    kBic = 0x4E601C00,
+    kOrr = 0x4EA01C00,
+    kBsl = 0x6E601C00,
+  };
+
+  // Two register NEON ops, "op Vd.4S, Vn.4S".
+  enum VecOp2 : uint32_t {
+    kFsqrt = 0x6EA1F800,
+    kFneg = 0x6EA0F800,
+    kFabs = 0x4EA0F800,
+    kNot = 0x6E205800,
+    kFcmeqZero = 0x4EA0D800,
+  };
+
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+  size_t size() const { return bytes_.size(); }
+
+  void Vec3(VecOp3 op, int d, int n, int m) {
+    Emit(op | static_cast<uint32_t>(m) << 16 | static_cast<uint32_t>(n) << 5 |
+         static_cast<uint32_t>(d));
+  }
+
+  void Vec2(VecOp2 op, int d, int n) {
+    Emit(op | static_cast<uint32_t>(n) << 5 | static_cast<uint32_t>(d));
+  }
+
+  // mov Vd.16B, Vn.16B
+  void VecMov(int d, int n) { Vec3(kOrr, d, n, n); }
+
+  // movi Vd.4S, #0
+  void VecZero(int d) { Emit(0x4F000400 | static_cast<uint32_t>(d)); }
+
+  // ldr Qt, [Xn, Xm]
+  void LdrQ(int t, int n, int m) {
+    Emit(0x3CE06800 | static_cast<uint32_t>(m) << 16 |
+         static_cast<uint32_t>(n) << 5 | static_cast<uint32_t>(t));
+  }
+
+  // str Qt, [Xn, Xm]
+  void StrQ(int t, int n, int m) {
+    Emit(0x3CA06800 | static_cast<uint32_t>(m) << 16 |
+         static_cast<uint32_t>(n) << 5 | static_cast<uint32_t>(t));
+  }
+
+  // ld1r {Vt.4S}, [Xn]
+  void Ld1r(int t, int n) {
+    Emit(0x4D40C800 | static_cast<uint32_t>(n) << 5 | static_cast<uint32_t>(t));
+  }
+
+  // add Xd, Xn, #imm12
+  void AddImm(int d, int n, uint32_t imm12) {
+    Emit(0x91000000 | (imm12 & 0xFFF) << 10 | static_cast<uint32_t>(n) << 5 |
+         static_cast<uint32_t>(d));
+  }
+
+  // subs Xd, Xn, #imm12
+  void SubsImm(int d, int n, uint32_t imm12) {
+    Emit(0xF1000000 | (imm12 & 0xFFF) << 10 | static_cast<uint32_t>(n) << 5 |
+         static_cast<uint32_t>(d));
+  }
+
+  // mov Xd, #0
+  void MovZero(int d) { Emit(0xD2800000 | static_cast<uint32_t>(d)); }
+
+  // cbz Xt, <patched later>; returns the instruction offset for Patch.
+  size_t Cbz(int t) {
+    const size_t at = bytes_.size();
+    Emit(0xB4000000 | static_cast<uint32_t>(t));
+    return at;
+  }
+
+  // b.ne target (target already emitted)
+  void BneTo(size_t target) {
+    const size_t at = bytes_.size();
+    Emit(0x54000001 | Imm19(at, target));
+  }
+
+  // Points the branch at `at` (cbz / b.cond) to `target`.
+  void PatchImm19(size_t at, size_t target) {
+    uint32_t insn = Read(at) | Imm19(at, target);
+    for (int i = 0; i < 4; ++i) {
+      bytes_[at + i] = static_cast<uint8_t>(insn >> (8 * i));
+    }
+  }
+
+  void Ret() { Emit(0xD65F03C0); }
+
+ private:
+  static uint32_t Imm19(size_t at, size_t target) {
+    const int64_t words =
+        (static_cast<int64_t>(target) - static_cast<int64_t>(at)) / 4;
+    return (static_cast<uint32_t>(words) & 0x7FFFF) << 5;
+  }
+
+  uint32_t Read(size_t at) const {
+    uint32_t insn = 0;
+    for (int i = 0; i < 4; ++i) {
+      insn |= static_cast<uint32_t>(bytes_[at + i]) << (8 * i);
+    }
+    return insn;
+  }
+
+  void Emit(uint32_t insn) {
+    for (int i = 0; i < 4; ++i) {
+      bytes_.push_back(static_cast<uint8_t>(insn >> (8 * i)));
+    }
+  }
+
+  std::vector<uint8_t> bytes_;
+};
+
+}  // namespace jit
+}  // namespace funcs
+}  // namespace custom_kernel
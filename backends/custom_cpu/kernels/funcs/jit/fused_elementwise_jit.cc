@@ -0,0 +1,408 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/jit/fused_elementwise_jit.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "kernels/funcs/jit/aarch64_emitter.h"
+#include "kernels/funcs/jit/x64_emitter.h"
+
+namespace custom_kernel {
+namespace funcs {
+namespace jit {
+
+namespace {
+
+// Constants are addressed with 12-bit immediates on AArch64.
+constexpr size_t kMaxJitConstants = 1024;
+
+class ConstantPool {
+ public:
+  // Index of `value`, added on first use.
+  int Index(float value) {
+    for (size_t i = 0; i < values_.size(); ++i) {
+      if (std::memcmp(&values_[i], &value, sizeof(float)) == 0) {
+        return static_cast<int>(i);
+      }
+    }
+    values_.push_back(value);
+    return static_cast<int>(values_.size() - 1);
+  }
+
+  std::vector<float>& values() { return values_; }
+
+ private:
+  std::vector<float> values_;
+};
+
+std::string ProgramKey(const FusedProgram& program, Isa isa) {
+  std::string key = "fused_elementwise|float32|";
+  key += IsaName(isa);
+  char buffer[32];
+  for (const auto& instr : program.instrs()) {
+    uint32_t bits;
+    std::memcpy(&bits, &instr.value, sizeof(bits));
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  "|%d:%d:%08x",
+                  static_cast<int>(instr.code),
+                  instr.input,
+                  bits);
+    key += buffer;
+  }
+  return key;
+}
+
+// ---------------------------------------------------------------- AVX2 ---
+
+// Stack slot s is ymm s; ymm8 and ymm9 are scratch.
+bool EmitAvx2(const FusedProgram& program,
+              ConstantPool* pool,
+              std::vector<uint8_t>* code) {
+  using E = X64Emitter;
+  constexpr int kT0 = 8;
+  constexpr int kT1 = 9;
+  const int input_regs[kFusionMaxInputs] = {x64::kRdi, x64::kRsi, x64::kRdx};
+  E e;
+  auto broadcast = [&](int dst, float value) {
+    e.VbroadcastssMem(dst, x64::kR9, 4 * pool->Index(value));
+  };
+
+  e.Test(x64::kR8, x64::kR8);
+  const size_t skip = e.Jz();
+  e.XorReg32(x64::kRax, x64::kRax);
+  const size_t loop = e.size();
+  int sp = 0;
+  for (const auto& instr : program.instrs()) {
+    const int a = sp - 2;
+    const int b = sp - 1;
+    switch (instr.code) {
+      case FusedOpCode::kInput:
+        e.VmovupsLoad(sp++, input_regs[instr.input], x64::kRax);
+        break;
+      case FusedOpCode::kConst:
+        broadcast(sp++, instr.value);
+        break;
+      case FusedOpCode::kRelu:
+        e.VecOp(E::kVxorps, kT0, kT0, kT0);
+        e.VecOp(E::kVmaxps, b, b, kT0);
+        break;
+      case FusedOpCode::kNeg:
+        broadcast(kT0, -0.0f);
+        e.VecOp(E::kVxorps, b, b, kT0);
+        break;
+      case FusedOpCode::kAbs:
+        broadcast(kT0, -0.0f);
+        e.VecOp(E::kVandnps, b, kT0, b);
+        break;
+      case FusedOpCode::kSqrt:
+        e.Vsqrtps(b, b);
+        break;
+      case FusedOpCode::kRsqrt:
+        e.Vsqrtps(b, b);
+        broadcast(kT0, 1.0f);
+        e.VecOp(E::kVdivps, b, kT0, b);
+        break;
+      case FusedOpCode::kSquare:
+        e.VecOp(E::kVmulps, b, b, b);
+        break;
+      case FusedOpCode::kReciprocal:
+        broadcast(kT0, 1.0f);
+        e.VecOp(E::kVdivps, b, kT0, b);
+        break;
+      case FusedOpCode::kAdd:
+        e.VecOp(E::kVaddps, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kSub:
+        e.VecOp(E::kVsubps, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kMul:
+        e.VecOp(E::kVmulps, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kDiv:
+        e.VecOp(E::kVdivps, a, a, b);
+        --sp;
+        break;
+      // vmaxps/vminps return the second operand on NaN, like a > b ? a : b.
+      case FusedOpCode::kMax:
+        e.VecOp(E::kVmaxps, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kMin:
+        e.VecOp(E::kVminps, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kEqual:
+      case FusedOpCode::kNotEqual:
+      case FusedOpCode::kLess:
+      case FusedOpCode::kLessEqual:
+      case FusedOpCode::kGreater:
+      case FusedOpCode::kGreaterEqual: {
+        E::CmpPredicate predicate =
+            instr.code == FusedOpCode::kEqual      ? E::kCmpEq
+            : instr.code == FusedOpCode::kNotEqual ? E::kCmpNeq
+            : instr.code == FusedOpCode::kLess     ? E::kCmpLt
+            : instr.code == FusedOpCode::kLessEqual ? E::kCmpLe
+            : instr.code == FusedOpCode::kGreater  ? E::kCmpGt
+                                                   : E::kCmpGe;
+        e.Vcmpps(a, a, b, predicate);
+        broadcast(kT0, 1.0f);
+        e.VecOp(E::kVandps, a, a, kT0);
+        --sp;
+        break;
+      }
+      case FusedOpCode::kWhere: {
+        const int cond = sp - 3;
+        e.VecOp(E::kVxorps, kT1, kT1, kT1);
+        e.Vcmpps(kT0, cond, kT1, E::kCmpNeq);
+        e.Vblendvps(cond, b, a, kT0);
+        sp -= 2;
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  e.VmovupsStore(x64::kRcx, x64::kRax, 0);
+  e.AddImm8(x64::kRax, 32);
+  e.SubImm8(x64::kR8, 8);
+  e.JnzTo(loop);
+  e.PatchRel32(skip, e.size());
+  e.Vzeroupper();
+  e.Ret();
+  *code = e.bytes();
+  return true;
+}
+
+// ---------------------------------------------------------------- NEON ---
+
+// Arguments arrive in x0-x5; x6 is the byte offset, x7 the constant
+// address. Stack slot s is v s; v16 and v17 are scratch (v8-v15 are callee
+// saved).
+bool EmitNeon(const FusedProgram& program,
+              ConstantPool* pool,
+              std::vector<uint8_t>* code) {
+  using E = AArch64Emitter;
+  constexpr int kOffset = 6;
+  constexpr int kConstAddr = 7;
+  constexpr int kT0 = 16;
+  constexpr int kT1 = 17;
+  E e;
+  auto broadcast = [&](int dst, float value) {
+    e.AddImm(kConstAddr, 5, 4 * pool->Index(value));
+    e.Ld1r(dst, kConstAddr);
+  };
+
+  const size_t skip = e.Cbz(4);
+  e.MovZero(kOffset);
+  const size_t loop = e.size();
+  int sp = 0;
+  for (const auto& instr : program.instrs()) {
+    const int a = sp - 2;
+    const int b = sp - 1;
+    switch (instr.code) {
+      case FusedOpCode::kInput:
+        e.LdrQ(sp++, instr.input, kOffset);
+        break;
+      case FusedOpCode::kConst:
+        broadcast(sp++, instr.value);
+        break;
+      // relu, max and min are compare + select so NaN inputs give the
+      // same result as the interpreter (fmax would propagate the NaN).
+      case FusedOpCode::kRelu:
+        e.VecZero(kT0);
+        e.Vec3(E::kFcmgt, kT0, b, kT0);
+        e.Vec3(E::kAnd, b, b, kT0);
+        break;
+      case FusedOpCode::kNeg:
+        e.Vec2(E::kFneg, b, b);
+        break;
+      case FusedOpCode::kAbs:
+        e.Vec2(E::kFabs, b, b);
+        break;
+      case FusedOpCode::kSqrt:
+        e.Vec2(E::kFsqrt, b, b);
+        break;
+      case FusedOpCode::kRsqrt:
+        e.Vec2(E::kFsqrt, b, b);
+        broadcast(kT0, 1.0f);
+        e.Vec3(E::kFdiv, b, kT0, b);
+        break;
+      case FusedOpCode::kSquare:
+        e.Vec3(E::kFmul, b, b, b);
+        break;
+      case FusedOpCode::kReciprocal:
+        broadcast(kT0, 1.0f);
+        e.Vec3(E::kFdiv, b, kT0, b);
+        break;
+      case FusedOpCode::kAdd:
+        e.Vec3(E::kFadd, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kSub:
+        e.Vec3(E::kFsub, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kMul:
+        e.Vec3(E::kFmul, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kDiv:
+        e.Vec3(E::kFdiv, a, a, b);
+        --sp;
+        break;
+      case FusedOpCode::kMax:
+        e.Vec3(E::kFcmgt, kT0, a, b);
+        e.Vec3(E::kBsl, kT0, a, b);
+        e.VecMov(a, kT0);
+        --sp;
+        break;
+      case FusedOpCode::kMin:
+        e.Vec3(E::kFcmgt, kT0, b, a);
+        e.Vec3(E::kBsl, kT0, a, b);
+        e.VecMov(a, kT0);
+        --sp;
+        break;
+      case FusedOpCode::kEqual:
+      case FusedOpCode::kNotEqual:
+      case FusedOpCode::kLess:
+      case FusedOpCode::kLessEqual:
+      case FusedOpCode::kGreater:
+      case FusedOpCode::kGreaterEqual:
+        if (instr.code == FusedOpCode::kEqual ||
+            instr.code == FusedOpCode::kNotEqual) {
+          e.Vec3(E::kFcmeq, a, a, b);
+          if (instr.code == FusedOpCode::kNotEqual) {
+            e.Vec2(E::kNot, a, a);
+          }
+        } else if (instr.code == FusedOpCode::kLess) {
+          e.Vec3(E::kFcmgt, a, b, a);
+        } else if (instr.code == FusedOpCode::kLessEqual) {
+          e.Vec3(E::kFcmge, a, b, a);
+        } else if (instr.code == FusedOpCode::kGreater) {
+          e.Vec3(E::kFcmgt, a, a, b);
+        } else {
+          e.Vec3(E::kFcmge, a, a, b);
+        }
+        broadcast(kT0, 1.0f);
+        e.Vec3(E::kAnd, a, a, kT0);
+        --sp;
+        break;
+      case FusedOpCode::kWhere: {
+        const int cond = sp - 3;
+        e.Vec2(E::kFcmeqZero, kT1, cond);
+        e.Vec2(E::kNot, kT1, kT1);
+        e.Vec3(E::kBsl, kT1, a, b);
+        e.VecMov(cond, kT1);
+        sp -= 2;
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  e.StrQ(0, 3, kOffset);
+  e.AddImm(kOffset, kOffset, 16);
+  e.SubsImm(4, 4, 4);
+  e.BneTo(loop);
+  e.PatchImm19(skip, e.size());
+  e.Ret();
+  *code = e.bytes();
+  return true;
+}
+
+std::shared_ptr<const JitKernel> CompileFusedElementwise(
+    const FusedProgram& program, Isa isa) {
+  ConstantPool pool;
+  std::vector<uint8_t> bytes;
+  int64_t lanes = 0;
+  bool ok = false;
+  if (isa == Isa::kAvx2) {
+    ok = EmitAvx2(program, &pool, &bytes);
+    lanes = 8;
+  } else if (isa == Isa::kNeon) {
+    ok = EmitNeon(program, &pool, &bytes);
+    lanes = 4;
+  }
+  if (!ok || pool.values().size() > kMaxJitConstants) {
+    return nullptr;
+  }
+  auto code = JitCode::Create(bytes);
+  if (!code) {
+    return nullptr;
+  }
+  return std::make_shared<FusedElementwiseJit>(
+      std::move(code), std::move(pool.values()), lanes);
+}
+
+}  // namespace
+
+std::shared_ptr<const FusedElementwiseJit> GetFusedElementwiseJit(
+    const FusedProgram& program) {
+  const Isa isa = HostIsa();
+  if (isa == Isa::kNone) {
+    return nullptr;
+  }
+  auto kernel = JitCodeCache::Instance().GetOrCompile(
+      ProgramKey(program, isa),
+      [&] { return CompileFusedElementwise(program, isa); });
+  return std::static_pointer_cast<const FusedElementwiseJit>(kernel);
+}
+
+bool TryRunFusedProgramJit(const FusedProgram& program,
+                           const std::vector<FusedInput<float>>& inputs,
+                           int64_t numel,
+                           float* out) {
+  for (const auto& input : inputs) {
+    if (input.numel != numel) {
+      return false;
+    }
+  }
+  auto kernel = GetFusedElementwiseJit(program);
+  if (!kernel) {
+    return false;
+  }
+  const float* data[kFusionMaxInputs] = {nullptr, nullptr, nullptr};
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    data[i] = inputs[i].data;
+  }
+  const int64_t lanes = kernel->lanes();
+  ParallelFor(0, numel, kParallelGrainSize, [&](int64_t begin, int64_t end) {
+    auto at = [&](int i, int64_t offset) {
+      return data[i] ? data[i] + offset : nullptr;
+    };
+    const int64_t vec = (end - begin) / lanes * lanes;
+    (*kernel)(at(0, begin), at(1, begin), at(2, begin), out + begin, vec);
+    // The last few elements of the block go through the interpreter.
+    const int64_t tail = end - begin - vec;
+    if (tail > 0) {
+      std::vector<FusedInput<float>> rest;
+      for (size_t i = 0; i < inputs.size(); ++i) {
+        rest.push_back({data[i] + begin + vec, tail});
+      }
+      RunFusedProgram<float, float>(program, rest, tail, out + begin + vec);
+    }
+  });
+  return true;
+}
+
+}  // namespace jit
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,78 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "kernels/funcs/fusion_engine.h"
+#include "kernels/funcs/jit/jit_code.h"
+
+namespace custom_kernel {
+namespace funcs {
+namespace jit {
+
+// fn(x, y, z, out, n, constants), n a multiple of lanes().
+using FusedElementwiseFn = void (*)(const float*,
+                                    const float*,
+                                    const float*,
+                                    float*,
+                                    int64_t,
+                                    const float*);
+
+// A fused elementwise program compiled to straight-line vector code: the
+// operand stack lives in vector registers (ymm0-7 / v0-7), so one loop
+// iteration loads each input once, runs the whole chain in registers and
+// stores once.
+class FusedElementwiseJit : public JitKernel {
+ public:
+  FusedElementwiseJit(std::unique_ptr<JitCode> code,
+                      std::vector<float> constants,
+                      int64_t lanes)
+      : JitKernel(std::move(code)),
+        constants_(std::move(constants)),
+        lanes_(lanes) {}
+
+  void operator()(const float* x,
+                  const float* y,
+                  const float* z,
+                  float* out,
+                  int64_t n) const {
+    code().As<FusedElementwiseFn>()(x, y, z, out, n, constants_.data());
+  }
+
+  int64_t lanes() const { return lanes_; }
+
+ private:
+  std::vector<float> constants_;
+  int64_t lanes_;
+};
+
+// Returns the compiled program for the host ISA, or nullptr when the JIT is
+// off or the program uses an op without a code generator (exp, log, tanh,
+// sigmoid, silu, pow).
+std::shared_ptr<const FusedElementwiseJit> GetFusedElementwiseJit(
+    const FusedProgram& program);
+
+// Runs a float32 program through the JIT when every input is full-size.
+// Returns false, having written nothing, when the interpreter has to run it.
+bool TryRunFusedProgramJit(const FusedProgram& program,
+                           const std::vector<FusedInput<float>>& inputs,
+                           int64_t numel,
+                           float* out);
+
+}  // namespace jit
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,132 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/jit/jit_code.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace custom_kernel {
+namespace funcs {
+namespace jit {
+
+static bool JitEnabledByEnv() {
+  const char* value = std::getenv("CUSTOM_CPU_JIT");
+  return value == nullptr || std::strcmp(value, "0") != 0;
+}
+
+static Isa DetectIsa() {
+  if (!JitEnabledByEnv()) {
+    return Isa::kNone;
+  }
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::kAvx2;
+  }
+  return Isa::kNone;
+#elif defined(__aarch64__)
+  return Isa::kNeon;
+#else
+  return Isa::kNone;
+#endif
+}
+
+Isa HostIsa() {
+  static const Isa isa = DetectIsa();
+  return isa;
+}
+
+const char* IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kAvx2:
+      return "avx2";
+    case Isa::kNeon:
+      return "neon";
+    default:
+      return "none";
+  }
+}
+
+std::unique_ptr<JitCode> JitCode::Create(const std::vector<uint8_t>& bytes) {
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t size = (bytes.size() + page - 1) / page * page;
+  void* data = mmap(nullptr,
+                    size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1,
+                    0);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  std::memcpy(data, bytes.data(), bytes.size());
+  if (mprotect(data, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(data, size);
+    return nullptr;
+  }
+  char* begin = static_cast<char*>(data);
+  __builtin___clear_cache(begin, begin + bytes.size());
+  return std::unique_ptr<JitCode>(new JitCode(data, size));
+}
+
+JitCode::~JitCode() { munmap(data_, size_); }
+
+JitCodeCache& JitCodeCache::Instance() {
+  static JitCodeCache cache([] {
+    const char* value = std::getenv("CUSTOM_CPU_JIT_CACHE_CAPACITY");
+    const long capacity = value ? std::atol(value) : 0;  // NOLINT
+    return capacity > 0 ? static_cast<size_t>(capacity)
+                        : kDefaultJitCacheCapacity;
+  }());
+  return cache;
+}
+
+std::shared_ptr<const JitKernel> JitCodeCache::GetOrCompile(
+    const std::string& key, const Compiler& compile) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+  // Codegen is a few microseconds, so compiling under the lock is simpler
+  // than coordinating racing compiles of the same key.
+  auto kernel = compile();
+  lru_.emplace_front(key, kernel);
+  index_[key] = lru_.begin();
+  while (lru_.size() > capacity_) {
+    index_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  return kernel;
+}
+
+size_t JitCodeCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return lru_.size();
+}
+
+void JitCodeCache::Clear() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  index_.clear();
+  lru_.clear();
+}
+
+}  // namespace jit
+}  // namespace funcs
+}  // namespace custom_kernel
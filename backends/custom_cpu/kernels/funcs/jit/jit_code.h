@@ -0,0 +1,118 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Runtime code generation for custom_cpu.
+//
+// Generated kernels are cached process wide, keyed by a string that names
+// the kernel and everything its code depends on (shape, dtype, ISA). The
+// cache is bounded and evicts the least recently used kernel; callers hold
+// a shared_ptr, so an evicted kernel stays mapped until its last run ends.
+// Every JIT kernel has an interpreter fallback: when the ISA is not
+// supported, codegen fails or CUSTOM_CPU_JIT=0, Get* returns nullptr and the
+// caller runs its portable path.
+
+namespace custom_kernel {
+namespace funcs {
+namespace jit {
+
+enum class Isa { kNone, kAvx2, kNeon };
+
+// ISA the JIT emits code for on this host, kNone when it cannot (or is
+// disabled through CUSTOM_CPU_JIT=0).
+Isa HostIsa();
+
+const char* IsaName(Isa isa);
+
+// Executable copy of generated machine code. The pages are mapped
+// read-write for the copy and then flipped to read-execute, never both.
+class JitCode {
+ public:
+  static std::unique_ptr<JitCode> Create(const std::vector<uint8_t>& bytes);
+  ~JitCode();
+
+  JitCode(const JitCode&) = delete;
+  JitCode& operator=(const JitCode&) = delete;
+
+  template <typename Fn>
+  Fn As() const {
+    return reinterpret_cast<Fn>(data_);
+  }
+  size_t size() const { return size_; }
+
+ private:
+  JitCode(void* data, size_t size) : data_(data), size_(size) {}
+
+  void* data_;
+  size_t size_;
+};
+
+// Base of cached kernels: the code plus whatever data it reads at run time
+// (constant pools and such).
+class JitKernel {
+ public:
+  explicit JitKernel(std::unique_ptr<JitCode> code) : code_(std::move(code)) {}
+  virtual ~JitKernel() = default;
+
+  const JitCode& code() const { return *code_; }
+
+ private:
+  std::unique_ptr<JitCode> code_;
+};
+
+// LRU cache of generated kernels. The capacity (in kernels) defaults to
+// kDefaultJitCacheCapacity and can be set with CUSTOM_CPU_JIT_CACHE_CAPACITY.
+class JitCodeCache {
+ public:
+  using Compiler = std::function<std::shared_ptr<const JitKernel>()>;
+
+  static JitCodeCache& Instance();
+
+  explicit JitCodeCache(size_t capacity) : capacity_(capacity) {}
+
+  // Returns the kernel cached under `key`, compiling it with `compile` on a
+  // miss. A failed compile (nullptr) is cached too so it is not retried.
+  std::shared_ptr<const JitKernel> GetOrCompile(const std::string& key,
+                                                const Compiler& compile);
+
+  size_t size() const;
+  size_t capacity() const { return capacity_; }
+  void Clear();
+
+ private:
+  using Entry = std::pair<std::string, std::shared_ptr<const JitKernel>>;
+
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  std::list<Entry> lru_;  // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+constexpr size_t kDefaultJitCacheCapacity = 256;
+
+}  // namespace jit
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,227 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Minimal x86-64 assembler: the handful of general purpose and AVX (VEX.256)
+// instructions the custom_cpu JIT kernels use. Operands are register
+// numbers (rax = 0 ... r15 = 15, ymm0 ... ymm15); memory operands are
+// [base + index] or [base + disp32].
+
+namespace custom_kernel {
+namespace funcs {
+namespace jit {
+
+namespace x64 {
+constexpr int kRax = 0;
+constexpr int kRcx = 1;
+constexpr int kRdx = 2;
+constexpr int kRsi = 6;
+constexpr int kRdi = 7;
+constexpr int kR8 = 8;
+constexpr int kR9 = 9;
+}  // namespace x64
+
+class X64Emitter {
+ public:
+  // VEX.256 packed single opcodes in map 0F, pp = none.
+  enum PackedOp : uint8_t {
+    kVmovupsLoad = 0x10,
+    kVmovupsStore = 0x11,
+    kVsqrtps = 0x51,
+    kVandps = 0x54,
+    kVandnps = 0x55,
+    kVxorps = 0x57,
+    kVaddps = 0x58,
+    kVmulps = 0x59,
+    kVsubps = 0x5C,
+    kVminps = 0x5D,
+    kVdivps = 0x5E,
+    kVmaxps = 0x5F,
+  };
+
+  // vcmpps predicates.
+  enum CmpPredicate : uint8_t {
+    kCmpEq = 0x00,
+    kCmpLt = 0x01,
+    kCmpLe = 0x02,
+    kCmpNeq = 0x04,  // unordered, so NaN != x
+    kCmpGe = 0x0D,
+    kCmpGt = 0x0E,
+  };
+
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+  size_t size() const { return bytes_.size(); }
+
+  // op ymm_dst, ymm_src1, ymm_src2
+  void VecOp(PackedOp op, int dst, int src1, int src2) {
+    Vex(dst, src1, src2, 0, 1, 0);
+    Emit(op);
+    ModRmReg(dst, src2);
+  }
+
+  // vsqrtps ymm_dst, ymm_src
+  void Vsqrtps(int dst, int src) { VecOp(kVsqrtps, dst, 0, src); }
+
+  // vcmpps ymm_dst, ymm_src1, ymm_src2, predicate
+  void Vcmpps(int dst, int src1, int src2, CmpPredicate predicate) {
+    Vex(dst, src1, src2, 0, 1, 0);
+    Emit(0xC2);
+    ModRmReg(dst, src2);
+    Emit(predicate);
+  }
+
+  // vblendvps ymm_dst, ymm_src1, ymm_src2, ymm_mask:
+  // dst = mask ? src2 : src1 per lane (sign bit of mask).
+  void Vblendvps(int dst, int src1, int src2, int mask) {
+    Vex(dst, src1, src2, 0, 3, 1);
+    Emit(0x4A);
+    ModRmReg(dst, src2);
+    Emit(static_cast<uint8_t>(mask << 4));
+  }
+
+  // vmovups ymm, [base + index]
+  void VmovupsLoad(int dst, int base, int index) {
+    Vex(dst, 0, base, index, 1, 0);
+    Emit(kVmovupsLoad);
+    ModRmSib(dst, base, index);
+  }
+
+  // vmovups [base + index], ymm
+  void VmovupsStore(int base, int index, int src) {
+    Vex(src, 0, base, index, 1, 0);
+    Emit(kVmovupsStore);
+    ModRmSib(src, base, index);
+  }
+
+  // vbroadcastss ymm, dword [base + disp32]
+  void VbroadcastssMem(int dst, int base, int32_t disp) {
+    Vex(dst, 0, base, 0, 2, 1);
+    Emit(0x18);
+    ModRmDisp32(dst, base, disp);
+  }
+
+  void Vzeroupper() {
+    Emit(0xC5);
+    Emit(0xF8);
+    Emit(0x77);
+  }
+
+  // xor r32, r32 (zero extends to 64 bits)
+  void XorReg32(int dst, int src) {
+    Rex(false, src, dst);
+    Emit(0x31);
+    ModRmReg(src, dst);
+  }
+
+  // add r64, imm8
+  void AddImm8(int reg, int8_t imm) { GroupImm8(0, reg, imm); }
+
+  // sub r64, imm8
+  void SubImm8(int reg, int8_t imm) { GroupImm8(5, reg, imm); }
+
+  // test r64, r64
+  void Test(int a, int b) {
+    Rex(true, b, a);
+    Emit(0x85);
+    ModRmReg(b, a);
+  }
+
+  // jz / jnz rel32. Returns the offset of the displacement for Patch, or
+  // jumps back to `target` when it is already known.
+  size_t Jz() { return Jcc(0x84); }
+  void JnzTo(size_t target) {
+    const size_t disp_at = Jcc(0x85);
+    PatchRel32(disp_at, target);
+  }
+
+  // Points the rel32 at `disp_at` to `target`.
+  void PatchRel32(size_t disp_at, size_t target) {
+    const int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) -
+                                             static_cast<int64_t>(disp_at + 4));
+    for (int i = 0; i < 4; ++i) {
+      bytes_[disp_at + i] = static_cast<uint8_t>(rel >> (8 * i));
+    }
+  }
+
+  void Ret() { Emit(0xC3); }
+
+ private:
+  void Emit(uint8_t byte) { bytes_.push_back(byte); }
+
+  void Emit32(int32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      Emit(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  // Three byte VEX prefix, L = 256. `map` is 1 (0F), 2 (0F38) or 3 (0F3A);
+  // `pp` is 0 (none) or 1 (66).
+  void Vex(int reg, int vvvv, int rm, int index, int map, int pp) {
+    Emit(0xC4);
+    Emit(static_cast<uint8_t>((((reg >> 3) & 1) ^ 1) << 7 |
+                              (((index >> 3) & 1) ^ 1) << 6 |
+                              (((rm >> 3) & 1) ^ 1) << 5 | map));
+    Emit(static_cast<uint8_t>(((~vvvv) & 0xF) << 3 | 1 << 2 | pp));
+  }
+
+  void Rex(bool w, int reg, int rm) {
+    const uint8_t rex = static_cast<uint8_t>(0x40 | (w ? 8 : 0) |
+                                             ((reg >> 3) & 1) << 2 |
+                                             ((rm >> 3) & 1));
+    if (rex != 0x40) {
+      Emit(rex);
+    }
+  }
+
+  void ModRmReg(int reg, int rm) {
+    Emit(static_cast<uint8_t>(0xC0 | (reg & 7) << 3 | (rm & 7)));
+  }
+
+  // [base + index * 1]; base must not be rbp/r13 (no disp0 form).
+  void ModRmSib(int reg, int base, int index) {
+    Emit(static_cast<uint8_t>((reg & 7) << 3 | 0x04));
+    Emit(static_cast<uint8_t>((index & 7) << 3 | (base & 7)));
+  }
+
+  // [base + disp32]; base must not be rsp/r12 (needs a SIB).
+  void ModRmDisp32(int reg, int base, int32_t disp) {
+    Emit(static_cast<uint8_t>(0x80 | (reg & 7) << 3 | (base & 7)));
+    Emit32(disp);
+  }
+
+  void GroupImm8(int ext, int reg, int8_t imm) {
+    Rex(true, 0, reg);
+    Emit(0x83);
+    ModRmReg(ext, reg);
+    Emit(static_cast<uint8_t>(imm));
+  }
+
+  size_t Jcc(uint8_t opcode) {
+    Emit(0x0F);
+    Emit(opcode);
+    const size_t disp_at = bytes_.size();
+    Emit32(0);
+    return disp_at;
+  }
+
+  std::vector<uint8_t> bytes_;
+};
+
+}  // namespace jit
+}  // namespace funcs
+}  // namespace custom_kernel
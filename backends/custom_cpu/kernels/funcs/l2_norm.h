@@ -0,0 +1,139 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/parallel.h"
+
+// Squared L2 norms and scaling of groups of tensors, the two sweeps of
+// gradient clipping by norm.
+//
+// A sum of squares over millions of elements loses most of the low bits of
+// the small terms in a single float accumulator. Each block of kCastBlock
+// elements is summed in kNormLanes independent lanes (one vector loop),
+// and the block totals are added with Kahan compensation. Chunks are
+// reduced in parallel to one partial each and the partials are combined in
+// chunk order, so the result does not depend on the number of threads.
+
+namespace custom_kernel {
+namespace funcs {
+
+constexpr int64_t kNormChunkSize = 16384;
+constexpr int64_t kNormLanes = 8;
+
+template <typename MT>
+struct KahanSum {
+  MT sum = 0;
+  MT compensation = 0;
+
+  void Add(MT value) {
+    const MT y = value - compensation;
+    const MT t = sum + y;
+    compensation = (t - sum) - y;
+    sum = t;
+  }
+};
+
+template <typename T, typename MT>
+MT SumSquares(const T* x, int64_t n) {
+  static_assert(kCastBlock % kNormLanes == 0, "");
+  MT block[kCastBlock];
+  KahanSum<MT> total;
+  for (int64_t i = 0; i < n; i += kCastBlock) {
+    const int64_t len = std::min(kCastBlock, n - i);
+    ConvertElements(x + i, block, len);
+    const int64_t padded = (len + kNormLanes - 1) / kNormLanes * kNormLanes;
+    std::fill(block + len, block + padded, MT(0));
+    MT lanes[kNormLanes] = {};
+    for (int64_t j = 0; j < padded; j += kNormLanes) {
+      PD_CPU_SIMD
+      for (int64_t l = 0; l < kNormLanes; ++l) {
+        lanes[l] += block[j + l] * block[j + l];
+      }
+    }
+    MT block_sum = 0;
+    for (int64_t l = 0; l < kNormLanes; ++l) {
+      block_sum += lanes[l];
+    }
+    total.Add(block_sum);
+  }
+  return total.sum;
+}
+
+// Sum of squares of all elements of all `xs` (numels[i] elements each).
+template <typename T, typename MT>
+MT MultiTensorSquaredL2Norm(const std::vector<const T*>& xs,
+                            const std::vector<int64_t>& numels) {
+  std::vector<int64_t> chunk_offsets(numels.size() + 1, 0);
+  for (size_t i = 0; i < numels.size(); ++i) {
+    chunk_offsets[i + 1] =
+        chunk_offsets[i] + (numels[i] + kNormChunkSize - 1) / kNormChunkSize;
+  }
+  std::vector<MT> partials(chunk_offsets.back());
+  MultiTensorParallelFor(
+      numels, kNormChunkSize, [&](size_t t, int64_t begin, int64_t end) {
+        partials[chunk_offsets[t] + begin / kNormChunkSize] =
+            SumSquares<T, MT>(xs[t] + begin, end - begin);
+      });
+  KahanSum<MT> total;
+  for (auto partial : partials) {
+    total.Add(partial);
+  }
+  return total.sum;
+}
+
+// out[i] = x[i] * scale, in place when out == x.
+template <typename T, typename MT>
+void ScaleElements(const T* x, T* out, MT scale, int64_t n) {
+  if (std::is_same<T, MT>::value) {
+    auto src = reinterpret_cast<const MT*>(x);
+    auto dst = reinterpret_cast<MT*>(out);
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < n; ++i) {
+      dst[i] = src[i] * scale;
+    }
+    return;
+  }
+  MT block[kCastBlock];
+  for (int64_t i = 0; i < n; i += kCastBlock) {
+    const int64_t len = std::min(kCastBlock, n - i);
+    ConvertElements(x + i, block, len);
+    PD_CPU_SIMD
+    for (int64_t j = 0; j < len; ++j) {
+      block[j] *= scale;
+    }
+    ConvertElements(block, out + i, len);
+  }
+}
+
+template <typename T, typename MT>
+void MultiTensorScale(const std::vector<const T*>& xs,
+                      const std::vector<T*>& outs,
+                      const std::vector<int64_t>& numels,
+                      MT scale) {
+  MultiTensorParallelFor(
+      numels, kNormChunkSize, [&](size_t t, int64_t begin, int64_t end) {
+        ScaleElements<T, MT>(
+            xs[t] + begin, outs[t] + begin, scale, end - begin);
+      });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
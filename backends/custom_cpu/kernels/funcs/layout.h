@@ -0,0 +1,244 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "kernels/funcs/parallel.h"
+
+// Conversions between the activation layouts of the CPU CNN kernels, for an
+// image batch with N images, C channels and S = H * W (or D * H * W)
+// spatial positions:
+//
+//   NCHW     [N, C, S]
+//   NHWC     [N, S, C]
+//   nChw16c  [N, ceil(C / 16), S, 16], channels padded with zeros
+//
+// The blocked layout keeps 16 channels of a position in one 64-byte line,
+// which is what vectorized conv / pool kernels load per step.
+
+namespace custom_kernel {
+namespace funcs {
+
+constexpr int64_t kChannelBlock = 16;
+
+// Square tile of the cache-blocked transposes.
+constexpr int64_t kTransposeTile = 32;
+
+enum class ImageFormat { kNCHW, kNHWC, kNChw16c };
+
+inline bool ParseImageFormat(const std::string& name, ImageFormat* format) {
+  if (name == "NCHW" || name == "NCDHW") {
+    *format = ImageFormat::kNCHW;
+  } else if (name == "NHWC" || name == "NDHWC") {
+    *format = ImageFormat::kNHWC;
+  } else if (name == "nChw16c") {
+    *format = ImageFormat::kNChw16c;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline int64_t ChannelBlocks(int64_t channels) {
+  return (channels + kChannelBlock - 1) / kChannelBlock;
+}
+
+// dst[c * dst_ld + r] = src[r * src_ld + c] for r < rows and c in
+// [col_begin, col_end), walked in tiles so both sides stay in cache.
+template <typename T>
+void TransposeBlock(const T* src,
+                    int64_t src_ld,
+                    int64_t rows,
+                    int64_t col_begin,
+                    int64_t col_end,
+                    T* dst,
+                    int64_t dst_ld) {
+  for (int64_t r0 = 0; r0 < rows; r0 += kTransposeTile) {
+    const int64_t r1 = std::min(rows, r0 + kTransposeTile);
+    for (int64_t c0 = col_begin; c0 < col_end; c0 += kTransposeTile) {
+      const int64_t c1 = std::min(col_end, c0 + kTransposeTile);
+      for (int64_t r = r0; r < r1; ++r) {
+        const T* s = src + r * src_ld;
+        for (int64_t c = c0; c < c1; ++c) {
+          dst[c * dst_ld + r] = s[c];
+        }
+      }
+    }
+  }
+}
+
+// Runs f(n, s_begin, s_end) over every image and a split of its spatial
+// positions, so a single image still spreads over all threads.
+template <typename F>
+void ParallelForImages(int64_t batch,
+                       int64_t spatial,
+                       int64_t elems_per_position,
+                       const F& f) {
+  const int64_t chunk = kTransposeTile * 4;
+  const int64_t chunks = (spatial + chunk - 1) / chunk;
+  const int64_t grain = std::max<int64_t>(
+      1, kParallelGrainSize / std::max<int64_t>(1, chunk * elems_per_position));
+  ParallelFor(0, batch * chunks, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      const int64_t n = i / chunks;
+      const int64_t s0 = (i % chunks) * chunk;
+      f(n, s0, std::min(spatial, s0 + chunk));
+    }
+  });
+}
+
+template <typename T>
+void NchwToNhwc(
+    const T* x, int64_t batch, int64_t channels, int64_t spatial, T* out) {
+  const int64_t image = channels * spatial;
+  ParallelForImages(
+      batch, spatial, channels, [&](int64_t n, int64_t s0, int64_t s1) {
+        TransposeBlock(x + n * image,
+                       spatial,
+                       channels,
+                       s0,
+                       s1,
+                       out + n * image,
+                       channels);
+      });
+}
+
+template <typename T>
+void NhwcToNchw(
+    const T* x, int64_t batch, int64_t channels, int64_t spatial, T* out) {
+  const int64_t image = channels * spatial;
+  ParallelForImages(
+      batch, spatial, channels, [&](int64_t n, int64_t s0, int64_t s1) {
+        TransposeBlock(x + n * image + s0 * channels,
+                       channels,
+                       s1 - s0,
+                       0,
+                       channels,
+                       out + n * image + s0,
+                       spatial);
+      });
+}
+
+// Positions [s0, s1) of one NCHW / NHWC image -> its nChw16c blocks.
+template <typename T>
+void PlainToBlockedImage(const T* x,
+                         bool nhwc,
+                         int64_t channels,
+                         int64_t spatial,
+                         int64_t s0,
+                         int64_t s1,
+                         T* out) {
+  for (int64_t cb = 0; cb < ChannelBlocks(channels); ++cb) {
+    const int64_t c0 = cb * kChannelBlock;
+    const int64_t cn = std::min(kChannelBlock, channels - c0);
+    T* dst = out + (cb * spatial + s0) * kChannelBlock;
+    if (cn < kChannelBlock) {
+      for (int64_t s = 0; s < s1 - s0; ++s) {
+        std::fill(dst + s * kChannelBlock + cn,
+                  dst + (s + 1) * kChannelBlock,
+                  static_cast<T>(0));
+      }
+    }
+    if (nhwc) {
+      for (int64_t s = s0; s < s1; ++s) {
+        std::memcpy(dst + (s - s0) * kChannelBlock,
+                    x + s * channels + c0,
+                    cn * sizeof(T));
+      }
+    } else {
+      TransposeBlock(
+          x + c0 * spatial + s0, spatial, cn, 0, s1 - s0, dst, kChannelBlock);
+    }
+  }
+}
+
+// Positions [s0, s1) of one nChw16c image -> NCHW / NHWC.
+template <typename T>
+void BlockedToPlainImage(const T* x,
+                         bool nhwc,
+                         int64_t channels,
+                         int64_t spatial,
+                         int64_t s0,
+                         int64_t s1,
+                         T* out) {
+  for (int64_t cb = 0; cb < ChannelBlocks(channels); ++cb) {
+    const int64_t c0 = cb * kChannelBlock;
+    const int64_t cn = std::min(kChannelBlock, channels - c0);
+    const T* src = x + (cb * spatial + s0) * kChannelBlock;
+    if (nhwc) {
+      for (int64_t s = s0; s < s1; ++s) {
+        std::memcpy(out + s * channels + c0,
+                    src + (s - s0) * kChannelBlock,
+                    cn * sizeof(T));
+      }
+    } else {
+      TransposeBlock(
+          src, kChannelBlock, s1 - s0, 0, cn, out + c0 * spatial + s0, spatial);
+    }
+  }
+}
+
+// NCHW or NHWC -> nChw16c.
+template <typename T>
+void PlainToBlocked(const T* x,
+                    bool nhwc,
+                    int64_t batch,
+                    int64_t channels,
+                    int64_t spatial,
+                    T* out) {
+  const int64_t image = channels * spatial;
+  const int64_t blocked_image =
+      ChannelBlocks(channels) * kChannelBlock * spatial;
+  ParallelForImages(
+      batch, spatial, channels, [&](int64_t n, int64_t s0, int64_t s1) {
+        PlainToBlockedImage(x + n * image,
+                            nhwc,
+                            channels,
+                            spatial,
+                            s0,
+                            s1,
+                            out + n * blocked_image);
+      });
+}
+
+// nChw16c -> NCHW or NHWC, dropping the padding channels.
+template <typename T>
+void BlockedToPlain(const T* x,
+                    bool nhwc,
+                    int64_t batch,
+                    int64_t channels,
+                    int64_t spatial,
+                    T* out) {
+  const int64_t image = channels * spatial;
+  const int64_t blocked_image =
+      ChannelBlocks(channels) * kChannelBlock * spatial;
+  ParallelForImages(
+      batch, spatial, channels, [&](int64_t n, int64_t s0, int64_t s1) {
+        BlockedToPlainImage(x + n * blocked_image,
+                            nhwc,
+                            channels,
+                            spatial,
+                            s0,
+                            s1,
+                            out + n * image);
+      });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,168 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// PD_CPU_SIMD_SUM(acc) vectorizes a loop that sums into the scalar `acc`.
+#ifdef _OPENMP
+#define PD_CPU_SIMD _Pragma("omp simd")
+#define PD_CPU_PRAGMA(x) _Pragma(#x)
+#define PD_CPU_SIMD_SUM(var) PD_CPU_PRAGMA(omp simd reduction(+ : var))
+#else
+#define PD_CPU_SIMD
+#define PD_CPU_SIMD_SUM(var)
+#endif
+
+namespace custom_kernel {
+namespace funcs {
+
+// Ranges shorter than this are not worth forking a thread team for.
+constexpr int64_t kParallelGrainSize = 32768;
+
+inline int GetMaxThreads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+inline int GetThreadNum() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+inline bool InParallelRegion() {
+#ifdef _OPENMP
+  return omp_in_parallel();
+#else
+  return false;
+#endif
+}
+
+// Splits [begin, end) into one contiguous block per thread, each holding at
+// least `grain_size` iterations, and calls `f(block_begin, block_end)`.
+// The split only depends on the range and the team size, so kernels that
+// write disjoint outputs per block are deterministic. `f` must not throw.
+template <typename Func>
+void ParallelFor(int64_t begin,
+                 int64_t end,
+                 int64_t grain_size,
+                 const Func& f) {
+  if (begin >= end) {
+    return;
+  }
+  const int64_t n = end - begin;
+  grain_size = std::max<int64_t>(grain_size, 1);
+  const int64_t max_blocks = (n + grain_size - 1) / grain_size;
+  const int num_threads =
+      static_cast<int>(std::min<int64_t>(GetMaxThreads(), max_blocks));
+  if (num_threads <= 1 || InParallelRegion()) {
+    f(begin, end);
+    return;
+  }
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+  {
+    const int64_t team = omp_get_num_threads();
+    const int64_t tid = omp_get_thread_num();
+    const int64_t block = (n + team - 1) / team;
+    const int64_t block_begin = begin + tid * block;
+    const int64_t block_end = std::min(end, block_begin + block);
+    if (block_begin < block_end) {
+      f(block_begin, block_end);
+    }
+  }
+#else
+  f(begin, end);
+#endif
+}
+
+// Bytes below which a memcpy stays on the calling thread.
+constexpr int64_t kParallelCopyGrainBytes = 1 << 20;
+
+inline void ParallelMemcpy(void* dst, const void* src, int64_t bytes) {
+  if (dst == src || bytes <= 0) {
+    return;
+  }
+  auto d = static_cast<char*>(dst);
+  auto s = static_cast<const char*>(src);
+  ParallelFor(0, bytes, kParallelCopyGrainBytes, [&](int64_t b, int64_t e) {
+    std::memcpy(d + b, s + b, e - b);
+  });
+}
+
+inline void ParallelMemset(void* dst, int value, int64_t bytes) {
+  if (bytes <= 0) {
+    return;
+  }
+  auto d = static_cast<char*>(dst);
+  ParallelFor(0, bytes, kParallelCopyGrainBytes, [&](int64_t b, int64_t e) {
+    std::memset(d + b, value, e - b);
+  });
+}
+
+// Runs `f(tensor_index, begin, end)` over every element of a group of
+// tensors in one parallel loop. Each tensor is cut into chunks of
+// `chunk_size` elements and the chunks of all tensors are distributed
+// together, so a group of many small tensors costs one fork instead of one
+// per tensor.
+template <typename Func>
+void MultiTensorParallelFor(const std::vector<int64_t>& numels,
+                            int64_t chunk_size,
+                            const Func& f) {
+  chunk_size = std::max<int64_t>(chunk_size, 1);
+  std::vector<int64_t> chunk_offsets(numels.size() + 1, 0);
+  for (size_t i = 0; i < numels.size(); ++i) {
+    chunk_offsets[i + 1] =
+        chunk_offsets[i] + (numels[i] + chunk_size - 1) / chunk_size;
+  }
+  const int64_t total_chunks = chunk_offsets.back();
+  int64_t total_numel = 0;
+  for (auto numel : numels) {
+    total_numel += numel;
+  }
+  const int64_t grain =
+      std::max<int64_t>(1, total_chunks * kParallelGrainSize /
+                               std::max<int64_t>(total_numel, 1));
+
+  ParallelFor(0, total_chunks, grain, [&](int64_t first, int64_t last) {
+    size_t t = std::upper_bound(
+                   chunk_offsets.cbegin(), chunk_offsets.cend(), first) -
+               chunk_offsets.cbegin() - 1;
+    for (int64_t c = first; c < last; ++c) {
+      while (c >= chunk_offsets[t + 1]) {
+        ++t;
+      }
+      const int64_t begin = (c - chunk_offsets[t]) * chunk_size;
+      const int64_t end = std::min(numels[t], begin + chunk_size);
+      f(t, begin, end);
+    }
+  });
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
@@ -0,0 +1,149 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include "kernels/funcs/parallel.h"
+
+// Counter based random numbers (Philox4x32-10, Salmon et al., "Parallel
+// Random Numbers: As Easy as 1, 2, 3", SC'11).
+//
+// Each 128-bit counter maps to four independent 32-bit outputs, so element
+// i of a tensor can be computed directly from (seed, offset + i / 4) without
+// generating the elements before it. Fills are split across threads freely
+// and give the same values for any thread count.
+
+namespace custom_kernel {
+namespace funcs {
+
+constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+constexpr int kPhiloxRounds = 10;
+
+// Values produced by one Philox call.
+constexpr int64_t kPhiloxLanes = 4;
+
+// Seed used when an op asks for a random seed (seed == 0 and no fixed seed).
+constexpr uint64_t kDefaultPhiloxSeed = 0x853C49E6748FEA9BULL;
+
+struct PhiloxBlock {
+  uint32_t v[kPhiloxLanes];
+};
+
+static inline void MulHiLo(uint32_t a, uint32_t b, uint32_t* hi, uint32_t* lo) {
+  const uint64_t product = static_cast<uint64_t>(a) * b;
+  *hi = static_cast<uint32_t>(product >> 32);
+  *lo = static_cast<uint32_t>(product);
+}
+
+class Philox4x32 {
+ public:
+  Philox4x32(uint64_t seed, uint64_t offset)
+      : key0_(static_cast<uint32_t>(seed)),
+        key1_(static_cast<uint32_t>(seed >> 32)),
+        offset_(offset) {}
+
+  // Output of counter `offset + index` in sub-stream `stream`.
+  PhiloxBlock operator()(uint64_t index, uint32_t stream = 0) const {
+    const uint64_t counter = offset_ + index;
+    uint32_t c0 = static_cast<uint32_t>(counter);
+    uint32_t c1 = static_cast<uint32_t>(counter >> 32);
+    uint32_t c2 = stream;
+    uint32_t c3 = 0;
+    uint32_t k0 = key0_;
+    uint32_t k1 = key1_;
+    for (int r = 0; r < kPhiloxRounds; ++r) {
+      uint32_t hi0, lo0, hi1, lo1;
+      MulHiLo(kPhiloxM0, c0, &hi0, &lo0);
+      MulHiLo(kPhiloxM1, c2, &hi1, &lo1);
+      const uint32_t n0 = hi1 ^ c1 ^ k0;
+      const uint32_t n2 = hi0 ^ c3 ^ k1;
+      c0 = n0;
+      c1 = lo1;
+      c2 = n2;
+      c3 = lo0;
+      k0 += kPhiloxW0;
+      k1 += kPhiloxW1;
+    }
+    return PhiloxBlock{{c0, c1, c2, c3}};
+  }
+
+ private:
+  uint32_t key0_;
+  uint32_t key1_;
+  uint64_t offset_;
+};
+
+// Uniform float in [0, 1) from the top 24 bits.
+static inline float Uint32ToUnitFloat(uint32_t x) {
+  return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Uniform double in [0, 1) from 53 bits of two outputs.
+static inline double Uint64ToUnitDouble(uint32_t hi, uint32_t lo) {
+  const uint64_t bits =
+      ((static_cast<uint64_t>(hi) << 32) | static_cast<uint64_t>(lo)) >> 11;
+  return static_cast<double>(bits) * (1.0 / 9007199254740992.0);
+}
+
+// Returns (seed, offset) for a random op. An explicit seed always starts at
+// offset 0 so the same seed reproduces the same tensor. Otherwise a process
+// wide counter is advanced by `num_blocks`, an upper bound on the Philox
+// calls the op consumes, so consecutive unseeded ops draw disjoint parts of
+// one stream.
+static inline void GetPhiloxSeedOffset(uint64_t seed,
+                                       uint64_t num_blocks,
+                                       uint64_t* out_seed,
+                                       uint64_t* out_offset) {
+  static std::atomic<uint64_t> default_offset(0);
+  if (seed != 0) {
+    *out_seed = seed;
+    *out_offset = 0;
+    return;
+  }
+  *out_seed = kDefaultPhiloxSeed;
+  *out_offset = default_offset.fetch_add(num_blocks);
+}
+
+// Calls `f(block_index, block)` for Philox blocks [0, num_blocks) in
+// parallel. `grain` is in blocks.
+template <typename Func>
+void PhiloxParallelFor(const Philox4x32& philox,
+                       int64_t num_blocks,
+                       int64_t grain,
+                       const Func& f) {
+  ParallelFor(0, num_blocks, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; ++b) {
+      f(b, philox(b));
+    }
+  });
+}
+
+// Box-Muller on two uniforms in (0, 1] and [0, 1).
+static inline void BoxMuller(float u1, float u2, float* z0, float* z1) {
+  constexpr float kTwoPi = 6.283185307179586f;
+  const float radius = std::sqrt(-2.0f * std::log(u1));
+  const float theta = kTwoPi * u2;
+  *z0 = radius * std::cos(theta);
+  *z1 = radius * std::sin(theta);
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
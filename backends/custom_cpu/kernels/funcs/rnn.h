@@ -0,0 +1,782 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kernels/funcs/blocked_gemm.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/funcs/philox.h"
+
+// Multi-layer, optionally bidirectional LSTM / GRU / simple RNN over a time
+// major [seq_len, batch, input] sequence, forward and backward.
+//
+// Per layer and direction the input projection of every time step is one
+// GEMM, with both directions in the same batch. The recurrence then runs a
+// step at a time: h_prev * W_hh^T from a transposed copy of W_hh packed
+// once per call, and one fused elementwise pass for all gates, the cell
+// and the new state. The backward pass walks the steps in reverse with the
+// same two pieces and leaves the weight gradients to GEMMs over all steps.
+//
+// Rows shorter than seq_len stop early: their state is held, their output
+// is zero past the end, and the reverse direction starts at their last
+// step.
+
+namespace custom_kernel {
+namespace funcs {
+
+enum class RnnMode { kLstm, kGru, kRnnTanh, kRnnRelu };
+
+inline bool ParseRnnMode(const std::string& name, RnnMode* mode) {
+  if (name == "LSTM") {
+    *mode = RnnMode::kLstm;
+  } else if (name == "GRU") {
+    *mode = RnnMode::kGru;
+  } else if (name == "RNN_TANH") {
+    *mode = RnnMode::kRnnTanh;
+  } else if (name == "RNN_RELU") {
+    *mode = RnnMode::kRnnRelu;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Gates per hidden unit: LSTM (i, f, g, o), GRU (r, z, c), simple RNN.
+inline int64_t RnnGates(RnnMode mode) {
+  return mode == RnnMode::kLstm ? 4 : (mode == RnnMode::kGru ? 3 : 1);
+}
+
+constexpr int64_t kRnnRowBlock = 8;
+constexpr int64_t kRnnColBlock = 64;
+
+// Sizes of a call, and where each tensor lives in the reserve (the state
+// kept from the forward for the backward).
+//
+// Per layer and direction the record holds, by processing step, the
+// activated gates [B, G*H], the state after the step [B, H] and for LSTM
+// the cell, for GRU the recurrent part of the candidate (W_hc h + b_hc).
+// Per layer but the last follow the input of the next layer and, with
+// dropout, its mask (0 or the 1 / (1 - p) scale).
+struct RnnShape {
+  RnnMode mode;
+  int64_t seq_len;
+  int64_t batch;
+  int64_t input_size;
+  int64_t hidden;
+  int64_t layers;
+  int64_t directions;
+  bool dropout;
+
+  int64_t gates() const { return RnnGates(mode) * hidden; }
+  int64_t extra() const {
+    return mode == RnnMode::kLstm || mode == RnnMode::kGru ? hidden : 0;
+  }
+  int64_t layer_input(int64_t layer) const {
+    return layer == 0 ? input_size : directions * hidden;
+  }
+  int64_t step_values() const { return batch * (gates() + hidden + extra()); }
+  int64_t record_size() const { return seq_len * step_values(); }
+  int64_t io_size() const { return seq_len * batch * directions * hidden; }
+  int64_t record_offset(int64_t layer, int64_t dir) const {
+    return (layer * directions + dir) * record_size();
+  }
+  // input of `layer` >= 1, and its dropout mask
+  int64_t input_offset(int64_t layer) const {
+    return layers * directions * record_size() +
+           (layer - 1) * io_size() * (dropout ? 2 : 1);
+  }
+  int64_t mask_offset(int64_t layer) const {
+    return input_offset(layer) + io_size();
+  }
+  int64_t reserve_size() const { return input_offset(layers); }
+};
+
+// Record of one layer and direction; `ring` > 0 keeps only the last ring
+// steps (inference).
+template <typename T>
+struct RnnRecord {
+  T* base;
+  int64_t batch;
+  int64_t gates;
+  int64_t hidden;
+  int64_t extra;
+  int64_t steps;
+  int64_t ring;
+
+  int64_t slot(int64_t k) const { return ring > 0 ? k % ring : k; }
+  T* gate(int64_t k) const { return base + slot(k) * batch * gates; }
+  T* state(int64_t k) const {
+    return base + steps * batch * gates + slot(k) * batch * hidden;
+  }
+  T* cell(int64_t k) const {
+    return base + steps * batch * (gates + hidden) + slot(k) * batch * extra;
+  }
+};
+
+template <typename T>
+RnnRecord<T> MakeRnnRecord(const RnnShape& shape, T* base, int64_t ring) {
+  return RnnRecord<T>{base,
+                      shape.batch,
+                      shape.gates(),
+                      shape.hidden,
+                      shape.extra(),
+                      ring > 0 ? ring : shape.seq_len,
+                      ring};
+}
+
+// Parameters of one layer and direction.
+template <typename T>
+struct RnnWeights {
+  const T* w_ih;  // [G*H, in]
+  const T* w_hh;  // [G*H, H]
+  const T* b_ih;  // [G*H]
+  const T* b_hh;  // [G*H]
+};
+
+// `weights` in the order of the rnn op: the input and hidden weights of
+// every layer and direction, then their biases in the same order.
+template <typename T>
+RnnWeights<T> GetRnnWeights(const RnnShape& shape,
+                            const std::vector<const T*>& weights,
+                            int64_t layer,
+                            int64_t dir) {
+  const int64_t i = 2 * (layer * shape.directions + dir);
+  const int64_t biases = 2 * shape.layers * shape.directions;
+  return RnnWeights<T>{
+      weights[i], weights[i + 1], weights[biases + i], weights[biases + i + 1]};
+}
+
+// rows x cols matrix `w` as an MT matrix, transposed when `transpose`.
+template <typename T, typename MT>
+void PackRnnWeight(const T* w,
+                   int64_t rows,
+                   int64_t cols,
+                   bool transpose,
+                   std::vector<MT>* packed) {
+  packed->resize(rows * cols);
+  MT* dst = packed->data();
+  ParallelFor(0, rows, std::max<int64_t>(1, kParallelGrainSize / cols),
+              [&](int64_t begin, int64_t end) {
+                for (int64_t r = begin; r < end; ++r) {
+                  if (!transpose) {
+                    ConvertElements(w + r * cols, dst + r * cols, cols);
+                    continue;
+                  }
+                  for (int64_t c = 0; c < cols; ++c) {
+                    dst[c * rows + r] = static_cast<MT>(w[r * cols + c]);
+                  }
+                }
+              });
+}
+
+// out[rows, N] += x[rows, K] * w[K, N] for the few rows of one time step,
+// w packed. Tiles of kRnnRowBlock rows and kRnnColBlock columns read each
+// slice of w once per row tile; every output sums over k in order.
+template <typename X, typename MT>
+void RnnRowGemm(const X* x,
+                int64_t rows,
+                int64_t K,
+                int64_t N,
+                const MT* w,
+                MT* out) {
+  const int64_t row_tiles = (rows + kRnnRowBlock - 1) / kRnnRowBlock;
+  const int64_t col_tiles = (N + kRnnColBlock - 1) / kRnnColBlock;
+  const int64_t grain = std::max<int64_t>(
+      1, kParallelGrainSize / (kRnnRowBlock * kRnnColBlock * K + 1));
+  ParallelFor(0, row_tiles * col_tiles, grain, [&](int64_t first,
+                                                   int64_t last) {
+    std::vector<MT> xs(kRnnRowBlock * K);
+    for (int64_t t = first; t < last; ++t) {
+      const int64_t r0 = (t / col_tiles) * kRnnRowBlock;
+      const int64_t n0 = (t % col_tiles) * kRnnColBlock;
+      const int64_t nr = std::min(kRnnRowBlock, rows - r0);
+      const int64_t nn = std::min(kRnnColBlock, N - n0);
+      for (int64_t r = 0; r < nr; ++r) {
+        ConvertElements(x + (r0 + r) * K, xs.data() + r * K, K);
+      }
+      for (int64_t k = 0; k < K; ++k) {
+        const MT* wk = w + k * N + n0;
+        for (int64_t r = 0; r < nr; ++r) {
+          const MT xk = xs[r * K + k];
+          MT* o = out + (r0 + r) * N + n0;
+          PD_CPU_SIMD
+          for (int64_t j = 0; j < nn; ++j) {
+            o[j] += xk * wk[j];
+          }
+        }
+      }
+    }
+  });
+}
+
+template <typename MT>
+inline MT RnnSigmoid(MT v) {
+  return static_cast<MT>(1) / (static_cast<MT>(1) + std::exp(-v));
+}
+
+// Time index of processing step k of row `b` in direction `dir`, or -1
+// when the row has ended.
+inline int64_t RnnTimeIndex(const std::vector<int64_t>& lengths,
+                            int64_t b,
+                            int64_t k,
+                            int64_t dir) {
+  if (k >= lengths[b]) {
+    return -1;
+  }
+  return dir == 0 ? k : lengths[b] - 1 - k;
+}
+
+// Input projections x * W_ih^T + bias of every time step for the
+// directions of one layer, [seq_len * batch, G*H] each. The hidden bias is
+// folded in too, but for the GRU candidate where r scales it.
+template <typename T, typename MT>
+void RnnInputProjection(const RnnShape& shape,
+                        const T* input,
+                        int64_t in_size,
+                        const std::vector<RnnWeights<T>>& weights,
+                        std::vector<std::vector<T>>* biases,
+                        const std::vector<T*>& proj) {
+  const int64_t GH = shape.gates();
+  std::vector<GemmProblem<T, MT>> problems;
+  biases->resize(weights.size());
+  for (size_t d = 0; d < weights.size(); ++d) {
+    auto& bias = (*biases)[d];
+    bias.resize(GH);
+    const int64_t folded =
+        shape.mode == RnnMode::kGru ? 2 * shape.hidden : GH;
+    for (int64_t j = 0; j < GH; ++j) {
+      MT v = static_cast<MT>(weights[d].b_ih[j]);
+      if (j < folded) {
+        v += static_cast<MT>(weights[d].b_hh[j]);
+      }
+      bias[j] = static_cast<T>(v);
+    }
+    GemmEpilogue<T> ep;
+    ep.bias = bias.data();
+    ep.bias_rows = 1;
+    ep.bias_col_stride = 1;
+    problems.push_back({false,
+                        true,
+                        shape.seq_len * shape.batch,
+                        in_size,
+                        GH,
+                        input,
+                        weights[d].w_ih,
+                        proj[d],
+                        false,
+                        static_cast<MT>(1),
+                        false,
+                        ep});
+  }
+  BlockedGemmBatch<T, MT>(problems, DefaultGemmConfig());
+}
+
+// One forward step: gates from the projection rows and hh = h_prev W_hh^T,
+// activations, cell and new state into step k of `rec`, and the state to
+// the output at the row's time index.
+template <typename T, typename MT>
+void RnnCellForward(const RnnShape& shape,
+                    const std::vector<int64_t>& lengths,
+                    int64_t k,
+                    int64_t dir,
+                    const T* proj,
+                    const MT* hh,
+                    const T* b_hh,
+                    const T* h_prev,
+                    const T* c_prev,
+                    const RnnRecord<T>& rec,
+                    T* out) {
+  const int64_t B = shape.batch;
+  const int64_t H = shape.hidden;
+  const int64_t GH = shape.gates();
+  const int64_t out_stride = shape.directions * H;
+  T* gates = rec.gate(k);
+  T* h = rec.state(k);
+  T* cell = rec.cell(k);
+  ParallelFor(0, B, std::max<int64_t>(1, kParallelGrainSize / (GH + 1)),
+              [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; ++b) {
+      const int64_t t = RnnTimeIndex(lengths, b, k, dir);
+      const T* hp = h_prev + b * H;
+      if (t < 0) {
+        std::copy(hp, hp + H, h + b * H);
+        if (shape.mode == RnnMode::kLstm) {
+          std::copy(c_prev + b * H, c_prev + (b + 1) * H, cell + b * H);
+        }
+        continue;
+      }
+      const T* x = proj + (t * B + b) * GH;
+      const MT* a = hh + b * GH;
+      T* g = gates + b * GH;
+      T* hb = h + b * H;
+      T* cb = cell + b * H;
+      T* ob = out + (t * B + b) * out_stride + dir * H;
+      switch (shape.mode) {
+        case RnnMode::kLstm: {
+          const T* cp = c_prev + b * H;
+          for (int64_t j = 0; j < H; ++j) {
+            const MT i = RnnSigmoid(static_cast<MT>(x[j]) + a[j]);
+            const MT f =
+                RnnSigmoid(static_cast<MT>(x[H + j]) + a[H + j]);
+            const MT c_hat =
+                std::tanh(static_cast<MT>(x[2 * H + j]) + a[2 * H + j]);
+            const MT o =
+                RnnSigmoid(static_cast<MT>(x[3 * H + j]) + a[3 * H + j]);
+            const MT c = f * static_cast<MT>(cp[j]) + i * c_hat;
+            g[j] = static_cast<T>(i);
+            g[H + j] = static_cast<T>(f);
+            g[2 * H + j] = static_cast<T>(c_hat);
+            g[3 * H + j] = static_cast<T>(o);
+            cb[j] = static_cast<T>(c);
+            hb[j] = ob[j] = static_cast<T>(o * std::tanh(c));
+          }
+          break;
+        }
+        case RnnMode::kGru: {
+          for (int64_t j = 0; j < H; ++j) {
+            const MT r = RnnSigmoid(static_cast<MT>(x[j]) + a[j]);
+            const MT z =
+                RnnSigmoid(static_cast<MT>(x[H + j]) + a[H + j]);
+            const MT hc = a[2 * H + j] + static_cast<MT>(b_hh[2 * H + j]);
+            const MT c = std::tanh(static_cast<MT>(x[2 * H + j]) + r * hc);
+            g[j] = static_cast<T>(r);
+            g[H + j] = static_cast<T>(z);
+            g[2 * H + j] = static_cast<T>(c);
+            cb[j] = static_cast<T>(hc);
+            hb[j] = ob[j] =
+                static_cast<T>((static_cast<MT>(hp[j]) - c) * z + c);
+          }
+          break;
+        }
+        default: {
+          const bool relu = shape.mode == RnnMode::kRnnRelu;
+          for (int64_t j = 0; j < H; ++j) {
+            const MT v = static_cast<MT>(x[j]) + a[j];
+            const MT y = relu ? std::max(v, static_cast<MT>(0))
+                              : std::tanh(v);
+            g[j] = hb[j] = ob[j] = static_cast<T>(y);
+          }
+        }
+      }
+    }
+  });
+}
+
+// Zeroes the outputs past the end of every row (both directions).
+template <typename T>
+void RnnZeroPadding(const RnnShape& shape,
+                    const std::vector<int64_t>& lengths,
+                    T* out) {
+  const int64_t row = shape.directions * shape.hidden;
+  ParallelFor(0, shape.seq_len * shape.batch, 1, [&](int64_t b, int64_t e) {
+    for (int64_t i = b; i < e; ++i) {
+      if (i / shape.batch >= lengths[i % shape.batch]) {
+        std::fill(out + i * row, out + (i + 1) * row, static_cast<T>(0));
+      }
+    }
+  });
+}
+
+// Inverted dropout of a layer output into the next layer input; the mask
+// holds 0 or the scale and `keep` 0 or 1. `in` may be `mask`.
+template <typename T, typename MT>
+void RnnDropout(const T* in,
+                int64_t numel,
+                float prob,
+                const Philox4x32& philox,
+                int64_t first_block,
+                T* out,
+                T* mask,
+                uint8_t* keep) {
+  const uint64_t threshold =
+      static_cast<uint64_t>(std::ldexp(static_cast<double>(prob), 32));
+  const MT scale =
+      prob < 1.0f ? static_cast<MT>(1 / (1 - prob)) : static_cast<MT>(0);
+  const int64_t blocks = (numel + 3) / 4;
+  ParallelFor(0, blocks, kParallelGrainSize / 4, [&](int64_t b, int64_t e) {
+    for (int64_t j = b; j < e; ++j) {
+      const PhiloxBlock r = philox(first_block + j);
+      for (int64_t l = 0; l < 4 && 4 * j + l < numel; ++l) {
+        const int64_t i = 4 * j + l;
+        const bool kept = r.v[l] >= threshold;
+        const MT m = kept ? scale : static_cast<MT>(0);
+        const MT v = static_cast<MT>(in[i]);
+        mask[i] = static_cast<T>(m);
+        out[i] = static_cast<T>(v * m);
+        if (keep != nullptr) {
+          keep[i] = kept;
+        }
+      }
+    }
+  });
+}
+
+// Everything the forward and backward passes read.
+template <typename T>
+struct RnnArgs {
+  RnnShape shape;
+  std::vector<int64_t> lengths;  // per row, <= seq_len
+  std::vector<const T*> weights;
+  const T* x;
+  const T* init_h;  // [layers * directions, B, H]
+  const T* init_c;  // LSTM only
+  float dropout_prob;
+  bool is_test;
+};
+
+// Forward pass. Without is_test the records, layer inputs and masks go to
+// `reserve` (shape.reserve_size() values) for RnnBackward; `keep` (the
+// dropout_state output) gets the last dropout mask as 0 / 1.
+template <typename T, typename MT>
+void RnnForward(const RnnArgs<T>& args,
+                uint64_t philox_seed,
+                uint64_t philox_offset,
+                T* out,
+                T* last_h,
+                T* last_c,
+                T* reserve,
+                uint8_t* keep) {
+  const RnnShape& shape = args.shape;
+  const int64_t B = shape.batch;
+  const int64_t H = shape.hidden;
+  const int64_t GH = shape.gates();
+  const int64_t D = shape.directions;
+  const int64_t steps = shape.seq_len;
+  const bool train = !args.is_test;
+  const int64_t ring = train ? 0 : 2;
+  const Philox4x32 philox(philox_seed, philox_offset);
+
+  std::vector<T> local_records;
+  std::vector<T> local_io[2];
+  if (!train) {
+    local_records.resize(D * 2 * shape.step_values());
+  }
+  std::vector<std::vector<T>> proj(D);
+  std::vector<T*> proj_ptr(D);
+  for (int64_t d = 0; d < D; ++d) {
+    proj[d].resize(steps * B * GH);
+    proj_ptr[d] = proj[d].data();
+  }
+  std::vector<MT> w_hh_t;
+  std::vector<MT> hh(B * GH);
+  std::vector<std::vector<T>> biases;
+
+  const T* input = args.x;
+  for (int64_t l = 0; l < shape.layers; ++l) {
+    const bool last_layer = l + 1 == shape.layers;
+    T* layer_out = out;
+    if (!last_layer) {
+      if (train) {
+        layer_out = reserve + shape.input_offset(l + 1);
+      } else {
+        local_io[l % 2].resize(shape.io_size());
+        layer_out = local_io[l % 2].data();
+      }
+    }
+    std::vector<RnnWeights<T>> weights;
+    for (int64_t d = 0; d < D; ++d) {
+      weights.push_back(GetRnnWeights(shape, args.weights, l, d));
+    }
+    RnnInputProjection<T, MT>(
+        shape, input, shape.layer_input(l), weights, &biases, proj_ptr);
+    if (shape.dropout && train && !last_layer) {
+      // the pre-dropout output goes to the mask slot first
+      layer_out = reserve + shape.mask_offset(l + 1);
+    }
+    RnnZeroPadding(shape, args.lengths, layer_out);
+
+    for (int64_t d = 0; d < D; ++d) {
+      const int64_t s = l * D + d;
+      PackRnnWeight<T, MT>(weights[d].w_hh, GH, H, true, &w_hh_t);
+      T* base = train ? reserve + shape.record_offset(l, d)
+                      : local_records.data() + d * 2 * shape.step_values();
+      const RnnRecord<T> rec = MakeRnnRecord(shape, base, ring);
+      const T* h0 = args.init_h + s * B * H;
+      const T* c0 =
+          shape.mode == RnnMode::kLstm ? args.init_c + s * B * H : nullptr;
+      for (int64_t k = 0; k < steps; ++k) {
+        const T* h_prev = k == 0 ? h0 : rec.state(k - 1);
+        const T* c_prev = k == 0 ? c0 : rec.cell(k - 1);
+        std::fill(hh.begin(), hh.end(), static_cast<MT>(0));
+        RnnRowGemm<T, MT>(h_prev, B, H, GH, w_hh_t.data(), hh.data());
+        RnnCellForward<T, MT>(shape,
+                              args.lengths,
+                              k,
+                              d,
+                              proj[d].data(),
+                              hh.data(),
+                              weights[d].b_hh,
+                              h_prev,
+                              c_prev,
+                              rec,
+                              layer_out);
+      }
+      const T* h_end = steps > 0 ? rec.state(steps - 1) : h0;
+      std::copy(h_end, h_end + B * H, last_h + s * B * H);
+      if (shape.mode == RnnMode::kLstm) {
+        const T* c_end = steps > 0 ? rec.cell(steps - 1) : c0;
+        std::copy(c_end, c_end + B * H, last_c + s * B * H);
+      }
+    }
+
+    if (shape.dropout && train && !last_layer) {
+      T* mask = reserve + shape.mask_offset(l + 1);
+      T* next = reserve + shape.input_offset(l + 1);
+      const int64_t numel = shape.io_size();
+      // the mask slot holds the layer output until it is replaced
+      RnnDropout<T, MT>(mask,
+                        numel,
+                        args.dropout_prob,
+                        philox,
+                        l * ((numel + 3) / 4),
+                        next,
+                        mask,
+                        l + 2 == shape.layers ? keep : nullptr);
+      layer_out = next;
+    }
+    input = layer_out;
+  }
+}
+
+// Column sums of x[rows, cols] into out (accumulated when asked), as a GEMM
+// with a row of ones.
+template <typename T, typename MT>
+void RnnColumnSum(const T* x,
+                  int64_t rows,
+                  int64_t cols,
+                  const std::vector<T>& ones,
+                  T* out) {
+  BlockedGemm<T, MT>(false,
+                     false,
+                     1,
+                     rows,
+                     cols,
+                     ones.data(),
+                     x,
+                     out,
+                     false,
+                     static_cast<MT>(1),
+                     false,
+                     DefaultGemmConfig());
+}
+
+// Gradients for RnnBackward. Null pointers are skipped.
+template <typename T>
+struct RnnGrads {
+  const T* out_grad;
+  const T* last_h_grad;
+  const T* last_c_grad;
+  T* x_grad;
+  T* init_h_grad;
+  T* init_c_grad;
+  std::vector<T*> weight_grads;  // in the order of the weights
+};
+
+// Backward pass from the reserve written by RnnForward.
+template <typename T, typename MT>
+void RnnBackward(const RnnArgs<T>& args,
+                 const T* reserve,
+                 const RnnGrads<T>& grads) {
+  const RnnShape& shape = args.shape;
+  const int64_t B = shape.batch;
+  const int64_t H = shape.hidden;
+  const int64_t GH = shape.gates();
+  const int64_t D = shape.directions;
+  const int64_t steps = shape.seq_len;
+  const int64_t out_stride = D * H;
+  const auto& lengths = args.lengths;
+  const bool lstm = shape.mode == RnnMode::kLstm;
+  const bool gru = shape.mode == RnnMode::kGru;
+
+  std::vector<T> ones(steps * B, static_cast<T>(1));
+  std::vector<T> dgx(steps * B * GH);   // by time, as the projection
+  std::vector<T> dhh(steps * B * GH);   // by step, as the recurrence
+  std::vector<T> layer_grad[2];
+  std::vector<MT> w_hh;
+  std::vector<MT> dh(B * H), dh_next(B * H), dc(B * H);
+  std::vector<T> dh_t(B * H);
+
+  const T* dout = grads.out_grad;
+  for (int64_t l = shape.layers - 1; l >= 0; --l) {
+    const int64_t in_size = shape.layer_input(l);
+    const T* input =
+        l == 0 ? args.x : reserve + shape.input_offset(l);
+    T* dinput = nullptr;
+    if (l > 0) {
+      layer_grad[l % 2].resize(shape.io_size());
+      dinput = layer_grad[l % 2].data();
+    } else {
+      dinput = grads.x_grad;
+    }
+
+    for (int64_t d = 0; d < D; ++d) {
+      const int64_t s = l * D + d;
+      const RnnWeights<T> weights = GetRnnWeights(shape, args.weights, l, d);
+      PackRnnWeight<T, MT>(weights.w_hh, GH, H, false, &w_hh);
+      const RnnRecord<T> rec = MakeRnnRecord(
+          shape, const_cast<T*>(reserve) + shape.record_offset(l, d), 0);
+      const T* h0 = args.init_h + s * B * H;
+      const T* c0 = lstm ? args.init_c + s * B * H : nullptr;
+      for (int64_t i = 0; i < B * H; ++i) {
+        dh[i] = grads.last_h_grad != nullptr
+                    ? static_cast<MT>(grads.last_h_grad[s * B * H + i])
+                    : static_cast<MT>(0);
+        dc[i] = lstm && grads.last_c_grad != nullptr
+                    ? static_cast<MT>(grads.last_c_grad[s * B * H + i])
+                    : static_cast<MT>(0);
+      }
+      std::fill(dgx.begin(), dgx.end(), static_cast<T>(0));
+
+      for (int64_t k = steps - 1; k >= 0; --k) {
+        const T* h_prev = k == 0 ? h0 : rec.state(k - 1);
+        const T* c_prev = k == 0 ? c0 : rec.cell(k - 1);
+        const T* gates = rec.gate(k);
+        const T* cell = rec.cell(k);
+        T* dhh_k = dhh.data() + k * B * GH;
+        ParallelFor(0, B, std::max<int64_t>(1, kParallelGrainSize / GH),
+                    [&](int64_t begin, int64_t end) {
+          for (int64_t b = begin; b < end; ++b) {
+            const int64_t t = RnnTimeIndex(lengths, b, k, d);
+            MT* dhb = dh.data() + b * H;
+            MT* dnb = dh_next.data() + b * H;
+            T* dr = dhh_k + b * GH;
+            if (t < 0) {
+              std::copy(dhb, dhb + H, dnb);
+              std::fill(dr, dr + GH, static_cast<T>(0));
+              continue;
+            }
+            const T* dob = dout + (t * B + b) * out_stride + d * H;
+            const T* g = gates + b * GH;
+            const T* hp = h_prev + b * H;
+            MT* dcb = dc.data() + b * H;
+            T* dx = dgx.data() + (t * B + b) * GH;
+            for (int64_t j = 0; j < H; ++j) {
+              const MT dhj = dhb[j] + static_cast<MT>(dob[j]);
+              MT direct = 0;
+              if (lstm) {
+                const MT i = static_cast<MT>(g[j]);
+                const MT f = static_cast<MT>(g[H + j]);
+                const MT c_hat = static_cast<MT>(g[2 * H + j]);
+                const MT o = static_cast<MT>(g[3 * H + j]);
+                const MT tc = std::tanh(static_cast<MT>(cell[b * H + j]));
+                const MT dcj = dcb[j] + dhj * o * (1 - tc * tc);
+                const MT di = dcj * c_hat * i * (1 - i);
+                const MT df =
+                    dcj * static_cast<MT>(c_prev[b * H + j]) * f * (1 - f);
+                const MT dg = dcj * i * (1 - c_hat * c_hat);
+                const MT dout_gate = dhj * tc * o * (1 - o);
+                dcb[j] = dcj * f;
+                dx[j] = dr[j] = static_cast<T>(di);
+                dx[H + j] = dr[H + j] = static_cast<T>(df);
+                dx[2 * H + j] = dr[2 * H + j] = static_cast<T>(dg);
+                dx[3 * H + j] = dr[3 * H + j] = static_cast<T>(dout_gate);
+              } else if (gru) {
+                const MT r = static_cast<MT>(g[j]);
+                const MT z = static_cast<MT>(g[H + j]);
+                const MT c = static_cast<MT>(g[2 * H + j]);
+                const MT hc = static_cast<MT>(cell[b * H + j]);
+                const MT h_old = static_cast<MT>(hp[j]);
+                const MT dcand = dhj * (1 - z) * (1 - c * c);
+                const MT dr_pre = dcand * hc * r * (1 - r);
+                const MT dz_pre = dhj * (h_old - c) * z * (1 - z);
+                direct = dhj * z;
+                dx[j] = dr[j] = static_cast<T>(dr_pre);
+                dx[H + j] = dr[H + j] = static_cast<T>(dz_pre);
+                dx[2 * H + j] = static_cast<T>(dcand);
+                dr[2 * H + j] = static_cast<T>(dcand * r);
+              } else {
+                const MT y = static_cast<MT>(g[j]);
+                const MT dv = shape.mode == RnnMode::kRnnRelu
+                                  ? (y > 0 ? dhj : static_cast<MT>(0))
+                                  : dhj * (1 - y * y);
+                dx[j] = dr[j] = static_cast<T>(dv);
+              }
+              dnb[j] = direct;
+            }
+          }
+        });
+        RnnRowGemm<T, MT>(dhh_k, B, GH, H, w_hh.data(), dh_next.data());
+        std::swap(dh, dh_next);
+      }
+      if (grads.init_h_grad != nullptr) {
+        for (int64_t i = 0; i < B * H; ++i) {
+          grads.init_h_grad[s * B * H + i] = static_cast<T>(dh[i]);
+        }
+      }
+      if (lstm && grads.init_c_grad != nullptr) {
+        for (int64_t i = 0; i < B * H; ++i) {
+          grads.init_c_grad[s * B * H + i] = static_cast<T>(dc[i]);
+        }
+      }
+
+      const int64_t w = 2 * s;
+      const int64_t bias = 2 * shape.layers * D + w;
+      auto grad_of = [&](int64_t i) {
+        return static_cast<size_t>(i) < grads.weight_grads.size()
+                   ? grads.weight_grads[i]
+                   : nullptr;
+      };
+      const MT one = static_cast<MT>(1);
+      const auto config = DefaultGemmConfig();
+      if (grad_of(w) != nullptr) {
+        BlockedGemm<T, MT>(true, false, GH, steps * B, in_size, dgx.data(),
+                           input, grad_of(w), false, one, false, config);
+      }
+      if (grad_of(w + 1) != nullptr) {
+        // step 0 starts from init_h, step k from the state of step k - 1
+        BlockedGemm<T, MT>(true, false, GH, B, H, dhh.data(), h0,
+                           grad_of(w + 1), false, one, false, config);
+        if (steps > 1) {
+          BlockedGemm<T, MT>(true, false, GH, (steps - 1) * B, H,
+                             dhh.data() + B * GH, rec.state(0),
+                             grad_of(w + 1), false, one, true, config);
+        }
+      }
+      if (grad_of(bias) != nullptr) {
+        RnnColumnSum<T, MT>(dgx.data(), steps * B, GH, ones, grad_of(bias));
+      }
+      if (grad_of(bias + 1) != nullptr) {
+        RnnColumnSum<T, MT>(
+            dhh.data(), steps * B, GH, ones, grad_of(bias + 1));
+      }
+      if (dinput != nullptr) {
+        BlockedGemm<T, MT>(false, false, steps * B, GH, in_size, dgx.data(),
+                           weights.w_ih, dinput, false, one, d > 0, config);
+      }
+    }
+
+    if (l > 0 && shape.dropout) {
+      const T* mask = reserve + shape.mask_offset(l);
+      const int64_t numel = shape.io_size();
+      ParallelFor(0, numel, kParallelGrainSize, [&](int64_t b, int64_t e) {
+        PD_CPU_SIMD
+        for (int64_t i = b; i < e; ++i) {
+          dinput[i] = static_cast<T>(static_cast<MT>(dinput[i]) *
+                                     static_cast<MT>(mask[i]));
+        }
+      });
+    }
+    dout = dinput;
+  }
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
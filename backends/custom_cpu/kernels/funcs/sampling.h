@@ -0,0 +1,260 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Token sampling for the generation loop, one vocabulary row at a time:
+//
+//   1. penalties on the tokens generated so far, applied sparsely from the
+//      sorted ids instead of a vocab sized count table;
+//   2. temperature and softmax: a max sweep and an exp-and-sum sweep;
+//   3. top-k / top-p by partial selection: a histogram sweep finds where
+//      the cut falls and only the tokens above it are sorted (the common
+//      case sorts a few dozen to a few thousand tokens out of tens of
+//      thousands);
+//   4. a multinomial draw among the kept tokens.
+//
+// Rows are independent, callers run them in parallel over the batch with
+// one SamplingScratch per thread.
+
+namespace custom_kernel {
+namespace funcs {
+
+// Logit of tokens that must not be produced, the value the generation ops
+// of the other backends use.
+constexpr float kMaskedLogit = -1e10f;
+
+struct SamplingScratch {
+  std::vector<float> row;
+  std::vector<int64_t> order;
+  std::vector<std::pair<int64_t, int64_t>> counts;
+  std::vector<float> bucket_mass;
+  std::vector<int64_t> bucket_count;
+};
+
+struct TokenPenalty {
+  float repetition = 1.0f;
+  float frequency = 0.0f;
+  float presence = 0.0f;
+};
+
+// (token, occurrences) of ids[0, n) in increasing token order. The ids end
+// at the first negative one; ids outside the vocabulary are ignored.
+inline void CountTokens(const int64_t* ids,
+                        int64_t n,
+                        int64_t vocab,
+                        SamplingScratch* scratch) {
+  auto& counts = scratch->counts;
+  counts.clear();
+  std::vector<int64_t>& sorted = scratch->order;
+  sorted.clear();
+  for (int64_t i = 0; i < n && ids[i] >= 0; ++i) {
+    if (ids[i] < vocab) {
+      sorted.push_back(ids[i]);
+    }
+  }
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < sorted.size();) {
+    size_t j = i;
+    while (j < sorted.size() && sorted[j] == sorted[i]) {
+      ++j;
+    }
+    counts.emplace_back(sorted[i], static_cast<int64_t>(j - i));
+    i = j;
+  }
+}
+
+// Repetition, frequency and presence penalties on the counted tokens: a
+// repeated logit is divided by the repetition penalty (multiplied when
+// negative), then frequency * count + presence is subtracted.
+inline void ApplyTokenPenalty(const TokenPenalty& penalty,
+                              const SamplingScratch& scratch,
+                              float* logits) {
+  for (const auto& count : scratch.counts) {
+    float& logit = logits[count.first];
+    logit = logit < 0 ? logit * penalty.repetition
+                      : logit / penalty.repetition;
+    logit -= count.second * penalty.frequency + penalty.presence;
+  }
+}
+
+inline void MaskTokens(const int64_t* tokens,
+                       int64_t n,
+                       int64_t vocab,
+                       float* logits) {
+  for (int64_t i = 0; i < n; ++i) {
+    if (tokens[i] >= 0 && tokens[i] < vocab) {
+      logits[tokens[i]] = kMaskedLogit;
+    }
+  }
+}
+
+inline bool IsEndToken(int64_t token, const int64_t* end_ids, int64_t n) {
+  for (int64_t i = 0; i < n; ++i) {
+    if (token == end_ids[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// probs[i] = exp((logits[i] - max) / temperature) in place; returns the
+// sum, the normalizer of the softmax.
+inline float ExpInPlace(float* logits, int64_t n, float temperature) {
+  float max = logits[0];
+  for (int64_t i = 1; i < n; ++i) {
+    max = std::max(max, logits[i]);
+  }
+  const float inv_temperature = 1.0f / temperature;
+  float sum = 0.0f;
+  for (int64_t i = 0; i < n; ++i) {
+    logits[i] = std::exp((logits[i] - max) * inv_temperature);
+    sum += logits[i];
+  }
+  return sum;
+}
+
+// The bits of a non-negative float order like its value; the top 11
+// (exponent and 3 mantissa bits) split probabilities into buckets 1/8 of
+// an octave wide.
+constexpr int kSamplingBucketShift = 20;
+constexpr int64_t kSamplingBuckets = int64_t{1} << 11;
+
+inline int64_t ProbabilityBucket(float p) {
+  if (!(p > 0.0f)) {
+    return 0;
+  }
+  uint32_t bits;
+  std::memcpy(&bits, &p, sizeof(bits));
+  return bits >> kSamplingBucketShift;
+}
+
+// Draws a token from probs[0, n) (unnormalized, `total` is their sum) with
+// u uniform in [0, 1). Only the top_k most probable tokens (all for
+// top_k <= 0) are kept, of those the fewest whose mass reaches top_p of
+// the total, and of those the ones with probability >= threshold (the most
+// probable token is always kept).
+//
+// One sweep builds a histogram of mass and count per bucket; walking it
+// from the top gives the bucket holding the cut, and only the tokens of
+// that bucket and above are sorted. Should rounding leave them short of
+// the mass, the rest of the row follows in doubling batches.
+inline int64_t SampleToken(const float* probs,
+                           int64_t n,
+                           float total,
+                           int64_t top_k,
+                           float top_p,
+                           float threshold,
+                           double u,
+                           SamplingScratch* scratch) {
+  const int64_t limit = top_k > 0 ? std::min(top_k, n) : n;
+  const float mass_limit = top_p * total;
+  const float min_prob = threshold * total;
+
+  auto& bucket_mass = scratch->bucket_mass;
+  auto& bucket_count = scratch->bucket_count;
+  bucket_mass.assign(kSamplingBuckets, 0.0f);
+  bucket_count.assign(kSamplingBuckets, 0);
+  for (int64_t i = 0; i < n; ++i) {
+    const int64_t bucket = ProbabilityBucket(probs[i]);
+    bucket_mass[bucket] += probs[i];
+    ++bucket_count[bucket];
+  }
+  int64_t cut = kSamplingBuckets - 1;
+  float mass = 0.0f;
+  int64_t count = 0;
+  for (; cut > 0; --cut) {
+    mass += bucket_mass[cut];
+    count += bucket_count[cut];
+    if (count > 0 && (mass >= mass_limit || count >= limit)) {
+      break;
+    }
+  }
+
+  auto& order = scratch->order;
+  order.resize(n);
+  int64_t candidates = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    if (ProbabilityBucket(probs[i]) >= cut) {
+      order[candidates++] = i;
+    }
+  }
+  int64_t filled = candidates;
+
+  // descending probability, ties to the smaller id: a total order, so the
+  // selection does not depend on the library's nth_element
+  auto before = [probs](int64_t a, int64_t b) {
+    return probs[a] > probs[b] || (probs[a] == probs[b] && a < b);
+  };
+  mass = 0.0f;
+  int64_t kept = 0;
+  int64_t sorted = 0;
+  int64_t batch_end = std::min(candidates, limit);
+  bool done = false;
+  while (!done) {
+    if (batch_end > filled) {
+      // the cut was short: append every token below it
+      for (int64_t i = 0; i < n; ++i) {
+        if (ProbabilityBucket(probs[i]) < cut) {
+          order[filled++] = i;
+        }
+      }
+    }
+    if (batch_end < filled) {
+      std::nth_element(order.begin() + sorted,
+                       order.begin() + batch_end,
+                       order.begin() + filled,
+                       before);
+    }
+    std::sort(order.begin() + sorted, order.begin() + batch_end, before);
+    for (int64_t i = sorted; i < batch_end; ++i) {
+      const float p = probs[order[i]];
+      if (kept > 0 && p < min_prob) {
+        done = true;
+        break;
+      }
+      mass += p;
+      ++kept;
+      // stop here rather than at the next candidate, which for the last
+      // one of a batch would first pull the rest of the row in
+      if (mass >= mass_limit) {
+        done = true;
+        break;
+      }
+    }
+    sorted = batch_end;
+    done = done || sorted == limit;
+    batch_end = std::min(limit, std::max(2 * sorted, sorted + 1));
+  }
+
+  const float target = static_cast<float>(u) * mass;
+  float running = 0.0f;
+  for (int64_t i = 0; i < kept; ++i) {
+    running += probs[order[i]];
+    if (target < running) {
+      return order[i];
+    }
+  }
+  return order[kept - 1];
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
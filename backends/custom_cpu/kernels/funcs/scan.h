@@ -0,0 +1,342 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/parallel.h"
+
+// Prefix scans (cumsum, cumprod, logcumsumexp) along one axis.
+//
+// With outer = prod(dims[:axis]) and inner = prod(dims[axis + 1:]) the
+// tensor is `outer` x `inner` lines of `len` elements. Lines are scanned in
+// blocks of kScanBlock elements: each block is scanned locally from the
+// identity and combined with the running total of the blocks before it.
+//
+// A few long lines (inner == 1) are scanned in three phases over all
+// blocks in parallel: reduce every block, scan the block totals, rescan
+// every block from its offset. Many lines are scanned one line per
+// iteration. Both orders do the same arithmetic, so the result only
+// depends on the shape, never on the thread count.
+//
+// Lines with inner > 1 are scanned along the axis with the inner elements
+// as the vector dimension.
+
+namespace custom_kernel {
+namespace funcs {
+
+constexpr int64_t kScanBlock = 2048;
+
+struct ScanShape {
+  int64_t outer = 1;
+  int64_t len = 1;
+  int64_t inner = 1;
+};
+
+inline ScanShape GetScanShape(const std::vector<int64_t>& dims,
+                              int axis,
+                              bool flatten) {
+  ScanShape shape;
+  if (flatten || dims.empty()) {
+    for (auto d : dims) {
+      shape.len *= d;
+    }
+    return shape;
+  }
+  const int rank = static_cast<int>(dims.size());
+  if (axis < 0) {
+    axis += rank;
+  }
+  for (int i = 0; i < rank; ++i) {
+    if (i < axis) {
+      shape.outer *= dims[i];
+    } else if (i == axis) {
+      shape.len = dims[i];
+    } else {
+      shape.inner *= dims[i];
+    }
+  }
+  return shape;
+}
+
+// CUSTOM_CPU_SCAN_FP64=1 accumulates float scans in double.
+inline bool ScanInDouble() {
+  static const bool enabled = [] {
+    const char* value = std::getenv("CUSTOM_CPU_SCAN_FP64");
+    return value != nullptr && std::strcmp(value, "1") == 0;
+  }();
+  return enabled;
+}
+
+struct SumOp {
+  template <typename MT>
+  static MT Identity() {
+    return MT(0);
+  }
+  template <typename MT>
+  static MT Apply(MT a, MT b) {
+    return a + b;
+  }
+};
+
+struct ProdOp {
+  template <typename MT>
+  static MT Identity() {
+    return MT(1);
+  }
+  template <typename MT>
+  static MT Apply(MT a, MT b) {
+    return a * b;
+  }
+};
+
+// log(exp(a) + exp(b)) without overflow; -inf is the identity. A NaN is
+// propagated, which std::max / std::min alone would drop.
+struct LogAddExpOp {
+  template <typename MT>
+  static MT Identity() {
+    return -std::numeric_limits<MT>::infinity();
+  }
+  template <typename MT>
+  static MT Apply(MT a, MT b) {
+    if (a != a || b != b) {
+      return std::numeric_limits<MT>::quiet_NaN();
+    }
+    const MT hi = std::max(a, b);
+    const MT lo = std::min(a, b);
+    if (lo == -std::numeric_limits<MT>::infinity() || hi == lo) {
+      return lo == hi ? hi + static_cast<MT>(M_LN2) : hi;
+    }
+    return hi + std::log1p(std::exp(lo - hi));
+  }
+};
+
+// Folds x[0, n) from the identity, the total BlockScan returns.
+template <typename MT, typename Op>
+MT BlockReduce(const MT* x, int64_t n) {
+  MT carry = Op::template Identity<MT>();
+  for (int64_t k = 0; k < n; ++k) {
+    carry = Op::Apply(carry, x[k]);
+  }
+  return carry;
+}
+
+// y[k] = offset (op) prefix of x, inclusive or exclusive of x[k]; returns
+// the total of x. The prefix is folded from the identity and combined with
+// the offset afterwards, so the blocks of a line can be scanned in any
+// order with the same result. x and y may be the same buffer.
+template <typename MT, typename Op>
+MT BlockScan(const MT* x, MT* y, int64_t n, MT offset, bool exclusive) {
+  MT carry = Op::template Identity<MT>();
+  for (int64_t k = 0; k < n; ++k) {
+    const MT next = Op::Apply(carry, x[k]);
+    y[k] = Op::Apply(offset, exclusive ? carry : next);
+    carry = next;
+  }
+  return carry;
+}
+
+// Block [first, first + n) of a contiguous line in scan order is the
+// block [len - first - n, len - first) reversed for reverse scans.
+// Blocks that need no conversion or reversal are scanned in place of the
+// tensors, the others are staged through `buffer`.
+template <typename T, typename MT, typename Op>
+MT ReduceLineBlock(const T* line,
+                   int64_t len,
+                   int64_t first,
+                   int64_t n,
+                   bool reverse,
+                   MT* buffer) {
+  if (std::is_same<T, MT>::value && !reverse) {
+    return BlockReduce<MT, Op>(reinterpret_cast<const MT*>(line) + first, n);
+  }
+  ConvertElements(line + (reverse ? len - first - n : first), buffer, n);
+  if (reverse) {
+    std::reverse(buffer, buffer + n);
+  }
+  return BlockReduce<MT, Op>(buffer, n);
+}
+
+template <typename T, typename MT, typename Op>
+MT ScanLineBlock(const T* x_line,
+                 T* y_line,
+                 int64_t len,
+                 int64_t first,
+                 int64_t n,
+                 MT offset,
+                 bool exclusive,
+                 bool reverse,
+                 MT* buffer) {
+  if (std::is_same<T, MT>::value && !reverse) {
+    return BlockScan<MT, Op>(reinterpret_cast<const MT*>(x_line) + first,
+                             reinterpret_cast<MT*>(y_line) + first,
+                             n,
+                             offset,
+                             exclusive);
+  }
+  const int64_t begin = reverse ? len - first - n : first;
+  ConvertElements(x_line + begin, buffer, n);
+  if (reverse) {
+    std::reverse(buffer, buffer + n);
+  }
+  const MT total = BlockScan<MT, Op>(buffer, buffer, n, offset, exclusive);
+  if (reverse) {
+    std::reverse(buffer, buffer + n);
+  }
+  ConvertElements(buffer, y_line + begin, n);
+  return total;
+}
+
+template <typename T, typename MT, typename Op>
+void ScanContiguousLines(const T* x,
+                         T* y,
+                         int64_t lines,
+                         int64_t len,
+                         bool exclusive,
+                         bool reverse) {
+  const int64_t blocks = (len + kScanBlock - 1) / kScanBlock;
+  if (lines >= GetMaxThreads() || blocks < 2) {
+    ParallelFor(0, lines, 1, [&](int64_t begin, int64_t end) {
+      std::vector<MT> buffer(kScanBlock);
+      for (int64_t r = begin; r < end; ++r) {
+        MT offset = Op::template Identity<MT>();
+        for (int64_t first = 0; first < len; first += kScanBlock) {
+          const MT total =
+              ScanLineBlock<T, MT, Op>(x + r * len,
+                                       y + r * len,
+                                       len,
+                                       first,
+                                       std::min(kScanBlock, len - first),
+                                       offset,
+                                       exclusive,
+                                       reverse,
+                                       buffer.data());
+          offset = Op::Apply(offset, total);
+        }
+      }
+    });
+    return;
+  }
+
+  // phase 1: the total of every block of every line
+  std::vector<MT> offsets(lines * blocks);
+  ParallelFor(0, lines * blocks, 1, [&](int64_t begin, int64_t end) {
+    std::vector<MT> buffer(kScanBlock);
+    for (int64_t i = begin; i < end; ++i) {
+      const int64_t r = i / blocks;
+      const int64_t first = (i % blocks) * kScanBlock;
+      offsets[i] =
+          ReduceLineBlock<T, MT, Op>(x + r * len,
+                                     len,
+                                     first,
+                                     std::min(kScanBlock, len - first),
+                                     reverse,
+                                     buffer.data());
+    }
+  });
+  // phase 2: exclusive scan of the block totals of each line
+  for (int64_t r = 0; r < lines; ++r) {
+    MT running = Op::template Identity<MT>();
+    for (int64_t b = 0; b < blocks; ++b) {
+      const MT total = offsets[r * blocks + b];
+      offsets[r * blocks + b] = running;
+      running = Op::Apply(running, total);
+    }
+  }
+  // phase 3: rescan every block from its offset
+  ParallelFor(0, lines * blocks, 1, [&](int64_t begin, int64_t end) {
+    std::vector<MT> buffer(kScanBlock);
+    for (int64_t i = begin; i < end; ++i) {
+      const int64_t r = i / blocks;
+      const int64_t first = (i % blocks) * kScanBlock;
+      ScanLineBlock<T, MT, Op>(x + r * len,
+                               y + r * len,
+                               len,
+                               first,
+                               std::min(kScanBlock, len - first),
+                               offsets[i],
+                               exclusive,
+                               reverse,
+                               buffer.data());
+    }
+  });
+}
+
+// Scans along the middle axis of [outer, len, inner], inner > 1, tiles of
+// the inner axis being the vector dimension.
+template <typename T, typename MT, typename Op>
+void ScanStridedLines(const T* x,
+                      T* y,
+                      const ScanShape& shape,
+                      bool exclusive,
+                      bool reverse) {
+  const int64_t tiles = (shape.inner + kCastBlock - 1) / kCastBlock;
+  ParallelFor(0, shape.outer * tiles, 1, [&](int64_t begin, int64_t end) {
+    MT carry[kCastBlock];
+    MT row[kCastBlock];
+    for (int64_t i = begin; i < end; ++i) {
+      const int64_t o = i / tiles;
+      const int64_t first = (i % tiles) * kCastBlock;
+      const int64_t n = std::min(kCastBlock, shape.inner - first);
+      std::fill(carry, carry + n, Op::template Identity<MT>());
+      for (int64_t k = 0; k < shape.len; ++k) {
+        const int64_t j = reverse ? shape.len - 1 - k : k;
+        const int64_t offset = (o * shape.len + j) * shape.inner + first;
+        ConvertElements(x + offset, row, n);
+        PD_CPU_SIMD
+        for (int64_t c = 0; c < n; ++c) {
+          const MT next = Op::Apply(carry[c], row[c]);
+          row[c] = exclusive ? carry[c] : next;
+          carry[c] = next;
+        }
+        ConvertElements(row, y + offset, n);
+      }
+    }
+  });
+}
+
+template <typename T, typename MT, typename Op>
+void Scan(const T* x,
+          T* y,
+          const ScanShape& shape,
+          bool exclusive,
+          bool reverse) {
+  if (shape.outer * shape.len * shape.inner == 0) {
+    return;
+  }
+  if (shape.inner == 1) {
+    ScanContiguousLines<T, MT, Op>(
+        x, y, shape.outer, shape.len, exclusive, reverse);
+  } else {
+    ScanStridedLines<T, MT, Op>(x, y, shape, exclusive, reverse);
+  }
+}
+
+// Offset of the first element of line i = o * inner + c; elements of a line
+// are shape.inner apart.
+inline int64_t ScanLineOffset(const ScanShape& shape, int64_t i) {
+  return i / shape.inner * shape.len * shape.inner + i % shape.inner;
+}
+
+}  // namespace funcs
+}  // namespace custom_kernel
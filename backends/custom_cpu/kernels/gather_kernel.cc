@@ -0,0 +1,196 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <numeric>
+
+#include "kernels/funcs/index_engine.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+static inline int64_t Product(const std::vector<int64_t>& dims,
+                              int64_t begin,
+                              int64_t end) {
+  return std::accumulate(dims.cbegin() + begin,
+                         dims.cbegin() + end,
+                         static_cast<int64_t>(1),
+                         std::multiplies<int64_t>());
+}
+
+template <typename T>
+void GatherKernel(const phi::Context& dev_ctx,
+                  const phi::DenseTensor& x,
+                  const phi::DenseTensor& index,
+                  const phi::Scalar& axis_scalar,
+                  phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  const int64_t rank = x_dims.size();
+  int64_t axis = axis_scalar.to<int64_t>();
+  if (axis < 0) {
+    axis += rank;
+  }
+  const int64_t rows = x_dims[axis];
+  auto idx = funcs::ReadIndex(index, rows, "gather");
+
+  auto out_dims = x_dims;
+  if (index.dims().empty()) {
+    out_dims.erase(out_dims.begin() + axis);
+  } else {
+    out_dims[axis] = idx.size();
+  }
+  out->Resize(out_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  funcs::GatherSlices(x.data<T>(),
+                      Product(x_dims, 0, axis),
+                      rows,
+                      Product(x_dims, axis + 1, rank),
+                      idx,
+                      out_data);
+}
+
+template <typename T>
+void GatherGradKernel(const phi::Context& dev_ctx,
+                      const phi::DenseTensor& x,
+                      const phi::DenseTensor& index,
+                      const phi::DenseTensor& out_grad,
+                      const phi::Scalar& axis_scalar,
+                      phi::DenseTensor* x_grad) {
+  auto x_dims = x.dims();
+  const int64_t rank = x_dims.size();
+  int64_t axis = axis_scalar.to<int64_t>();
+  if (axis < 0) {
+    axis += rank;
+  }
+  const int64_t rows = x_dims[axis];
+  auto idx = funcs::ReadIndex(index, rows, "gather_grad");
+
+  x_grad->Resize(x_dims);
+  auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+  funcs::ParallelMemset(x_grad_data, 0, x_grad->numel() * sizeof(T));
+  funcs::ScatterSlices(out_grad.data<T>(),
+                       Product(x_dims, 0, axis),
+                       rows,
+                       Product(x_dims, axis + 1, rank),
+                       idx,
+                       funcs::ScatterMode::kAddToZero,
+                       x_grad_data);
+}
+
+template <typename T>
+void GatherNdKernel(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& x,
+                    const phi::DenseTensor& index,
+                    phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  auto index_dims = index.dims();
+  const int64_t depth = index_dims.empty() ? 0 : index_dims.back();
+
+  std::vector<int64_t> out_dims(index_dims.begin(), index_dims.end());
+  if (!out_dims.empty()) {
+    out_dims.pop_back();
+  }
+  out_dims.insert(out_dims.end(), x_dims.begin() + depth, x_dims.end());
+  out->Resize(out_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  auto rows = funcs::NdIndexToRows(index, x_dims, "gather_nd");
+  funcs::GatherSlices(x.data<T>(),
+                      1,
+                      Product(x_dims, 0, depth),
+                      Product(x_dims, depth, x_dims.size()),
+                      rows,
+                      out_data);
+}
+
+template <typename T>
+void GatherNdGradKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        const phi::DenseTensor& index,
+                        const phi::DenseTensor& out_grad,
+                        phi::DenseTensor* x_grad) {
+  auto x_dims = x.dims();
+  auto index_dims = index.dims();
+  const int64_t depth = index_dims.empty() ? 0 : index_dims.back();
+
+  x_grad->Resize(x_dims);
+  auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+  funcs::ParallelMemset(x_grad_data, 0, x_grad->numel() * sizeof(T));
+  if (out_grad.numel() == 0) {
+    return;
+  }
+
+  auto rows = funcs::NdIndexToRows(index, x_dims, "gather_nd_grad");
+  funcs::ScatterSlices(out_grad.data<T>(),
+                       1,
+                       Product(x_dims, 0, depth),
+                       Product(x_dims, depth, x_dims.size()),
+                       rows,
+                       funcs::ScatterMode::kAddToZero,
+                       x_grad_data);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(gather,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::GatherKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(gather_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::GatherGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(gather_nd,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::GatherNdKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(gather_nd_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::GatherNdGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
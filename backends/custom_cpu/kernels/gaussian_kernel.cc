@@ -0,0 +1,283 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/philox.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Philox blocks turned into normals per Box-Muller batch.
+constexpr int64_t kBoxMullerBatch = 256;
+
+// Attempts (of four candidates each) before truncated sampling falls back to
+// the inverse CDF.
+constexpr uint32_t kTruncatedMaxAttempts = 64;
+
+// Truncation windows with a smaller acceptance probability go straight to
+// the inverse CDF.
+constexpr double kTruncatedMinAcceptance = 0.25;
+
+// Fills data[4 * first_block, 4 * end_block) with standard normals. The
+// uniforms of a batch are unpacked first so the log/sqrt/sin/cos loop runs
+// over plain arrays.
+static void FillStandardNormal(const funcs::Philox4x32 &philox,
+                               int64_t first_block,
+                               int64_t end_block,
+                               float *out) {
+  constexpr int64_t kPairs = kBoxMullerBatch * 2;
+  constexpr float kTwoPi = 6.283185307179586f;
+  float u1[kPairs];
+  float u2[kPairs];
+  float z0[kPairs];
+  float z1[kPairs];
+  for (int64_t b0 = first_block; b0 < end_block; b0 += kBoxMullerBatch) {
+    const int64_t blocks = std::min(kBoxMullerBatch, end_block - b0);
+    for (int64_t b = 0; b < blocks; ++b) {
+      const funcs::PhiloxBlock r = philox(b0 + b);
+      // 1 - u keeps the argument of log in (0, 1].
+      u1[2 * b] = 1.0f - funcs::Uint32ToUnitFloat(r.v[0]);
+      u2[2 * b] = funcs::Uint32ToUnitFloat(r.v[1]);
+      u1[2 * b + 1] = 1.0f - funcs::Uint32ToUnitFloat(r.v[2]);
+      u2[2 * b + 1] = funcs::Uint32ToUnitFloat(r.v[3]);
+    }
+    const int64_t pairs = blocks * 2;
+    PD_CPU_SIMD
+    for (int64_t i = 0; i < pairs; ++i) {
+      const float radius = std::sqrt(-2.0f * std::log(u1[i]));
+      const float theta = kTwoPi * u2[i];
+      z0[i] = radius * std::cos(theta);
+      z1[i] = radius * std::sin(theta);
+    }
+    float *dst = out + (b0 - first_block) * funcs::kPhiloxLanes;
+    for (int64_t i = 0; i < pairs; ++i) {
+      dst[2 * i] = z0[i];
+      dst[2 * i + 1] = z1[i];
+    }
+  }
+}
+
+// Element i is lane i % 4 of Philox block i / 4; each block yields two
+// Box-Muller pairs.
+template <typename T>
+void PhiloxGaussianFill(const funcs::Philox4x32 &philox,
+                        T *data,
+                        int64_t size,
+                        float mean,
+                        float std) {
+  const int64_t num_blocks =
+      (size + funcs::kPhiloxLanes - 1) / funcs::kPhiloxLanes;
+  funcs::ParallelFor(
+      0,
+      num_blocks,
+      kBoxMullerBatch,
+      [&](int64_t begin, int64_t end) {
+        float normal[kBoxMullerBatch * funcs::kPhiloxLanes];
+        for (int64_t b0 = begin; b0 < end; b0 += kBoxMullerBatch) {
+          const int64_t b1 = std::min(end, b0 + kBoxMullerBatch);
+          FillStandardNormal(philox, b0, b1, normal);
+          const int64_t first = b0 * funcs::kPhiloxLanes;
+          const int64_t count =
+              std::min(size, b1 * funcs::kPhiloxLanes) - first;
+          for (int64_t i = 0; i < count; ++i) {
+            data[first + i] = static_cast<T>(normal[i] * std + mean);
+          }
+        }
+      });
+}
+
+// Doubles take a full block per pair: 53-bit uniforms from lanes (0, 1) and
+// (2, 3).
+template <>
+void PhiloxGaussianFill<double>(const funcs::Philox4x32 &philox,
+                                double *data,
+                                int64_t size,
+                                float mean,
+                                float std) {
+  constexpr double kTwoPi = 6.283185307179586;
+  const int64_t num_blocks = (size + 1) / 2;
+  funcs::PhiloxParallelFor(
+      philox,
+      num_blocks,
+      funcs::kParallelGrainSize / 2,
+      [&](int64_t b, const funcs::PhiloxBlock &r) {
+        const double u1 = 1.0 - funcs::Uint64ToUnitDouble(r.v[0], r.v[1]);
+        const double u2 = funcs::Uint64ToUnitDouble(r.v[2], r.v[3]);
+        const double radius = std::sqrt(-2.0 * std::log(u1));
+        data[2 * b] = radius * std::cos(kTwoPi * u2) * std + mean;
+        if (2 * b + 1 < size) {
+          data[2 * b + 1] = radius * std::sin(kTwoPi * u2) * std + mean;
+        }
+      });
+}
+
+template <typename T>
+void GaussianKernel(const phi::Context &dev_ctx,
+                    const phi::IntArray &shape,
+                    float mean,
+                    float std,
+                    int seed,
+                    phi::DataType dtype,
+                    phi::DenseTensor *out) {
+  auto shape_data = shape.GetData();
+  out->Resize(std::vector<int64_t>(shape_data.begin(), shape_data.end()));
+  T *data = dev_ctx.template Alloc<T>(out);
+  auto size = out->numel();
+
+  uint64_t philox_seed, offset;
+  funcs::GetPhiloxSeedOffset(
+      static_cast<uint32_t>(seed), size, &philox_seed, &offset);
+  PhiloxGaussianFill<T>(
+      funcs::Philox4x32(philox_seed, offset), data, size, mean, std);
+}
+
+static inline double NormalCdf(double x) {
+  return 0.5 * std::erfc(-x * M_SQRT1_2);
+}
+
+// Inverse error function on (-1, 1) (M. Giles, "Approximating the erfinv
+// function", GPU Computing Gems, 2011), refined with one Newton step.
+static inline double ErfInv(double x) {
+  double w = -std::log((1.0 - x) * (1.0 + x));
+  double p;
+  if (w < 5.0) {
+    w = w - 2.5;
+    p = 2.81022636e-08;
+    p = 3.43273939e-07 + p * w;
+    p = -3.5233877e-06 + p * w;
+    p = -4.39150654e-06 + p * w;
+    p = 0.00021858087 + p * w;
+    p = -0.00125372503 + p * w;
+    p = -0.00417768164 + p * w;
+    p = 0.246640727 + p * w;
+    p = 1.50140941 + p * w;
+  } else {
+    w = std::sqrt(w) - 3.0;
+    p = -0.000200214257;
+    p = 0.000100950558 + p * w;
+    p = 0.00134934322 + p * w;
+    p = -0.00367342844 + p * w;
+    p = 0.00573950773 + p * w;
+    p = -0.0076224613 + p * w;
+    p = 0.00943887047 + p * w;
+    p = 1.00167406 + p * w;
+    p = 2.83297682 + p * w;
+  }
+  double y = p * x;
+  // d/dy erf(y) = 2 / sqrt(pi) * exp(-y^2)
+  y -= (std::erf(y) - x) / (M_2_SQRTPI * std::exp(-y * y));
+  return y;
+}
+
+// Samples N(mean, std) restricted to [a, b]. Element i owns Philox counter
+// i and uses the sub-stream as the attempt number, so its value does not
+// depend on how many attempts other elements needed. Wide windows use
+// Box-Muller rejection; narrow or far-tail windows, and the rare element
+// that exhausts its attempts, use the inverse CDF.
+template <typename T>
+void TruncatedGaussianRandomKernel(const phi::Context &dev_ctx,
+                                   const std::vector<int> &shape,
+                                   float mean,
+                                   float std,
+                                   int seed,
+                                   float a,
+                                   float b,
+                                   phi::DataType dtype,
+                                   phi::DenseTensor *out) {
+  out->Resize(std::vector<int64_t>(shape.begin(), shape.end()));
+  T *data = dev_ctx.template Alloc<T>(out);
+  auto size = out->numel();
+  PD_CHECK(std > 0.0f,
+           "The std of truncated_gaussian_random must be positive, but "
+           "received %f.",
+           std);
+  PD_CHECK(a < b,
+           "The truncation bounds of truncated_gaussian_random must satisfy "
+           "a < b, but received a = %f, b = %f.",
+           a,
+           b);
+
+  const double alpha = (static_cast<double>(a) - mean) / std;
+  const double beta = (static_cast<double>(b) - mean) / std;
+  const double cdf_alpha = NormalCdf(alpha);
+  const double cdf_beta = NormalCdf(beta);
+  const double acceptance = cdf_beta - cdf_alpha;
+  const bool rejection = acceptance >= kTruncatedMinAcceptance;
+
+  uint64_t philox_seed, offset;
+  funcs::GetPhiloxSeedOffset(
+      static_cast<uint32_t>(seed), size, &philox_seed, &offset);
+  funcs::Philox4x32 philox(philox_seed, offset);
+
+  auto inverse_cdf = [&](uint32_t bits) {
+    const double u = (static_cast<double>(bits) + 0.5) * (1.0 / 4294967296.0);
+    const double p = cdf_alpha + u * acceptance;
+    const double z = M_SQRT2 * ErfInv(2.0 * p - 1.0);
+    return std::min(std::max(z, alpha), beta);
+  };
+
+  funcs::ParallelFor(
+      0, size, funcs::kParallelGrainSize / 16, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          double z = 0.0;
+          bool found = false;
+          uint32_t fallback_bits = philox(i).v[0];
+          for (uint32_t attempt = 0; rejection && !found &&
+                                     attempt < kTruncatedMaxAttempts;
+               ++attempt) {
+            const funcs::PhiloxBlock r = philox(i, attempt);
+            float candidates[funcs::kPhiloxLanes];
+            funcs::BoxMuller(1.0f - funcs::Uint32ToUnitFloat(r.v[0]),
+                             funcs::Uint32ToUnitFloat(r.v[1]),
+                             &candidates[0],
+                             &candidates[1]);
+            funcs::BoxMuller(1.0f - funcs::Uint32ToUnitFloat(r.v[2]),
+                             funcs::Uint32ToUnitFloat(r.v[3]),
+                             &candidates[2],
+                             &candidates[3]);
+            for (int l = 0; l < funcs::kPhiloxLanes; ++l) {
+              if (candidates[l] >= alpha && candidates[l] <= beta) {
+                z = candidates[l];
+                found = true;
+                break;
+              }
+            }
+            fallback_bits = r.v[0];
+          }
+          if (!found) {
+            z = inverse_cdf(fallback_bits);
+          }
+          data[i] = static_cast<T>(z * std + mean);
+        }
+      });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(gaussian,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::GaussianKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(truncated_gaussian_random,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::TruncatedGaussianRandomKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,160 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/interpolate.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+struct GridSampleShape {
+  int64_t batch = 0;
+  int64_t channels = 0;
+  int64_t in_h = 0;
+  int64_t in_w = 0;
+  int64_t points = 0;
+  bool nearest = false;
+  funcs::GridPadding padding = funcs::GridPadding::kZeros;
+};
+
+GridSampleShape GetGridSampleShape(const phi::DenseTensor& x,
+                                   const phi::DenseTensor& grid,
+                                   const std::string& mode,
+                                   const std::string& padding_mode) {
+  const auto x_dims = x.dims();
+  const auto grid_dims = grid.dims();
+  PD_CHECK(x_dims.size() == 4,
+           "grid_sample on custom_cpu takes a 4-D input, but received a "
+           "%d-D tensor.",
+           static_cast<int>(x_dims.size()));
+  PD_CHECK(grid_dims.size() == 4 && grid_dims[0] == x_dims[0] &&
+               grid_dims[3] == 2,
+           "The grid of grid_sample must be [N, H, W, 2].");
+  PD_CHECK(mode == "bilinear" || mode == "nearest",
+           "The mode of grid_sample must be bilinear or nearest, but "
+           "received %s.",
+           mode);
+  GridSampleShape shape;
+  shape.batch = x_dims[0];
+  shape.channels = x_dims[1];
+  shape.in_h = x_dims[2];
+  shape.in_w = x_dims[3];
+  shape.points = grid_dims[1] * grid_dims[2];
+  shape.nearest = mode == "nearest";
+  if (padding_mode == "border") {
+    shape.padding = funcs::GridPadding::kBorder;
+  } else if (padding_mode == "reflection") {
+    shape.padding = funcs::GridPadding::kReflection;
+  } else {
+    PD_CHECK(padding_mode == "zeros",
+             "The padding_mode of grid_sample must be zeros, border or "
+             "reflection, but received %s.",
+             padding_mode);
+  }
+  return shape;
+}
+
+}  // namespace
+
+template <typename T>
+void GridSampleKernel(const phi::Context& dev_ctx,
+                      const phi::DenseTensor& x,
+                      const phi::DenseTensor& grid,
+                      const std::string& mode,
+                      const std::string& padding_mode,
+                      bool align_corners,
+                      phi::DenseTensor* out) {
+  using MT = funcs::InterpMT<T>;
+  const auto s = GetGridSampleShape(x, grid, mode, padding_mode);
+  const auto grid_dims = grid.dims();
+  out->Resize({s.batch, s.channels, grid_dims[1], grid_dims[2]});
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  const auto taps = funcs::MakeGridSampleTaps<T, MT>(grid.data<T>(),
+                                                     s.batch * s.points,
+                                                     s.in_h,
+                                                     s.in_w,
+                                                     s.nearest,
+                                                     s.padding,
+                                                     align_corners);
+  funcs::GridSampleForward<T, MT>(taps,
+                                  s.batch,
+                                  s.channels,
+                                  s.in_h * s.in_w,
+                                  s.points,
+                                  s.nearest ? 1 : 4,
+                                  x.data<T>(),
+                                  out_data);
+}
+
+template <typename T>
+void GridSampleGradKernel(const phi::Context& dev_ctx,
+                          const phi::DenseTensor& x,
+                          const phi::DenseTensor& grid,
+                          const phi::DenseTensor& out_grad,
+                          const std::string& mode,
+                          const std::string& padding_mode,
+                          bool align_corners,
+                          phi::DenseTensor* x_grad,
+                          phi::DenseTensor* grid_grad) {
+  using MT = funcs::InterpMT<T>;
+  const auto s = GetGridSampleShape(x, grid, mode, padding_mode);
+  T* dx = nullptr;
+  if (x_grad != nullptr) {
+    x_grad->Resize(x.dims());
+    dx = dev_ctx.template Alloc<T>(x_grad);
+  }
+  T* dgrid = nullptr;
+  if (grid_grad != nullptr) {
+    grid_grad->Resize(grid.dims());
+    dgrid = dev_ctx.template Alloc<T>(grid_grad);
+  }
+  const auto taps = funcs::MakeGridSampleTaps<T, MT>(grid.data<T>(),
+                                                     s.batch * s.points,
+                                                     s.in_h,
+                                                     s.in_w,
+                                                     s.nearest,
+                                                     s.padding,
+                                                     align_corners);
+  funcs::GridSampleBackward<T, MT>(taps,
+                                   s.batch,
+                                   s.channels,
+                                   s.in_h * s.in_w,
+                                   s.points,
+                                   s.nearest ? 1 : 4,
+                                   x.data<T>(),
+                                   out_grad.data<T>(),
+                                   dx,
+                                   dgrid);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(grid_sample,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::GridSampleKernel,
+                    float,
+                    double) {}
+
+PD_BUILD_PHI_KERNEL(grid_sample_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::GridSampleGradKernel,
+                    float,
+                    double) {}
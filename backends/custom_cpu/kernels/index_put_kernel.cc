@@ -0,0 +1,281 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <numeric>
+
+#include "kernels/funcs/index_engine.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// One coordinate per indexed dim of x, already broadcast to a common shape.
+struct IndexPutCoords {
+  std::vector<std::vector<int64_t>> coords;
+  int64_t count = 0;
+};
+
+static inline std::vector<int64_t> ReadRawIndex(const phi::DenseTensor& t) {
+  const int64_t n = t.numel();
+  std::vector<int64_t> out(n);
+  if (t.dtype() == phi::DataType::INT64) {
+    auto data = t.data<int64_t>();
+    std::copy(data, data + n, out.begin());
+  } else {
+    auto data = t.data<int32_t>();
+    std::copy(data, data + n, out.begin());
+  }
+  return out;
+}
+
+// Bool masks are expanded to one int64 coordinate list per masked dim, in
+// row-major order, and the integer indices are broadcast against each other.
+static inline IndexPutCoords GetIndexPutCoords(
+    const std::vector<const phi::DenseTensor*>& indices) {
+  std::vector<std::vector<int64_t>> raw;
+  std::vector<std::vector<int64_t>> raw_dims;
+  for (auto t : indices) {
+    auto dims = t->dims();
+    if (t->dtype() == phi::DataType::BOOL) {
+      auto mask = t->data<bool>();
+      const int64_t rank = dims.size();
+      std::vector<std::vector<int64_t>> cols(rank);
+      for (int64_t i = 0; i < t->numel(); ++i) {
+        if (!mask[i]) {
+          continue;
+        }
+        int64_t rest = i;
+        for (int64_t d = rank - 1; d >= 0; --d) {
+          cols[d].push_back(rest % dims[d]);
+          rest /= dims[d];
+        }
+      }
+      for (auto& c : cols) {
+        raw_dims.push_back({static_cast<int64_t>(c.size())});
+        raw.push_back(std::move(c));
+      }
+    } else {
+      PD_CHECK(t->dtype() == phi::DataType::INT64 ||
+                   t->dtype() == phi::DataType::INT32,
+               "The indices of index_put must be bool, int32 or int64, but "
+               "received %s.",
+               phi::to_string(t->dtype()));
+      raw.push_back(ReadRawIndex(*t));
+      raw_dims.push_back(dims);
+    }
+  }
+
+  std::vector<int64_t> shape;
+  for (auto& dims : raw_dims) {
+    shape = phi::BroadcastDims(-1, shape, dims);
+  }
+  IndexPutCoords result;
+  result.count = std::accumulate(shape.cbegin(),
+                                 shape.cend(),
+                                 static_cast<int64_t>(1),
+                                 std::multiplies<int64_t>());
+  const int64_t rank = shape.size();
+  for (size_t i = 0; i < raw.size(); ++i) {
+    if (static_cast<int64_t>(raw[i].size()) == result.count) {
+      result.coords.push_back(std::move(raw[i]));
+      continue;
+    }
+    // Broadcast a lower rank or size-1 index up to `shape`.
+    const auto& dims = raw_dims[i];
+    const int64_t pad = rank - dims.size();
+    std::vector<int64_t> out(result.count);
+    for (int64_t p = 0; p < result.count; ++p) {
+      int64_t rest = p;
+      int64_t src = 0;
+      int64_t stride = 1;
+      for (int64_t d = rank - 1; d >= pad; --d) {
+        const int64_t coord = rest % shape[d];
+        rest /= shape[d];
+        const int64_t extent = dims[d - pad];
+        src += (extent == 1 ? 0 : coord) * stride;
+        stride *= extent;
+      }
+      out[p] = raw[i][src];
+    }
+    result.coords.push_back(std::move(out));
+  }
+  return result;
+}
+
+// Flat row of every index tuple over the first `coords.size()` dims of x.
+static inline std::vector<int64_t> IndexPutRows(
+    const IndexPutCoords& c,
+    const std::vector<int64_t>& x_dims,
+    const std::string& op_name) {
+  const int64_t depth = c.coords.size();
+  PD_CHECK(depth <= static_cast<int64_t>(x_dims.size()),
+           "Too many indices for %s: x has %ld dims but %ld were indexed.",
+           op_name,
+           static_cast<int64_t>(x_dims.size()),
+           depth);
+  std::vector<int64_t> rows(c.count, 0);
+  for (int64_t d = 0; d < depth; ++d) {
+    for (int64_t p = 0; p < c.count; ++p) {
+      int64_t v = c.coords[d][p];
+      if (v < 0) {
+        v += x_dims[d];
+      }
+      PD_CHECK(v >= 0 && v < x_dims[d],
+               "The index of %s is out of range in dimension %ld, expected "
+               "in [%ld, %ld), but received %ld.",
+               op_name,
+               d,
+               -x_dims[d],
+               x_dims[d],
+               c.coords[d][p]);
+      rows[p] = rows[p] * x_dims[d] + v;
+    }
+  }
+  return rows;
+}
+
+template <typename T>
+void IndexPutKernel(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& x,
+                    const std::vector<const phi::DenseTensor*>& indices,
+                    const phi::DenseTensor& value,
+                    bool accumulate,
+                    phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  out->Resize(x_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  funcs::ParallelMemcpy(out_data, x.data<T>(), x.numel() * sizeof(T));
+
+  auto c = GetIndexPutCoords(indices);
+  if (c.count == 0 || x.numel() == 0) {
+    return;
+  }
+  auto rows = IndexPutRows(c, x_dims, "index_put");
+  const int64_t depth = c.coords.size();
+  const int64_t slice = std::accumulate(x_dims.cbegin() + depth,
+                                        x_dims.cend(),
+                                        static_cast<int64_t>(1),
+                                        std::multiplies<int64_t>());
+  const int64_t num_rows = x.numel() / slice;
+  const int64_t total = c.count * slice;
+
+  // The engine scatters whole [count, slice] blocks; a broadcast value is
+  // expanded to that block first.
+  const T* src = value.data<T>();
+  std::vector<T> expanded;
+  if (value.numel() != total) {
+    PD_CHECK(value.numel() == slice || value.numel() == 1,
+             "The value of index_put must be broadcastable to %ld elements, "
+             "but received %ld.",
+             total,
+             value.numel());
+    expanded.resize(total);
+    const int64_t period = value.numel();
+    funcs::ParallelFor(
+        0, total, funcs::kParallelGrainSize, [&](int64_t b, int64_t e) {
+          for (int64_t i = b; i < e; ++i) {
+            expanded[i] = src[i % period];
+          }
+        });
+    src = expanded.data();
+  }
+
+  funcs::ScatterSlices(
+      src,
+      1,
+      num_rows,
+      slice,
+      rows,
+      accumulate ? funcs::ScatterMode::kAdd : funcs::ScatterMode::kAssign,
+      out_data);
+}
+
+template <typename T>
+void IndexPutGradKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        const std::vector<const phi::DenseTensor*>& indices,
+                        const phi::DenseTensor& value,
+                        const phi::DenseTensor& out_grad,
+                        bool accumulate,
+                        phi::DenseTensor* x_grad,
+                        phi::DenseTensor* value_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  auto x_dims = x.dims();
+  auto c = GetIndexPutCoords(indices);
+  auto rows = IndexPutRows(c, x_dims, "index_put_grad");
+  const int64_t depth = c.coords.size();
+  const int64_t slice = std::accumulate(x_dims.cbegin() + depth,
+                                        x_dims.cend(),
+                                        static_cast<int64_t>(1),
+                                        std::multiplies<int64_t>());
+  const int64_t num_rows = slice == 0 ? 0 : x.numel() / slice;
+
+  if (x_grad) {
+    x_grad->Resize(x_dims);
+    auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+    funcs::ParallelMemcpy(
+        x_grad_data, out_grad.data<T>(), out_grad.numel() * sizeof(T));
+    if (!accumulate) {
+      funcs::ZeroSlices(1, num_rows, slice, rows, x_grad_data);
+    }
+  }
+  if (!value_grad) {
+    return;
+  }
+
+  value_grad->Resize(value.dims());
+  auto value_grad_data = dev_ctx.template Alloc<T>(value_grad);
+  const int64_t total = c.count * slice;
+  if (value.numel() == total) {
+    funcs::GatherSlices(
+        out_grad.data<T>(), 1, num_rows, slice, rows, value_grad_data);
+    return;
+  }
+
+  // Broadcast value: reduce the gathered rows back onto its period.
+  std::vector<T> gathered(total);
+  funcs::GatherSlices(
+      out_grad.data<T>(), 1, num_rows, slice, rows, gathered.data());
+  const int64_t period = value.numel();
+  std::vector<MT> acc(period, static_cast<MT>(0));
+  for (int64_t i = 0; i < total; ++i) {
+    acc[i % period] += static_cast<MT>(gathered[i]);
+  }
+  for (int64_t i = 0; i < period; ++i) {
+    value_grad_data[i] = static_cast<T>(acc[i]);
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(index_put,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::IndexPutKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(index_put_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::IndexPutGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,205 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <numeric>
+
+#include "kernels/funcs/index_engine.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Rows of index_sample handled per parallel block.
+constexpr int64_t kIndexSampleRowGrain = 64;
+
+template <typename T>
+void IndexSelectKernel(const phi::Context& dev_ctx,
+                       const phi::DenseTensor& x,
+                       const phi::DenseTensor& index,
+                       int dim,
+                       phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  const int64_t rank = x_dims.size();
+  if (dim < 0) {
+    dim += rank;
+  }
+  const int64_t rows = x_dims[dim];
+  auto idx = funcs::ReadIndex(index, rows, "index_select");
+
+  auto out_dims = x_dims;
+  out_dims[dim] = idx.size();
+  out->Resize(out_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  const int64_t outer = std::accumulate(x_dims.cbegin(),
+                                        x_dims.cbegin() + dim,
+                                        static_cast<int64_t>(1),
+                                        std::multiplies<int64_t>());
+  const int64_t slice = std::accumulate(x_dims.cbegin() + dim + 1,
+                                        x_dims.cend(),
+                                        static_cast<int64_t>(1),
+                                        std::multiplies<int64_t>());
+  funcs::GatherSlices(x.data<T>(), outer, rows, slice, idx, out_data);
+}
+
+template <typename T>
+void IndexSelectGradKernel(const phi::Context& dev_ctx,
+                           const phi::DenseTensor& x,
+                           const phi::DenseTensor& index,
+                           const phi::DenseTensor& out_grad,
+                           int dim,
+                           phi::DenseTensor* x_grad) {
+  auto x_dims = x.dims();
+  const int64_t rank = x_dims.size();
+  if (dim < 0) {
+    dim += rank;
+  }
+  const int64_t rows = x_dims[dim];
+  auto idx = funcs::ReadIndex(index, rows, "index_select_grad");
+
+  x_grad->Resize(x_dims);
+  auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+  funcs::ParallelMemset(x_grad_data, 0, x_grad->numel() * sizeof(T));
+
+  const int64_t outer = std::accumulate(x_dims.cbegin(),
+                                        x_dims.cbegin() + dim,
+                                        static_cast<int64_t>(1),
+                                        std::multiplies<int64_t>());
+  const int64_t slice = std::accumulate(x_dims.cbegin() + dim + 1,
+                                        x_dims.cend(),
+                                        static_cast<int64_t>(1),
+                                        std::multiplies<int64_t>());
+  funcs::ScatterSlices(out_grad.data<T>(),
+                       outer,
+                       rows,
+                       slice,
+                       idx,
+                       funcs::ScatterMode::kAddToZero,
+                       x_grad_data);
+}
+
+template <typename T>
+void IndexSampleKernel(const phi::Context& dev_ctx,
+                       const phi::DenseTensor& x,
+                       const phi::DenseTensor& index,
+                       phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  auto index_dims = index.dims();
+  const int64_t batch = x_dims[0];
+  const int64_t width = x_dims[1];
+  const int64_t k = index_dims[1];
+
+  out->Resize(index_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  auto idx = funcs::ReadIndex(index, width, "index_sample");
+  auto x_data = x.data<T>();
+  funcs::ParallelFor(
+      0, batch, kIndexSampleRowGrain, [&](int64_t begin, int64_t end) {
+        for (int64_t b = begin; b < end; ++b) {
+          const T* src = x_data + b * width;
+          const int64_t* row_idx = idx.data() + b * k;
+          T* dst = out_data + b * k;
+          for (int64_t j = 0; j < k; ++j) {
+            dst[j] = src[row_idx[j]];
+          }
+        }
+      });
+}
+
+// Every row of x_grad only receives the gradients of the same row of
+// out_grad, so rows are independent and accumulated in index order.
+template <typename T>
+void IndexSampleGradKernel(const phi::Context& dev_ctx,
+                           const phi::DenseTensor& x,
+                           const phi::DenseTensor& index,
+                           const phi::DenseTensor& out_grad,
+                           phi::DenseTensor* x_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  auto x_dims = x.dims();
+  const int64_t batch = x_dims[0];
+  const int64_t width = x_dims[1];
+  const int64_t k = index.dims()[1];
+
+  x_grad->Resize(x_dims);
+  auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+  auto idx = funcs::ReadIndex(index, width, "index_sample_grad");
+  auto out_grad_data = out_grad.data<T>();
+  funcs::ParallelFor(
+      0, batch, kIndexSampleRowGrain, [&](int64_t begin, int64_t end) {
+        std::vector<MT> acc(width);
+        for (int64_t b = begin; b < end; ++b) {
+          std::fill(acc.begin(), acc.end(), static_cast<MT>(0));
+          const int64_t* row_idx = idx.data() + b * k;
+          const T* src = out_grad_data + b * k;
+          for (int64_t j = 0; j < k; ++j) {
+            acc[row_idx[j]] += static_cast<MT>(src[j]);
+          }
+          T* dst = x_grad_data + b * width;
+          for (int64_t j = 0; j < width; ++j) {
+            dst[j] = static_cast<T>(acc[j]);
+          }
+        }
+      });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(index_select,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::IndexSelectKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(index_select_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::IndexSelectGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(index_sample,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::IndexSampleKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(index_sample_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::IndexSampleGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,321 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/interpolate.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+int64_t ReadSize(const phi::DenseTensor& t, int64_t i) {
+  return t.dtype() == phi::DataType::INT64 ? t.data<int64_t>()[i]
+                                           : t.data<int>()[i];
+}
+
+// Sizes and ratios of a 3-D (NCW / NWC) or 4-D (NCHW / NHWC) resize. The
+// output size comes from SizeTensor, else OutSize, else the scales; a
+// given scale sets the ratio even when OutSize overrides the size.
+struct InterpParams {
+  funcs::InterpShape shape;
+  float ratio_h = 0.0f;
+  float ratio_w = 0.0f;
+};
+
+InterpParams GetInterpParams(
+    const phi::DenseTensor& x,
+    const paddle::optional<phi::DenseTensor>& out_size,
+    const paddle::optional<std::vector<const phi::DenseTensor*>>& size_tensor,
+    const paddle::optional<phi::DenseTensor>& scale_tensor,
+    const std::string& data_layout,
+    int out_h,
+    int out_w,
+    const std::vector<float>& scale,
+    bool align_corners) {
+  const auto dims = x.dims();
+  const int rank = static_cast<int>(dims.size());
+  PD_CHECK(rank == 3 || rank == 4,
+           "interpolate on custom_cpu takes 3-D or 4-D inputs, but received "
+           "a %d-D tensor.",
+           rank);
+  const bool channels_last = data_layout == "NHWC" || data_layout == "NWC";
+  const int spatial = rank - 2;
+  const int64_t n = dims[0];
+  const int64_t c = channels_last ? dims[rank - 1] : dims[1];
+  const int64_t in_h = spatial == 2 ? dims[channels_last ? 1 : 2] : 1;
+  const int64_t in_w = dims[channels_last ? rank - 2 : rank - 1];
+
+  float scale_h = -1.0f, scale_w = -1.0f;
+  int64_t oh = spatial == 2 ? out_h : 1;
+  int64_t ow = out_w;
+  if (size_tensor && !size_tensor->empty()) {
+    const auto& sizes = *size_tensor;
+    PD_CHECK(static_cast<int>(sizes.size()) == spatial,
+             "SizeTensor of interpolate must hold %d sizes.",
+             spatial);
+    if (spatial == 2) {
+      oh = ReadSize(*sizes[0], 0);
+    }
+    ow = ReadSize(*sizes[spatial - 1], 0);
+  } else {
+    std::vector<float> scales;
+    if (scale_tensor) {
+      const auto& t = *scale_tensor;
+      const float* data = t.data<float>();
+      scales.assign(data, data + t.numel());
+    } else {
+      scales = scale;
+    }
+    if (!scales.empty()) {
+      scale_w = scales.size() > 1 && spatial == 2 ? scales[1] : scales[0];
+      scale_h = spatial == 2 ? scales[0] : 1.0f;
+      PD_CHECK(scale_h > 0.0f && scale_w > 0.0f,
+               "The scale of interpolate must be positive.");
+      if (spatial == 2) {
+        oh = static_cast<int64_t>(in_h * scale_h);
+      }
+      ow = static_cast<int64_t>(in_w * scale_w);
+    }
+    if (out_size) {
+      PD_CHECK(out_size->numel() == spatial,
+               "OutSize of interpolate must hold %d sizes.",
+               spatial);
+      if (spatial == 2) {
+        oh = ReadSize(*out_size, 0);
+      }
+      ow = ReadSize(*out_size, spatial - 1);
+    }
+  }
+  PD_CHECK(oh > 0 && ow > 0,
+           "The output size of interpolate must be positive, but received "
+           "[%ld, %ld].",
+           oh,
+           ow);
+
+  InterpParams params;
+  auto& shape = params.shape;
+  shape.planes = channels_last ? n : n * c;
+  shape.vec = channels_last ? c : 1;
+  shape.in_h = in_h;
+  shape.in_w = in_w;
+  shape.out_h = oh;
+  shape.out_w = ow;
+  params.ratio_h = funcs::InterpRatio(in_h, oh, scale_h, align_corners);
+  params.ratio_w = funcs::InterpRatio(in_w, ow, scale_w, align_corners);
+  return params;
+}
+
+std::vector<int64_t> InterpOutDims(const phi::DenseTensor& x,
+                                   const std::string& data_layout,
+                                   const funcs::InterpShape& shape) {
+  auto dims = x.dims();
+  const int rank = static_cast<int>(dims.size());
+  const bool channels_last = data_layout == "NHWC" || data_layout == "NWC";
+  const int w_axis = channels_last ? rank - 2 : rank - 1;
+  dims[w_axis] = shape.out_w;
+  if (rank == 4) {
+    dims[w_axis - 1] = shape.out_h;
+  }
+  return dims;
+}
+
+funcs::InterpMethod GetInterpMethod(const std::string& interp_method) {
+  if (interp_method == "nearest") {
+    return funcs::InterpMethod::kNearest;
+  }
+  if (interp_method == "bilinear" || interp_method == "linear") {
+    return funcs::InterpMethod::kLinear;
+  }
+  PD_CHECK(interp_method == "bicubic",
+           "interpolate on custom_cpu supports nearest, linear, bilinear and "
+           "bicubic, but received %s.",
+           interp_method);
+  return funcs::InterpMethod::kCubic;
+}
+
+// Tables of both axes; a 3-D input reads its single row as is.
+template <typename MT>
+void MakeInterpAxes(const InterpParams& params,
+                    const std::string& interp_method,
+                    bool align_corners,
+                    int align_mode,
+                    funcs::InterpAxis<MT>* ay,
+                    funcs::InterpAxis<MT>* ax) {
+  const auto method = GetInterpMethod(interp_method);
+  const auto& s = params.shape;
+  *ay = funcs::MakeInterpAxis<MT>(
+      s.in_h == 1 && s.out_h == 1 ? funcs::InterpMethod::kNearest : method,
+      s.in_h,
+      s.out_h,
+      params.ratio_h,
+      align_corners,
+      align_mode);
+  *ax = funcs::MakeInterpAxis<MT>(
+      method, s.in_w, s.out_w, params.ratio_w, align_corners, align_mode);
+}
+
+}  // namespace
+
+template <typename T>
+void InterpolateKernel(
+    const phi::Context& dev_ctx,
+    const phi::DenseTensor& x,
+    const paddle::optional<phi::DenseTensor>& out_size,
+    const paddle::optional<std::vector<const phi::DenseTensor*>>& size_tensor,
+    const paddle::optional<phi::DenseTensor>& scale_tensor,
+    const std::string& data_layout,
+    int out_d,
+    int out_h,
+    int out_w,
+    const std::vector<float>& scale,
+    const std::string& interp_method,
+    bool align_corners,
+    int align_mode,
+    phi::DenseTensor* out) {
+  using MT = funcs::InterpMT<T>;
+  const auto params = GetInterpParams(x,
+                                      out_size,
+                                      size_tensor,
+                                      scale_tensor,
+                                      data_layout,
+                                      out_h,
+                                      out_w,
+                                      scale,
+                                      align_corners);
+  out->Resize(InterpOutDims(x, data_layout, params.shape));
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  funcs::InterpAxis<MT> ay, ax;
+  MakeInterpAxes(params, interp_method, align_corners, align_mode, &ay, &ax);
+  funcs::InterpForward<T, MT>(params.shape, ay, ax, x.data<T>(), out_data);
+}
+
+template <typename T>
+void InterpolateGradKernel(
+    const phi::Context& dev_ctx,
+    const phi::DenseTensor& x,
+    const paddle::optional<phi::DenseTensor>& out_size,
+    const paddle::optional<std::vector<const phi::DenseTensor*>>& size_tensor,
+    const paddle::optional<phi::DenseTensor>& scale_tensor,
+    const phi::DenseTensor& out_grad,
+    const std::string& data_layout,
+    int out_d,
+    int out_h,
+    int out_w,
+    const std::vector<float>& scale,
+    const std::string& interp_method,
+    bool align_corners,
+    int align_mode,
+    phi::DenseTensor* x_grad) {
+  using MT = funcs::InterpMT<T>;
+  const auto params = GetInterpParams(x,
+                                      out_size,
+                                      size_tensor,
+                                      scale_tensor,
+                                      data_layout,
+                                      out_h,
+                                      out_w,
+                                      scale,
+                                      align_corners);
+  PD_CHECK(out_grad.dims() == InterpOutDims(x, data_layout, params.shape),
+           "The out_grad of interpolate does not match its output size.");
+  x_grad->Resize(x.dims());
+  T* dx = dev_ctx.template Alloc<T>(x_grad);
+  funcs::InterpAxis<MT> ay, ax;
+  MakeInterpAxes(params, interp_method, align_corners, align_mode, &ay, &ax);
+  funcs::InterpBackward<T, MT>(params.shape, ay, ax, out_grad.data<T>(), dx);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(nearest_interp,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16,
+                    int,
+                    int64_t,
+                    uint8_t) {}
+
+PD_BUILD_PHI_KERNEL(linear_interp,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16,
+                    uint8_t) {}
+
+PD_BUILD_PHI_KERNEL(bilinear_interp,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16,
+                    uint8_t) {}
+
+PD_BUILD_PHI_KERNEL(bicubic_interp,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16,
+                    uint8_t) {}
+
+PD_BUILD_PHI_KERNEL(nearest_interp_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(linear_interp_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(bilinear_interp_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(bicubic_interp_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::InterpolateGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,70 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/compare.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// The mask is packed to bits once; the popcount of each block gives where
+// its selected elements land, so the gather runs in parallel and in order.
+// A broadcast x or mask is read in place through broadcast strides.
+template <typename T>
+void MaskedSelectKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        const phi::DenseTensor& mask,
+                        phi::DenseTensor* out) {
+  const T* x_data = x.data<T>();
+  funcs::PackedMask bits;
+  if (x.dims() == mask.dims()) {
+    funcs::PackBoolMask(mask.data<bool>(), mask.numel(), &bits);
+    const auto scan = funcs::ScanMask(bits);
+    out->Resize({scan.count()});
+    T* out_data = dev_ctx.template Alloc<T>(out);
+    funcs::ForEachSetBit(bits, scan, [&](int64_t index, int64_t position) {
+      out_data[position] = x_data[index];
+    });
+    return;
+  }
+
+  const auto dims = phi::BroadcastDims(-1, x.dims(), mask.dims());
+  const int64_t rank = dims.size();
+  const auto shape = funcs::GetBroadcastShape(
+      dims,
+      funcs::AlignBroadcastDims(x.dims(), rank, -1),
+      funcs::AlignBroadcastDims(mask.dims(), rank, -1));
+  funcs::PackBroadcastMask(mask.data<bool>(), shape, &bits);
+  const auto scan = funcs::ScanMask(bits);
+  out->Resize({scan.count()});
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  funcs::ForEachSetBit(bits, scan, [&](int64_t index, int64_t position) {
+    out_data[position] =
+        x_data[funcs::BroadcastOffset(shape, shape.x_strides, index)];
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(masked_select,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::MaskedSelectKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
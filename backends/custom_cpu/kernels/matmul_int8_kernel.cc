@@ -0,0 +1,198 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <vector>
+
+#include "kernels/funcs/int8_gemm.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Copies a row major [rows, cols] int8 matrix, or its transpose when
+// `trans` is set, into `dst` as [rows, cols].
+static inline void PackInt8(const int8_t* src,
+                            int64_t rows,
+                            int64_t cols,
+                            bool trans,
+                            int8_t* dst) {
+  if (!trans) {
+    std::memcpy(dst, src, rows * cols);
+    return;
+  }
+  for (int64_t r = 0; r < rows; ++r) {
+    for (int64_t c = 0; c < cols; ++c) {
+      dst[r * cols + c] = src[c * rows + r];
+    }
+  }
+}
+
+// int8 x int8 -> int32 matmul. y is either 2-D or has the same batch dims
+// as x.
+template <typename T>
+void MatmulInt8Kernel(const phi::Context& dev_ctx,
+                      const phi::DenseTensor& x,
+                      const phi::DenseTensor& y,
+                      bool transpose_x,
+                      bool transpose_y,
+                      phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  auto y_dims = y.dims();
+  PD_CHECK(x_dims.size() >= 2 && y_dims.size() >= 2,
+           "The inputs of matmul_int8 must be at least 2-D, but received "
+           "%ld-D and %ld-D.",
+           static_cast<int64_t>(x_dims.size()),
+           static_cast<int64_t>(y_dims.size()));
+  const int64_t x_rank = x_dims.size();
+  const int64_t y_rank = y_dims.size();
+  const int64_t m = transpose_x ? x_dims[x_rank - 1] : x_dims[x_rank - 2];
+  const int64_t k = transpose_x ? x_dims[x_rank - 2] : x_dims[x_rank - 1];
+  const int64_t y_k = transpose_y ? y_dims[y_rank - 1] : y_dims[y_rank - 2];
+  const int64_t n = transpose_y ? y_dims[y_rank - 2] : y_dims[y_rank - 1];
+  PD_CHECK(k == y_k,
+           "The reduced dims of matmul_int8 must match, but received %ld "
+           "and %ld.",
+           k,
+           y_k);
+  const int64_t batch = x.numel() / std::max<int64_t>(m * k, 1);
+  const int64_t y_batch = y.numel() / std::max<int64_t>(k * n, 1);
+  PD_CHECK(y_batch == 1 || y_batch == batch,
+           "The batch of y in matmul_int8 must be 1 or %ld, but received "
+           "%ld.",
+           batch,
+           y_batch);
+
+  auto out_dims = x_dims;
+  out_dims[x_rank - 2] = m;
+  out_dims[x_rank - 1] = n;
+  out->Resize(out_dims);
+  auto out_data = dev_ctx.template Alloc<int32_t>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  // Both operands are brought to row major [m, k] and [n, k] so the micro
+  // kernel only ever walks contiguous k.
+  std::vector<int8_t> a(m * k);
+  std::vector<int8_t> b(n * k);
+  auto x_data = x.data<int8_t>();
+  auto y_data = y.data<int8_t>();
+  for (int64_t bs = 0; bs < batch; ++bs) {
+    PackInt8(x_data + bs * m * k, m, k, transpose_x, a.data());
+    if (bs == 0 || y_batch > 1) {
+      PackInt8(y_data + (y_batch > 1 ? bs : 0) * k * n,
+               n,
+               k,
+               !transpose_y,
+               b.data());
+    }
+    funcs::Int8Gemm(m, n, k, a.data(), b.data(), out_data + bs * m * n);
+  }
+}
+
+// LLM.int8() linear: x is quantized per row on the fly and multiplied with
+// the int8 [n, k] weight in int32; the columns of x holding an outlier
+// (|x| >= threshold) are kept in floating point and multiplied with the
+// dequantized weight instead.
+template <typename T>
+void LLMInt8LinearKernel(const phi::Context& dev_ctx,
+                         const phi::DenseTensor& x,
+                         const phi::DenseTensor& weight,
+                         const paddle::optional<phi::DenseTensor>& bias,
+                         const phi::DenseTensor& weight_scale,
+                         float threshold,
+                         phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  const int64_t k = x_dims.back();
+  const int64_t n = weight.dims()[0];
+  const int64_t m = k == 0 ? 0 : x.numel() / k;
+
+  auto out_dims = x_dims;
+  out_dims.back() = n;
+  out->Resize(out_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  auto x_data = x.data<T>();
+  auto w_data = weight.data<int8_t>();
+  auto w_scale = weight_scale.data<float>();
+  const T* bias_data = bias ? bias->data<T>() : nullptr;
+
+  std::vector<int64_t> outliers;
+  for (int64_t c = 0; c < k; ++c) {
+    for (int64_t i = 0; i < m; ++i) {
+      if (std::abs(static_cast<float>(x_data[i * k + c])) >= threshold) {
+        outliers.push_back(c);
+        break;
+      }
+    }
+  }
+
+  std::vector<float> inlier(m * k);
+  funcs::ParallelFor(
+      0, m * k, funcs::kParallelGrainSize, [&](int64_t b, int64_t e) {
+        for (int64_t i = b; i < e; ++i) {
+          inlier[i] = static_cast<float>(x_data[i]);
+        }
+      });
+  for (int64_t i = 0; i < m; ++i) {
+    for (auto c : outliers) {
+      inlier[i * k + c] = 0.f;
+    }
+  }
+  std::vector<int8_t> x_q(m * k);
+  std::vector<float> x_scale(m);
+  funcs::QuantizeRowsAbsMax(inlier.data(), m, k, x_q.data(), x_scale.data());
+  std::vector<int32_t> acc(m * n);
+  funcs::Int8Gemm(m, n, k, x_q.data(), w_data, acc.data());
+
+  const int64_t grain =
+      std::max<int64_t>(1, funcs::kParallelGrainSize / (outliers.size() + 1));
+  funcs::ParallelFor(0, m * n, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      const int64_t i = idx / n;
+      const int64_t j = idx % n;
+      float v = static_cast<float>(acc[idx]) * x_scale[i] * w_scale[j];
+      float fp = 0.f;
+      for (auto c : outliers) {
+        fp += static_cast<float>(x_data[i * k + c]) *
+              static_cast<float>(w_data[j * k + c]);
+      }
+      v += fp * w_scale[j];
+      if (bias_data) {
+        v += static_cast<float>(bias_data[j]);
+      }
+      out_data[idx] = static_cast<T>(v);
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(matmul_int8,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::MatmulInt8Kernel,
+                    int8_t) {}
+
+PD_BUILD_PHI_KERNEL(llm_int8_linear,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::LLMInt8LinearKernel,
+                    float,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
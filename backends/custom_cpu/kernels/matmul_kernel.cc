@@ -12,11 +12,130 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "kernels/funcs/autotune.h"
+#include "kernels/funcs/blocked_gemm.h"
 #include "kernels/phi_funcs.h"
 #include "paddle/phi/capi/all.h"
 
 namespace custom_kernel {
 
+// Problems below this many multiply-adds run with the default blocking;
+// timing them would cost more than tuning could save.
+constexpr int64_t kGemmAutotuneMinFlops = 1 << 18;
+
+// Blocking for one GEMM problem: the cached winner if there is one,
+// otherwise the candidates are timed on the real output (the result does
+// not depend on the blocking) and the winner is cached. Returns true if
+// `out` already holds the result.
+template <typename T, typename MT>
+bool GetGemmConfig(bool trans_x,
+                   bool trans_y,
+                   int64_t M,
+                   int64_t K,
+                   int64_t N,
+                   const T* x,
+                   const T* y,
+                   T* out,
+                   bool trans_out,
+                   MT alpha,
+                   bool accumulate,
+                   funcs::GemmConfig* config) {
+  // The registered types all differ in size, which serves as the dtype tag.
+  funcs::AutotuneKey key{static_cast<uint32_t>(funcs::AutotuneOp::kGemm),
+                         static_cast<uint32_t>(sizeof(T)),
+                         {trans_x,
+                          trans_y,
+                          M,
+                          K,
+                          N,
+                          static_cast<int64_t>(funcs::GetMaxThreads())}};
+  auto& cache = funcs::AutotuneCache::Instance();
+  funcs::AutotuneRecord record;
+  if (cache.Lookup(key, &record)) {
+    *config = funcs::GemmConfig{record.params[0],
+                                record.params[1],
+                                record.params[2],
+                                record.params[3]};
+    return false;
+  }
+  *config = funcs::DefaultGemmConfig();
+  if (accumulate || M * N * K < kGemmAutotuneMinFlops ||
+      !funcs::AutotuneEnabled()) {
+    return false;
+  }
+
+  const auto candidates = funcs::GemmCandidates();
+  double seconds = 0.0;
+  const int best = funcs::AutotuneCache::Benchmark(
+      static_cast<int>(candidates.size()),
+      [&](int i) {
+        funcs::BlockedGemm<T, MT>(trans_x,
+                                  trans_y,
+                                  M,
+                                  K,
+                                  N,
+                                  x,
+                                  y,
+                                  out,
+                                  trans_out,
+                                  alpha,
+                                  false,
+                                  candidates[i]);
+      },
+      &seconds);
+  *config = candidates[best];
+  record.key = key;
+  record.params[0] = config->mc;
+  record.params[1] = config->nc;
+  record.params[2] = config->kc;
+  record.params[3] = config->col_major_tiles;
+  record.seconds = static_cast<float>(seconds);
+  record.reserved = 0;
+  cache.Insert(record);
+  return true;
+}
+
+template <typename T, typename MT>
+void RunGemm(bool trans_x,
+             bool trans_y,
+             int64_t M,
+             int64_t K,
+             int64_t N,
+             const T* x,
+             const T* y,
+             T* out,
+             bool trans_out,
+             MT alpha,
+             bool accumulate) {
+  funcs::GemmConfig config;
+  if (GetGemmConfig<T, MT>(trans_x,
+                           trans_y,
+                           M,
+                           K,
+                           N,
+                           x,
+                           y,
+                           out,
+                           trans_out,
+                           alpha,
+                           accumulate,
+                           &config)) {
+    return;
+  }
+  funcs::BlockedGemm<T, MT>(trans_x,
+                            trans_y,
+                            M,
+                            K,
+                            N,
+                            x,
+                            y,
+                            out,
+                            trans_out,
+                            alpha,
+                            accumulate,
+                            config);
+}
+
 template <typename T>
 void GEMM(bool trans_x,
           bool trans_y,
@@ -27,17 +146,18 @@ void GEMM(bool trans_x,
           const T* y,
           T* out,
           bool trans_out = false) {
-  memset(out, 0, M * N * sizeof(T));
-  for (size_t m = 0; m < M; ++m) {
-    for (size_t n = 0; n < N; ++n) {
-      auto* out_data = trans_out ? &out[n * M + m] : &out[m * N + n];
-      for (size_t k = 0; k < K; ++k) {
-        auto x_dat = trans_x ? x[k * M + m] : x[m * K + k];
-        auto y_dat = trans_y ? y[n * K + k] : y[k * N + n];
-        *out_data += x_dat * y_dat;
-      }
-    }
-  }
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  RunGemm<T, MT>(trans_x,
+                 trans_y,
+                 M,
+                 K,
+                 N,
+                 x,
+                 y,
+                 out,
+                 trans_out,
+                 static_cast<MT>(1),
+                 false);
 }
 
 template <typename T>
@@ -55,41 +175,56 @@ void BatchedGEMM(bool trans_x,
                  bool bs_flag = false,
                  bool reduce_bs = false,
                  float alpha = 1.0) {
-  memset(out, 0, sizeof(T) * (reduce_bs ? M * N : batch_size * M * N));
-  if (x_is_larger) {
-    for (size_t bs = 0; bs < batch_size; ++bs) {
-      for (size_t m = 0; m < M; ++m) {
-        for (size_t n = 0; n < N; ++n) {
-          auto out_bs = reduce_bs ? 0 : bs * M * N;
-          auto* out_data =
-              trans_out ? &out[out_bs + n * M + m] : &out[out_bs + m * N + n];
-          for (size_t k = 0; k < K; ++k) {
-            auto x_dat =
-                trans_x ? x[bs * M * K + k * M + m] : x[bs * M * K + m * K + k];
-            auto y_bs = bs_flag ? bs * N * K : 0;
-            auto y_dat = trans_y ? y[y_bs + n * K + k] : y[y_bs + k * N + n];
-            *out_data += static_cast<T>(alpha) * (x_dat * y_dat);
-          }
-        }
-      }
-    }
-  } else {
-    for (size_t bs = 0; bs < batch_size; ++bs) {
-      for (size_t m = 0; m < M; ++m) {
-        for (size_t n = 0; n < N; ++n) {
-          auto out_bs = reduce_bs ? 0 : bs * M * N;
-          auto* out_data =
-              trans_out ? &out[out_bs + n * M + m] : &out[out_bs + m * N + n];
-          for (size_t k = 0; k < K; ++k) {
-            auto y_dat =
-                trans_y ? y[bs * K * N + n * K + k] : y[bs * K * N + k * N + n];
-            auto x_bs = bs_flag ? bs * M * K : 0;
-            auto x_dat = trans_x ? x[x_bs + k * M + m] : x[x_bs + m * K + k];
-            *out_data += static_cast<T>(alpha) * (x_dat * y_dat);
-          }
-        }
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  if (reduce_bs && batch_size == 0) {
+    memset(out, 0, sizeof(T) * M * N);
+  }
+  // The operand with the batch dimension steps every batch, the other one
+  // only with bs_flag; a reduced output is summed over the batch.
+  auto run = [&](size_t bs) {
+    const T* x_bs = x + (x_is_larger || bs_flag ? bs * M * K : 0);
+    const T* y_bs = y + (!x_is_larger || bs_flag ? bs * K * N : 0);
+    T* out_bs = out + (reduce_bs ? 0 : bs * M * N);
+    RunGemm<T, MT>(trans_x,
+                   trans_y,
+                   M,
+                   K,
+                   N,
+                   x_bs,
+                   y_bs,
+                   out_bs,
+                   trans_out,
+                   static_cast<MT>(alpha),
+                   reduce_bs && bs > 0);
+  };
+  // Small matrices in a large batch are better split across the batch than
+  // inside each GEMM, which then runs serially with the default blocking.
+  if (!reduce_bs &&
+      batch_size >= static_cast<size_t>(funcs::GetMaxThreads()) &&
+      M * N * K < static_cast<size_t>(kGemmAutotuneMinFlops)) {
+    const auto config = funcs::DefaultGemmConfig();
+    funcs::ParallelFor(0, batch_size, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t bs = begin; bs < end; ++bs) {
+        const int64_t x_bs = x_is_larger || bs_flag ? bs : 0;
+        const int64_t y_bs = !x_is_larger || bs_flag ? bs : 0;
+        funcs::BlockedGemm<T, MT>(trans_x,
+                                  trans_y,
+                                  M,
+                                  K,
+                                  N,
+                                  x + x_bs * M * K,
+                                  y + y_bs * K * N,
+                                  out + bs * M * N,
+                                  trans_out,
+                                  static_cast<MT>(alpha),
+                                  false,
+                                  config);
       }
-    }
+    });
+    return;
+  }
+  for (size_t bs = 0; bs < batch_size; ++bs) {
+    run(bs);
   }
 }
 
@@ -0,0 +1,265 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+constexpr int64_t kMomentumChunkSize = 16384;
+
+template <typename T, typename MT>
+struct MomentumTensorArgs {
+  const T* param;
+  const T* grad;
+  const MT* velocity;
+  const MT* master_param;
+  T* param_out;
+  MT* velocity_out;
+  MT* master_param_out;
+  MT lr;
+  MT l2_coeff;
+};
+
+template <typename T, typename MT, bool kHasMaster, bool kNesterov>
+void MomentumUpdate(const MomentumTensorArgs<T, MT>& args,
+                    MT mu,
+                    MT rescale_grad,
+                    int64_t begin,
+                    int64_t end) {
+  const MT lr = args.lr;
+  const MT l2_coeff = args.l2_coeff;
+  PD_CPU_SIMD
+  for (int64_t i = begin; i < end; ++i) {
+    MT p = kHasMaster ? args.master_param[i] : static_cast<MT>(args.param[i]);
+    const MT g = static_cast<MT>(args.grad[i]) * rescale_grad + l2_coeff * p;
+    const MT v = args.velocity[i] * mu + g;
+    p -= kNesterov ? (g + v * mu) * lr : v * lr;
+    args.velocity_out[i] = v;
+    args.param_out[i] = static_cast<T>(p);
+    if (kHasMaster) {
+      args.master_param_out[i] = p;
+    }
+  }
+}
+
+template <typename T, typename MT>
+void MultiTensorMomentum(const std::vector<MomentumTensorArgs<T, MT>>& group,
+                         const std::vector<int64_t>& numels,
+                         MT mu,
+                         bool use_nesterov,
+                         MT rescale_grad) {
+  funcs::MultiTensorParallelFor(
+      numels, kMomentumChunkSize, [&](size_t t, int64_t begin, int64_t end) {
+        const auto& args = group[t];
+        if (args.master_param != nullptr) {
+          if (use_nesterov) {
+            MomentumUpdate<T, MT, true, true>(
+                args, mu, rescale_grad, begin, end);
+          } else {
+            MomentumUpdate<T, MT, true, false>(
+                args, mu, rescale_grad, begin, end);
+          }
+        } else {
+          if (use_nesterov) {
+            MomentumUpdate<T, MT, false, true>(
+                args, mu, rescale_grad, begin, end);
+          } else {
+            MomentumUpdate<T, MT, false, false>(
+                args, mu, rescale_grad, begin, end);
+          }
+        }
+      });
+}
+
+template <typename T, typename MT>
+MomentumTensorArgs<T, MT> PrepareMomentumTensor(
+    const phi::Context& dev_ctx,
+    const phi::DenseTensor& param,
+    const phi::DenseTensor& grad,
+    const phi::DenseTensor& velocity,
+    const phi::DenseTensor& learning_rate,
+    const phi::DenseTensor* master_param,
+    const std::string& regularization_method,
+    float regularization_coeff,
+    phi::DenseTensor* param_out,
+    phi::DenseTensor* velocity_out,
+    phi::DenseTensor* master_param_out) {
+  PD_CHECK(param.numel() == grad.numel() && param.numel() == velocity.numel(),
+           "The numel of Param(%ld), Grad(%ld) and Velocity(%ld) must be "
+           "equal.",
+           param.numel(),
+           grad.numel(),
+           velocity.numel());
+  PD_CHECK(regularization_method.empty() ||
+               regularization_method == "l2_decay",
+           "Only l2_decay regularization is supported, but received %s.",
+           regularization_method);
+
+  MomentumTensorArgs<T, MT> args;
+  args.param = param.data<T>();
+  args.grad = grad.data<T>();
+  args.velocity = velocity.data<MT>();
+  args.param_out = dev_ctx.template Alloc<T>(param_out);
+  args.velocity_out = dev_ctx.template Alloc<MT>(velocity_out);
+  args.master_param = nullptr;
+  args.master_param_out = nullptr;
+  if (master_param != nullptr) {
+    args.master_param = master_param->data<MT>();
+    args.master_param_out = dev_ctx.template Alloc<MT>(master_param_out);
+  }
+  args.lr = learning_rate.data<MT>()[0];
+  args.l2_coeff = regularization_method == "l2_decay"
+                      ? static_cast<MT>(regularization_coeff)
+                      : static_cast<MT>(0);
+  return args;
+}
+
+template <typename T>
+void MomentumKernel(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& param,
+                    const phi::DenseTensor& grad,
+                    const phi::DenseTensor& velocity,
+                    const phi::DenseTensor& learning_rate,
+                    const paddle::optional<phi::DenseTensor>& master_param,
+                    float mu,
+                    bool use_nesterov,
+                    const std::string& regularization_method,
+                    float regularization_coeff,
+                    bool multi_precision,
+                    float rescale_grad,
+                    phi::DenseTensor* param_out,
+                    phi::DenseTensor* velocity_out,
+                    phi::DenseTensor* master_param_out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+
+  const bool use_master = multi_precision && master_param_out != nullptr;
+  if (use_master) {
+    PD_CHECK(master_param.get_ptr() != nullptr,
+             "Input(MasterParam) must be provided when multi_precision is "
+             "true.");
+  }
+
+  std::vector<MomentumTensorArgs<T, MT>> group{PrepareMomentumTensor<T, MT>(
+      dev_ctx,
+      param,
+      grad,
+      velocity,
+      learning_rate,
+      use_master ? master_param.get_ptr() : nullptr,
+      regularization_method,
+      regularization_coeff,
+      param_out,
+      velocity_out,
+      master_param_out)};
+  MultiTensorMomentum<T, MT>(group,
+                             {param.numel()},
+                             static_cast<MT>(mu),
+                             use_nesterov,
+                             static_cast<MT>(rescale_grad));
+}
+
+template <typename T>
+void MergedMomentumKernel(
+    const phi::Context& dev_ctx,
+    const std::vector<const phi::DenseTensor*>& param,
+    const std::vector<const phi::DenseTensor*>& grad,
+    const std::vector<const phi::DenseTensor*>& velocity,
+    const std::vector<const phi::DenseTensor*>& learning_rate,
+    const paddle::optional<std::vector<const phi::DenseTensor*>>& master_param,
+    float mu,
+    bool use_nesterov,
+    const std::vector<std::string>& regularization_method,
+    const std::vector<float>& regularization_coeff,
+    bool multi_precision,
+    float rescale_grad,
+    std::vector<phi::DenseTensor*> param_out,
+    std::vector<phi::DenseTensor*> velocity_out,
+    std::vector<phi::DenseTensor*> master_param_out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+
+  const size_t n = param.size();
+  PD_CHECK(n == grad.size() && n == velocity.size() &&
+               n == param_out.size() && n == velocity_out.size(),
+           "The size of Input(Grad), Input(Velocity), Output(ParamOut) and "
+           "Output(VelocityOut) must be equal to Input(Param) (%d).",
+           static_cast<int>(n));
+  PD_CHECK(learning_rate.size() == 1 || learning_rate.size() == n,
+           "The size of Input(LearningRate) must be 1 or equal to "
+           "Input(Param) (%d), but received %d.",
+           static_cast<int>(n),
+           static_cast<int>(learning_rate.size()));
+  PD_CHECK(regularization_method.empty() ||
+               (regularization_method.size() == n &&
+                regularization_coeff.size() == n),
+           "The size of Attr(regularization_method) and "
+           "Attr(regularization_coeff) must be equal to Input(Param) (%d).",
+           static_cast<int>(n));
+  if (multi_precision) {
+    PD_CHECK(master_param.get_ptr() != nullptr &&
+                 master_param->size() == n && master_param_out.size() == n,
+             "Input(MasterParam) and Output(MasterParamOut) must hold %d "
+             "tensors when multi_precision is true.",
+             static_cast<int>(n));
+  }
+
+  std::vector<MomentumTensorArgs<T, MT>> group;
+  std::vector<int64_t> numels;
+  group.reserve(n);
+  numels.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    const bool has_reg = !regularization_method.empty();
+    group.push_back(PrepareMomentumTensor<T, MT>(
+        dev_ctx,
+        *param[i],
+        *grad[i],
+        *velocity[i],
+        *learning_rate[learning_rate.size() == 1 ? 0 : i],
+        multi_precision ? master_param.get()[i] : nullptr,
+        has_reg ? regularization_method[i] : std::string(),
+        has_reg ? regularization_coeff[i] : 0.0f,
+        param_out[i],
+        velocity_out[i],
+        multi_precision ? master_param_out[i] : nullptr));
+    numels.push_back(param[i]->numel());
+  }
+  MultiTensorMomentum<T, MT>(group,
+                             numels,
+                             static_cast<MT>(mu),
+                             use_nesterov,
+                             static_cast<MT>(rescale_grad));
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(momentum,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::MomentumKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(merged_momentum,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::MergedMomentumKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
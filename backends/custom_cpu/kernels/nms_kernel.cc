@@ -0,0 +1,180 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "kernels/funcs/detection.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Boxes are expected in descending score order; keeps their indices.
+template <typename T>
+void NMSKernel(const phi::Context& dev_ctx,
+               const phi::DenseTensor& boxes,
+               float threshold,
+               phi::DenseTensor* output) {
+  const auto dims = boxes.dims();
+  PD_CHECK(dims.size() == 2 && dims[1] == 4,
+           "The boxes of nms must be [N, 4].");
+  std::vector<int64_t> order(dims[0]);
+  std::iota(order.begin(), order.end(), 0);
+  auto kept = funcs::GreedyNms(boxes.data<T>(), order, threshold, true);
+  output->Resize({static_cast<int64_t>(kept.size())});
+  int64_t* out = dev_ctx.template Alloc<int64_t>(output);
+  std::copy(kept.begin(), kept.end(), out);
+}
+
+// bboxes: [N, M, 4], scores: [N, C, M]. Every (image, class) pair runs
+// its own NMS; rows come out per image, by class, then by score.
+template <typename T>
+void MultiClassNMSKernel(const phi::Context& dev_ctx,
+                         const phi::DenseTensor& bboxes,
+                         const phi::DenseTensor& scores,
+                         const paddle::optional<phi::DenseTensor>& rois_num,
+                         float score_threshold,
+                         int nms_top_k,
+                         int keep_top_k,
+                         float nms_threshold,
+                         bool normalized,
+                         float nms_eta,
+                         int background_label,
+                         phi::DenseTensor* out,
+                         phi::DenseTensor* index,
+                         phi::DenseTensor* nms_rois_num) {
+  const auto box_dims = bboxes.dims();
+  const auto score_dims = scores.dims();
+  PD_CHECK(!rois_num && score_dims.size() == 3,
+           "multiclass_nms3 on custom_cpu takes scores [N, C, M] without "
+           "RoisNum.");
+  PD_CHECK(box_dims.size() == 3 && box_dims[0] == score_dims[0] &&
+               box_dims[1] == score_dims[2] && box_dims[2] == 4,
+           "The bboxes of multiclass_nms3 must be [N, M, 4].");
+  const int64_t batch = score_dims[0];
+  const int64_t classes = score_dims[1];
+  const int64_t m = score_dims[2];
+  const T* box_data = bboxes.data<T>();
+  const T* score_data = scores.data<T>();
+
+  std::vector<std::vector<int64_t>> kept(batch * classes);
+  funcs::ParallelFor(0, batch * classes, 1, [&](int64_t b, int64_t e) {
+    std::vector<std::pair<T, int64_t>> candidates;
+    std::vector<int64_t> order;
+    for (int64_t task = b; task < e; ++task) {
+      if (task % classes == background_label) {
+        continue;
+      }
+      const T* s = score_data + task * m;
+      candidates.clear();
+      for (int64_t i = 0; i < m; ++i) {
+        if (s[i] > score_threshold) {
+          candidates.emplace_back(s[i], i);
+        }
+      }
+      std::stable_sort(
+          candidates.begin(),
+          candidates.end(),
+          [](const std::pair<T, int64_t>& a, const std::pair<T, int64_t>& b) {
+            return a.first > b.first;
+          });
+      if (nms_top_k > -1 &&
+          nms_top_k < static_cast<int64_t>(candidates.size())) {
+        candidates.resize(nms_top_k);
+      }
+      order.clear();
+      for (const auto& c : candidates) {
+        order.push_back(c.second);
+      }
+      kept[task] = funcs::GreedyNms(box_data + (task / classes) * m * 4,
+                                    order,
+                                    nms_threshold,
+                                    normalized,
+                                    nms_eta);
+    }
+  });
+
+  // keep_top_k keeps the best detections of an image over all classes.
+  std::vector<int64_t> counts(batch, 0);
+  for (int64_t n = 0; n < batch; ++n) {
+    // (score, (class, box)) of every kept detection.
+    std::vector<std::pair<T, std::pair<int64_t, int64_t>>> dets;
+    for (int64_t c = 0; c < classes; ++c) {
+      for (int64_t i : kept[n * classes + c]) {
+        dets.push_back({score_data[(n * classes + c) * m + i], {c, i}});
+      }
+    }
+    if (keep_top_k > -1 && static_cast<int64_t>(dets.size()) > keep_top_k) {
+      std::stable_sort(
+          dets.begin(), dets.end(), [](const auto& a, const auto& b) {
+            return a.first > b.first;
+          });
+      dets.resize(keep_top_k);
+      for (int64_t c = 0; c < classes; ++c) {
+        kept[n * classes + c].clear();
+      }
+      for (const auto& d : dets) {
+        kept[n * classes + d.second.first].push_back(d.second.second);
+      }
+    }
+    counts[n] = static_cast<int64_t>(dets.size());
+  }
+  const int64_t total =
+      std::accumulate(counts.begin(), counts.end(), int64_t{0});
+
+  out->Resize({total, 6});
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  int* index_data = nullptr;
+  if (index != nullptr) {
+    index->Resize({total, 1});
+    index_data = dev_ctx.template Alloc<int>(index);
+  }
+  int64_t row = 0;
+  for (int64_t n = 0; n < batch; ++n) {
+    for (int64_t c = 0; c < classes; ++c) {
+      for (int64_t i : kept[n * classes + c]) {
+        T* o = out_data + row * 6;
+        o[0] = static_cast<T>(c);
+        o[1] = score_data[(n * classes + c) * m + i];
+        std::copy_n(box_data + (n * m + i) * 4, 4, o + 2);
+        if (index_data != nullptr) {
+          index_data[row] = static_cast<int>(n * m + i);
+        }
+        ++row;
+      }
+    }
+  }
+  if (nms_rois_num != nullptr) {
+    nms_rois_num->Resize({batch});
+    int* num = dev_ctx.template Alloc<int>(nms_rois_num);
+    for (int64_t n = 0; n < batch; ++n) {
+      num[n] = static_cast<int>(counts[n]);
+    }
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(
+    nms, custom_cpu, ALL_LAYOUT, custom_kernel::NMSKernel, float, double) {}
+
+PD_BUILD_PHI_KERNEL(multiclass_nms3,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::MultiClassNMSKernel,
+                    float,
+                    double) {}
@@ -0,0 +1,74 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/compare.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+template <typename T>
+struct NonZeroFunctor {
+  bool operator()(const T a, const T zero) const { return a != zero; }
+};
+
+// x != 0 goes straight from the compare engine into a packed mask; the
+// coordinates of the set bits are written in parallel, each block at the
+// rank of its first set bit.
+template <typename T>
+void NonZeroKernel(const phi::Context& dev_ctx,
+                   const phi::DenseTensor& condition,
+                   phi::DenseTensor* out) {
+  const std::vector<int64_t> dims = condition.dims();
+  const int64_t rank = static_cast<int64_t>(dims.size());
+  const int64_t numel = condition.numel();
+
+  funcs::PackedMask bits;
+  const T zero = static_cast<T>(0);
+  funcs::BroadcastShape shape;
+  shape.dims = {numel};
+  shape.x_strides = {1};
+  shape.y_strides = {0};
+  shape.numel = numel;
+  funcs::CompareBits<T, NonZeroFunctor<T>>(
+      condition.data<T>(), &zero, shape, &bits);
+  const auto scan = funcs::ScanMask(bits);
+
+  out->Resize({scan.count(), rank});
+  int64_t* out_data = dev_ctx.template Alloc<int64_t>(out);
+  if (rank == 0) {
+    return;
+  }
+  funcs::ForEachSetBit(bits, scan, [&](int64_t index, int64_t position) {
+    int64_t* coord = out_data + position * rank;
+    for (int64_t d = rank - 1; d >= 0; --d) {
+      coord[d] = index % dims[d];
+      index /= dims[d];
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(nonzero,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::NonZeroKernel,
+                    float,
+                    double,
+                    uint8_t,
+                    int16_t,
+                    int32_t,
+                    int64_t,
+                    bool) {}
@@ -31,6 +31,22 @@ T TolerableValue(const T& x) {
   return x;
 }
 
+// Compute type used for low precision storage types.
+template <typename T>
+struct MPTypeTrait {
+  using Type = T;
+};
+
+template <>
+struct MPTypeTrait<phi::dtype::float16> {
+  using Type = float;
+};
+
+template <>
+struct MPTypeTrait<phi::dtype::bfloat16> {
+  using Type = float;
+};
+
 template <typename T>
 static inline std::string to_string(const T& val) {
   std::stringstream ss;
@@ -57,6 +73,14 @@ template <>
 inline std::string to_string<phi::DataLayout>(const phi::DataLayout& val) {
   if (val == phi::DataLayout::NCHW) {
     return "nchw";
+  } else if (val == phi::DataLayout::NHWC) {
+    return "nhwc";
+  } else if (val == phi::DataLayout::NCDHW) {
+    return "ncdhw";
+  } else if (val == phi::DataLayout::NDHWC) {
+    return "ndhwc";
+  } else if (val == phi::DataLayout::ANY) {
+    return "any";
   } else {
     return "undefined";
   }
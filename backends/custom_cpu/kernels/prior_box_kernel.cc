@@ -0,0 +1,154 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+// 1 first, then every new ratio and (with flip) its inverse.
+std::vector<float> ExpandAspectRatios(const std::vector<float>& ratios,
+                                      bool flip) {
+  std::vector<float> out = {1.0f};
+  for (float ar : ratios) {
+    const bool seen = std::any_of(out.begin(), out.end(), [ar](float r) {
+      return std::fabs(ar - r) < 1e-6;
+    });
+    if (!seen) {
+      out.push_back(ar);
+      if (flip) {
+        out.push_back(1.0f / ar);
+      }
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+// The half extents of every prior of a cell only depend on the sizes and
+// ratios, so they are computed once and offset by every cell center.
+template <typename T>
+void PriorBoxKernel(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& input,
+                    const phi::DenseTensor& image,
+                    const std::vector<float>& min_sizes,
+                    const std::vector<float>& max_sizes,
+                    const std::vector<float>& aspect_ratios,
+                    const std::vector<float>& variances,
+                    bool flip,
+                    bool clip,
+                    float step_w,
+                    float step_h,
+                    float offset,
+                    bool min_max_aspect_ratios_order,
+                    phi::DenseTensor* out,
+                    phi::DenseTensor* var) {
+  PD_CHECK(input.dims().size() == 4 && image.dims().size() == 4,
+           "The input and image of prior_box must be 4-D.");
+  PD_CHECK(variances.size() == 4, "prior_box takes 4 variances.");
+  PD_CHECK(max_sizes.empty() || max_sizes.size() == min_sizes.size(),
+           "prior_box takes one max_size per min_size.");
+  const int64_t feature_h = input.dims()[2];
+  const int64_t feature_w = input.dims()[3];
+  const T img_h = static_cast<T>(image.dims()[2]);
+  const T img_w = static_cast<T>(image.dims()[3]);
+  T step_width = static_cast<T>(step_w);
+  T step_height = static_cast<T>(step_h);
+  if (step_w == 0 || step_h == 0) {
+    step_width = img_w / feature_w;
+    step_height = img_h / feature_h;
+  }
+
+  const auto ratios = ExpandAspectRatios(aspect_ratios, flip);
+  std::vector<T> half;  // (w / 2, h / 2) of every prior of a cell
+  auto add = [&](T w, T h) {
+    half.push_back(w / 2);
+    half.push_back(h / 2);
+  };
+  for (size_t s = 0; s < min_sizes.size(); ++s) {
+    const T min_size = static_cast<T>(min_sizes[s]);
+    if (min_max_aspect_ratios_order) {
+      add(min_size, min_size);
+      if (!max_sizes.empty()) {
+        const T size = std::sqrt(min_size * max_sizes[s]);
+        add(size, size);
+      }
+      for (float ar : ratios) {
+        if (std::fabs(ar - 1.0f) >= 1e-6) {
+          add(min_size * std::sqrt(ar), min_size / std::sqrt(ar));
+        }
+      }
+    } else {
+      for (float ar : ratios) {
+        add(min_size * std::sqrt(ar), min_size / std::sqrt(ar));
+      }
+      if (!max_sizes.empty()) {
+        const T size = std::sqrt(min_size * max_sizes[s]);
+        add(size, size);
+      }
+    }
+  }
+  const int64_t priors = static_cast<int64_t>(half.size() / 2);
+
+  const std::vector<int64_t> dims = {feature_h, feature_w, priors, 4};
+  out->Resize(dims);
+  var->Resize(dims);
+  T* boxes = dev_ctx.template Alloc<T>(out);
+  T* vars = dev_ctx.template Alloc<T>(var);
+  const int64_t row = feature_w * priors * 4;
+  const int64_t grain = std::max<int64_t>(1, funcs::kParallelGrainSize / row);
+  funcs::ParallelFor(0, feature_h, grain, [&](int64_t b, int64_t e) {
+    for (int64_t h = b; h < e; ++h) {
+      const T cy = (h + offset) * step_height;
+      T* o = boxes + h * row;
+      for (int64_t w = 0; w < feature_w; ++w) {
+        const T cx = (w + offset) * step_width;
+        for (int64_t p = 0; p < priors; ++p, o += 4) {
+          o[0] = (cx - half[2 * p]) / img_w;
+          o[1] = (cy - half[2 * p + 1]) / img_h;
+          o[2] = (cx + half[2 * p]) / img_w;
+          o[3] = (cy + half[2 * p + 1]) / img_h;
+        }
+      }
+      if (clip) {
+        T* r = boxes + h * row;
+        PD_CPU_SIMD
+        for (int64_t i = 0; i < row; ++i) {
+          r[i] = std::min(std::max(r[i], T(0)), T(1));
+        }
+      }
+      T* v = vars + h * row;
+      for (int64_t i = 0; i < row; ++i) {
+        v[i] = static_cast<T>(variances[i % 4]);
+      }
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(prior_box,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::PriorBoxKernel,
+                    float,
+                    double) {}
@@ -0,0 +1,260 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "kernels/funcs/fill.h"
+#include "kernels/funcs/rnn.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+template <typename T>
+funcs::RnnArgs<T> MakeRnnArgs(
+    const phi::DenseTensor& x,
+    const std::vector<const phi::DenseTensor*>& pre_state,
+    const std::vector<const phi::DenseTensor*>& weight_list,
+    const paddle::optional<phi::DenseTensor>& sequence_length,
+    float dropout_prob,
+    bool is_bidirec,
+    int hidden_size,
+    int num_layers,
+    const std::string& mode,
+    bool is_test) {
+  funcs::RnnArgs<T> args;
+  auto& shape = args.shape;
+  PD_CHECK(funcs::ParseRnnMode(mode, &shape.mode),
+           "The mode of rnn must be LSTM, GRU, RNN_TANH or RNN_RELU, but "
+           "received %s.",
+           mode);
+  const auto dims = x.dims();
+  PD_CHECK(dims.size() == 3,
+           "The input of rnn must be [seq_len, batch_size, input_size], but "
+           "received a %d-D tensor.",
+           static_cast<int>(dims.size()));
+  shape.seq_len = dims[0];
+  shape.batch = dims[1];
+  shape.input_size = dims[2];
+  shape.hidden = hidden_size;
+  shape.layers = num_layers;
+  shape.directions = is_bidirec ? 2 : 1;
+  shape.dropout = !is_test && num_layers > 1 && dropout_prob > 0.0f;
+  PD_CHECK(dropout_prob >= 0.0f && dropout_prob <= 1.0f,
+           "The dropout_prob of rnn must be in [0, 1], but received %f.",
+           dropout_prob);
+
+  const bool lstm = shape.mode == funcs::RnnMode::kLstm;
+  PD_CHECK(pre_state.size() == (lstm ? 2u : 1u),
+           "rnn in %s mode takes %d initial states, but received %d.",
+           mode,
+           lstm ? 2 : 1,
+           static_cast<int>(pre_state.size()));
+  const int64_t states = shape.layers * shape.directions;
+  for (const auto* state : pre_state) {
+    PD_CHECK(state->numel() == states * shape.batch * shape.hidden,
+             "The initial states of rnn must be [num_layers * directions "
+             "(%ld), batch_size (%ld), hidden_size (%ld)].",
+             states,
+             shape.batch,
+             shape.hidden);
+  }
+  PD_CHECK(weight_list.size() == static_cast<size_t>(4 * states),
+           "rnn takes 4 weights per layer and direction (%ld), but received "
+           "%d.",
+           4 * states,
+           static_cast<int>(weight_list.size()));
+  for (int64_t l = 0; l < shape.layers; ++l) {
+    for (int64_t d = 0; d < shape.directions; ++d) {
+      const int64_t i = 2 * (l * shape.directions + d);
+      PD_CHECK(weight_list[i]->numel() ==
+                       shape.gates() * shape.layer_input(l) &&
+                   weight_list[i + 1]->numel() == shape.gates() * shape.hidden,
+               "The weights of layer %ld of rnn do not match its sizes.",
+               l);
+    }
+  }
+  for (const auto* w : weight_list) {
+    args.weights.push_back(w->data<T>());
+  }
+
+  args.lengths.assign(shape.batch, shape.seq_len);
+  if (sequence_length) {
+    const auto& lengths = *sequence_length;
+    PD_CHECK(lengths.numel() == shape.batch,
+             "SequenceLength of rnn must hold one length per row.");
+    for (int64_t b = 0; b < shape.batch; ++b) {
+      args.lengths[b] = lengths.dtype() == phi::DataType::INT64
+                            ? lengths.data<int64_t>()[b]
+                            : lengths.data<int>()[b];
+      PD_CHECK(args.lengths[b] >= 0 && args.lengths[b] <= shape.seq_len,
+               "SequenceLength of rnn must be in [0, %ld], but received "
+               "%ld.",
+               shape.seq_len,
+               args.lengths[b]);
+    }
+  }
+  args.x = x.data<T>();
+  args.init_h = pre_state[0]->data<T>();
+  args.init_c = lstm ? pre_state[1]->data<T>() : nullptr;
+  args.dropout_prob = dropout_prob;
+  args.is_test = is_test;
+  return args;
+}
+
+}  // namespace
+
+template <typename T>
+void RnnKernel(const phi::Context& dev_ctx,
+               const phi::DenseTensor& x,
+               const std::vector<const phi::DenseTensor*>& pre_state,
+               const std::vector<const phi::DenseTensor*>& weight_list,
+               const paddle::optional<phi::DenseTensor>& sequence_length,
+               float dropout_prob,
+               bool is_bidirec,
+               int input_size,
+               int hidden_size,
+               int num_layers,
+               const std::string& mode,
+               int seed,
+               bool is_test,
+               phi::DenseTensor* out,
+               phi::DenseTensor* dropout_state,
+               std::vector<phi::DenseTensor*> state,
+               phi::DenseTensor* reserve) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto args = MakeRnnArgs<T>(x,
+                                   pre_state,
+                                   weight_list,
+                                   sequence_length,
+                                   dropout_prob,
+                                   is_bidirec,
+                                   hidden_size,
+                                   num_layers,
+                                   mode,
+                                   is_test);
+  const auto& shape = args.shape;
+  const std::vector<int64_t> out_dims = {
+      shape.seq_len, shape.batch, shape.directions * shape.hidden};
+  out->Resize(out_dims);
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  T* last_h = dev_ctx.template Alloc<T>(state[0]);
+  T* last_c = shape.mode == funcs::RnnMode::kLstm
+                  ? dev_ctx.template Alloc<T>(state[1])
+                  : nullptr;
+
+  T* reserve_data = nullptr;
+  uint8_t* keep = nullptr;
+  if (!is_test) {
+    reserve->Resize({shape.reserve_size()});
+    reserve_data = dev_ctx.template Alloc<T>(reserve);
+    dropout_state->Resize(out_dims);
+    keep = dev_ctx.template Alloc<uint8_t>(dropout_state);
+    funcs::ParallelFill(keep, dropout_state->numel(), uint8_t{1});
+  }
+  uint64_t philox_seed = 0, offset = 0;
+  if (shape.dropout) {
+    funcs::GetPhiloxSeedOffset(
+        seed > 0 ? static_cast<uint64_t>(seed) : 0,
+        (shape.layers - 1) * ((shape.io_size() + 3) / 4),
+        &philox_seed,
+        &offset);
+  }
+  funcs::RnnForward<T, MT>(
+      args, philox_seed, offset, out_data, last_h, last_c, reserve_data, keep);
+}
+
+template <typename T>
+void RnnGradKernel(const phi::Context& dev_ctx,
+                   const phi::DenseTensor& x,
+                   const std::vector<const phi::DenseTensor*>& pre_state,
+                   const std::vector<const phi::DenseTensor*>& weight_list,
+                   const paddle::optional<phi::DenseTensor>& sequence_length,
+                   const phi::DenseTensor& out,
+                   const phi::DenseTensor& dropout_state,
+                   const phi::DenseTensor& reserve,
+                   const phi::DenseTensor& out_grad,
+                   const std::vector<const phi::DenseTensor*>& state_grad,
+                   float dropout_prob,
+                   bool is_bidirec,
+                   int input_size,
+                   int hidden_size,
+                   int num_layers,
+                   const std::string& mode,
+                   int seed,
+                   bool is_test,
+                   phi::DenseTensor* x_grad,
+                   std::vector<phi::DenseTensor*> pre_state_grad,
+                   std::vector<phi::DenseTensor*> weight_grad_list) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  PD_CHECK(!is_test, "rnn_grad needs the reserve of a training forward.");
+  const auto args = MakeRnnArgs<T>(x,
+                                   pre_state,
+                                   weight_list,
+                                   sequence_length,
+                                   dropout_prob,
+                                   is_bidirec,
+                                   hidden_size,
+                                   num_layers,
+                                   mode,
+                                   is_test);
+  PD_CHECK(reserve.numel() == args.shape.reserve_size(),
+           "The reserve of rnn_grad holds %ld values, but %ld are expected.",
+           reserve.numel(),
+           args.shape.reserve_size());
+
+  auto grad_data = [](const std::vector<const phi::DenseTensor*>& grads,
+                      size_t i) -> const T* {
+    return i < grads.size() && grads[i] != nullptr && grads[i]->initialized()
+               ? grads[i]->data<T>()
+               : nullptr;
+  };
+  auto alloc = [&](phi::DenseTensor* t, const phi::DenseTensor& like) {
+    if (t == nullptr) {
+      return static_cast<T*>(nullptr);
+    }
+    t->Resize(like.dims());
+    return dev_ctx.template Alloc<T>(t);
+  };
+  funcs::RnnGrads<T> grads;
+  grads.out_grad = out_grad.data<T>();
+  grads.last_h_grad = grad_data(state_grad, 0);
+  grads.last_c_grad = grad_data(state_grad, 1);
+  grads.x_grad = alloc(x_grad, x);
+  grads.init_h_grad =
+      pre_state_grad.size() > 0 ? alloc(pre_state_grad[0], *pre_state[0])
+                                : nullptr;
+  grads.init_c_grad =
+      pre_state_grad.size() > 1 ? alloc(pre_state_grad[1], *pre_state[1])
+                                : nullptr;
+  for (size_t i = 0; i < weight_grad_list.size(); ++i) {
+    grads.weight_grads.push_back(alloc(weight_grad_list[i], *weight_list[i]));
+  }
+  funcs::RnnBackward<T, MT>(args, reserve.data<T>(), grads);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(
+    rnn, custom_cpu, ALL_LAYOUT, custom_kernel::RnnKernel, float, double) {}
+
+PD_BUILD_PHI_KERNEL(rnn_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::RnnGradKernel,
+                    float,
+                    double) {}
@@ -0,0 +1,163 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "kernels/funcs/detection.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+funcs::RoiAlignShape GetRoiAlignShape(const phi::DenseTensor& x,
+                                      const phi::DenseTensor& boxes,
+                                      int pooled_height,
+                                      int pooled_width,
+                                      float spatial_scale,
+                                      int sampling_ratio,
+                                      bool aligned) {
+  const auto dims = x.dims();
+  PD_CHECK(dims.size() == 4, "The input of roi_align must be [N, C, H, W].");
+  const auto box_dims = boxes.dims();
+  PD_CHECK(box_dims.size() == 2 && box_dims[1] == 4,
+           "The boxes of roi_align must be [R, 4].");
+  PD_CHECK(pooled_height > 0 && pooled_width > 0,
+           "The pooled size of roi_align must be positive.");
+  funcs::RoiAlignShape shape;
+  shape.channels = dims[1];
+  shape.height = dims[2];
+  shape.width = dims[3];
+  shape.pooled_h = pooled_height;
+  shape.pooled_w = pooled_width;
+  shape.spatial_scale = spatial_scale;
+  shape.sampling_ratio = sampling_ratio;
+  shape.aligned = aligned;
+  return shape;
+}
+
+// The image of every ROI, from BoxesNum (ROIs per image, in order).
+std::vector<int64_t> RoiBatchIds(
+    const phi::DenseTensor& x,
+    const phi::DenseTensor& boxes,
+    const paddle::optional<phi::DenseTensor>& boxes_num) {
+  const int64_t batch = x.dims()[0];
+  const int64_t rois = boxes.dims()[0];
+  std::vector<int64_t> ids(rois, 0);
+  if (!boxes_num) {
+    PD_CHECK(batch == 1,
+             "roi_align on custom_cpu needs BoxesNum for a batch of %ld "
+             "images.",
+             batch);
+    return ids;
+  }
+  const auto& num = *boxes_num;
+  PD_CHECK(num.numel() == batch,
+           "BoxesNum of roi_align must hold one count per image.");
+  int64_t r = 0;
+  for (int64_t n = 0; n < batch; ++n) {
+    const int64_t count = num.dtype() == phi::DataType::INT64
+                              ? num.data<int64_t>()[n]
+                              : num.data<int>()[n];
+    PD_CHECK(count >= 0 && r + count <= rois,
+             "BoxesNum of roi_align does not match the %ld boxes.",
+             rois);
+    std::fill(ids.begin() + r, ids.begin() + r + count, n);
+    r += count;
+  }
+  PD_CHECK(r == rois,
+           "BoxesNum of roi_align sums to %ld, but there are %ld boxes.",
+           r,
+           rois);
+  return ids;
+}
+
+}  // namespace
+
+template <typename T>
+void RoiAlignKernel(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& x,
+                    const phi::DenseTensor& boxes,
+                    const paddle::optional<phi::DenseTensor>& boxes_num,
+                    int pooled_height,
+                    int pooled_width,
+                    float spatial_scale,
+                    int sampling_ratio,
+                    bool aligned,
+                    phi::DenseTensor* out) {
+  const auto shape = GetRoiAlignShape(x,
+                                      boxes,
+                                      pooled_height,
+                                      pooled_width,
+                                      spatial_scale,
+                                      sampling_ratio,
+                                      aligned);
+  const auto ids = RoiBatchIds(x, boxes, boxes_num);
+  out->Resize({static_cast<int64_t>(ids.size()),
+               shape.channels,
+               shape.pooled_h,
+               shape.pooled_w});
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  funcs::RoiAlignForward<T>(shape, x.data<T>(), boxes.data<T>(), ids, out_data);
+}
+
+template <typename T>
+void RoiAlignGradKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        const phi::DenseTensor& boxes,
+                        const paddle::optional<phi::DenseTensor>& boxes_num,
+                        const phi::DenseTensor& out_grad,
+                        int pooled_height,
+                        int pooled_width,
+                        float spatial_scale,
+                        int sampling_ratio,
+                        bool aligned,
+                        phi::DenseTensor* dx) {
+  if (dx == nullptr) {
+    return;
+  }
+  const auto shape = GetRoiAlignShape(x,
+                                      boxes,
+                                      pooled_height,
+                                      pooled_width,
+                                      spatial_scale,
+                                      sampling_ratio,
+                                      aligned);
+  const auto ids = RoiBatchIds(x, boxes, boxes_num);
+  dx->Resize(x.dims());
+  T* dx_data = dev_ctx.template Alloc<T>(dx);
+  funcs::RoiAlignBackward<T>(shape,
+                             boxes.data<T>(),
+                             ids,
+                             x.dims()[0],
+                             out_grad.data<T>(),
+                             dx_data);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(roi_align,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::RoiAlignKernel,
+                    float,
+                    double) {}
+
+PD_BUILD_PHI_KERNEL(roi_align_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::RoiAlignGradKernel,
+                    float,
+                    double) {}
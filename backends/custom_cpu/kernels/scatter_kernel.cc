@@ -0,0 +1,195 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <numeric>
+
+#include "kernels/funcs/index_engine.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+static inline int64_t TailNumel(const std::vector<int64_t>& dims,
+                                int64_t begin) {
+  return std::accumulate(dims.cbegin() + std::min<int64_t>(begin, dims.size()),
+                         dims.cend(),
+                         static_cast<int64_t>(1),
+                         std::multiplies<int64_t>());
+}
+
+template <typename T>
+void ScatterKernel(const phi::Context& dev_ctx,
+                   const phi::DenseTensor& x,
+                   const phi::DenseTensor& index,
+                   const phi::DenseTensor& updates,
+                   bool overwrite,
+                   phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  out->Resize(x_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  funcs::ParallelMemcpy(out_data, x.data<T>(), x.numel() * sizeof(T));
+  if (index.numel() == 0 || x_dims.empty()) {
+    return;
+  }
+
+  const int64_t rows = x_dims[0];
+  const int64_t slice = TailNumel(x_dims, 1);
+  auto idx = funcs::ReadIndex(index, rows, "scatter");
+  PD_CHECK(updates.numel() == static_cast<int64_t>(idx.size()) * slice,
+           "The updates of scatter must hold %ld elements, but received %ld.",
+           static_cast<int64_t>(idx.size()) * slice,
+           updates.numel());
+
+  // Without overwrite the addressed rows are replaced by the sum of their
+  // updates, not accumulated onto x.
+  funcs::ScatterSlices(updates.data<T>(),
+                       1,
+                       rows,
+                       slice,
+                       idx,
+                       overwrite ? funcs::ScatterMode::kAssign
+                                 : funcs::ScatterMode::kAddToZero,
+                       out_data);
+}
+
+template <typename T>
+void ScatterGradKernel(const phi::Context& dev_ctx,
+                       const phi::DenseTensor& index,
+                       const phi::DenseTensor& updates,
+                       const phi::DenseTensor& out_grad,
+                       bool overwrite,
+                       phi::DenseTensor* x_grad,
+                       phi::DenseTensor* updates_grad) {
+  auto dims = out_grad.dims();
+  const int64_t rows = dims.empty() ? 1 : dims[0];
+  const int64_t slice = TailNumel(dims, 1);
+  auto idx = funcs::ReadIndex(index, rows, "scatter_grad");
+
+  if (x_grad) {
+    x_grad->Resize(dims);
+    auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+    funcs::ParallelMemcpy(
+        x_grad_data, out_grad.data<T>(), out_grad.numel() * sizeof(T));
+    funcs::ZeroSlices(1, rows, slice, idx, x_grad_data);
+  }
+  if (updates_grad) {
+    updates_grad->Resize(updates.dims());
+    auto updates_grad_data = dev_ctx.template Alloc<T>(updates_grad);
+    funcs::GatherSlices(
+        out_grad.data<T>(), 1, rows, slice, idx, updates_grad_data);
+  }
+}
+
+template <typename T>
+void ScatterNdAddKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        const phi::DenseTensor& index,
+                        const phi::DenseTensor& updates,
+                        phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  out->Resize(x_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  funcs::ParallelMemcpy(out_data, x.data<T>(), x.numel() * sizeof(T));
+  if (updates.numel() == 0) {
+    return;
+  }
+
+  auto index_dims = index.dims();
+  const int64_t depth = index_dims.empty() ? 0 : index_dims.back();
+  const int64_t slice = TailNumel(x_dims, depth);
+  auto rows = funcs::NdIndexToRows(index, x_dims, "scatter_nd_add");
+  funcs::ScatterSlices(updates.data<T>(),
+                       1,
+                       x.numel() / std::max<int64_t>(slice, 1),
+                       slice,
+                       rows,
+                       funcs::ScatterMode::kAdd,
+                       out_data);
+}
+
+template <typename T>
+void ScatterNdAddGradKernel(const phi::Context& dev_ctx,
+                            const phi::DenseTensor& index,
+                            const phi::DenseTensor& updates,
+                            const phi::DenseTensor& out_grad,
+                            phi::DenseTensor* x_grad,
+                            phi::DenseTensor* updates_grad) {
+  auto dims = out_grad.dims();
+  if (x_grad) {
+    x_grad->Resize(dims);
+    auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+    funcs::ParallelMemcpy(
+        x_grad_data, out_grad.data<T>(), out_grad.numel() * sizeof(T));
+  }
+  if (updates_grad) {
+    updates_grad->Resize(updates.dims());
+    auto updates_grad_data = dev_ctx.template Alloc<T>(updates_grad);
+    if (updates.numel() == 0) {
+      return;
+    }
+    auto index_dims = index.dims();
+    const int64_t depth = index_dims.empty() ? 0 : index_dims.back();
+    const int64_t slice = TailNumel(dims, depth);
+    auto rows = funcs::NdIndexToRows(index, dims, "scatter_nd_add_grad");
+    funcs::GatherSlices(out_grad.data<T>(),
+                        1,
+                        out_grad.numel() / std::max<int64_t>(slice, 1),
+                        slice,
+                        rows,
+                        updates_grad_data);
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(scatter,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::ScatterKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(scatter_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::ScatterGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(scatter_nd_add,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::ScatterNdAddKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(scatter_nd_add_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::ScatterNdAddGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,163 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/concat_split.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Splits x along `axis` into parts of `axis_sizes`; unbind drops the axis
+// from the outputs (keep_axis = false). The outputs are always copies, as
+// an output sharing x's memory would see in-place ops on x and the other
+// way around. When every dim before `axis` is 1 each part is a single
+// contiguous copy.
+template <typename T>
+void SplitAlongAxis(const phi::Context& dev_ctx,
+                    const phi::DenseTensor& x,
+                    int64_t axis,
+                    const std::vector<int64_t>& axis_sizes,
+                    bool keep_axis,
+                    std::vector<phi::DenseTensor*> outs) {
+  const std::vector<int64_t> x_dims = x.dims();
+  std::vector<T*> parts(outs.size(), nullptr);
+  for (size_t k = 0; k < outs.size(); ++k) {
+    if (outs[k] == nullptr) {
+      continue;
+    }
+    std::vector<int64_t> dims = x_dims;
+    if (keep_axis) {
+      dims[axis] = axis_sizes[k];
+    } else {
+      dims.erase(dims.begin() + axis);
+    }
+    outs[k]->Resize(dims);
+    parts[k] = dev_ctx.template Alloc<T>(outs[k]);
+  }
+  if (x.numel() == 0) {
+    return;
+  }
+  funcs::SplitParts(
+      x.data<T>(), funcs::GetPartsShape(x_dims, axis, axis_sizes), parts);
+}
+
+inline int64_t NormalizeAxis(int64_t axis, int64_t rank) {
+  return axis < 0 ? axis + rank : axis;
+}
+
+template <typename T>
+void SplitKernel(const phi::Context& dev_ctx,
+                 const phi::DenseTensor& x,
+                 const phi::IntArray& sections,
+                 const phi::Scalar& axis_scalar,
+                 std::vector<phi::DenseTensor*> outs) {
+  const auto x_dims = x.dims();
+  const int64_t axis = NormalizeAxis(axis_scalar.to<int64_t>(), x_dims.size());
+  std::vector<int64_t> axis_sizes = sections.GetData();
+  // at most one section is -1, it takes what the others leave
+  int64_t known = 0;
+  int64_t unknown = -1;
+  for (size_t k = 0; k < axis_sizes.size(); ++k) {
+    if (axis_sizes[k] < 0) {
+      PD_CHECK(unknown == -1, "Only one section of split can be -1.");
+      unknown = static_cast<int64_t>(k);
+    } else {
+      known += axis_sizes[k];
+    }
+  }
+  if (unknown >= 0) {
+    axis_sizes[unknown] = x_dims[axis] - known;
+  }
+  int64_t total = 0;
+  for (auto size : axis_sizes) {
+    total += size;
+  }
+  PD_CHECK(total == x_dims[axis],
+           "The sections of split sum to %d, the axis has %d elements.",
+           static_cast<int>(total),
+           static_cast<int>(x_dims[axis]));
+  SplitAlongAxis<T>(dev_ctx, x, axis, axis_sizes, true, outs);
+}
+
+template <typename T>
+void SplitWithNumKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        int num,
+                        const phi::Scalar& axis_scalar,
+                        std::vector<phi::DenseTensor*> outs) {
+  const auto x_dims = x.dims();
+  const int64_t axis = NormalizeAxis(axis_scalar.to<int64_t>(), x_dims.size());
+  PD_CHECK(num > 0 && x_dims[axis] % num == 0,
+           "split_with_num needs the axis size (%d) to be divisible by "
+           "num (%d).",
+           static_cast<int>(x_dims[axis]),
+           num);
+  std::vector<int64_t> axis_sizes(num, x_dims[axis] / num);
+  SplitAlongAxis<T>(dev_ctx, x, axis, axis_sizes, true, outs);
+}
+
+template <typename T>
+void UnbindKernel(const phi::Context& dev_ctx,
+                  const phi::DenseTensor& x,
+                  int axis,
+                  std::vector<phi::DenseTensor*> outs) {
+  const auto x_dims = x.dims();
+  const int64_t dim = NormalizeAxis(axis, x_dims.size());
+  std::vector<int64_t> axis_sizes(x_dims[dim], 1);
+  SplitAlongAxis<T>(dev_ctx, x, dim, axis_sizes, false, outs);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(split,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::SplitKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    int8_t,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(split_with_num,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::SplitWithNumKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    int8_t,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(unbind,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::UnbindKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    int8_t,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,65 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/l2_norm.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+template <typename T>
+void SquaredL2NormKernel(const phi::Context& dev_ctx,
+                         const phi::DenseTensor& x,
+                         phi::DenseTensor* out) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  out->Resize({1});
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  out_data[0] = static_cast<T>(
+      funcs::MultiTensorSquaredL2Norm<T, MT>({x.data<T>()}, {x.numel()}));
+}
+
+template <typename T>
+void SquaredL2NormGradKernel(const phi::Context& dev_ctx,
+                             const phi::DenseTensor& x,
+                             const phi::DenseTensor& out_grad,
+                             phi::DenseTensor* x_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  PD_CHECK(out_grad.numel() == 1,
+           "Input(GRAD@Out) of squared_l2_norm_grad must be a scalar.");
+  x_grad->Resize(x.dims());
+  T* x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+  const MT scale = MT(2) * static_cast<MT>(out_grad.data<T>()[0]);
+  funcs::MultiTensorScale<T, MT>(
+      {x.data<T>()}, {x_grad_data}, {x.numel()}, scale);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(squared_l2_norm,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::SquaredL2NormKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(squared_l2_norm_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::SquaredL2NormGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
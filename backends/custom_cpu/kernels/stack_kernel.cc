@@ -0,0 +1,106 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/concat_split.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// stack is a concat of the inputs, each seen with a new axis of size 1.
+template <typename T>
+void StackKernel(const phi::Context& dev_ctx,
+                 const std::vector<const phi::DenseTensor*>& x,
+                 int axis,
+                 phi::DenseTensor* out) {
+  std::vector<int64_t> out_dims = x[0]->dims();
+  const int64_t dim =
+      axis < 0 ? axis + static_cast<int64_t>(out_dims.size()) + 1 : axis;
+  for (auto t : x) {
+    PD_CHECK(t->dims() == x[0]->dims(),
+             "The inputs of stack must have the same shape.");
+  }
+  out_dims.insert(out_dims.begin() + dim, static_cast<int64_t>(x.size()));
+  out->Resize(out_dims);
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  std::vector<const T*> parts;
+  for (auto t : x) {
+    parts.push_back(t->data<T>());
+  }
+  std::vector<int64_t> axis_sizes(x.size(), 1);
+  funcs::ConcatParts(
+      parts, funcs::GetPartsShape(out_dims, dim, axis_sizes), out_data);
+}
+
+template <typename T>
+void StackGradKernel(const phi::Context& dev_ctx,
+                     const phi::DenseTensor& out_grad,
+                     int axis,
+                     std::vector<phi::DenseTensor*> x_grad) {
+  const std::vector<int64_t> out_dims = out_grad.dims();
+  const int64_t dim =
+      axis < 0 ? axis + static_cast<int64_t>(out_dims.size()) : axis;
+  std::vector<int64_t> x_dims = out_dims;
+  x_dims.erase(x_dims.begin() + dim);
+  std::vector<T*> parts;
+  for (auto t : x_grad) {
+    T* part = nullptr;
+    if (t != nullptr) {
+      t->Resize(x_dims);
+      part = dev_ctx.template Alloc<T>(t);
+    }
+    parts.push_back(part);
+  }
+  if (out_grad.numel() == 0) {
+    return;
+  }
+  std::vector<int64_t> axis_sizes(x_grad.size(), 1);
+  funcs::SplitParts(out_grad.data<T>(),
+                    funcs::GetPartsShape(out_dims, dim, axis_sizes),
+                    parts);
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(stack,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::StackKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    int8_t,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(stack_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::StackGradKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    int8_t,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,228 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "kernels/funcs/batch_norm.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+#include "runtime/runtime.h"
+
+namespace custom_kernel {
+
+namespace {
+
+void SyncBatchNormAllReduce(std::vector<double> *sums) {
+  PD_CHECK(custom_cpu::AllReduceSum(custom_cpu::DefaultComm(),
+                                    sums->data(),
+                                    sums->size()) == C_SUCCESS,
+           "sync_batch_norm failed to all-reduce its statistics.");
+}
+
+}  // namespace
+
+// batch_norm over the batches of all ranks. Each rank reduces its part to
+// per channel partial sums, one all-reduce of doubles per reduction
+// combines them, so the statistics do not depend on how the batch is
+// split.
+template <typename T>
+void SyncBatchNormKernel(const phi::Context &dev_ctx,
+                         const phi::DenseTensor &x,
+                         const phi::DenseTensor &mean,
+                         const phi::DenseTensor &variance,
+                         const phi::DenseTensor &scale,
+                         const phi::DenseTensor &bias,
+                         bool is_test,
+                         float momentum,
+                         float epsilon,
+                         const std::string &data_layout,
+                         bool use_global_stats,
+                         bool trainable_statistics,
+                         phi::DenseTensor *y,
+                         phi::DenseTensor *mean_out,
+                         phi::DenseTensor *variance_out,
+                         phi::DenseTensor *saved_mean,
+                         phi::DenseTensor *saved_variance,
+                         phi::DenseTensor *reserve_space) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto shape = funcs::GetChannelShape(x.dims(), data_layout);
+  const int64_t C = shape.c;
+  const bool global_stats = (is_test && !trainable_statistics) ||
+                            use_global_stats;
+  const MT *running_mean = mean.data<MT>();
+  const MT *running_var = variance.data<MT>();
+
+  T *y_data = dev_ctx.template Alloc<T>(y);
+  MT *mean_out_data = dev_ctx.template Alloc<MT>(mean_out);
+  MT *variance_out_data = dev_ctx.template Alloc<MT>(variance_out);
+  MT *saved_mean_data = dev_ctx.template Alloc<MT>(saved_mean);
+  MT *saved_variance_data = dev_ctx.template Alloc<MT>(saved_variance);
+
+  std::vector<MT> batch_mean(C);
+  std::vector<MT> batch_var(C);
+  if (global_stats) {
+    for (int64_t c = 0; c < C; ++c) {
+      batch_mean[c] = running_mean[c];
+      batch_var[c] = running_var[c];
+      mean_out_data[c] = running_mean[c];
+      variance_out_data[c] = running_var[c];
+    }
+  } else {
+    std::vector<funcs::WelfordState<MT>> stats;
+    funcs::ChannelWelford<T, MT>(x.data<T>(), shape, &stats);
+    // [sum of x per channel, element count], then the global mean
+    std::vector<double> sums(C + 1);
+    for (int64_t c = 0; c < C; ++c) {
+      sums[c] = static_cast<double>(stats[c].mean) * stats[c].count;
+    }
+    sums[C] = static_cast<double>(shape.n * shape.s);
+    SyncBatchNormAllReduce(&sums);
+    const double count = sums[C];
+    PD_CHECK(count > 0, "sync_batch_norm got an empty batch on all ranks.");
+    // squared deviations from the global mean: m2 + n * (mean - gmean)^2
+    std::vector<double> m2(C);
+    for (int64_t c = 0; c < C; ++c) {
+      const double global_mean = sums[c] / count;
+      const double delta = static_cast<double>(stats[c].mean) - global_mean;
+      m2[c] = static_cast<double>(stats[c].m2) +
+              delta * delta * static_cast<double>(stats[c].count);
+      batch_mean[c] = static_cast<MT>(global_mean);
+    }
+    SyncBatchNormAllReduce(&m2);
+    const MT m = static_cast<MT>(momentum);
+    for (int64_t c = 0; c < C; ++c) {
+      batch_var[c] = static_cast<MT>(m2[c] / count);
+      mean_out_data[c] = running_mean[c] * m + batch_mean[c] * (1 - m);
+      variance_out_data[c] = running_var[c] * m + batch_var[c] * (1 - m);
+    }
+  }
+  std::vector<MT> inv_std(C);
+  for (int64_t c = 0; c < C; ++c) {
+    inv_std[c] = MT(1) / std::sqrt(batch_var[c] + static_cast<MT>(epsilon));
+    saved_mean_data[c] = batch_mean[c];
+    saved_variance_data[c] = inv_std[c];
+  }
+  if (x.numel() == 0) {
+    return;
+  }
+  funcs::BatchNormApply<T, MT>(x.data<T>(),
+                               shape,
+                               batch_mean.data(),
+                               inv_std.data(),
+                               scale.data<MT>(),
+                               bias.data<MT>(),
+                               y_data);
+}
+
+template <typename T>
+void SyncBatchNormGradKernel(
+    const phi::Context &dev_ctx,
+    const phi::DenseTensor &x,
+    const phi::DenseTensor &scale,
+    const phi::DenseTensor &bias,
+    const phi::DenseTensor &saved_mean,
+    const phi::DenseTensor &saved_variance,
+    const paddle::optional<phi::DenseTensor> &reserve_space,
+    const phi::DenseTensor &y_grad,
+    float momentum,
+    float epsilon,
+    const std::string &data_layout,
+    bool is_test,
+    bool use_global_stats,
+    bool trainable_statistics,
+    phi::DenseTensor *x_grad,
+    phi::DenseTensor *scale_grad,
+    phi::DenseTensor *bias_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  const auto shape = funcs::GetChannelShape(x.dims(), data_layout);
+  const int64_t C = shape.c;
+  const MT *mean = saved_mean.data<MT>();
+  const MT *inv_std = saved_variance.data<MT>();
+
+  std::vector<MT> sum_dy(C);
+  std::vector<MT> sum_dy_xmu(C);
+  funcs::ChannelGradSums<T, MT>(y_grad.data<T>(),
+                                x.data<T>(),
+                                shape,
+                                mean,
+                                sum_dy.data(),
+                                sum_dy_xmu.data());
+  // The parameter grads come from this rank's batch only; data-parallel
+  // gradient averaging combines them across ranks like any other grad.
+  if (scale_grad) {
+    MT *scale_grad_data = dev_ctx.template Alloc<MT>(scale_grad);
+    for (int64_t c = 0; c < C; ++c) {
+      scale_grad_data[c] = sum_dy_xmu[c] * inv_std[c];
+    }
+  }
+  if (bias_grad) {
+    MT *bias_grad_data = dev_ctx.template Alloc<MT>(bias_grad);
+    for (int64_t c = 0; c < C; ++c) {
+      bias_grad_data[c] = sum_dy[c];
+    }
+  }
+
+  // x_grad needs [sum_dy, sum_dy_xmu, element count] over all ranks.
+  std::vector<double> sums(2 * C + 1);
+  for (int64_t c = 0; c < C; ++c) {
+    sums[c] = static_cast<double>(sum_dy[c]);
+    sums[C + c] = static_cast<double>(sum_dy_xmu[c]);
+  }
+  sums[2 * C] = static_cast<double>(shape.n * shape.s);
+  SyncBatchNormAllReduce(&sums);
+  for (int64_t c = 0; c < C; ++c) {
+    sum_dy[c] = static_cast<MT>(sums[c]);
+    sum_dy_xmu[c] = static_cast<MT>(sums[C + c]);
+  }
+
+  if (x_grad) {
+    T *x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+    if (x.numel() == 0) {
+      return;
+    }
+    const bool global_stats = (is_test && !trainable_statistics) ||
+                              use_global_stats;
+    funcs::BatchNormGradApply<T, MT>(y_grad.data<T>(),
+                                     x.data<T>(),
+                                     shape,
+                                     mean,
+                                     inv_std,
+                                     scale.data<MT>(),
+                                     sum_dy.data(),
+                                     sum_dy_xmu.data(),
+                                     static_cast<MT>(sums[2 * C]),
+                                     !global_stats,
+                                     x_grad_data);
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(sync_batch_norm,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::SyncBatchNormKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(sync_batch_norm_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::SyncBatchNormGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,167 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <numeric>
+
+#include "kernels/funcs/index_engine.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// The index and x share the leading dims; the dims after `axis` are
+// flattened separately for each of them, the same way the phi CPU gather
+// and scatter functors address them.
+struct AlongAxisShape {
+  int64_t outer;
+  int64_t index_rows;
+  int64_t x_rows;
+  int64_t index_inner;
+  int64_t x_inner;
+};
+
+static inline AlongAxisShape GetAlongAxisShape(
+    const std::vector<int64_t>& x_dims,
+    const std::vector<int64_t>& index_dims,
+    int64_t axis) {
+  AlongAxisShape shape;
+  shape.outer = std::accumulate(index_dims.cbegin(),
+                                index_dims.cbegin() + axis,
+                                static_cast<int64_t>(1),
+                                std::multiplies<int64_t>());
+  shape.index_rows = index_dims[axis];
+  shape.x_rows = x_dims[axis];
+  shape.index_inner = std::accumulate(index_dims.cbegin() + axis + 1,
+                                      index_dims.cend(),
+                                      static_cast<int64_t>(1),
+                                      std::multiplies<int64_t>());
+  shape.x_inner = std::accumulate(x_dims.cbegin() + axis + 1,
+                                  x_dims.cend(),
+                                  static_cast<int64_t>(1),
+                                  std::multiplies<int64_t>());
+  return shape;
+}
+
+template <typename T>
+void TakeAlongAxisKernel(const phi::Context& dev_ctx,
+                         const phi::DenseTensor& x,
+                         const phi::DenseTensor& index,
+                         int axis,
+                         phi::DenseTensor* out) {
+  auto x_dims = x.dims();
+  auto index_dims = index.dims();
+  if (axis < 0) {
+    axis += x_dims.size();
+  }
+  out->Resize(index_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  auto s = GetAlongAxisShape(x_dims, index_dims, axis);
+  auto idx = funcs::ReadIndex(index, s.x_rows, "take_along_axis");
+  auto x_data = x.data<T>();
+  funcs::ParallelFor(
+      0,
+      s.outer * s.index_rows,
+      funcs::SliceGrain(s.index_inner),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t r = begin; r < end; ++r) {
+          const int64_t o = r / s.index_rows;
+          const int64_t* row_idx = idx.data() + r * s.index_inner;
+          const T* src = x_data + o * s.x_rows * s.x_inner;
+          T* dst = out_data + r * s.index_inner;
+          for (int64_t k = 0; k < s.index_inner; ++k) {
+            dst[k] = src[row_idx[k] * s.x_inner + k];
+          }
+        }
+      });
+}
+
+// Each (outer, inner) column of x_grad only receives the gradients of the
+// same column of out_grad. Columns are split across threads and every column
+// is accumulated in index order, so the result does not depend on the thread
+// count.
+template <typename T>
+void TakeAlongAxisGradKernel(const phi::Context& dev_ctx,
+                             const phi::DenseTensor& x,
+                             const phi::DenseTensor& index,
+                             const phi::DenseTensor& out_grad,
+                             int axis,
+                             phi::DenseTensor* x_grad) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  auto x_dims = x.dims();
+  auto index_dims = index.dims();
+  if (axis < 0) {
+    axis += x_dims.size();
+  }
+  x_grad->Resize(x_dims);
+  auto x_grad_data = dev_ctx.template Alloc<T>(x_grad);
+  funcs::ParallelMemset(x_grad_data, 0, x_grad->numel() * sizeof(T));
+  if (index.numel() == 0) {
+    return;
+  }
+
+  auto s = GetAlongAxisShape(x_dims, index_dims, axis);
+  auto idx = funcs::ReadIndex(index, s.x_rows, "take_along_axis_grad");
+  auto out_grad_data = out_grad.data<T>();
+  funcs::ParallelFor(
+      0,
+      s.outer * s.index_inner,
+      funcs::SliceGrain(s.index_rows),
+      [&](int64_t begin, int64_t end) {
+        std::vector<MT> acc(s.x_rows);
+        for (int64_t c = begin; c < end; ++c) {
+          const int64_t o = c / s.index_inner;
+          const int64_t k = c % s.index_inner;
+          const int64_t offset = o * s.index_rows * s.index_inner;
+          const int64_t* col_idx = idx.data() + offset;
+          const T* src = out_grad_data + offset;
+          std::fill(acc.begin(), acc.end(), static_cast<MT>(0));
+          for (int64_t j = 0; j < s.index_rows; ++j) {
+            acc[col_idx[j * s.index_inner + k]] +=
+                static_cast<MT>(src[j * s.index_inner + k]);
+          }
+          T* dst = x_grad_data + o * s.x_rows * s.x_inner + k;
+          for (int64_t j = 0; j < s.x_rows; ++j) {
+            dst[j * s.x_inner] = static_cast<T>(acc[j]);
+          }
+        }
+      });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(take_along_axis,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::TakeAlongAxisKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    uint8_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(take_along_axis_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::TakeAlongAxisGradKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
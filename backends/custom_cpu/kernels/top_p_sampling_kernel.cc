@@ -0,0 +1,101 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/funcs/philox.h"
+#include "kernels/funcs/sampling.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Samples one token per row of the probabilities x [bs, vocab] from the
+// smallest set of most probable tokens holding ps[b] of the mass. Row b
+// draws Philox block b, a seeded call returns the same ids for any thread
+// count; random_seed <= 0 draws from the default stream.
+template <typename T>
+void TopPSamplingKernel(const phi::Context& dev_ctx,
+                        const phi::DenseTensor& x,
+                        const phi::DenseTensor& ps,
+                        const paddle::optional<phi::DenseTensor>& threshold,
+                        int random_seed,
+                        phi::DenseTensor* out,
+                        phi::DenseTensor* ids) {
+  const auto dims = x.dims();
+  PD_CHECK(dims.size() == 2,
+           "The input of top_p_sampling must be [batch_size, vocab_size], "
+           "but it is %d-D.",
+           static_cast<int>(dims.size()));
+  const int64_t bs = dims[0];
+  const int64_t vocab = dims[1];
+  PD_CHECK(ps.numel() == bs,
+           "top_p_sampling needs one top_p per row (%ld rows, %ld values).",
+           bs,
+           ps.numel());
+  out->Resize({bs, 1});
+  ids->Resize({bs, 1});
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  int64_t* ids_data = dev_ctx.template Alloc<int64_t>(ids);
+  if (bs == 0 || vocab == 0) {
+    return;
+  }
+  const T* x_data = x.data<T>();
+  const T* ps_data = ps.data<T>();
+  const T* threshold_data = threshold ? threshold->data<T>() : nullptr;
+
+  uint64_t philox_seed, offset;
+  funcs::GetPhiloxSeedOffset(
+      random_seed > 0 ? static_cast<uint64_t>(random_seed) : 0,
+      bs,
+      &philox_seed,
+      &offset);
+  const funcs::Philox4x32 philox(philox_seed, offset);
+
+  funcs::ParallelFor(0, bs, 1, [&](int64_t begin, int64_t end) {
+    funcs::SamplingScratch scratch;
+    scratch.row.resize(vocab);
+    float* probs = scratch.row.data();
+    for (int64_t b = begin; b < end; ++b) {
+      const T* row = x_data + b * vocab;
+      funcs::ConvertElements(row, probs, vocab);
+      float total = 0.0f;
+      for (int64_t i = 0; i < vocab; ++i) {
+        total += probs[i];
+      }
+      const funcs::PhiloxBlock r = philox(b);
+      const int64_t id = funcs::SampleToken(
+          probs,
+          vocab,
+          total,
+          0,
+          static_cast<float>(ps_data[b]),
+          threshold_data ? static_cast<float>(threshold_data[b]) : 0.0f,
+          funcs::Uint64ToUnitDouble(r.v[0], r.v[1]),
+          &scratch);
+      ids_data[b] = id;
+      out_data[b] = row[id];
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(top_p_sampling,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::TopPSamplingKernel,
+                    float,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
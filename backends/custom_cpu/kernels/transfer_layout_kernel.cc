@@ -0,0 +1,94 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/layout.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+bool IsChannelsLast(phi::DataLayout layout) {
+  return layout == phi::DataLayout::NHWC || layout == phi::DataLayout::NDHWC;
+}
+
+bool IsChannelsFirst(phi::DataLayout layout) {
+  return layout == phi::DataLayout::NCHW || layout == phi::DataLayout::NCDHW;
+}
+
+}  // namespace
+
+// Converts between channels-first and channels-last at the edges of a
+// layout-transformed subgraph. Other layout pairs (or ranks below 4) only
+// relabel the data.
+template <typename T>
+void TransferLayoutKernel(const phi::Context& dev_ctx,
+                          const phi::DenseTensor& x,
+                          int src_layout,
+                          int dst_layout,
+                          phi::DenseTensor* out) {
+  const auto src = static_cast<phi::DataLayout>(src_layout);
+  const auto dst = static_cast<phi::DataLayout>(dst_layout);
+  auto dims = x.dims();
+  const int rank = dims.size();
+  const bool to_last = IsChannelsFirst(src) && IsChannelsLast(dst);
+  const bool to_first = IsChannelsLast(src) && IsChannelsFirst(dst);
+
+  std::vector<int64_t> out_dims = dims;
+  if (rank >= 4 && to_last) {
+    out_dims.erase(out_dims.begin() + 1);
+    out_dims.push_back(dims[1]);
+  } else if (rank >= 4 && to_first) {
+    out_dims.pop_back();
+    out_dims.insert(out_dims.begin() + 1, dims.back());
+  }
+  out->Resize(out_dims);
+  out->set_layout(dst);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (x.numel() == 0) {
+    return;
+  }
+  auto x_data = x.data<T>();
+
+  if (rank < 4 || !(to_last || to_first)) {
+    funcs::ParallelMemcpy(out_data, x_data, x.numel() * sizeof(T));
+    return;
+  }
+  const int64_t batch = dims[0];
+  const int64_t channels = to_last ? dims[1] : dims.back();
+  const int64_t spatial = x.numel() / std::max<int64_t>(1, batch * channels);
+  if (to_last) {
+    funcs::NchwToNhwc(x_data, batch, channels, spatial, out_data);
+  } else {
+    funcs::NhwcToNchw(x_data, batch, channels, spatial, out_data);
+  }
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(transfer_layout,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::TransferLayoutKernel,
+                    bool,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16,
+                    uint8_t,
+                    int8_t,
+                    int16_t,
+                    int32_t,
+                    int64_t) {}
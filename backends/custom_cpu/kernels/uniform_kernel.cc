@@ -12,23 +12,55 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <random>
-
+#include "kernels/funcs/philox.h"
 #include "paddle/phi/capi/all.h"
 
 namespace custom_kernel {
 
+// Element i is drawn from lane i % n of Philox block i / n, with n = 4 for
+// 32-bit outputs and n = 2 for double (53 bits from two lanes).
 template <typename T>
-inline void UniformRealDistribution(T *data,
-                                    const int64_t &size,
-                                    const float &min,
-                                    const float &max,
-                                    std::shared_ptr<std::mt19937_64> engine) {
-  std::uniform_real_distribution<T> dist(static_cast<T>(min),
-                                         static_cast<T>(max));
-  for (int64_t i = 0; i < size; ++i) {
-    data[i] = dist(*engine);
-  }
+void PhiloxUniformFill(const funcs::Philox4x32 &philox,
+                       T *data,
+                       int64_t size,
+                       float min,
+                       float max) {
+  const float range = max - min;
+  const int64_t num_blocks =
+      (size + funcs::kPhiloxLanes - 1) / funcs::kPhiloxLanes;
+  funcs::PhiloxParallelFor(
+      philox,
+      num_blocks,
+      funcs::kParallelGrainSize / funcs::kPhiloxLanes,
+      [&](int64_t b, const funcs::PhiloxBlock &r) {
+        const int64_t first = b * funcs::kPhiloxLanes;
+        const int64_t count = std::min(funcs::kPhiloxLanes, size - first);
+        for (int64_t l = 0; l < count; ++l) {
+          data[first + l] =
+              static_cast<T>(funcs::Uint32ToUnitFloat(r.v[l]) * range + min);
+        }
+      });
+}
+
+template <>
+void PhiloxUniformFill<double>(const funcs::Philox4x32 &philox,
+                               double *data,
+                               int64_t size,
+                               float min,
+                               float max) {
+  const double range = static_cast<double>(max) - min;
+  const int64_t num_blocks = (size + 1) / 2;
+  funcs::PhiloxParallelFor(
+      philox,
+      num_blocks,
+      funcs::kParallelGrainSize / 2,
+      [&](int64_t b, const funcs::PhiloxBlock &r) {
+        data[2 * b] = funcs::Uint64ToUnitDouble(r.v[0], r.v[1]) * range + min;
+        if (2 * b + 1 < size) {
+          data[2 * b + 1] =
+              funcs::Uint64ToUnitDouble(r.v[2], r.v[3]) * range + min;
+        }
+      });
 }
 
 template <typename T>
@@ -47,13 +79,15 @@ void UniformRawKernel(const phi::Context &dev_ctx,
   out->Resize(std::vector<int64_t>(shape_data.begin(), shape_data.end()));
   T *data = dev_ctx.template Alloc<T>(out);
   auto size = out->numel();
-  std::shared_ptr<std::mt19937_64> engine;
-
-  engine = std::make_shared<std::mt19937_64>();
-  engine->seed(seed);
 
-  UniformRealDistribution<T>(
-      data, size, min.to<float>(), max.to<float>(), engine);
+  uint64_t philox_seed, offset;
+  funcs::GetPhiloxSeedOffset(
+      static_cast<uint32_t>(seed), size, &philox_seed, &offset);
+  PhiloxUniformFill<T>(funcs::Philox4x32(philox_seed, offset),
+                       data,
+                       size,
+                       min.to<float>(),
+                       max.to<float>());
   if (diag_num > 0) {
     PD_CHECK(size > (diag_num - 1) * (diag_step + 1),
              "ShapeInvalid: the diagonal's elements is equal (num-1) "
@@ -65,7 +99,7 @@ void UniformRawKernel(const phi::Context &dev_ctx,
              size);
     for (int64_t i = 0; i < diag_num; ++i) {
       int64_t pos = i * diag_step + i;
-      data[pos] = diag_val;
+      data[pos] = static_cast<T>(diag_val);
     }
   }
 }
@@ -88,11 +122,15 @@ PD_BUILD_PHI_KERNEL(uniform_raw,
                     ALL_LAYOUT,
                     custom_kernel::UniformRawKernel,
                     float,
-                    double) {}
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
 
 PD_BUILD_PHI_KERNEL(uniform,
                     custom_cpu,
                     ALL_LAYOUT,
                     custom_kernel::UniformKernel,
                     float,
-                    double) {}
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,137 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstring>
+
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+constexpr int64_t kLossScalingChunkSize = 65536;
+
+template <typename MT>
+void UpdateScaling(bool found_inf,
+                   MT pre_loss_scaling,
+                   int good_in,
+                   int bad_in,
+                   int incr_every_n_steps,
+                   int decr_every_n_nan_or_inf,
+                   float incr_ratio,
+                   float decr_ratio,
+                   MT* updated_loss_scaling,
+                   int* good_out,
+                   int* bad_out) {
+  *updated_loss_scaling = pre_loss_scaling;
+  if (found_inf) {
+    *good_out = 0;
+    *bad_out = bad_in + 1;
+    if (*bad_out == decr_every_n_nan_or_inf) {
+      const MT scaled = pre_loss_scaling * static_cast<MT>(decr_ratio);
+      *updated_loss_scaling = scaled < MT(1) ? MT(1) : scaled;
+      *bad_out = 0;
+    }
+  } else {
+    *bad_out = 0;
+    *good_out = good_in + 1;
+    if (*good_out == incr_every_n_steps) {
+      const MT scaled = pre_loss_scaling * static_cast<MT>(incr_ratio);
+      if (std::isfinite(scaled)) {
+        *updated_loss_scaling = scaled;
+      }
+      *good_out = 0;
+    }
+  }
+}
+
+// On a step with an inf or nan gradient every output gradient is zeroed,
+// in one parallel sweep over all of them, so the optimizer step that
+// follows is a no-op; otherwise Out, normally sharing X, keeps the
+// gradients. Then the loss scaling and the good / bad step counters are
+// updated unless stop_update is set.
+template <typename T>
+void UpdateLossScalingKernel(const phi::Context& dev_ctx,
+                             const std::vector<const phi::DenseTensor*>& xs,
+                             const phi::DenseTensor& found_infinite,
+                             const phi::DenseTensor& prev_loss_scaling,
+                             const phi::DenseTensor& in_good_steps,
+                             const phi::DenseTensor& in_bad_steps,
+                             int incr_every_n_steps,
+                             int decr_every_n_nan_or_inf,
+                             float incr_ratio,
+                             float decr_ratio,
+                             const phi::Scalar& stop_update,
+                             std::vector<phi::DenseTensor*> outs,
+                             phi::DenseTensor* loss_scaling,
+                             phi::DenseTensor* out_good_steps,
+                             phi::DenseTensor* out_bad_steps) {
+  using MT = typename phi::MPTypeTrait<T>::Type;
+  PD_CHECK(found_infinite.numel() == 1,
+           "Input(FoundInfinite) must have only one element.");
+  const bool found_inf = found_infinite.data<bool>()[0];
+
+  const size_t n = xs.size();
+  std::vector<const T*> x_data(n);
+  std::vector<T*> out_data(n);
+  std::vector<int64_t> numels(n);
+  bool any_copy = false;
+  for (size_t i = 0; i < n; ++i) {
+    x_data[i] = xs[i]->data<T>();
+    outs[i]->Resize(xs[i]->dims());
+    out_data[i] = dev_ctx.template Alloc<T>(outs[i]);
+    numels[i] = xs[i]->numel();
+    any_copy = any_copy || x_data[i] != out_data[i];
+  }
+  if (found_inf || any_copy) {
+    funcs::MultiTensorParallelFor(
+        numels,
+        kLossScalingChunkSize,
+        [&](size_t t, int64_t begin, int64_t end) {
+          T* dst = out_data[t] + begin;
+          if (found_inf) {
+            std::memset(dst, 0, (end - begin) * sizeof(T));
+          } else if (dst != x_data[t] + begin) {
+            std::memcpy(dst, x_data[t] + begin, (end - begin) * sizeof(T));
+          }
+        });
+  }
+
+  if (stop_update.to<bool>()) {
+    return;
+  }
+  UpdateScaling<MT>(found_inf,
+                    prev_loss_scaling.data<MT>()[0],
+                    in_good_steps.data<int>()[0],
+                    in_bad_steps.data<int>()[0],
+                    incr_every_n_steps,
+                    decr_every_n_nan_or_inf,
+                    incr_ratio,
+                    decr_ratio,
+                    dev_ctx.template Alloc<MT>(loss_scaling),
+                    dev_ctx.template Alloc<int>(out_good_steps),
+                    dev_ctx.template Alloc<int>(out_bad_steps));
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(update_loss_scaling,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::UpdateLossScalingKernel,
+                    float,
+                    double,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,144 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "kernels/funcs/cast.h"
+#include "kernels/funcs/int8_gemm.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// Dequantizes output channels [j_begin, j_end) of an int8 [n, k] or packed
+// int4 [n / 2, k] weight into `tile`, one float row of k per channel.
+static inline void DequantWeightTile(const int8_t* weight,
+                                     const float* scale,
+                                     bool int4,
+                                     int64_t n,
+                                     int64_t k,
+                                     int64_t group,
+                                     int64_t j_begin,
+                                     int64_t j_end,
+                                     float* tile) {
+  for (int64_t j = j_begin; j < j_end; ++j) {
+    float* dst = tile + (j - j_begin) * k;
+    if (int4) {
+      const int8_t* src = weight + (j / 2) * k;
+      const bool high = j % 2 == 1;
+      for (int64_t kk = 0; kk < k; ++kk) {
+        dst[kk] = static_cast<float>(high ? funcs::HighNibble(src[kk])
+                                          : funcs::LowNibble(src[kk]));
+      }
+    } else {
+      const int8_t* src = weight + j * k;
+      PD_CPU_SIMD
+      for (int64_t kk = 0; kk < k; ++kk) {
+        dst[kk] = static_cast<float>(src[kk]);
+      }
+    }
+    for (int64_t kk = 0; kk < k; ++kk) {
+      dst[kk] *= scale[(kk / group) * n + j];
+    }
+  }
+}
+
+// out[..., n] = x[..., k] . dequant(weight)^T + bias
+//
+// The weight stays int8/int4 in memory and is only expanded tile by tile:
+// each thread owns a range of output channels, dequantizes kWeightTileRows
+// of them into a small float buffer and applies that tile to every row of
+// x before moving on, so weight traffic is 4x (int8) or 8x (int4) lower
+// than an fp32 GEMM.
+template <typename T>
+void WeightOnlyLinearKernel(const phi::Context& dev_ctx,
+                            const phi::DenseTensor& x,
+                            const phi::DenseTensor& weight,
+                            const paddle::optional<phi::DenseTensor>& bias,
+                            const phi::DenseTensor& weight_scale,
+                            const std::string& weight_dtype,
+                            int32_t arch,
+                            int32_t group_size,
+                            phi::DenseTensor* out) {
+  PD_CHECK(weight_dtype == "int8" || weight_dtype == "int4",
+           "The weight_dtype of weight_only_linear must be int8 or int4, but "
+           "received %s.",
+           weight_dtype);
+  const bool int4 = weight_dtype == "int4";
+  auto x_dims = x.dims();
+  auto w_dims = weight.dims();
+  const int64_t k = x_dims.back();
+  const int64_t n = int4 ? w_dims[0] * 2 : w_dims[0];
+  PD_CHECK(w_dims[1] == k,
+           "The weight of weight_only_linear must have k = %ld columns, but "
+           "received %ld.",
+           k,
+           w_dims[1]);
+  const int64_t m = k == 0 ? 0 : x.numel() / k;
+  const int64_t group = group_size == -1 ? k : group_size;
+
+  auto out_dims = x_dims;
+  out_dims.back() = n;
+  out->Resize(out_dims);
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  if (out->numel() == 0) {
+    return;
+  }
+
+  auto x_data = x.data<T>();
+  std::vector<float> x_float(m * k);
+  funcs::ParallelConvert(x_data, x_float.data(), m * k);
+  const T* bias_data = bias ? bias->data<T>() : nullptr;
+  auto weight_data = weight.data<int8_t>();
+  auto scale_data = weight_scale.data<float>();
+
+  const int64_t num_tiles =
+      (n + funcs::kWeightTileRows - 1) / funcs::kWeightTileRows;
+  funcs::ParallelFor(0, num_tiles, 1, [&](int64_t begin, int64_t end) {
+    std::vector<float> tile(funcs::kWeightTileRows * k);
+    for (int64_t t = begin; t < end; ++t) {
+      const int64_t j_begin = t * funcs::kWeightTileRows;
+      const int64_t j_end = std::min(n, j_begin + funcs::kWeightTileRows);
+      DequantWeightTile(weight_data,
+                        scale_data,
+                        int4,
+                        n,
+                        k,
+                        group,
+                        j_begin,
+                        j_end,
+                        tile.data());
+      for (int64_t i = 0; i < m; ++i) {
+        const float* x_row = x_float.data() + i * k;
+        for (int64_t j = j_begin; j < j_end; ++j) {
+          float v = funcs::FloatDot(x_row, tile.data() + (j - j_begin) * k, k);
+          if (bias_data) {
+            v += static_cast<float>(bias_data[j]);
+          }
+          out_data[i * n + j] = static_cast<T>(v);
+        }
+      }
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(weight_only_linear,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::WeightOnlyLinearKernel,
+                    float,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
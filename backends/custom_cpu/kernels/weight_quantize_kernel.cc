@@ -0,0 +1,184 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "kernels/funcs/int8_gemm.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+static inline bool IsInt4Algo(const std::string& algo) {
+  return algo == "weight_only_int4";
+}
+
+static inline void CheckWeightQuantAlgo(const std::string& algo) {
+  PD_CHECK(algo == "weight_only_int8" || algo == "weight_only_int4" ||
+               algo == "llm.int8",
+           "The algo of weight_quantize must be weight_only_int8, "
+           "weight_only_int4 or llm.int8, but received %s.",
+           algo);
+}
+
+static inline int64_t NumScaleGroups(int64_t k, int32_t group_size) {
+  return group_size == -1 ? 1 : (k + group_size - 1) / group_size;
+}
+
+// Quantizes a [k, n] weight into output-channel major [n, k] int8 (or
+// [n / 2, k] packed int4) with one absmax scale per channel and k group.
+template <typename T>
+void WeightQuantizeKernel(const phi::Context& dev_ctx,
+                          const phi::DenseTensor& x,
+                          const std::string& algo,
+                          int32_t arch,
+                          int32_t group_size,
+                          phi::DenseTensor* out,
+                          phi::DenseTensor* scale) {
+  CheckWeightQuantAlgo(algo);
+  PD_CHECK(group_size == -1 || group_size == 64 || group_size == 128,
+           "The group_size of weight_quantize must be -1, 64 or 128, but "
+           "received %d.",
+           group_size);
+  auto x_dims = x.dims();
+  PD_CHECK(x_dims.size() == 2,
+           "The weight of weight_quantize must be 2-D, but received %ld-D.",
+           static_cast<int64_t>(x_dims.size()));
+  const int64_t k = x_dims[0];
+  const int64_t n = x_dims[1];
+  const bool int4 = IsInt4Algo(algo);
+  PD_CHECK(!int4 || n % 2 == 0,
+           "weight_only_int4 needs an even number of output channels, but "
+           "received %ld.",
+           n);
+  const int bound = int4 ? funcs::kInt4Bound : funcs::kInt8Bound;
+  const int64_t groups = NumScaleGroups(k, group_size);
+  const int64_t group = group_size == -1 ? k : group_size;
+
+  out->Resize({int4 ? n / 2 : n, k});
+  auto out_data = dev_ctx.template Alloc<int8_t>(out);
+  if (group_size == -1) {
+    scale->Resize({n});
+  } else {
+    scale->Resize({groups, n});
+  }
+  auto scale_data = dev_ctx.template Alloc<float>(scale);
+  auto x_data = x.data<T>();
+
+  // Quantize one channel into `dst`, one value per k.
+  auto quantize_channel = [&](int64_t j, int8_t* dst) {
+    for (int64_t g = 0; g < groups; ++g) {
+      const int64_t k_begin = g * group;
+      const int64_t k_end = std::min(k, k_begin + group);
+      float absmax = 0.f;
+      for (int64_t kk = k_begin; kk < k_end; ++kk) {
+        absmax =
+            std::max(absmax, std::abs(static_cast<float>(x_data[kk * n + j])));
+      }
+      const float s = absmax / bound;
+      const float inv_s = s > 0.f ? 1.f / s : 0.f;
+      for (int64_t kk = k_begin; kk < k_end; ++kk) {
+        dst[kk] =
+            funcs::QuantizeValue(static_cast<float>(x_data[kk * n + j]),
+                                 inv_s,
+                                 bound);
+      }
+      scale_data[g * n + j] = s;
+    }
+  };
+
+  const int64_t grain =
+      std::max<int64_t>(1, funcs::kParallelGrainSize / std::max<int64_t>(k, 1));
+  if (!int4) {
+    funcs::ParallelFor(0, n, grain, [&](int64_t begin, int64_t end) {
+      for (int64_t j = begin; j < end; ++j) {
+        quantize_channel(j, out_data + j * k);
+      }
+    });
+    return;
+  }
+  funcs::ParallelFor(0, n / 2, grain, [&](int64_t begin, int64_t end) {
+    std::vector<int8_t> low(k);
+    std::vector<int8_t> high(k);
+    for (int64_t r = begin; r < end; ++r) {
+      quantize_channel(2 * r, low.data());
+      quantize_channel(2 * r + 1, high.data());
+      int8_t* dst = out_data + r * k;
+      for (int64_t kk = 0; kk < k; ++kk) {
+        dst[kk] = funcs::PackNibbles(low[kk], high[kk]);
+      }
+    }
+  });
+}
+
+// Inverse of weight_quantize: [n, k] int8 (or [n / 2, k] int4) back to a
+// [k, n] weight of type T.
+template <typename T>
+void WeightDequantizeKernel(const phi::Context& dev_ctx,
+                            const phi::DenseTensor& x,
+                            const phi::DenseTensor& scale,
+                            const std::string& algo,
+                            phi::DataType out_dtype,
+                            int32_t group_size,
+                            phi::DenseTensor* out) {
+  CheckWeightQuantAlgo(algo);
+  const bool int4 = IsInt4Algo(algo);
+  auto x_dims = x.dims();
+  const int64_t n = int4 ? x_dims[0] * 2 : x_dims[0];
+  const int64_t k = x_dims[1];
+  const int64_t group = group_size == -1 ? k : group_size;
+
+  out->Resize({k, n});
+  auto out_data = dev_ctx.template Alloc<T>(out);
+  auto x_data = x.data<int8_t>();
+  auto scale_data = scale.data<float>();
+
+  const int64_t grain =
+      std::max<int64_t>(1, funcs::kParallelGrainSize / std::max<int64_t>(n, 1));
+  funcs::ParallelFor(0, k, grain, [&](int64_t begin, int64_t end) {
+    for (int64_t kk = begin; kk < end; ++kk) {
+      const float* s = scale_data + (kk / group) * n;
+      T* dst = out_data + kk * n;
+      for (int64_t j = 0; j < n; ++j) {
+        int8_t q;
+        if (int4) {
+          const int8_t packed = x_data[(j / 2) * k + kk];
+          q = (j % 2 == 0) ? funcs::LowNibble(packed)
+                           : funcs::HighNibble(packed);
+        } else {
+          q = x_data[j * k + kk];
+        }
+        dst[j] = static_cast<T>(static_cast<float>(q) * s[j]);
+      }
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(weight_quantize,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::WeightQuantizeKernel,
+                    float,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(weight_dequantize,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::WeightDequantizeKernel,
+                    float,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
@@ -0,0 +1,104 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kernels/funcs/compare.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+// The select is branch free, the compiler turns it into a blend.
+template <typename T>
+void WhereKernel(const phi::Context& dev_ctx,
+                 const phi::DenseTensor& condition,
+                 const phi::DenseTensor& x,
+                 const phi::DenseTensor& y,
+                 phi::DenseTensor* out) {
+  PD_CHECK(condition.numel() == x.numel() && x.numel() == y.numel(),
+           "The condition, x and y of where must have the same shape.");
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  const int64_t numel = out->numel();
+  if (numel == 0) {
+    return;
+  }
+  const bool* cond = condition.data<bool>();
+  const T* x_data = x.data<T>();
+  const T* y_data = y.data<T>();
+  funcs::ParallelFor(
+      0, numel, funcs::kParallelGrainSize, [&](int64_t b, int64_t e) {
+        PD_CPU_SIMD
+        for (int64_t i = b; i < e; ++i) {
+          out_data[i] = cond[i] ? x_data[i] : y_data[i];
+        }
+      });
+}
+
+template <typename T>
+void WhereGradKernel(const phi::Context& dev_ctx,
+                     const phi::DenseTensor& condition,
+                     const phi::DenseTensor& x,
+                     const phi::DenseTensor& y,
+                     const phi::DenseTensor& out_grad,
+                     phi::DenseTensor* x_grad,
+                     phi::DenseTensor* y_grad) {
+  const int64_t numel = out_grad.numel();
+  const bool* cond = condition.data<bool>();
+  const T* dout = out_grad.data<T>();
+  T* dx = x_grad ? dev_ctx.template Alloc<T>(x_grad) : nullptr;
+  T* dy = y_grad ? dev_ctx.template Alloc<T>(y_grad) : nullptr;
+  if (numel == 0) {
+    return;
+  }
+  const T zero = static_cast<T>(0);
+  funcs::ParallelFor(
+      0, numel, funcs::kParallelGrainSize, [&](int64_t b, int64_t e) {
+        if (dx != nullptr) {
+          PD_CPU_SIMD
+          for (int64_t i = b; i < e; ++i) {
+            dx[i] = cond[i] ? dout[i] : zero;
+          }
+        }
+        if (dy != nullptr) {
+          PD_CPU_SIMD
+          for (int64_t i = b; i < e; ++i) {
+            dy[i] = cond[i] ? zero : dout[i];
+          }
+        }
+      });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(where,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::WhereKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    bool,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
+
+PD_BUILD_PHI_KERNEL(where_grad,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::WhereGradKernel,
+                    float,
+                    double,
+                    int,
+                    int64_t,
+                    phi::dtype::float16,
+                    phi::dtype::bfloat16) {}
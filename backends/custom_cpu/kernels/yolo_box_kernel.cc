@@ -0,0 +1,148 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "kernels/funcs/fill.h"
+#include "kernels/funcs/parallel.h"
+#include "kernels/phi_funcs.h"
+#include "paddle/phi/capi/all.h"
+
+namespace custom_kernel {
+
+namespace {
+
+template <typename T>
+inline T YoloSigmoid(T x) {
+  return static_cast<T>(1) / (static_cast<T>(1) + std::exp(-x));
+}
+
+}  // namespace
+
+// x: [N, A * (5 + classes) (+ A leading IoU channels), H, W]. Every
+// (image, anchor, grid row) decodes its W cells: the confidences of the
+// row are computed in one vector pass, then only cells above conf_thresh
+// write boxes and scores; the rest stay zero.
+template <typename T>
+void YoloBoxKernel(const phi::Context& dev_ctx,
+                   const phi::DenseTensor& x,
+                   const phi::DenseTensor& img_size,
+                   const std::vector<int>& anchors,
+                   int class_num,
+                   float conf_thresh,
+                   int downsample_ratio,
+                   bool clip_bbox,
+                   float scale_x_y,
+                   bool iou_aware,
+                   float iou_aware_factor,
+                   phi::DenseTensor* boxes,
+                   phi::DenseTensor* scores) {
+  const auto dims = x.dims();
+  PD_CHECK(dims.size() == 4, "The input of yolo_box must be [N, C, H, W].");
+  PD_CHECK(anchors.size() % 2 == 0 && !anchors.empty(),
+           "The anchors of yolo_box must be (w, h) pairs.");
+  const int64_t n = dims[0];
+  const int64_t h = dims[2];
+  const int64_t w = dims[3];
+  const int64_t an_num = static_cast<int64_t>(anchors.size() / 2);
+  const int64_t stride = h * w;
+  const int64_t an_stride = (class_num + 5) * stride;
+  PD_CHECK(dims[1] == an_num * (class_num + 5) + (iou_aware ? an_num : 0),
+           "The channels of yolo_box do not match its anchors and classes.");
+  const int64_t box_num = an_num * stride;
+  boxes->Resize({n, box_num, 4});
+  scores->Resize({n, box_num, static_cast<int64_t>(class_num)});
+  T* box_data = dev_ctx.template Alloc<T>(boxes);
+  T* score_data = dev_ctx.template Alloc<T>(scores);
+  funcs::ParallelFill(box_data, boxes->numel(), T(0));
+  funcs::ParallelFill(score_data, scores->numel(), T(0));
+
+  const T* input = x.data<T>();
+  const int* sizes = img_size.data<int>();
+  const T input_h = static_cast<T>(downsample_ratio * h);
+  const T input_w = static_cast<T>(downsample_ratio * w);
+  const T scale = static_cast<T>(scale_x_y);
+  const T bias = static_cast<T>(-0.5 * (scale_x_y - 1.));
+  const T factor = static_cast<T>(iou_aware_factor);
+  const T thresh = static_cast<T>(conf_thresh);
+  const int64_t grain =
+      std::max<int64_t>(1, funcs::kParallelGrainSize / (w * (class_num + 5)));
+
+  funcs::ParallelFor(0, n * an_num * h, grain, [&](int64_t b, int64_t e) {
+    std::vector<T> conf(w);
+    for (int64_t task = b; task < e; ++task) {
+      const int64_t i = task / (an_num * h);
+      const int64_t j = task / h % an_num;
+      const int64_t k = task % h;
+      const T img_h = static_cast<T>(sizes[2 * i]);
+      const T img_w = static_cast<T>(sizes[2 * i + 1]);
+      // The image's anchor block, past the IoU channels when iou_aware.
+      const T* entry = input + i * dims[1] * stride +
+                       (iou_aware ? an_num * stride : 0) + j * an_stride +
+                       k * w;
+      const T* obj = entry + 4 * stride;
+      PD_CPU_SIMD
+      for (int64_t l = 0; l < w; ++l) {
+        conf[l] = YoloSigmoid(obj[l]);
+      }
+      if (iou_aware) {
+        const T* iou = input + i * dims[1] * stride + j * stride + k * w;
+        for (int64_t l = 0; l < w; ++l) {
+          conf[l] = std::pow(conf[l], 1 - factor) *
+                    std::pow(YoloSigmoid(iou[l]), factor);
+        }
+      }
+      for (int64_t l = 0; l < w; ++l) {
+        if (conf[l] < thresh) {
+          continue;
+        }
+        const T cx = (l + YoloSigmoid(entry[l]) * scale + bias) * img_w / w;
+        const T cy =
+            (k + YoloSigmoid(entry[stride + l]) * scale + bias) * img_h / h;
+        const T bw =
+            std::exp(entry[2 * stride + l]) * anchors[2 * j] * img_w / input_w;
+        const T bh = std::exp(entry[3 * stride + l]) * anchors[2 * j + 1] *
+                     img_h / input_h;
+        const int64_t cell = i * box_num + j * stride + k * w + l;
+        T* o = box_data + cell * 4;
+        o[0] = cx - bw / 2;
+        o[1] = cy - bh / 2;
+        o[2] = cx + bw / 2;
+        o[3] = cy + bh / 2;
+        if (clip_bbox) {
+          o[0] = std::max(o[0], T(0));
+          o[1] = std::max(o[1], T(0));
+          o[2] = std::min(o[2], img_w - 1);
+          o[3] = std::min(o[3], img_h - 1);
+        }
+        T* s = score_data + cell * class_num;
+        const T* label = entry + 5 * stride + l;
+        for (int c = 0; c < class_num; ++c) {
+          s[c] = conf[l] * YoloSigmoid(label[c * stride]);
+        }
+      }
+    }
+  });
+}
+
+}  // namespace custom_kernel
+
+PD_BUILD_PHI_KERNEL(yolo_box,
+                    custom_cpu,
+                    ALL_LAYOUT,
+                    custom_kernel::YoloBoxKernel,
+                    float,
+                    double) {}
@@ -0,0 +1,50 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function, division
+
+import os
+import paddle
+
+from . import elementwise_fuse  # noqa: F401
+from . import inference_fuse  # noqa: F401
+
+
+def setUp():
+    for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+        if lib.endswith(".so"):
+            paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+                lib
+            )
+
+
+def register_pass(pass_builder, pass_name):
+    pass_builder.append_pass(pass_name)
+    paddle.base.core.register_subgraph_pass(pass_name)
+
+
+def addPasses(pass_builder):
+    # longer chains first so their prefixes are not fused on their own
+    register_pass(pass_builder, "custom_cpu_fuse_qkv_bias")
+    register_pass(pass_builder, "custom_cpu_fuse_qkv")
+    register_pass(pass_builder, "custom_cpu_fuse_conv_bn_relu")
+    register_pass(pass_builder, "custom_cpu_fuse_conv_bn")
+    register_pass(pass_builder, "custom_cpu_fuse_matmul_bias_relu")
+    register_pass(pass_builder, "custom_cpu_fuse_matmul_bias_gelu")
+    register_pass(pass_builder, "custom_cpu_fuse_matmul_bias")
+    register_pass(pass_builder, "custom_cpu_fuse_residual_layer_norm")
+    register_pass(pass_builder, "custom_cpu_fuse_mul_add_relu")
+    register_pass(pass_builder, "custom_cpu_fuse_add_relu_cast")
+    register_pass(pass_builder, "custom_cpu_fuse_add_relu")
+    register_pass(pass_builder, "custom_cpu_fuse_mul_add")
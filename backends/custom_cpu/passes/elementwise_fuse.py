@@ -0,0 +1,91 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Rewrites chains of elementwise ops into one fused_elementwise op, which
+# evaluates a postfix program (see kernels/funcs/fusion_engine.h) in a
+# single pass over memory. Inputs are named x, y, z in the program.
+#
+# fused_elementwise broadcasts x, y and z against each other the numpy way
+# and gives the output the broadcast shape, which is what elementwise ops
+# do with the default axis of -1, so the patterns only match that axis. It
+# runs on every dtype these ops do (float, float16, bfloat16, double, int32,
+# int64), as the patterns cannot tell dtypes apart.
+
+from paddle.incubate.passes import ir
+
+
+def fused_elementwise(program, out_dtype=-1, **inputs):
+    op = ir.PassDesc.OP.fused_elementwise(**inputs)
+    op.SetAttr("program", program)
+    op.SetAttr("out_dtype", out_dtype)
+    return op
+
+
+def elementwise(op_type, x, y):
+    op = getattr(ir.PassDesc.OP, op_type)(X=x, Y=y)
+    op.Attr("axis").EQ(-1)
+    return op
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_mul_add_relu():
+    def pattern(x, w, b):
+        mul = elementwise("elementwise_mul", x, w)
+        add = elementwise("elementwise_add", mul.Output("Out"), b)
+        return ir.PassDesc.OP.relu(X=add.Output("Out"))
+
+    def replace(x, w, b):
+        op = fused_elementwise("x y mul z add relu", x=x, y=w, z=b)
+        return op.Output("out")
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_add_relu_cast():
+    def pattern(x, y):
+        add = elementwise("elementwise_add", x, y)
+        relu = ir.PassDesc.OP.relu(X=add.Output("Out"))
+        return ir.PassDesc.OP.cast(X=relu.Output("Out"))
+
+    def replace(x, y):
+        op = fused_elementwise("x y add relu", x=x, y=y)
+        op.Attr("out_dtype").MappedPattern(op="cast", name="out_dtype")
+        return op.Output("out")
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_add_relu():
+    def pattern(x, y):
+        add = elementwise("elementwise_add", x, y)
+        return ir.PassDesc.OP.relu(X=add.Output("Out"))
+
+    def replace(x, y):
+        return fused_elementwise("x y add relu", x=x, y=y).Output("out")
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_mul_add():
+    def pattern(x, w, b):
+        mul = elementwise("elementwise_mul", x, w)
+        return elementwise("elementwise_add", mul.Output("Out"), b)
+
+    def replace(x, w, b):
+        return fused_elementwise("x y mul z add", x=x, y=w, z=b).Output("out")
+
+    return pattern, replace
@@ -0,0 +1,217 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Rewrites the common inference subgraphs (conv + batch_norm, matmul + bias
+# + activation, residual add + layer_norm, the Q/K/V projections) into the
+# fused custom ops of custom_op/, which run their epilogues on each output
+# tile while it is still in cache. The patterns only match an
+# elementwise_add broadcasting along the trailing axes (axis=-1), and Q/K/V
+# projections whose matmul_v2 transposes neither operand. A matmul + bias
+# needs a 2-D, untransposed weight and a [N] bias, gelu the exact (erf) form,
+# and a residual add two operands of the same shape, as the fused ops
+# check all of these.
+
+from paddle.incubate.passes import ir
+
+
+def fused_conv2d_bn_act(input, filter, scale, bias, mean, var, activation):
+    op = ir.PassDesc.OP.fused_conv2d_bn_act(
+        input=input,
+        filter=filter,
+        scale=scale,
+        bias=bias,
+        mean=mean,
+        variance=var,
+    )
+    for name in [
+        "strides",
+        "paddings",
+        "padding_algorithm",
+        "dilations",
+        "groups",
+        "data_format",
+    ]:
+        op.Attr(name).MappedPattern(op="conv2d", name=name)
+    op.Attr("epsilon").MappedPattern(op="batch_norm", name="epsilon")
+    op.SetAttr("activation", activation)
+    return op.Output("out")
+
+
+def conv_bn(input, filter, scale, bias, mean, var):
+    conv2d = ir.PassDesc.OP.conv2d(Input=input, Filter=filter)
+    return ir.PassDesc.OP.batch_norm(
+        X=conv2d.Output("Output"),
+        Scale=scale,
+        Bias=bias,
+        Mean=mean,
+        Variance=var,
+    )
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_conv_bn_relu():
+    def pattern(input, filter, scale, bias, mean, var):
+        bn = conv_bn(input, filter, scale, bias, mean, var)
+        return ir.PassDesc.OP.relu(X=bn.Output("Y"))
+
+    def replace(input, filter, scale, bias, mean, var):
+        return fused_conv2d_bn_act(input, filter, scale, bias, mean, var, "relu")
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_conv_bn():
+    def pattern(input, filter, scale, bias, mean, var):
+        return conv_bn(input, filter, scale, bias, mean, var).Output("Y")
+
+    def replace(input, filter, scale, bias, mean, var):
+        return fused_conv2d_bn_act(input, filter, scale, bias, mean, var, "")
+
+    return pattern, replace
+
+
+def fused_matmul_bias_act(x, y, bias, activation):
+    op = ir.PassDesc.OP.fused_matmul_bias_act(x=x, y=y, bias=bias)
+    op.Attr("trans_x").MappedPattern(op="matmul_v2", name="trans_x")
+    op.Attr("trans_y").MappedPattern(op="matmul_v2", name="trans_y")
+    op.SetAttr("activation", activation)
+    return op.Output("out")
+
+
+def elementwise_add(x, y):
+    add = ir.PassDesc.OP.elementwise_add(X=x, Y=y)
+    add.Attr("axis").EQ(-1)
+    return add
+
+
+def matmul_bias(x, y, bias):
+    x.Attr("shape").Size().GE(2)
+    y.Attr("shape").Size().EQ(2)
+    # a [N] bias rather than a [1] one broadcasting over the whole output
+    bias.Attr("shape").Size().EQ(1)
+    bias.Attr("shape")[0].NE(1)
+    matmul = ir.PassDesc.OP.matmul_v2(X=x, Y=y)
+    matmul.Attr("trans_y").EQ(False)
+    return elementwise_add(matmul.Output("Out"), bias)
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_matmul_bias_relu():
+    def pattern(x, y, bias):
+        add = matmul_bias(x, y, bias)
+        return ir.PassDesc.OP.relu(X=add.Output("Out"))
+
+    def replace(x, y, bias):
+        return fused_matmul_bias_act(x, y, bias, "relu")
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_matmul_bias_gelu():
+    def pattern(x, y, bias):
+        add = matmul_bias(x, y, bias)
+        gelu = ir.PassDesc.OP.gelu(X=add.Output("Out"))
+        gelu.Attr("approximate").EQ(False)
+        return gelu
+
+    def replace(x, y, bias):
+        # fused_matmul_bias_act evaluates the exact (erf) gelu
+        return fused_matmul_bias_act(x, y, bias, "gelu")
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_matmul_bias():
+    def pattern(x, y, bias):
+        return matmul_bias(x, y, bias).Output("Out")
+
+    def replace(x, y, bias):
+        return fused_matmul_bias_act(x, y, bias, "")
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_residual_layer_norm():
+    def pattern(x, residual, scale, bias):
+        x.Attr("shape").EQ(residual.Attr("shape"))
+        add = elementwise_add(x, residual)
+        ln = ir.PassDesc.OP.layer_norm(X=add.Output("Out"), Scale=scale, Bias=bias)
+        return ln.Output("Y")[0], add.Output("Out")[0]
+
+    def replace(x, residual, scale, bias):
+        op = ir.PassDesc.OP.fused_residual_layer_norm(
+            x=x, residual=residual, scale=scale, bias=bias
+        )
+        op.Attr("epsilon").MappedPattern(op="layer_norm", name="epsilon")
+        op.Attr("begin_norm_axis").MappedPattern(
+            op="layer_norm", name="begin_norm_axis"
+        )
+        return op.Output("out")[0], op.Output("residual_out")[0]
+
+    return pattern, replace
+
+
+def projection(x, w, bias=None):
+    # fused_qkv_projection has no transpose flags, and the three matmuls
+    # could not share one mapped from the pattern anyway
+    matmul = ir.PassDesc.OP.matmul_v2(X=x, Y=w)
+    matmul.Attr("trans_x").EQ(False)
+    matmul.Attr("trans_y").EQ(False)
+    if bias is None:
+        return matmul.Output("Out")[0]
+    add = elementwise_add(matmul.Output("Out"), bias)
+    return add.Output("Out")[0]
+
+
+def fused_qkv_projection(**inputs):
+    op = ir.PassDesc.OP.fused_qkv_projection(**inputs)
+    return op.Output("q")[0], op.Output("k")[0], op.Output("v")[0]
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_qkv_bias():
+    def pattern(x, wq, wk, wv, bq, bk, bv):
+        return (
+            projection(x, wq, bq),
+            projection(x, wk, bk),
+            projection(x, wv, bv),
+        )
+
+    def replace(x, wq, wk, wv, bq, bk, bv):
+        return fused_qkv_projection(
+            x=x,
+            q_weight=wq,
+            k_weight=wk,
+            v_weight=wv,
+            q_bias=bq,
+            k_bias=bk,
+            v_bias=bv,
+        )
+
+    return pattern, replace
+
+
+@ir.RegisterPass
+def custom_cpu_fuse_qkv():
+    def pattern(x, wq, wk, wv):
+        return projection(x, wq), projection(x, wk), projection(x, wv)
+
+    def replace(x, wq, wk, wv):
+        return fused_qkv_projection(x=x, q_weight=wq, k_weight=wk, v_weight=wv)
+
+    return pattern, replace
@@ -0,0 +1,265 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/memory_planner.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace custom_cpu {
+
+namespace {
+
+size_t AlignUp(size_t size) {
+  const size_t a = MemoryPlanner::kAlignment;
+  return (std::max<size_t>(size, 1) + a - 1) / a * a;
+}
+
+bool Overlap(int64_t begin_a, int64_t end_a, int64_t begin_b, int64_t end_b) {
+  return begin_a < end_b && begin_b < end_a;
+}
+
+}  // namespace
+
+constexpr size_t MemoryPlanner::kAlignment;
+constexpr int64_t MemoryPlanner::kNotFreed;
+
+MemoryPlanner& MemoryPlanner::Instance() {
+  // leaked on purpose: tensors may be freed after static destructors ran
+  static MemoryPlanner* planner = new MemoryPlanner();
+  return *planner;
+}
+
+void MemoryPlanner::BeginRun(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  key_ = key;
+  trace_ = Plan();
+  clock_ = 0;
+  diverged_ = false;
+  slot_live_.clear();
+  live_.clear();
+  plan_ = nullptr;
+  auto it = plans_.find(key);
+  // buffers of the previous run still in the slab would be overwritten
+  if (it != plans_.end() && slab_live_ == 0) {
+    if (slab_bytes_ < it->second.slab_bytes) {
+      free(slab_);
+      slab_bytes_ = 0;
+      slab_ = static_cast<char*>(aligned_alloc(kAlignment,
+                                               it->second.slab_bytes));
+      if (slab_ != nullptr) {
+        slab_bytes_ = it->second.slab_bytes;
+      }
+    }
+    if (slab_ != nullptr) {
+      plan_ = &it->second;
+    }
+  }
+  active_.store(true, std::memory_order_release);
+}
+
+void MemoryPlanner::EndRun() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!active_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  active_.store(false, std::memory_order_release);
+  live_.clear();
+
+  auto it = plans_.find(key_);
+  if (it == plans_.end()) {
+    AssignOffsets(&trace_);
+    plans_.emplace(key_, std::move(trace_));
+    stats_.plans = plans_.size();
+  } else if (plan_ == nullptr || diverged_) {
+    Plan& plan = it->second;
+    if (plan.starts == trace_.starts && plan.ends == trace_.ends) {
+      // same lifetimes, other sizes: widen the plan to cover both runs of
+      // the shape bucket
+      for (size_t i = 0; i < plan.sizes.size(); ++i) {
+        plan.sizes[i] = std::max(plan.sizes[i], trace_.sizes[i]);
+      }
+    } else {
+      plan = std::move(trace_);
+    }
+    AssignOffsets(&plan);
+  }
+  plan_ = nullptr;
+  trace_ = Plan();
+}
+
+void MemoryPlanner::AssignOffsets(Plan* plan) {
+  const int n = static_cast<int>(plan->sizes.size());
+  plan->offsets.assign(n, -1);
+  plan->conflicts.assign(n, {});
+  std::vector<int> order;
+  for (int i = 0; i < n; ++i) {
+    if (plan->ends[i] != kNotFreed) {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return plan->sizes[a] > plan->sizes[b];
+  });
+
+  std::vector<int> placed;
+  std::vector<std::pair<int64_t, int64_t>> busy;
+  size_t slab_bytes = 0;
+  for (int i : order) {
+    const int64_t size = AlignUp(plan->sizes[i]);
+    busy.clear();
+    for (int j : placed) {
+      if (Overlap(plan->starts[i], plan->ends[i], plan->starts[j],
+                  plan->ends[j])) {
+        busy.emplace_back(plan->offsets[j],
+                          plan->offsets[j] + AlignUp(plan->sizes[j]));
+      }
+    }
+    std::sort(busy.begin(), busy.end());
+    int64_t offset = 0;
+    for (const auto& range : busy) {
+      if (range.first - offset >= size) {
+        break;
+      }
+      offset = std::max(offset, range.second);
+    }
+    plan->offsets[i] = offset;
+    placed.push_back(i);
+    slab_bytes = std::max<size_t>(slab_bytes, offset + size);
+  }
+  plan->slab_bytes = slab_bytes;
+
+  // earlier slots sharing addresses with a slot; their lifetimes are
+  // disjoint in the recorded run, replay checks that they are here too
+  for (int i : placed) {
+    const int64_t end_i = plan->offsets[i] + AlignUp(plan->sizes[i]);
+    for (int j : placed) {
+      if (j < i && Overlap(plan->offsets[i], end_i, plan->offsets[j],
+                           plan->offsets[j] + AlignUp(plan->sizes[j]))) {
+        plan->conflicts[i].push_back(j);
+      }
+    }
+  }
+}
+
+void* MemoryPlanner::ServeFromSlab(size_t size) {
+  const size_t slot = trace_.sizes.size();
+  if (plan_ == nullptr || slot >= plan_->sizes.size()) {
+    return nullptr;
+  }
+  if (plan_->offsets[slot] < 0 || size > plan_->sizes[slot]) {
+    return nullptr;
+  }
+  for (int j : plan_->conflicts[slot]) {
+    if (slot_live_[j]) {
+      return nullptr;
+    }
+  }
+  return slab_ + plan_->offsets[slot];
+}
+
+void* MemoryPlanner::Allocate(size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!active_.load(std::memory_order_relaxed)) {
+    return malloc(size);
+  }
+  const int slot = static_cast<int>(trace_.sizes.size());
+  void* ptr = ServeFromSlab(size);
+  const bool in_slab = ptr != nullptr;
+  if (in_slab) {
+    ++slab_live_;
+    ++stats_.served;
+  } else {
+    ptr = malloc(size);
+    if (ptr == nullptr) {
+      return nullptr;
+    }
+    // a miss unless the plan left this buffer to malloc
+    if (plan_ != nullptr && (slot >= static_cast<int>(plan_->sizes.size()) ||
+                             plan_->offsets[slot] >= 0)) {
+      diverged_ = true;
+      ++stats_.fallback;
+    }
+  }
+  trace_.sizes.push_back(size);
+  trace_.starts.push_back(clock_++);
+  trace_.ends.push_back(kNotFreed);
+  slot_live_.push_back(in_slab);
+  live_[ptr] = slot;
+  return ptr;
+}
+
+bool MemoryPlanner::Deallocate(void* ptr) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = live_.find(ptr);
+  if (it != live_.end()) {
+    trace_.ends[it->second] = clock_++;
+    slot_live_[it->second] = false;
+    live_.erase(it);
+  }
+  if (InSlab(ptr)) {
+    --slab_live_;
+    return true;
+  }
+  return false;
+}
+
+MemoryPlanner::Stats MemoryPlanner::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.slab_bytes = slab_bytes_;
+  return stats;
+}
+
+void MemoryPlanner::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  plans_.clear();
+  stats_ = Stats();
+  if (slab_live_ == 0) {
+    free(slab_);
+    slab_ = nullptr;
+    slab_bytes_ = 0;
+  }
+}
+
+}  // namespace custom_cpu
+
+// Entry points of the planner, called from python through ctypes (see
+// tools/memory_plan.py) around each run of a predictor.
+extern "C" {
+
+void CustomCpuMemoryPlanBegin(const char* key) {
+  custom_cpu::MemoryPlanner::Instance().BeginRun(key);
+}
+
+void CustomCpuMemoryPlanEnd() {
+  custom_cpu::MemoryPlanner::Instance().EndRun();
+}
+
+void CustomCpuMemoryPlanStats(size_t* slab_bytes,
+                              size_t* served,
+                              size_t* fallback,
+                              size_t* plans) {
+  const auto stats = custom_cpu::MemoryPlanner::Instance().GetStats();
+  *slab_bytes = stats.slab_bytes;
+  *served = stats.served;
+  *fallback = stats.fallback;
+  *plans = stats.plans;
+}
+
+void CustomCpuMemoryPlanReset() {
+  custom_cpu::MemoryPlanner::Instance().Reset();
+}
+
+}  // extern "C"
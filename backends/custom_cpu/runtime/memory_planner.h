@@ -0,0 +1,115 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace custom_cpu {
+
+// Liveness based static memory planning for inference.
+//
+// A run (one forward pass of a model for one input shape bucket) is
+// bracketed by BeginRun(key) / EndRun(). The first run of a key is served
+// by malloc while the order and size of its allocations and frees are
+// recorded. At EndRun the buffers freed within the run get offsets in one
+// slab, greedy by size: each takes the lowest offset not overlapping a
+// buffer placed before it whose lifetime intersects its own. Later runs of
+// the key hand out slab + offset for the n-th allocation in O(1), so the
+// peak is the planned live set instead of what malloc accumulated.
+//
+// Replay is checked, never trusted: an allocation larger than planned, one
+// past the end of the plan or one whose slab range is still in use by a
+// live buffer falls back to malloc, and the run's trace then replaces the
+// plan (or widens it, when only sizes changed). Buffers alive at EndRun
+// are never put in the slab, since the slab is reused by the next run.
+class MemoryPlanner {
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  struct Stats {
+    size_t slab_bytes = 0;
+    size_t served = 0;    // allocations served from the slab
+    size_t fallback = 0;  // allocations of planned runs served by malloc
+    size_t plans = 0;
+  };
+
+  static MemoryPlanner& Instance();
+
+  // Fast check for runtime Allocate / Deallocate.
+  bool Active() const {
+    return active_.load(std::memory_order_acquire) || slab_live_ > 0;
+  }
+
+  void BeginRun(const std::string& key);
+  void EndRun();
+
+  void* Allocate(size_t size);
+  // Returns false if ptr was not allocated by the planner.
+  bool Deallocate(void* ptr);
+
+  Stats GetStats();
+  // Drops all plans and the slab (once no slab buffer is alive).
+  void Reset();
+
+ private:
+  static constexpr int64_t kNotFreed = INT64_MAX;
+
+  struct Plan {
+    std::vector<size_t> sizes;
+    std::vector<int64_t> starts;  // event clock of the allocation
+    std::vector<int64_t> ends;    // of the free, kNotFreed if it escapes
+    std::vector<int64_t> offsets;  // -1 for buffers left to malloc
+    // slots placed on overlapping addresses that must be dead before
+    // the slot is handed out
+    std::vector<std::vector<int>> conflicts;
+    size_t slab_bytes = 0;
+  };
+
+  MemoryPlanner() = default;
+
+  void AssignOffsets(Plan* plan);
+  void* ServeFromSlab(size_t size);
+  bool InSlab(const void* ptr) const {
+    const char* p = static_cast<const char*>(ptr);
+    return slab_ != nullptr && p >= slab_ && p < slab_ + slab_bytes_;
+  }
+
+  std::mutex mutex_;
+  std::atomic<bool> active_{false};
+  std::atomic<int64_t> slab_live_{0};
+
+  std::unordered_map<std::string, Plan> plans_;
+  char* slab_ = nullptr;
+  size_t slab_bytes_ = 0;
+
+  // the current run
+  Plan* plan_ = nullptr;  // nullptr while recording
+  std::string key_;
+  Plan trace_;
+  int64_t clock_ = 0;
+  bool diverged_ = false;
+  std::vector<bool> slot_live_;
+  std::unordered_map<void*, int> live_;  // slot of each buffer
+
+  Stats stats_;
+};
+
+}  // namespace custom_cpu
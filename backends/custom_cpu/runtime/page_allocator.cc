@@ -0,0 +1,117 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/page_allocator.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "runtime/runtime.h"
+
+namespace custom_cpu {
+
+namespace {
+
+bool LazyZeroEnabledByEnv() {
+  const char* value = std::getenv("CUSTOM_CPU_LAZY_ZERO");
+  return value == nullptr || std::strcmp(value, "0") != 0;
+}
+
+}  // namespace
+
+constexpr size_t PageAllocator::kMinBytes;
+
+PageAllocator::PageAllocator()
+    : enabled_(LazyZeroEnabledByEnv()),
+      page_size_(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {}
+
+PageAllocator& PageAllocator::Instance() {
+  // leaked on purpose: tensors may be freed after static destructors ran
+  static PageAllocator* allocator = new PageAllocator();
+  return *allocator;
+}
+
+void* PageAllocator::Allocate(size_t size) {
+  if (!enabled_ || size < kMinBytes) {
+    return nullptr;
+  }
+  void* data = mmap(nullptr,
+                    size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1,
+                    0);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  mappings_[reinterpret_cast<uintptr_t>(data)] = size;
+  return data;
+}
+
+bool PageAllocator::Deallocate(void* ptr) {
+  size_t size = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = mappings_.find(reinterpret_cast<uintptr_t>(ptr));
+    if (it == mappings_.end()) {
+      return false;
+    }
+    size = it->second;
+    mappings_.erase(it);
+  }
+  munmap(ptr, size);
+  return true;
+}
+
+bool PageAllocator::ZeroRange(void* ptr, size_t bytes) {
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t end = begin + bytes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = mappings_.upper_bound(begin);
+    if (it == mappings_.begin()) {
+      return false;
+    }
+    --it;
+    if (end > it->first + it->second) {
+      return false;
+    }
+  }
+  // whole pages only, a partial page may hold a neighbouring buffer
+  const uintptr_t page_begin =
+      (begin + page_size_ - 1) / page_size_ * page_size_;
+  const uintptr_t page_end = end / page_size_ * page_size_;
+  if (page_begin >= page_end) {
+    std::memset(ptr, 0, bytes);
+    return true;
+  }
+  std::memset(ptr, 0, page_begin - begin);
+  std::memset(reinterpret_cast<void*>(page_end), 0, end - page_end);
+  if (madvise(reinterpret_cast<void*>(page_begin),
+              page_end - page_begin,
+              MADV_DONTNEED) != 0) {
+    std::memset(reinterpret_cast<void*>(page_begin), 0, page_end - page_begin);
+  }
+  return true;
+}
+
+bool ZeroPages(void* ptr, size_t bytes) {
+  return PageAllocator::Instance().ZeroRange(ptr, bytes);
+}
+
+}  // namespace custom_cpu
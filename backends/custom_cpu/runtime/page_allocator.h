@@ -0,0 +1,62 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace custom_cpu {
+
+// Large device allocations as private anonymous mappings.
+//
+// Pages of such a mapping read as zero until first written, and
+// madvise(MADV_DONTNEED) turns written pages back into zero pages without
+// touching them. Zero-filling a whole-page range of a mapped allocation is
+// therefore one system call, the zeroing being done by the kernel at first
+// touch, page by page, on the thread that touches it. That is the thread
+// consuming the buffer, so with bound OpenMP threads (OMP_PROC_BIND) the
+// pages also land on its NUMA node.
+//
+// Allocations below kMinBytes stay with malloc. CUSTOM_CPU_LAZY_ZERO=0
+// turns the mappings off.
+class PageAllocator {
+ public:
+  static constexpr size_t kMinBytes = 4 << 20;
+
+  static PageAllocator& Instance();
+
+  // nullptr if `size` is below kMinBytes, mappings are off or mmap failed;
+  // the caller then uses malloc.
+  void* Allocate(size_t size);
+  // Returns false if ptr was not allocated here.
+  bool Deallocate(void* ptr);
+
+  // Zeroes [ptr, ptr + bytes): the whole pages by dropping them, the
+  // partial pages at both ends with memset. Returns false, writing
+  // nothing, if the range is not inside one mapping.
+  bool ZeroRange(void* ptr, size_t bytes);
+
+ private:
+  PageAllocator();
+
+  const bool enabled_;
+  const size_t page_size_;
+  std::mutex mutex_;
+  std::map<uintptr_t, size_t> mappings_;  // start -> length
+};
+
+}  // namespace custom_cpu
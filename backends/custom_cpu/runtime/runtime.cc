@@ -15,16 +15,26 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "paddle/phi/backends/device_ext.h"
+#include "runtime/memory_planner.h"
+#include "runtime/page_allocator.h"
+#include "runtime/runtime.h"
 
 #define MEMORY_FRACTION 0.5f
 
@@ -107,7 +117,16 @@ C_Status AsyncMemCpyP2P(const C_Device dst_device,
 }
 
 C_Status Allocate(const C_Device device, void **ptr, size_t size) {
-  auto data = malloc(size);
+  auto &planner = custom_cpu::MemoryPlanner::Instance();
+  void *data = nullptr;
+  if (planner.Active()) {
+    data = planner.Allocate(size);
+  } else {
+    data = custom_cpu::PageAllocator::Instance().Allocate(size);
+    if (data == nullptr) {
+      data = malloc(size);
+    }
+  }
   if (data) {
     *ptr = data;
     return C_SUCCESS;
@@ -118,6 +137,14 @@ C_Status Allocate(const C_Device device, void **ptr, size_t size) {
 }
 
 C_Status Deallocate(const C_Device device, void *ptr, size_t size) {
+  auto &planner = custom_cpu::MemoryPlanner::Instance();
+  if (planner.Active() && planner.Deallocate(ptr)) {
+    return C_SUCCESS;
+  }
+  if (size >= custom_cpu::PageAllocator::kMinBytes &&
+      custom_cpu::PageAllocator::Instance().Deallocate(ptr)) {
+    return C_SUCCESS;
+  }
   free(ptr);
   return C_SUCCESS;
 }
@@ -195,8 +222,171 @@ struct C_CCLComm_st {
   sem_t *sig_2;
   std::string sig_name;
   std::string sig_2_name;
+  // released by rank 0 once every rank reached a Barrier
+  std::vector<sem_t *> release;
+  std::vector<std::string> release_names;
+  // shared memory with one slot per rank for the data of a collective
+  std::string buf_name;
 };
 
+namespace {
+
+std::mutex comms_mutex;
+std::vector<C_CCLComm> comms;
+
+// Each rank blocks on its own semaphore, so a rank leaving one barrier
+// early cannot take the release meant for another rank.
+void Barrier(C_CCLComm comm) {
+  if (comm->rank == 0) {
+    for (size_t i = 1; i < comm->nranks; ++i) {
+      sem_wait(comm->sig);
+    }
+    for (size_t i = 1; i < comm->nranks; ++i) {
+      sem_post(comm->release[i]);
+    }
+  } else {
+    sem_post(comm->sig);
+    sem_wait(comm->release[comm->rank]);
+  }
+}
+
+size_t DataTypeSize(C_DataType data_type) {
+  switch (data_type) {
+    case BOOL:
+    case UINT8:
+    case INT8:
+      return 1;
+    case UINT16:
+    case INT16:
+    case FLOAT16:
+    case BFLOAT16:
+      return 2;
+    case UINT32:
+    case INT32:
+    case FLOAT32:
+      return 4;
+    case UINT64:
+    case INT64:
+    case FLOAT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+float HalfToFloat(uint16_t h) {
+  const uint32_t sign = (h & 0x8000u) << 16;
+  uint32_t exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ffu;
+  uint32_t bits;
+  if (exp == 0x1f) {
+    bits = sign | 0x7f800000u | (mant << 13);
+  } else if (exp != 0) {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  } else if (mant == 0) {
+    bits = sign;
+  } else {
+    // subnormal: normalize the mantissa
+    exp = 113;
+    while ((mant & 0x400u) == 0) {
+      mant <<= 1;
+      --exp;
+    }
+    bits = sign | (exp << 23) | ((mant & 0x3ffu) << 13);
+  }
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+uint16_t FloatToHalf(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000u;
+  const uint32_t abs = bits & 0x7fffffffu;
+  if (abs >= 0x7f800000u) {
+    return sign | 0x7c00u | (abs > 0x7f800000u ? 0x200u : 0);
+  }
+  if (abs >= 0x477ff000u) {
+    return sign | 0x7c00u;  // rounds past the largest half
+  }
+  if (abs < 0x38800000u) {
+    // subnormal half: let the float adder round at the 2^-24 ulp
+    float v;
+    memcpy(&v, &abs, sizeof(v));
+    return sign | static_cast<uint16_t>(std::nearbyint(v * 16777216.0f));
+  }
+  const uint32_t odd = (abs >> 13) & 1u;
+  return sign | static_cast<uint16_t>((abs - 0x38000000u + 0xfffu + odd) >> 13);
+}
+
+float Bfloat16ToFloat(uint16_t h) {
+  const uint32_t bits = static_cast<uint32_t>(h) << 16;
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+uint16_t FloatToBfloat16(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  if ((bits & 0x7fffffffu) > 0x7f800000u) {
+    return static_cast<uint16_t>((bits >> 16) | 0x40u);
+  }
+  return static_cast<uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+}
+
+template <typename T>
+T Combine(T a, T b, C_CCLReduceOp op) {
+  switch (op) {
+    case MAX:
+      return a > b ? a : b;
+    case MIN:
+      return a < b ? a : b;
+    case PRODUCT:
+      return a * b;
+    default:
+      return a + b;
+  }
+}
+
+// Reduces the slots of all ranks in rank order, so every rank computes
+// bitwise the same result. T is the storage type, AT the one reduced in.
+template <typename T, typename AT, typename Load, typename Store>
+void ReduceSlots(const char *slots,
+                 size_t nranks,
+                 size_t count,
+                 C_CCLReduceOp op,
+                 void *recv_buf,
+                 Load load,
+                 Store store) {
+  const size_t bytes = count * sizeof(T);
+  auto out = static_cast<T *>(recv_buf);
+  for (size_t i = 0; i < count; ++i) {
+    AT acc = load(reinterpret_cast<const T *>(slots)[i]);
+    for (size_t r = 1; r < nranks; ++r) {
+      acc = Combine(
+          acc, load(reinterpret_cast<const T *>(slots + r * bytes)[i]), op);
+    }
+    if (op == AVG) {
+      acc = acc / static_cast<AT>(nranks);
+    }
+    out[i] = store(acc);
+  }
+}
+
+template <typename T>
+void ReduceSlots(const char *slots,
+                 size_t nranks,
+                 size_t count,
+                 C_CCLReduceOp op,
+                 void *recv_buf) {
+  auto same = [](T v) { return v; };
+  ReduceSlots<T, T>(slots, nranks, count, op, recv_buf, same, same);
+}
+
+}  // namespace
+
 // for unittest
 C_Status XcclGetUniqueIdSize(size_t *sz) {
   *sz = sizeof(size_t);
@@ -216,28 +406,43 @@ C_Status XcclCommInitRank(size_t ranks,
                           C_CCLRootId *unique_id,
                           size_t rank,
                           C_CCLComm *comm) {
-  auto sig = sem_open(static_cast<char *>(unique_id->data), O_CREAT, 0644, 0);
-  auto sig_2 =
-      sem_open(static_cast<char *>(unique_id->data) + 1, O_CREAT, 0644, 0);
-  *comm =
-      new C_CCLComm_st({rank,
-                        ranks,
-                        sig,
-                        sig_2,
-                        std::string(static_cast<char *>(unique_id->data)),
-                        std::string(static_cast<char *>(unique_id->data) + 1)});
+  const std::string id(static_cast<char *>(unique_id->data));
+  auto sig = sem_open(id.c_str(), O_CREAT, 0644, 0);
+  auto sig_2 = sem_open(id.c_str() + 1, O_CREAT, 0644, 0);
+  *comm = new C_CCLComm_st({rank, ranks, sig, sig_2, id, id.substr(1)});
+  for (size_t i = 0; i < ranks; ++i) {
+    (*comm)->release_names.push_back(id + "_release_" + std::to_string(i));
+    (*comm)->release.push_back(
+        sem_open((*comm)->release_names.back().c_str(), O_CREAT, 0644, 0));
+  }
+  (*comm)->buf_name = id + "_buf";
+  std::lock_guard<std::mutex> lock(comms_mutex);
+  comms.push_back(*comm);
   return C_SUCCESS;
 }
 
 C_Status XcclDestroyComm(C_CCLComm comm) {
   if (comm) {
+    {
+      std::lock_guard<std::mutex> lock(comms_mutex);
+      comms.erase(std::remove(comms.begin(), comms.end(), comm), comms.end());
+    }
     sem_unlink(comm->sig_name.c_str());
     sem_unlink(comm->sig_2_name.c_str());
+    for (size_t i = 0; i < comm->release.size(); ++i) {
+      sem_close(comm->release[i]);
+      sem_unlink(comm->release_names[i].c_str());
+    }
+    shm_unlink(comm->buf_name.c_str());
     delete comm;
   }
   return C_SUCCESS;
 }
 
+// Every rank copies its buffer into its slot of a shared memory segment;
+// after a barrier each rank reduces all slots into its recv_buf, and a
+// second barrier keeps the slots from being overwritten by the next
+// collective while another rank still reads them.
 C_Status XcclAllReduce(void *send_buf,
                        void *recv_buf,
                        size_t count,
@@ -245,22 +450,92 @@ C_Status XcclAllReduce(void *send_buf,
                        C_CCLReduceOp op,
                        C_CCLComm comm,
                        C_Stream stream) {
-  sem_post(comm->sig);
-
-  if (comm->rank == 0) {
-    for (auto i = 0; i < comm->nranks; ++i) {
-      sem_wait(comm->sig);
-    }
-
-    for (auto i = 0; i < comm->nranks; ++i) {
-      sem_post(comm->sig_2);
+  const size_t bytes = count * DataTypeSize(data_type);
+  if (bytes == 0 && count > 0) {
+    return C_FAILED;
+  }
+  if (comm->nranks == 1 || bytes == 0) {
+    if (recv_buf != send_buf) {
+      memcpy(recv_buf, send_buf, bytes);
     }
+    return C_SUCCESS;
+  }
+  const size_t total = bytes * comm->nranks;
+  int fd = shm_open(comm->buf_name.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    return C_FAILED;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      (static_cast<size_t>(st.st_size) < total && ftruncate(fd, total) != 0)) {
+    close(fd);
+    return C_FAILED;
+  }
+  void *mapped =
+      mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return C_FAILED;
+  }
+  auto slots = static_cast<char *>(mapped);
+  memcpy(slots + comm->rank * bytes, send_buf, bytes);
+  Barrier(comm);
+
+  const size_t n = comm->nranks;
+  C_Status status = C_SUCCESS;
+  switch (data_type) {
+    case FLOAT32:
+      ReduceSlots<float>(slots, n, count, op, recv_buf);
+      break;
+    case FLOAT64:
+      ReduceSlots<double>(slots, n, count, op, recv_buf);
+      break;
+    case INT32:
+      ReduceSlots<int32_t>(slots, n, count, op, recv_buf);
+      break;
+    case INT64:
+      ReduceSlots<int64_t>(slots, n, count, op, recv_buf);
+      break;
+    case INT8:
+      ReduceSlots<int8_t>(slots, n, count, op, recv_buf);
+      break;
+    case BOOL:
+    case UINT8:
+      ReduceSlots<uint8_t>(slots, n, count, op, recv_buf);
+      break;
+    case FLOAT16:
+      ReduceSlots<uint16_t, float>(
+          slots, n, count, op, recv_buf, HalfToFloat, FloatToHalf);
+      break;
+    case BFLOAT16:
+      ReduceSlots<uint16_t, float>(
+          slots, n, count, op, recv_buf, Bfloat16ToFloat, FloatToBfloat16);
+      break;
+    default:
+      status = C_FAILED;
+      break;
   }
+  Barrier(comm);
+  munmap(mapped, total);
+  return status;
+}
 
-  sem_wait(comm->sig_2);
-  return C_SUCCESS;
+namespace custom_cpu {
+
+C_CCLComm DefaultComm() {
+  std::lock_guard<std::mutex> lock(comms_mutex);
+  return comms.empty() ? nullptr : comms.front();
 }
 
+C_Status AllReduceSum(C_CCLComm comm, double *data, size_t count) {
+  if (comm == nullptr || comm->nranks == 1) {
+    return C_SUCCESS;
+  }
+  return XcclAllReduce(data, data, count, FLOAT64, SUM, comm, nullptr);
+}
+
+}  // namespace custom_cpu
+
 C_Status XcclBroadcast(void *buf,
                        size_t count,
                        C_DataType data_type,
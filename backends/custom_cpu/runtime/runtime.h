@@ -0,0 +1,36 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+#include "paddle/phi/backends/device_ext.h"
+
+namespace custom_cpu {
+
+// The first XCCL communicator created in this process (the global group's),
+// for kernels, which are given no communicator. nullptr when there is none.
+C_CCLComm DefaultComm();
+
+// Sums `count` doubles in place over the ranks of `comm`. A null or
+// single-rank communicator leaves `data` as is.
+C_Status AllReduceSum(C_CCLComm comm, double* data, size_t count);
+
+// Zeroes `bytes` at `ptr` lazily when they lie in one page-mapped device
+// allocation (see page_allocator.h): the whole pages are dropped and read
+// as zero at first touch. Returns false, writing nothing, otherwise.
+bool ZeroPages(void* ptr, size_t bytes);
+
+}  // namespace custom_cpu
@@ -0,0 +1,145 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def adam_step(inputs, attributes):
+    param = inputs["Param"]
+    grad = inputs["Grad"]
+    moment1 = inputs["Moment1"]
+    moment2 = inputs["Moment2"]
+    lr = inputs["LearningRate"]
+    beta1_pow = inputs["Beta1Pow"]
+    beta2_pow = inputs["Beta2Pow"]
+
+    epsilon = attributes["epsilon"]
+    beta1 = attributes["beta1"]
+    beta2 = attributes["beta2"]
+
+    if attributes.get("with_decay", False):
+        lr = lr * attributes["lr_ratio"]
+        param = param - lr * attributes["coeff"] * param
+
+    moment1_out = beta1 * moment1 + (1 - beta1) * grad
+    moment2_out = beta2 * moment2 + (1 - beta2) * np.square(grad)
+    lr_t = lr * np.sqrt(1 - beta2_pow) / (1 - beta1_pow)
+    param_out = param - lr_t * (
+        moment1_out / (np.sqrt(moment2_out) + epsilon * np.sqrt(1 - beta2_pow))
+    )
+    return param_out, moment1_out, moment2_out
+
+
+class TestAdamOp(OpTest):
+    def setUp(self):
+        self.op_type = "adam"
+        self.init_attrs()
+        param = np.random.uniform(-1, 1, (102, 105)).astype("float32")
+        grad = np.random.uniform(-1, 1, (102, 105)).astype("float32")
+        moment1 = np.random.uniform(-1, 1, (102, 105)).astype("float32")
+        # The second moment is positive
+        moment2 = np.random.random((102, 105)).astype("float32")
+
+        beta1_pow = self.attrs["beta1"] ** 10
+        beta2_pow = self.attrs["beta2"] ** 10
+
+        self.inputs = {
+            "Param": param,
+            "Grad": grad,
+            "Moment1": moment1,
+            "Moment2": moment2,
+            "LearningRate": np.array([0.004]).astype("float32"),
+            "Beta1Pow": np.array([beta1_pow]).astype("float32"),
+            "Beta2Pow": np.array([beta2_pow]).astype("float32"),
+        }
+
+        param_out, moment1_out, moment2_out = adam_step(self.inputs, self.attrs)
+
+        self.outputs = {
+            "Moment1Out": moment1_out,
+            "Moment2Out": moment2_out,
+            "ParamOut": param_out,
+            "Beta1PowOut": np.array([beta1_pow]).astype("float32")
+            * self.attrs["beta1"],
+            "Beta2PowOut": np.array([beta2_pow]).astype("float32")
+            * self.attrs["beta2"],
+        }
+
+    def init_attrs(self):
+        self.attrs = {"epsilon": 1e-4, "beta1": 0.78, "beta2": 0.836}
+
+    def test_check_output(self):
+        self.check_output(atol=1e-5)
+
+
+class TestAdamWOp(TestAdamOp):
+    def setUp(self):
+        super().setUp()
+        self.op_type = "adamw"
+
+    def init_attrs(self):
+        self.attrs = {
+            "epsilon": 1e-4,
+            "beta1": 0.78,
+            "beta2": 0.836,
+            "coeff": 0.5,
+            "lr_ratio": 0.1,
+            "with_decay": True,
+        }
+
+
+class TestMultiTensorAdam(unittest.TestCase):
+    def run_adam(self, use_multi_tensor):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+        paddle.seed(10)
+        np.random.seed(10)
+        model = paddle.nn.Sequential(
+            paddle.nn.Linear(13, 37), paddle.nn.Linear(37, 5)
+        )
+        optimizer = paddle.optimizer.Adam(
+            learning_rate=0.01,
+            parameters=model.parameters(),
+            use_multi_tensor=use_multi_tensor,
+        )
+        for _ in range(3):
+            x = paddle.to_tensor(np.random.random((4, 13)).astype("float32"))
+            out = model(x)
+            out.mean().backward()
+            optimizer.step()
+            optimizer.clear_grad()
+        params = [p.numpy() for p in model.parameters()]
+        paddle.enable_static()
+        return params
+
+    def test_merged_adam(self):
+        for expect, actual in zip(self.run_adam(False), self.run_adam(True)):
+            np.testing.assert_allclose(expect, actual, rtol=1e-6, atol=1e-6)
+
+
+if __name__ == "__main__":
+    unittest.main()
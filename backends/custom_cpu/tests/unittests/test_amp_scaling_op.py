@@ -0,0 +1,195 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+import paddle.static.amp.amp_nn as amp_nn
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+# many small tensors and one above the parallel chunk size
+SHAPES = [[3], [17, 5], [1], [300, 200], [64]]
+
+
+def check_finite_and_unscale_wrapper(x, scale):
+    _, found_inf = amp_nn.check_finite_and_unscale(x, scale)
+    return (*x, found_inf)
+
+
+def update_loss_scaling_wrapper(
+    x,
+    found_inf,
+    prev_loss_scaling,
+    num_good_steps,
+    num_bad_steps,
+    incr_every_n_steps,
+    decr_every_n_nan_or_inf,
+    incr_ratio,
+    decr_ratio,
+    stop_update=False,
+):
+    amp_nn.update_loss_scaling(
+        x,
+        found_inf,
+        prev_loss_scaling,
+        num_good_steps,
+        num_bad_steps,
+        incr_every_n_steps,
+        decr_every_n_nan_or_inf,
+        incr_ratio,
+        decr_ratio,
+        stop_update,
+    )
+    return (*x, prev_loss_scaling, num_good_steps, num_bad_steps)
+
+
+class TestCheckFiniteAndUnscaleOp(OpTest):
+    def setUp(self):
+        self.op_type = "check_finite_and_unscale"
+        self.python_api = check_finite_and_unscale_wrapper
+        self.python_out_sig = ["out%d" % i for i in range(len(SHAPES))]
+        self.python_out_sig.append("FoundInfinite")
+        self.init_config()
+        xs = [np.random.uniform(-4, 4, s).astype(self.dtype) for s in SHAPES]
+        if self.bad_value is not None:
+            xs[3][123, 45] = self.bad_value
+        scale = np.array([1024.0], "float32")
+        self.inputs = {
+            "X": [("x%d" % i, x) for i, x in enumerate(xs)],
+            "Scale": scale,
+        }
+        self.outputs = {
+            "FoundInfinite": np.array([self.bad_value is not None]),
+            "Out": [
+                ("out%d" % i, (x.astype("float32") / scale).astype(self.dtype))
+                for i, x in enumerate(xs)
+            ],
+        }
+
+    def init_config(self):
+        self.dtype = "float32"
+        self.bad_value = None
+
+    def test_check_output(self):
+        if self.bad_value is None:
+            self.check_output(atol=1e-3 if self.dtype == "float16" else 1e-6)
+        else:
+            # the unscaled gradients are discarded on an inf or nan step
+            self.check_output(no_check_set=["Out"])
+
+
+class TestCheckFiniteAndUnscaleOpInf(TestCheckFiniteAndUnscaleOp):
+    def init_config(self):
+        self.dtype = "float32"
+        self.bad_value = np.inf
+
+
+class TestCheckFiniteAndUnscaleOpNan(TestCheckFiniteAndUnscaleOp):
+    def init_config(self):
+        self.dtype = "float32"
+        self.bad_value = np.nan
+
+
+class TestCheckFiniteAndUnscaleOpFp16(TestCheckFiniteAndUnscaleOp):
+    def init_config(self):
+        self.dtype = "float16"
+        self.bad_value = None
+
+
+class TestCheckFiniteAndUnscaleOpFp16Inf(TestCheckFiniteAndUnscaleOp):
+    def init_config(self):
+        self.dtype = "float16"
+        self.bad_value = -np.inf
+
+
+class TestUpdateLossScalingOp(OpTest):
+    def setUp(self):
+        self.op_type = "update_loss_scaling"
+        self.python_api = update_loss_scaling_wrapper
+        self.python_out_sig = ["out%d" % i for i in range(len(SHAPES))]
+        self.python_out_sig += ["LossScaling", "OutGoodSteps", "OutBadSteps"]
+        self.init_config()
+        xs = [np.random.uniform(-4, 4, s).astype("float32") for s in SHAPES]
+        self.inputs = {
+            "X": [("x%d" % i, x) for i, x in enumerate(xs)],
+            "FoundInfinite": np.array([self.found_inf]),
+            "PrevLossScaling": np.array([self.scaling], "float32"),
+            "InGoodSteps": np.array([self.good], "int32"),
+            "InBadSteps": np.array([self.bad], "int32"),
+        }
+        self.attrs = {
+            "incr_every_n_steps": 2,
+            "decr_every_n_nan_or_inf": 2,
+            "incr_ratio": 2.0,
+            "decr_ratio": 0.5,
+        }
+        # an inf or nan step zeroes every gradient
+        outs = [np.zeros_like(x) if self.found_inf else x for x in xs]
+        new_scaling, new_good, new_bad = self.expect
+        self.outputs = {
+            "Out": [("out%d" % i, out) for i, out in enumerate(outs)],
+            "LossScaling": np.array([new_scaling], "float32"),
+            "OutGoodSteps": np.array([new_good], "int32"),
+            "OutBadSteps": np.array([new_bad], "int32"),
+        }
+
+    def init_config(self):
+        self.found_inf = False
+        self.scaling, self.good, self.bad = 8.0, 0, 0
+        self.expect = (8.0, 1, 0)
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestUpdateLossScalingOpIncrease(TestUpdateLossScalingOp):
+    def init_config(self):
+        self.found_inf = False
+        self.scaling, self.good, self.bad = 8.0, 1, 0
+        self.expect = (16.0, 0, 0)
+
+
+class TestUpdateLossScalingOpBadStep(TestUpdateLossScalingOp):
+    def init_config(self):
+        self.found_inf = True
+        self.scaling, self.good, self.bad = 8.0, 1, 0
+        self.expect = (8.0, 0, 1)
+
+
+class TestUpdateLossScalingOpDecrease(TestUpdateLossScalingOp):
+    def init_config(self):
+        self.found_inf = True
+        self.scaling, self.good, self.bad = 8.0, 0, 1
+        self.expect = (4.0, 0, 0)
+
+
+class TestUpdateLossScalingOpClampAtOne(TestUpdateLossScalingOp):
+    def init_config(self):
+        self.found_inf = True
+        self.scaling, self.good, self.bad = 1.5, 0, 1
+        self.expect = (1.0, 0, 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
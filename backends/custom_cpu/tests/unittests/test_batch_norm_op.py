@@ -0,0 +1,358 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def channel_axes(x, data_format):
+    channel = x.ndim - 1 if data_format.endswith("C") else 1
+    axes = tuple(i for i in range(x.ndim) if i != channel)
+    shape = [1] * x.ndim
+    shape[channel] = -1
+    return axes, shape
+
+
+def ref_batch_norm_train(x, scale, bias, eps, data_format):
+    axes, shape = channel_axes(x, data_format)
+    x = x.astype("float64")
+    mean = x.mean(axis=axes)
+    var = x.var(axis=axes)
+    x_hat = (x - mean.reshape(shape)) / np.sqrt(var.reshape(shape) + eps)
+    return x_hat * scale.reshape(shape) + bias.reshape(shape), mean, var
+
+
+def ref_batch_norm_grad(x, dy, scale, eps, data_format):
+    axes, shape = channel_axes(x, data_format)
+    x = x.astype("float64")
+    dy = dy.astype("float64")
+    count = x.size // scale.size
+    mean = x.mean(axis=axes).reshape(shape)
+    inv_std = 1.0 / np.sqrt(x.var(axis=axes).reshape(shape) + eps)
+    x_hat = (x - mean) * inv_std
+    d_bias = dy.sum(axis=axes)
+    d_scale = (dy * x_hat).sum(axis=axes)
+    dx = (
+        scale.reshape(shape)
+        * inv_std
+        * (dy - d_bias.reshape(shape) / count - x_hat * d_scale.reshape(shape) / count)
+    )
+    return dx, d_scale, d_bias
+
+
+# Rank r of two normalizes rows SPLIT[r]:SPLIT[r + 1] of the batch with
+# SyncBatchNorm and saves what it computed, with the parameter grads averaged
+# over the ranks the way data-parallel training does.
+SYNC_WORKER = """
+import sys
+import numpy as np
+import paddle
+import paddle.distributed as dist
+
+SPLIT = [0, 2, 6]
+dist.init_parallel_env()
+rank = dist.get_rank()
+np.random.seed(2024)
+x = np.random.uniform(-2, 3, [6, 4, 3, 5]).astype("float32")
+dy = np.random.uniform(-1, 1, x.shape).astype("float32")
+rows = slice(SPLIT[rank], SPLIT[rank + 1])
+layer = paddle.nn.SyncBatchNorm(4, epsilon=1e-5)
+layer.train()
+x_t = paddle.to_tensor(x[rows], stop_gradient=False)
+y = layer(x_t)
+y.backward(paddle.to_tensor(dy[rows]))
+local_scale = layer.weight.grad.numpy()
+local_bias = layer.bias.grad.numpy()
+for param in [layer.weight, layer.bias]:
+    dist.all_reduce(param.grad)
+    param.grad.scale_(1.0 / dist.get_world_size())
+np.savez(
+    "%s/rank%d.npz" % (sys.argv[1], rank),
+    x=x,
+    dy=dy,
+    y=y.numpy(),
+    dx=x_t.grad.numpy(),
+    local_scale=local_scale,
+    local_bias=local_bias,
+    d_scale=layer.weight.grad.numpy(),
+    d_bias=layer.bias.grad.numpy(),
+)
+"""
+
+
+def batch_norm_wrapper(
+    X,
+    Mean,
+    Variance,
+    Scale,
+    Bias,
+    is_test=False,
+    momentum=0.9,
+    epsilon=1e-5,
+    data_layout="NCHW",
+    use_global_stats=False,
+    trainable_statistics=False,
+):
+    return paddle._C_ops.batch_norm(
+        X,
+        Mean,
+        Variance,
+        Scale,
+        Bias,
+        is_test,
+        momentum,
+        epsilon,
+        data_layout,
+        use_global_stats,
+        trainable_statistics,
+    )
+
+
+class TestBatchNormOpTraining(OpTest):
+    def setUp(self):
+        self.op_type = "batch_norm"
+        self.python_api = batch_norm_wrapper
+        self.python_out_sig = ["Y"]
+        self.init_config()
+        eps, m = 1e-5, 0.9
+        x = np.random.uniform(-2, 3, self.shape)
+        c = self.shape[-1] if self.data_layout.endswith("C") else self.shape[1]
+        scale = np.random.uniform(0.5, 1.5, c)
+        bias = np.random.uniform(-1, 1, c)
+        running_mean = np.random.uniform(-1, 1, c)
+        running_var = np.random.uniform(0.5, 1.5, c)
+        self.inputs = {
+            "X": x,
+            "Scale": scale,
+            "Bias": bias,
+            "Mean": running_mean,
+            "Variance": running_var,
+        }
+        self.attrs = {
+            "epsilon": eps,
+            "momentum": m,
+            "is_test": self.is_test,
+            "data_layout": self.data_layout,
+            "use_global_stats": False,
+            "trainable_statistics": False,
+        }
+        if self.is_test:
+            mean, var = running_mean, running_var
+            _, shape = channel_axes(x, self.data_layout)
+            y = (x - mean.reshape(shape)) / np.sqrt(var.reshape(shape) + eps)
+            y = y * scale.reshape(shape) + bias.reshape(shape)
+            mean_out, var_out = running_mean, running_var
+        else:
+            y, mean, var = ref_batch_norm_train(
+                x, scale, bias, eps, self.data_layout
+            )
+            mean_out = running_mean * m + mean * (1 - m)
+            var_out = running_var * m + var * (1 - m)
+        self.outputs = {
+            "Y": y,
+            "MeanOut": mean_out,
+            "VarianceOut": var_out,
+            "SavedMean": mean,
+            "SavedVariance": 1 / np.sqrt(var + eps),
+        }
+
+    def init_config(self):
+        self.shape = [4, 6, 5, 7]
+        self.data_layout = "NCHW"
+        self.is_test = False
+
+    def test_check_output(self):
+        self.check_output(atol=1e-6)
+
+    def test_check_grad(self):
+        if not self.is_test:
+            self.check_grad(["X", "Scale", "Bias"], "Y")
+
+
+class TestBatchNormOpTrainingNHWC(TestBatchNormOpTraining):
+    def init_config(self):
+        self.shape = [4, 5, 7, 6]
+        self.data_layout = "NHWC"
+        self.is_test = False
+
+
+class TestBatchNormOpTraining2D(TestBatchNormOpTraining):
+    def init_config(self):
+        self.shape = [64, 33]
+        self.data_layout = "NCHW"
+        self.is_test = False
+
+
+class TestBatchNormOpInference(TestBatchNormOpTraining):
+    def init_config(self):
+        self.shape = [2, 4, 3, 5]
+        self.data_layout = "NCHW"
+        self.is_test = True
+
+
+class TestBatchNormOpInferenceNHWC(TestBatchNormOpTraining):
+    def init_config(self):
+        self.shape = [2, 3, 5, 4]
+        self.data_layout = "NHWC"
+        self.is_test = True
+
+
+class TestBatchNormOp(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+        self.eps = 1e-5
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def to_tensor(self, x, stop_gradient=True):
+        return paddle.to_tensor(x, place=self.place, stop_gradient=stop_gradient)
+
+    def test_train_large_mean(self):
+        # a mean far from zero loses the variance in a sum-of-squares pass
+        x_shape = [8, 3, 16, 16]
+        x = (np.random.rand(*x_shape) + 1e4).astype("float32")
+        scale = np.ones(3, "float32")
+        bias = np.zeros(3, "float32")
+        y = paddle.nn.functional.batch_norm(
+            self.to_tensor(x),
+            self.to_tensor(np.zeros(3, "float32")),
+            self.to_tensor(np.ones(3, "float32")),
+            weight=self.to_tensor(scale),
+            bias=self.to_tensor(bias),
+            training=True,
+            epsilon=self.eps,
+        )
+        expect, _, _ = ref_batch_norm_train(x, scale, bias, self.eps, "NCHW")
+        np.testing.assert_allclose(y.numpy(), expect, rtol=1e-2, atol=1e-2)
+
+    def test_sync_batch_norm_single_process(self):
+        # without a communicator the statistics are those of the local batch
+        paddle.set_device("custom_cpu")
+        x = np.random.uniform(-2, 3, [4, 6, 5, 7]).astype("float32")
+        layer = paddle.nn.SyncBatchNorm(6, epsilon=self.eps)
+        layer.train()
+        x_t = self.to_tensor(x, stop_gradient=False)
+        y = layer(x_t)
+        y.sum().backward()
+        scale = np.ones(6, "float32")
+        expect, _, _ = ref_batch_norm_train(x, scale, 0 * scale, self.eps, "NCHW")
+        np.testing.assert_allclose(y.numpy(), expect, rtol=1e-4, atol=1e-4)
+        dx, _, _ = ref_batch_norm_grad(x, np.ones_like(x), scale, self.eps, "NCHW")
+        np.testing.assert_allclose(x_t.grad.numpy(), dx, rtol=1e-4, atol=1e-4)
+
+    def test_sync_batch_norm_two_processes(self):
+        # the statistics and x grads are those of the whole batch, which the
+        # two ranks split unevenly; each rank's parameter grads cover its own
+        # rows, so after averaging they are the whole-batch grads over two
+        work_dir = tempfile.mkdtemp()
+        worker = os.path.join(work_dir, "worker.py")
+        with open(worker, "w") as f:
+            f.write(SYNC_WORKER)
+        env = dict(os.environ, PADDLE_XCCL_BACKEND="custom_cpu")
+        subprocess.check_call(
+            [
+                sys.executable,
+                "-m",
+                "paddle.distributed.launch",
+                "--devices",
+                "0,1",
+                "--log_dir",
+                os.path.join(work_dir, "log"),
+                worker,
+                work_dir,
+            ],
+            env=env,
+        )
+        ranks = [np.load(os.path.join(work_dir, "rank%d.npz" % r)) for r in range(2)]
+        x, dy = ranks[0]["x"], ranks[0]["dy"]
+        scale = np.ones(4, "float32")
+        expect, _, _ = ref_batch_norm_train(x, scale, 0 * scale, self.eps, "NCHW")
+        dx, d_scale, d_bias = ref_batch_norm_grad(x, dy, scale, self.eps, "NCHW")
+        y = np.concatenate([r["y"] for r in ranks])
+        np.testing.assert_allclose(y, expect, rtol=1e-4, atol=1e-4)
+        grad = np.concatenate([r["dx"] for r in ranks])
+        np.testing.assert_allclose(grad, dx, rtol=1e-4, atol=1e-4)
+        local_scale = sum(r["local_scale"] for r in ranks)
+        local_bias = sum(r["local_bias"] for r in ranks)
+        np.testing.assert_allclose(local_scale, d_scale, rtol=1e-4, atol=1e-4)
+        np.testing.assert_allclose(local_bias, d_bias, rtol=1e-4, atol=1e-4)
+        for r in ranks:
+            np.testing.assert_allclose(r["d_scale"], d_scale / 2, rtol=1e-4, atol=1e-4)
+            np.testing.assert_allclose(r["d_bias"], d_bias / 2, rtol=1e-4, atol=1e-4)
+
+    def check_low_precision(self, dtype, tol):
+        # float16 / bfloat16 data with float32 scale, bias and statistics
+        shape = [4, 6, 5, 7]
+        x = np.random.uniform(-2, 3, shape).astype("float32")
+        dy = np.random.uniform(-1, 1, shape).astype("float32")
+        scale = np.random.uniform(0.5, 1.5, 6).astype("float32")
+        bias = np.random.uniform(-1, 1, 6).astype("float32")
+        x_t = self.to_tensor(x).astype(dtype)
+        x_t.stop_gradient = False
+        scale_t = self.to_tensor(scale, stop_gradient=False)
+        bias_t = self.to_tensor(bias, stop_gradient=False)
+        y = paddle.nn.functional.batch_norm(
+            x_t,
+            self.to_tensor(np.zeros(6, "float32")),
+            self.to_tensor(np.ones(6, "float32")),
+            weight=scale_t,
+            bias=bias_t,
+            training=True,
+            epsilon=self.eps,
+        )
+        self.assertEqual(y.dtype, x_t.dtype)
+        y.backward(self.to_tensor(dy).astype(dtype))
+
+        # the reference sees the same rounded inputs
+        x16 = x_t.astype("float32").numpy()
+        dy16 = self.to_tensor(dy).astype(dtype).astype("float32").numpy()
+        expect, _, _ = ref_batch_norm_train(x16, scale, bias, self.eps, "NCHW")
+        np.testing.assert_allclose(
+            y.astype("float32").numpy(), expect, rtol=tol, atol=tol
+        )
+        dx, d_scale, d_bias = ref_batch_norm_grad(x16, dy16, scale, self.eps, "NCHW")
+        np.testing.assert_allclose(
+            x_t.grad.astype("float32").numpy(), dx, rtol=tol, atol=tol
+        )
+        np.testing.assert_allclose(scale_t.grad.numpy(), d_scale, rtol=1e-3, atol=1e-3)
+        np.testing.assert_allclose(bias_t.grad.numpy(), d_bias, rtol=1e-3, atol=1e-3)
+
+    def test_train_float16(self):
+        self.check_low_precision("float16", 1e-2)
+
+    def test_train_bfloat16(self):
+        self.check_low_precision("bfloat16", 5e-2)
+
+
+if __name__ == "__main__":
+    unittest.main()
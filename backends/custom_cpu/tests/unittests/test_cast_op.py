@@ -21,7 +21,7 @@ import paddle
 import paddle.base.core as core
 import paddle.base as base
 from paddle.base import Program, program_guard
-from op_test import OpTest, convert_uint16_to_float, convert_float_to_uint16
+from op_test import OpTest, convert_uint16_to_float
 
 paddle.enable_static()
 
@@ -33,6 +33,11 @@ def get_places(self):
 OpTest._get_places = get_places
 
 
+def convert_float_to_bf16_rne(x):
+    u = x.astype("float32").view(np.uint32).astype(np.uint64)
+    return ((u + 0x7FFF + ((u >> 16) & 1)) >> 16).astype(np.uint16)
+
+
 class TestCastOpFp32ToFp64(OpTest):
     def setUp(self):
         ipt = np.random.random(size=[10, 10])
@@ -103,7 +108,7 @@ class TestCastOpFp32ToBf16(OpTest):
     def setUp(self):
         ipt = np.random.random(size=[10, 10]).astype("float32")
         self.inputs = {"X": ipt}
-        self.outputs = {"Out": convert_float_to_uint16(ipt)}
+        self.outputs = {"Out": convert_float_to_bf16_rne(ipt)}
         self.attrs = {
             "in_dtype": int(core.VarDesc.VarType.FP32),
             "out_dtype": int(core.VarDesc.VarType.BF16),
@@ -125,6 +130,73 @@ class TestCastOpError(unittest.TestCase):
             self.assertRaises(TypeError, paddle.cast, x1, "int32")
 
 
+class TestCastConversions(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def cast(self, x, dtype):
+        return paddle.cast(paddle.to_tensor(x, place=self.place), dtype).numpy()
+
+    def test_float_to_int_saturates(self):
+        x = np.array([np.nan, 1e10, -1e10, 127.5, -128.9, 300, -3.7], "float32")
+        np.testing.assert_array_equal(
+            self.cast(x, "int8"), [0, 127, -128, 127, -128, 127, -3]
+        )
+        np.testing.assert_array_equal(
+            self.cast(x, "uint8"), [0, 255, 0, 127, 0, 255, 0]
+        )
+        np.testing.assert_array_equal(
+            self.cast(x, "int32"),
+            [0, 2**31 - 1, -(2**31), 127, -128, 300, -3],
+        )
+
+    def test_int64_keeps_precision(self):
+        x = np.array([2**40 + 1, -(2**35) - 3, 7], "int64")
+        np.testing.assert_array_equal(self.cast(x, "float64"), x.astype("float64"))
+        np.testing.assert_array_equal(self.cast(x, "int32"), x.astype("int32"))
+
+    def test_large_half_round_trip(self):
+        # above the parallel grain, every element rounds to nearest even
+        x = np.random.uniform(-7e4, 7e4, [1 << 21]).astype("float32")
+        x[:4] = [np.inf, -np.inf, 6e-8, -1e-7]
+        half = self.cast(x, "float16")
+        np.testing.assert_array_equal(half, x.astype("float16"))
+        back = self.cast(half, "float32")
+        np.testing.assert_array_equal(back, half.astype("float32"))
+        bf16 = paddle.cast(paddle.to_tensor(x, place=self.place), "bfloat16")
+        np.testing.assert_array_equal(
+            bf16.numpy().view(np.uint16), convert_float_to_bf16_rne(x)
+        )
+
+    def test_nan_payload(self):
+        # NaNs are quieted and keep the top of their payload on every path
+        bits = np.array([0x7FC12345, 0xFFE00000, 0x7F801000, 0x7FFFFFFF], "uint32")
+        x = np.tile(bits.view("float32"), 1024)
+        half = self.cast(x, "float16").view(np.uint16)
+        np.testing.assert_array_equal(
+            half, np.tile(np.array([0x7E09, 0xFF00, 0x7E00, 0x7FFF], "uint16"), 1024)
+        )
+        bf16 = paddle.cast(paddle.to_tensor(x, place=self.place), "bfloat16")
+        np.testing.assert_array_equal(
+            bf16.numpy().view(np.uint16),
+            np.tile(np.array([0x7FC1, 0xFFE0, 0x7FC0, 0x7FFF], "uint16"), 1024),
+        )
+
+    def test_to_bool(self):
+        x = np.array([0.0, -0.0, 0.5, np.nan, -2.0], "float32")
+        np.testing.assert_array_equal(
+            self.cast(x, "bool"), [False, False, True, True, True]
+        )
+        np.testing.assert_array_equal(
+            self.cast(x.astype("float16"), "bool"), [False, False, True, True, True]
+        )
+
+
 if __name__ == "__main__":
     paddle.enable_static()
     unittest.main()
@@ -0,0 +1,237 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle import _C_ops
+from paddle.base import core
+
+paddle.enable_static()
+
+for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+    if lib.endswith(".so"):
+        paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+            lib
+        )
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def squared_l2_norm_wrapper(x):
+    return _C_ops.squared_l2_norm(x)
+
+
+def clip_by_norm_wrapper(x, max_norm):
+    return _C_ops.clip_by_norm(x, max_norm)
+
+
+def coalesce_tensor_wrapper(
+    Input,
+    datatype=core.VarDesc.VarType.FP32,
+    copy_data=False,
+    set_constant=False,
+    persist_output=False,
+    constant=0.0,
+    use_align=True,
+    align_size=-1,
+    user_defined_size_of_dtype=-1,
+    concated_shapes=[],
+    concated_ranks=[],
+):
+    if datatype == int(core.VarDesc.VarType.FP32):
+        datatype = core.VarDesc.VarType.FP32
+    return _C_ops.coalesce_tensor(
+        Input,
+        datatype,
+        copy_data,
+        set_constant,
+        persist_output,
+        constant,
+        use_align,
+        align_size,
+        user_defined_size_of_dtype,
+        concated_shapes,
+        concated_ranks,
+    )
+
+
+class TestSquaredL2NormOp(OpTest):
+    def setUp(self):
+        self.op_type = "squared_l2_norm"
+        self.python_api = squared_l2_norm_wrapper
+        self.init_config()
+        x = np.random.uniform(-1, 1, self.shape).astype("float32")
+        x[np.abs(x) < 0.01] = 0.1
+        self.inputs = {"X": x}
+        self.outputs = {"Out": np.array([np.sum(x.astype("float64") ** 2)])}
+
+    def init_config(self):
+        self.shape = (13, 19)
+        self.check_gradient = True
+
+    def test_check_output(self):
+        self.check_output(atol=1e-3)
+
+    def test_check_grad(self):
+        if self.check_gradient:
+            self.check_grad(["X"], "Out")
+
+
+class TestSquaredL2NormOpLarge(TestSquaredL2NormOp):
+    def init_config(self):
+        # blocked, parallel partial sums
+        self.shape = (1 << 21,)
+        self.check_gradient = False
+
+
+class TestClipByNormOp(OpTest):
+    def setUp(self):
+        self.op_type = "clip_by_norm"
+        self.python_api = clip_by_norm_wrapper
+        self.init_config()
+        x = np.random.uniform(-1, 1, self.shape).astype("float32")
+        norm = np.sqrt(np.sum(x.astype("float64") ** 2))
+        out = x * self.max_norm / norm if norm > self.max_norm else x
+        self.inputs = {"X": x}
+        self.attrs = {"max_norm": self.max_norm}
+        self.outputs = {"Out": out}
+
+    def init_config(self):
+        self.shape = (500, 300)
+        self.max_norm = 10.0
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestClipByNormOpNoClip(TestClipByNormOp):
+    def init_config(self):
+        self.shape = (500, 300)
+        self.max_norm = 1e6
+
+
+class TestClipByNormOpSmall(TestClipByNormOp):
+    def init_config(self):
+        self.shape = (16, 16)
+        self.max_norm = 0.1
+
+
+class TestCoalesceTensorOp(OpTest):
+    def setUp(self):
+        self.op_type = "coalesce_tensor"
+        self.python_api = coalesce_tensor_wrapper
+        self.init_config()
+        xs = [np.random.uniform(-1, 1, s).astype("float32") for s in self.shapes]
+        self.inputs = {"Input": [("x%d" % i, x) for i, x in enumerate(xs)]}
+        self.attrs = {
+            "copy_data": not self.set_constant,
+            "set_constant": self.set_constant,
+            "constant": self.constant,
+            "use_align": True,
+            "dtype": int(core.VarDesc.VarType.FP32),
+        }
+        # every tensor is padded to 512 bytes; the padding is zero unless
+        # the whole buffer is set to the constant
+        fill = self.constant if self.set_constant else 0.0
+        slots, outs = [], []
+        for x in xs:
+            value = np.full_like(x, fill) if self.set_constant else x
+            slot = np.full(-(-x.size // 128) * 128, fill, "float32")
+            slot[: x.size] = value.ravel()
+            slots.append(slot)
+            outs.append(value)
+        self.outputs = {
+            "Output": [("out%d" % i, o) for i, o in enumerate(outs)],
+            "FusedOutput": np.concatenate(slots),
+        }
+
+    def init_config(self):
+        self.shapes = [[3], [17, 5], [1], [300, 200], [64]]
+        self.set_constant = False
+        self.constant = 0.0
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestCoalesceTensorOpSetConstant(TestCoalesceTensorOp):
+    def init_config(self):
+        self.shapes = [[20, 3], [1, 1], [129]]
+        self.set_constant = True
+        self.constant = 0.5
+
+
+class TestClipByNormOps(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def to_tensor(self, x, stop_gradient=True):
+        return paddle.to_tensor(x, place=self.place, stop_gradient=stop_gradient)
+
+    def grads(self):
+        shapes = [[3], [17, 5], [300, 200], [1 << 20], [64]]
+        return [np.random.uniform(-1, 1, s).astype("float32") for s in shapes]
+
+    def test_clip_grad_by_global_norm(self):
+        grads = self.grads()
+        norm = np.sqrt(sum(np.sum(g.astype("float64") ** 2) for g in grads))
+        tensors = [self.to_tensor(g) for g in grads]
+        outs = core.eager._run_custom_op("clip_by_global_norm", tensors, 5.0)
+        np.testing.assert_allclose(outs[-1].numpy().reshape([]), norm, rtol=1e-6)
+        for g, t in zip(grads, tensors):
+            np.testing.assert_allclose(t.numpy(), g * 5.0 / norm, rtol=1e-5)
+
+    def test_coalesce_tensor(self):
+        grads = self.grads()
+        tensors = [self.to_tensor(g) for g in grads]
+        outs, fused = _C_ops.coalesce_tensor(
+            tensors,
+            paddle.float32,
+            True,
+            False,
+            False,
+            0.0,
+            True,
+            -1,
+            -1,
+            [],
+            [],
+        )
+        for g, out in zip(grads, outs):
+            np.testing.assert_array_equal(out.numpy(), g)
+        # the alignment padding is zero, the fused buffer has the same norm
+        norm = np.sqrt(sum(np.sum(g.astype("float64") ** 2) for g in grads))
+        fused_norm = np.sqrt(np.sum(fused.numpy().astype("float64") ** 2))
+        np.testing.assert_allclose(fused_norm, norm, rtol=1e-6)
+        core.eager._run_custom_op("clip_by_global_norm", [fused], 1.0)
+        for g, out in zip(grads, outs):
+            np.testing.assert_allclose(out.numpy(), g / norm, rtol=1e-5)
+
+
+if __name__ == "__main__":
+    unittest.main()
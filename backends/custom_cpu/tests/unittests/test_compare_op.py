@@ -78,6 +78,30 @@ for _type_name in {"float32", "float64", "int32", "int64"}:
     create_test_class("not_equal", _type_name, lambda _a, _b: _a != _b)
 
 
+def create_axis_test_class(op_type, callback):
+    # Y is placed at an explicit axis of the full-rank X
+    class AxisCls(op_test.OpTest):
+        def setUp(self):
+            a = numpy.random.random(size=(2, 3, 4, 5)).astype("float32")
+            b = numpy.random.random(size=(3, 4)).astype("float32")
+            self.python_api = eval("paddle." + op_type)
+            self.inputs = {"X": a, "Y": b}
+            self.attrs = {"axis": 1}
+            self.outputs = {"Out": callback(a, b.reshape(1, 3, 4, 1))}
+            self.op_type = op_type
+
+        def test_output(self):
+            self.check_output(check_eager=False)
+
+    cls_name = "{0}_axis".format(op_type)
+    AxisCls.__name__ = cls_name
+    globals()[cls_name] = AxisCls
+
+
+create_axis_test_class("less_than", lambda _a, _b: _a < _b)
+create_axis_test_class("not_equal", lambda _a, _b: _a != _b)
+
+
 def create_paddle_case(op_type, callback):
     class PaddleCls(unittest.TestCase):
         def setUp(self):
@@ -0,0 +1,300 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle import _C_ops
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def np_scan(x, axis, exclusive, reverse, ufunc):
+    x = x.astype("float64")
+    if reverse:
+        x = np.flip(x, axis)
+    out = ufunc.accumulate(x, axis=axis)
+    if exclusive:
+        value = -np.inf if ufunc is np.logaddexp else ufunc.identity
+        identity = np.full_like(np.take(out, [0], axis=axis), value)
+        out = np.concatenate([identity, np.delete(out, -1, axis=axis)], axis=axis)
+    if reverse:
+        out = np.flip(out, axis)
+    return out
+
+
+def cumprod_wrapper(x, dim=-1, exclusive=False, reverse=False):
+    return _C_ops.cumprod(x, dim, exclusive, reverse)
+
+
+class TestCumsumOp(OpTest):
+    def setUp(self):
+        self.init_op()
+        self.init_config()
+        x = self.make_input()
+        self.inputs = {"X": x}
+        self.attrs = {
+            "axis": self.axis,
+            "flatten": self.flatten,
+            "exclusive": self.exclusive,
+            "reverse": self.reverse,
+        }
+        if self.flatten:
+            x, axis = x.ravel(), 0
+        else:
+            axis = self.axis
+        out = np_scan(x, axis, self.exclusive, self.reverse, self.ufunc)
+        self.outputs = {"Out": out.astype(self.dtype)}
+
+    def init_op(self):
+        self.op_type = "cumsum"
+        self.python_api = paddle.cumsum
+        self.ufunc = np.add
+
+    def make_input(self):
+        return np.random.uniform(-1, 1, self.shape).astype(self.dtype)
+
+    def init_config(self):
+        self.shape = (3, 77, 30)
+        self.axis = 1
+        self.flatten = False
+        self.exclusive = False
+        self.reverse = False
+        self.dtype = "float64"
+        self.check_gradient = True
+
+    def test_check_output(self):
+        self.check_output(atol=2e-3 if self.dtype == "float32" else 1e-7)
+
+    def test_check_grad(self):
+        if self.check_gradient:
+            self.check_grad(["X"], "Out")
+
+
+class TestCumsumOpExclusive(TestCumsumOp):
+    def init_config(self):
+        self.shape = (3, 77, 30)
+        self.axis = -1
+        self.flatten = False
+        self.exclusive = True
+        self.reverse = False
+        self.dtype = "float64"
+        self.check_gradient = True
+
+
+class TestCumsumOpReverse(TestCumsumOp):
+    def init_config(self):
+        self.shape = (3, 77, 30)
+        self.axis = 0
+        self.flatten = False
+        self.exclusive = False
+        self.reverse = True
+        self.dtype = "float64"
+        self.check_gradient = True
+
+
+class TestCumsumOpExclusiveReverse(TestCumsumOp):
+    def init_config(self):
+        self.shape = (3, 77, 30)
+        self.axis = 1
+        self.flatten = False
+        self.exclusive = True
+        self.reverse = True
+        self.dtype = "float64"
+        self.check_gradient = True
+
+
+class TestCumsumOpLongRow(TestCumsumOp):
+    def init_config(self):
+        # one row long enough for the three phase parallel scan
+        self.shape = (1 << 20,)
+        self.axis = 0
+        self.flatten = False
+        self.exclusive = True
+        self.reverse = True
+        self.dtype = "float32"
+        self.check_gradient = False
+
+
+class TestCumsumOpManyRows(TestCumsumOp):
+    def init_config(self):
+        self.shape = (64, 5000)
+        self.axis = -1
+        self.flatten = False
+        self.exclusive = False
+        self.reverse = False
+        self.dtype = "float32"
+        self.check_gradient = False
+
+
+class TestCumsumOpInt64Flatten(TestCumsumOp):
+    def make_input(self):
+        return np.random.randint(-100, 100, self.shape).astype(self.dtype)
+
+    def init_config(self):
+        self.shape = (6, 7, 8)
+        self.axis = -1
+        self.flatten = True
+        self.exclusive = False
+        self.reverse = False
+        self.dtype = "int64"
+        self.check_gradient = False
+
+
+class TestCumprodOp(TestCumsumOp):
+    def setUp(self):
+        self.op_type = "cumprod"
+        self.python_api = cumprod_wrapper
+        self.init_config()
+        x = np.random.uniform(0.5, 1.5, self.shape)
+        # zeros take the division-free path of the gradient
+        x[1, 7, :] = 0.0
+        x[3, 20, 2] = 0.0
+        self.inputs = {"X": x}
+        self.attrs = {
+            "dim": self.axis,
+            "exclusive": self.exclusive,
+            "reverse": self.reverse,
+        }
+        out = np_scan(x, self.axis, self.exclusive, self.reverse, np.multiply)
+        self.outputs = {"Out": out}
+
+    def init_config(self):
+        self.shape = (5, 40, 6)
+        self.axis = 1
+        self.flatten = False
+        self.exclusive = False
+        self.reverse = False
+        self.dtype = "float64"
+        self.check_gradient = True
+
+
+class TestCumprodOpExclusiveReverse(TestCumprodOp):
+    def init_config(self):
+        self.shape = (5, 40, 6)
+        self.axis = -1
+        self.flatten = False
+        self.exclusive = True
+        self.reverse = True
+        self.dtype = "float64"
+        self.check_gradient = True
+
+
+class TestLogcumsumexpOp(TestCumsumOp):
+    def init_op(self):
+        self.op_type = "logcumsumexp"
+        self.python_api = paddle.logcumsumexp
+        self.ufunc = np.logaddexp
+
+    def make_input(self):
+        return np.random.uniform(-20, 20, self.shape).astype(self.dtype)
+
+    def init_config(self):
+        self.shape = (4, 3000)
+        self.axis = -1
+        self.flatten = False
+        self.exclusive = False
+        self.reverse = False
+        self.dtype = "float32"
+        self.check_gradient = False
+
+    def test_check_output(self):
+        self.check_output(atol=1e-4, equal_nan=True)
+
+
+class TestLogcumsumexpOpGrad(TestLogcumsumexpOp):
+    def init_config(self):
+        self.shape = (3, 30, 4)
+        self.axis = 1
+        self.flatten = False
+        self.exclusive = True
+        self.reverse = True
+        self.dtype = "float64"
+        self.check_gradient = True
+
+
+class TestLogcumsumexpOpNan(TestLogcumsumexpOp):
+    def make_input(self):
+        # a NaN poisons the rest of its scan, whichever side of the max it is
+        x = np.random.uniform(-5, 5, self.shape).astype(self.dtype)
+        x[0, 10] = np.nan
+        x[1, 4000] = np.nan
+        return x
+
+    def init_config(self):
+        self.shape = (2, 5000)
+        self.axis = -1
+        self.flatten = False
+        self.exclusive = False
+        self.reverse = True
+        self.dtype = "float32"
+        self.check_gradient = False
+
+
+class TestCumOps(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        paddle.set_device("custom_cpu")
+        np.random.seed(2024)
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def modes(self):
+        for exclusive in [False, True]:
+            for reverse in [False, True]:
+                yield exclusive, reverse
+
+    def test_logcumsumexp_grad(self):
+        x = np.random.uniform(-5, 5, [3, 30, 4]).astype("float64")
+        x[0, :5, 0] = -np.inf
+        for exclusive, reverse in self.modes():
+            x_t = paddle.to_tensor(x, stop_gradient=False)
+            out = _C_ops.logcumsumexp(x_t, 1, False, exclusive, reverse)
+            dout = np.random.uniform(-1, 1, x.shape)
+            (dx,) = paddle.grad(out, x_t, paddle.to_tensor(dout))
+            expect = self.numeric_grad(
+                x, dout, 1, exclusive, reverse, np.logaddexp
+            )
+            np.testing.assert_allclose(dx.numpy(), expect, atol=1e-6)
+
+    def numeric_grad(self, x, dout, axis, exclusive, reverse, ufunc):
+        eps = 1e-6
+        grad = np.zeros_like(x)
+        for index in np.ndindex(*x.shape):
+            if np.isinf(x[index]):
+                continue
+            up = x.copy()
+            up[index] += eps
+            down = x.copy()
+            down[index] -= eps
+            diff = np_scan(up, axis, exclusive, reverse, ufunc) - np_scan(
+                down, axis, exclusive, reverse, ufunc
+            )
+            diff[np.isnan(diff)] = 0.0
+            grad[index] = np.sum(dout * diff) / (2 * eps)
+        return grad
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,514 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import math
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle import _C_ops
+from paddle.vision import ops
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def np_iou(a, b, normalized=True):
+    if b[0] > a[2] or b[2] < a[0] or b[1] > a[3] or b[3] < a[1]:
+        return 0.0
+    off = 0 if normalized else 1
+
+    def area(x):
+        if x[2] < x[0] or x[3] < x[1]:
+            return 0.0
+        return (x[2] - x[0] + off) * (x[3] - x[1] + off)
+
+    w = min(a[2], b[2]) - max(a[0], b[0]) + off
+    h = min(a[3], b[3]) - max(a[1], b[1]) + off
+    return w * h / (area(a) + area(b) - w * h)
+
+
+def np_nms(boxes, order, threshold, normalized=True):
+    kept = []
+    for i in order:
+        if all(np_iou(boxes[i], boxes[k], normalized) <= threshold for k in kept):
+            kept.append(i)
+    return kept
+
+
+def random_boxes(n, span=100.0):
+    xy = np.random.uniform(0, span, [n, 2])
+    wh = np.random.uniform(1, span / 4, [n, 2])
+    return np.concatenate([xy, xy + wh], axis=1).astype("float32")
+
+
+def np_roi_align(x, boxes, batch_ids, pooled, scale, ratio, aligned):
+    _, c, h, w = x.shape
+    out = np.zeros([len(boxes), c, pooled, pooled])
+    off = 0.5 if aligned else 0.0
+    for r, box in enumerate(boxes):
+        x0, y0, x1, y1 = box * scale - off
+        rw, rh = x1 - x0, y1 - y0
+        if not aligned:
+            rw, rh = max(rw, 1.0), max(rh, 1.0)
+        bw, bh = rw / pooled, rh / pooled
+        gh = ratio if ratio > 0 else math.ceil(bh)
+        gw = ratio if ratio > 0 else math.ceil(bw)
+        img = x[batch_ids[r]]
+        for ph in range(pooled):
+            for pw in range(pooled):
+                acc = np.zeros(c)
+                for iy in range(gh):
+                    for ix in range(gw):
+                        y = y0 + ph * bh + (iy + 0.5) * bh / gh
+                        xx = x0 + pw * bw + (ix + 0.5) * bw / gw
+                        if y < -1 or y > h or xx < -1 or xx > w:
+                            continue
+                        y, xx = max(y, 0.0), max(xx, 0.0)
+                        yl, xl = int(y), int(xx)
+                        yh, xh = yl + 1, xl + 1
+                        if yl >= h - 1:
+                            yl = yh = h - 1
+                            y = float(yl)
+                        if xl >= w - 1:
+                            xl = xh = w - 1
+                            xx = float(xl)
+                        ly, lx = y - yl, xx - xl
+                        acc += (
+                            (1 - ly) * (1 - lx) * img[:, yl, xl]
+                            + (1 - ly) * lx * img[:, yl, xh]
+                            + ly * (1 - lx) * img[:, yh, xl]
+                            + ly * lx * img[:, yh, xh]
+                        )
+                out[r, :, ph, pw] = acc / max(gh * gw, 1)
+    return out
+
+
+def sigmoid(x):
+    return 1 / (1 + np.exp(-x))
+
+
+def np_multiclass_nms(bboxes, scores, score_threshold, nms_top_k, keep_top_k, iou):
+    n, classes, m = scores.shape
+    rows, nums = [], []
+    for b in range(n):
+        dets = []
+        for c in range(1, classes):
+            cand = [i for i in range(m) if scores[b, c, i] > score_threshold]
+            cand = sorted(cand, key=lambda i: -scores[b, c, i])[:nms_top_k]
+            for i in np_nms(bboxes[b], cand, iou, normalized=False):
+                dets.append((scores[b, c, i], c, i))
+        dets = sorted(dets, key=lambda d: -d[0])[:keep_top_k]
+        nums.append(len(dets))
+        for _, c, i in sorted(dets, key=lambda d: (d[1], -d[0])):
+            rows.append([c, scores[b, c, i], *bboxes[b, i], b * m + i])
+    rows = np.array(rows).reshape([-1, 7])
+    return rows[:, :6], rows[:, 6:].astype("int32"), np.array(nums, "int32")
+
+
+def np_center_size(boxes, normalized):
+    off = 0 if normalized else 1
+    w = boxes[..., 2] - boxes[..., 0] + off
+    h = boxes[..., 3] - boxes[..., 1] + off
+    return boxes[..., 0] + w / 2, boxes[..., 1] + h / 2, w, h
+
+
+def np_box_coder(prior, var, target, code_type, normalized):
+    pcx, pcy, pw, ph = np_center_size(prior, normalized)
+    if code_type == "encode_center_size":
+        off = 0 if normalized else 1
+        tw = (target[:, 2] - target[:, 0] + off)[:, None]
+        th = (target[:, 3] - target[:, 1] + off)[:, None]
+        tcx = ((target[:, 0] + target[:, 2]) / 2)[:, None]
+        tcy = ((target[:, 1] + target[:, 3]) / 2)[:, None]
+        out = np.stack(
+            [
+                (tcx - pcx) / pw,
+                (tcy - pcy) / ph,
+                np.log(np.abs(tw / pw)),
+                np.log(np.abs(th / ph)),
+            ],
+            axis=-1,
+        )
+        return out / var
+    # decode with the prior of every column (axis 0)
+    off = 0 if normalized else 1
+    cx = var[:, 0] * target[..., 0] * pw + pcx
+    cy = var[:, 1] * target[..., 1] * ph + pcy
+    w = np.exp(var[:, 2] * target[..., 2]) * pw
+    h = np.exp(var[:, 3] * target[..., 3]) * ph
+    return np.stack(
+        [cx - w / 2, cy - h / 2, cx + w / 2 - off, cy + h / 2 - off], axis=-1
+    )
+
+
+def np_yolo_box(x, img_size, anchors, classes, conf_thresh, ratio, scale):
+    n, _, h, w = x.shape
+    an_num = len(anchors) // 2
+    boxes = np.zeros([n, an_num * h * w, 4])
+    scores = np.zeros([n, an_num * h * w, classes])
+    bias = -0.5 * (scale - 1)
+    for i in range(n):
+        img_h, img_w = img_size[i]
+        for j in range(an_num):
+            v = x[i, j * (5 + classes) : (j + 1) * (5 + classes)]
+            for k in range(h):
+                for l in range(w):
+                    conf = sigmoid(v[4, k, l])
+                    if conf < conf_thresh:
+                        continue
+                    cx = (l + sigmoid(v[0, k, l]) * scale + bias) * img_w / w
+                    cy = (k + sigmoid(v[1, k, l]) * scale + bias) * img_h / h
+                    bw = np.exp(v[2, k, l]) * anchors[2 * j] * img_w / (ratio * w)
+                    bh = np.exp(v[3, k, l]) * anchors[2 * j + 1] * img_h / (ratio * h)
+                    box = [cx - bw / 2, cy - bh / 2, cx + bw / 2, cy + bh / 2]
+                    box = np.clip(box, 0, [np.inf, np.inf, img_w - 1, img_h - 1])
+                    cell = j * h * w + k * w + l
+                    boxes[i, cell] = box
+                    scores[i, cell] = conf * sigmoid(v[5:, k, l])
+    return boxes, scores
+
+
+def nms_wrapper(boxes, iou_threshold=0.3):
+    return _C_ops.nms(boxes, iou_threshold)
+
+
+def multiclass_nms3_wrapper(
+    bboxes,
+    scores,
+    rois_num=None,
+    score_threshold=0.3,
+    nms_top_k=1000,
+    keep_top_k=100,
+    nms_threshold=0.3,
+    normalized=True,
+    nms_eta=1.0,
+    background_label=-1,
+):
+    return _C_ops.multiclass_nms3(
+        bboxes,
+        scores,
+        rois_num,
+        score_threshold,
+        nms_top_k,
+        keep_top_k,
+        nms_threshold,
+        normalized,
+        nms_eta,
+        background_label,
+    )
+
+
+def roi_align_wrapper(
+    x,
+    boxes,
+    boxes_num=None,
+    pooled_height=1,
+    pooled_width=1,
+    spatial_scale=1.0,
+    sampling_ratio=-1,
+    aligned=False,
+):
+    return _C_ops.roi_align(
+        x,
+        boxes,
+        boxes_num,
+        pooled_height,
+        pooled_width,
+        spatial_scale,
+        sampling_ratio,
+        aligned,
+    )
+
+
+def box_coder_wrapper(
+    prior_box,
+    prior_box_var=None,
+    target_box=None,
+    code_type="encode_center_size",
+    box_normalized=True,
+    axis=0,
+    variance=[],
+):
+    return _C_ops.box_coder(
+        prior_box,
+        prior_box_var,
+        target_box,
+        code_type,
+        box_normalized,
+        axis,
+        variance,
+    )
+
+
+def prior_box_wrapper(
+    input,
+    image,
+    min_sizes,
+    max_sizes=None,
+    aspect_ratios=[1.0],
+    variances=[0.1, 0.1, 0.2, 0.2],
+    flip=False,
+    clip=False,
+    step_w=0,
+    step_h=0,
+    offset=0.5,
+    min_max_aspect_ratios_order=False,
+):
+    return ops.prior_box(
+        input,
+        image,
+        min_sizes=min_sizes,
+        max_sizes=max_sizes,
+        aspect_ratios=aspect_ratios,
+        variance=variances,
+        flip=flip,
+        clip=clip,
+        steps=[step_w, step_h],
+        offset=offset,
+        min_max_aspect_ratios_order=min_max_aspect_ratios_order,
+    )
+
+
+class TestNMSOp(OpTest):
+    def setUp(self):
+        self.op_type = "nms"
+        self.python_api = nms_wrapper
+        self.init_config()
+        boxes = random_boxes(300)
+        self.inputs = {"Boxes": boxes}
+        self.attrs = {"iou_threshold": self.threshold}
+        kept = np_nms(boxes, range(len(boxes)), self.threshold)
+        self.outputs = {"KeepBoxesIdxs": np.array(kept, "int64")}
+
+    def init_config(self):
+        self.threshold = 0.3
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestNMSOpLowThreshold(TestNMSOp):
+    def init_config(self):
+        self.threshold = 0.1
+
+
+class TestNMSOpHighThreshold(TestNMSOp):
+    def init_config(self):
+        self.threshold = 0.7
+
+
+class TestMulticlassNMS3Op(OpTest):
+    def setUp(self):
+        self.op_type = "multiclass_nms3"
+        self.python_api = multiclass_nms3_wrapper
+        self.python_out_sig = ["Out", "Index", "NmsRoisNum"]
+        n, classes, m = 2, 4, 60
+        bboxes = np.stack([random_boxes(m) for _ in range(n)])
+        scores = np.random.uniform(0, 1, [n, classes, m]).astype("float32")
+        self.inputs = {"BBoxes": bboxes, "Scores": scores}
+        self.attrs = {
+            "background_label": 0,
+            "score_threshold": 0.3,
+            "nms_top_k": 20,
+            "keep_top_k": 25,
+            "nms_threshold": 0.4,
+            "normalized": False,
+            "nms_eta": 1.0,
+        }
+        out, index, num = np_multiclass_nms(bboxes, scores, 0.3, 20, 25, 0.4)
+        self.outputs = {
+            "Out": out.astype("float32"),
+            "Index": index,
+            "NmsRoisNum": num,
+        }
+
+    def test_check_output(self):
+        self.check_output(atol=1e-6)
+
+
+class TestROIAlignOp(OpTest):
+    def setUp(self):
+        self.op_type = "roi_align"
+        self.python_api = roi_align_wrapper
+        self.init_config()
+        x = np.random.uniform(-1, 1, [2, 3, 12, 14])
+        boxes = random_boxes(6, span=10).astype("float64")
+        boxes_num = np.array([2, 4], "int32")
+        batch_ids = [0, 0, 1, 1, 1, 1]
+        self.inputs = {
+            "X": x,
+            "ROIs": (boxes, [boxes_num.tolist()]),
+            "RoisNum": boxes_num,
+        }
+        self.attrs = {
+            "pooled_height": 3,
+            "pooled_width": 3,
+            "spatial_scale": 0.8,
+            "sampling_ratio": self.sampling_ratio,
+            "aligned": self.aligned,
+        }
+        out = np_roi_align(
+            x, boxes, batch_ids, 3, 0.8, self.sampling_ratio, self.aligned
+        )
+        self.outputs = {"Out": out}
+
+    def init_config(self):
+        self.sampling_ratio = -1
+        self.aligned = True
+
+    def test_check_output(self):
+        self.check_output(atol=1e-12)
+
+    def test_check_grad(self):
+        self.check_grad(["X"], "Out")
+
+
+class TestROIAlignOpFixedRatio(TestROIAlignOp):
+    def init_config(self):
+        self.sampling_ratio = 2
+        self.aligned = False
+
+
+class TestBoxCoderOp(OpTest):
+    def setUp(self):
+        self.op_type = "box_coder"
+        self.python_api = box_coder_wrapper
+        self.init_config()
+        prior = random_boxes(5)
+        var = np.random.uniform(0.1, 0.3, [5, 4]).astype("float32")
+        if self.code_type == "encode_center_size":
+            target = random_boxes(3)
+        else:
+            target = np.random.uniform(-1, 1, [3, 5, 4]).astype("float32")
+        self.inputs = {"PriorBox": prior, "PriorBoxVar": var, "TargetBox": target}
+        self.attrs = {
+            "code_type": self.code_type,
+            "box_normalized": self.box_normalized,
+        }
+        out = np_box_coder(
+            prior.astype("float64"),
+            var.astype("float64"),
+            target.astype("float64"),
+            self.code_type,
+            self.box_normalized,
+        )
+        self.outputs = {"OutputBox": out.astype("float32")}
+
+    def init_config(self):
+        self.code_type = "encode_center_size"
+        self.box_normalized = False
+
+    def test_check_output(self):
+        self.check_output(atol=1e-4)
+
+
+class TestBoxCoderOpNormalized(TestBoxCoderOp):
+    def init_config(self):
+        self.code_type = "encode_center_size"
+        self.box_normalized = True
+
+
+class TestBoxCoderOpDecode(TestBoxCoderOp):
+    def init_config(self):
+        self.code_type = "decode_center_size"
+        self.box_normalized = False
+
+
+class TestPriorBoxOp(OpTest):
+    def setUp(self):
+        self.op_type = "prior_box"
+        self.python_api = prior_box_wrapper
+        self.python_out_sig = ["Boxes", "Variances"]
+        feature = np.zeros([1, 8, 3, 4], "float32")
+        image = np.zeros([1, 3, 60, 80], "float32")
+        variances = [0.1, 0.1, 0.2, 0.2]
+        self.inputs = {"Input": feature, "Image": image}
+        self.attrs = {
+            "min_sizes": [10.0],
+            "max_sizes": [20.0],
+            "aspect_ratios": [2.0],
+            "variances": variances,
+            "flip": True,
+            "clip": True,
+            "step_w": 0.0,
+            "step_h": 0.0,
+            "offset": 0.5,
+            "min_max_aspect_ratios_order": False,
+        }
+        half = [
+            (5, 5),
+            (5 * math.sqrt(2), 5 / math.sqrt(2)),
+            (5 / math.sqrt(2), 5 * math.sqrt(2)),
+            (math.sqrt(200) / 2, math.sqrt(200) / 2),
+        ]
+        boxes = np.zeros([3, 4, 4, 4])
+        for h in range(3):
+            for w in range(4):
+                cx, cy = (w + 0.5) * 20, (h + 0.5) * 20
+                for p, (bw, bh) in enumerate(half):
+                    boxes[h, w, p] = [
+                        (cx - bw) / 80,
+                        (cy - bh) / 60,
+                        (cx + bw) / 80,
+                        (cy + bh) / 60,
+                    ]
+        self.outputs = {
+            "Boxes": np.clip(boxes, 0, 1).astype("float32"),
+            "Variances": np.broadcast_to(variances, boxes.shape).astype("float32"),
+        }
+
+    def test_check_output(self):
+        self.check_output(atol=1e-6)
+
+
+class TestYoloBoxOp(OpTest):
+    def setUp(self):
+        self.op_type = "yolo_box"
+        self.python_api = ops.yolo_box
+        self.python_out_sig = ["Boxes", "Scores"]
+        anchors, classes, h, w = [10, 13, 16, 30], 3, 4, 5
+        x = np.random.uniform(-2, 2, [2, 2 * (5 + classes), h, w])
+        x = x.astype("float32")
+        img_size = np.array([[320, 416], [288, 352]], "int32")
+        self.inputs = {"X": x, "ImgSize": img_size}
+        self.attrs = {
+            "anchors": anchors,
+            "class_num": classes,
+            "conf_thresh": 0.3,
+            "downsample_ratio": 32,
+            "clip_bbox": True,
+            "scale_x_y": 1.2,
+            "iou_aware": False,
+            "iou_aware_factor": 0.5,
+        }
+        boxes, scores = np_yolo_box(x, img_size, anchors, classes, 0.3, 32, 1.2)
+        self.outputs = {
+            "Boxes": boxes.astype("float32"),
+            "Scores": scores.astype("float32"),
+        }
+
+    def test_check_output(self):
+        self.check_output(atol=1e-4)
+
+
+if __name__ == "__main__":
+    unittest.main()
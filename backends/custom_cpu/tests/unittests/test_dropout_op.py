@@ -0,0 +1,138 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+import paddle.nn.functional as F
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def dropout_wrapper(
+    X,
+    Seed=None,
+    dropout_prob=0.5,
+    is_test=False,
+    dropout_implementation="downgrade_in_infer",
+    seed=0,
+    fix_seed=False,
+):
+    return paddle._C_ops.dropout(
+        X, Seed, dropout_prob, is_test, dropout_implementation, seed, fix_seed
+    )
+
+
+class TestDropoutOp(OpTest):
+    def setUp(self):
+        self.op_type = "dropout"
+        self.python_api = dropout_wrapper
+        self.python_out_sig = ["Out"]
+        self.init_config()
+        x = np.random.random(self.shape).astype("float32")
+        self.inputs = {"X": x}
+        self.attrs = {
+            "dropout_prob": self.dropout_prob,
+            "fix_seed": True,
+            "is_test": self.is_test,
+            "dropout_implementation": self.mode,
+        }
+        if self.is_test:
+            factor = 1.0 if self.mode == "upscale_in_train" else 1 - self.dropout_prob
+            self.outputs = {"Out": x * factor}
+        else:
+            # p is 0 or 1 here, so the mask is known: one bit per element
+            keep = np.full(self.shape, self.dropout_prob == 0.0)
+            self.outputs = {
+                "Out": x * keep,
+                "Mask": np.packbits(keep.ravel(), bitorder="little"),
+            }
+
+    def init_config(self):
+        self.shape = [32, 67]
+        self.dropout_prob = 0.0
+        self.is_test = False
+        self.mode = "upscale_in_train"
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        if not self.is_test:
+            self.check_grad(["X"], "Out")
+
+
+class TestDropoutOpDropAll(TestDropoutOp):
+    def init_config(self):
+        self.shape = [1001]
+        self.dropout_prob = 1.0
+        self.is_test = False
+        self.mode = "upscale_in_train"
+
+
+class TestDropoutOpInfer(TestDropoutOp):
+    def init_config(self):
+        self.shape = [32, 64, 3]
+        self.dropout_prob = 0.35
+        self.is_test = True
+        self.mode = "downgrade_in_infer"
+
+
+class TestDropout(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+        np.random.seed(2024)
+        self.x_np = np.random.uniform(1, 2, (1000, 123)).astype("float32")
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def run_dropout(self, p, mode="upscale_in_train", training=True):
+        x = paddle.to_tensor(self.x_np, stop_gradient=False)
+        out = F.dropout(x, p=p, training=training, mode=mode)
+        out.backward(paddle.ones_like(out))
+        return out.numpy(), x.grad.numpy()
+
+    def test_upscale_in_train(self):
+        out, dx = self.run_dropout(0.3)
+        kept = out != 0
+        self.assertAlmostEqual(kept.mean(), 0.7, delta=0.01)
+        np.testing.assert_allclose(
+            out[kept], self.x_np[kept] / 0.7, rtol=1e-6
+        )
+        # the gradient sees the same (bit-packed) mask as the forward
+        np.testing.assert_allclose(dx, kept / 0.7, rtol=1e-6)
+
+    def test_downgrade_in_infer(self):
+        out, dx = self.run_dropout(0.5, mode="downgrade_in_infer")
+        kept = out != 0
+        self.assertAlmostEqual(kept.mean(), 0.5, delta=0.01)
+        np.testing.assert_allclose(out[kept], self.x_np[kept], rtol=1e-6)
+        np.testing.assert_allclose(dx, kept.astype("float32"), rtol=1e-6)
+
+        out, _ = self.run_dropout(0.5, mode="downgrade_in_infer", training=False)
+        np.testing.assert_allclose(out, self.x_np * 0.5, rtol=1e-6)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,112 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def einsum_wrapper(a, b):
+    if not isinstance(a, list):
+        a = [a]
+    # the kernel returns [Out, InnerCache, XShape]
+    return paddle._C_ops.einsum(a, b)[0]
+
+
+class TestEinsumOp(OpTest):
+    def setUp(self):
+        self.op_type = "einsum"
+        self.python_api = einsum_wrapper
+        self.python_out_sig = ["Out"]
+        self.init_config()
+        xs = [np.random.uniform(-1, 1, s).astype(self.dtype) for s in self.shapes]
+        out = np.einsum(self.equation, *[x.astype("float64") for x in xs])
+        self.names = ["x%d" % i for i in range(len(xs))]
+        self.inputs = {"Operands": list(zip(self.names, xs))}
+        self.attrs = {"equation": self.equation}
+        self.outputs = {
+            "Out": out.astype(self.dtype),
+            "InnerCache": [("cache_%d" % i, np.array([1.0])) for i in range(len(xs))],
+            "XShape": [("xshape_%d" % i, np.array([1.0])) for i in range(len(xs))],
+        }
+
+    def init_config(self):
+        self.equation = "ij,jk->ik"
+        self.shapes = [[17, 33], [33, 9]]
+        self.dtype = "float64"
+        self.check_gradient = True
+
+    def test_check_output(self):
+        atol = 5e-2 if self.dtype == "float16" else 1e-10
+        self.check_output(atol=atol, no_check_set=["InnerCache", "XShape"])
+
+    def test_check_grad(self):
+        if self.check_gradient:
+            self.check_grad(self.names, "Out")
+
+
+def create_test_class(name, equation, shapes, dtype="float64", grad=True):
+    class Cls(TestEinsumOp):
+        def init_config(self):
+            self.equation = equation
+            self.shapes = shapes
+            self.dtype = dtype
+            self.check_gradient = grad
+
+    cls_name = "TestEinsumOp{0}".format(name)
+    Cls.__name__ = cls_name
+    globals()[cls_name] = Cls
+
+
+# pairwise contractions, attention scores and context with permuted heads
+create_test_class("Implicit", "ij,kj", [[17, 33], [9, 33]])
+create_test_class("BatchPermuted", "bij,bjk->kbi", [[4, 5, 7], [4, 7, 3]])
+create_test_class("Scores", "bhqd,bhkd->bhqk", [[2, 3, 5, 8], [2, 3, 6, 8]])
+create_test_class("Context", "bhqk,bhkd->bqhd", [[2, 3, 5, 6], [2, 3, 6, 8]])
+create_test_class("Outer", "i,j->ij", [[6], [5]])
+create_test_class("RowDot", "ij,ij->i", [[300, 70], [300, 70]], grad=False)
+create_test_class("Diagonal", "iij,jk->ik", [[3, 3, 4], [4, 5]])
+create_test_class("KeepContracted", "ij,jk->ikj", [[3, 4], [4, 5]])
+# single operand
+create_test_class("Diag", "ii->i", [[6, 6]])
+create_test_class("Trace", "ii", [[6, 6]])
+create_test_class("Transpose", "ijk->kj", [[3, 4, 5]])
+create_test_class("Sum", "ij->", [[6, 5]])
+# ellipsis broadcast
+create_test_class("Ellipsis", "...ij,...jk->...ik", [[2, 3, 4, 5], [3, 5, 2]])
+create_test_class("EllipsisImplicit", "...ij,...jk", [[2, 1, 4, 5], [3, 5, 2]])
+# many operands
+create_test_class("Chain", "ab,bc,cd,de->ae", [[3, 40], [40, 2], [2, 30], [30, 4]])
+create_test_class("Three", "abc,cd,dbe->ae", [[3, 4, 5], [5, 6], [6, 4, 2]])
+create_test_class(
+    "Seven", "a,b,c,d,e,f,g->gfedcba", [[2], [3], [2], [1], [2], [3], [2]]
+)
+create_test_class(
+    "Float16", "bij,bjk->bik", [[3, 16, 32], [3, 32, 8]], "float16", grad=False
+)
+
+
+if __name__ == "__main__":
+    unittest.main()
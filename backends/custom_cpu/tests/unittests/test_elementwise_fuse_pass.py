@@ -0,0 +1,106 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import tempfile
+import unittest
+
+import numpy as np
+import paddle
+import paddle_custom_device.custom_cpu.passes as passes
+
+paddle.enable_static()
+
+
+def save_model(path, build, feeds):
+    main, startup = paddle.static.Program(), paddle.static.Program()
+    with paddle.static.program_guard(main, startup):
+        inputs = [
+            paddle.static.data(name, value.shape, "float32")
+            for name, value in feeds.items()
+        ]
+        out = build(*inputs)
+    exe = paddle.static.Executor(paddle.CPUPlace())
+    exe.run(startup)
+    paddle.static.save_inference_model(path, inputs, [out], exe, program=main)
+
+
+def run_model(path, feeds, fuse):
+    config = paddle.inference.Config(path + ".pdmodel", path + ".pdiparams")
+    config.enable_custom_device("custom_cpu")
+    if fuse:
+        passes.addPasses(config.pass_builder())
+    else:
+        config.switch_ir_optim(False)
+    predictor = paddle.inference.create_predictor(config)
+    for name in predictor.get_input_names():
+        predictor.get_input_handle(name).copy_from_cpu(feeds[name])
+    predictor.run()
+    name = predictor.get_output_names()[0]
+    return predictor.get_output_handle(name).copy_to_cpu()
+
+
+def param(shape):
+    return paddle.static.create_parameter(
+        shape,
+        "float32",
+        default_initializer=paddle.nn.initializer.Uniform(-1.0, 1.0),
+    )
+
+
+class TestElementwiseFusePass(unittest.TestCase):
+    def setUp(self):
+        passes.setUp()
+        np.random.seed(2024)
+        self.dir = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def check(self, build, **feeds):
+        path = os.path.join(self.dir.name, "model")
+        save_model(path, build, feeds)
+        expect = run_model(path, feeds, fuse=False)
+        out = run_model(path, feeds, fuse=True)
+        self.assertEqual(out.shape, expect.shape)
+        np.testing.assert_allclose(out, expect, rtol=1e-6, atol=1e-6)
+
+    def rand(self, *shape):
+        return np.random.uniform(-1, 1, shape).astype("float32")
+
+    def test_channel_bias(self):
+        # a [C, 1, 1] scale and bias over NCHW, as batch_norm folding emits
+        def build(x):
+            y = x * param([3, 1, 1]) + param([3, 1, 1])
+            return paddle.nn.functional.relu(y)
+
+        self.check(build, x=self.rand(2, 3, 4, 5))
+
+    def test_broadcast_x(self):
+        # bias + act, with X the smaller side
+        self.check(
+            lambda x: paddle.nn.functional.relu(paddle.add(param([5]), x)),
+            x=self.rand(2, 3, 4, 5),
+        )
+
+    def test_larger_addend(self):
+        self.check(
+            lambda x, b: paddle.add(x * param([5]), b),
+            x=self.rand(4, 5),
+            b=self.rand(3, 4, 5),
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
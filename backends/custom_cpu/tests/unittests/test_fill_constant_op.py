@@ -233,6 +233,43 @@ class TestFillConstantOp2_ValueTensor(OpTest):
         self.check_output()
 
 
+# Situation 6: tensors above the lazy zero and page mapping thresholds
+class TestFillLargeTensor(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        self.shape = [1024, 2048]
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def test_zeros_after_reuse(self):
+        # the buffer freed by the first tensor is likely handed to zeros
+        x = paddle.full(self.shape, 7.0, dtype="float32").to(self.place)
+        del x
+        y = paddle.zeros(self.shape, dtype="float32").to(self.place)
+        self.assertEqual(np.count_nonzero(y.numpy()), 0)
+
+    def test_full_and_full_like(self):
+        for value, dtype in [(2.5, "float32"), (-3, "int64"), (0, "int32")]:
+            x = paddle.full(self.shape, value, dtype=dtype).to(self.place)
+            np.testing.assert_array_equal(x.numpy(), np.full(self.shape, value, dtype))
+            y = paddle.full_like(x, 1)
+            np.testing.assert_array_equal(y.numpy(), np.ones(self.shape, dtype))
+
+    def test_fill_inplace(self):
+        x = paddle.ones(self.shape, dtype="float32").to(self.place)
+        x.fill_(0.0)
+        self.assertEqual(np.count_nonzero(x.numpy()), 0)
+        x.fill_(-1.5)
+        np.testing.assert_array_equal(x.numpy(), np.full(self.shape, -1.5, "float32"))
+
+    def test_assign(self):
+        data = np.random.uniform(-1, 1, self.shape).astype("float32")
+        x = paddle.to_tensor(data, place=self.place)
+        np.testing.assert_array_equal(paddle.assign(x).numpy(), data)
+
+
 if __name__ == "__main__":
     paddle.enable_static()
     unittest.main()
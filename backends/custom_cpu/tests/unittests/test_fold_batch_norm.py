@@ -0,0 +1,103 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+import paddle
+import paddle_custom_device.custom_cpu.passes as passes
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..", "tools"))
+from fold_batch_norm import fold_batch_norm  # noqa: E402
+
+paddle.enable_static()
+
+
+def run_model(path, x, fuse):
+    config = paddle.inference.Config(path + ".pdmodel", path + ".pdiparams")
+    config.enable_custom_device("custom_cpu")
+    if fuse:
+        passes.addPasses(config.pass_builder())
+    else:
+        config.switch_ir_optim(False)
+    predictor = paddle.inference.create_predictor(config)
+    predictor.get_input_handle(predictor.get_input_names()[0]).copy_from_cpu(x)
+    predictor.run()
+    name = predictor.get_output_names()[0]
+    return predictor.get_output_handle(name).copy_to_cpu()
+
+
+class TestFoldBatchNorm(unittest.TestCase):
+    def setUp(self):
+        passes.setUp()
+        np.random.seed(2024)
+        self.dir = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def save_conv_bn_relu(self, path):
+        main, startup = paddle.static.Program(), paddle.static.Program()
+        with paddle.static.program_guard(main, startup):
+            x = paddle.static.data("x", [-1, 3, 9, 10], "float32")
+            y = paddle.static.nn.conv2d(x, 8, 3, padding=1, bias_attr=False)
+            y = paddle.static.nn.batch_norm(y, is_test=True)
+            out = paddle.nn.functional.relu(y)
+        exe = paddle.static.Executor(paddle.CPUPlace())
+        exe.run(startup)
+        # statistics far from the identity so folding is not a no-op
+        scope = paddle.static.global_scope()
+        for var in main.list_vars():
+            if var.persistable:
+                tensor = scope.find_var(var.name).get_tensor()
+                low = 0.5 if "variance" in var.name else -1.0
+                value = np.random.uniform(low, 1.5, np.array(tensor).shape)
+                tensor.set(value.astype("float32"), paddle.CPUPlace())
+        paddle.static.save_inference_model(path, [x], [out], exe, program=main)
+
+    def test_fold_then_fuse(self):
+        # conv -> add([C, 1, 1]) -> relu goes through the fusion passes
+        original = os.path.join(self.dir.name, "original", "inference")
+        folded = os.path.join(self.dir.name, "folded", "inference")
+        self.save_conv_bn_relu(original)
+
+        exe = paddle.static.Executor(paddle.CPUPlace())
+        program, feeds, fetches = paddle.static.load_inference_model(
+            original, exe
+        )
+        scope = paddle.static.global_scope()
+        self.assertEqual(fold_batch_norm(program, scope, paddle.CPUPlace()), 1)
+        ops = [op.type for op in program.global_block().ops]
+        self.assertNotIn("batch_norm", ops)
+        block = program.global_block()
+        paddle.static.save_inference_model(
+            folded,
+            [block.var(name) for name in feeds],
+            fetches,
+            exe,
+            program=program,
+        )
+
+        x = np.random.uniform(-1, 1, [2, 3, 9, 10]).astype("float32")
+        expect = run_model(original, x, fuse=False)
+        for fuse in [False, True]:
+            out = run_model(folded, x, fuse)
+            np.testing.assert_allclose(out, expect, rtol=1e-5, atol=1e-5)
+
+
+if __name__ == "__main__":
+    unittest.main()
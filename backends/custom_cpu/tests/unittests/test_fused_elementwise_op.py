@@ -0,0 +1,166 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import unittest
+
+import numpy as np
+import paddle
+from paddle.base import core
+
+for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+    if lib.endswith(".so"):
+        paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+            lib
+        )
+
+
+def run_fused(program, x, y=None, z=None, out_dtype=-1):
+    return core.eager._run_custom_op(
+        "fused_elementwise", x, y, z, program, out_dtype
+    )[0]
+
+
+class TestFusedElementwise(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+        # not a multiple of the tile size
+        self.x = np.random.uniform(-1, 1, (37, 129)).astype("float32")
+        self.w = np.random.uniform(-1, 1, (37, 129)).astype("float32")
+        self.b = np.random.uniform(-1, 1, (129,)).astype("float32")
+
+    def to_tensor(self, x):
+        return paddle.to_tensor(x, place=self.place)
+
+    def test_mul_add_relu(self):
+        out = run_fused(
+            "x y mul z add relu",
+            self.to_tensor(self.x),
+            self.to_tensor(self.w),
+            self.to_tensor(self.b),
+        )
+        expect = np.maximum(self.x * self.w + self.b, 0)
+        np.testing.assert_allclose(out.numpy(), expect, rtol=1e-6, atol=1e-6)
+
+    def test_scalar_and_constants(self):
+        out = run_fused(
+            "x y mul 0.5 add sigmoid",
+            self.to_tensor(self.x),
+            self.to_tensor(np.array([2.0], dtype="float32")),
+        )
+        expect = 1 / (1 + np.exp(-(self.x * 2 + 0.5)))
+        np.testing.assert_allclose(out.numpy(), expect, rtol=1e-5, atol=1e-6)
+
+    def test_compare_where(self):
+        out = run_fused(
+            "x y gt x y where",
+            self.to_tensor(self.x),
+            self.to_tensor(self.w),
+        )
+        np.testing.assert_allclose(out.numpy(), np.maximum(self.x, self.w))
+
+        mask = run_fused(
+            "x 0 ge", self.to_tensor(self.x), out_dtype=0
+        )  # BOOL
+        self.assertEqual(mask.dtype, paddle.bool)
+        np.testing.assert_array_equal(mask.numpy(), self.x >= 0)
+
+    def test_cast_output(self):
+        out = run_fused(
+            "x y add relu",
+            self.to_tensor(self.x),
+            self.to_tensor(self.b),
+            out_dtype=4,  # FP16
+        )
+        self.assertEqual(out.dtype, paddle.float16)
+        expect = np.maximum(self.x + self.b, 0).astype("float16")
+        np.testing.assert_allclose(
+            out.astype("float32").numpy(), expect.astype("float32"), rtol=1e-3
+        )
+
+    def test_jit_and_interpreter(self):
+        # full-size float32 inputs run as JIT code where the host supports
+        # it; exp has no code generator and always takes the interpreter
+        x = np.concatenate([self.x.ravel(), [np.nan, 0.0, -0.0]])
+        w = np.concatenate([self.w.ravel(), [1.0, np.nan, 0.0]])
+        x = x.astype("float32")
+        w = w.astype("float32")
+        for program, expect in (
+            ("x y max abs sqrt", np.sqrt(np.abs(np.where(x > w, x, w)))),
+            ("x y le x neg y where", np.where(x <= w, -x, w)),
+            ("x y max exp", np.exp(np.where(x > w, x, w))),
+        ):
+            out = run_fused(program, self.to_tensor(x), self.to_tensor(w))
+            np.testing.assert_allclose(
+                out.numpy(), expect, rtol=1e-6, equal_nan=True
+            )
+
+    def test_double_and_integer(self):
+        # computed in the input type, not rounded through float
+        x = self.x.astype("float64") * 1e-3 + 1
+        out = run_fused(
+            "x y mul z add relu",
+            self.to_tensor(x),
+            self.to_tensor(self.w.astype("float64")),
+            self.to_tensor(self.b.astype("float64")),
+        )
+        self.assertEqual(out.dtype, paddle.float64)
+        np.testing.assert_allclose(
+            out.numpy(), np.maximum(x * self.w + self.b, 0), rtol=1e-15
+        )
+
+        xi = np.arange(-100, 100, dtype="int64") + 2**40
+        out = run_fused(
+            "x y mul z add",
+            self.to_tensor(xi),
+            self.to_tensor(np.array([3], "int64")),
+            self.to_tensor(np.array([7], "int64")),
+        )
+        np.testing.assert_array_equal(out.numpy(), xi * 3 + 7)
+
+    def test_broadcast(self):
+        # the output takes the broadcast shape, whichever input is largest
+        x = np.random.uniform(-1, 1, (2, 3, 4, 5)).astype("float32")
+        for y_shape, z_shape in (
+            ((3, 1, 1), (5,)),  # per-channel scale over NCHW
+            ((5,), (2, 3, 4, 5)),  # x smaller than z
+            ((3, 1, 5), (2, 1, 1, 1)),  # expanded to the output shape
+            ((6, 2, 3, 1, 1), (1,)),  # y of higher rank than x
+        ):
+            y = np.random.uniform(-1, 1, y_shape).astype("float32")
+            z = np.random.uniform(-1, 1, z_shape).astype("float32")
+            out = run_fused(
+                "x y mul z add relu",
+                self.to_tensor(x),
+                self.to_tensor(y),
+                self.to_tensor(z),
+            )
+            expect = np.maximum(x * y + z, 0)
+            self.assertEqual(out.shape, list(expect.shape))
+            np.testing.assert_allclose(out.numpy(), expect, rtol=1e-6, atol=1e-6)
+        with self.assertRaises(Exception):
+            y = np.ones((4,), "float32")
+            run_fused("x y add", self.to_tensor(x), self.to_tensor(y))
+
+    def test_invalid_program(self):
+        with self.assertRaises(Exception):
+            run_fused("x y add", self.to_tensor(self.x))
+        with self.assertRaises(Exception):
+            run_fused("x x", self.to_tensor(self.x))
+
+
+if __name__ == "__main__":
+    unittest.main()
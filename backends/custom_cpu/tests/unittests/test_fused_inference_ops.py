@@ -0,0 +1,176 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import math
+import os
+import unittest
+
+import numpy as np
+import paddle
+from paddle.base import core
+
+for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+    if lib.endswith(".so"):
+        paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+            lib
+        )
+
+
+def ref_conv2d(x, w, stride, pad, dilation, groups):
+    n, c, h, width = x.shape
+    oc, cg, kh, kw = w.shape
+    x = np.pad(x, ((0, 0), (0, 0), (pad[0], pad[1]), (pad[2], pad[3])))
+    oh = (x.shape[2] - dilation[0] * (kh - 1) - 1) // stride[0] + 1
+    ow = (x.shape[3] - dilation[1] * (kw - 1) - 1) // stride[1] + 1
+    out = np.zeros((n, oc, oh, ow), np.float64)
+    ocg = oc // groups
+    for o in range(oc):
+        g = o // ocg
+        xs = x[:, g * cg : (g + 1) * cg]
+        for i in range(kh):
+            for j in range(kw):
+                patch = xs[
+                    :,
+                    :,
+                    i * dilation[0] : i * dilation[0] + stride[0] * oh : stride[0],
+                    j * dilation[1] : j * dilation[1] + stride[1] * ow : stride[1],
+                ]
+                out[:, o] += np.einsum("nchw,c->nhw", patch, w[o, :, i, j])
+    return out
+
+
+def ref_gelu(x):
+    erf = np.vectorize(math.erf)
+    return 0.5 * x * (1 + erf(x / math.sqrt(2)))
+
+
+class TestFusedInferenceOps(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+
+    def to_tensor(self, x):
+        return paddle.to_tensor(x, place=self.place)
+
+    def rand(self, *shape):
+        return np.random.uniform(-1, 1, shape).astype("float32")
+
+    def test_conv2d_bn_relu(self):
+        x = self.rand(2, 6, 9, 11)
+        w = self.rand(4, 3, 3, 2)
+        scale = np.random.uniform(0.5, 1.5, 4).astype("float32")
+        bias = self.rand(4)
+        mean = self.rand(4)
+        var = np.random.uniform(0.1, 2, 4).astype("float32")
+        eps = 1e-5
+        conv = ref_conv2d(x, w, [2, 1], [1, 0, 1, 1], [1, 2], 2)
+        bn = (conv - mean[:, None, None]) / np.sqrt(var + eps)[:, None, None]
+        expect = np.maximum(bn * scale[:, None, None] + bias[:, None, None], 0)
+        for data_format in ["NCHW", "NHWC"]:
+            inp = x if data_format == "NCHW" else x.transpose(0, 2, 3, 1)
+            out = core.eager._run_custom_op(
+                "fused_conv2d_bn_act",
+                self.to_tensor(inp),
+                self.to_tensor(w),
+                self.to_tensor(scale),
+                self.to_tensor(bias),
+                self.to_tensor(mean),
+                self.to_tensor(var),
+                [2, 1],
+                [1, 0, 1, 1],
+                "EXPLICIT",
+                [1, 2],
+                2,
+                data_format,
+                eps,
+                "relu",
+            )[0].numpy()
+            if data_format == "NHWC":
+                out = out.transpose(0, 3, 1, 2)
+            np.testing.assert_allclose(out, expect, rtol=1e-5, atol=1e-5)
+
+    def test_matmul_bias_act(self):
+        x = self.rand(3, 5, 7)
+        y = self.rand(9, 7)
+        for bias_shape in [(9,), (5, 9), (3, 5, 9)]:
+            bias = self.rand(*bias_shape)
+            out = core.eager._run_custom_op(
+                "fused_matmul_bias_act",
+                self.to_tensor(x),
+                self.to_tensor(y),
+                self.to_tensor(bias),
+                False,
+                True,
+                "gelu",
+            )[0]
+            expect = ref_gelu(np.matmul(x, y.T) + bias)
+            np.testing.assert_allclose(out.numpy(), expect, rtol=1e-5, atol=1e-5)
+        out = core.eager._run_custom_op(
+            "fused_matmul_bias_act",
+            self.to_tensor(x.transpose(0, 2, 1)),
+            self.to_tensor(y.T),
+            None,
+            True,
+            False,
+            "relu",
+        )[0]
+        np.testing.assert_allclose(
+            out.numpy(), np.maximum(np.matmul(x, y.T), 0), rtol=1e-5, atol=1e-5
+        )
+
+    def test_residual_layer_norm(self):
+        for dtype, tol in [("float32", 1e-5), ("float64", 1e-10)]:
+            x = self.rand(4, 6, 10).astype(dtype)
+            residual = self.rand(4, 6, 10).astype(dtype)
+            scale = self.rand(10).astype(dtype)
+            bias = self.rand(10).astype(dtype)
+            out, residual_out = core.eager._run_custom_op(
+                "fused_residual_layer_norm",
+                self.to_tensor(x),
+                self.to_tensor(residual),
+                self.to_tensor(scale),
+                self.to_tensor(bias),
+                1e-5,
+                2,
+            )
+            self.assertEqual(out.numpy().dtype, np.dtype(dtype))
+            s = x + residual
+            mean = s.mean(-1, keepdims=True)
+            var = s.var(-1, keepdims=True)
+            expect = (s - mean) / np.sqrt(var + 1e-5) * scale + bias
+            np.testing.assert_allclose(residual_out.numpy(), s, rtol=1e-6)
+            np.testing.assert_allclose(out.numpy(), expect, rtol=tol, atol=tol)
+
+    def test_qkv_projection(self):
+        x = self.rand(2, 3, 8)
+        weights = [self.rand(8, 8), self.rand(8, 4), self.rand(8, 4)]
+        q_bias = self.rand(8)
+        outs = core.eager._run_custom_op(
+            "fused_qkv_projection",
+            self.to_tensor(x),
+            *[self.to_tensor(w) for w in weights],
+            self.to_tensor(q_bias),
+            None,
+            None,
+        )
+        biases = [q_bias, 0, 0]
+        for out, w, b in zip(outs, weights, biases):
+            np.testing.assert_allclose(
+                out.numpy(), np.matmul(x, w) + b, rtol=1e-5, atol=1e-5
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
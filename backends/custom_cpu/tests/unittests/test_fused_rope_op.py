@@ -0,0 +1,137 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import unittest
+
+import numpy as np
+import paddle
+from paddle.base import core
+
+for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+    if lib.endswith(".so"):
+        paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+            lib
+        )
+
+
+def rope_naive(data, cos, sin):
+    r1, r2 = paddle.chunk(data, 2, -1)
+    data_new = paddle.concat((-r2, r1), axis=-1)
+    return cos * data + sin * data_new
+
+
+class TestFusedRope(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        # (B, S, N, D) and (1, S, 1, D)
+        self.x_shape = (2, 16, 4, 64)
+        self.table_shape = (1, 16, 1, 64)
+
+    def test_rope(self):
+        np_x = np.random.uniform(-1, 1, self.x_shape).astype("float32")
+        np_cos = np.random.uniform(0, 1, self.table_shape).astype("float32")
+        np_sin = np.random.uniform(0, 1, self.table_shape).astype("float32")
+
+        golden_x = paddle.to_tensor(np_x, place=self.place, stop_gradient=False)
+        cos = paddle.to_tensor(np_cos, place=self.place)
+        sin = paddle.to_tensor(np_sin, place=self.place)
+        golden_y = rope_naive(golden_x, cos, sin)
+        golden_y.backward()
+
+        fused_x = paddle.to_tensor(np_x, place=self.place, stop_gradient=False)
+        fused_y = core.eager._run_custom_op("fused_rope", fused_x, cos, sin)[0]
+        fused_y.backward()
+
+        np.testing.assert_allclose(
+            golden_y.numpy(), fused_y.numpy(), rtol=1e-5, atol=1e-6
+        )
+        np.testing.assert_allclose(
+            golden_x.grad.numpy(), fused_x.grad.numpy(), rtol=1e-5, atol=1e-6
+        )
+
+
+class TestQKVTransposeSplit(unittest.TestCase):
+    def test_split(self):
+        paddle.disable_static()
+        place = paddle.CustomPlace("custom_cpu", 0)
+        num_head, kv_num_head, head_size = 4, 2, 8
+        seq_lens = np.array([3, 5], dtype="int32")
+        max_seq_len = 6
+        token_num = int(seq_lens.sum())
+        hidden = (num_head + 2 * kv_num_head) * head_size
+        qkv = np.random.random((token_num, hidden)).astype("float32")
+        padding_offset = np.array([0, 0, 0, 3, 3, 3, 3, 3], dtype="int32")
+        input_ids = np.zeros((2, max_seq_len), dtype="int64")
+
+        q, k, v = core.eager._run_custom_op(
+            "qkv_transpose_split",
+            paddle.to_tensor(qkv, place=place),
+            paddle.to_tensor(padding_offset, place=place),
+            paddle.to_tensor(seq_lens, place=place),
+            paddle.to_tensor(input_ids, place=place),
+            num_head,
+            head_size,
+        )
+
+        padded = np.zeros((2 * max_seq_len, hidden), dtype="float32")
+        padded[np.arange(token_num) + padding_offset] = qkv
+        padded = padded.reshape(2, max_seq_len, -1, head_size)
+        padded = padded.transpose(0, 2, 1, 3)
+        np.testing.assert_allclose(q.numpy(), padded[:, :num_head])
+        np.testing.assert_allclose(
+            k.numpy(), padded[:, num_head : num_head + kv_num_head]
+        )
+        np.testing.assert_allclose(
+            v.numpy(), padded[:, num_head + kv_num_head :]
+        )
+
+
+class TestWriteCacheKV(unittest.TestCase):
+    def test_paged(self):
+        paddle.disable_static()
+        place = paddle.CustomPlace("custom_cpu", 0)
+        bsz, num_head, seq_len, head_dim = 2, 3, 10, 8
+        block_size, num_blocks = 4, 8
+        k = np.random.random((bsz, num_head, seq_len, head_dim))
+        v = np.random.random((bsz, num_head, seq_len, head_dim))
+        k, v = k.astype("float32"), v.astype("float32")
+        seq_lens = np.array([10, 6], dtype="int32")
+        block_tables = np.array([[5, 0, 7], [2, 4, -1]], dtype="int32")
+        cache = np.zeros(
+            (2, num_blocks, num_head, block_size, head_dim), dtype="float32"
+        )
+
+        cache_t = paddle.to_tensor(cache, place=place)
+        core.eager._run_custom_op(
+            "write_cache_kv",
+            paddle.to_tensor(k, place=place),
+            paddle.to_tensor(v, place=place),
+            cache_t,
+            paddle.to_tensor(seq_lens, place=place),
+            paddle.to_tensor(block_tables, place=place),
+        )
+
+        expect = np.copy(cache)
+        for b in range(bsz):
+            for t in range(seq_lens[b]):
+                block = block_tables[b, t // block_size]
+                expect[0, block, :, t % block_size] = k[b, :, t]
+                expect[1, block, :, t % block_size] = v[b, :, t]
+        np.testing.assert_allclose(cache_t.numpy(), expect)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,104 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+class TestGatherOp(OpTest):
+    def setUp(self):
+        self.op_type = "gather"
+        self.python_api = paddle.gather
+        self.init_config()
+        x = np.random.random(self.x_shape).astype(self.dtype)
+        index = np.array(self.index).astype("int64")
+        self.inputs = {"X": x, "Index": index}
+        self.attrs = {"axis": self.axis}
+        self.outputs = {"Out": np.take(x, index, axis=self.axis)}
+
+    def init_config(self):
+        self.x_shape = (10, 20)
+        self.index = [1, 3, 5, 3]
+        self.axis = 0
+        self.dtype = "float32"
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X"], "Out")
+
+
+class TestGatherOpAxis1(TestGatherOp):
+    def init_config(self):
+        self.x_shape = (3, 88, 3)
+        self.index = [1, 3, 5, 87, 0, 5]
+        self.axis = 1
+        self.dtype = "float64"
+
+
+class TestGatherOpSliceOne(TestGatherOp):
+    def init_config(self):
+        self.x_shape = (4, 100)
+        self.index = [99, 0, 7, 7, 42]
+        self.axis = 1
+        self.dtype = "float32"
+
+
+class TestGatherNdOp(OpTest):
+    def setUp(self):
+        self.op_type = "gather_nd"
+        self.python_api = paddle.gather_nd
+        self.init_config()
+        x = np.random.random((5, 6, 7)).astype("float32")
+        self.inputs = {"X": x, "Index": self.index}
+        # an empty tuple of the [3, 0] index selects all of x
+        batch = self.index.shape[:-1]
+        tuples = self.index.reshape(int(np.prod(batch)), self.depth)
+        out = np.stack([x[tuple(i)] for i in tuples])
+        out = out.reshape(batch + x.shape[self.depth :])
+        self.outputs = {"Out": out}
+
+    def init_config(self):
+        self.index = np.array([[1, 2], [4, 5], [1, 2]]).astype("int32")
+        self.depth = 2
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X"], "Out")
+
+
+class TestGatherNdOpEmptyTuple(TestGatherNdOp):
+    def init_config(self):
+        self.index = np.zeros([3, 0], "int64")
+        self.depth = 0
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,135 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle.nn.initializer import TruncatedNormal
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+class TestGaussianRandomOp(OpTest):
+    def setUp(self):
+        self.op_type = "gaussian_random"
+        self.python_api = paddle.normal
+        self.set_attrs()
+        self.inputs = {}
+        self.attrs = {
+            "shape": [123, 92],
+            "mean": self.mean,
+            "std": self.std,
+            "seed": 10,
+        }
+        paddle.seed(10)
+        self.outputs = {"Out": np.zeros((123, 92), dtype="float32")}
+
+    def set_attrs(self):
+        self.mean = 1.0
+        self.std = 2.0
+
+    def test_check_output(self):
+        self.check_output_customized(self.verify_output)
+
+    def verify_output(self, outs):
+        self.assertEqual(outs[0].shape, (123, 92))
+        hist, _ = np.histogram(outs[0], range=(-3, 5))
+        hist = hist.astype("float32") / outs[0].size
+        data = np.random.normal(size=(123, 92), loc=1, scale=2)
+        hist2, _ = np.histogram(data, range=(-3, 5))
+        hist2 = hist2.astype("float32") / outs[0].size
+        np.testing.assert_allclose(hist, hist2, rtol=0, atol=0.01)
+
+
+class TestGaussianRandomOpIntMeanStd(TestGaussianRandomOp):
+    def set_attrs(self):
+        self.mean = 1
+        self.std = 2
+
+
+class TestGaussianRandom(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def check_moments(self, dtype):
+        out = paddle.normal(mean=1.0, std=2.0, shape=[1000, 784]).astype(dtype)
+        out = out.numpy().astype("float64")
+        self.assertAlmostEqual(out.mean(), 1.0, delta=0.02)
+        self.assertAlmostEqual(out.std(), 2.0, delta=0.02)
+
+    def test_moments(self):
+        paddle.set_default_dtype("float32")
+        self.check_moments("float32")
+        paddle.set_default_dtype("float64")
+        self.check_moments("float64")
+        paddle.set_default_dtype("float32")
+
+    def test_seed(self):
+        a = paddle.tensor.random.gaussian([1001], seed=10).numpy()
+        b = paddle.tensor.random.gaussian([1001], seed=10).numpy()
+        c = paddle.tensor.random.gaussian([1001], seed=11).numpy()
+        np.testing.assert_array_equal(a, b)
+        self.assertFalse(np.array_equal(a, c))
+
+    def test_unseeded_draws_differ(self):
+        a = paddle.randn([1024]).numpy()
+        b = paddle.randn([1024]).numpy()
+        self.assertFalse(np.array_equal(a, b))
+
+
+class TestTruncatedGaussianRandom(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def sample(self, mean, std, a, b):
+        linear = paddle.nn.Linear(
+            1000,
+            500,
+            weight_attr=paddle.ParamAttr(
+                initializer=TruncatedNormal(mean=mean, std=std, a=a, b=b)
+            ),
+        )
+        return linear.weight.numpy().astype("float64")
+
+    def test_wide_window(self):
+        out = self.sample(0.0, 1.0, -2.0, 2.0)
+        self.assertTrue(np.all(out >= -2.0) and np.all(out <= 2.0))
+        self.assertAlmostEqual(out.mean(), 0.0, delta=0.01)
+        # std of N(0, 1) truncated to [-2, 2]
+        self.assertAlmostEqual(out.std(), 0.8796, delta=0.01)
+
+    def test_tail_window(self):
+        # acceptance ~ 2%: sampled through the inverse CDF
+        out = self.sample(0.0, 1.0, 2.0, 3.0)
+        self.assertTrue(np.all(out >= 2.0) and np.all(out <= 3.0))
+        self.assertAlmostEqual(out.mean(), 2.3158, delta=0.01)
+
+
+if __name__ == "__main__":
+    unittest.main()
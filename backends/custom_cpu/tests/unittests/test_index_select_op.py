@@ -0,0 +1,79 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+class TestIndexSelectOp(OpTest):
+    def setUp(self):
+        self.op_type = "index_select"
+        self.python_api = paddle.index_select
+        self.init_config()
+        x = np.random.random(self.x_shape).astype("float32")
+        index = np.array(self.index).astype("int64")
+        self.inputs = {"X": x, "Index": index}
+        self.attrs = {"dim": self.dim}
+        self.outputs = {"Out": np.take(x, index, axis=self.dim)}
+
+    def init_config(self):
+        self.x_shape = (10, 30, 4)
+        self.index = [1, 3, 29, 3, 0]
+        self.dim = 1
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X"], "Out")
+
+
+class TestIndexSelectOpLastDim(TestIndexSelectOp):
+    def init_config(self):
+        self.x_shape = (5, 64)
+        self.index = [63, 2, 2, 10]
+        self.dim = -1
+
+
+class TestIndexSampleOp(OpTest):
+    def setUp(self):
+        self.op_type = "index_sample"
+        self.python_api = paddle.index_sample
+        x = np.random.random((10, 20)).astype("float32")
+        index = np.random.randint(0, 20, (10, 6)).astype("int64")
+        self.inputs = {"X": x, "Index": index}
+        self.outputs = {"Out": np.take_along_axis(x, index, axis=1)}
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X"], "Out")
+
+
+if __name__ == "__main__":
+    unittest.main()
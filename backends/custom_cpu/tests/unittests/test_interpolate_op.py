@@ -0,0 +1,337 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import math
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+import paddle.nn.functional as F
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def np_cubic(t):
+    a = -0.75
+
+    def near(x):
+        return ((a + 2) * x - (a + 3)) * x * x + 1
+
+    def far(x):
+        return ((a * x - 5 * a) * x + 8 * a) * x - 4 * a
+
+    return [far(t + 1), near(t), near(1 - t), far(2 - t)]
+
+
+def np_axis(mode, n_in, n_out, align_corners, align_mode=0):
+    """The [n_out, n_in] matrix resampling one axis."""
+    ratio = 0.0
+    if n_out > 1:
+        ratio = (n_in - 1) / (n_out - 1) if align_corners else n_in / n_out
+    half_pixel = align_mode == 0 and not align_corners
+    w = np.zeros([n_out, n_in])
+    for o in range(n_out):
+        if mode == "nearest":
+            w[o, min(int(ratio * o + (0.5 if align_corners else 0)), n_in - 1)] = 1
+        elif mode == "bilinear":
+            center = ratio * (o + 0.5) - 0.5
+            i0 = max(int(center) if half_pixel else int(ratio * o), 0)
+            lam = max(center, 0) - i0 if half_pixel else ratio * o - i0
+            w[o, i0] += 1 - lam
+            w[o, min(i0 + 1, n_in - 1)] += lam
+        else:
+            src = ratio * o if align_corners else ratio * (o + 0.5) - 0.5
+            i = math.floor(src)
+            for t, c in enumerate(np_cubic(src - i)):
+                w[o, min(max(i - 1 + t, 0), n_in - 1)] += c
+    return w
+
+
+def interp_wrapper(method):
+    def api(
+        x,
+        OutSize=None,
+        SizeTensor=None,
+        Scale=None,
+        data_layout="NCHW",
+        out_d=-1,
+        out_h=-1,
+        out_w=-1,
+        scale=[],
+        interp_method=method,
+        align_corners=True,
+        align_mode=0,
+    ):
+        return getattr(paddle._C_ops, method + "_interp")(
+            x,
+            OutSize,
+            SizeTensor,
+            Scale,
+            data_layout,
+            out_d,
+            out_h,
+            out_w,
+            scale,
+            interp_method,
+            align_corners,
+            align_mode,
+        )
+
+    return api
+
+
+class TestInterpOp(OpTest):
+    def setUp(self):
+        self.init_config()
+        self.op_type = self.interp_method + "_interp_v2"
+        self.python_api = interp_wrapper(self.interp_method)
+        n, c, h, w = self.input_shape
+        x = np.random.uniform(-1, 1, self.input_shape).astype(self.dtype)
+        out_h, out_w = self.out_h, self.out_w
+        if self.scale:
+            out_h, out_w = int(h * self.scale[0]), int(w * self.scale[1])
+        wy = np_axis(self.interp_method, h, out_h, self.align_corners, self.align_mode)
+        wx = np_axis(self.interp_method, w, out_w, self.align_corners, self.align_mode)
+        out = np.einsum("kh,nchw,lw->nckl", wy, x.astype("float64"), wx)
+        if self.data_layout == "NHWC":
+            x, out = x.transpose([0, 2, 3, 1]), out.transpose([0, 2, 3, 1])
+        self.inputs = {"X": x}
+        self.attrs = {
+            "out_h": self.out_h,
+            "out_w": self.out_w,
+            "interp_method": self.interp_method,
+            "align_corners": self.align_corners,
+            "align_mode": self.align_mode,
+            "data_layout": self.data_layout,
+        }
+        if self.scale:
+            self.attrs["scale"] = self.scale
+        self.outputs = {"Out": out.astype(self.dtype)}
+
+    def init_config(self):
+        self.interp_method = "bilinear"
+        self.input_shape = [2, 3, 7, 9]
+        self.out_h = 12
+        self.out_w = 5
+        self.scale = []
+        self.align_corners = False
+        self.align_mode = 0
+        self.data_layout = "NCHW"
+        self.dtype = "float64"
+
+    def test_check_output(self):
+        atol = 1e-2 if self.dtype == "float16" else 1e-10
+        self.check_output(atol=atol)
+
+    def test_check_grad(self):
+        if self.dtype == "float64":
+            self.check_grad(["X"], "Out")
+
+
+class TestInterpOpBilinearNHWC(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.data_layout = "NHWC"
+
+
+class TestInterpOpBilinearAlignCorners(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.out_h = 4
+        self.out_w = 17
+        self.align_corners = True
+
+
+class TestInterpOpBilinearAlignMode(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.out_h = 9
+        self.out_w = 9
+        self.align_mode = 1
+        self.data_layout = "NHWC"
+
+
+class TestInterpOpBilinearFP16(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.dtype = "float16"
+
+
+class TestInterpOpNearest(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.interp_method = "nearest"
+
+
+class TestInterpOpNearestNHWC(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.interp_method = "nearest"
+        self.data_layout = "NHWC"
+
+
+class TestInterpOpNearestScale(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.interp_method = "nearest"
+        self.input_shape = [1, 2, 5, 6]
+        self.out_h = -1
+        self.out_w = -1
+        self.scale = [2.0, 2.0]
+
+
+class TestInterpOpBicubic(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.interp_method = "bicubic"
+
+
+class TestInterpOpBicubicAlignCornersNHWC(TestInterpOp):
+    def init_config(self):
+        super().init_config()
+        self.interp_method = "bicubic"
+        self.out_h = 5
+        self.out_w = 20
+        self.align_corners = True
+        self.data_layout = "NHWC"
+
+
+class TestInterpolateUint8(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        paddle.set_device("custom_cpu")
+        np.random.seed(2024)
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def test_uint8(self):
+        x = np.random.randint(0, 256, [1, 3, 6, 6]).astype("uint8")
+        out = F.interpolate(paddle.to_tensor(x), size=[11, 11], mode="bicubic")
+        wy = np_axis("bicubic", 6, 11, False)
+        expect = np.einsum("kh,nchw,lw->nckl", wy, x.astype("float64"), wy)
+        expect = np.clip(expect, 0, 255).astype("uint8")
+        self.assertLessEqual(
+            np.abs(out.numpy().astype(int) - expect.astype(int)).max(), 1
+        )
+
+
+
+class TestInterpolateZeroSize(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        paddle.set_device("custom_cpu")
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def test_interpolate(self):
+        x = paddle.zeros([0, 3, 6, 6])
+        x.stop_gradient = False
+        out = F.interpolate(x, size=[11, 11], mode="bilinear")
+        self.assertEqual(out.shape, [0, 3, 11, 11])
+        out.sum().backward()
+        self.assertEqual(x.grad.shape, [0, 3, 6, 6])
+
+    def test_grid_sample(self):
+        x = paddle.ones([2, 3, 6, 6])
+        x.stop_gradient = False
+        grid = paddle.zeros([2, 0, 5, 2])
+        grid.stop_gradient = False
+        out = F.grid_sample(x, grid, align_corners=False)
+        self.assertEqual(out.shape, [2, 3, 0, 5])
+        out.sum().backward()
+        np.testing.assert_array_equal(x.grad.numpy(), np.zeros([2, 3, 6, 6]))
+
+def np_grid_sample(x, grid, align_corners, padding_mode):
+    n, c, h, w = x.shape
+    _, gh, gw, _ = grid.shape
+
+    def source(g, size):
+        if align_corners:
+            v = (g + 1) / 2 * (size - 1)
+        else:
+            v = ((g + 1) * size - 1) / 2
+        return np.clip(v, 0, size - 1) if padding_mode == "border" else v
+
+    out = np.zeros([n, c, gh, gw])
+    for b in range(n):
+        gx = source(grid[b, ..., 0], w)
+        gy = source(grid[b, ..., 1], h)
+        x0, y0 = np.floor(gx).astype(int), np.floor(gy).astype(int)
+        for dy in (0, 1):
+            for dx in (0, 1):
+                xi, yi = x0 + dx, y0 + dy
+                wt = (1 - np.abs(gx - xi)) * (1 - np.abs(gy - yi))
+                ok = (xi >= 0) & (xi < w) & (yi >= 0) & (yi < h)
+                v = x[b][:, np.clip(yi, 0, h - 1), np.clip(xi, 0, w - 1)]
+                out[b] += v * (wt * ok)
+    return out
+
+
+class TestGridSampleOp(OpTest):
+    def setUp(self):
+        self.op_type = "grid_sampler"
+        self.python_api = F.grid_sample
+        self.init_config()
+        x = np.random.uniform(-1, 1, [2, 3, 5, 6])
+        grid = np.random.uniform(-1.3, 1.3, [2, 4, 7, 2])
+        self.inputs = {"X": x, "Grid": grid}
+        self.attrs = {
+            "mode": "bilinear",
+            "padding_mode": self.padding_mode,
+            "align_corners": self.align_corners,
+        }
+        out = np_grid_sample(x, grid, self.align_corners, self.padding_mode)
+        self.outputs = {"Output": out}
+
+    def init_config(self):
+        self.padding_mode = "zeros"
+        self.align_corners = True
+
+    def test_check_output(self):
+        self.check_output(atol=1e-10)
+
+    def test_check_grad(self):
+        self.check_grad(["X", "Grid"], "Output", max_relative_error=0.01)
+
+
+class TestGridSampleOpUnaligned(TestGridSampleOp):
+    def init_config(self):
+        self.padding_mode = "zeros"
+        self.align_corners = False
+
+
+class TestGridSampleOpBorder(TestGridSampleOp):
+    def init_config(self):
+        self.padding_mode = "border"
+        self.align_corners = True
+
+
+class TestGridSampleOpBorderUnaligned(TestGridSampleOp):
+    def init_config(self):
+        self.padding_mode = "border"
+        self.align_corners = False
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,142 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle.base import core
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+    if lib.endswith(".so"):
+        paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+            lib
+        )
+
+# phi::DataLayout
+NHWC, NCHW = 1, 2
+
+
+def reorder(x, src_format, dst_format, channels=-1):
+    return core.eager._run_custom_op(
+        "layout_reorder", x, src_format, dst_format, channels
+    )[0]
+
+
+def to_blocked(x_nchw):
+    n, c, h, w = x_nchw.shape
+    blocks = (c + 15) // 16
+    padded = np.zeros((n, blocks * 16, h, w), x_nchw.dtype)
+    padded[:, :c] = x_nchw
+    return padded.reshape(n, blocks, 16, h, w).transpose(0, 1, 3, 4, 2)
+
+
+def transfer_layout(x, src_layout=-1, dst_layout=-1):
+    return paddle._C_ops.transfer_layout(x, src_layout, dst_layout)
+
+
+class TestTransferLayoutOp(OpTest):
+    def setUp(self):
+        self.op_type = "transfer_layout"
+        self.python_api = transfer_layout
+        self.init_config()
+        # channels not a multiple of 16, odd spatial size
+        x = np.random.uniform(-1, 1, (2, 37, 9, 13)).astype(self.dtype)
+        if self.src_layout == NHWC:
+            x = x.transpose(0, 2, 3, 1)
+        perm = (0, 2, 3, 1) if self.dst_layout == NHWC else (0, 3, 1, 2)
+        self.inputs = {"X": x}
+        self.attrs = {"src_layout": self.src_layout, "dst_layout": self.dst_layout}
+        self.outputs = {"Out": x.transpose(perm)}
+
+    def init_config(self):
+        self.src_layout = NCHW
+        self.dst_layout = NHWC
+        self.dtype = "float32"
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestTransferLayoutOpToNCHW(TestTransferLayoutOp):
+    def init_config(self):
+        self.src_layout = NHWC
+        self.dst_layout = NCHW
+        self.dtype = "float64"
+
+
+class TestLayoutReorder(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+        # channels not a multiple of 16, odd spatial size
+        self.x = np.random.uniform(-1, 1, (2, 37, 9, 13)).astype("float32")
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def to_tensor(self, x):
+        return paddle.to_tensor(x, place=self.place)
+
+    def test_nchw_nhwc(self):
+        x = self.to_tensor(self.x)
+        nhwc = reorder(x, "NCHW", "NHWC")
+        np.testing.assert_array_equal(
+            nhwc.numpy(), self.x.transpose(0, 2, 3, 1)
+        )
+        np.testing.assert_array_equal(
+            reorder(nhwc, "NHWC", "NCHW").numpy(), self.x
+        )
+
+    def test_blocked(self):
+        expect = to_blocked(self.x)
+        blocked = reorder(self.to_tensor(self.x), "NCHW", "nChw16c")
+        np.testing.assert_array_equal(blocked.numpy(), expect)
+        nhwc = self.to_tensor(self.x.transpose(0, 2, 3, 1))
+        np.testing.assert_array_equal(
+            reorder(nhwc, "NHWC", "nChw16c").numpy(), expect
+        )
+
+        back = reorder(blocked, "nChw16c", "NCHW", 37)
+        np.testing.assert_array_equal(back.numpy(), self.x)
+        back = reorder(blocked, "nChw16c", "NHWC", 37)
+        np.testing.assert_array_equal(
+            back.numpy(), self.x.transpose(0, 2, 3, 1)
+        )
+        # without the channel count all padded channels are kept
+        self.assertEqual(
+            reorder(blocked, "nChw16c", "NCHW").shape, [2, 48, 9, 13]
+        )
+
+    def test_activation_in_blocked_layout(self):
+        # elementwise kernels are layout agnostic, so a chain can stay blocked
+        blocked = reorder(self.to_tensor(self.x), "NCHW", "nChw16c")
+        out = reorder(paddle.nn.functional.relu(blocked), "nChw16c", "NCHW", 37)
+        np.testing.assert_array_equal(out.numpy(), np.maximum(self.x, 0))
+
+
+if __name__ == "__main__":
+    unittest.main()
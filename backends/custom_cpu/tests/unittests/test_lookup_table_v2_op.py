@@ -0,0 +1,90 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+class TestLookupTableV2Op(OpTest):
+    def setUp(self):
+        self.op_type = "lookup_table_v2"
+        self.python_api = paddle.nn.functional.embedding
+        self.init_config()
+        table = np.random.random((17, 31)).astype("float32")
+        ids = np.random.randint(0, 17, self.ids_shape).astype(self.id_dtype)
+        out = table[ids]
+        if self.padding_idx != -1:
+            out[ids == self.padding_idx] = 0
+        self.inputs = {"W": table, "Ids": ids}
+        self.attrs = {"padding_idx": self.padding_idx}
+        self.outputs = {"Out": out}
+
+    def init_config(self):
+        self.ids_shape = (4, 50)
+        self.id_dtype = "int64"
+        self.padding_idx = -1
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["W"], "Out", no_grad_set=set("Ids"))
+
+
+class TestLookupTableV2OpInt32(TestLookupTableV2Op):
+    def init_config(self):
+        self.ids_shape = (200,)
+        self.id_dtype = "int32"
+        self.padding_idx = -1
+
+
+class TestLookupTableV2OpPadding(TestLookupTableV2Op):
+    def init_config(self):
+        self.ids_shape = (4, 50)
+        self.id_dtype = "int64"
+        self.padding_idx = 3
+
+
+class TestEmbeddingGradDeterministic(unittest.TestCase):
+    def test_repeated_ids(self):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+        table = np.random.random((10, 8)).astype("float32")
+        ids = np.array([[1, 3, 1, 1], [9, 3, 0, 1]]).astype("int64")
+        out_grad = np.random.random((2, 4, 8)).astype("float32")
+
+        w = paddle.to_tensor(table, stop_gradient=False)
+        out = paddle.nn.functional.embedding(paddle.to_tensor(ids), w)
+        out.backward(paddle.to_tensor(out_grad))
+
+        expect = np.zeros_like(table)
+        np.add.at(expect, ids.reshape(-1), out_grad.reshape(-1, 8))
+        np.testing.assert_allclose(w.grad.numpy(), expect, rtol=1e-6)
+        paddle.enable_static()
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,145 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+class TestMaskedSelectOp(OpTest):
+    def setUp(self):
+        self.op_type = "masked_select"
+        self.python_api = paddle.masked_select
+        self.init_config()
+        x = np.random.random(self.shape).astype(self.dtype)
+        mask = np.random.randint(2, size=self.mask_shape).astype(bool)
+        self.inputs = {"X": x, "Mask": mask}
+        self.outputs = {"Y": x[np.broadcast_to(mask, x.shape)]}
+
+    def init_config(self):
+        self.shape = (50, 3)
+        self.mask_shape = (50, 3)
+        self.dtype = "float32"
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X"], "Y")
+
+
+class TestMaskedSelectOp4D(TestMaskedSelectOp):
+    def init_config(self):
+        self.shape = (6, 8, 9, 18)
+        self.mask_shape = (6, 8, 9, 18)
+        self.dtype = "float64"
+
+
+class TestMaskedSelectOpBroadcast(TestMaskedSelectOp):
+    def init_config(self):
+        self.shape = (5, 6)
+        self.mask_shape = (6,)
+        self.dtype = "float32"
+
+
+class TestWhereOp(OpTest):
+    def setUp(self):
+        self.op_type = "where"
+        self.python_api = paddle.where
+        cond = np.random.rand(7, 33) > 0.5
+        x = np.random.rand(7, 33).astype("float64")
+        y = np.random.rand(7, 33).astype("float64")
+        self.inputs = {"Condition": cond, "X": x, "Y": y}
+        self.outputs = {"Out": np.where(cond, x, y)}
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X", "Y"], "Out")
+
+
+class TestWhereIndexOp(OpTest):
+    def setUp(self):
+        self.op_type = "where_index"
+        self.python_api = paddle.nonzero
+        self.init_config()
+        self.inputs = {"Condition": self.x}
+        self.outputs = {"Out": np.argwhere(self.x).astype("int64")}
+
+    def init_config(self):
+        self.x = (np.random.rand(3, 70, 5) < 0.2).astype("float32")
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestWhereIndexOpInt64(TestWhereIndexOp):
+    def init_config(self):
+        self.x = (np.random.rand(3, 70, 5) < 0.2).astype("int64")
+
+
+class TestWhereIndexOpBool(TestWhereIndexOp):
+    def init_config(self):
+        self.x = np.random.rand(3, 70, 5) < 0.2
+
+
+class TestWhereIndexOpTiny(TestWhereIndexOp):
+    def init_config(self):
+        # any nonzero value counts, however small
+        self.x = np.array([0.0, 1e-9, -2.0], "float32")
+
+
+class TestMaskOps(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def to_tensor(self, x, stop_gradient=True):
+        return paddle.to_tensor(x, place=self.place, stop_gradient=stop_gradient)
+
+    def test_compare_broadcast_large(self):
+        x = np.random.randint(0, 4, (64, 1, 300)).astype("int64")
+        y = np.random.randint(0, 4, (1, 70, 300)).astype("int64")
+        out = paddle.less_than(self.to_tensor(x), self.to_tensor(y))
+        np.testing.assert_array_equal(out.numpy(), x < y)
+        out = paddle.equal(self.to_tensor(x), self.to_tensor(y[0, 0]))
+        np.testing.assert_array_equal(out.numpy(), x == y[0, 0])
+
+    def test_masked_select(self):
+        # sparse, dense and empty masks over several words and blocks
+        for density in [0.001, 0.5, 0.0, 1.0]:
+            x = np.random.rand(301, 129).astype("float32")
+            mask = np.random.rand(301, 129) < density
+            out = paddle.masked_select(self.to_tensor(x), self.to_tensor(mask))
+            np.testing.assert_array_equal(out.numpy(), x[mask])
+
+
+if __name__ == "__main__":
+    unittest.main()
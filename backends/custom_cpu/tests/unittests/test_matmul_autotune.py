@@ -0,0 +1,81 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+# The cache location and the opt-in are read on the first matmul of the
+# process.
+CACHE_DIR = tempfile.mkdtemp()
+os.environ["CUSTOM_CPU_AUTOTUNE_CACHE_DIR"] = CACHE_DIR
+os.environ["CUSTOM_CPU_AUTOTUNE"] = "1"
+
+import numpy as np
+import paddle
+
+
+class TestMatmulAutotune(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+        np.random.seed(2024)
+
+    def check(self, x_shape, y_shape, trans_x=False, trans_y=False):
+        x_np = np.random.uniform(-1, 1, x_shape).astype("float32")
+        y_np = np.random.uniform(-1, 1, y_shape).astype("float32")
+        x = paddle.to_tensor(x_np)
+        y = paddle.to_tensor(y_np)
+        ref = np.matmul(
+            np.swapaxes(x_np, -1, -2) if trans_x else x_np,
+            np.swapaxes(y_np, -1, -2) if trans_y else y_np,
+        )
+        # the first call tunes, the second one uses the cached blocking
+        for _ in range(2):
+            out = paddle.matmul(x, y, transpose_x=trans_x, transpose_y=trans_y)
+            np.testing.assert_allclose(out.numpy(), ref, rtol=1e-5, atol=1e-4)
+
+    def test_tuned_gemm(self):
+        self.check([192, 160], [160, 130])
+        self.check([160, 192], [130, 160], trans_x=True, trans_y=True)
+        self.check([3, 96, 128], [128, 100])
+        files = [f for f in os.listdir(CACHE_DIR) if f.endswith(".bin")]
+        self.assertEqual(len(files), 1)
+        self.assertGreater(os.path.getsize(os.path.join(CACHE_DIR, files[0])), 0)
+
+    def test_read_only_by_default(self):
+        # without the opt-in a process uses the cache but never tunes
+        cache_dir = tempfile.mkdtemp()
+        env = dict(os.environ, CUSTOM_CPU_AUTOTUNE_CACHE_DIR=cache_dir)
+        del env["CUSTOM_CPU_AUTOTUNE"]
+        script = (
+            "import numpy as np, paddle\n"
+            "paddle.set_device('custom_cpu')\n"
+            "x = paddle.to_tensor(np.ones([192, 160], 'float32'))\n"
+            "y = paddle.to_tensor(np.ones([160, 130], 'float32'))\n"
+            "assert (paddle.matmul(x, y).numpy() == 160).all()\n"
+        )
+        subprocess.check_call([sys.executable, "-c", script], env=env)
+        self.assertEqual(os.listdir(cache_dir), [])
+
+    def test_small_batched_gemm(self):
+        self.check([64, 5, 7], [64, 7, 3])
+        self.check([64, 7, 5], [7, 3], trans_x=True)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,101 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import ctypes
+import os
+import unittest
+
+# every tensor goes to the device allocator instead of a cached chunk
+os.environ["FLAGS_use_system_allocator"] = "1"
+
+import numpy as np  # noqa: E402
+import paddle  # noqa: E402
+
+
+def load_plugin():
+    root = os.getenv("CUSTOM_DEVICE_ROOT")
+    for lib in sorted(os.listdir(root)):
+        if lib.endswith(".so"):
+            plugin = ctypes.CDLL(os.path.join(root, lib))
+            if hasattr(plugin, "CustomCpuMemoryPlanBegin"):
+                plugin.CustomCpuMemoryPlanBegin.argtypes = [ctypes.c_char_p]
+                return plugin
+    return None
+
+
+class TestMemoryPlanner(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        self.plugin = load_plugin()
+        self.plugin.CustomCpuMemoryPlanReset()
+        np.random.seed(2024)
+
+    def stats(self):
+        values = [ctypes.c_size_t() for _ in range(4)]
+        self.plugin.CustomCpuMemoryPlanStats(*[ctypes.byref(v) for v in values])
+        return [v.value for v in values]
+
+    def model(self, x, w):
+        h = x
+        for _ in range(8):
+            h = paddle.nn.functional.relu(paddle.matmul(h, w) + 0.5)
+            h = h / (h.sum(-1, keepdim=True) + 1.0)
+        return h
+
+    def expect(self, x, w):
+        h = x
+        for _ in range(8):
+            h = np.maximum(h @ w + 0.5, 0)
+            h = h / (h.sum(-1, keepdims=True) + 1.0)
+        return h
+
+    def run_planned(self, key, x, w):
+        self.plugin.CustomCpuMemoryPlanBegin(key.encode())
+        try:
+            with paddle.no_grad():
+                out = self.model(
+                    paddle.to_tensor(x, place=self.place),
+                    paddle.to_tensor(w, place=self.place),
+                )
+        finally:
+            self.plugin.CustomCpuMemoryPlanEnd()
+        return out.numpy()
+
+    def test_replay(self):
+        x = np.random.rand(16, 64).astype("float32")
+        w = np.random.rand(64, 64).astype("float32")
+        expect = self.expect(x, w)
+        for _ in range(3):
+            out = self.run_planned("mlp/16x64", x, w)
+            np.testing.assert_allclose(out, expect, rtol=1e-5)
+        slab_bytes, served, fallback, plans = self.stats()
+        self.assertEqual(plans, 1)
+        self.assertGreater(served, fallback)
+        self.assertGreater(slab_bytes, 0)
+
+    def test_shape_change(self):
+        w = np.random.rand(64, 64).astype("float32")
+        # a smaller and a larger batch in one bucket widen the plan
+        for rows in [12, 16, 12, 16]:
+            x = np.random.rand(rows, 64).astype("float32")
+            out = self.run_planned("mlp/16x64", x, w)
+            np.testing.assert_allclose(out, self.expect(x, w), rtol=1e-5)
+        _, served, _, plans = self.stats()
+        self.assertEqual(plans, 1)
+        self.assertGreater(served, 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
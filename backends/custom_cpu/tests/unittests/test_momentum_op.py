@@ -0,0 +1,143 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def calculate_momentum_by_numpy(
+    param,
+    grad,
+    mu,
+    velocity,
+    use_nesterov,
+    learning_rate,
+    regularization_method=None,
+    regularization_coeff=1.0,
+):
+    if regularization_method == "l2_decay":
+        grad = grad + regularization_coeff * param
+    velocity_out = mu * velocity + grad
+    if use_nesterov:
+        param_out = param - (grad + velocity_out * mu) * learning_rate
+    else:
+        param_out = param - learning_rate * velocity_out
+    return param_out, velocity_out
+
+
+class TestMomentumOp(OpTest):
+    def setUp(self):
+        self.op_type = "momentum"
+        self.init_config()
+
+        param = np.random.random((123, 321)).astype("float32")
+        grad = np.random.random((123, 321)).astype("float32")
+        velocity = np.zeros((123, 321)).astype("float32")
+        learning_rate = np.array([0.001]).astype("float32")
+        mu = 0.0001
+
+        self.inputs = {
+            "Param": param,
+            "Grad": grad,
+            "Velocity": velocity,
+            "LearningRate": learning_rate,
+        }
+        self.attrs = {
+            "mu": mu,
+            "use_nesterov": self.use_nesterov,
+            "regularization_method": self.regularization_method,
+            "regularization_coeff": self.regularization_coeff,
+        }
+
+        param_out, velocity_out = calculate_momentum_by_numpy(
+            param=param,
+            grad=grad,
+            mu=mu,
+            velocity=velocity,
+            use_nesterov=self.use_nesterov,
+            learning_rate=learning_rate,
+            regularization_method=self.regularization_method,
+            regularization_coeff=self.regularization_coeff,
+        )
+        self.outputs = {"ParamOut": param_out, "VelocityOut": velocity_out}
+
+    def init_config(self):
+        self.use_nesterov = False
+        self.regularization_method = ""
+        self.regularization_coeff = 1.0
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestMomentumOpNesterov(TestMomentumOp):
+    def init_config(self):
+        self.use_nesterov = True
+        self.regularization_method = ""
+        self.regularization_coeff = 1.0
+
+
+class TestMomentumOpL2Decay(TestMomentumOp):
+    def init_config(self):
+        self.use_nesterov = False
+        self.regularization_method = "l2_decay"
+        self.regularization_coeff = 0.9
+
+
+class TestMergedMomentum(unittest.TestCase):
+    def run_momentum(self, use_multi_tensor):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+        paddle.seed(10)
+        np.random.seed(10)
+        model = paddle.nn.Sequential(
+            paddle.nn.Linear(13, 37), paddle.nn.Linear(37, 5)
+        )
+        optimizer = paddle.optimizer.Momentum(
+            learning_rate=0.01,
+            momentum=0.9,
+            parameters=model.parameters(),
+            use_multi_tensor=use_multi_tensor,
+        )
+        for _ in range(3):
+            x = paddle.to_tensor(np.random.random((4, 13)).astype("float32"))
+            out = model(x)
+            out.mean().backward()
+            optimizer.step()
+            optimizer.clear_grad()
+        params = [p.numpy() for p in model.parameters()]
+        paddle.enable_static()
+        return params
+
+    def test_merged_momentum(self):
+        for expect, actual in zip(
+            self.run_momentum(False), self.run_momentum(True)
+        ):
+            np.testing.assert_allclose(expect, actual, rtol=1e-6, atol=1e-6)
+
+
+if __name__ == "__main__":
+    unittest.main()
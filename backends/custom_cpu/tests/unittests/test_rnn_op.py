@@ -0,0 +1,313 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle import _C_ops
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+GATES = {"LSTM": 4, "GRU": 3, "RNN_TANH": 1, "RNN_RELU": 1}
+
+
+def sigmoid(x):
+    return 1.0 / (1.0 + np.exp(-x))
+
+
+def np_cell(mode, x, h, c, w_ih, w_hh, b_ih, b_hh):
+    xg = x @ w_ih.T + b_ih
+    hg = h @ w_hh.T + b_hh
+    if mode == "LSTM":
+        i, f, g, o = np.split(xg + hg, 4)
+        c = sigmoid(f) * c + sigmoid(i) * np.tanh(g)
+        return sigmoid(o) * np.tanh(c), c
+    if mode == "GRU":
+        xr, xz, xc = np.split(xg, 3)
+        hr, hz, hc = np.split(hg, 3)
+        r, z = sigmoid(xr + hr), sigmoid(xz + hz)
+        cand = np.tanh(xc + r * hc)
+        return (h - cand) * z + cand, c
+    v = xg + hg
+    return (np.maximum(v, 0) if mode == "RNN_RELU" else np.tanh(v)), c
+
+
+def np_rnn(mode, x, h0, c0, weights, lengths, num_layers, directions):
+    seq_len, batch, _ = x.shape
+    hidden = h0.shape[-1]
+    biases = weights[len(weights) // 2 :]
+    last_h, last_c = np.zeros_like(h0), np.zeros_like(c0)
+    for layer in range(num_layers):
+        out = np.zeros([seq_len, batch, directions * hidden])
+        for d in range(directions):
+            s = layer * directions + d
+            w_ih, w_hh = weights[2 * s], weights[2 * s + 1]
+            b_ih, b_hh = biases[2 * s], biases[2 * s + 1]
+            for b in range(batch):
+                h, c = h0[s, b], c0[s, b]
+                steps = range(lengths[b])
+                for t in steps if d == 0 else reversed(steps):
+                    h, c = np_cell(mode, x[t, b], h, c, w_ih, w_hh, b_ih, b_hh)
+                    out[t, b, d * hidden : (d + 1) * hidden] = h
+                last_h[s, b], last_c[s, b] = h, c
+        x = out
+    return x, last_h, last_c
+
+
+def make_rnn(mode, seq_len, batch, input_size, hidden, layers, directions):
+    gates = GATES[mode] * hidden
+    weights, biases = [], []
+    for layer in range(layers):
+        width = input_size if layer == 0 else directions * hidden
+        for _ in range(directions):
+            weights.append(np.random.uniform(-0.5, 0.5, [gates, width]))
+            weights.append(np.random.uniform(-0.5, 0.5, [gates, hidden]))
+            biases.append(np.random.uniform(-0.5, 0.5, [gates]))
+            biases.append(np.random.uniform(-0.5, 0.5, [gates]))
+    x = np.random.uniform(-1, 1, [seq_len, batch, input_size])
+    states = [
+        np.random.uniform(-1, 1, [layers * directions, batch, hidden])
+        for _ in range(2 if mode == "LSTM" else 1)
+    ]
+    return x, states, weights + biases
+
+
+def rnn_wrapper(
+    Input,
+    PreState,
+    WeightList=None,
+    SequenceLength=None,
+    dropout_prob=0.0,
+    is_bidirec=False,
+    input_size=10,
+    hidden_size=100,
+    num_layers=1,
+    mode="LSTM",
+    seed=0,
+    is_test=False,
+):
+    return _C_ops.rnn(
+        Input,
+        PreState,
+        WeightList,
+        SequenceLength,
+        dropout_prob,
+        is_bidirec,
+        input_size,
+        hidden_size,
+        num_layers,
+        mode,
+        seed,
+        is_test,
+    )
+
+
+class TestRNNOp(OpTest):
+    def setUp(self):
+        self.op_type = "rnn"
+        self.python_api = rnn_wrapper
+        self.python_out_sig = ["Out", "DropoutState", "State"]
+        self.init_config()
+        directions = 2 if self.is_bidirec else 1
+        x, states, weights = make_rnn(
+            self.mode, 6, 4, 5, self.hidden, self.num_layers, directions
+        )
+        state_names = ["init_h", "init_c"][: len(states)]
+        last_names = ["last_hidden", "last_cell"][: len(states)]
+        self.python_out_sig_sub_name = {"State": last_names}
+        self.grad_names = ["Input"] + state_names
+        self.grad_names += ["w%d" % i for i in range(len(weights))]
+        self.inputs = {
+            "Input": x,
+            "PreState": list(zip(state_names, states)),
+            "WeightList": [("w%d" % i, w) for i, w in enumerate(weights)],
+        }
+        lengths = [6] * 4
+        if self.sequence_length is not None:
+            lengths = self.sequence_length
+            self.inputs["SequenceLength"] = np.array(lengths, "int32")
+        self.attrs = {
+            "dropout_prob": 0.0,
+            "is_bidirec": self.is_bidirec,
+            "input_size": 5,
+            "hidden_size": self.hidden,
+            "num_layers": self.num_layers,
+            "mode": self.mode,
+            "is_test": self.is_test,
+        }
+        c0 = states[1] if self.mode == "LSTM" else np.zeros_like(states[0])
+        out, last_h, last_c = np_rnn(
+            self.mode, x, states[0], c0, weights, lengths, self.num_layers, directions
+        )
+        self.outputs = {
+            "Out": out,
+            "State": list(zip(last_names, [last_h, last_c])),
+            "Reserve": np.ndarray([400]).astype("uint8"),
+            "DropoutState": np.ndarray([300]).astype("uint8"),
+        }
+
+    def init_config(self):
+        self.mode = "LSTM"
+        self.hidden = 3
+        self.num_layers = 1
+        self.is_bidirec = True
+        self.sequence_length = [6, 3, 1, 4]
+        self.is_test = False
+        self.check_gradient = True
+
+    def test_check_output(self):
+        self.check_output(atol=1e-12, no_check_set=["Reserve", "DropoutState"])
+
+    def test_check_grad(self):
+        if self.check_gradient:
+            outputs = ["Out"] + self.python_out_sig_sub_name["State"]
+            self.check_grad(self.grad_names, outputs)
+
+
+class TestRNNOpGRU(TestRNNOp):
+    def init_config(self):
+        super().init_config()
+        self.mode = "GRU"
+        self.sequence_length = None
+
+
+class TestRNNOpTanh(TestRNNOp):
+    def init_config(self):
+        super().init_config()
+        self.mode = "RNN_TANH"
+        self.is_bidirec = False
+
+
+class TestRNNOpRelu(TestRNNOp):
+    def init_config(self):
+        super().init_config()
+        self.mode = "RNN_RELU"
+        self.check_gradient = False
+
+
+class TestRNNOpInference(TestRNNOp):
+    def init_config(self):
+        super().init_config()
+        self.is_test = True
+        self.check_gradient = False
+
+
+class TestRNNOpLSTMStacked(TestRNNOp):
+    def init_config(self):
+        super().init_config()
+        self.hidden = 7
+        self.num_layers = 2
+        self.check_gradient = False
+
+
+class TestRNNOpGRUStacked(TestRNNOp):
+    def init_config(self):
+        super().init_config()
+        self.mode = "GRU"
+        self.hidden = 7
+        self.num_layers = 3
+        self.sequence_length = [2, 6, 0, 5]
+        self.check_gradient = False
+
+
+class TestRnnDropoutGrad(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        paddle.set_device("custom_cpu")
+        np.random.seed(2024)
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def run_rnn(self, mode, x, states, weights, lengths, layers, directions, **kw):
+        seq_lens = None if lengths is None else paddle.to_tensor(lengths, "int32")
+        out, _, state, _ = _C_ops.rnn(
+            x,
+            states,
+            weights,
+            seq_lens,
+            kw.get("dropout", 0.0),
+            directions == 2,
+            x.shape[-1],
+            states[0].shape[-1],
+            layers,
+            mode,
+            kw.get("seed", 0),
+            kw.get("is_test", False),
+        )
+        return out, state
+
+    def test_grad(self):
+        for mode in ["LSTM", "GRU", "RNN_TANH"]:
+            self.check_grad(mode)
+
+    def check_grad(self, mode):
+        x, states, weights = make_rnn(mode, 4, 3, 3, 5, 2, 2)
+        lengths = [4, 2, 3]
+        values = [x] + states + weights
+        # the loss also reads the last states, so their gradients feed back
+        douts = [np.random.uniform(-1, 1, [4, 3, 10])]
+        douts += [np.random.uniform(-1, 1, s.shape) for s in states]
+
+        def forward(tensors):
+            out, state = self.run_rnn(
+                mode,
+                tensors[0],
+                tensors[1 : 1 + len(states)],
+                tensors[1 + len(states) :],
+                lengths,
+                2,
+                2,
+                dropout=0.3,
+                seed=5,
+            )
+            return [out] + list(state)
+
+        def loss(arrays):
+            outs = forward([paddle.to_tensor(a) for a in arrays])
+            return sum(np.sum(o.numpy() * d) for o, d in zip(outs, douts))
+
+        tensors = [paddle.to_tensor(v, stop_gradient=False) for v in values]
+        grads = paddle.grad(
+            forward(tensors), tensors, [paddle.to_tensor(d) for d in douts]
+        )
+        eps = 1e-6
+        for k, (value, grad) in enumerate(zip(values, grads)):
+            # every element of x, a sample of every state, weight and bias
+            indices = list(np.ndindex(*value.shape))
+            if k > 0 and len(indices) > 12:
+                picks = np.random.choice(len(indices), 12, replace=False)
+                indices = [indices[i] for i in picks]
+            for index in indices:
+                up, down = list(values), list(values)
+                up[k], down[k] = value.copy(), value.copy()
+                up[k][index] += eps
+                down[k][index] -= eps
+                expect = (loss(up) - loss(down)) / (2 * eps)
+                np.testing.assert_allclose(
+                    grad.numpy()[index], expect, atol=1e-6, err_msg=mode
+                )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,210 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle.base import core
+
+for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+    if lib.endswith(".so"):
+        paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+            lib
+        )
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def np_penalty(
+    logits, pre_ids, penalty, frequency, presence, cur_len, min_len, eos
+):
+    out = logits.copy()
+    for b in range(logits.shape[0]):
+        if cur_len[b] < 0:
+            continue
+        if cur_len[b] < min_len[b]:
+            out[b, eos] = -1e10
+        ids = pre_ids[b]
+        ids = ids[: np.argmax(ids < 0)] if (ids < 0).any() else ids
+        tokens, counts = np.unique(ids, return_counts=True)
+        for token, count in zip(tokens, counts):
+            logit = out[b, token]
+            logit = logit * penalty[b] if logit < 0 else logit / penalty[b]
+            out[b, token] = logit - count * frequency[b] - presence[b]
+    return out
+
+
+def top_p_sampling_wrapper(x, ps, threshold=None, random_seed=-1):
+    return paddle.tensor.top_p_sampling(x, ps, threshold=threshold, seed=random_seed)
+
+
+class TestTopPSamplingOp(OpTest):
+    def setUp(self):
+        self.op_type = "top_p_sampling"
+        self.python_api = top_p_sampling_wrapper
+        self.python_out_sig = ["out", "ids"]
+        logits = np.random.uniform(-5, 5, [4, 3000]).astype("float32")
+        e = np.exp(logits - logits.max(-1, keepdims=True))
+        probs = e / e.sum(-1, keepdims=True)
+        # a tiny top_p keeps only the most probable token
+        ps = np.full([4, 1], 1e-6, "float32")
+        self.inputs = {"x": probs, "ps": ps}
+        self.attrs = {"random_seed": 1}
+        self.outputs = {
+            "out": probs.max(-1, keepdims=True),
+            "ids": probs.argmax(-1).reshape([4, 1]).astype("int64"),
+        }
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestSamplingOps(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        paddle.set_device("custom_cpu")
+        np.random.seed(2024)
+        self.bs = 4
+        self.vocab = 3000
+        self.logits = np.random.uniform(-5, 5, [self.bs, self.vocab]).astype(
+            "float32"
+        )
+        self.pre_ids = np.random.randint(0, 50, [self.bs, 16]).astype("int64")
+        self.pre_ids[1, 10:] = -1
+        self.penalty = np.full([self.bs, 1], 1.3, "float32")
+        self.frequency = np.full([self.bs, 1], 0.2, "float32")
+        self.presence = np.full([self.bs, 1], 0.5, "float32")
+        self.cur_len = np.array([3, 20, -1, 0], "int64")
+        self.min_len = np.array([5, 5, 5, 5], "int64")
+        self.eos = np.array([7, 8], "int64")
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def penalty_inputs(self):
+        return [
+            paddle.to_tensor(self.pre_ids),
+            paddle.to_tensor(self.logits),
+            paddle.to_tensor(self.penalty),
+            paddle.to_tensor(self.frequency),
+            paddle.to_tensor(self.presence),
+        ]
+
+    def expected_logits(self):
+        return np_penalty(
+            self.logits,
+            self.pre_ids,
+            self.penalty.ravel(),
+            self.frequency.ravel(),
+            self.presence.ravel(),
+            self.cur_len,
+            self.min_len,
+            self.eos,
+        )
+
+    def test_token_penalty(self):
+        out = core.eager._run_custom_op(
+            "get_token_penalty_multi_scores",
+            *self.penalty_inputs(),
+            paddle.to_tensor(self.cur_len),
+            paddle.to_tensor(self.min_len),
+            paddle.to_tensor(self.eos),
+        )[0]
+        expect = self.expected_logits()
+        np.testing.assert_allclose(out.numpy(), expect, rtol=1e-6)
+
+    def test_token_penalty_v2(self):
+        temperatures = np.array([[0.5], [1.0], [2.0], [0.7]], "float32")
+        bad_tokens = np.array([100, 200], "int64")
+        out = core.eager._run_custom_op(
+            "get_token_penalty_multi_scores_v2",
+            *self.penalty_inputs(),
+            paddle.to_tensor(temperatures),
+            paddle.to_tensor(bad_tokens),
+            paddle.to_tensor(self.cur_len),
+            paddle.to_tensor(self.min_len),
+            paddle.to_tensor(self.eos),
+        )[0]
+        expect = self.expected_logits() / temperatures
+        expect[:, bad_tokens] = -1e10
+        np.testing.assert_allclose(out.numpy(), expect, rtol=1e-6)
+
+    def test_stop_value_multi_ends(self):
+        topk_ids = np.array([[3], [8], [7], [9]], "int64")
+        stop_flags = np.array([[False], [False], [True], [False]])
+        ids, flags = core.eager._run_custom_op(
+            "set_stop_value_multi_ends",
+            paddle.to_tensor(topk_ids),
+            paddle.to_tensor(stop_flags),
+            paddle.to_tensor(self.eos),
+            0,
+        )
+        np.testing.assert_array_equal(ids.numpy().ravel(), [3, 8, 7, 9])
+        np.testing.assert_array_equal(flags.numpy().ravel(), [0, 1, 1, 0])
+
+    def probs(self):
+        e = np.exp(self.logits - self.logits.max(-1, keepdims=True))
+        return e / e.sum(-1, keepdims=True)
+
+    def test_top_p_sampling(self):
+        probs = self.probs()
+        x = paddle.to_tensor(probs)
+        ps = paddle.full([self.bs, 1], 0.5, "float32")
+        out, ids = paddle.tensor.top_p_sampling(x, ps, seed=7)
+        _, ids_again = paddle.tensor.top_p_sampling(x, ps, seed=7)
+        np.testing.assert_array_equal(ids.numpy(), ids_again.numpy())
+        for b, token in enumerate(ids.numpy().ravel()):
+            row = np.sort(probs[b])[::-1]
+            kept = np.searchsorted(np.cumsum(row), 0.5) + 1
+            self.assertGreaterEqual(probs[b, token], row[kept - 1])
+            self.assertEqual(out.numpy()[b, 0], probs[b, token])
+
+    def test_fused_token_sampling(self):
+        stop_flags = np.array([[False], [False], [True], [False]])
+        pre_ids, logits, *scores = self.penalty_inputs()
+        # top_k = 1 draws the most probable token after the penalties
+        outs = core.eager._run_custom_op(
+            "fused_token_sampling",
+            logits,
+            pre_ids,
+            *scores,
+            paddle.full([self.bs, 1], 0.8, "float32"),
+            paddle.full([self.bs, 1], 0.9, "float32"),
+            paddle.to_tensor(self.cur_len),
+            paddle.to_tensor(self.min_len),
+            paddle.to_tensor(self.eos),
+            paddle.to_tensor(stop_flags),
+            1,
+            5,
+        )
+        tokens, flags = (t.numpy().ravel() for t in outs)
+        expect = self.expected_logits().argmax(-1)
+        expect[2] = self.eos[0]
+        np.testing.assert_array_equal(tokens, expect)
+        stopped = np.isin(expect, self.eos) | stop_flags.ravel()
+        np.testing.assert_array_equal(flags, stopped)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,99 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def scatter_by_numpy(x, index, updates, overwrite):
+    out = np.copy(x)
+    if overwrite:
+        for i, row in enumerate(index):
+            out[row] = updates[i]
+    else:
+        out[index] = 0
+        for i, row in enumerate(index):
+            out[row] += updates[i]
+    return out
+
+
+class TestScatterOp(OpTest):
+    def setUp(self):
+        self.op_type = "scatter"
+        self.python_api = paddle.scatter
+        self.init_config()
+        x = np.random.random((20, 30)).astype("float32")
+        index = np.array(self.index).astype("int64")
+        updates = np.random.random((len(self.index), 30)).astype("float32")
+        self.inputs = {"X": x, "Ids": index, "Updates": updates}
+        self.attrs = {"overwrite": self.overwrite}
+        self.outputs = {
+            "Out": scatter_by_numpy(x, index, updates, self.overwrite)
+        }
+
+    def init_config(self):
+        self.index = [1, 7, 3, 19]
+        self.overwrite = True
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X", "Updates"], "Out")
+
+
+class TestScatterOpDuplicateAdd(TestScatterOp):
+    def init_config(self):
+        self.index = [1, 7, 1, 3, 7, 7]
+        self.overwrite = False
+
+    def test_check_grad(self):
+        pass
+
+
+class TestScatterNdAddOp(OpTest):
+    def setUp(self):
+        self.op_type = "scatter_nd_add"
+        self.python_api = paddle.scatter_nd_add
+        x = np.random.random((6, 7, 8)).astype("float32")
+        index = np.array([[1, 2], [5, 6], [1, 2], [0, 0]]).astype("int64")
+        updates = np.random.random((4, 8)).astype("float32")
+        out = np.copy(x)
+        for i, (a, b) in enumerate(index):
+            out[a, b] += updates[i]
+        self.inputs = {"X": x, "Index": index, "Updates": updates}
+        self.outputs = {"Out": out}
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X", "Updates"], "Out")
+
+
+if __name__ == "__main__":
+    unittest.main()
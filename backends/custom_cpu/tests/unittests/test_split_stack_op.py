@@ -0,0 +1,213 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+class TestSplitOp(OpTest):
+    def setUp(self):
+        self.op_type = "split"
+        self.python_api = paddle.split
+        self.init_config()
+        x = (np.random.rand(*self.shape) * 10).astype(self.dtype)
+        out = np.split(x, self.indices, axis=self.axis)
+        self.python_out_sig = ["out%d" % i for i in range(len(out))]
+        self.inputs = {"X": x}
+        self.attrs = {"axis": self.axis, "sections": self.sections, "num": self.num}
+        self.outputs = {"Out": [("out%d" % i, o) for i, o in enumerate(out)]}
+
+    def init_config(self):
+        # -1 takes what the other sections leave
+        self.shape = (4, 9, 5)
+        self.axis = 1
+        self.sections = [1, -1, 3]
+        self.num = 0
+        self.indices = [1, 6]
+        self.dtype = "float32"
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        if self.dtype in ["float32", "float64"]:
+            self.check_grad(["X"], self.python_out_sig)
+
+
+class TestSplitOpLastAxis(TestSplitOp):
+    def init_config(self):
+        self.shape = (4, 9, 5)
+        self.axis = -1
+        self.sections = [2, 1, 2]
+        self.num = 0
+        self.indices = [2, 3]
+        self.dtype = "float64"
+
+
+class TestSplitOpNum(TestSplitOp):
+    def init_config(self):
+        self.shape = (6, 4, 3)
+        self.axis = 0
+        self.sections = []
+        self.num = 3
+        self.indices = 3
+        self.dtype = "float32"
+
+
+class TestSplitOpNumInt64(TestSplitOp):
+    def init_config(self):
+        self.shape = (6, 4, 3)
+        self.axis = 1
+        self.sections = []
+        self.num = 2
+        self.indices = 2
+        self.dtype = "int64"
+
+
+class TestSplitOpNumFp16(TestSplitOp):
+    def init_config(self):
+        self.shape = (6, 4, 3)
+        self.axis = 1
+        self.sections = []
+        self.num = 4
+        self.indices = 4
+        self.dtype = "float16"
+
+
+class TestUnbindOp(OpTest):
+    def setUp(self):
+        self.op_type = "unbind"
+        self.python_api = paddle.unbind
+        self.init_config()
+        x = np.random.rand(3, 4, 5).astype("float32")
+        n = x.shape[self.axis]
+        self.python_out_sig = ["out%d" % i for i in range(n)]
+        self.inputs = {"X": x}
+        self.attrs = {"axis": self.axis}
+        self.outputs = {
+            "Out": [("out%d" % i, np.take(x, i, axis=self.axis)) for i in range(n)]
+        }
+
+    def init_config(self):
+        self.axis = 0
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["X"], self.python_out_sig)
+
+
+class TestUnbindOpAxis2(TestUnbindOp):
+    def init_config(self):
+        self.axis = 2
+
+
+class TestStackOp(OpTest):
+    def setUp(self):
+        self.op_type = "stack"
+        self.python_api = paddle.stack
+        self.init_config()
+        xs = [np.random.rand(3, 4, 5).astype("float32") for _ in range(3)]
+        self.x_names = ["x%d" % i for i in range(len(xs))]
+        self.inputs = {"X": list(zip(self.x_names, xs))}
+        self.attrs = {"axis": self.axis}
+        self.outputs = {"Y": np.stack(xs, axis=self.axis)}
+
+    def init_config(self):
+        self.axis = 0
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(self.x_names, "Y")
+
+
+class TestStackOpAxis1(TestStackOp):
+    def init_config(self):
+        self.axis = 1
+
+
+class TestStackOpLastAxis(TestStackOp):
+    def init_config(self):
+        self.axis = -1
+
+
+class TestSplitStackOps(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        self.place = paddle.CustomPlace("custom_cpu", 0)
+        np.random.seed(2024)
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def to_tensor(self, x, stop_gradient=True):
+        return paddle.to_tensor(x, place=self.place, stop_gradient=stop_gradient)
+
+    def test_split_outputs_do_not_alias(self):
+        # in-place ops on x or on an output leave the other untouched
+        x = np.random.rand(8, 16).astype("float32")
+        x_t = self.to_tensor(x)
+        outs = paddle.split(x_t, [3, 5], axis=0)
+        outs[0].scale_(2.0)
+        np.testing.assert_array_equal(x_t.numpy(), x)
+        x_t.scale_(3.0)
+        np.testing.assert_array_equal(outs[0].numpy(), x[:3] * 2)
+        np.testing.assert_array_equal(outs[1].numpy(), x[3:])
+
+        unbound = paddle.unbind(x_t, axis=0)
+        unbound[1].scale_(0.0)
+        np.testing.assert_array_equal(x_t.numpy(), x * 3)
+
+    def test_concat_grad(self):
+        xs = [np.random.rand(5, n, 7).astype("float32") for n in [1, 4, 2]]
+        tensors = [self.to_tensor(x, stop_gradient=False) for x in xs]
+        tensors[1].stop_gradient = True
+        out = paddle.concat(tensors, axis=1)
+        np.testing.assert_array_equal(out.numpy(), np.concatenate(xs, axis=1))
+        dy = np.random.rand(*out.shape).astype("float32")
+        out.backward(self.to_tensor(dy))
+        np.testing.assert_array_equal(tensors[0].grad.numpy(), dy[:, :1])
+        self.assertIsNone(tensors[1].grad)
+        np.testing.assert_array_equal(tensors[2].grad.numpy(), dy[:, 5:])
+
+    def test_concat_mismatched_dims(self):
+        xs = [self.to_tensor(np.zeros([2, n, 3], "float32")) for n in [1, 2]]
+        xs.append(self.to_tensor(np.zeros([2, 1, 4], "float32")))
+        with self.assertRaises(Exception):
+            paddle.concat(xs, axis=1)
+
+    def test_concat_large(self):
+        # parallel copy across many narrow rows
+        xs = [np.random.rand(4096, n, 3).astype("float32") for n in [3, 1, 5]]
+        out = paddle.concat([self.to_tensor(x) for x in xs], axis=1)
+        np.testing.assert_array_equal(out.numpy(), np.concatenate(xs, axis=1))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,65 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+class TestTakeAlongAxisOp(OpTest):
+    def setUp(self):
+        self.op_type = "take_along_axis"
+        self.python_api = paddle.take_along_axis
+        self.init_config()
+        x = np.random.random(self.x_shape).astype("float32")
+        index = np.random.randint(
+            0, self.x_shape[self.axis], self.index_shape
+        ).astype("int64")
+        self.inputs = {"Input": x, "Index": index}
+        self.attrs = {"Axis": self.axis}
+        self.outputs = {"Result": np.take_along_axis(x, index, self.axis)}
+
+    def init_config(self):
+        self.x_shape = (5, 5, 5)
+        self.index_shape = (5, 7, 5)
+        self.axis = 1
+
+    def test_check_output(self):
+        self.check_output()
+
+    def test_check_grad(self):
+        self.check_grad(["Input"], "Result")
+
+
+class TestTakeAlongAxisOpAxis0(TestTakeAlongAxisOp):
+    def init_config(self):
+        self.x_shape = (6, 4)
+        self.index_shape = (9, 4)
+        self.axis = 0
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,195 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+import paddle
+from paddle.nn.quant import (
+    weight_dequantize,
+    weight_only_linear,
+    weight_quantize,
+)
+
+paddle.enable_static()
+
+
+def get_places(self):
+    return [paddle.CustomPlace("custom_cpu", 0)]
+
+
+OpTest._get_places = get_places
+
+
+def np_weight_quantize(w, int4, group_size):
+    """[k, n] float32 -> [n, k] int8 (or packed [n / 2, k]) and scales."""
+    k, n = w.shape
+    bound = np.float32(7 if int4 else 127)
+    group = k if group_size == -1 else group_size
+    w = w.reshape(k // group, group, n)
+    scale = np.abs(w).max(axis=1) / bound
+    inv = np.divide(1, scale, out=np.zeros_like(scale), where=scale > 0)
+    v = w * inv[:, None, :]
+    # std::round rounds halves away from zero
+    q = np.clip(np.sign(v) * np.floor(np.abs(v) + 0.5), -bound, bound)
+    q = q.reshape(k, n).T.astype("int8")
+    if int4:
+        low, high = q[0::2].view("uint8") & 0x0F, q[1::2].view("uint8") & 0x0F
+        q = (low | (high << 4)).view("int8")
+    return q, scale[0] if group_size == -1 else scale
+
+
+def np_weight_dequantize(q, scale, int4, group_size):
+    if int4:
+        low = (q << 4).view("int8") >> 4
+        q = np.stack([low, q >> 4], axis=1).reshape(-1, q.shape[1])
+    n, k = q.shape
+    group = k if group_size == -1 else group_size
+    scale = scale.reshape(-1, n).repeat(group, axis=0)
+    return q.T.astype("float64") * scale
+
+
+class TestWeightQuantizeOp(OpTest):
+    def setUp(self):
+        self.op_type = "weight_quantize"
+        self.python_api = weight_quantize
+        self.init_config()
+        w = np.random.uniform(-1, 1, (self.k, self.n)).astype("float32")
+        q, scale = np_weight_quantize(w, self.int4, self.group_size)
+        self.inputs = {"x": w}
+        self.attrs = {
+            "algo": "weight_only_int4" if self.int4 else "weight_only_int8",
+            "arch": 80,
+            "group_size": self.group_size,
+        }
+        self.outputs = {"out": q, "scale": scale}
+
+    def init_config(self):
+        self.k = 128
+        self.n = 64
+        self.int4 = False
+        self.group_size = -1
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestWeightQuantizeOpInt4(TestWeightQuantizeOp):
+    def init_config(self):
+        self.k = 128
+        self.n = 64
+        self.int4 = True
+        self.group_size = -1
+
+
+class TestWeightQuantizeOpGroupwise(TestWeightQuantizeOp):
+    def init_config(self):
+        self.k = 256
+        self.n = 32
+        self.int4 = False
+        self.group_size = 64
+
+
+class TestWeightOnlyLinearOp(TestWeightQuantizeOp):
+    def setUp(self):
+        self.op_type = "weight_only_linear"
+        self.python_api = weight_only_linear
+        self.init_config()
+        x = np.random.uniform(-1, 1, (3, 5, self.k)).astype("float32")
+        w = np.random.uniform(-1, 1, (self.k, self.n)).astype("float32")
+        bias = np.random.uniform(-1, 1, (self.n,)).astype("float32")
+        q, scale = np_weight_quantize(w, self.int4, self.group_size)
+        self.inputs = {"x": x, "weight": q, "bias": bias, "weight_scale": scale}
+        self.attrs = {
+            "weight_dtype": "int4" if self.int4 else "int8",
+            "arch": 80,
+            "group_size": self.group_size,
+        }
+        w = np_weight_dequantize(q, scale, self.int4, self.group_size)
+        out = np.matmul(x.astype("float64"), w) + bias
+        self.outputs = {"out": out.astype("float32")}
+
+    def test_check_output(self):
+        self.check_output(atol=1e-4)
+
+
+class TestWeightOnlyLinearOpInt4(TestWeightOnlyLinearOp):
+    def init_config(self):
+        self.k = 128
+        self.n = 64
+        self.int4 = True
+        self.group_size = -1
+
+
+class TestWeightOnlyLinearOpGroupwise(TestWeightOnlyLinearOp):
+    def init_config(self):
+        self.k = 256
+        self.n = 32
+        self.int4 = False
+        self.group_size = 64
+
+
+def matmul_int8_wrapper(x, y, transpose_x=False, transpose_y=False):
+    return paddle._C_ops.matmul_int8(x, y, transpose_x, transpose_y)
+
+
+class TestMatmulInt8Op(OpTest):
+    def setUp(self):
+        self.op_type = "matmul_int8"
+        self.python_api = matmul_int8_wrapper
+        x = np.random.randint(-128, 128, (2, 7, 33)).astype("int8")
+        y = np.random.randint(-128, 128, (19, 33)).astype("int8")
+        self.inputs = {"x": x, "y": y}
+        self.attrs = {"transpose_x": False, "transpose_y": True}
+        out = np.matmul(x.astype("int32"), y.astype("int32").T)
+        self.outputs = {"out": out}
+
+    def test_check_output(self):
+        self.check_output()
+
+
+class TestWeightDequantize(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+        np.random.seed(2024)
+        self.w = np.random.uniform(-1, 1, (256, 64)).astype("float32")
+
+    def tearDown(self):
+        paddle.enable_static()
+
+    def test_dequantize(self):
+        for algo, bound, group_size in [
+            ("weight_only_int8", 127, -1),
+            ("weight_only_int4", 7, -1),
+            ("weight_only_int8", 127, 64),
+        ]:
+            qw, scale = weight_quantize(
+                paddle.to_tensor(self.w), algo=algo, arch=80, group_size=group_size
+            )
+            w = weight_dequantize(
+                qw, scale, algo=algo, out_dtype="float32", group_size=group_size
+            ).numpy()
+            # Rounding error is at most half a quantization step.
+            step = np.abs(self.w).max() / bound
+            np.testing.assert_allclose(w, self.w, atol=step / 2 + 1e-6)
+            expect = np_weight_dequantize(
+                qw.numpy(), scale.numpy(), algo == "weight_only_int4", group_size
+            )
+            np.testing.assert_allclose(w, expect, rtol=1e-6)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,114 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Fills the custom_cpu autotuning cache for the matmuls of a model.
+
+    python tools/autotune_matmul.py --model_dir ./infer_model \\
+        --batch_size 1 --batch_size 8
+
+Every matmul / matmul_v2 of the inference program is run once on custom_cpu
+per batch size (-1 dims are replaced by it), which tunes the GEMM blocking
+of each shape and stores the winners under CUSTOM_CPU_AUTOTUNE_CACHE_DIR
+(default ~/.cache/paddle_custom_cpu/autotune). Deploy the cache file with
+the model to skip tuning at startup; it is only valid for the CPU model it
+is named after and the thread count it was tuned with (OMP_NUM_THREADS).
+Problems the cache already holds are not tuned again; the script fails when
+the run added no entries at all.
+"""
+
+import argparse
+import glob
+import os
+import sys
+
+# Tuning is opt-in and read on the first matmul of the process.
+os.environ["CUSTOM_CPU_AUTOTUNE"] = "1"
+
+import numpy as np  # noqa: E402
+import paddle  # noqa: E402
+
+
+def cache_dir():
+    default = os.path.join(
+        os.path.expanduser("~"), ".cache", "paddle_custom_cpu", "autotune"
+    )
+    return os.environ.get("CUSTOM_CPU_AUTOTUNE_CACHE_DIR") or default
+
+
+def cache_bytes():
+    # records have a fixed size, so the files only grow with new entries
+    return sum(
+        os.path.getsize(f) for f in glob.glob(os.path.join(cache_dir(), "*.bin"))
+    )
+
+
+def collect_matmuls(program, batch_size):
+    shapes = set()
+    block = program.global_block()
+    for op in block.ops:
+        if op.type == "matmul_v2":
+            trans_x, trans_y = op.attr("trans_x"), op.attr("trans_y")
+        elif op.type == "matmul":
+            trans_x, trans_y = op.attr("transpose_X"), op.attr("transpose_Y")
+        else:
+            continue
+        x = block._var_recursive(op.input("X")[0])
+        y = block._var_recursive(op.input("Y")[0])
+        x_shape = tuple(batch_size if d < 0 else d for d in x.shape)
+        y_shape = tuple(batch_size if d < 0 else d for d in y.shape)
+        shapes.add((x_shape, y_shape, trans_x, trans_y, str(x.dtype)))
+    return sorted(shapes)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model_dir", required=True)
+    parser.add_argument("--model_filename", default=None)
+    parser.add_argument("--params_filename", default=None)
+    parser.add_argument("--batch_size", type=int, action="append")
+    args = parser.parse_args()
+
+    paddle.enable_static()
+    exe = paddle.static.Executor(paddle.CPUPlace())
+    program, _, _ = paddle.static.load_inference_model(
+        args.model_dir,
+        exe,
+        model_filename=args.model_filename,
+        params_filename=args.params_filename,
+    )
+    problems = []
+    for batch_size in args.batch_size or [1]:
+        problems += collect_matmuls(program, batch_size)
+
+    paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+    before = cache_bytes()
+    for x_shape, y_shape, trans_x, trans_y, dtype in sorted(set(problems)):
+        dtype = "float16" if "FP16" in dtype else "float32"
+        x = paddle.to_tensor(np.random.rand(*x_shape).astype(dtype))
+        y = paddle.to_tensor(np.random.rand(*y_shape).astype(dtype))
+        paddle.matmul(x, y, transpose_x=trans_x, transpose_y=trans_y)
+        print(
+            "ran matmul x{} y{} trans_x={} trans_y={} {}".format(
+                list(x_shape), list(y_shape), trans_x, trans_y, dtype
+            )
+        )
+    if problems and cache_bytes() <= before:
+        sys.exit(
+            "no autotuning entries were added to {}: the matmuls above are "
+            "already in the cache or were not tuned".format(cache_dir())
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,85 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Times embedding forward and backward on a large table.
+
+    python tools/benchmark_embedding.py --rows 10000000 --width 64 \\
+        --batch 65536
+"""
+
+import argparse
+import time
+
+import numpy as np
+import paddle
+
+
+def parse_args():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--rows", type=int, default=10000000)
+    parser.add_argument("--width", type=int, default=64)
+    parser.add_argument("--batch", type=int, default=65536)
+    parser.add_argument("--padding_idx", type=int, default=None)
+    parser.add_argument("--warmup", type=int, default=3)
+    parser.add_argument("--repeat", type=int, default=10)
+    return parser.parse_args()
+
+
+def timeit(fn, warmup, repeat):
+    for _ in range(warmup):
+        fn()
+    start = time.perf_counter()
+    for _ in range(repeat):
+        fn()
+    return (time.perf_counter() - start) / repeat
+
+
+def main():
+    args = parse_args()
+    paddle.set_device("custom_cpu")
+
+    table = paddle.to_tensor(
+        np.random.random((args.rows, args.width)).astype("float32"),
+        stop_gradient=False,
+    )
+    # Zipf distributed ids, like the hot rows of a recommendation model.
+    ids = np.random.zipf(1.2, args.batch) % args.rows
+    ids = paddle.to_tensor(ids.astype("int64"))
+
+    def forward():
+        return paddle.nn.functional.embedding(
+            ids, table, padding_idx=args.padding_idx
+        )
+
+    def forward_backward():
+        out = forward()
+        out.sum().backward()
+        table.clear_gradient()
+
+    fwd = timeit(forward, args.warmup, args.repeat)
+    fwd_bwd = timeit(forward_backward, args.warmup, args.repeat)
+    gathered = args.batch * args.width * 4
+    print(
+        "table [{}, {}], {} ids".format(args.rows, args.width, args.batch)
+    )
+    print(
+        "forward          {:8.3f} ms  {:6.2f} GB/s gathered".format(
+            fwd * 1e3, gathered / fwd / 1e9
+        )
+    )
+    print("forward+backward {:8.3f} ms".format(fwd_bwd * 1e3))
+
+
+if __name__ == "__main__":
+    main()
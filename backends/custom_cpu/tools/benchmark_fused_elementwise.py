@@ -0,0 +1,96 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Compares relu(x * w + b) -> cast run op by op against fused_elementwise.
+
+    python tools/benchmark_fused_elementwise.py --numel 16777216 --repeat 20
+
+Effective bandwidth counts the bytes each variant has to move: the unfused
+chain reads and writes a full tensor per op, the fused op reads its inputs
+and writes the output once.
+"""
+
+import argparse
+import os
+import time
+
+import numpy as np
+import paddle
+from paddle.base import core
+
+
+def load_custom_ops():
+    for lib in os.listdir(os.getenv("CUSTOM_DEVICE_ROOT")):
+        if lib.endswith(".so"):
+            paddle.utils.cpp_extension.extension_utils.load_op_meta_info_and_register_op(
+                lib
+            )
+
+
+def timeit(fn, repeat):
+    fn()
+    start = time.perf_counter()
+    for _ in range(repeat):
+        fn()
+    return (time.perf_counter() - start) / repeat
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--numel", type=int, default=1 << 24)
+    parser.add_argument("--hidden", type=int, default=4096)
+    parser.add_argument("--repeat", type=int, default=20)
+    args = parser.parse_args()
+
+    load_custom_ops()
+    paddle.disable_static(paddle.CustomPlace("custom_cpu", 0))
+    rows = args.numel // args.hidden
+    x = paddle.to_tensor(np.random.rand(rows, args.hidden).astype("float32"))
+    w = paddle.to_tensor(np.random.rand(rows, args.hidden).astype("float32"))
+    b = paddle.to_tensor(np.random.rand(args.hidden).astype("float32"))
+
+    def unfused():
+        return paddle.cast(paddle.nn.functional.relu(x * w + b), "float16")
+
+    def fused():
+        # out_dtype 4 is FP16 in framework.proto
+        return core.eager._run_custom_op(
+            "fused_elementwise", x, w, b, "x y mul z add relu", 4
+        )[0]
+
+    np.testing.assert_allclose(
+        unfused().astype("float32").numpy(),
+        fused().astype("float32").numpy(),
+        rtol=1e-3,
+    )
+
+    numel = rows * args.hidden
+    # mul: 2r+1w, add: 1r+1w, relu: 1r+1w, cast: 1r (fp32) + 1w (fp16)
+    unfused_bytes = numel * (4 * 8 + 2)
+    # x, w: 2r, out: 1w (fp16); b stays in cache
+    fused_bytes = numel * (4 * 2 + 2)
+    for name, fn, nbytes in (
+        ("unfused", unfused, unfused_bytes),
+        ("fused", fused, fused_bytes),
+    ):
+        seconds = timeit(fn, args.repeat)
+        print(
+            "{:8s} {:8.2f} ms {:8.2f} GB/s moved".format(
+                name, seconds * 1e3, nbytes / seconds / 1e9
+            )
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,164 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Folds the inference batch_norm ops of a model into the weights before it.
+
+    python tools/fold_batch_norm.py --model_dir ./infer_model \\
+        --output_dir ./infer_model_folded
+
+A batch_norm whose input comes straight from a conv2d / depthwise_conv2d
+or a matmul_v2 with a persistable weight is an affine map per output
+channel, y = x * s + (beta - mean * s) with s = scale / sqrt(var + eps).
+The weight is scaled by s once here and the batch_norm is replaced by an
+elementwise_add of the folded bias. The bias is stored already shaped to
+broadcast the numpy way ([C, 1, 1] for NCHW, [C] for channels last), so
+the add keeps the default axis=-1 and an activation after it fuses into
+fused_elementwise (passes/elementwise_fuse.py), which reads the bias in
+place. A weight read by another op, a batch_norm input read by another op
+or a batch_norm still computing batch statistics is left alone.
+
+fused_conv2d_bn_act folds the statistics per call instead; this tool does
+it once at load time for models run through the predictor.
+"""
+
+import argparse
+
+import numpy as np
+import paddle
+
+
+def consumers(block, name):
+    return [op for op in block.ops if name in op.input_arg_names]
+
+
+def tensor_of(scope, name):
+    return scope.find_var(name).get_tensor()
+
+
+def fold_target(block, bn):
+    """The conv / matmul op producing the input of `bn`, its weight name and
+    the axis of the output channel in the weight, or None."""
+    if not bn.attr("is_test") and not bn.attr("use_global_stats"):
+        return None
+    x = bn.input("X")[0]
+    if len(consumers(block, x)) != 1:
+        return None
+    layout = bn.attr("data_layout")
+    for op in block.ops:
+        if x not in op.output_arg_names:
+            continue
+        if op.type in ("conv2d", "depthwise_conv2d"):
+            conv_layout = op.attr("data_format")
+            conv_layout = "NCHW" if conv_layout == "AnyLayout" else conv_layout
+            if conv_layout != layout:
+                return None
+            weight, axis = op.input("Filter")[0], 0
+        elif op.type == "matmul_v2":
+            rank = len(block._var_recursive(x).shape)
+            if rank != 2 and layout != "NHWC":
+                return None
+            weight = op.input("Y")[0]
+            axis = 0 if op.attr("trans_y") else 1
+        else:
+            return None
+        var = block._var_recursive(weight)
+        if not var.persistable or len(consumers(block, weight)) != 1:
+            return None
+        return op, weight, axis
+    return None
+
+
+def fold_batch_norm(program, scope, place):
+    block = program.global_block()
+    folded = 0
+    index = 0
+    while index < len(block.ops):
+        bn = block.ops[index]
+        target = fold_target(block, bn) if bn.type == "batch_norm" else None
+        if target is None:
+            index += 1
+            continue
+        _, weight, axis = target
+        stats = {
+            key: np.array(tensor_of(scope, bn.input(key)[0]))
+            for key in ("Scale", "Bias", "Mean", "Variance")
+        }
+        bias_dtype = stats["Bias"].dtype
+        stats = {key: value.astype("float64") for key, value in stats.items()}
+        s = stats["Scale"] / np.sqrt(stats["Variance"] + bn.attr("epsilon"))
+        folded_bias = stats["Bias"] - stats["Mean"] * s
+
+        w_tensor = tensor_of(scope, weight)
+        w = np.array(w_tensor)
+        shape = [1] * w.ndim
+        shape[axis] = -1
+        w_tensor.set((w * s.reshape(shape)).astype(w.dtype), place)
+
+        # [C] followed by a 1 per spatial dim after an NCHW channel
+        rank = len(block._var_recursive(bn.input("X")[0]).shape)
+        if bn.attr("data_layout") == "NCHW" and rank > 2:
+            folded_bias = folded_bias.reshape([-1] + [1] * (rank - 2))
+        bias_name = bn.output("Y")[0] + ".folded_bias"
+        bias_var = block.create_var(
+            name=bias_name,
+            shape=folded_bias.shape,
+            dtype=block._var_recursive(bn.input("Bias")[0]).dtype,
+            persistable=True,
+        )
+        scope.var(bias_name).get_tensor().set(folded_bias.astype(bias_dtype), place)
+        block._insert_op(
+            index,
+            type="elementwise_add",
+            inputs={"X": bn.input("X"), "Y": [bias_var]},
+            outputs={"Out": bn.output("Y")},
+            attrs={"axis": -1},
+        )
+        block._remove_op(index + 1)
+        folded += 1
+        index += 1
+    program._sync_with_cpp()
+    return folded
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model_dir", required=True)
+    parser.add_argument("--model_filename", default=None)
+    parser.add_argument("--params_filename", default=None)
+    parser.add_argument("--output_dir", required=True)
+    args = parser.parse_args()
+
+    paddle.enable_static()
+    place = paddle.CPUPlace()
+    exe = paddle.static.Executor(place)
+    program, feed_names, fetch_vars = paddle.static.load_inference_model(
+        args.model_dir,
+        exe,
+        model_filename=args.model_filename,
+        params_filename=args.params_filename,
+    )
+    folded = fold_batch_norm(program, paddle.static.global_scope(), place)
+    block = program.global_block()
+    paddle.static.save_inference_model(
+        args.output_dir + "/inference",
+        [block.var(name) for name in feed_names],
+        fetch_vars,
+        exe,
+        program=program,
+    )
+    print("folded {} batch_norm ops into {}".format(folded, args.output_dir))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+#   Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Static memory planning of custom_cpu inference runs.
+
+    FLAGS_use_system_allocator=1 python tools/memory_plan.py \\
+        --model_dir ./infer_model --batch_size 1 --repeat 10
+
+Each run of the predictor is bracketed by MemoryPlan.run(key), keyed by
+the model and the input shape bucket (every dim rounded up to a power of
+two). The first run of a bucket records the lifetime of every buffer, later
+runs get their buffers from one slab at planned offsets (see
+runtime/memory_planner.h). The planner sees the allocations the framework
+forwards to the device, so FLAGS_use_system_allocator=1 is needed for it to
+see each tensor rather than the chunks of the caching allocator.
+
+The script prints the latency and peak RSS of the runs; compare with a
+--no_plan invocation.
+"""
+
+import argparse
+import contextlib
+import ctypes
+import os
+import resource
+import time
+
+import numpy as np
+
+
+def load_plugin():
+    root = os.getenv("CUSTOM_DEVICE_ROOT")
+    for lib in sorted(os.listdir(root)):
+        if lib.endswith(".so"):
+            plugin = ctypes.CDLL(os.path.join(root, lib))
+            if hasattr(plugin, "CustomCpuMemoryPlanBegin"):
+                return plugin
+    raise RuntimeError("custom_cpu plugin not found in " + root)
+
+
+def shape_bucket(shapes):
+    def round_up(d):
+        return 1 << max(int(d) - 1, 0).bit_length()
+
+    return ";".join("x".join(str(round_up(d)) for d in shape) for shape in shapes)
+
+
+class MemoryPlan:
+    def __init__(self, plugin=None):
+        self.plugin = plugin or load_plugin()
+        self.plugin.CustomCpuMemoryPlanBegin.argtypes = [ctypes.c_char_p]
+
+    @contextlib.contextmanager
+    def run(self, key):
+        self.plugin.CustomCpuMemoryPlanBegin(key.encode())
+        try:
+            yield
+        finally:
+            self.plugin.CustomCpuMemoryPlanEnd()
+
+    def stats(self):
+        values = [ctypes.c_size_t() for _ in range(4)]
+        self.plugin.CustomCpuMemoryPlanStats(*[ctypes.byref(v) for v in values])
+        names = ["slab_bytes", "served", "fallback", "plans"]
+        return dict(zip(names, [v.value for v in values]))
+
+    def reset(self):
+        self.plugin.CustomCpuMemoryPlanReset()
+
+
+def peak_rss_mb():
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024.0
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model_dir", required=True)
+    parser.add_argument("--model_filename", default="inference.pdmodel")
+    parser.add_argument("--params_filename", default="inference.pdiparams")
+    parser.add_argument("--batch_size", type=int, default=1)
+    parser.add_argument("--repeat", type=int, default=10)
+    parser.add_argument("--no_plan", action="store_true")
+    args = parser.parse_args()
+
+    from paddle import inference
+
+    config = inference.Config(
+        os.path.join(args.model_dir, args.model_filename),
+        os.path.join(args.model_dir, args.params_filename),
+    )
+    config.enable_custom_device("custom_cpu")
+    predictor = inference.create_predictor(config)
+    inputs = []
+    for name in predictor.get_input_names():
+        handle = predictor.get_input_handle(name)
+        shape = [args.batch_size if d < 0 else d for d in handle.shape()]
+        inputs.append((handle, np.random.rand(*shape).astype("float32")))
+    key = "{}/{}".format(
+        os.path.abspath(args.model_dir), shape_bucket([x.shape for _, x in inputs])
+    )
+
+    plan = None if args.no_plan else MemoryPlan()
+    start = time.time()
+    for _ in range(args.repeat):
+        for handle, x in inputs:
+            handle.copy_from_cpu(x)
+        with plan.run(key) if plan else contextlib.nullcontext():
+            predictor.run()
+    latency = (time.time() - start) / args.repeat
+    print(
+        "latency {:.3f} ms, peak rss {:.1f} MB".format(latency * 1e3, peak_rss_mb())
+    )
+    if plan:
+        print(plan.stats())
+
+
+if __name__ == "__main__":
+    main()